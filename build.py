@@ -7,6 +7,7 @@
 
 import subprocess
 import os
+import shutil
 import sys
 import platform
 from typing import Optional
@@ -18,12 +19,14 @@ BUILD_DIR = os.path.join(TOP_DIR, "build")
 CPUS = os.getenv('CPUS') or os.cpu_count() or 1
 
 BUILD_TYPE = os.environ["BUILD_TYPE"].title() if "BUILD_TYPE" in os.environ else "Release"
+if BUILD_TYPE == "Pgo":
+  BUILD_TYPE = "PGO"
 BUILD_DOCS = "ON" if "BUILD_DOCS" in os.environ and os.environ["BUILD_DOCS"] in ("1", "ON", "on") else "OFF"
 
 
-def execute(cmd: str, cwd: Optional[str] = None):
+def execute(cmd: str, cwd: Optional[str] = None, env: Optional[dict] = None):
   popen = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
-                           shell=True, text=True, cwd=cwd)
+                           shell=True, text=True, cwd=cwd, env=env)
   for stdout_line in iter(popen.stdout.readline, ""):
     sys.stdout.write(stdout_line)
     sys.stdout.flush()
@@ -44,17 +47,38 @@ def ensure_spidermonkey():
   execute("bash ./setup.sh", cwd=TOP_DIR)
 
 
-def run_cmake_build():
+def run_cmake_build(build_type: str = BUILD_TYPE, extra_options: str = ""):
   os.makedirs(BUILD_DIR, exist_ok=True)  # mkdir -p
 
   if platform.system() == "Windows":
     # use Clang/LLVM toolset for Visual Studio
-    execute(f"cmake -DBUILD_DOCS={BUILD_DOCS} -DPM_BUILD_TYPE={BUILD_TYPE} .. -T ClangCL", cwd=BUILD_DIR)
+    execute(f"cmake -DBUILD_DOCS={BUILD_DOCS} -DPM_BUILD_TYPE={build_type} {extra_options} .. -T ClangCL", cwd=BUILD_DIR)
   else:
-    execute(f"cmake -DBUILD_DOCS={BUILD_DOCS} -DPM_BUILD_TYPE={BUILD_TYPE} ..", cwd=BUILD_DIR)
+    execute(f"cmake -DBUILD_DOCS={BUILD_DOCS} -DPM_BUILD_TYPE={build_type} {extra_options} ..", cwd=BUILD_DIR)
   execute(f"cmake --build . -j{CPUS} --config Release", cwd=BUILD_DIR)
 
 
+def run_pgo_build():
+  """
+  Build instrumented, train on the benchmark suite, and rebuild optimized with the profiles and LTO.
+  The training runs the pythonmonkey package of the source tree with PGO_TRAINING_PYTHON (this Python by default),
+  which needs the runtime dependencies of pythonmonkey installed.
+  """
+  if platform.system() == "Windows":
+    print("The PGO build type is not supported on Windows yet, building Release instead")
+    run_cmake_build("Release")
+    return
+
+  pgo_dir = os.path.join(BUILD_DIR, "pgo")
+  shutil.rmtree(pgo_dir, ignore_errors=True)  # the profiles of an older build would not match
+  run_cmake_build("PGO", f"-DPM_PGO_PHASE=generate -DPM_PGO_DIR={pgo_dir}")
+  copy_artifacts()
+  python = os.getenv("PGO_TRAINING_PYTHON") or sys.executable
+  env = dict(os.environ, PYTHONPATH=os.path.join(TOP_DIR, "python"))
+  execute(f'"{python}" ./tests/bench/bench_conversions.py --simple --fast', cwd=TOP_DIR, env=env)
+  run_cmake_build("PGO", f"-DPM_PGO_PHASE=use -DPM_PGO_DIR={pgo_dir}")
+
+
 def copy_artifacts():
 
   if platform.system() == "Windows":
@@ -68,7 +92,10 @@ def copy_artifacts():
 def build():
   if BUILD_TYPE != "None":  # do not build SpiderMonkey if we are not compiling
     ensure_spidermonkey()
-  run_cmake_build()
+  if BUILD_TYPE == "PGO":
+    run_pgo_build()
+  else:
+    run_cmake_build()
   if BUILD_TYPE != "None":  # do not copy artifacts if we did not build them
     copy_artifacts()
 
@@ -0,0 +1,81 @@
+/**
+ * @file AtomCache.hh
+ * @author agent (agent@local)
+ * @brief Caches of the property keys crossing between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_AtomCache_
+#define PythonMonkey_AtomCache_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief Maximum number of entries of the cache, it is emptied when full
+ */
+#define ATOM_CACHE_MAX_ENTRIES 4096
+
+/**
+ * @brief This struct caches the jsids of interned Python strings, which attribute names almost always are,
+ * so that looking up `jsobj.name` from Python repeatedly skips the UTF-8 encoding, the JS string allocation and the atomization.
+ * In the other direction, it caches the interned Python strings of JS atoms, so that `pyDict.name` from JS is a dict lookup with an interned key.
+ *
+ * The cached Python strings are owned by the caches and the JS atoms are traced by them, each cache is bounded by ATOM_CACHE_MAX_ENTRIES.
+ */
+struct AtomCache {
+public:
+  /**
+   * @brief Initialize the cache, must be called once the JS context has been created
+   *
+   * @param cx - javascript context pointer
+   * @return true - the cache was created
+   * @return false - out of memory
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Destroy the cache, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Get the jsid previously cached for a Python string
+   *
+   * @param key - the Python string
+   * @param idp - set to the cached jsid
+   * @return true - the jsid was found
+   * @return false - key is not interned or not cached
+   */
+  static bool getId(PyObject *key, JS::MutableHandleId idp);
+
+  /**
+   * @brief Remember the jsid of a Python string, does nothing if the string is not interned
+   *
+   * @param key - the Python string
+   * @param id - its jsid
+   */
+  static void putId(PyObject *key, JS::HandleId id);
+
+  /**
+   * @brief Get the interned Python string previously cached for a JS atom
+   *
+   * @param atom - the JS atom, i.e. the string of a string jsid
+   * @return PyObject* - a new reference to the Python string, or NULL if it isn't cached
+   */
+  static PyObject *getKey(JSString *atom);
+
+  /**
+   * @brief Remember the interned Python string of a JS atom
+   *
+   * @param atom - the JS atom, i.e. the string of a string jsid
+   * @param key - the interned Python string, a new reference is taken
+   */
+  static void putKey(JSString *atom, PyObject *key);
+};
+
+#endif
@@ -16,10 +16,61 @@
 
 #include <Python.h>
 
+#include <vector>
+
+/**
+ * @brief The exporter of the memoryviews made from JS buffers. It roots the JS TypedArray or (Shared)ArrayBuffer,
+ * and pins its length so that it can't be detached or resized while the memoryview exists
+ */
+typedef struct {
+  PyObject_HEAD
+  JS::PersistentRootedObject *jsBuffer;
+  void *data;
+  Py_ssize_t byteLength;
+  Py_ssize_t itemSize;
+  Py_ssize_t length; /* number of items */
+  const char *format;
+  bool pinned; /* whether this exporter holds a pin of the length of the ArrayBuffer, false for shared memory */
+  void *pinnedBase; /* the start of the data of the pinned ArrayBuffer */
+} JSBufferExporter;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSBufferExporter type
+ */
+struct JSBufferExporterMethodDefinitions {
+public:
+  /**
+   * @brief Deallocation method (.tp_dealloc), unpins and unroots the JS buffer
+   *
+   * @param self - The JSBufferExporter to be free'd
+   */
+  static void JSBufferExporter_dealloc(JSBufferExporter *self);
+
+  /**
+   * @brief .bf_getbuffer method, exports the JS memory as a writable 1-dimensional buffer
+   *
+   * @param self - The JSBufferExporter
+   * @param view - The buffer view to fill
+   * @param flags - The requested buffer flags
+   * @return int 0 on success, -1 with an exception set otherwise
+   */
+  static int JSBufferExporter_getbuffer(JSBufferExporter *self, Py_buffer *view, int flags);
+};
+
+static PyBufferProcs JSBufferExporter_buffer_methods = {
+  .bf_getbuffer = (getbufferproc)JSBufferExporterMethodDefinitions::JSBufferExporter_getbuffer,
+  .bf_releasebuffer = NULL
+};
+
+extern PyTypeObject JSBufferExporterType;
+
 struct BufferType {
 public:
   /**
-   * @brief Construct a new BufferType object from a JS TypedArray or ArrayBuffer, as a Python [memoryview](https://docs.python.org/3.9/c-api/memoryview.html) object
+   * @brief Construct a new BufferType object from a JS TypedArray, ArrayBuffer or SharedArrayBuffer, as a Python [memoryview](https://docs.python.org/3.9/c-api/memoryview.html) object.
+   * The memoryview is writable and shares the JS memory without copying. It keeps the JS buffer alive, and pins it so that it can't be detached or resized meanwhile.
+   * TypedArrays with inline data have their data moved out of line first, so that it doesn't move with the object during a GC.
+   * Memory backing a SharedArrayBuffer may be accessed concurrently by JS workers and Python threads, as with `Atomics` the ordering is up to the users.
    *
    * @param cx - javascript context pointer
    * @param bufObj - JS object to be coerced
@@ -30,7 +81,8 @@ public:
 
   /**
    * @brief Convert a Python object that [provides the buffer interface](https://docs.python.org/3.9/c-api/typeobj.html#buffer-object-structures) to JS TypedArray.
-   * The subtype (Uint8Array, Float64Array, ...) is automatically determined by the Python buffer's [format](https://docs.python.org/3.9/c-api/buffer.html#c.Py_buffer.format)
+   * The subtype (Uint8Array, Float64Array, ...) is automatically determined by the Python buffer's [format](https://docs.python.org/3.9/c-api/buffer.html#c.Py_buffer.format).
+   * Multidimensional buffers are flattened, their dimensions are exposed as the read-only `shape` and `strides` (in bytes) arrays of the TypedArray
    *
    * @param cx - javascript context pointer
    * @param pyObject - the object to be converted
@@ -38,13 +90,58 @@ public:
   static JSObject *toJsTypedArray(JSContext *cx, PyObject *pyObject);
 
   /**
-   * @returns Is the given JS object either a TypedArray or an ArrayBuffer?
+   * @brief Unpack the numbers of a 1-dimensional Python buffer (e.g. `array.array` or a numpy vector) into a new dense JS Array
+   *
+   * @param cx - javascript context pointer
+   * @param pyObject - the object providing the buffer
+   * @return JSObject* - the JS Array, or nullptr with a Python exception set
+   */
+  static JSObject *toJsArray(JSContext *cx, PyObject *pyObject);
+
+  /**
+   * @brief Pin the length of the ArrayBuffer of a TypedArray or ArrayBuffer for one more exporter. The length stays pinned until the last
+   * exporter of the same ArrayBuffer calls `unpinLength`, the memoryviews and Wasm memory buffers of one ArrayBuffer share the count.
+   *
+   * @param bufObj - the TypedArray or non-shared ArrayBuffer, its data must not be inline
+   * @param base - the start of the data of the ArrayBuffer, which doesn't move while the length is pinned
+   */
+  static void pinLength(JSObject *bufObj, void *base);
+
+  /**
+   * @brief Release the pin taken by `pinLength`, unpinning the length of the ArrayBuffer if it was the last exporter
+   */
+  static void unpinLength(JSObject *bufObj, void *base);
+
+  /**
+   * @returns Is the given JS object either a TypedArray, an ArrayBuffer or a SharedArrayBuffer?
    */
   static bool isSupportedJsTypes(JSObject *obj);
 
+  /**
+   * @brief If true, buffers that are not C-contiguous (e.g. numpy slices or Fortran-ordered arrays) are copied into a new C-ordered ArrayBuffer
+   * instead of raising. The copy doesn't share memory with the Python buffer. C-contiguous buffers are never copied.
+   */
+  static bool copyStridedBuffers;
+
+  /**
+   * @brief If true, immutable buffers (e.g. `bytes`) are copied into a new TypedArray instead of being wrapped by the read-only bytes proxy.
+   * JS has no read-only ArrayBuffers to share the memory safely, the copy trades one memcpy for native-speed element access
+   */
+  static bool copyImmutableBuffers;
+
 protected:
   static PyObject *fromJsTypedArray(JSContext *cx, JS::HandleObject typedArray);
   static PyObject *fromJsArrayBuffer(JSContext *cx, JS::HandleObject arrayBuffer);
+  static PyObject *fromJsSharedArrayBuffer(JSContext *cx, JS::HandleObject sharedArrayBuffer);
+
+  /**
+   * @brief Create a memoryview of JS memory, exported by a JSBufferExporter holding the JS buffer
+   *
+   * @param base - the start of the data of the ArrayBuffer to pin
+   * @param shared - whether the memory is shared, it can't be detached and is not pinned
+   */
+  static PyObject *_exportJsBuffer(JSContext *cx, JS::HandleObject bufObj, void *data, size_t byteLength, JS::Scalar::Type subtype,
+    void *base, bool shared);
 
 private:
   static void _releasePyBuffer(Py_buffer *bufView);
@@ -59,6 +156,16 @@ private:
    * There's no SpiderMonkey API to assign the subtype at execution time
    */
   static JSObject *_newTypedArrayWithBuffer(JSContext *cx, JS::Scalar::Type subtype, JS::HandleObject arrayBuffer);
+
+  /**
+   * @brief Copy a Python buffer that is not C-contiguous into a new TypedArray, used when `copyStridedBuffers` is set
+   */
+  static JSObject *_stridedToJsTypedArray(JSContext *cx, PyObject *pyObject);
+
+  /**
+   * @brief Define the `shape` and `strides` properties of a TypedArray made from a multidimensional buffer
+   */
+  static bool _defineShape(JSContext *cx, JS::HandleObject typedArray, const std::vector<Py_ssize_t> &shape);
 };
 
 #endif
\ No newline at end of file
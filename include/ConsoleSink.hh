@@ -0,0 +1,78 @@
+/**
+ * @file ConsoleSink.hh
+ * @author agent (agent@local)
+ * @brief Buffered output of the JS console to the Python standard streams
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_ConsoleSink_
+#define PythonMonkey_ConsoleSink_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <cstddef>
+
+/**
+ * @brief This struct accumulates the output of the global `console` as UTF-8, instead of calling `sys.stdout.write` for each line.
+ *
+ * The buffer is flushed when it grows past `threshold`, when the JS code returns to Python (the outermost entry point returns,
+ * or JS calls a Python function, which may print too), before anything is written to stderr, and at exit.
+ * If `sys.stdout` is still the stream of the process, its pending text is flushed and the batch is written to its file descriptor;
+ * otherwise, e.g. when the output is captured, the batch goes through a single call of its `write` method.
+ * Stderr is not buffered.
+ */
+struct ConsoleSink {
+public:
+  /**
+   * @brief The size, in bytes, past which the buffered output is flushed right away
+   */
+  static size_t threshold;
+
+  /**
+   * @brief Register the flush at exit with the `atexit` module
+   *
+   * @return true - the flush was registered
+   * @return false - a Python exception was set
+   */
+  static bool init();
+
+  /**
+   * @brief Drop the buffered output, called when PythonMonkey is finalized, after the flush at exit
+   */
+  static void finalize();
+
+  /**
+   * @brief Write a JS string to stdout, buffered, or to stderr, which flushes stdout first
+   *
+   * @param cx - javascript context pointer
+   * @param str - the string
+   * @param toStderr - whether it goes to stderr
+   * @return true - the string was written or buffered
+   * @return false - a JS exception is pending, out of memory
+   */
+  static bool write(JSContext *cx, JS::HandleString str, bool toStderr);
+
+  /**
+   * @brief Write the buffered output out. Python errors are swallowed, a pending Python exception is preserved
+   */
+  static void flush();
+
+  /**
+   * @brief Flush if there is buffered output, cheap enough to call on every return to Python
+   */
+  static inline void flushPending() {
+    if (pending) {
+      flush();
+    }
+  }
+
+private:
+  static bool pending;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file ContextOwner.hh
+ * @author agent (agent@local)
+ * @brief Keep the JS context, and the registries that go with it, on the thread that owns it when CPython runs without the GIL
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_ContextOwner_
+#define PythonMonkey_ContextOwner_
+
+#include <Python.h>
+
+/**
+ * @brief This struct makes PythonMonkey's JS context thread-affine on free-threaded CPython builds (`Py_GIL_DISABLED`, e.g. 3.13t).
+ *
+ * With the GIL, Python threads take turns using the JS context, and the registries of proxies and strings
+ * (`jsStringProxies`, the external strings, the proxy caches, ...) are serialized by it,
+ * except while JS runs on a thread that handed the GIL over (see GILSwitch): the other threads must then leave the context alone,
+ * and the proxies they release are deallocated once the JS code returns.
+ * The module doesn't declare `Py_MOD_GIL_NOT_USED`, as the registries have no locking of their own, so free-threaded builds
+ * enable the GIL again when it is imported, and then behave the same.
+ * Only if the GIL is forced off (PYTHON_GIL=0), the JS context and these registries belong to the thread that imported pythonmonkey:
+ * JS code and the proxies are only used from that thread, and the proxies released by the other threads are deallocated on it.
+ * Parallel JS runs in `pythonmonkey.Worker`s instead, each with its own context.
+ */
+struct ContextOwner {
+public:
+  /**
+   * @brief Make the current thread the owner of the JS context, called when the module is initialized
+   */
+  static void init();
+
+  /**
+   * @brief Check that the JS context can be used from the current thread, and run the deallocations deferred by the other threads
+   *
+   * @return true - the current thread can use the JS context
+   * @return false - a Python RuntimeError was set
+   */
+  static bool check();
+
+  /**
+   * @brief Defer the deallocation of an object released by a thread that can't use the JS context
+   *
+   * @param self - the object being deallocated
+   * @param dealloc - its deallocation method, to be called again by `check` or `runDeferredDeallocs`
+   * @return true - the deallocation was deferred, the caller must return
+   * @return false - the current thread can use the JS context, the caller must deallocate the object now
+   */
+  static bool deferDealloc(PyObject *self, destructor dealloc);
+
+  /**
+   * @brief Run the deferred deallocations, called when the JS code run with the GIL handed over returns
+   */
+  static void runDeferredDeallocs();
+};
+
+#endif
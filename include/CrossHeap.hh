@@ -0,0 +1,79 @@
+/**
+ * @file CrossHeap.hh
+ * @author agent (agent@local)
+ * @brief Collection of the reference cycles that span the Python and the JS heaps
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_CrossHeap_
+#define PythonMonkey_CrossHeap_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct lets the Python cycle collector see the references that go through the JS heap.
+ *
+ * A JSObjectProxy or JSArrayProxy roots its JS object, and the JS proxies of Python objects (and the holders of the Python
+ * functions) own a reference to their Python object, so a cycle like `pyObject -> JSObjectProxy -> JS object -> JS function -> closure -> pyObject`
+ * is invisible to both collectors. Before each full Python collection, the roots of these Python proxies are traced as gray roots
+ * by a full JS GC: the JS things that are still gray afterwards are only reachable from the Python proxies, not from JS.
+ * Each Python object held by a gray JS thing reachable from a single Python proxy is then reported by the `tp_traverse` of that proxy,
+ * so the Python collector finds the whole cycle. Clearing its Python objects releases the proxy, and the next JS GC, run right after, the JS side.
+ *
+ * The JS things reachable from several Python proxies are left out, their Python objects are conservatively kept alive.
+ *
+ * As the scan is a full non-incremental JS GC, it only runs if `enabled`, set by `pythonmonkey.setCollectCrossHeapCycles`.
+ */
+struct CrossHeap {
+public:
+  /**
+   * @brief Whether the full Python collections scan the JS heap for cross-heap cycles (true), or leave them uncollected (false, default)
+   */
+  static bool enabled;
+
+  /**
+   * @brief Install the root tracers of the JS heap and the callback of the Python cycle collector
+   *
+   * @param cx - javascript context pointer
+   * @return true - the collector was installed
+   * @return false - a Python exception was set
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Uninstall the collector, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Register a Python proxy rooting a JS object, called when a JSObjectProxy or JSArrayProxy is created
+   *
+   * @param proxy - the Python proxy
+   * @param root - the root of its JS object, owned by the proxy
+   */
+  static void registerProxy(PyObject *proxy, JS::PersistentRootedObject *root);
+
+  /**
+   * @brief Unregister a Python proxy, called first thing when it is deallocated, possibly during a scan: its root is then given back its JS object
+   *
+   * @param proxy - the Python proxy
+   */
+  static void unregisterProxy(PyObject *proxy);
+
+  /**
+   * @brief The `tp_traverse` of the Python proxies: visit the Python objects held through the JS heap, only during a full Python collection
+   *
+   * @param proxy - the Python proxy
+   * @param visit - the visitor of the Python collector
+   * @param arg - the argument of the visitor
+   * @return int - 0, or the non-zero result of the visitor
+   */
+  static int traverse(PyObject *proxy, visitproc visit, void *arg);
+};
+
+#endif
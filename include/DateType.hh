@@ -22,7 +22,7 @@
 struct DateType {
 public:
   /**
-   * @brief Convert a JS Date object to Python datetime
+   * @brief Convert a JS Date object to a timezone-aware (UTC) Python datetime, or to a float timestamp if `datesAsTimestamps` is set
    */
   static PyObject *getPyObject(JSContext *cx, JS::HandleObject dateObj);
 
@@ -33,6 +33,11 @@ public:
    * @param pyObject - the python datetime object to be converted
    */
   static JSObject *toJsDate(JSContext *cx, PyObject *pyObject);
+
+  /**
+   * @brief If true, JS Dates are converted to Python floats of seconds since the epoch (like `datetime.timestamp()`) instead of datetimes
+   */
+  static bool datesAsTimestamps;
 };
 
 #endif
\ No newline at end of file
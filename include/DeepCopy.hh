@@ -0,0 +1,49 @@
+/**
+ * @file DeepCopy.hh
+ * @author agent (agent@local)
+ * @brief Eager, structured-clone style conversion of whole object graphs between JS and Python
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_DeepCopy_
+#define PythonMonkey_DeepCopy_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct is a bundle of methods that copy a value and everything reachable from it, instead of proxying it.
+ * The copy is a snapshot: later changes on either side are not reflected on the other, but reading the copy never calls back into the other engine.
+ *
+ * Plain objects, arrays and primitives are copied recursively, preserving shared references and cycles.
+ * Dates and typed arrays (or, from Python, buffers) are copied as single values.
+ * Everything else (functions, promises, class instances of the other side, ...) is coerced as usual, i.e. proxied.
+ */
+struct DeepCopy {
+public:
+  /**
+   * @brief Copy a JS value into plain Python objects: dict, list, str, float, bool, None, datetime and memoryview
+   *
+   * @param cx - javascript context pointer
+   * @param value - the JS value to copy
+   * @return PyObject* - a new reference to the copy, or NULL with a Python exception set
+   */
+  static PyObject *toPython(JSContext *cx, JS::HandleValue value);
+
+  /**
+   * @brief Copy a Python object into plain JS values: objects for dicts, arrays for lists and tuples, strings, numbers, ...
+   *
+   * @param cx - javascript context pointer
+   * @param object - the Python object to copy
+   * @param rval - set to the copy
+   * @return true - the object was copied
+   * @return false - a Python exception was set
+   */
+  static bool toJS(JSContext *cx, PyObject *object, JS::MutableHandleValue rval);
+};
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * @file DeepEqual.hh
+ * @author agent (agent@local)
+ * @brief Structural equality of JS values and Python objects, walked natively instead of through proxies
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_DeepEqual_
+#define PythonMonkey_DeepEqual_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct is a bundle of methods that compare a JS value with a Python object as `==` would compare the Python value of the JS one.
+ *
+ * Arrays are compared with lists and plain objects with dicts by reading their elements and properties directly,
+ * without creating a JSArrayProxy or JSObjectProxy for each nested value, and JS strings and numbers are compared in place.
+ * When the Python side is itself a proxy of a JS value, the two JS values are compared, identical objects being equal without a walk.
+ * Each (JS object, Python object or JS object) pair is compared once, so cycles terminate and shared subgraphs aren't walked again.
+ * The other values (functions, Dates, Maps, class instances of Python, ...) are converted and compared by Python.
+ */
+struct DeepEqual {
+public:
+  /**
+   * @brief Whether a JS value equals a Python object
+   *
+   * @param cx - javascript context pointer
+   * @param value - the JS value
+   * @param object - the Python object
+   * @return int - 1 if they are equal, 0 if not, -1 with a Python exception set
+   */
+  static int equals(JSContext *cx, JS::HandleValue value, PyObject *object);
+};
+
+#endif
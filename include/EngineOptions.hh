@@ -0,0 +1,69 @@
+/**
+ * @file EngineOptions.hh
+ * @author agent (agent@local)
+ * @brief The JIT tiers and thresholds of Spidermonkey, set from the environment at import time or by pythonmonkey.setEngineOptions
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_EngineOptions_
+#define PythonMonkey_EngineOptions_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct exposes the JIT compiler options of the engine by name.
+ *
+ * The flags enable the tiers: baselineInterpreter, baseline, ion (the Warp optimizing compiler), offThreadCompilation,
+ * nativeRegExp, wasmBaseline and wasmOptimizing. The thresholds are the warm-up counts after which a function moves
+ * up a tier, e.g. a baselineWarmUpThreshold of 0 compiles every function with the baseline compiler on its first call;
+ * setting a threshold to -1 restores its default. They apply to the whole process, already compiled code is recompiled lazily.
+ *
+ * At import time, the options are read from the PYTHONMONKEY_ENGINE_OPTIONS environment variable,
+ * a comma-separated list like `ion=false,baselineWarmUpThreshold=0`.
+ *
+ * The perfMap option makes the JITs describe the code they generate to `perf` (a jitdump file in PERF_SPEW_DIR, /tmp by default,
+ * read by `perf inject --jit`), so that profilers attribute the samples of JIT code to JS functions. SpiderMonkey reads it once
+ * when it is initialized, so it can only be turned on from the environment, with `perfMap=true` or its own IONPERF variable.
+ */
+struct EngineOptions {
+public:
+  /**
+   * @brief Apply the options of the PYTHONMONKEY_ENGINE_OPTIONS environment variable that must be set before the engine is initialized,
+   * must be called before JS_Init
+   */
+  static void initProcess();
+
+  /**
+   * @brief Apply the options of the PYTHONMONKEY_ENGINE_OPTIONS environment variable
+   *
+   * @param cx - javascript context pointer
+   * @return true - the options were applied
+   * @return false - the variable is malformed or names an unknown option, a Python exception was set
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Set options from a Python dict, all or none of them
+   *
+   * @param cx - javascript context pointer
+   * @param options - option name -> bool or int
+   * @return true - the options were set
+   * @return false - a Python exception was set
+   */
+  static bool set(JSContext *cx, PyObject *options);
+
+  /**
+   * @brief Get the current options
+   *
+   * @param cx - javascript context pointer
+   * @return PyObject* - a new dict, option name -> bool or int, or NULL with a Python exception set
+   */
+  static PyObject *toPython(JSContext *cx);
+};
+
+#endif
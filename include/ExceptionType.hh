@@ -12,6 +12,7 @@
 #define PythonMonkey_ExceptionType_
 
 #include <jsapi.h>
+#include <js/Exception.h>
 
 #include <Python.h>
 
@@ -20,6 +21,25 @@
  */
 struct ExceptionType {
 public:
+  /**
+   * @brief Create the pythonmonkey.SpiderMonkeyError exception class.
+   * Its instances wrapping a JS exception only format their message on first use of `str()`, `repr()`, `args` or pickling, and create their `jsError` proxy on first access.
+   *
+   * @returns PyObject* - a new reference to the class, or NULL with a Python exception set
+   */
+  static PyObject *newSpiderMonkeyErrorType();
+
+  /**
+   * @brief Construct a new SpiderMonkeyError wrapping a JS exception, without formatting its message yet
+   *
+   * @param cx - javascript context pointer
+   * @param exceptionStack - the JS exception and the stack it was thrown from, if any
+   * @param thrown - whether the exception was thrown, its JS stack is then only printed if it is not already part of its message
+   *
+   * @returns PyObject* - a new reference to the SpiderMonkeyError, or NULL with a Python exception set
+   */
+  static PyObject *newSpiderMonkeyError(JSContext *cx, const JS::ExceptionStack &exceptionStack, bool thrown);
+
   /**
    * @brief Construct a new SpiderMonkeyError from the JS Error object.
    *
@@ -36,8 +56,20 @@ public:
    * @param cx - javascript context pointer
    * @param exceptionValue - Exception object pointer, cannot be NULL
    * @param traceBack - Exception traceback pointer, can be NULL
+   *
+   * Only the JS stack frames are captured, the Python exception and traceback are formatted the first time the Error's `message` is read.
    */
   static JSObject *toJsError(JSContext *cx, PyObject *exceptionValue, PyObject *traceBack);
+
+  /**
+   * @brief Check whether a JS Error was converted by toJsError, its error report then has no message
+   *
+   * @param cx - javascript context pointer
+   * @param error - the JS object
+   * @return true - the object's `message` is formatted from a Python exception on demand
+   * @return false - otherwise
+   */
+  static bool hasLazyMessage(JSContext *cx, JS::HandleObject error);
 };
 
 #endif
\ No newline at end of file
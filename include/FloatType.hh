@@ -11,6 +11,8 @@
 #ifndef PythonMonkey_FloatType_
 #define PythonMonkey_FloatType_
 
+#include <jsapi.h>
+
 #include <Python.h>
 
 /**
@@ -18,7 +20,27 @@
  */
 struct FloatType {
 public:
+  static constexpr double MAX_SAFE_INTEGER = 9007199254740991.0; // 2^53 - 1, Number.MAX_SAFE_INTEGER
+
   static PyObject *getPyObject(double n);
+
+  /**
+   * @brief Convert a JS number to a Python float, or to an int according to `int32AsInt` and `integralAsInt`
+   *
+   * @param number - the JS number value
+   * @return PyObject* a new reference to the float or int
+   */
+  static PyObject *getPyObject(const JS::Value &number);
+
+  /**
+   * @brief If true, JS numbers stored as int32 are converted to Python ints (using CPython's small int cache) instead of floats
+   */
+  static bool int32AsInt;
+
+  /**
+   * @brief If true, any integral JS number within the safe integer range is converted to a Python int, except -0
+   */
+  static bool integralAsInt;
 };
 
 #endif
\ No newline at end of file
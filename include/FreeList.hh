@@ -0,0 +1,63 @@
+/**
+ * @file FreeList.hh
+ * @author agent (agent@local)
+ * @brief Free lists of the deallocated proxy objects, reused by the next proxies of the same type
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_FreeList_
+#define PythonMonkey_FreeList_
+
+#include <Python.h>
+
+#include <cstddef>
+
+/**
+ * @brief A bounded stack of the memory of deallocated proxies of one exact type, like the free lists CPython keeps for its own
+ * floats, tuples and dicts. `pop` re-initializes the object header only: the caller sets all the fields of the proxy, and
+ * tracks a GC type again, as it was untracked before `push`.
+ *
+ * Disabled in the free-threaded builds, where proxies may be allocated and deallocated on other threads than the owner of the JS context.
+ */
+class FreeList {
+public:
+  /**
+   * @brief Keep the memory of a deallocated object
+   *
+   * @return true - the object was kept
+   * @return false - the list is full, the caller frees the object
+   */
+  inline bool push(PyObject *op) {
+  #ifdef Py_GIL_DISABLED
+    return false;
+  #else
+    if (count == CAPACITY) {
+      return false;
+    }
+    items[count++] = op;
+    return true;
+  #endif
+  }
+
+  /**
+   * @brief Get the memory of a deallocated object of the type, as a new reference
+   *
+   * @return PyObject* - the object, or nullptr if the list is empty
+   */
+  inline PyObject *pop(PyTypeObject *type) {
+    if (count == 0) {
+      return nullptr;
+    }
+    return PyObject_Init(items[--count], type);
+  }
+
+private:
+  static const size_t CAPACITY = 256;
+  PyObject *items[CAPACITY];
+  size_t count = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file GILSwitch.hh
+ * @author agent (agent@local)
+ * @brief Hand the GIL over to the other Python threads at regular intervals while JS code runs
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_GILSwitch_
+#define PythonMonkey_GILSwitch_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct lets the other Python threads run while PythonMonkey executes JS code, like the CPython interpreter loop does between bytecodes.
+ *
+ * The GIL is never released for the whole JS execution: every path from JS back into Python (Python functions, proxy traps, finalizers, ...) would have to re-acquire it.
+ * Instead a ticker thread requests a JS interrupt every `sys.getswitchinterval()` seconds while JS runs,
+ * and the interrupt callback, which SpiderMonkey only calls between JS operations, releases the GIL and takes it back.
+ */
+struct GILSwitch {
+public:
+  /**
+   * @brief Whether the GIL is handed over while JS runs (true), or held for the whole execution (false, default)
+   */
+  static bool enabled;
+
+  /**
+   * @brief Register the interrupt callback, must be called once the JS context has been created
+   *
+   * @param cx - javascript context pointer
+   * @return true - the callback was registered
+   * @return false - out of memory
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Enable or disable handing the GIL over, called by `pythonmonkey.setReleaseGIL`
+   *
+   * @param enable - whether to hand the GIL over
+   * @return true - the setting was changed
+   * @return false - a Python exception was set
+   */
+  static bool setEnabled(bool enable);
+
+  /**
+   * @brief Whether JS is running on a thread other than the current one, which handed the GIL over or released it in Python code called from JS.
+   * The JS context must not be used meanwhile, must be called while holding the GIL.
+   */
+  static bool runningOnAnotherThread();
+
+  /**
+   * @brief RAII guard around the Python -> JS entry points that run JS code: `eval`, calls of JS functions, promise jobs.
+   * While a guard exists, the GIL is handed over at regular intervals if `enabled`.
+   * When the outermost guard goes away, whether or not `enabled`, the buffered console output is flushed.
+   */
+  class AutoHandOver {
+  public:
+    AutoHandOver();
+    ~AutoHandOver();
+
+    /**
+     * @return true - JS can run
+     * @return false - a Python RuntimeError was set, JS is already running on another thread that handed the GIL over,
+     *    or, without the GIL, the current thread does not own the JS context (see ContextOwner)
+     */
+    inline bool entered() const {
+      return _entered;
+    }
+  private:
+    bool _entered;
+  };
+};
+
+#endif
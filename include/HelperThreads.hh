@@ -0,0 +1,45 @@
+/**
+ * @file HelperThreads.hh
+ * @author agent (agent@local)
+ * @brief The threads running the off-thread tasks of SpiderMonkey (background GC, JIT and Wasm compilation, ...)
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_HelperThreads_
+#define PythonMonkey_HelperThreads_
+
+#include <Python.h>
+
+/**
+ * @brief This struct runs the helper tasks of SpiderMonkey on threads of our own instead of its internal thread pool,
+ * so that they can be stopped before a `fork()` and started again in both processes after it: a child process only has the
+ * thread that forked, a task left half-done by another thread would never finish, and the internal pool can't be restarted.
+ */
+struct HelperThreads {
+public:
+  /**
+   * @brief Hand the helper tasks over to our threads, must be called after JS_Init and before the first JS context is created
+   *
+   * @return true - the threads were started
+   * @return false - a Python exception was set
+   */
+  static bool init();
+
+  /**
+   * @brief Run the pending tasks to completion and stop the threads, no task is left running afterwards
+   */
+  static void quiesce();
+
+  /**
+   * @brief Start the threads again after `quiesce`, the tasks dispatched meanwhile are then run
+   *
+   * @return true - the threads were started
+   * @return false - a Python exception was set
+   */
+  static bool restart();
+};
+
+#endif
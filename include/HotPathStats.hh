@@ -0,0 +1,188 @@
+/**
+ * @file HotPathStats.hh
+ * @author agent (agent@local)
+ * @brief Per-thread counters, and cycle timers in the Profile and DRelease builds, of the conversions and of the proxy traps and methods
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_HotPathStats_
+#define PythonMonkey_HotPathStats_
+
+#include <Python.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PYTHONMONKEY_HOT_PATH_TSC 1
+#else
+#include <chrono>
+#endif
+#endif
+
+/**
+ * @brief The hot paths, as X(group, name): the branches of jsTypeFactory (`toJS`) and pyTypeFactory (`toPython`),
+ * the traps of the proxies of the Python objects in JS, and the methods of the proxies of the JS objects in Python
+ */
+#define PYTHONMONKEY_HOT_PATHS(X) \
+  X(toJS, bool) X(toJS, int) X(toJS, bigint) X(toJS, float) X(toJS, JSStringProxy) \
+  X(toJS, strLatin1) X(toJS, strUCS2) X(toJS, strUCS4) X(toJS, function) X(toJS, exception) X(toJS, datetime) \
+  X(toJS, buffer) X(toJS, JSObjectProxy) X(toJS, JSMethodProxy) X(toJS, JSFunctionProxy) X(toJS, JSArrayProxy) \
+  X(toJS, JSMapProxy) X(toJS, JSSetProxy) X(toJS, map) \
+  X(toJS, cachedProxy) X(toJS, dict) X(toJS, list) X(toJS, None) X(toJS, null) X(toJS, awaitable) X(toJS, iterator) \
+  X(toJS, asyncIterable) X(toJS, object) \
+  X(toPython, undefined) X(toPython, null) X(toPython, boolean) X(toPython, number) X(toPython, string) \
+  X(toPython, symbol) X(toPython, bigint) X(toPython, pythonProxy) X(toPython, boxed) X(toPython, Date) \
+  X(toPython, Promise) X(toPython, Error) X(toPython, pythonFunction) X(toPython, function) X(toPython, Array) \
+  X(toPython, Map) X(toPython, Set) \
+  X(toPython, buffer) X(toPython, wasmMemory) X(toPython, iterable) X(toPython, object) \
+  X(PyDictProxyHandler, ownPropertyKeys) X(PyDictProxyHandler, delete) X(PyDictProxyHandler, has) \
+  X(PyDictProxyHandler, getOwnPropertyDescriptor) X(PyDictProxyHandler, set) X(PyDictProxyHandler, enumerate) \
+  X(PyDictProxyHandler, hasOwn) X(PyDictProxyHandler, getOwnEnumerablePropertyKeys) X(PyDictProxyHandler, defineProperty) \
+  X(PyListProxyHandler, getOwnPropertyDescriptor) X(PyListProxyHandler, methodLookup) X(PyListProxyHandler, defineProperty) \
+  X(PyListProxyHandler, ownPropertyKeys) X(PyListProxyHandler, delete) \
+  X(PyObjectProxyHandler, ownPropertyKeys) X(PyObjectProxyHandler, delete) X(PyObjectProxyHandler, has) \
+  X(PyObjectProxyHandler, getOwnPropertyDescriptor) X(PyObjectProxyHandler, set) X(PyObjectProxyHandler, enumerate) \
+  X(PyObjectProxyHandler, hasOwn) X(PyObjectProxyHandler, getOwnEnumerablePropertyKeys) X(PyObjectProxyHandler, defineProperty) \
+  X(JSObjectProxy, length) X(JSObjectProxy, get) X(JSObjectProxy, getSubscript) X(JSObjectProxy, contains) \
+  X(JSObjectProxy, assign) X(JSObjectProxy, richcompare) X(JSObjectProxy, iter) X(JSObjectProxy, repr) \
+  X(JSObjectProxy, getMethod) X(JSObjectProxy, setdefault) X(JSObjectProxy, pop) X(JSObjectProxy, update) \
+  X(JSObjectProxy, keys) X(JSObjectProxy, values) X(JSObjectProxy, items) X(JSObjectProxy, getMany) X(JSObjectProxy, setMany) \
+  X(JSArrayProxy, length) X(JSArrayProxy, get) X(JSArrayProxy, getSubscript) X(JSArrayProxy, assignKey) \
+  X(JSArrayProxy, richcompare) X(JSArrayProxy, iter) X(JSArrayProxy, reversed) X(JSArrayProxy, repr) \
+  X(JSArrayProxy, concat) X(JSArrayProxy, contains) X(JSArrayProxy, append) X(JSArrayProxy, insert) \
+  X(JSArrayProxy, extend) X(JSArrayProxy, pop) X(JSArrayProxy, remove) X(JSArrayProxy, index) X(JSArrayProxy, count) \
+  X(JSArrayProxy, sort) \
+  X(JSONStringify, fast) X(JSONStringify, fallback)
+
+/**
+ * @brief This struct counts how many times each hot path of the bridge runs, for `pythonmonkey.stats()["hotPaths"]`.
+ *
+ * Each thread counts in its own block, with relaxed atomic loads and stores rather than read-modify-write operations, so
+ * a count costs a thread-local load and an increment. The blocks of the threads that exited are kept, so the totals include them.
+ * In the builds compiled with PYTHONMONKEY_HOT_PATH_TIMERS (the Profile and DRelease builds), each hot path also accumulates the
+ * time spent in it, including the nested hot paths, in TSC cycles on x86 and in nanoseconds elsewhere.
+ */
+struct HotPathStats {
+public:
+  enum Counter {
+#define PYTHONMONKEY_HOT_PATH_ENUM(group, name) group##_##name,
+    PYTHONMONKEY_HOT_PATHS(PYTHONMONKEY_HOT_PATH_ENUM)
+#undef PYTHONMONKEY_HOT_PATH_ENUM
+    COUNTERS
+  };
+
+  struct Block {
+  public:
+    std::atomic<uint64_t> counts[COUNTERS] = {};
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+    std::atomic<uint64_t> ticks[COUNTERS] = {};
+#endif
+    Block *next = nullptr; /**< the block of the thread that counted before this one */
+  };
+
+  /**
+   * @return Block* - the block of the current thread, allocated on its first count
+   */
+  static inline Block *block() {
+    Block *current = threadBlock;
+    return current ? current : attachThread();
+  }
+
+  /**
+   * @brief Count a run of a hot path
+   */
+  static inline void count(Counter counter) {
+    std::atomic<uint64_t> &value = block()->counts[counter];
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+  /**
+   * @return uint64_t - the current time, in the unit of the timers
+   */
+  static inline uint64_t ticks() {
+#ifdef PYTHONMONKEY_HOT_PATH_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  /**
+   * @brief Add the time spent in a hot path
+   */
+  static inline void addTicks(Counter counter, uint64_t elapsed) {
+    std::atomic<uint64_t> &value = block()->ticks[counter];
+    value.store(value.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+  }
+#endif
+
+  /**
+   * @brief Sum up the blocks of all the threads as a Python dict of groups, `{"toJS": {"str": count, ...}, ...}`,
+   * with a `time` dict of the same shape and its `timeUnit` in the builds with timers
+   *
+   * @return PyObject* - a new reference to the dict, or NULL with a Python exception set
+   */
+  static PyObject *toPython();
+
+  /**
+   * @brief Zero the counters of all the threads; a count running on another thread at the same time may be kept
+   */
+  static void reset();
+
+private:
+  static Block *attachThread();
+
+  static inline thread_local Block *threadBlock = nullptr;
+};
+
+/**
+ * @brief RAII count of a run of a hot path, which also times it in the builds with timers
+ */
+class HotPathScope {
+public:
+  explicit HotPathScope(HotPathStats::Counter counter) {
+    HotPathStats::count(counter);
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+    this->counter = counter;
+    start = HotPathStats::ticks();
+#endif
+  }
+
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+  ~HotPathScope() {
+    HotPathStats::addTicks(counter, HotPathStats::ticks() - start);
+  }
+#endif
+
+  HotPathScope(const HotPathScope &) = delete;
+  HotPathScope &operator=(const HotPathScope &) = delete;
+
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+private:
+  HotPathStats::Counter counter;
+  uint64_t start;
+#endif
+};
+
+/**
+ * @brief Count the current scope as a run of a hot path, e.g. `PYTHONMONKEY_HOT_PATH(toJS, float);`, compiled out with -DPYTHONMONKEY_NO_HOT_PATH_STATS
+ */
+#ifdef PYTHONMONKEY_NO_HOT_PATH_STATS
+#define PYTHONMONKEY_HOT_PATH(group, name) ((void)0)
+#else
+#define PYTHONMONKEY_HOT_PATH(group, name) HotPathScope hotPathScope(HotPathStats::group##_##name)
+#endif
+
+#endif
@@ -14,6 +14,7 @@
 
 
 #include <jsapi.h>
+#include <js/GCVector.h>
 
 #include <Python.h>
 
@@ -32,6 +33,8 @@ typedef struct {
  */
 typedef struct {
   PyListIterObject it;
+  JS::PersistentRootedValueVector *block; /* elements prefetched by forward iteration, nullptr when iterating in reverse */
+  Py_ssize_t blockStart; /* index of block[0] in the array */
 } JSArrayIterProxy;
 
 /**
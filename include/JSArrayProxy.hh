@@ -14,9 +14,12 @@
 
 
 #include <jsapi.h>
+#include <js/GCVector.h>
 
 #include <Python.h>
 
+#define JS_ARRAY_ELEMENTS_BLOCK_SIZE 64 // number of elements read per JSAPI call when walking a JS array
+
 
 /**
  * @brief The typedef for the backing store that will be used by JSArrayProxy objects. All it contains is a pointer to the JSObject
@@ -40,6 +43,13 @@ public:
    */
   static void JSArrayProxy_dealloc(JSArrayProxy *self);
 
+  /**
+   * @brief Allocate a JSArrayProxy, reusing the memory of a deallocated one if there is any. Its JS array is left for the caller to set
+   *
+   * @return JSArrayProxy* - the new proxy, or NULL with an exception set
+   */
+  static JSArrayProxy *allocate();
+
   /**
    * @brief Length method (.mp_length and .sq_length), returns the number of keys in the JSObject, used by the python len() method
    *
@@ -238,6 +248,36 @@ public:
    */
   static PyObject *JSArrayProxy_count(JSArrayProxy *self, PyObject *value);
 
+  /**
+   * @brief to_list method, converts the whole JS array into a Python list in one native pass
+   *
+   * @param self - The JSArrayProxy
+   * @return PyObject* NULL on exception, a new list of the converted elements otherwise
+   */
+  static PyObject *JSArrayProxy_to_list(JSArrayProxy *self);
+
+  /**
+   * @brief to_buffer method, packs an array of numbers into a contiguous buffer, without creating a Python object per element
+   *
+   * @param self - The JSArrayProxy
+   * @param args - the optional struct format of the items: 'd' (float64, the default), 'f' (float32), 'i' (int32) or 'q' (int64)
+   * @param nargs - number of args
+   * @return PyObject* NULL on exception, a memoryview of the given format over a new bytearray otherwise
+   */
+  static PyObject *JSArrayProxy_to_buffer(JSArrayProxy *self, PyObject *const *args, Py_ssize_t nargs);
+
+  /**
+   * @brief Read a range of elements with a single JSAPI call (js::GetElementsWithAdder), which copies the elements of dense arrays directly
+   *
+   * @param self - The JSArrayProxy
+   * @param begin - index of the first element to read
+   * @param end - index one past the last element to read
+   * @param values - resized to end - begin and set to the elements
+   * @return true - the elements were read
+   * @return false - a Python exception was set
+   */
+  static bool JSArrayProxy_get_elements(JSArrayProxy *self, uint32_t begin, uint32_t end, JS::MutableHandleValueVector values);
+
   /**
    * @brief reverse method   Reverse list in place
    *
@@ -361,6 +401,18 @@ PyDoc_STRVAR(list_count__doc__,
   "\n"
   "Return number of occurrences of value.");
 
+PyDoc_STRVAR(list_to_list__doc__,
+  "to_list($self, /)\n"
+  "--\n"
+  "\n"
+  "Return a new list of all the elements, converted in one pass.");
+
+PyDoc_STRVAR(list_to_buffer__doc__,
+  "to_buffer($self, format='d', /)\n"
+  "--\n"
+  "\n"
+  "Return a memoryview of the numbers packed in the given format: 'd', 'f', 'i' or 'q'.");
+
 PyDoc_STRVAR(list_reverse__doc__,
   "reverse($self, /)\n"
   "--\n"
@@ -402,6 +454,8 @@ static PyMethodDef JSArrayProxy_methods[] = {
   {"remove", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_remove, METH_O, list_remove__doc__},
   {"index", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_index, METH_FASTCALL, list_index__doc__},
   {"count", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_count, METH_O, list_count__doc__},
+  {"to_list", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_to_list, METH_NOARGS, list_to_list__doc__},
+  {"to_buffer", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_to_buffer, METH_FASTCALL, list_to_buffer__doc__},
   {"reverse", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_reverse, METH_NOARGS, list_reverse__doc__},
   {"sort", (PyCFunction)JSArrayProxyMethodDefinitions::JSArrayProxy_sort, METH_VARARGS|METH_KEYWORDS, list_sort__doc__},
   {NULL, NULL}                       /* sentinel */
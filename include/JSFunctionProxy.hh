@@ -14,6 +14,13 @@
 #include <jsapi.h>
 
 #include <Python.h>
+#include "include/pyshim.hh"
+
+/**
+ * @brief Number of arguments a JSFunctionProxy or JSMethodProxy call can pass to JS without a heap allocation
+ */
+#define JS_FUNC_SMALL_ARGS_COUNT 8
+
 /**
  * @brief The typedef for the backing store that will be used by JSFunctionProxy objects. All it contains is a pointer to the JSFunction
  *
@@ -21,6 +28,9 @@
 typedef struct {
   PyObject_HEAD
   JS::PersistentRootedObject *jsFunc;
+  JS::PersistentRootedObject *jsThis; // the `this` of calls if the function was read from a JSObjectProxy, or nullptr to use `globalThis`
+  JS::PersistentRootedObject *jsBound; // the function bound to `jsThis` once it was passed back to JS, or nullptr
+  vectorcallfunc vectorcall;
 } JSFunctionProxy;
 
 /**
@@ -55,6 +65,48 @@ public:
    * @return PyObject* - Result of the function call
    */
   static PyObject *JSFunctionProxy_call(PyObject *self, PyObject *args, PyObject *kwargs);
+
+  /**
+   * @brief Vectorcall method (.tp_vectorcall_offset), called when the JSFunctionProxy is called without an args tuple
+   *
+   * @param self - this callable, might be a free function or a method
+   * @param args - positional args to the function, followed by the values of the keyword args
+   * @param nargsf - number of positional args, possibly or'ed with PY_VECTORCALL_ARGUMENTS_OFFSET
+   * @param kwnames - tuple of the names of the keyword args, or NULL
+   * @return PyObject* - Result of the function call
+   */
+  static PyObject *JSFunctionProxy_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf, PyObject *kwnames);
+
+  /**
+   * @brief Call a JS function with arguments in the vectorcall layout, shared by JSFunctionProxy and JSMethodProxy
+   *
+   * @param cx - javascript context pointer
+   * @param thisObj - the `this` of the call
+   * @param jsFunc - the JS function to call
+   * @param args - positional args to the function, followed by the values of the keyword args
+   * @param nargsf - number of positional args, possibly or'ed with PY_VECTORCALL_ARGUMENTS_OFFSET
+   * @param kwnames - tuple of the names of the keyword args, or NULL
+   * @return PyObject* - Result of the function call
+   */
+  static PyObject *callJSFunction(JSContext *cx, JS::HandleObject thisObj, JS::HandleValue jsFunc, PyObject *const *args, size_t nargsf, PyObject *kwnames);
+
+  /**
+   * @brief Call a JS function once per item of a Python iterable, with the item as its argument, for `pythonmonkey.callMany`.
+   * The items are converted `chunk` at a time into a rooted buffer kept across the chunks, then the calls of the chunk run back-to-back
+   * and their results are converted, so that the per-call setup of a JSFunctionProxy call is paid once
+   *
+   * @param cx - javascript context pointer
+   * @param func - the JSFunctionProxy or JSMethodProxy to call, or any other value converting to a JS function
+   * @param iterable - the arguments of the calls
+   * @param chunk - the number of items converted at a time
+   * @return PyObject* - the list of the results, or NULL with an exception set when the conversion of an item or a call fails
+   */
+  static PyObject *callMany(JSContext *cx, PyObject *func, PyObject *iterable, Py_ssize_t chunk);
+
+  /**
+   * @brief Whether keyword arguments are passed to JS as a trailing options object (true), or ignored (false, default)
+   */
+  static bool keywordArgumentsAsOptions;
 };
 
 /**
@@ -0,0 +1,140 @@
+/**
+ * @file JSIteratorProxy.hh
+ * @author agent (agent@local)
+ * @brief JSIteratorProxy is a custom C-implemented python type that derives from JSObjectProxy. It proxies the JS iterables, iterators and
+ * generators, and iterates them with the JS iteration protocol
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSIteratorProxy_
+#define PythonMonkey_JSIteratorProxy_
+
+#include "include/JSObjectProxy.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief The typedef for the backing store that will be used by JSIteratorProxy and JSIterableProxy objects. The JS object keeps the dict behaviour
+ * of a JSObjectProxy for its properties. A JSIteratorProxy, of a generator or a builtin iterator, is a Python iterator that steps the object itself,
+ * a JSIterableProxy, of an object with its own `[Symbol.iterator]` method, only hands out the JSIteratorProxy of the iterator it returns
+ *
+ */
+typedef struct {
+  JSObjectProxy object;
+  JS::PersistentRootedValue *next; // the `next` method of the JS iterator, looked up on the first step
+  bool async; // the JS object is an async iterable, iterated by `async for`
+} JSIteratorProxy;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSIteratorProxy type
+ *
+ */
+struct JSIteratorProxyMethodDefinitions {
+public:
+  /**
+   * @brief Deallocation method (.tp_dealloc), removes the reference to the `next` method before deallocating the JSObjectProxy
+   *
+   * @param self - The JSIteratorProxy to be free'd
+   */
+  static void JSIteratorProxy_dealloc(JSIteratorProxy *self);
+
+  /**
+   * @brief .tp_iter method, calls `[Symbol.iterator]()`
+   *
+   * @param self - The JSIteratorProxy
+   * @return PyObject* - self if the JS object is its own iterator, a new JSIteratorProxy of its iterator otherwise, or NULL with an exception set
+   */
+  static PyObject *JSIteratorProxy_iter(JSIteratorProxy *self);
+
+  /**
+   * @brief .tp_iternext method, calls `next()` and unpacks the iterator result without proxying it
+   *
+   * @param self - The JSIteratorProxy
+   * @return PyObject* - the next value, or NULL once done (without an exception set) or if the iteration threw
+   */
+  static PyObject *JSIteratorProxy_iternext(JSIteratorProxy *self);
+
+  /**
+   * @brief .am_aiter method, calls `[Symbol.asyncIterator]()`
+   *
+   * @param self - The JSIteratorProxy
+   * @return PyObject* - self if the JS object is its own async iterator, a new JSIteratorProxy of its async iterator otherwise, or NULL with an exception set
+   */
+  static PyObject *JSIteratorProxy_aiter(JSIteratorProxy *self);
+
+  /**
+   * @brief .am_anext method, calls `next()`
+   *
+   * @param self - The JSIteratorProxy
+   * @return PyObject* - an awaitable of the next value, which raises StopAsyncIteration once done, or NULL with an exception set
+   */
+  static PyObject *JSIteratorProxy_anext(JSIteratorProxy *self);
+
+  /**
+   * @brief Whether a JS object is proxied as an iterator or an iterable: a generator or one of the builtin iterators (of Arrays, Maps, Sets,
+   * Strings, RegExp matches and the iterator helpers) by its class, or an ordinary object by its own `[Symbol.iterator]`
+   * or `[Symbol.asyncIterator]` data property holding a function. No getter, Proxy trap or other JS code runs, the inherited methods,
+   * e.g. of class instances, and the JS Proxies are not looked at: their objects stay plain JSObjectProxy dicts
+   *
+   * @param cx - javascript context pointer
+   * @param obj - the JS object
+   * @param iterable - set to whether it is an iterable or an iterator
+   * @param async - set to whether it is iterated by `async for`
+   * @param iterator - set to whether it is an iterator, stepped by `next()` itself
+   * @return bool - false with a JS exception pending if the own properties could not be looked up
+   */
+  static bool isIterable(JSContext *cx, JS::HandleObject obj, bool *iterable, bool *async, bool *iterator);
+
+  /**
+   * @brief Create a JSIteratorProxy or JSIterableProxy of a JS object, or get the proxy it already has, whatever its type
+   *
+   * @param cx - javascript context pointer
+   * @param obj - the JS iterable or iterator
+   * @param async - whether it is iterated by `async for`
+   * @param iterator - whether to create a JSIteratorProxy
+   * @return PyObject* - a new reference to the proxy, or NULL with an exception set
+   */
+  static PyObject *getPyObject(JSContext *cx, JS::HandleObject obj, bool async, bool iterator);
+
+  /**
+   * @brief Get a JSIteratorProxy of a JS iterator, a new one that is not cached if the object is already proxied by another type
+   *
+   * @param cx - javascript context pointer
+   * @param obj - the JS iterator
+   * @param async - whether it is iterated by `async for`
+   * @return PyObject* - a new reference to the JSIteratorProxy, or NULL with an exception set
+   */
+  static PyObject *getIteratorPyObject(JSContext *cx, JS::HandleObject obj, bool async);
+};
+
+/**
+ * @brief Struct for the async methods of the JSIteratorProxyType
+ */
+static PyAsyncMethods JSIteratorProxy_async_methods = {
+  .am_aiter = (unaryfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_aiter,
+  .am_anext = (unaryfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_anext
+};
+
+/**
+ * @brief Struct for the async methods of the JSIterableProxyType, which is not an async iterator itself
+ */
+static PyAsyncMethods JSIterableProxy_async_methods = {
+  .am_aiter = (unaryfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_aiter,
+};
+
+/**
+ * @brief Struct for the JSIterableProxyType, used by the JSIteratorProxy objects of the JS iterables that are not iterators
+ */
+extern PyTypeObject JSIterableProxyType;
+
+/**
+ * @brief Struct for the JSIteratorProxyType, used by all JSIteratorProxy objects of JS iterators, a subtype of JSIterableProxyType
+ */
+extern PyTypeObject JSIteratorProxyType;
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * @file JSMapProxy.hh
+ * @author agent (agent@local)
+ * @brief JSMapProxy is a custom C-implemented python type that proxies a JS Map as a Python mapping, its entries being looked up
+ * by `JS::MapGet`/`JS::MapHas` with the JS value of the Python key rather than by a property name
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSMapProxy_
+#define PythonMonkey_JSMapProxy_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief The typedef for the backing store that will be used by JSMapProxy objects. All it contains is a pointer to the JS Map
+ *
+ */
+typedef struct {
+  PyObject_HEAD
+  JS::PersistentRootedObject *jsMap;
+} JSMapProxy;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSMapProxy type
+ *
+ */
+struct JSMapProxyMethodDefinitions {
+public:
+  /**
+   * @brief Deallocation method (.tp_dealloc), removes the reference to the underlying JS Map before freeing the JSMapProxy
+   *
+   * @param self - The JSMapProxy to be free'd
+   */
+  static void JSMapProxy_dealloc(JSMapProxy *self);
+
+  /**
+   * @brief .tp_traverse method
+   *
+   * @param self - The JSMapProxy
+   * @param visit - The function to be applied on each element of the proxy
+   * @param arg - The argument to the visit function
+   * @return 0 on success
+   */
+  static int JSMapProxy_traverse(JSMapProxy *self, visitproc visit, void *arg);
+
+  /**
+   * @brief .tp_clear method
+   *
+   * @param self - The JSMapProxy
+   * @return 0 on success
+   */
+  static int JSMapProxy_clear(JSMapProxy *self);
+
+  /**
+   * @brief Length method (.mp_length), the `size` of the Map
+   *
+   * @param self - The JSMapProxy
+   * @return Py_ssize_t - The number of entries
+   */
+  static Py_ssize_t JSMapProxy_length(JSMapProxy *self);
+
+  /**
+   * @brief Getter method (.mp_subscript), returns the value of the entry of a key
+   *
+   * @param self - The JSMapProxy
+   * @param key - The key, converted to its JS value
+   * @return PyObject* - the value, or NULL with a KeyError set if the Map has no such entry
+   */
+  static PyObject *JSMapProxy_get(JSMapProxy *self, PyObject *key);
+
+  /**
+   * @brief Assign method (.mp_ass_subscript), sets or deletes the entry of a key
+   *
+   * @param self - The JSMapProxy
+   * @param key - The key, converted to its JS value
+   * @param value - The value to be set, or NULL to delete the entry
+   * @return int -1 on exception, 0 on success
+   */
+  static int JSMapProxy_assign(JSMapProxy *self, PyObject *key, PyObject *value);
+
+  /**
+   * @brief Test method (.sq_contains), `JS::MapHas`
+   *
+   * @param self - The JSMapProxy
+   * @param key - The key, converted to its JS value
+   * @return int 1 if the Map has an entry for the key, 0 if not, -1 on exception
+   */
+  static int JSMapProxy_contains(JSMapProxy *self, PyObject *key);
+
+  /**
+   * @brief Return an iterator object to make JSMapProxy iterable, iterating its keys in insertion order
+   *
+   * @param self - The JSMapProxy
+   * @return PyObject* - a JSIteratorProxy of the `keys()` of the Map
+   */
+  static PyObject *JSMapProxy_iter(JSMapProxy *self);
+
+  /**
+   * @brief Compute a string representation of the JSMapProxy, as a dict would
+   *
+   * @param self - The JSMapProxy
+   * @return the string representation (a PyUnicodeObject) on success, NULL on failure
+   */
+  static PyObject *JSMapProxy_repr(JSMapProxy *self);
+
+  /**
+   * @brief get method
+   *
+   * @param self - The JSMapProxy
+   * @param args - the key, and the default value returned if the Map has no such entry, None by default
+   * @return PyObject* - the value
+   */
+  static PyObject *JSMapProxy_get_method(JSMapProxy *self, PyObject *args);
+
+  /**
+   * @brief pop method
+   *
+   * @param self - The JSMapProxy
+   * @param args - the key, and the default value returned if the Map has no such entry, a KeyError is raised without it
+   * @return PyObject* - the value of the deleted entry
+   */
+  static PyObject *JSMapProxy_pop_method(JSMapProxy *self, PyObject *args);
+
+  /**
+   * @brief clear method, `JS::MapClear`
+   *
+   * @param self - The JSMapProxy
+   * @return None
+   */
+  static PyObject *JSMapProxy_clear_method(JSMapProxy *self);
+
+  /**
+   * @brief keys method
+   *
+   * @param self - The JSMapProxy
+   * @return PyObject* - a JSIteratorProxy of the JS iterator `map.keys()`
+   */
+  static PyObject *JSMapProxy_keys_method(JSMapProxy *self);
+
+  /**
+   * @brief values method
+   *
+   * @param self - The JSMapProxy
+   * @return PyObject* - a JSIteratorProxy of the JS iterator `map.values()`
+   */
+  static PyObject *JSMapProxy_values_method(JSMapProxy *self);
+
+  /**
+   * @brief items method
+   *
+   * @param self - The JSMapProxy
+   * @return PyObject* - a JSIteratorProxy of the JS iterator `map.entries()`, yielding `[key, value]` lists
+   */
+  static PyObject *JSMapProxy_items_method(JSMapProxy *self);
+
+  /**
+   * @brief Create a JSMapProxy of a JS Map, or get the one it already has
+   *
+   * @param cx - javascript context pointer
+   * @param map - the JS Map
+   * @return PyObject* - a new reference to the JSMapProxy, or NULL with an exception set
+   */
+  static PyObject *getPyObject(JSContext *cx, JS::HandleObject map);
+};
+
+/**
+ * @brief Struct for the methods that define the Mapping protocol
+ *
+ */
+static PyMappingMethods JSMapProxy_mapping_methods = {
+  .mp_length = (lenfunc)JSMapProxyMethodDefinitions::JSMapProxy_length,
+  .mp_subscript = (binaryfunc)JSMapProxyMethodDefinitions::JSMapProxy_get,
+  .mp_ass_subscript = (objobjargproc)JSMapProxyMethodDefinitions::JSMapProxy_assign
+};
+
+/**
+ * @brief Struct for the `in` operator
+ *
+ */
+static PySequenceMethods JSMapProxy_sequence_methods = {
+  .sq_contains = (objobjproc)JSMapProxyMethodDefinitions::JSMapProxy_contains
+};
+
+PyDoc_STRVAR(map_get__doc__,
+  "get($self, key, default=None, /)\n"
+  "--\n"
+  "\n"
+  "Return the value for key if key is in the Map, else default.");
+
+PyDoc_STRVAR(map_pop__doc__,
+  "pop($self, key, default=<unrepresentable>, /)\n"
+  "--\n"
+  "\n"
+  "Delete the entry of key and return its value.\n"
+  "\n"
+  "If the key is not found, return the default if given; otherwise, raise a KeyError.");
+
+PyDoc_STRVAR(map_clear__doc__,
+  "clear($self, /)\n"
+  "--\n"
+  "\n"
+  "Remove all entries from the Map.");
+
+PyDoc_STRVAR(map_keys__doc__,
+  "keys($self, /)\n"
+  "--\n"
+  "\n"
+  "Return an iterator of the keys of the Map, in insertion order.");
+
+PyDoc_STRVAR(map_values__doc__,
+  "values($self, /)\n"
+  "--\n"
+  "\n"
+  "Return an iterator of the values of the Map, in insertion order.");
+
+PyDoc_STRVAR(map_items__doc__,
+  "items($self, /)\n"
+  "--\n"
+  "\n"
+  "Return an iterator of the [key, value] entries of the Map, in insertion order.");
+
+/**
+ * @brief Struct for the other methods
+ *
+ */
+static PyMethodDef JSMapProxy_methods[] = {
+  {"get", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_get_method, METH_VARARGS, map_get__doc__},
+  {"pop", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_pop_method, METH_VARARGS, map_pop__doc__},
+  {"clear", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_clear_method, METH_NOARGS, map_clear__doc__},
+  {"keys", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_keys_method, METH_NOARGS, map_keys__doc__},
+  {"values", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_values_method, METH_NOARGS, map_values__doc__},
+  {"items", (PyCFunction)JSMapProxyMethodDefinitions::JSMapProxy_items_method, METH_NOARGS, map_items__doc__},
+  {NULL, NULL}                  /* sentinel */
+};
+
+/**
+ * @brief Struct for the JSMapProxyType, used by all JSMapProxy objects
+ */
+extern PyTypeObject JSMapProxyType;
+
+#endif
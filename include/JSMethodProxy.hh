@@ -24,6 +24,7 @@ typedef struct {
   PyObject_HEAD
   PyObject *self;
   JS::PersistentRootedObject *jsFunc;
+  vectorcallfunc vectorcall;
 } JSMethodProxy;
 
 /**
@@ -58,6 +59,17 @@ public:
    * @return PyObject* - Result of the method call
    */
   static PyObject *JSMethodProxy_call(PyObject *self, PyObject *args, PyObject *kwargs);
+
+  /**
+   * @brief Vectorcall method (.tp_vectorcall_offset), called when the JSMethodProxy is called without an args tuple, properly handling `self` and `this`
+   *
+   * @param self - the JSMethodProxy being called
+   * @param args - positional args to the method, followed by the values of the keyword args
+   * @param nargsf - number of positional args, possibly or'ed with PY_VECTORCALL_ARGUMENTS_OFFSET
+   * @param kwnames - tuple of the names of the keyword args, or NULL
+   * @return PyObject* - Result of the method call
+   */
+  static PyObject *JSMethodProxy_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf, PyObject *kwnames);
 };
 
 /**
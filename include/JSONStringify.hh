@@ -0,0 +1,57 @@
+/**
+ * @file JSONStringify.hh
+ * @author agent (agent@local)
+ * @brief The native encoder behind `JSON.stringify` of the proxies of Python dicts and lists
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSONStringify_
+#define PythonMonkey_JSONStringify_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct replaces `JSON.stringify` of the main global with a native function that serializes the proxy of a Python dict or list
+ * straight from the Python objects, instead of walking the proxy traps of SpiderMonkey, which convert every key to an id and every value to
+ * a new JS value. The output is the one of `JSON.stringify`: None and the functions are skipped in the objects and `null` in the arrays,
+ * NaN and the infinities are `null`, and the strings are escaped the same way, lone surrogates included.
+ *
+ * The original `JSON.stringify` does the work whenever the encoder can't give the same result: with a replacer, with a boxed Number or String
+ * as `space`, when a `toJSON` method may be called, or when the tree holds a value other than None, pm.null, bool, int, float, str, functions,
+ * or str-keyed dicts and lists, e.g. a JS object, a bigint or a cycle, which throws.
+ */
+struct JSONStringify {
+public:
+  /**
+   * @brief Install the native `JSON.stringify`, keeping the original one for the values the encoder does not handle
+   *
+   * @param cx - javascript context pointer
+   * @param global - the global object whose `JSON` is patched
+   * @return bool - false with a JS exception pending if `JSON.stringify` could not be replaced
+   */
+  static bool init(JSContext *cx, JS::HandleObject global);
+
+  /**
+   * @brief Serialize a Python dict or list like `JSON.stringify(value, undefined, space)` would serialize its proxy
+   *
+   * @param cx - javascript context pointer
+   * @param value - the dict or list
+   * @param space - the `space` argument of `JSON.stringify`
+   * @param rval - set to the JSON string
+   * @param handled - set to false if the value must be serialized by the original `JSON.stringify` instead
+   * @return bool - false with a JS exception pending on failure
+   */
+  static bool stringify(JSContext *cx, PyObject *value, JS::HandleValue space, JS::MutableHandleValue rval, bool *handled);
+
+  /**
+   * @brief Release the original `JSON.stringify`, must be called before the JS context is destroyed
+   */
+  static void finalize();
+};
+
+#endif
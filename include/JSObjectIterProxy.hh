@@ -94,6 +94,17 @@ public:
    * @return PyObject* - number of objects left to iterate over in iteration
    */
   static PyObject *JSObjectIterProxy_len(JSObjectIterProxy *self);
+
+  /**
+   * @brief Create an iterator over a JSObjectProxy. The own property keys are snapshotted once here,
+   * so each step of the iteration costs a single property lookup rather than a re-enumeration of the object
+   *
+   * @param dict - The JSObjectProxy to iterate over
+   * @param kind - KIND_KEYS, KIND_VALUES or KIND_ITEMS
+   * @param reversed - whether to iterate from the last key to the first
+   * @return PyObject* - the new JSObjectIterProxy, or NULL with an exception set
+   */
+  static PyObject *JSObjectIterProxy_new(PyDictObject *dict, int kind, bool reversed);
 };
 
 
@@ -15,9 +15,6 @@
 
 #include <Python.h>
 
-#include <unordered_map>
-
-
 /**
  * @brief The typedef for the backing store that will be used by JSObjectProxy objects. All it contains is a pointer to the JSObject
  *
@@ -40,6 +37,13 @@ public:
    */
   static void JSObjectProxy_dealloc(JSObjectProxy *self);
 
+  /**
+   * @brief Allocate a JSObjectProxy, reusing the memory of a deallocated one if there is any. Its JS object is left for the caller to set
+   *
+   * @return JSObjectProxy* - the new proxy, or NULL with an exception set
+   */
+  static JSObjectProxy *allocate();
+
   /**
    * @brief Length method (.mp_length), returns the number of key-value pairs in the JSObject, used by the python len() method
    *
@@ -91,21 +95,10 @@ public:
    * @param self - The JSObjectProxy
    * @param other - Any other PyObject
    * @param op - Which boolean operator is being performed (Py_EQ for equality, Py_NE for inequality, all other operators are not implemented)
-   * @return PyObject* - True or false depending on result of comparison
+   * @return PyObject* - True or false depending on result of comparison, see DeepEqual
    */
   static PyObject *JSObjectProxy_richcompare(JSObjectProxy *self, PyObject *other, int op);
 
-  /**
-   * @brief Helper function for JSObjectProxy_richcompare
-   *
-   * @param self - The PyObject on the left side of the operator (guaranteed to be a JSObjectProxy *)
-   * @param other - The PyObject on the right side of the operator
-   * @param visited
-   * @return bool - Whether the compared objects are equal or not
-   */
-  // private
-  static bool JSObjectProxy_richcompare_helper(JSObjectProxy *self, PyObject *other, std::unordered_map<PyObject *, PyObject *> &visited);
-
   /**
    * @brief Return an iterator object to make JSObjectProxy iterable, emitting (key, value) tuples
    *
@@ -204,6 +197,33 @@ public:
    */
   static PyObject *JSObjectProxy_update_method(JSObjectProxy *self, PyObject *args, PyObject *kwds);
 
+  /**
+   * @brief get_many method, reads many properties in one native loop, their ids being resolved before any of them is read
+   *
+   * @param self - The JSObjectProxy
+   * @param keys - An iterable of str or int keys
+   * @return PyObject* - a list of the values, None for the missing properties
+   */
+  static PyObject *JSObjectProxy_get_many_method(JSObjectProxy *self, PyObject *keys);
+
+  /**
+   * @brief set_many method, sets many properties in one native loop, their ids being resolved before any of them is set
+   *
+   * @param self - The JSObjectProxy
+   * @param mapping - A mapping, or an iterable of (key, value) pairs
+   * @return None
+   */
+  static PyObject *JSObjectProxy_set_many_method(JSObjectProxy *self, PyObject *mapping);
+
+  /**
+   * @brief update_fast method, the set_many of a dict, walked in place rather than through its items
+   *
+   * @param self - The JSObjectProxy
+   * @param dict - The dict whose items are set
+   * @return None
+   */
+  static PyObject *JSObjectProxy_update_fast_method(JSObjectProxy *self, PyObject *dict);
+
   /**
    * @brief keys method
    *
@@ -294,6 +314,17 @@ If E is present and has a .keys() method, then does:  for k in E: D[k] = E[k]\n\
 If E is present and lacks a .keys() method, then does:  for k, v in E: D[k] = v\n\
 In either case, this is followed by: for k in F:  D[k] = F[k]");
 
+PyDoc_STRVAR(get_many__doc__,
+  "D.get_many(keys) -> list of D[k] for k in keys, None for the missing keys.\n\
+The property ids are resolved in bulk and read in a single native loop");
+
+PyDoc_STRVAR(set_many__doc__,
+  "D.set_many(E) -> None.  Set D[k] = v for the items of the mapping or (k, v) pairs E.\n\
+The property ids are resolved in bulk, no property is set if one key is invalid");
+
+PyDoc_STRVAR(update_fast__doc__,
+  "D.update_fast(E) -> None.  D.set_many(E) for a dict E");
+
 PyDoc_STRVAR(dict_keys__doc__,
   "D.keys() -> a set-like object providing a view on D's keys");
 PyDoc_STRVAR(dict_items__doc__,
@@ -336,6 +367,9 @@ static PyMethodDef JSObjectProxy_methods[] = {
   {"clear", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_clear_method, METH_NOARGS, clear__doc__},
   {"copy", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_copy_method, METH_NOARGS, copy__doc__},
   {"update", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_update_method, METH_VARARGS | METH_KEYWORDS, update__doc__},
+  {"get_many", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_get_many_method, METH_O, get_many__doc__},
+  {"set_many", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_set_many_method, METH_O, set_many__doc__},
+  {"update_fast", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_update_fast_method, METH_O, update_fast__doc__},
   {"keys", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_keys_method, METH_NOARGS, dict_keys__doc__},
   {"items", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_items_method, METH_NOARGS, dict_items__doc__},
   {"values", (PyCFunction)JSObjectProxyMethodDefinitions::JSObjectProxy_values_method, METH_NOARGS, dict_values__doc__},
@@ -0,0 +1,99 @@
+/**
+ * @file JSScriptHandle.hh
+ * @author agent (agent@local)
+ * @brief JSScriptHandle is a custom C-implemented python type. It holds a script compiled once by pythonmonkey.compile, to be run many times.
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSScriptHandle_
+#define PythonMonkey_JSScriptHandle_
+
+#include <jsapi.h>
+#include <js/CompileOptions.h>
+
+#include <Python.h>
+
+/**
+ * @brief The typedef for the backing store that will be used by JSScriptHandle objects.
+ *
+ */
+typedef struct {
+  PyObject_HEAD
+  PyObject *code; /**< the source, kept to compile the variant that runs with bindings */
+  JS::OwningCompileOptions *options;
+  JS::PersistentRootedScript *script; /**< compiled for the global scope */
+  JS::PersistentRootedScript *scriptWithBindings; /**< compiled for a non-syntactic scope, on the first run with bindings */
+} JSScriptHandle;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSScriptHandle type.
+ *
+ * Unlike `eval`, the script is not compiled as run-once, so running it again only costs its execution.
+ */
+struct JSScriptHandleMethodDefinitions {
+public:
+  /**
+   * @brief Compile a script, the implementation of `pythonmonkey.compile`
+   *
+   * @param cx - javascript context pointer
+   * @param code - the UTF-8 source of the script, a Python str
+   * @param options - the compile options of the script, by then without run-once
+   * @return PyObject* - a new JSScriptHandle, or NULL with a Python exception set
+   */
+  static PyObject *compile(JSContext *cx, PyObject *code, const JS::ReadOnlyCompileOptions &options);
+
+  /**
+   * @brief Compile a script on a thread of its own, the implementation of `pythonmonkey.compileAsync`.
+   * The stencil is instantiated on the event-loop thread once it is compiled, through the dispatch queue of the JobQueue
+   *
+   * @param cx - javascript context pointer
+   * @param code - the UTF-8 source of the script, a Python str
+   * @param options - the compile options of the script, by then without run-once
+   * @return PyObject* - a new asyncio.Future of the running event-loop, resolved to the JSScriptHandle, or NULL with a Python exception set
+   */
+  static PyObject *compileAsync(JSContext *cx, PyObject *code, const JS::ReadOnlyCompileOptions &options);
+
+  /**
+   * @brief Deallocation method (.tp_dealloc), releases the compiled scripts
+   *
+   * @param self - The JSScriptHandle to be free'd
+   */
+  static void JSScriptHandle_dealloc(JSScriptHandle *self);
+
+  /**
+   * @brief Run the script, in the global scope or with a dict of bindings in front of it
+   *
+   * @param self - The JSScriptHandle
+   * @param args - optionally a dict of the names visible to the script
+   * @param kwds - keyword arguments, `bindings`
+   * @return PyObject* - the value of the last expression of the script, or NULL with a Python exception set
+   */
+  static PyObject *JSScriptHandle_run(JSScriptHandle *self, PyObject *args, PyObject *kwds);
+};
+
+PyDoc_STRVAR(script_run__doc__,
+  "run($self, /, bindings=None)\n"
+  "--\n"
+  "\n"
+  "Run the compiled script and return the value of its last expression.\n"
+  "With a dict of bindings, the script runs in a fresh lexical environment where the keys of the dict are\n"
+  "variables holding its values; its top-level let and const declarations are then local to that run.");
+
+/**
+ * @brief Struct for the methods of the JSScriptHandleType
+ *
+ */
+static PyMethodDef JSScriptHandle_methods[] = {
+  {"run", (PyCFunction)JSScriptHandleMethodDefinitions::JSScriptHandle_run, METH_VARARGS | METH_KEYWORDS, script_run__doc__},
+  {NULL, NULL}                  /* sentinel */
+};
+
+/**
+ * @brief Struct for the JSScriptHandleType, used by all JSScriptHandle objects
+ */
+extern PyTypeObject JSScriptHandleType;
+
+#endif
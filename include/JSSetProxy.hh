@@ -0,0 +1,189 @@
+/**
+ * @file JSSetProxy.hh
+ * @author agent (agent@local)
+ * @brief JSSetProxy is a custom C-implemented python type that proxies a JS Set as a Python set-like collection, its membership being
+ * tested by `JS::SetHas` with the JS value of the Python element
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSSetProxy_
+#define PythonMonkey_JSSetProxy_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief The typedef for the backing store that will be used by JSSetProxy objects. All it contains is a pointer to the JS Set
+ *
+ */
+typedef struct {
+  PyObject_HEAD
+  JS::PersistentRootedObject *jsSet;
+} JSSetProxy;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSSetProxy type
+ *
+ */
+struct JSSetProxyMethodDefinitions {
+public:
+  /**
+   * @brief Deallocation method (.tp_dealloc), removes the reference to the underlying JS Set before freeing the JSSetProxy
+   *
+   * @param self - The JSSetProxy to be free'd
+   */
+  static void JSSetProxy_dealloc(JSSetProxy *self);
+
+  /**
+   * @brief .tp_traverse method
+   *
+   * @param self - The JSSetProxy
+   * @param visit - The function to be applied on each element of the proxy
+   * @param arg - The argument to the visit function
+   * @return 0 on success
+   */
+  static int JSSetProxy_traverse(JSSetProxy *self, visitproc visit, void *arg);
+
+  /**
+   * @brief .tp_clear method
+   *
+   * @param self - The JSSetProxy
+   * @return 0 on success
+   */
+  static int JSSetProxy_clear(JSSetProxy *self);
+
+  /**
+   * @brief Length method (.sq_length), the `size` of the Set
+   *
+   * @param self - The JSSetProxy
+   * @return Py_ssize_t - The number of elements
+   */
+  static Py_ssize_t JSSetProxy_length(JSSetProxy *self);
+
+  /**
+   * @brief Test method (.sq_contains), `JS::SetHas`
+   *
+   * @param self - The JSSetProxy
+   * @param element - The element, converted to its JS value
+   * @return int 1 if the Set has the element, 0 if not, -1 on exception
+   */
+  static int JSSetProxy_contains(JSSetProxy *self, PyObject *element);
+
+  /**
+   * @brief Return an iterator object to make JSSetProxy iterable, iterating its elements in insertion order
+   *
+   * @param self - The JSSetProxy
+   * @return PyObject* - a JSIteratorProxy of the `values()` of the Set
+   */
+  static PyObject *JSSetProxy_iter(JSSetProxy *self);
+
+  /**
+   * @brief Compute a string representation of the JSSetProxy, as a set would
+   *
+   * @param self - The JSSetProxy
+   * @return the string representation (a PyUnicodeObject) on success, NULL on failure
+   */
+  static PyObject *JSSetProxy_repr(JSSetProxy *self);
+
+  /**
+   * @brief add method, `JS::SetAdd`
+   *
+   * @param self - The JSSetProxy
+   * @param element - The element to add
+   * @return None
+   */
+  static PyObject *JSSetProxy_add_method(JSSetProxy *self, PyObject *element);
+
+  /**
+   * @brief discard method, `JS::SetDelete`
+   *
+   * @param self - The JSSetProxy
+   * @param element - The element to remove if present
+   * @return None
+   */
+  static PyObject *JSSetProxy_discard_method(JSSetProxy *self, PyObject *element);
+
+  /**
+   * @brief remove method
+   *
+   * @param self - The JSSetProxy
+   * @param element - The element to remove, a KeyError is raised if the Set doesn't have it
+   * @return None
+   */
+  static PyObject *JSSetProxy_remove_method(JSSetProxy *self, PyObject *element);
+
+  /**
+   * @brief clear method, `JS::SetClear`
+   *
+   * @param self - The JSSetProxy
+   * @return None
+   */
+  static PyObject *JSSetProxy_clear_method(JSSetProxy *self);
+
+  /**
+   * @brief Create a JSSetProxy of a JS Set, or get the one it already has
+   *
+   * @param cx - javascript context pointer
+   * @param set - the JS Set
+   * @return PyObject* - a new reference to the JSSetProxy, or NULL with an exception set
+   */
+  static PyObject *getPyObject(JSContext *cx, JS::HandleObject set);
+};
+
+/**
+ * @brief Struct for the methods that define the Sequence protocol, only `len()` and `in`
+ *
+ */
+static PySequenceMethods JSSetProxy_sequence_methods = {
+  .sq_length = (lenfunc)JSSetProxyMethodDefinitions::JSSetProxy_length,
+  .sq_contains = (objobjproc)JSSetProxyMethodDefinitions::JSSetProxy_contains
+};
+
+PyDoc_STRVAR(set_add__doc__,
+  "add($self, element, /)\n"
+  "--\n"
+  "\n"
+  "Add an element to the Set.");
+
+PyDoc_STRVAR(set_discard__doc__,
+  "discard($self, element, /)\n"
+  "--\n"
+  "\n"
+  "Remove an element from the Set if it is a member.");
+
+PyDoc_STRVAR(set_remove__doc__,
+  "remove($self, element, /)\n"
+  "--\n"
+  "\n"
+  "Remove an element from the Set; it must be a member.\n"
+  "\n"
+  "If the element is not a member, raise a KeyError.");
+
+PyDoc_STRVAR(set_clear__doc__,
+  "clear($self, /)\n"
+  "--\n"
+  "\n"
+  "Remove all elements from the Set.");
+
+/**
+ * @brief Struct for the other methods
+ *
+ */
+static PyMethodDef JSSetProxy_methods[] = {
+  {"add", (PyCFunction)JSSetProxyMethodDefinitions::JSSetProxy_add_method, METH_O, set_add__doc__},
+  {"discard", (PyCFunction)JSSetProxyMethodDefinitions::JSSetProxy_discard_method, METH_O, set_discard__doc__},
+  {"remove", (PyCFunction)JSSetProxyMethodDefinitions::JSSetProxy_remove_method, METH_O, set_remove__doc__},
+  {"clear", (PyCFunction)JSSetProxyMethodDefinitions::JSSetProxy_clear_method, METH_NOARGS, set_clear__doc__},
+  {NULL, NULL}                  /* sentinel */
+};
+
+/**
+ * @brief Struct for the JSSetProxyType, used by all JSSetProxy objects
+ */
+extern PyTypeObject JSSetProxyType;
+
+#endif
@@ -12,6 +12,7 @@
 #define PythonMonkey_JSStringProxy_
 
 #include <jsapi.h>
+#include <js/HeapAPI.h>
 
 #include <Python.h>
 
@@ -27,6 +28,16 @@ typedef struct {
 } JSStringProxy;
 
 extern std::unordered_set<JSStringProxy *> jsStringProxies; // a collection of all JSStringProxy objects, used during a GCCallback to ensure they continue to point to the correct char buffer
+extern std::unordered_set<JSStringProxy *> nurseryJSStringProxies; // the subset of jsStringProxies whose JSString is nursery-allocated, the only ones a minor GC can move
+
+/**
+ * @brief Check if the JSString backing a JSStringProxy is allocated in the nursery, and so may be moved by a minor GC
+ *
+ * @param self - The JSStringProxy
+ */
+inline bool JSStringProxyIsInNursery(const JSStringProxy *self) {
+  return js::gc::IsInsideNursery(reinterpret_cast<const js::gc::Cell *>(self->jsString->toString()));
+}
 
 /**
  * @brief This struct is a bundle of methods used by the JSStringProxy type
@@ -41,6 +52,13 @@ public:
    */
   static void JSStringProxy_dealloc(JSStringProxy *self);
 
+  /**
+   * @brief Allocate a JSStringProxy, reusing the memory of a deallocated one if there is any. The caller sets all of its fields
+   *
+   * @return JSStringProxy* - the new proxy, or NULL with an exception set
+   */
+  static JSStringProxy *allocate();
+
   /**
    * @brief copy protocol method for both copy and deepcopy
    *
@@ -48,6 +66,14 @@ public:
    * @return a copy of the string
    */
   static PyObject *JSStringProxy_copy_method(JSStringProxy *self);
+
+  /**
+   * @brief String method (.tp_str), returns a well-formed str, joining surrogate pairs left in place by lazy normalization
+   *
+   * @param self - The JSStringProxy
+   * @return a new str object
+   */
+  static PyObject *JSStringProxy_str(JSStringProxy *self);
 };
 
 // docs for methods, copied from cpython
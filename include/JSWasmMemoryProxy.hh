@@ -0,0 +1,96 @@
+/**
+ * @file JSWasmMemoryProxy.hh
+ * @author agent (agent@local)
+ * @brief JSWasmMemoryProxy is a custom C-implemented python type that derives from JSObjectProxy. It proxies a `WebAssembly.Memory`,
+ * and exports the current memory of the Wasm instance as a writable Python buffer, across `memory.grow()`
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSWasmMemoryProxy_
+#define PythonMonkey_JSWasmMemoryProxy_
+
+#include "include/JSObjectProxy.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief The typedef for the backing store that will be used by JSWasmMemoryProxy objects. The properties and methods of the Memory
+ * (`grow`, `buffer`) are reached like those of a JSObjectProxy. Each buffer export looks the `buffer` of the Memory up again, so that
+ * a `memoryview(memory)` taken after a grow sees the grown memory, where a memoryview of an old `memory.buffer` would be detached
+ *
+ */
+typedef struct {
+  JSObjectProxy object;
+  JS::PersistentRootedObject *buffer; // the ArrayBuffer of the exports that are still alive, the Memory can't grow until they are released
+  Py_ssize_t exports;
+  Py_ssize_t pinnedBytes; // the byte length of `buffer` while it is pinned, 0 for shared memory
+} JSWasmMemoryProxy;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSWasmMemoryProxy type
+ *
+ */
+struct JSWasmMemoryProxyMethodDefinitions {
+public:
+  /**
+   * @brief Deallocation method (.tp_dealloc), no buffer is exported anymore as each export holds a reference to the proxy
+   *
+   * @param self - The JSWasmMemoryProxy to be free'd
+   */
+  static void JSWasmMemoryProxy_dealloc(JSWasmMemoryProxy *self);
+
+  /**
+   * @brief .bf_getbuffer method, exports the memory of the Wasm instance as a writable 1-dimensional buffer of bytes, without copying.
+   * The ArrayBuffer of a non-shared Memory is pinned while a buffer is exported, so `memory.grow()` throws a RangeError meanwhile instead of
+   * detaching it under Python. Shared memory grows in place and is never detached, it is not pinned
+   *
+   * @param self - The JSWasmMemoryProxy
+   * @param view - The buffer view to fill
+   * @param flags - The requested buffer flags
+   * @return int 0 on success, -1 with an exception set otherwise
+   */
+  static int JSWasmMemoryProxy_getbuffer(JSWasmMemoryProxy *self, Py_buffer *view, int flags);
+
+  /**
+   * @brief .bf_releasebuffer method, unpins the ArrayBuffer once the last export is released, so that the Memory can grow again
+   *
+   * @param self - The JSWasmMemoryProxy
+   * @param view - The released buffer view
+   */
+  static void JSWasmMemoryProxy_releasebuffer(JSWasmMemoryProxy *self, Py_buffer *view);
+
+  /**
+   * @returns Is the given JS object a `WebAssembly.Memory`?
+   */
+  static bool isWasmMemory(JSObject *obj);
+
+  /**
+   * @brief Get the proxy of a `WebAssembly.Memory`, the cached one if the Memory was already proxied
+   *
+   * @param cx - javascript context pointer
+   * @param obj - the `WebAssembly.Memory`
+   * @return PyObject* - the JSWasmMemoryProxy, or NULL with an exception set
+   */
+  static PyObject *getPyObject(JSContext *cx, JS::HandleObject obj);
+};
+
+/**
+ * @brief Struct for the buffer methods of the JSWasmMemoryProxyType
+ *
+ */
+static PyBufferProcs JSWasmMemoryProxy_buffer_methods = {
+  .bf_getbuffer = (getbufferproc)JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_getbuffer,
+  .bf_releasebuffer = (releasebufferproc)JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_releasebuffer
+};
+
+/**
+ * @brief Struct for the JSWasmMemoryProxyType, used by all JSWasmMemoryProxy objects
+ */
+extern PyTypeObject JSWasmMemoryProxyType;
+
+#endif
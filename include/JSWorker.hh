@@ -0,0 +1,121 @@
+/**
+ * @file JSWorker.hh
+ * @author agent (agent@local)
+ * @brief JSWorker is a custom C-implemented python type. It runs JS code in an isolated JS runtime on its own thread, exchanging structured clones with Python.
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_JSWorker_
+#define PythonMonkey_JSWorker_
+
+#include <Python.h>
+
+struct WorkerThread;
+
+/**
+ * @brief The typedef for the backing store that will be used by JSWorker objects. All it contains is a pointer to the native worker thread
+ *
+ */
+typedef struct {
+  PyObject_HEAD
+  WorkerThread *worker;
+} JSWorker;
+
+/**
+ * @brief This struct is a bundle of methods used by the JSWorker type.
+ *
+ * A worker has its own JSContext and runtime, so several workers run JS in parallel with each other and with Python,
+ * without the GIL. The code of a worker never sees Python objects: the values passed to `postMessage` on either side
+ * are deep-copied into a structured clone, like the `postMessage` of Web Workers.
+ */
+struct JSWorkerMethodDefinitions {
+public:
+  /**
+   * @brief New method (.tp_new), starts the worker thread and evaluates its code there
+   *
+   * @param type - The type of object to be created, will always be JSWorkerType or a derived type
+   * @param args - the JS code of the worker, and optionally its filename for stack traces
+   * @param kwds - keyword arguments, `code` and `filename`
+   * @return PyObject* - A new instance of JSWorker, or NULL with a Python exception set
+   */
+  static PyObject *JSWorker_new(PyTypeObject *type, PyObject *args, PyObject *kwds);
+
+  /**
+   * @brief Deallocation method (.tp_dealloc), terminates the worker and waits for its thread to exit
+   *
+   * @param self - The JSWorker to be free'd
+   */
+  static void JSWorker_dealloc(JSWorker *self);
+
+  /**
+   * @brief Send a message to the worker, received by its `onmessage(event)` handler as `event.data`
+   *
+   * @param self - The JSWorker
+   * @param value - the value to be copied to the worker
+   * @return PyObject* - None, or NULL with a Python exception set if the value cannot be cloned
+   */
+  static PyObject *JSWorker_postMessage(JSWorker *self, PyObject *value);
+
+  /**
+   * @brief Wait for a message posted by the worker, releasing the GIL while waiting
+   *
+   * @param self - The JSWorker
+   * @param args - an optional timeout in seconds
+   * @param kwds - keyword arguments, `timeout`
+   * @return PyObject* - a copy of the message, or NULL with a Python exception set:
+   *    a SpiderMonkeyError if the worker threw, a TimeoutError, or a RuntimeError if the worker has exited
+   */
+  static PyObject *JSWorker_getMessage(JSWorker *self, PyObject *args, PyObject *kwds);
+
+  /**
+   * @brief Stop the worker, interrupting the JS code it might be running, and wait for its thread to exit
+   *
+   * @param self - The JSWorker
+   * @return PyObject* - None
+   */
+  static PyObject *JSWorker_terminate(JSWorker *self, PyObject *Py_UNUSED(args));
+
+  /**
+   * @brief The number of worker threads that haven't exited yet
+   */
+  static size_t running();
+};
+
+PyDoc_STRVAR(worker_postMessage__doc__,
+  "postMessage($self, value, /)\n"
+  "--\n"
+  "\n"
+  "Send a deep copy of value to the worker's onmessage(event) handler, as event.data.");
+
+PyDoc_STRVAR(worker_getMessage__doc__,
+  "getMessage($self, /, timeout=None)\n"
+  "--\n"
+  "\n"
+  "Wait for the next message posted by the worker and return a deep copy of it, releasing the GIL while waiting.");
+
+PyDoc_STRVAR(worker_terminate__doc__,
+  "terminate($self, /)\n"
+  "--\n"
+  "\n"
+  "Stop the worker, interrupting its JS code, and wait for its thread to exit.");
+
+/**
+ * @brief Struct for the methods of the JSWorkerType
+ *
+ */
+static PyMethodDef JSWorker_methods[] = {
+  {"postMessage", (PyCFunction)JSWorkerMethodDefinitions::JSWorker_postMessage, METH_O, worker_postMessage__doc__},
+  {"getMessage", (PyCFunction)JSWorkerMethodDefinitions::JSWorker_getMessage, METH_VARARGS | METH_KEYWORDS, worker_getMessage__doc__},
+  {"terminate", (PyCFunction)JSWorkerMethodDefinitions::JSWorker_terminate, METH_NOARGS, worker_terminate__doc__},
+  {NULL, NULL}                  /* sentinel */
+};
+
+/**
+ * @brief Struct for the JSWorkerType, used by all JSWorker objects
+ */
+extern PyTypeObject JSWorkerType;
+
+#endif
@@ -16,6 +16,9 @@
 
 #include <Python.h>
 
+#include <cstdint>
+#include <vector>
+
 /**
  * @brief Implement the ECMAScript Job Queue:
  * https://www.ecma-international.org/ecma-262/9.0/index.html#sec-jobs-and-job-queues
@@ -91,6 +94,42 @@ bool empty() const override;
  */
 bool isDrainingStopped() const override;
 
+/**
+ * @brief Run the queued jobs, and the ones they enqueue, back-to-back until the queue is empty.
+ * Called by the single Python event-loop callback scheduled for all the jobs enqueued since the last drain.
+ *
+ * @param cx - javascript context pointer
+ * @param first - index of the first job to run, the jobs before it belong to an outer drain that is still running
+ * @return true - the queue was drained
+ * @return false - a job failed and a Python exception was set, the remaining jobs are left to another drain
+ */
+bool drain(JSContext *cx, size_t first = 0);
+
+/**
+ * @brief Call a JS function, then run the promise jobs it enqueued (and the ones they enqueue) in a tight loop,
+ * without a round-trip through the Python event-loop per job. Used by `pythonmonkey.runSync`.
+ *
+ * @param cx - javascript context pointer
+ * @param fn - the JS function to call with an undefined `this`
+ * @param args - the arguments of the call
+ * @param rval - set to the return value of the call
+ * @return true - the call returned and its jobs were drained
+ * @return false - the call or one of its jobs failed and a Python exception was set
+ */
+bool callSync(JSContext *cx, JS::HandleValue fn, const JS::HandleValueArray &args, JS::MutableHandleValue rval);
+
+/**
+ * @brief Hold the queue of the dispatchables sent by the helper threads across a `fork()`, so that no thread owns it when the process is copied
+ */
+static void prepareFork();
+
+/**
+ * @brief Release the queue held by `prepareFork`. The child has no dispatcher thread, a new one is started for the dispatchables still queued
+ *
+ * @param inChild - whether this is the child process
+ */
+static void afterFork(bool inChild);
+
 /**
  * @brief Appends a callback to the queue of FinalizationRegistry callbacks
  *
@@ -112,6 +151,14 @@ private:
 using FunctionVector = JS::GCVector<JSFunction *, 0, js::SystemAllocPolicy>;
 JS::PersistentRooted<FunctionVector> *finalizationRegistryCallbacks;
 
+using JobVector = JS::GCVector<JSObject *, 0, js::SystemAllocPolicy>;
+JS::PersistentRooted<JobVector> *jobs; /**< the promise jobs waiting to run, in FIFO order */
+std::vector<uint64_t> enqueuedAt; /**< when each job of `jobs` was enqueued, see `Metrics::jobWait` */
+PyObject *drainLoop = nullptr; /**< the Python event-loop on which a drain of `jobs` is pending, if any */
+bool draining = false;
+
+class SavedQueue;
+
 /**
  * @brief Capture this JobQueue's current job queue as a SavedJobQueue and return it,
  * leaving the JobQueue's job queue empty. Destroying the returned object
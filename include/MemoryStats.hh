@@ -0,0 +1,79 @@
+/**
+ * @file MemoryStats.hh
+ * @author agent (agent@local)
+ * @brief Accounting of the memory of the JS heap and of the memory held across the Python <-> JS bridge
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_MemoryStats_
+#define PythonMonkey_MemoryStats_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <cstdint>
+
+/**
+ * @brief This struct holds the gauges behind `pythonmonkey.memoryStats()`: the live proxies in both directions, and the memory one heap keeps alive for the other.
+ * They are updated when the proxies, external strings and shared buffers are created and finalized, so reading them is cheap;
+ * only the detailed report walks the JS heap.
+ */
+struct MemoryStats {
+public:
+  /**
+   * @brief Count a JS proxy of a Python object being created or finalized
+   *
+   * @param family - the family of its proxy handler
+   * @param delta - 1 when created, -1 when finalized
+   */
+  static void countPyProxy(const void *family, int64_t delta);
+
+  /**
+   * @brief Describe the memory accounting as a Python dict
+   *
+   * @param cx - javascript context pointer
+   * @param detailed - also measure the JS heap with JS::CollectRuntimeStats, which walks all of it
+   * @return PyObject* - a new reference to the dict, or NULL with a Python exception set
+   */
+  static PyObject *toPython(JSContext *cx, bool detailed);
+
+  /**
+   * @brief The `mozilla::MallocSizeOf` of the measurements, the usable size of a block of the system allocator
+   *
+   * @param ptr - the block, or nullptr
+   * @return size_t - its usable size in bytes
+   */
+  static size_t mallocSizeOf(const void *ptr);
+
+  // JS proxies of Python objects, by proxy handler
+  static inline int64_t pyDictProxies = 0;
+  static inline int64_t pyListProxies = 0;
+  static inline int64_t pyObjectProxies = 0;
+  static inline int64_t pyIterableProxies = 0;
+  static inline int64_t pyBytesProxies = 0;
+
+  // Python proxies of JS values, each holding a persistent root (JSStringProxy objects are counted by `jsStringProxies`)
+  static inline int64_t jsObjectProxies = 0;
+  static inline int64_t jsArrayProxies = 0;
+  static inline int64_t jsFunctionProxies = 0;
+  static inline int64_t jsMethodProxies = 0;
+
+  // Python str buffers shared with JS external strings
+  static inline int64_t externalStrings = 0;
+  static inline int64_t externalStringBytes = 0;
+
+  // Python buffers backing JS ArrayBuffers
+  static inline int64_t sharedPyBuffers = 0;
+  static inline int64_t sharedPyBufferBytes = 0;
+
+  // JS ArrayBuffers exported to Python as memoryviews, pinned so that they can't be detached or resized meanwhile
+  static inline int64_t exportedJSBuffers = 0;
+  static inline int64_t exportedJSBufferBytes = 0;
+  static inline int64_t pinnedJSBufferBytes = 0;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file Metrics.hh
+ * @author agent (agent@local)
+ * @brief Counters and latency histograms of the work going through the event-loop and job queue bridge
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Metrics_
+#define PythonMonkey_Metrics_
+
+#include <Python.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief This struct holds the always-on instrumentation behind `pythonmonkey.stats()` and `internalBinding("metrics")`.
+ * Recording is a few integer increments, and a clock read per job or timer, all on the thread holding the GIL,
+ * except for the dispatchables which are queued by SpiderMonkey helper threads.
+ */
+struct Metrics {
+public:
+  /**
+   * @brief A histogram of durations in power-of-two microsecond buckets: bucket `i` counts the durations below 2**i µs, the last one everything above
+   */
+  struct Histogram {
+  public:
+    static constexpr size_t BUCKETS = 24; // the last bucket starts at ~8.4s
+
+    /**
+     * @brief Record a duration
+     *
+     * @param nanoseconds - the duration
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief Describe the histogram as a Python dict: `count`, `totalUs`, `maxUs` and the `buckets` list
+     *
+     * @return PyObject* - a new reference to the dict, or NULL with a Python exception set
+     */
+    PyObject *toPython() const;
+
+    uint64_t buckets[BUCKETS] = {}; /**< number of durations in each bucket */
+    uint64_t count = 0; /**< number of durations recorded */
+    uint64_t totalNs = 0; /**< sum of the durations */
+    uint64_t maxNs = 0; /**< longest duration */
+  };
+
+  /**
+   * @return uint64_t - a monotonic timestamp in nanoseconds
+   */
+  static inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * @brief Describe all the metrics as a Python dict
+   *
+   * @return PyObject* - a new reference to the dict, or NULL with a Python exception set
+   */
+  static PyObject *toPython();
+
+  /**
+   * @brief Zero the counters and histograms, the gauges of work in flight are kept
+   */
+  static void reset();
+
+  // promise jobs (microtasks)
+  static inline uint64_t jobsEnqueued = 0;
+  static inline uint64_t jobsRun = 0;
+  static inline uint64_t drains = 0; /**< number of times the job queue was drained, i.e. event-loop callbacks or `runSync` calls */
+  static inline Histogram jobWait; /**< from enqueueing a job to running it */
+  static inline Histogram jobRun; /**< run duration of a job */
+
+  // timers
+  static inline uint64_t timersScheduled = 0;
+  static inline uint64_t timersFired = 0;
+  static inline uint64_t timersCancelled = 0;
+  static inline Histogram timerLateness; /**< how long after its deadline a timer fired */
+
+  // dispatchables, e.g. the results of off-thread WebAssembly compilation
+  static inline std::atomic<uint64_t> dispatchablesQueued = 0;
+  static inline uint64_t dispatchablesRun = 0;
+
+  // stencils of the scripts evaluated by `eval`, see StencilCache
+  static inline uint64_t stencilsCompiled = 0;
+  static inline uint64_t stencilMemoryHits = 0;
+  static inline uint64_t stencilDiskHits = 0;
+  static inline uint64_t stencilsStored = 0; /**< written to the on-disk store */
+
+  // Promise <-> Future bridges in flight
+  static inline int64_t promisesAwaitedByFutures = 0; /**< JS Promises converted to a Python asyncio.Future and not settled yet */
+  static inline int64_t awaitablesAwaitedByPromises = 0; /**< Python awaitables converted to a JS Promise and not done yet */
+};
+
+#endif
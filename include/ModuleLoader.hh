@@ -0,0 +1,106 @@
+/**
+ * @file ModuleLoader.hh
+ * @author agent (agent@local)
+ * @brief Native loading of ES modules, and the cached file system lookups of the module loaders
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_ModuleLoader_
+#define PythonMonkey_ModuleLoader_
+
+#include <jsapi.h>
+#include <js/CompileOptions.h>
+
+#include <string>
+
+/**
+ * @brief This struct loads ES modules from files: `import` declarations and `import()` expressions are resolved and compiled natively,
+ * through the stencil cache, from memory-mapped sources. Each file is instantiated once, later imports share its module record.
+ *
+ * It also implements the file system lookups of the CommonJS loader (`internalBinding("fs")`). The results of `stat` are cached for
+ * the paths inside `node_modules` directories, which are not expected to change while the process runs: resolving a bare module
+ * identifier probes many candidate paths in every parent directory, most of which do not exist. See RequireCache.
+ */
+struct ModuleLoader {
+public:
+  /**
+   * @brief Install the module hooks of the JS runtime
+   *
+   * @param cx - javascript context pointer
+   * @return true - the hooks were installed
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Drop the loaded modules and the caches, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Get the mode of a file, like `stat`
+   *
+   * @param path - the path of the file
+   * @return int - the st_mode of the file, or -1 if it does not exist
+   */
+  static int statMode(const std::string &path);
+
+  /**
+   * @brief Forget the cached results of `statMode` and the cached resolutions, e.g. after installing packages while the process runs
+   */
+  static void clearStatCache();
+
+  /**
+   * @brief Read a UTF-8 text file into a JS string
+   *
+   * @param cx - javascript context pointer
+   * @param path - the path of the file
+   * @return JSString* - the contents of the file, or nullptr with a JS exception pending
+   */
+  static JSString *readFile(JSContext *cx, const std::string &path);
+
+  /**
+   * @brief Read a text file into a JS string like Python's `open(path, "r", encoding=charset).read()`, decoding it from a charset
+   * and translating its "\r\n" and "\r" line endings to "\n"
+   *
+   * @param cx - javascript context pointer
+   * @param path - the path of the file
+   * @param charset - the name of a Python codec, or nullptr for UTF-8
+   * @return JSString* - the contents of the file, or nullptr with a JS exception pending
+   */
+  static JSString *readTextFile(JSContext *cx, const std::string &path, const char *charset);
+
+  /**
+   * @brief Compile an ES module that was not loaded from a file, e.g. by `pythonmonkey.eval` with the `module` option
+   *
+   * @param cx - javascript context pointer
+   * @param options - the compile options of the module, its filename is the base of its relative imports
+   * @param chars - the UTF-8 source of the module
+   * @param length - the length of the source in bytes
+   * @return JSObject* - the module record, or nullptr with a JS exception pending
+   */
+  static JSObject *compileModule(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length);
+
+  /**
+   * @brief Load the ES module of a file, or get the module record already loaded from it
+   *
+   * @param cx - javascript context pointer
+   * @param path - the path of the file, relative to the current directory or absolute
+   * @return JSObject* - the module record, or nullptr with a JS exception pending
+   */
+  static JSObject *loadModule(JSContext *cx, const std::string &path);
+
+  /**
+   * @brief Link and evaluate a module record and the modules it imports
+   *
+   * @param cx - javascript context pointer
+   * @param module - the module record
+   * @return JSObject* - the namespace object of the module, or nullptr with a JS exception pending.
+   *    A module that uses top-level await may still be running, the bindings of its namespace are then filled in by the event-loop
+   */
+  static JSObject *evaluateModule(JSContext *cx, JS::HandleObject module);
+};
+
+#endif
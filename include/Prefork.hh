@@ -0,0 +1,49 @@
+/**
+ * @file Prefork.hh
+ * @author agent (agent@local)
+ * @brief Make the JS runtime safe to fork, so that a warmed-up process can fork workers sharing its heaps copy-on-write
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Prefork_
+#define PythonMonkey_Prefork_
+
+#include "include/JobQueue.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct quiesces the threads of the runtime around `os.fork()`, and restarts them in both processes after it.
+ *
+ * Before the fork, an incremental GC in progress is finished and the SpiderMonkey helper threads are stopped once their tasks are done,
+ * and the queues shared with the watchdog and dispatcher threads are held, so that no other thread is in the middle of their work
+ * when the process is copied. After it, the parent resumes where it was, and the child starts new threads in place of the ones it doesn't have.
+ */
+struct Prefork {
+public:
+  /**
+   * @brief Register the fork handlers with `os.register_at_fork`, on the platforms that have `fork()`
+   *
+   * @return true - the handlers were registered, or the platform doesn't fork
+   * @return false - a Python exception was set
+   */
+  static bool init();
+
+  /**
+   * @brief Get the runtime ready to be the parent of forked workers, for `pythonmonkey.prefork`: run the pending promise jobs,
+   * compact the JS heap and freeze the Python objects, so that the children write to as few shared pages as possible
+   *
+   * @param cx - javascript context pointer
+   * @param jobQueue - the job queue of the context
+   * @return true - the runtime is ready to fork
+   * @return false - a Python exception was set, e.g. if Workers or the profiler are running, as their threads wouldn't be in the children
+   */
+  static bool prepare(JSContext *cx, JobQueue *jobQueue);
+};
+
+#endif
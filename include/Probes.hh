@@ -0,0 +1,29 @@
+/**
+ * @file Probes.hh
+ * @author agent (agent@local)
+ * @brief USDT probes of the transitions between Python and JS, for perf, bpftrace and the continuous profilers
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Probes_
+#define PythonMonkey_Probes_
+
+/**
+ * The probes are in the `pythonmonkey` provider, e.g. `bpftrace -e 'usdt:<path of pythonmonkey.so>:pythonmonkey:bridge__enter { @[str(arg0)] = count(); }'`.
+ * A probe is a single nop instruction until a tracer attaches to it. They are only compiled in where <sys/sdt.h> (systemtap-sdt-dev) is available,
+ * and can be left out with -DPYTHONMONKEY_NO_USDT.
+ *
+ *  - `bridge__enter(const char *label)` and `bridge__exit(const char *label)`: an entry point of the bridge was entered and left,
+ *    with the labels of ProfilerLabel, e.g. `callPyFunc` or `JSFunctionProxy_call`
+ */
+#if defined(__linux__) && !defined(PYTHONMONKEY_NO_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PYTHONMONKEY_PROBE1(name, arg) DTRACE_PROBE1(pythonmonkey, name, arg)
+#else
+#define PYTHONMONKEY_PROBE1(name, arg) ((void)(arg))
+#endif
+
+#endif
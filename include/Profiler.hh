@@ -0,0 +1,108 @@
+/**
+ * @file Profiler.hh
+ * @author agent (agent@local)
+ * @brief Sampling CPU profiler of the JS code and of the bridge between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Profiler_
+#define PythonMonkey_Profiler_
+
+#include "include/Probes.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct samples the stacks of the main JS context, in the `.cpuprofile` format of the Chrome DevTools (the one of `node --cpu-prof`),
+ * which the Firefox Profiler, speedscope and the DevTools load.
+ *
+ * The stacks come from the profiling stack of SpiderMonkey: the interpreted frames, the JIT frames found by JS::ProfilingFrameIterator,
+ * and the label frames that the bridge entry points push with ProfilerLabel (calls between Python and JS, the type factories and the proxy traps),
+ * merged by stack address. A sampler thread ticks at the sampling interval and requests an interrupt; the stack is recorded on the JS thread,
+ * by the interrupt callback, or by the next label frame pushed or popped if the thread is running Python code. The ticks that pass while no
+ * PythonMonkey frame is on the stack are recorded as `(program)`.
+ */
+struct Profiler {
+public:
+  /**
+   * @brief Whether the profiler is running, read by ProfilerLabel on every bridge entry point
+   */
+  static bool active;
+
+  /**
+   * @brief Start sampling the stacks of a JS context
+   *
+   * @param cx - javascript context pointer
+   * @param interval - the sampling interval in seconds
+   * @return true - the profiler was started
+   * @return false - a Python exception was set, the profiler is already running
+   */
+  static bool start(JSContext *cx, double interval);
+
+  /**
+   * @brief Stop sampling
+   *
+   * @return PyObject* - the profile as a JSON str, or NULL with a Python exception set if the profiler is not running
+   */
+  static PyObject *stop();
+
+  /**
+   * @brief Stop sampling and drop the profile, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Record the current stack for the ticks that passed since the last sample, on the JS thread
+   */
+  static void sample();
+
+  /**
+   * @brief Push a label frame on the profiling stack, called by ProfilerLabel
+   *
+   * @param label - the static name of the frame
+   * @param stackAddress - an address in the native stack frame of the caller, which orders the label among the JIT frames
+   * @return true - the frame was pushed
+   * @return false - not on the JS thread of the profiled context
+   */
+  static bool pushLabel(const char *label, void *stackAddress);
+
+  /**
+   * @brief Pop the label frame pushed last
+   */
+  static void popLabel();
+};
+
+/**
+ * @brief RAII label frame of the profiler, which shows a bridge entry point in the sampled stacks, and fires the `bridge__enter` and `bridge__exit`
+ * USDT probes. Costs a branch when the profiler is not running
+ */
+class ProfilerLabel {
+public:
+  explicit ProfilerLabel(const char *label) : label(label) {
+    PYTHONMONKEY_PROBE1(bridge__enter, label);
+    if (Profiler::active) {
+      pushed = Profiler::pushLabel(label, this);
+    }
+  }
+
+  ~ProfilerLabel() {
+    if (pushed) {
+      Profiler::popLabel();
+    }
+    PYTHONMONKEY_PROBE1(bridge__exit, label);
+  }
+
+  ProfilerLabel(const ProfilerLabel &) = delete;
+  ProfilerLabel &operator=(const ProfilerLabel &) = delete;
+
+private:
+  const char *label;
+  bool pushed = false;
+};
+
+#endif
@@ -31,6 +31,17 @@ public:
    */
   static PyObject *getPyObject(JSContext *cx, JS::HandleObject promise);
 
+  /**
+   * @brief Get a Python asyncio.Future of the value of the Promise of a JS iterator result, as returned by the `next()` of a JS async iterator.
+   * The Future raises StopAsyncIteration once the iterator result is done.
+   *
+   * @param cx - javascript context pointer
+   * @param promise - the Promise of the iterator result
+   *
+   * @returns PyObject* pointer to the resulting Future, or NULL with a Python exception set
+   */
+  static PyObject *getIteratorValuePyObject(JSContext *cx, JS::HandleObject promise);
+
   /**
    * @brief Convert a Python [awaitable](https://docs.python.org/3/library/asyncio-task.html#awaitables) object to JS Promise
    *
@@ -38,6 +49,29 @@ public:
    * @param pyObject - the python awaitable to be converted
    */
   static JSObject *toJsPromise(JSContext *cx, PyObject *pyObject);
+
+  /**
+   * @brief Convert the awaitable returned by the `__anext__` of a Python async iterator to a JS Promise of the iterator result,
+   * `{value, done: false}`, or `{value: undefined, done: true}` once the awaitable raises StopAsyncIteration
+   *
+   * @param cx - javascript context pointer
+   * @param pyObject - the python awaitable to be converted
+   */
+  static JSObject *toJsIteratorResultPromise(JSContext *cx, PyObject *pyObject);
+
+  /**
+   * @brief Initialize the table of JS Promises waiting on Python awaitables, must be called once the global object has been created and entered
+   *
+   * @param cx - javascript context pointer
+   * @return true - the table was created
+   * @return false - out of memory
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Destroy the table of pending JS Promises, must be called before the JS context is destroyed
+   */
+  static void finalize();
 };
 
 /**
@@ -50,10 +84,10 @@ bool PythonAwaitable_Check(PyObject *obj);
  * @brief Callback to resolve or reject the JS Promise when the Future is done
  * @see https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.add_done_callback
  *
- * @param futureCallbackTuple - tuple( javascript context pointer, rooted JS Promise object )
- * @param args - Args tuple. The callback is called with the Future object as its only argument
+ * @param self - unused, the callback is shared by every Future
+ * @param futureObj - the Future object, which is the only argument the callback is called with
  */
-static PyObject *futureOnDoneCallback(PyObject *futureCallbackTuple, PyObject *args);
+static PyObject *futureOnDoneCallback(PyObject *self, PyObject *futureObj);
 
 /**
  * @brief Callbacks to settle the Python asyncio.Future once the JS Promise is resolved
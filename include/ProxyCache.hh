@@ -0,0 +1,101 @@
+/**
+ * @file ProxyCache.hh
+ * @author agent (agent@local)
+ * @brief Identity-preserving caches of the proxies created when coercing objects between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_ProxyCache_
+#define PythonMonkey_ProxyCache_
+
+#include <jsapi.h>
+#include <js/GCPolicyAPI.h>
+#include <js/HashTable.h>
+
+#include <Python.h>
+
+#include <vector>
+
+/**
+ * @brief PyObject pointers are not GC things, so there is nothing to trace or sweep when they are stored in a GC hash table
+ */
+template <>
+struct JS::GCPolicy<PyObject *> : public JS::IgnoreGCPolicy<PyObject *> {};
+
+/**
+ * @brief This struct caches the JS proxies of Python objects and the Python proxies of JS objects,
+ * so that coercing the same object twice yields the same proxy (`a === b` in JS, `a is b` in Python) and costs a hash lookup.
+ *
+ * The Python -> JS direction is weak: entries are swept by the JS GC when the proxy dies, just before the proxy handler's `finalize` releases the Python object.
+ * The JS -> Python direction is removed when the JSObjectProxy or JSArrayProxy is deallocated, which may happen during a JS GC,
+ * so it is kept in a plain (rooted) GC hash table rather than in a JS WeakMap.
+ */
+struct ProxyCache {
+public:
+  /**
+   * @brief Initialize the caches, must be called once the global object has been created and entered
+   *
+   * @param cx - javascript context pointer
+   * @return true - the caches were created
+   * @return false - out of memory
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Destroy the caches, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Get the live JS proxy previously created for a Python object
+   *
+   * @param pyObject - the Python object
+   * @return JSObject* - the JS proxy, or nullptr if there is none
+   */
+  static JSObject *getJSProxy(PyObject *pyObject);
+
+  /**
+   * @brief Remember the JS proxy created for a Python object
+   *
+   * @param pyObject - the Python object
+   * @param proxy - its JS proxy
+   */
+  static void putJSProxy(PyObject *pyObject, JSObject *proxy);
+
+  /**
+   * @brief Get the live Python proxy (JSObjectProxy or JSArrayProxy) previously created for a JS object
+   *
+   * @param jsObject - the JS object
+   * @return PyObject* - a new reference to the Python proxy, or NULL if there is none
+   */
+  static PyObject *getPyProxy(JSObject *jsObject);
+
+  /**
+   * @brief Remember the Python proxy created for a JS object
+   *
+   * @param jsObject - the JS object
+   * @param proxy - its Python proxy, not owned by the cache
+   */
+  static void putPyProxy(JSObject *jsObject, PyObject *proxy);
+
+  /**
+   * @brief Forget the Python proxy of a JS object, called when the Python proxy is deallocated
+   *
+   * @param jsObject - the JS object
+   * @param proxy - the Python proxy being deallocated, the entry is only removed if it refers to this proxy
+   */
+  static void removePyProxy(JSObject *jsObject, PyObject *proxy);
+
+  /**
+   * @brief Empty the JS -> Python direction, so that it doesn't keep the JS objects alive while CrossHeap scans for cycles.
+   * The entries are put back with `putPyProxy` afterwards
+   *
+   * @param proxies - receives the Python proxies that were cached
+   */
+  static void takePyProxies(std::vector<PyObject *> &proxies);
+};
+
+#endif
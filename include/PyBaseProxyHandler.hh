@@ -15,6 +15,7 @@
 #include <jsfriendapi.h>
 #include <js/Conversions.h>
 #include <js/Proxy.h>
+#include <js/Symbol.h>
 
 #include <Python.h>
 
@@ -38,6 +39,43 @@ typedef struct {
   uint16_t nargs;        /* The argument count for the method */
 } JSMethodDef;
 
+typedef struct {
+  JS::SymbolCode code;   /* The well-known symbol naming the method */
+  JSNative call;         /* The C function that implements it */
+  uint16_t nargs;        /* The argument count for the method */
+} JSSymbolMethodDef;
+
+/**
+ * @brief Reserved slots of the globals (within the JSCLASS_GLOBAL_APPLICATION_SLOTS available to the embedding),
+ * each holding the method holder object of a proxy handler's method table
+ */
+enum GlobalSlots {
+  PyListMethodsSlot,
+  PyBytesMethodsSlot,
+  PyIterableMethodsSlot,
+  PyAsyncIterableMethodsSlot,
+  PyMapMethodsSlot,
+  GlobalSlotCount
+};
+static_assert(GlobalSlotCount <= JSCLASS_GLOBAL_APPLICATION_SLOTS, "too many global reserved slots");
+
+/**
+ * @brief Look up a method of a proxy handler. The function objects of the method table are created once per global,
+ * as properties of a method holder object kept in a reserved slot of the global, so a lookup is a single property lookup that doesn't allocate
+ *
+ * @param cx - javascript context pointer
+ * @param globalSlot - the GlobalSlots slot of the method table
+ * @param methods - the methods named by strings, terminated by an entry with a NULL name
+ * @param symbolMethods - the methods named by well-known symbols, terminated by an entry with a NULL call, or nullptr
+ * @param id - the property key being looked up
+ * @param desc - set to the property descriptor of the method if id names one
+ * @param found - set to whether id names a method
+ * @return true - the lookup succeeded
+ * @return false - an exception was set
+ */
+bool getProxyMethod(JSContext *cx, GlobalSlots globalSlot, const JSMethodDef *methods, const JSSymbolMethodDef *symbolMethods,
+  JS::HandleId id, JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc, bool *found);
+
 /**
  * @brief Convert jsid to a PyObject to be used as dict keys
  */
@@ -48,6 +86,17 @@ PyObject *idToKey(JSContext *cx, JS::HandleId id);
  */
 bool keyToId(PyObject *key, JS::MutableHandleId idp);
 
+/**
+ * @brief Check whether a Python attribute name is the name of one of the methods (tp_methods) of a type.
+ * The names are collected into a set on first use, so the lookup is a hash (and usually pointer) comparison rather than a scan
+ *
+ * @param type - the type whose tp_methods are searched
+ * @param key - the attribute name, must be a str
+ * @return true - key names a method of type
+ * @return false - it does not
+ */
+bool isMethodName(PyTypeObject *type, PyObject *key);
+
 bool idToIndex(JSContext *cx, JS::HandleId id, Py_ssize_t *index);
 
 #endif
\ No newline at end of file
@@ -14,6 +14,8 @@
 #include <Python.h>
 #include <jsapi.h>
 #include <vector>
+#include <deque>
+#include <mutex>
 #include <utility>
 #include <atomic>
 
@@ -32,7 +34,7 @@ public:
    * @see https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.Handle
    */
   struct AsyncHandle {
-    using id_t = uint32_t;
+    using id_t = uint64_t; // the generation of the slot in the high bits, its index in `_timeoutIdMap` in the low 32 bits, exactly representable as a JS number
   public:
     explicit AsyncHandle(PyObject *handle) : _handle(handle) {};
     AsyncHandle(const AsyncHandle &old) = delete; // forbid copy-initialization
@@ -40,17 +42,15 @@ public:
     ~AsyncHandle() {
       if (Py_IsInitialized()) { // the Python runtime has already been finalized when `_timeoutIdMap` is cleared at exit
         Py_XDECREF(_handle);
+        Py_XDECREF(_debugInfo);
       }
     }
 
     /**
-     * @brief Create a new `AsyncHandle` without an associated `asyncio.Handle` Python object
+     * @brief Create a new `AsyncHandle` without an associated `asyncio.Handle` Python object, in a free slot of the timer table
      * @return the timeoutId
      */
-    static inline id_t newEmpty() {
-      auto handle = AsyncHandle(Py_None);
-      return AsyncHandle::getUniqueId(std::move(handle));
-    }
+    static id_t newEmpty();
 
     /**
      * @brief Cancel the scheduled event-loop job.
@@ -67,21 +67,17 @@ public:
     bool _finishedOrCancelled();
 
     /**
-     * @brief Get the unique `timeoutID` for JS `setTimeout`/`clearTimeout` methods
+     * @brief Get the timer of a `timeoutID` for JS `setTimeout`/`clearTimeout` methods
      * @see https://developer.mozilla.org/en-US/docs/Web/API/setTimeout#return_value
+     * @return the timer, whose address is stable until it is released, or nullptr if the timeoutID is invalid or its timer was released
      */
-    static inline id_t getUniqueId(AsyncHandle &&handle) {
-      // TODO (Tom Tang): mutex lock
-      _timeoutIdMap.push_back(std::move(handle));
-      return _timeoutIdMap.size() - 1; // the index in `_timeoutIdMap`
-    }
-    static inline AsyncHandle *fromId(id_t timeoutID) {
-      try {
-        return &_timeoutIdMap.at(timeoutID);
-      } catch (...) { // std::out_of_range&
-        return nullptr; // invalid timeoutID
-      }
-    }
+    static AsyncHandle *fromId(id_t timeoutID);
+
+    /**
+     * @brief Release the slot of a finished or cancelled timer for reuse, its timeoutID becomes invalid.
+     * The GIL must be held.
+     */
+    static void release(id_t timeoutID);
 
     /**
      * @brief Cancel all pending event-loop jobs.
@@ -144,6 +140,13 @@ public:
       return _debugInfo;
     }
 
+    /**
+     * @brief Whether this timer is waiting in the timer heap to expire at `deadline`
+     */
+    inline bool _scheduledFor(double deadline) const {
+      return _scheduled && _deadline == deadline;
+    }
+
     /**
      * @brief Get an iterator for the `AsyncHandle`s of all timers
      */
@@ -154,6 +157,19 @@ public:
     PyObject *_handle;
     std::atomic_bool _refed = false;
     PyObject *_debugInfo = nullptr;
+    uint32_t _generation = 1; /**< incremented when the slot is released, so that stale timeoutIDs are detected */
+
+    // Timers of the native timer heap, their `_handle` is the job function rather than an `asyncio.Handle`
+    bool _isTimer = false;
+    bool _repeat = false;
+    bool _scheduled = false; /**< waiting in the timer heap, or running if it repeats */
+    double _delaySeconds = 0;
+    double _deadline = 0; /**< in event-loop time, see https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.time */
+
+    friend struct PyEventLoop;
+
+    static inline std::mutex _timeoutIdMapMutex; /**< protects the slot bookkeeping, timers are otherwise only used with the GIL held */
+    static inline std::vector<uint32_t> _freeSlots; /**< indices in `_timeoutIdMap` of the released timers */
   };
 
   /**
@@ -163,7 +179,8 @@ public:
    */
   AsyncHandle enqueue(PyObject *jobFn);
   /**
-   * @brief Schedule a job to the Python event-loop, with the given delay
+   * @brief Schedule a job to the Python event-loop, with the given delay.
+   * The timers are kept in a native min-heap, only the earliest deadline has an `asyncio.TimerHandle`, and all the timers due then run in its callback.
    * @param jobFn - The JS event-loop job converted to a Python function
    * @param delaySeconds - The job function will be called after the given number of seconds
    * @param repeat - If true, the job will be executed repeatedly on a fixed interval
@@ -296,6 +313,13 @@ public:
       }
     }
 
+    /**
+     * @return int - the number of our job functions in the Python event-loop
+     */
+    inline int getCounter() const {
+      return _counter;
+    }
+
     /**
      * @brief An `asyncio.Event` instance to notify that there are no queued asynchronous jobs
      * @see https://docs.python.org/3/library/asyncio-sync.html#asyncio.Event
@@ -327,8 +351,24 @@ private:
   static PyThreadState *_getMainThread();
   static inline PyThreadState *_getCurrentThread();
 
+  /**
+   * @brief Schedule the single `asyncio.TimerHandle` of the timer heap for the earliest deadline, if it is not already
+   * @return success
+   */
+  static bool _armTimers();
+
+  /**
+   * @brief The callback of the timer heap's `asyncio.TimerHandle`, runs all the timers that are due
+   */
+  static PyObject *_fireTimers(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args));
+
+  /**
+   * @brief Release all the timers of the heap, when timers start being scheduled on another Python event-loop
+   */
+  static void _dropTimers();
+
   // TODO (Tom Tang): use separate pools of IDs for different global objects
-  static inline std::vector<AsyncHandle> _timeoutIdMap;
+  static inline std::deque<AsyncHandle> _timeoutIdMap; // a deque so that growing it never moves the timers
 };
 
 #endif
\ No newline at end of file
@@ -16,7 +16,9 @@
 
 
 /**
- * @brief This struct is the ProxyHandler for JS Proxy Iterable pythonmonkey creates to handle coercion from python iterables to JS Objects
+ * @brief This struct is the ProxyHandler for JS Proxy Iterable pythonmonkey creates to handle coercion from python iterables to JS Objects.
+ * It proxies Python iterators as JS iterators, and Python async iterables (`__aiter__`/`__anext__`) as JS async iterables whose `next()`
+ * returns a Promise of the iterator result
  *
  */
 struct PyIterableProxyHandler : public PyObjectProxyHandler {
@@ -24,6 +26,22 @@ public:
   PyIterableProxyHandler() : PyObjectProxyHandler(&family) {};
   static const char family;
 
+  /**
+   * @brief Number of items pulled from a Python iterator per native call when JS iterates it, 1 (the default) pulls one item per `next()`.
+   * A larger batch is buffered on the proxy, so the iterator runs ahead of its consumer by up to that many items
+   */
+  static size_t batchSize;
+
+  /**
+   * @brief Create a JS iterator result object `{value, done}`
+   *
+   * @param cx - javascript context pointer
+   * @param value - the value, unset if done
+   * @param done - whether the iteration is finished
+   * @return JSObject* - the iterator result, or nullptr if out of memory
+   */
+  static JSObject *newIteratorResult(JSContext *cx, JS::HandleValue value, bool done);
+
   bool getOwnPropertyDescriptor(
     JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
     JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
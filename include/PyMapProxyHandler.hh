@@ -0,0 +1,74 @@
+/**
+ * @file PyMapProxyHandler.hh
+ * @author agent (agent@local)
+ * @brief Struct for creating JS Map-like proxy objects for the Python dicts whose keys are not strings
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_PyMapProxy_
+#define PythonMonkey_PyMapProxy_
+
+#include "include/PyObjectProxyHandler.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+/**
+ * @brief This struct is the ProxyHandler for the JS proxies of the Python dicts none of whose keys is a str, e.g. `{1: 'a', (2, 3): 'b'}`.
+ * They have the methods of a JS Map (`get`, `set`, `has`, `delete`, `clear`, `keys`, `values`, `entries`, `forEach` and `size`),
+ * which look up the dict with the Python key of their argument, rather than properties named by the stringified keys
+ *
+ */
+struct PyMapProxyHandler : public PyObjectProxyHandler {
+public:
+  PyMapProxyHandler() : PyObjectProxyHandler(&family) {};
+  static const char family;
+
+  /**
+   * @brief Whether a Python dict is proxied as a JS Map, i.e. it is not empty and none of its keys is a str.
+   * This is decided when the dict is first proxied, and stops at the first str key
+   *
+   * @param dict - the Python dict
+   * @return true - the dict has keys, none of which is a str
+   * @return false - otherwise
+   */
+  static bool isMapLike(PyObject *dict);
+
+  /**
+   * @brief [[OwnPropertyKeys]], a Map has no own properties, its entries are reached through its methods
+   */
+  bool ownPropertyKeys(JSContext *cx, JS::HandleObject proxy,
+    JS::MutableHandleIdVector props) const override;
+  bool delete_(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+    JS::ObjectOpResult &result) const override;
+  bool has(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+    bool *bp) const override;
+  bool set(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+    JS::HandleValue v, JS::HandleValue receiver,
+    JS::ObjectOpResult &result) const override;
+  bool enumerate(JSContext *cx, JS::HandleObject proxy,
+    JS::MutableHandleIdVector props) const override;
+  bool hasOwn(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+    bool *bp) const override;
+  bool getOwnEnumerablePropertyKeys(
+    JSContext *cx, JS::HandleObject proxy,
+    JS::MutableHandleIdVector props) const override;
+
+  /**
+   * @brief [[GetOwnProperty]], the Map methods and the `size` of the dict
+   */
+  bool getOwnPropertyDescriptor(
+    JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+    JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
+  ) const override;
+  bool defineProperty(JSContext *cx, JS::HandleObject proxy,
+    JS::HandleId id,
+    JS::Handle<JS::PropertyDescriptor> desc,
+    JS::ObjectOpResult &result) const override;
+};
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file RequireCache.hh
+ * @author agent (agent@local)
+ * @brief Cache of the file system lookups and of the module resolutions of the module loaders, optionally persisted between runs
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_RequireCache_
+#define PythonMonkey_RequireCache_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief This struct caches what the module loaders learn about the `node_modules` directories, which are not expected to change while the process runs.
+ *
+ * The first lookup of a path inside a `node_modules` directory lists that directory once, and the later lookups of its entries are answered
+ * from the listing: a missing module costs no `stat` call, and neither do the paths below a missing directory. The resolutions of module
+ * identifiers (the identifier and the directory of the requiring module -> the resolved file) are remembered too, so that `require` and
+ * `import` skip the search of the `node_modules` directories above the module.
+ *
+ * With `pythonmonkey.setRequireCache` or the `PYTHONMONKEY_REQUIRE_CACHE` environment variable, the cache is loaded from a file and saved
+ * back to it at exit. When it is loaded, the listings of the directories whose modification time changed are dropped, and so are the
+ * resolutions into them, e.g. after reinstalling a package.
+ */
+struct RequireCache {
+public:
+  /**
+   * @brief Load the cache from the file named by the PYTHONMONKEY_REQUIRE_CACHE environment variable, if any
+   */
+  static void init();
+
+  /**
+   * @brief Save the cache to its file if it changed, and drop it
+   */
+  static void finalize();
+
+  /**
+   * @brief Get the mode of a file, like `stat`, from the cache for the paths inside `node_modules` directories
+   *
+   * @param path - the path of the file, normalized
+   * @return int - the st_mode of the file, or -1 if it does not exist
+   */
+  static int statMode(const std::string &path);
+
+  /**
+   * @brief Forget the cached listings, modes and resolutions, e.g. after installing packages while the process runs
+   */
+  static void clear();
+
+  /**
+   * @brief Get the cached resolution of a module identifier
+   *
+   * @param kind - the loader, "require" or "import": they do not resolve the same way
+   * @param baseDirectory - the directory of the requiring module
+   * @param searchPaths - the extra directories the loader searches, e.g. `require.path`, joined into one string
+   * @param specifier - the module identifier
+   * @return std::string - the path of the module, or an empty string if it is not cached or no longer a file
+   */
+  static std::string getResolution(const std::string &kind, const std::string &baseDirectory, const std::string &searchPaths,
+    const std::string &specifier);
+
+  /**
+   * @brief Remember the resolution of a module identifier
+   *
+   * @param kind - the loader, "require" or "import"
+   * @param baseDirectory - the directory of the requiring module
+   * @param searchPaths - the extra directories the loader searches, e.g. `require.path`, joined into one string
+   * @param specifier - the module identifier
+   * @param resolved - the absolute path of the module
+   */
+  static void setResolution(const std::string &kind, const std::string &baseDirectory, const std::string &searchPaths,
+    const std::string &specifier, const std::string &resolved);
+
+  /**
+   * @brief List the `node_modules` directories that the modules of a directory can load from, with their packages, scopes and nested `node_modules`
+   *
+   * @param directory - the directory, e.g. the one of the program module
+   * @return size_t - the number of directories listed
+   */
+  static size_t prewarm(const std::string &directory);
+
+  /**
+   * @brief Load the cache from a file, and save it there at exit
+   *
+   * @param path - the path of the file, which does not need to exist, or an empty string to stop persisting the cache
+   */
+  static void setFile(const std::string &path);
+
+  /**
+   * @brief Save the cache to its file now, if it changed
+   *
+   * @return true - the cache was saved, or there was nothing to save
+   * @return false - the file could not be written
+   */
+  static bool save();
+};
+
+#endif
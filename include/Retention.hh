@@ -0,0 +1,128 @@
+/**
+ * @file Retention.hh
+ * @author agent (agent@local)
+ * @brief Tracking of the references across the Python <-> JS bridge that keep objects alive, for leak hunting
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Retention_
+#define PythonMonkey_Retention_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <atomic>
+
+/**
+ * @brief This struct records, while tracking is on, the live references that one heap holds into the other: the Python objects
+ * pinned by the JS proxies and function holders (the references released by their finalizers), and the JS objects pinned by the
+ * persistent roots of the Python proxies (released when the proxies are deallocated).
+ *
+ * `pythonmonkey.retention()` groups them by holder and by type, with their shallow sizes. Tracking also samples the allocation sites:
+ * one in every 1/`stackSampleRate` references records the JS and the Python stacks that created it.
+ * Tracking is off by default, and costs a branch per proxy then. It starts with `pythonmonkey.trackRetention()`,
+ * or at startup with the PYTHONMONKEY_TRACK_RETENTION environment variable set to the stack sample rate, e.g. `0` or `0.01`.
+ * Only the references created while tracking is on are recorded.
+ */
+struct Retention {
+public:
+  /**
+   * @brief Whether the references are being recorded, read by the inline hooks below, including from the finalizers that the GC
+   * runs on its helper threads
+   */
+  static inline std::atomic<bool> tracking = false;
+
+  /**
+   * @brief Start tracking if the PYTHONMONKEY_TRACK_RETENTION environment variable is set
+   */
+  static void init();
+
+  /**
+   * @brief Start or stop tracking; stopping forgets the recorded references
+   *
+   * @param enabled - whether to track
+   * @param stackSampleRate - the fraction of the references whose allocation stacks are recorded, from 0 to 1
+   */
+  static void setTracking(bool enabled, double stackSampleRate);
+
+  /**
+   * @brief Describe the recorded references as a Python dict of the `pythonObjects` pinned by JS and the `jsObjects` pinned by Python,
+   * each a list of groups sorted by size
+   *
+   * @return PyObject* - a new reference to the dict, or NULL with a Python exception set
+   */
+  static PyObject *toPython();
+
+  /**
+   * @brief Stop tracking, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Get the name of a proxy handler family, e.g. "PyDictProxyHandler"
+   *
+   * @param family - the family of the proxy handler
+   * @return const char* - its static name
+   */
+  static const char *handlerName(const void *family);
+
+  /**
+   * @brief Record that a JS thing now owns a reference to a Python object
+   *
+   * @param cx - javascript context pointer, to capture the JS stack
+   * @param pyObject - the Python object
+   * @param holder - the static name of what holds it, the proxy handler or "function holder"
+   */
+  static inline void pinPython(JSContext *cx, PyObject *pyObject, const char *holder) {
+    if (tracking) {
+      recordPython(cx, pyObject, holder);
+    }
+  }
+
+  /**
+   * @brief Record that a JS thing released its reference to a Python object, possibly on a GC helper thread
+   *
+   * @param pyObject - the Python object
+   * @param holder - the static name of what held it
+   */
+  static inline void unpinPython(PyObject *pyObject, const char *holder) {
+    if (tracking) {
+      forgetPython(pyObject, holder);
+    }
+  }
+
+  /**
+   * @brief Record that a Python proxy now roots a JS object: a JSObjectProxy, JSArrayProxy, JSMapProxy, JSSetProxy, JSFunctionProxy or JSMethodProxy
+   *
+   * @param cx - javascript context pointer, to capture the JS stack
+   * @param proxy - the Python proxy
+   */
+  static inline void pinJS(JSContext *cx, PyObject *proxy) {
+    if (tracking) {
+      recordJS(cx, proxy);
+    }
+  }
+
+  /**
+   * @brief Record that a Python proxy is deallocated
+   *
+   * @param proxy - the Python proxy
+   */
+  static inline void unpinJS(PyObject *proxy) {
+    if (tracking) {
+      forgetJS(proxy);
+    }
+  }
+
+private:
+  static void recordPython(JSContext *cx, PyObject *pyObject, const char *holder);
+  static void forgetPython(PyObject *pyObject, const char *holder);
+  static void recordJS(JSContext *cx, PyObject *proxy);
+  static void forgetJS(PyObject *proxy);
+};
+
+#endif
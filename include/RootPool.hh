@@ -0,0 +1,87 @@
+/**
+ * @file RootPool.hh
+ * @author agent (agent@local)
+ * @brief Pool of the persistent roots of the JS values held by the Python proxies
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_RootPool_
+#define PythonMonkey_RootPool_
+
+#include <jsapi.h>
+
+/**
+ * @brief This struct hands out the persistent roots of the proxies of JS objects and strings. The roots are allocated and linked into the
+ * persistent roots of the runtime by slabs, and a released root is cleared and kept for the next proxy instead of being unlinked and freed,
+ * so that the short-lived proxies don't cost a malloc, a free and two list updates each. The rooted vectors of the key, value, item
+ * and array iterators are pooled the same way, emptied when released.
+ *
+ * Only the roots of the main JS context are pooled, like the proxies they are for.
+ */
+struct RootPool {
+public:
+  /**
+   * @brief Get a root of the main context holding `obj`, in place of `new JS::PersistentRootedObject(cx, obj)`
+   *
+   * @param cx - javascript context pointer of the main context
+   * @param obj - the object to root, may be nullptr
+   * @return JS::PersistentRootedObject* - the root, to be given back with `deleteRoot`
+   */
+  static JS::PersistentRootedObject *newRoot(JSContext *cx, JSObject *obj = nullptr);
+
+  /**
+   * @brief Get a root of the main context holding `value`, in place of `new JS::PersistentRootedValue(cx, value)`
+   *
+   * @param cx - javascript context pointer of the main context
+   * @param value - the value to root
+   * @return JS::PersistentRootedValue* - the root, to be given back with `deleteRoot`
+   */
+  static JS::PersistentRootedValue *newValueRoot(JSContext *cx, const JS::Value &value);
+
+  /**
+   * @brief Get an empty rooted vector of ids of the main context, in place of `new JS::PersistentRootedIdVector(cx)`
+   *
+   * @param cx - javascript context pointer of the main context
+   * @return JS::PersistentRootedIdVector* - the root, to be given back with `deleteRoot`
+   */
+  static JS::PersistentRootedIdVector *newIdVectorRoot(JSContext *cx);
+
+  /**
+   * @brief Get an empty rooted vector of values of the main context, in place of `new JS::PersistentRootedValueVector(cx)`
+   *
+   * @param cx - javascript context pointer of the main context
+   * @return JS::PersistentRootedValueVector* - the root, to be given back with `deleteRoot`
+   */
+  static JS::PersistentRootedValueVector *newValueVectorRoot(JSContext *cx);
+
+  /**
+   * @brief Clear a root got from `newRoot` and keep it for the next one, does nothing for nullptr
+   */
+  static void deleteRoot(JS::PersistentRootedObject *root);
+
+  /**
+   * @brief Clear a root got from `newValueRoot` and keep it for the next one, does nothing for nullptr
+   */
+  static void deleteRoot(JS::PersistentRootedValue *root);
+
+  /**
+   * @brief Empty a vector got from `newIdVectorRoot` and keep it for the next one, does nothing for nullptr
+   */
+  static void deleteRoot(JS::PersistentRootedIdVector *root);
+
+  /**
+   * @brief Empty a vector got from `newValueVectorRoot` and keep it for the next one, does nothing for nullptr
+   */
+  static void deleteRoot(JS::PersistentRootedValueVector *root);
+
+  /**
+   * @brief Clear all the pooled roots, must be called before the JS context is destroyed. The slabs are left allocated, as the proxies
+   * that outlive the context may still release their roots
+   */
+  static void finalize();
+};
+
+#endif
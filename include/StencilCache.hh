@@ -0,0 +1,115 @@
+/**
+ * @file StencilCache.hh
+ * @author agent (agent@local)
+ * @brief Cache of the compiled stencils of the scripts evaluated by pythonmonkey.eval and of the ES modules, in memory and optionally on disk
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_StencilCache_
+#define PythonMonkey_StencilCache_
+
+#include <jsapi.h>
+#include <js/CompileOptions.h>
+#include <js/experimental/JSStencil.h>
+
+#include <Python.h>
+
+#include <string>
+
+/**
+ * @brief This struct caches the stencils (the parsed and bytecode-compiled, context-independent form of a script) of the evaluated scripts,
+ * keyed by a hash of their source and the compile options that change the generated bytecode. A stencil is only reused for the very same source,
+ * which is kept with it in memory and on disk.
+ * Evaluating the same source again, e.g. the modules loaded by `require` or the bootstrap code of PythonMonkey itself, only instantiates the cached stencil.
+ *
+ * The in-memory cache keeps the most recently used stencils. The optional on-disk store keeps the stencils encoded with JS::EncodeStencil,
+ * so that the next processes skip parsing too; it is enabled with `pythonmonkey.setStencilCache` or the `PYTHONMONKEY_STENCIL_CACHE` environment variable.
+ */
+struct StencilCache {
+public:
+  /**
+   * @brief Initialize the cache, and its on-disk store if the PYTHONMONKEY_STENCIL_CACHE environment variable names a directory
+   *
+   * @return true - the cache was initialized
+   * @return false - out of memory
+   */
+  static bool init();
+
+  /**
+   * @brief Initialize the self-hosted code of the JS runtime (the builtins written in JS), decoding it from the on-disk store if it has it,
+   * and storing it otherwise. Must be called after `init`
+   *
+   * @param cx - javascript context pointer
+   * @return true - the self-hosted code was initialized
+   * @return false - it could not be compiled
+   */
+  static bool initSelfHostedCode(JSContext *cx);
+
+  /**
+   * @brief Drop the cached stencils, must be called before the JS context is destroyed
+   */
+  static void finalize();
+
+  /**
+   * @brief Compile a global script, reusing the stencil cached for the same source and options
+   *
+   * @param cx - javascript context pointer
+   * @param options - the compile options of the script
+   * @param chars - the UTF-8 source of the script
+   * @param length - the length of the source in bytes
+   * @return JSScript* - the script, or nullptr with a JS exception pending
+   */
+  static JSScript *compile(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length);
+
+  /**
+   * @brief Whether the stencil of a global script is in the in-memory cache, so that `compile` only instantiates it
+   *
+   * @param options - the compile options of the script
+   * @param chars - the UTF-8 source of the script
+   * @param length - the length of the source in bytes
+   */
+  static bool contains(const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length);
+
+  /**
+   * @brief Instantiate the stencil of a global script compiled elsewhere, e.g. off-thread, and remember it like `compile` does
+   *
+   * @param cx - javascript context pointer
+   * @param options - the compile options the stencil was compiled with
+   * @param chars - the UTF-8 source of the script
+   * @param length - the length of the source in bytes
+   * @param stencil - the stencil
+   * @return JSScript* - the script, or nullptr with a JS exception pending
+   */
+  static JSScript *instantiate(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length, JS::Stencil *stencil);
+
+  /**
+   * @brief Compile an ES module, reusing the stencil cached for the same source and options
+   *
+   * @param cx - javascript context pointer
+   * @param options - the compile options of the module
+   * @param chars - the UTF-8 source of the module
+   * @param length - the length of the source in bytes
+   * @return JSObject* - the module record, not linked yet, or nullptr with a JS exception pending
+   */
+  static JSObject *compileModule(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length);
+
+  /**
+   * @brief Configure the cache
+   *
+   * @param maxEntries - the number of stencils kept in memory, 0 disables the in-memory cache
+   * @param directory - the directory of the on-disk store, created if needed, or an empty string to disable it
+   * @return true - the cache was configured
+   * @return false - a Python exception was set, the directory could not be created
+   */
+  static bool configure(size_t maxEntries, const std::string &directory);
+
+  /**
+   * @brief The directory of the on-disk store named by the PYTHONMONKEY_STENCIL_CACHE environment variable, or an empty string
+   */
+  static const std::string &defaultDirectory();
+};
+
+#endif
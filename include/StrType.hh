@@ -37,6 +37,48 @@ public:
   static PyObject *getPyObject(JSContext *cx, JS::HandleValue str);
 
   static PyObject *proxifyString(JSContext *cx, JS::HandleValue str);
+
+  /**
+   * @brief creates new UCS4-encoded pyObject string. This must be called by the user if the original JSString contains any surrogate pairs
+   *
+   * @param pyString - the UCS2 pyObject string to be converted
+   * @return PyObject* - the UCS4-encoding of the pyObject string, a new reference, or NULL if it contains unpaired surrogates
+   */
+  static PyObject *asUCS4(PyObject *pyString);
+
+  /**
+   * @brief Get a well-formed view of a (possibly lazily normalized) string, joining surrogate pairs into code points
+   *
+   * @param pyString - the pyObject string
+   * @return PyObject* - a new exact str object
+   */
+  static PyObject *toWellFormed(PyObject *pyString);
+
+  /**
+   * @brief Encode a string to UTF-8 bytes, straight from the chars of the JSString of a JSStringProxy, with no intermediate str.
+   * The unpaired surrogates of a JS string are encoded as U+FFFD, a Python str is encoded by `str.encode('utf-8')`
+   *
+   * @param cx - javascript context pointer
+   * @param pyString - the str or JSStringProxy
+   * @return PyObject* - a new reference to the bytes, or NULL with a Python exception set
+   */
+  static PyObject *toUTF8(JSContext *cx, PyObject *pyString);
+
+  /**
+   * @brief Encode a string to UTF-8 into a writable buffer, e.g. a bytearray or a memoryview of one, or else pass the bytes
+   * to the `write` method of `target`, in chunks for the big JS strings
+   *
+   * @param cx - javascript context pointer
+   * @param pyString - the str or JSStringProxy
+   * @param target - the buffer, which must be big enough for the whole string, or an object with a `write` method
+   * @return Py_ssize_t - the number of bytes written, or -1 with a Python exception set
+   */
+  static Py_ssize_t writeUTF8(JSContext *cx, PyObject *pyString, PyObject *target);
+
+  /**
+   * @brief If true, JS strings containing surrogate pairs are proxied zero-copy as UCS2, and only converted to UCS4 when `toWellFormed` is called (e.g. by `str()`)
+   */
+  static bool lazySurrogateNormalization;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+/**
+ * @file StructuredClone.hh
+ * @author agent (agent@local)
+ * @brief The structuredClone global, and the serialization of JS values to bytes on the structured clone wire format
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_StructuredClone_
+#define PythonMonkey_StructuredClone_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <cstddef>
+
+/**
+ * @brief This struct clones JS values with the structured clone algorithm of SpiderMonkey (`JS_WriteStructuredClone`/`JS_ReadStructuredClone`),
+ * the one of `postMessage`: objects, arrays, Maps, Sets, Dates, RegExps, errors, typed arrays and ArrayBuffers are copied,
+ * shared references and cycles preserved. Functions, symbols, WeakMaps, promises and the proxies of Python objects cannot be cloned.
+ *
+ * `serialize` and `deserialize` use the different-process flavour of the format, which holds no pointers, so that the bytes can be stored
+ * or sent to another process running the same SpiderMonkey version.
+ */
+struct StructuredClone {
+public:
+  /**
+   * @brief `structuredClone(value, { transfer })`
+   *
+   * @param cx - javascript context pointer
+   * @param value - the value to clone
+   * @param transfer - an array of the ArrayBuffers whose contents are moved to the clone, detaching them, or undefined
+   * @param rval - set to the clone
+   * @return true - the value was cloned
+   * @return false - a JS exception is pending, a DOMException named DataCloneError if the value cannot be cloned
+   */
+  static bool clone(JSContext *cx, JS::HandleValue value, JS::HandleValue transfer, JS::MutableHandleValue rval);
+
+  /**
+   * @brief Serialize a JS value into bytes
+   *
+   * @param cx - javascript context pointer
+   * @param value - the value to serialize
+   * @return PyObject* - a new reference to the bytes, or NULL with a JS exception pending
+   */
+  static PyObject *serialize(JSContext *cx, JS::HandleValue value);
+
+  /**
+   * @brief Rebuild a JS value from the bytes made by `serialize`
+   *
+   * @param cx - javascript context pointer
+   * @param data - the bytes
+   * @param length - the number of bytes
+   * @param rval - set to the value
+   * @return true - the value was rebuilt
+   * @return false - a JS exception is pending, e.g. the bytes are not valid
+   */
+  static bool deserialize(JSContext *cx, const char *data, size_t length, JS::MutableHandleValue rval);
+};
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file TypeLayoutCache.hh
+ * @author agent (agent@local)
+ * @brief Cache of the attribute layout of the Python types whose objects are proxied into JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_TypeLayoutCache_
+#define PythonMonkey_TypeLayoutCache_
+
+#include <Python.h>
+
+/**
+ * @brief Maximum number of types of the cache, it is emptied when full
+ */
+#define TYPE_LAYOUT_CACHE_MAX_TYPES 1024
+
+/**
+ * @brief Maximum number of attributes cached per type, the attributes of a type are forgotten when full
+ */
+#define TYPE_LAYOUT_CACHE_MAX_ATTRIBUTES 256
+
+/**
+ * @brief This struct caches, for each type using the generic attribute lookup, how each attribute name read through a PyObjectProxyHandler
+ * resolves: a `__slots__` slot read at its offset, a data descriptor (e.g. a property) called directly, or the instance `__dict__` then
+ * the class attribute. It also caches the public names of `dir()` that come from the type, so that enumerating an object only adds the
+ * keys of its `__dict__`. Together with the keys of the AtomCache, `obj.field` from JS becomes a slot or dict read.
+ *
+ * An entry is valid as long as the version tag of its type is, which CPython changes whenever the type or one of its bases is modified.
+ * The cache holds references to the types and to their descriptors, and is bounded by TYPE_LAYOUT_CACHE_MAX_TYPES.
+ */
+struct TypeLayoutCache {
+public:
+  /**
+   * @brief Get an attribute of an object, as PyObject_GetAttr does
+   *
+   * @param object - the object
+   * @param name - the attribute name, the layout is only cached for interned str names
+   * @return PyObject* - a new reference to the attribute; or NULL, without an exception set if the object has no such attribute
+   * (an AttributeError is cleared), with the exception set if the lookup raised another one
+   */
+  static PyObject *getAttr(PyObject *object, PyObject *name);
+
+  /**
+   * @brief Get the names of `dir(object)` that do not start with "__", sorted
+   *
+   * @param object - the object
+   * @return PyObject* - a new reference to a list of str, or NULL with an exception set
+   */
+  static PyObject *publicNames(PyObject *object);
+
+  /**
+   * @brief Empty the cache, must be called before Python is finalized
+   */
+  static void finalize();
+};
+
+#endif
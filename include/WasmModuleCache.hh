@@ -0,0 +1,50 @@
+/**
+ * @file WasmModuleCache.hh
+ * @author agent (agent@local)
+ * @brief Cache of the compiled WebAssembly modules, keyed by the bytes of their binary
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_WasmModuleCache_
+#define PythonMonkey_WasmModuleCache_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <cstdint>
+
+/**
+ * @brief This struct keeps the most recently compiled WebAssembly modules, for `pythonmonkey.compileWasm`.
+ * Compiling the same binary again, e.g. the codec a library instantiates for each call, only creates a new `WebAssembly.Module` object
+ * sharing the cached machine code.
+ *
+ * SpiderMonkey can't serialize compiled Wasm code anymore, the cache is in memory only.
+ */
+struct WasmModuleCache {
+public:
+  /**
+   * @brief Get a `WebAssembly.Module` of a Wasm binary, compiling it unless the same bytes were compiled recently
+   *
+   * @param cx - javascript context pointer
+   * @param bytes - the Wasm binary
+   * @param length - the length of the binary in bytes
+   * @return JSObject* - the `WebAssembly.Module`, or nullptr with a JS exception pending, e.g. a `WebAssembly.CompileError`
+   */
+  static JSObject *compile(JSContext *cx, const uint8_t *bytes, size_t length);
+
+  /**
+   * @brief Drop the cached modules, must be called before SpiderMonkey is shut down
+   */
+  static void finalize();
+
+  /**
+   * @brief The number of modules kept in memory, 0 disables the cache
+   */
+  static size_t maxEntries;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file Watchdog.hh
+ * @author agent (agent@local)
+ * @brief Execution time and heap size limits of the JS code run by pythonmonkey.eval
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#ifndef PythonMonkey_Watchdog_
+#define PythonMonkey_Watchdog_
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief This struct enforces the `timeoutMs` and `maxHeapBytes` options of `pythonmonkey.eval`.
+ *
+ * A watchdog thread requests an interrupt when the deadline passes, and the interrupt callback then terminates the JS code
+ * (uncatchable by JS `try`/`catch`) with a Python TimeoutError. The heap limit lowers JSGC_MAX_BYTES while the code runs:
+ * when an allocation fails because of it, the code is terminated the same way with a Python MemoryError.
+ */
+struct Watchdog {
+public:
+  /**
+   * @brief Register the interrupt and out of memory callbacks, must be called once the JS context has been created
+   *
+   * @param cx - javascript context pointer
+   * @return true - the callbacks were registered
+   * @return false - out of memory
+   */
+  static bool init(JSContext *cx);
+
+  /**
+   * @brief Hold the state of the watchdog thread across a `fork()`, so that the thread doesn't own it when the process is copied
+   */
+  static void prepareFork();
+
+  /**
+   * @brief Release the state held by `prepareFork`. The child has no watchdog thread, a new one is started if limited code is running
+   *
+   * @param inChild - whether this is the child process
+   */
+  static void afterFork(bool inChild);
+
+  /**
+   * @brief RAII guard around the execution of limited JS code. Limits nest, the tighter one applies
+   */
+  class AutoLimit {
+  public:
+    /**
+     * @param timeoutMs - the maximum execution time in milliseconds, or 0 for no limit
+     * @param maxHeapBytes - the maximum size of the GC heap in bytes while the code runs, or 0 for no limit
+     */
+    AutoLimit(double timeoutMs, uint64_t maxHeapBytes);
+    ~AutoLimit();
+
+    /**
+     * @return true - the watchdog could not be started, a Python RuntimeError was set
+     */
+    inline bool failed() const {
+      return _failed;
+    }
+
+    /**
+     * @brief Called when the JS code failed: if it exceeded a limit, its uncaught JS exception, if any, is replaced by the Python exception
+     *
+     * @return true - a limit was exceeded and the Python exception is set
+     */
+    bool exceeded();
+
+  private:
+    bool _failed = false;
+    bool _armed = false;
+    bool _limitsHeap = false;
+    std::chrono::steady_clock::time_point _previousDeadline;
+    bool _previousArmed = false;
+    double _previousTimeoutMs = 0;
+    uint32_t _previousMaxBytes = 0;
+    uint64_t _previousHeapLimit = 0;
+  };
+};
+
+#endif
@@ -14,6 +14,24 @@
 namespace InternalBinding {
   extern JSFunctionSpec utils[];
   extern JSFunctionSpec timers[];
+  extern JSFunctionSpec metrics[];
+  extern JSFunctionSpec fs[];
+  extern JSFunctionSpec encoding[];
+  extern JSFunctionSpec console[];
+  extern JSFunctionSpec url[];
+
+  /**
+   * @brief Capture the String methods that `internalBinding("url")` calls, before any user code runs and can replace them;
+   * `createClasses` captures them too if this was not called
+   *
+   * @return false with a JS exception pending on failure
+   */
+  bool initUrl(JSContext *cx);
+
+  /**
+   * @brief Release the String methods captured for `internalBinding("url")`, must be called before the JS context is destroyed
+   */
+  void finalizeUrl();
 }
 
 JSObject *createInternalBindingsForNamespace(JSContext *cx, JSFunctionSpec *methodSpecs);
@@ -41,14 +41,87 @@ public:
 extern PythonExternalString PythonExternalStringCallbacks;
 
 /**
- * @brief Function that makes a UTF16-encoded copy of a UCS4 string
+ * @brief Reserved slots of the JSFunctions wrapping python callables (see `js::NewFunctionWithReserved`)
+ */
+enum PyFuncSlots {
+  PyFuncObjectSlot, // the wrapped PyObject (as a private value), or the JS function to forward calls to
+  PyFuncHolderSlot  // the native PyObjectHolder object releasing the python reference when the JSFunction is finalized
+};
+
+/**
+ * @brief Reserved slots of the native PyObjectHolder objects
+ */
+enum PyObjectHolderSlots {
+  PyObjectHolderSlot,
+  PyObjectHolderArgShapeSlot, // the PyFuncArgShape of the held python callable, undefined if it is not called through callPyFunc
+  PyObjectHolderSlotCount
+};
+
+/**
+ * @brief Number of positional arguments `callPyFunc` can pass without a heap allocation
+ */
+#define PY_FUNC_SMALL_ARGS_COUNT 8
+
+/**
+ * @brief The positional argument shape of a python callable, computed once when it is wrapped so `callPyFunc` doesn't have to introspect it on every call
+ */
+struct PyFuncArgShape {
+  int32_t nNormalArgs = 0; // number of positional arguments without a default value
+  int32_t nDefaultArgs = 0; // number of positional arguments with a default value
+  bool varargs = false; // the callable has a `*args` parameter
+  bool unknownNargs = false; // the callable can't be introspected, all passed arguments are forwarded
+
+  /**
+   * @brief Compute the argument shape of a python callable
+   *
+   * @param pyFunc - the python callable
+   * @return PyFuncArgShape - its argument shape
+   */
+  static PyFuncArgShape fromPyFunc(PyObject *pyFunc);
+
+  /**
+   * @brief Pack the argument shape into a JS::Value so it can be stored in a reserved slot
+   *
+   * @return JS::Value - the packed argument shape
+   */
+  JS::Value toValue() const;
+
+  /**
+   * @brief Unpack an argument shape stored with `toValue`
+   *
+   * @param value - the packed argument shape, or undefined in which case all passed arguments are forwarded
+   * @return PyFuncArgShape - the argument shape
+   */
+  static PyFuncArgShape fromValue(const JS::Value &value);
+
+  /**
+   * @brief The number of positional arguments to pass to the callable when called with `passed` arguments: the extra ones are dropped,
+   * and the missing positionals without a default value are set to None, as JS sets the missing arguments to undefined
+   *
+   * @param passed - the number of arguments of the call
+   * @return Py_ssize_t - the number of positional arguments to pass
+   */
+  Py_ssize_t argCount(Py_ssize_t passed) const;
+};
+
+/**
+ * @brief Function that computes the length of the UTF16 encoding of a UCS4 string
+ *
+ * @param chars - pointer to the UCS4-encoded string
+ * @param length - length of chars in code points
+ * @return size_t - length of the UTF16 encoding (counting surrogate pairs as 2)
+ */
+size_t UCS4ToUTF16Length(const uint32_t *chars, size_t length);
+
+/**
+ * @brief Function that writes a UTF16-encoded copy of a UCS4 string into a caller-provided buffer
  *
  * @param chars - pointer to the UCS4-encoded string
  * @param length - length of chars in code points
- * @param outStr - UTF16-encoded out-parameter string
+ * @param outStr - UTF16-encoded out-parameter string, must have room for UCS4ToUTF16Length(chars, length) code units
  * @return size_t - length of outStr (counting surrogate pairs as 2)
  */
-size_t UCS4ToUTF16(const uint32_t *chars, size_t length, uint16_t *outStr);
+size_t UCS4ToUTF16(const uint32_t *chars, size_t length, char16_t *outStr);
 
 /**
  * @brief Function that takes a PyObject and returns a corresponding JS::Value, doing shared memory management when necessary
@@ -64,6 +137,14 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object);
  */
 JS::Value jsTypeFactorySafe(JSContext *cx, PyObject *object);
 
+/**
+ * @brief Get the Python object a JS object owns a reference to: the Python object of a JS proxy, or the Python callable of the holder of a JS function
+ *
+ * @param obj - the JS object
+ * @return PyObject* - a borrowed reference to the Python object, or nullptr if the JS object holds none
+ */
+PyObject *getHeldPyObject(JSObject *obj);
+
 /**
  * @brief Helper function for jsTypeFactory to create a JSFunction* through JS_NewFunction that knows how to call a python function.
  *
@@ -74,4 +155,36 @@ JS::Value jsTypeFactorySafe(JSContext *cx, PyObject *object);
  * @return false - Function did not execute successfully and an exception has been set
  */
 bool callPyFunc(JSContext *cx, unsigned int argc, JS::Value *vp);
+
+/**
+ * @brief Move the Python exception being raised to the JSContext, as a JS Error
+ *
+ * @param cx - Pointer to the JSContext
+ * @return true - the exception has been set on the JSContext
+ * @return false - it is a SystemExit, which is left raised to end the program
+ */
+bool setPyException(JSContext *cx);
+
+/**
+ * @brief Get the python callable wrapped by a JSFunction that calls it through `callPyFunc`, so that it can be called without converting its arguments to JS and back
+ *
+ * @param function - the JS function
+ * @param shape - set to the argument shape of the callable
+ * @return PyObject* - a borrowed reference to the callable, kept alive by `function`, or nullptr if `function` is not such a JSFunction
+ */
+PyObject *getWrappedPyFunc(JSObject *function, PyFuncArgShape *shape);
+
+/**
+ * @brief Call a python callable got with `getWrappedPyFunc` with python arguments, passing them the way `callPyFunc` passes JS arguments
+ *
+ * @param cx - Pointer to the JSContext
+ * @param pyFunc - the python callable
+ * @param shape - its argument shape
+ * @param args - the arguments
+ * @param argc - the number of arguments
+ * @param pyRval - set to a new reference to the result, or NULL if the call returned none (e.g. SystemExit was raised)
+ * @return true - the callable was called
+ * @return false - it raised, and the exception has been set on the JSContext
+ */
+bool callWrappedPyFunc(JSContext *cx, PyObject *pyFunc, const PyFuncArgShape &shape, PyObject *const *args, Py_ssize_t argc, PyObject **pyRval);
 #endif
\ No newline at end of file
@@ -128,6 +128,31 @@ inline PyObject *PyObject_CallOneArg(PyObject *func, PyObject *arg) {
 }
 #endif
 
+/**
+ * @brief Shim for `PyObject_Vectorcall` and `Py_TPFLAGS_HAVE_VECTORCALL`.
+ *        The vectorcall protocol is provisional and underscore-prefixed in Python 3.8
+ */
+#if PY_VERSION_HEX < 0x03090000 // Python version is less than 3.9
+  #define PyObject_Vectorcall _PyObject_Vectorcall
+  #define Py_TPFLAGS_HAVE_VECTORCALL _Py_TPFLAGS_HAVE_VECTORCALL
+#endif
+
+/**
+ * @brief Shim for `PyFrame_GetCode` and `PyFrame_GetBack`, which return new references.
+ *        Both are not available in Python < 3.9, where the fields of the frame objects are public
+ */
+#if PY_VERSION_HEX < 0x03090000 // Python version is less than 3.9
+inline PyCodeObject *PyFrame_GetCode(PyFrameObject *frame) {
+  Py_INCREF(frame->f_code);
+  return frame->f_code;
+}
+
+inline PyFrameObject *PyFrame_GetBack(PyFrameObject *frame) {
+  Py_XINCREF(frame->f_back);
+  return frame->f_back;
+}
+#endif
+
 /**
  * @brief Shim for `_PyLong_AsByteArray`.
  *        Python 3.13.0a4 added a new public API `PyLong_AsNativeBytes()` to replace the private `_PyLong_AsByteArray()`.
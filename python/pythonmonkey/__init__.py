@@ -2,16 +2,59 @@
 from .pythonmonkey import *
 from .helpers import *
 from .require import *
+from .http_pool import *
+from . import profiler
 
 # Expose the package version
 import importlib.metadata
-__version__ = importlib.metadata.version(__name__)
+try:
+  __version__ = importlib.metadata.version(__name__)
+except importlib.metadata.PackageNotFoundError:  # imported from the source tree, e.g. by the PGO training run or the `bench` target
+  __version__ = "0.0.0"
 del importlib
 
-# Load the module by default to expose global APIs
-# builtin_modules
-require("console")
-require("base64")
-require("timers")
-require("url")
-require("XMLHttpRequest")
+# Expose the global APIs of the builtin_modules. A module is only loaded when one of its globals is first used,
+# which keeps `import pythonmonkey` fast for the programs that don't need them.
+pythonmonkey.eval("""'use strict'; (function defineLazyGlobals(require) {
+  const globalsByModule = {
+    'console': ['console'],
+    'base64': ['atob', 'btoa'],
+    'text-encoding': ['TextEncoder', 'TextDecoder'],
+    'structured-clone': ['structuredClone'],
+    'timers': ['setTimeout', 'clearTimeout', 'setImmediate', 'clearImmediate', 'setInterval', 'clearInterval'],
+    'event-target': ['Event', 'EventTarget'],
+    'dom-exception': ['DOMException'],
+    'url': ['URL', 'URLSearchParams'],
+    'XMLHttpRequest': ['XMLHttpRequestEventTarget', 'XMLHttpRequestUpload', 'XMLHttpRequest', 'ProgressEvent'],
+    'fetch': ['fetch', 'Headers', 'Request', 'Response'],
+  };
+
+  for (const [moduleId, names] of Object.entries(globalsByModule)) {
+    let loaded = false;
+    const getters = [];
+    function load() {
+      if (loaded)
+        return;
+      loaded = true;
+      // the module defines its globals only if they are not there yet
+      names.forEach((name, index) => {
+        if (Object.getOwnPropertyDescriptor(globalThis, name)?.get === getters[index])
+          delete globalThis[name];
+      });
+      require(moduleId);
+    }
+
+    names.forEach((name) => {
+      const get = () => { load(); return globalThis[name]; };
+      getters.push(get);
+      Object.defineProperty(globalThis, name, {
+        configurable: true,
+        enumerable: true,
+        get,
+        set(value) {
+          Object.defineProperty(globalThis, name, { value, writable: true, configurable: true, enumerable: true });
+        },
+      });
+    });
+  }
+})""", {'filename': __file__})(createRequire(__file__))
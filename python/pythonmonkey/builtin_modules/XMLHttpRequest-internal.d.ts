@@ -41,7 +41,8 @@ export declare function request(
   processRequestEndOfBody: () => void,
   // callbacks for response progress
   processResponse: (response: XHRResponse) => void,
-  processBodyChunk: (bytes: Uint8Array) => void,
+  /** returns a promise when the download must wait for the reader of the response stream */
+  processBodyChunk: (bytes: Uint8Array) => void | Promise<void>,
   processEndOfBody: () => void,
   // callbacks for known exceptions
   onTimeoutError: (err: Error) => void,
@@ -50,8 +51,3 @@ export declare function request(
   /** See `pm.bootstrap.require("debug")` */
   debug: (selector: string) => ((...args: string[]) => void),
 ): Promise<void>;
-
-/**
- * Decode data using the codec registered for encoding.
- */
-export declare function decodeStr(data: Uint8Array, encoding?: string): string;
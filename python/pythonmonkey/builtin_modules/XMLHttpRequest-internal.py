@@ -10,10 +10,8 @@ import yarl
 import io
 import platform
 import pythonmonkey as pm
-from typing import Union, ByteString, Callable, TypedDict
-
-keepAliveConnector: Union[aiohttp.TCPConnector, None] = None
-
+from pythonmonkey import http_pool
+from typing import Union, ByteString, Callable, TypedDict, Awaitable
 
 class XHRResponse(TypedDict, total=True):
   """
@@ -39,7 +37,7 @@ async def request(
     processRequestEndOfBody: Callable[[], None],
     # callbacks for response progress
     processResponse: Callable[[XHRResponse], None],
-    processBodyChunk: Callable[[bytearray], None],
+    processBodyChunk: Callable[[bytearray], Union[Awaitable[None], None]],
     processEndOfBody: Callable[[], None],
     # callbacks for known exceptions
     onTimeoutError: Callable[[asyncio.TimeoutError], None],
@@ -49,12 +47,6 @@ async def request(
     /
 ):
 
-  # to support HTTP-Keep-Alive
-  global keepAliveConnector
-  if (not keepAliveConnector):
-    # seconds before closing Keep-Alive connection.
-    keepAliveConnector = aiohttp.TCPConnector(keepalive_timeout=5)  # 5s is the default for Node.js's `http.globalAgent`
-
   class BytesPayloadWithProgress(aiohttp.BytesPayload):
     _chunkMaxLength = 2**16  # aiohttp default
 
@@ -84,13 +76,13 @@ async def request(
 
   try:
     debug('xhr:aiohttp')('creating request for', url)
-    async with aiohttp.request(method=method,
-                               url=yarl.URL(url, encoded=True),
-                               headers=headers,
-                               data=BytesPayloadWithProgress(body) if body else None,
-                               timeout=timeoutOptions,
-                               connector=keepAliveConnector,
-                               ) as res:
+    # the connections are pooled with those of fetch(), see `pm.configure_fetch`
+    async with http_pool.session_for(url).request(method=method,
+                                                  url=yarl.URL(url, encoded=True),
+                                                  headers=headers,
+                                                  data=BytesPayloadWithProgress(body) if body else None,
+                                                  timeout=timeoutOptions,
+                                                  ) as res:
       debug('xhr:aiohttp')('got', res.content_type, 'result')
 
       def getResponseHeader(name: str):
@@ -120,7 +112,10 @@ async def request(
       })
 
       async for data in res.content.iter_any():
-        processBodyChunk(bytearray(data))  # PythonMonkey only accepts the mutable bytearray type
+        # a bytearray is shared with JS without a copy, the immutable bytes would be proxied element by element
+        backpressure = processBodyChunk(bytearray(data))
+        if backpressure is not None:  # the response stream is full, wait for its reader
+          await backpressure
       # readyState DONE
       processEndOfBody()
   except asyncio.TimeoutError as e:
@@ -131,10 +126,5 @@ async def request(
     raise  # rethrow
 
 
-def decodeStr(data: bytes, encoding='utf-8'):  # XXX: Remove this once we get proper TextDecoder support
-  return str(data, encoding=encoding)
-
-
 # Module exports
 exports['request'] = request  # type: ignore
-exports['decodeStr'] = decodeStr  # type: ignore
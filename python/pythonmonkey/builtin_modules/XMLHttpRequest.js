@@ -12,7 +12,11 @@
 const { EventTarget, Event } = require('event-target');
 const { DOMException } = require('dom-exception');
 const { URL, URLSearchParams } = require('url');
-const { request, decodeStr } = require('XMLHttpRequest-internal');
+const { ResponseBodyStream, resizeArrayBuffer } = require('body-stream');
+const { TextDecoder } = require('text-encoding');
+const { request } = require('XMLHttpRequest-internal');
+
+const utf8Decoder = new TextDecoder();
 const debug = globalThis.python.eval('__import__("pythonmonkey").bootstrap.require')('debug');
 
 /**
@@ -25,9 +29,10 @@ const debug = globalThis.python.eval('__import__("pythonmonkey").bootstrap.requi
  */
 function trunc(what, maxlen, coerce)
 {
+  const length = what.length;
   if (coerce !== false && typeof what !== 'string')
   {
-    what = Array.from(what).map(x => {
+    what = Array.from(what.slice(0, maxlen)).map(x => {
       if (x > 31 && x < 127)
         return String.fromCharCode(x);
       else if (x < 32)
@@ -38,7 +43,7 @@ function trunc(what, maxlen, coerce)
         return '\u2423';
     }).join('');
   }
-  return `${what.slice(0, maxlen)}${what.length > maxlen ? '\u2026' : ''}`;
+  return `${what.slice(0, maxlen)}${length > maxlen ? '\u2026' : ''}`;
 }
 
 // exposed
@@ -93,6 +98,9 @@ const FORBIDDEN_REQUEST_METHODS = [
   'CONNECT'
 ];
 
+// the Content-Length is sent by the server, the body is not allocated upfront beyond this; larger bodies grow as they arrive
+const MAX_PREALLOCATED_BODY_LENGTH = 16 * 1024 * 1024;
+
 // exposed
 /**
  * Implement the `XMLHttpRequest` API (`XHR` for short) according to the spec.
@@ -195,7 +203,9 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       this.#synchronousFlag = true;
     this.#requestHeaders = {}; // clear
     this.#response = null;
-    this.#receivedBytes = [];
+    this.#body = null;
+    this.#receivedLength = 0;
+    this.#responseStream = null;
     this.#responseObject = null;
 
     // step 12
@@ -378,16 +388,28 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       if (this.#state !== XMLHttpRequest.HEADERS_RECEIVED) // step 11.9.6
         return;
       responseLength = this.#response.contentLength; // step 11.9.8
+      if (this.#responseType === 'stream')
+        this.#responseStream = new ResponseBodyStream(() => this.abort());
     };
 
-    const processBodyChunk = (/** @type {Uint8Array} */ bytes) =>
+    /**
+     * @param {Uint8Array} bytes - a chunk of the body, backed by the bytearray of the Python side without a copy
+     * @returns {Promise<void> | undefined} a promise that the download waits for when the response stream is full
+     */
+    const processBodyChunk = (bytes) =>
     {
       this.#debug('xhr:response')(`recv chunk, ${bytes.length} bytes «${trunc(bytes, 100)}»`);
-      this.#receivedBytes.push(bytes);
+      let backpressure;
+      if (this.#responseStream)
+        backpressure = this.#responseStream._enqueue(bytes);
+      else
+        this.#appendToBody(bytes, responseLength);
+      this.#receivedLength += bytes.length;
       if (this.#state === XMLHttpRequest.HEADERS_RECEIVED)
         this.#state = XMLHttpRequest.LOADING;
       this.dispatchEvent(new Event('readystatechange'));
       this.dispatchEvent(new ProgressEvent('progress', { loaded:this.#receivedLength, total:responseLength }));
+      return backpressure;
     };
 
     /**
@@ -398,6 +420,10 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       this.#debug('xhr:response')(`end of body, received ${this.#receivedLength} bytes`);
       const transmitted = this.#receivedLength; // step 3
       const length = responseLength || 0; // step 4
+      if (this.#body && this.#body.byteLength !== transmitted)
+        this.#body = resizeArrayBuffer(this.#body, transmitted); // trim the spare capacity, once
+      if (this.#responseStream)
+        this.#responseStream._close();
 
       this.dispatchEvent(new ProgressEvent('progress', { loaded:transmitted, total:length })); // step 6
       this.#state = XMLHttpRequest.DONE; // step 7
@@ -465,6 +491,8 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
     this.#sendFlag = false; // step 2
 
     this.#response = null/* network error */; // step 3
+    if (this.#responseStream)
+      this.#responseStream._error(exception);
 
     if (this.#synchronousFlag) // step 4
       throw exception;
@@ -578,7 +606,9 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
   }
 
   /**
-   * @typedef {"" | "arraybuffer" | "blob" | "document" | "json" | "text"} ResponseType
+   * "stream" is not standard: the response is then a ResponseBodyStream, readable from HEADERS_RECEIVED on,
+   * and the body is not kept
+   * @typedef {"" | "arraybuffer" | "blob" | "document" | "json" | "text" | "stream"} ResponseType
    */
   get responseType()
   {
@@ -588,8 +618,8 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
   {
     if (this.#state === XMLHttpRequest.LOADING || this.#state === XMLHttpRequest.DONE)
       throw new DOMException('responseType can only be set before send()', 'InvalidStateError');
-    if (!['', 'text', 'arraybuffer', 'json'].includes(t))
-      throw new DOMException('only responseType "text" or "arraybuffer" or "json" is supported', 'NotSupportedError');
+    if (!['', 'text', 'arraybuffer', 'json', 'stream'].includes(t))
+      throw new DOMException('only responseType "text" or "arraybuffer" or "json" or "stream" is supported', 'NotSupportedError');
     this.#responseType = t;
   }
 
@@ -599,9 +629,8 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
    */
   #getTextResponse()
   {
-    // TODO: refactor using proper TextDecoder API
     // TODO: handle encodings other than utf-8
-    this.#responseObject = decodeStr(this.#mergeReceivedBytes(), 'utf-8');
+    this.#responseObject = utf8Decoder.decode(this.#receivedBytes());
     return this.#responseObject;
   }
 
@@ -613,6 +642,8 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
   {
     if (this.#responseType === '' || this.#responseType === 'text') // step 1
       return this.responseText;
+    if (this.#responseType === 'stream')
+      return this.#responseStream;
     if (this.#state !== XMLHttpRequest.DONE) // step 2
       return null;
 
@@ -620,7 +651,7 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       return this.#responseObject;
     if (this.#responseType === 'arraybuffer') // step 5
     {
-      this.#responseObject = this.#mergeReceivedBytes().buffer;
+      this.#responseObject = this.#body ?? new ArrayBuffer(0); // already trimmed to the received length
       return this.#responseObject;
     }
     
@@ -633,8 +664,7 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       let jsonObject = null;
       try
       {
-        // TODO: use proper TextDecoder API
-        const str = decodeStr(this.#mergeReceivedBytes(), 'utf-8'); // only supports utf-8, see https://infra.spec.whatwg.org/#parse-json-bytes-to-a-javascript-value
+        const str = utf8Decoder.decode(this.#receivedBytes()); // only supports utf-8, see https://infra.spec.whatwg.org/#parse-json-bytes-to-a-javascript-value
         jsonObject = JSON.parse(str);
       }
       catch (exception)
@@ -643,6 +673,7 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
       }
       // step 8.4
       this.#responseObject = jsonObject;
+      return this.#responseObject;
     }
 
     // step 6 and step 7 ("blob" or "document") are not supported
@@ -689,37 +720,45 @@ class XMLHttpRequest extends XMLHttpRequestEventTarget
   #timedOutFlag = false; // A flag, initially unset.
   /** @type {import('./XMLHttpRequest-internal').XHRResponse} */
   #response = null;
-  /** @type {Uint8Array[]} */
-  #receivedBytes = [];
+  /**
+   * the received body, over-allocated while it is received and trimmed at its end
+   * @type {ArrayBuffer | null}
+   */
+  #body = null;
+  #receivedLength = 0;
+  /** @type {ResponseBodyStream | null} */
+  #responseStream = null;
   /** @type {ResponseType} */
   #responseType = '';
   /** 
-   * cache for converting receivedBytes to the desired response type
+   * cache for converting the received bytes to the desired response type
    * @type {ArrayBuffer | string | Record<any, any>}
    */
   #responseObject = null;
 
   /**
-   * Get received bytes’s total length
+   * Copy a chunk at the end of the body, growing it geometrically (or to the Content-Length, up to MAX_PREALLOCATED_BODY_LENGTH) so that the
+   * chunks are copied once, instead of being kept and concatenated into another copy of the whole body
+   * @param {Uint8Array} bytes
+   * @param {number} expectedLength - the Content-Length, 0 if unknown
    */
-  get #receivedLength()
+  #appendToBody(bytes, expectedLength)
   {
-    return this.#receivedBytes.reduce((sum, chunk) => sum + chunk.length, 0);
+    const offset = this.#receivedLength;
+    const needed = offset + bytes.length;
+    if (!this.#body)
+      this.#body = new ArrayBuffer(Math.max(needed, Math.min(expectedLength, MAX_PREALLOCATED_BODY_LENGTH)));
+    else if (needed > this.#body.byteLength)
+      this.#body = resizeArrayBuffer(this.#body, Math.max(needed, this.#body.byteLength * 2));
+    new Uint8Array(this.#body, offset, bytes.length).set(bytes);
   }
 
   /**
-   * Concatenate received bytes into one single Uint8Array
+   * The bytes received so far, without a copy
    */
-  #mergeReceivedBytes()
+  #receivedBytes()
   {
-    let offset = 0;
-    const merged = new Uint8Array(this.#receivedLength);
-    for (const chunk of this.#receivedBytes)
-    {
-      merged.set(chunk, offset);
-      offset += chunk.length;
-    }
-    return merged;
+    return this.#body ? new Uint8Array(this.#body, 0, this.#receivedLength) : new Uint8Array(0);
   }
 }
 
@@ -740,3 +779,4 @@ exports.XMLHttpRequestEventTarget = XMLHttpRequestEventTarget;
 exports.XMLHttpRequestUpload = XMLHttpRequestUpload;
 exports.XMLHttpRequest = XMLHttpRequest;
 exports.ProgressEvent = ProgressEvent;
+exports.ResponseBodyStream = ResponseBodyStream;
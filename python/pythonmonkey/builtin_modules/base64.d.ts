@@ -1,6 +1,6 @@
 /**
  * @file    base64.d.ts
- * @brief   TypeScript type declarations for base64.py
+ * @brief   TypeScript type declarations for base64.js
  * @author  Tom Tang <xmader@distributive.network>
  * @date    July 2023
  * 
@@ -20,3 +20,13 @@ export declare function atob(b64: string): string;
  * @see https://html.spec.whatwg.org/multipage/webappapis.html#dom-btoa-dev
  */
 export declare function btoa(data: string): string;
+
+/**
+ * Encode binary data to base64, without going through a binary string
+ */
+export declare function bytesToBase64(bytes: ArrayBuffer | SharedArrayBuffer | ArrayBufferView): string;
+
+/**
+ * Decode base64 to binary data, leniently like `atob`
+ */
+export declare function base64ToBytes(b64: string): Uint8Array;
@@ -0,0 +1,87 @@
+/**
+ * @file     base64.js
+ *           Implement atob/btoa, and base64 helpers for binary data, on the native codec of internalBinding("utils")
+ *
+ * @author   Tom Tang <xmader@distributive.network>, Hamada Gasmallah <hamada@distributive.network>
+ * @date     July 2023
+ *
+ * @copyright Copyright (c) 2023 Distributive Corp.
+ */
+'use strict';
+
+const internalBinding = require('internal-binding');
+const { DOMException } = require('dom-exception');
+
+const {
+  base64EncodeString,
+  base64DecodeString,
+  base64EncodeBytes,
+  base64DecodeBytes,
+} = internalBinding('utils');
+
+/**
+ * Decode base64 string
+ * @param {string} b64 A string containing base64-encoded data.
+ * @see https://html.spec.whatwg.org/multipage/webappapis.html#dom-atob-dev
+ */
+function atob(b64)
+{
+  if (arguments.length === 0)
+    throw new TypeError('atob requires 1 argument');
+  const decoded = base64DecodeString(b64);
+  if (decoded === null)
+    throw new DOMException('The string to be decoded is not correctly encoded.', 'InvalidCharacterError');
+  return decoded;
+}
+
+/**
+ * Create a base64-encoded ASCII string from a binary string
+ * @param {string} data The binary string to encode.
+ * @see https://html.spec.whatwg.org/multipage/webappapis.html#dom-btoa-dev
+ */
+function btoa(data)
+{
+  if (arguments.length === 0)
+    throw new TypeError('btoa requires 1 argument');
+  const encoded = base64EncodeString(data);
+  if (encoded === null)
+    throw new DOMException('The string to be encoded contains characters outside of the Latin1 range.', 'InvalidCharacterError');
+  return encoded;
+}
+
+/**
+ * Encode binary data to base64, without going through a binary string
+ * @param {ArrayBuffer | SharedArrayBuffer | ArrayBufferView} bytes
+ * @returns {string}
+ */
+function bytesToBase64(bytes)
+{
+  let encoded = base64EncodeBytes(bytes);
+  if (encoded === undefined) // e.g. the Uint8Array proxy of a Python bytes object
+    encoded = base64EncodeBytes(Uint8Array.from(bytes));
+  return encoded;
+}
+
+/**
+ * Decode base64 to binary data, leniently like atob
+ * @param {string} b64
+ * @returns {Uint8Array}
+ */
+function base64ToBytes(b64)
+{
+  const decoded = base64DecodeBytes(b64);
+  if (decoded === null)
+    throw new DOMException('The string to be decoded is not correctly encoded.', 'InvalidCharacterError');
+  return decoded;
+}
+
+// Make `atob`/`btoa` globally available
+if (!globalThis.atob)
+  globalThis.atob = atob;
+if (!globalThis.btoa)
+  globalThis.btoa = btoa;
+
+exports.atob = atob;
+exports.btoa = btoa;
+exports.bytesToBase64 = bytesToBase64;
+exports.base64ToBytes = base64ToBytes;
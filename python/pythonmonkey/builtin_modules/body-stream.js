@@ -0,0 +1,231 @@
+/**
+ * @file     body-stream.js
+ *           The streamed bodies of the HTTP responses of fetch() and XMLHttpRequest
+ *
+ * @author   agent <agent@local>
+ * @date     October 2026
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+'use strict';
+
+/**
+ * Resize an ArrayBuffer, in place when the engine can (ArrayBuffer.prototype.transfer reallocates its contents)
+ * @param {ArrayBuffer} buffer
+ * @param {number} byteLength
+ * @returns {ArrayBuffer}
+ */
+function resizeArrayBuffer(buffer, byteLength)
+{
+  if (typeof buffer.transfer === 'function')
+    return buffer.transfer(byteLength);
+  const resized = new ArrayBuffer(byteLength);
+  new Uint8Array(resized).set(new Uint8Array(buffer, 0, Math.min(buffer.byteLength, byteLength)));
+  return resized;
+}
+
+/**
+ * The body of a fetch() Response, or of an XMLHttpRequest whose responseType is "stream": a minimal ReadableStream of Uint8Array chunks.
+ * The chunks are not kept once read. When more than `highWaterMark` bytes are waiting to be read, the
+ * download pauses until the reader catches up, so the memory used stays near the size of a few chunks.
+ */
+class ResponseBodyStream
+{
+  /** The number of queued bytes above which the download pauses */
+  static highWaterMark = 1024 * 1024;
+
+  /** @type {Uint8Array[]} */
+  #queue = [];
+  #queuedBytes = 0;
+  #closed = false;
+  /** @type {Error} */
+  #error = null;
+  #locked = false;
+  /** @type {{ resolve: (result: { value: Uint8Array | undefined, done: boolean }) => void, reject: (error: Error) => void }} */
+  #pendingRead = null;
+  /** @type {{ promise: Promise<void>, resolve: () => void }} */
+  #pendingDrain = null;
+  /** @type {(reason: any) => void} */
+  #onCancel;
+
+  /**
+   * @param {(reason: any) => void} onCancel - aborts the download
+   */
+  constructor(onCancel)
+  {
+    this.#onCancel = onCancel;
+  }
+
+  get locked()
+  {
+    return this.#locked;
+  }
+
+  /**
+   * @returns {{ read: () => Promise<{ value: Uint8Array | undefined, done: boolean }>, cancel: (reason?: any) => Promise<void>, releaseLock: () => void }}
+   */
+  getReader()
+  {
+    if (this.#locked)
+      throw new TypeError('the response stream is already locked to a reader');
+    this.#locked = true;
+    return {
+      read: () => this.#read(),
+      cancel: (reason) => this.cancel(reason),
+      releaseLock: () => (this.#locked = false),
+    };
+  }
+
+  async *[Symbol.asyncIterator]()
+  {
+    const reader = this.getReader();
+    try
+    {
+      for (;;)
+      {
+        const { value, done } = await reader.read();
+        if (done)
+          return;
+        yield value;
+      }
+    }
+    finally
+    {
+      reader.releaseLock();
+    }
+  }
+
+  /**
+   * Drop the queued chunks and abort the download
+   * @param {any} reason
+   */
+  cancel(reason)
+  {
+    if (!this.#closed && !this.#error)
+    {
+      this.#closed = true;
+      this.#queue = [];
+      this.#queuedBytes = 0;
+      this.#settlePendingRead();
+      if (this.#pendingDrain)
+        this.#drained();
+      this.#onCancel(reason);
+    }
+    return Promise.resolve();
+  }
+
+  #read()
+  {
+    if (this.#queue.length)
+    {
+      const value = this.#queue.shift();
+      this.#queuedBytes -= value.length;
+      if (this.#pendingDrain && this.#queuedBytes <= ResponseBodyStream.highWaterMark)
+        this.#drained();
+      return Promise.resolve({ value, done: false });
+    }
+    if (this.#error)
+      return Promise.reject(this.#error);
+    if (this.#closed)
+      return Promise.resolve({ value: undefined, done: true });
+    return new Promise((resolve, reject) => (this.#pendingRead = { resolve, reject }));
+  }
+
+  #drained()
+  {
+    const { resolve } = this.#pendingDrain;
+    this.#pendingDrain = null;
+    resolve();
+  }
+
+  #settlePendingRead()
+  {
+    if (!this.#pendingRead)
+      return;
+    const { resolve, reject } = this.#pendingRead;
+    this.#pendingRead = null;
+    if (this.#error)
+      reject(this.#error);
+    else
+      resolve({ value: undefined, done: true });
+  }
+
+  /**
+   * Called by the HTTP client for each chunk of the body
+   * @param {Uint8Array} chunk
+   * @returns {Promise<void> | undefined} a promise when the download must wait for the reader
+   */
+  _enqueue(chunk)
+  {
+    if (this.#closed || this.#error)
+      return;
+    if (this.#pendingRead)
+    {
+      const { resolve } = this.#pendingRead;
+      this.#pendingRead = null;
+      resolve({ value: chunk, done: false });
+      return;
+    }
+    this.#queue.push(chunk);
+    this.#queuedBytes += chunk.length;
+    if (this.#queuedBytes <= ResponseBodyStream.highWaterMark)
+      return;
+    if (!this.#pendingDrain)
+    {
+      let resolve;
+      const promise = new Promise((resolveDrain) => (resolve = resolveDrain));
+      this.#pendingDrain = { promise, resolve };
+    }
+    return this.#pendingDrain.promise;
+  }
+
+  /**
+   * Called by the HTTP client at the end of the body, the queued chunks can still be read
+   */
+  _close()
+  {
+    this.#closed = true;
+    if (!this.#queue.length)
+      this.#settlePendingRead();
+  }
+
+  /**
+   * Called by the HTTP client when the request fails
+   * @param {Error} error
+   */
+  _error(error)
+  {
+    if (this.#closed && !this.#queue.length)
+      return;
+    this.#error = error;
+    this.#queue = [];
+    this.#queuedBytes = 0;
+    this.#settlePendingRead();
+    if (this.#pendingDrain)
+      this.#drained();
+  }
+}
+
+/**
+ * Read a whole body stream into one ArrayBuffer, copying each chunk once
+ * @param {ResponseBodyStream} stream
+ * @param {number} expectedLength - the Content-Length, 0 if unknown
+ * @returns {Promise<ArrayBuffer>}
+ */
+async function readAllBytes(stream, expectedLength)
+{
+  let buffer = new ArrayBuffer(expectedLength);
+  let length = 0;
+  for await (const chunk of stream)
+  {
+    if (length + chunk.length > buffer.byteLength)
+      buffer = resizeArrayBuffer(buffer, Math.max(length + chunk.length, buffer.byteLength * 2));
+    new Uint8Array(buffer, length, chunk.length).set(chunk);
+    length += chunk.length;
+  }
+  return buffer.byteLength === length ? buffer : resizeArrayBuffer(buffer, length);
+}
+
+exports.ResponseBodyStream = ResponseBodyStream;
+exports.resizeArrayBuffer = resizeArrayBuffer;
+exports.readAllBytes = readAllBytes;
@@ -6,6 +6,9 @@
  * @copyright Copyright (c) 2023 Distributive Corp.
  */
 const { customInspectSymbol, format } = require('util');
+const internalBinding = require('internal-binding');
+
+const { write: writeToSink } = internalBinding('console');
 
 /** @typedef {(str: string) => void} WriteFn */
 /** @typedef {{ write: WriteFn }} IOWriter */
@@ -190,7 +193,9 @@ class Console
    */
   #formatToStr(...args) 
   {
-    const msg = format(...args) + '\n';
+    const msg = (isPlainMessage(args) ? args.join(' ') : format(...args)) + '\n';
+    if (this.#groupLevel === 0)
+      return msg;
     return msg.split('\n').map(s => '│   '.repeat(this.#groupLevel) + s).join('\n');
   }
 
@@ -208,11 +213,36 @@ class Console
   static customInspectSymbol = customInspectSymbol;
 }
 
+/**
+ * Whether `format` would only join the arguments with spaces: a first argument that is a string without format specifiers,
+ * followed by strings and numbers
+ * @param {any[]} args
+ */
+function isPlainMessage(args)
+{
+  if (typeof args[0] !== 'string' || args[0].includes('%'))
+    return false;
+  for (let i = 1; i < args.length; i++)
+  {
+    const type = typeof args[i];
+    if (type !== 'string' && type !== 'number')
+      return false;
+  }
+  return true;
+}
+
+/**
+ * The streams of the global console: the output is buffered natively, and written to `sys.stdout`/`sys.stderr` in batches.
+ * Pass `python.stdout`/`python.stderr` to the `Console` constructor to call the Python streams for each message instead
+ */
+const bufferedStdout = { write: (str) => writeToSink(str, false) };
+const bufferedStderr = { write: (str) => writeToSink(str, true) };
+
 if (!globalThis.console) 
 {
   globalThis.console = new Console(
-    python.stdout /* sys.stdout */,
-    python.stderr /* sys.stderr */
+    bufferedStdout /* sys.stdout */,
+    bufferedStderr /* sys.stderr */
   );
 }
 
@@ -0,0 +1,45 @@
+/**
+ * @file    fetch-internal.d.ts
+ * @brief   TypeScript type declarations for the internal fetch helpers
+ * @author  agent <agent@local>
+ * @date    October 2026
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+/**
+ * `processResponse` callback's argument type
+ */
+export declare interface FetchResponse {
+  /** Response URL, after the redirects */
+  url: string;
+  /** HTTP status */
+  status: number;
+  /** HTTP status message */
+  statusText: string;
+  /** The response headers, as [name, value] pairs */
+  headers: [string, string][];
+  /** Whether the response comes from a redirect */
+  redirected: boolean;
+  /** Cancel the download of the body */
+  abort(): void;
+}
+
+/**
+ * Send a request through the pooled connections
+ */
+export declare function request(
+  method: string,
+  url: string,
+  headers: [string, string][],
+  body: string | Uint8Array | null,
+  redirect: 'follow' | 'manual' | 'error',
+  /** called first with the function cancelling the request */
+  setAbort: (abort: () => void) => void,
+  processResponse: (response: FetchResponse) => void,
+  /** returns a promise when the download must wait for the reader of the body */
+  processBodyChunk: (bytes: Uint8Array) => void | Promise<void>,
+  processEndOfBody: () => void,
+  /** See `pm.bootstrap.require("debug")` */
+  debug: (selector: string) => ((...args: string[]) => void),
+): Promise<void>;
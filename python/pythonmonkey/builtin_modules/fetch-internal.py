@@ -0,0 +1,82 @@
+# @file     fetch-internal.py
+# @brief    internal helper functions for fetch, on top of the pooled sessions of `pythonmonkey.http_pool`
+# @author   agent <agent@local>
+# @date     October 2026
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import asyncio
+import platform
+import yarl
+import pythonmonkey as pm
+from pythonmonkey import http_pool
+from typing import Awaitable, Callable, List, TypedDict, Union
+
+
+class FetchResponse(TypedDict, total=True):
+  """
+  See definitions in `fetch-internal.d.ts`
+  """
+  url: str
+  status: int
+  statusText: str
+  headers: List[List[str]]
+  redirected: bool
+  abort: Callable[[], None]
+
+
+async def request(
+    method: str,
+    url: str,
+    headers: List[List[str]],
+    body: Union[str, memoryview, None],
+    redirect: str,
+    # called first with the function cancelling the request
+    setAbort: Callable[[Callable[[], None]], None],
+    processResponse: Callable[[FetchResponse], None],
+    processBodyChunk: Callable[[bytearray], Union[Awaitable[None], None]],
+    processEndOfBody: Callable[[], None],
+    # the debug logging function, see `pm.bootstrap.require("debug")`
+    debug: Callable[[str], Callable[..., None]],
+    /
+):
+  task = asyncio.current_task()
+  setAbort(lambda: task.cancel())  # type: ignore
+
+  requestHeaders = [(str(name), str(value)) for name, value in headers]
+  if not any(name.lower() == 'user-agent' for name, _ in requestHeaders):
+    requestHeaders.append(('user-agent', f"Python/{platform.python_version()} PythonMonkey/{pm.__version__}"))
+  if isinstance(body, str):
+    data = body.encode('utf-8')
+  elif body is not None:
+    data = bytes(body)
+  else:
+    data = None
+
+  try:
+    debug('fetch:aiohttp')(method, url)
+    async with http_pool.session_for(url).request(method=method,
+                                                  url=yarl.URL(url, encoded=True),
+                                                  headers=requestHeaders,
+                                                  data=data,
+                                                  allow_redirects=redirect == 'follow',
+                                                  ) as res:
+      processResponse({
+          'url': str(res.real_url),
+          'status': res.status,
+          'statusText': str(res.reason or ''),
+          'headers': [[name, value] for name, value in res.headers.items()],
+          'redirected': len(res.history) > 0,
+          'abort': lambda: task.cancel(),  # type: ignore
+      })
+      async for chunk in res.content.iter_any():
+        # a bytearray is shared with JS without a copy
+        backpressure = processBodyChunk(bytearray(chunk))
+        if backpressure is not None:  # the body stream is full, wait for its reader
+          await backpressure
+      processEndOfBody()
+  except asyncio.CancelledError:
+    debug('fetch:io')('aborted', url)
+
+
+# Module exports
+exports['request'] = request  # type: ignore
@@ -0,0 +1,502 @@
+/**
+ * @file     fetch.js
+ *           Implement the fetch API, on the pooled connections of `pythonmonkey.http_pool`
+ *
+ * @author   agent <agent@local>
+ * @date     October 2026
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+'use strict';
+
+const { DOMException } = require('dom-exception');
+const { URL, URLSearchParams } = require('url');
+const { ResponseBodyStream, readAllBytes } = require('body-stream');
+const { TextEncoder, TextDecoder } = require('text-encoding');
+const { request } = require('fetch-internal');
+const debug = globalThis.python.eval('__import__("pythonmonkey").bootstrap.require')('debug');
+
+const FORBIDDEN_REQUEST_METHODS = [
+  'TRACE',
+  'TRACK',
+  'CONNECT'
+];
+
+/** @see https://fetch.spec.whatwg.org/#redirect-status */
+const REDIRECT_STATUSES = [301, 302, 303, 307, 308];
+
+/** passes the state of a network response to the Response constructor */
+const networkResponse = Symbol('networkResponse');
+
+const utf8Encoder = new TextEncoder();
+const utf8Decoder = new TextDecoder();
+
+/**
+ * Normalize a request or response body, and the Content-Type it implies
+ * @param {any} body
+ * @returns {{ body: string | Uint8Array | null, contentType: string | null }}
+ */
+function extractBody(body)
+{
+  if (body === null || body === undefined)
+    return { body: null, contentType: null };
+  if (typeof body === 'string')
+    return { body, contentType: 'text/plain;charset=UTF-8' };
+  if (body instanceof URLSearchParams)
+    return { body: body.toString(), contentType: 'application/x-www-form-urlencoded;charset=UTF-8' };
+  if (body instanceof ArrayBuffer)
+    return { body: new Uint8Array(body), contentType: null };
+  if (ArrayBuffer.isView(body))
+    return { body: new Uint8Array(body.buffer, body.byteOffset, body.byteLength), contentType: null };
+  return { body: String(body), contentType: 'text/plain;charset=UTF-8' };
+}
+
+// exposed
+/**
+ * @see https://fetch.spec.whatwg.org/#headers-class
+ */
+class Headers
+{
+  /** @type {Map<string, string>} lower-cased name -> the values, combined */
+  #entries = new Map();
+
+  /**
+   * @param {Headers | [string, string][] | Record<string, string>} init
+   */
+  constructor(init = undefined)
+  {
+    if (init === undefined || init === null)
+      return;
+    if (init instanceof Headers)
+      init.forEach((value, name) => this.append(name, value));
+    else if (typeof init[Symbol.iterator] === 'function')
+    {
+      for (const pair of init)
+      {
+        if (pair.length !== 2)
+          throw new TypeError('a header must be a [name, value] pair');
+        this.append(pair[0], pair[1]);
+      }
+    }
+    else
+      for (const name of Object.keys(init))
+        this.append(name, init[name]);
+  }
+
+  /**
+   * @param {string} name
+   */
+  static #normalizeName(name)
+  {
+    name = String(name);
+    if (!/^[!#$%&'*+\-.^_`|~0-9A-Za-z]+$/.test(name))
+      throw new TypeError(`invalid header name "${name}"`);
+    return name.toLowerCase();
+  }
+
+  append(name, value)
+  {
+    name = Headers.#normalizeName(name);
+    value = String(value).trim();
+    const current = this.#entries.get(name);
+    this.#entries.set(name, current === undefined ? value : `${current}, ${value}`);
+  }
+
+  delete(name)
+  {
+    this.#entries.delete(Headers.#normalizeName(name));
+  }
+
+  get(name)
+  {
+    return this.#entries.get(Headers.#normalizeName(name)) ?? null;
+  }
+
+  has(name)
+  {
+    return this.#entries.has(Headers.#normalizeName(name));
+  }
+
+  set(name, value)
+  {
+    this.#entries.set(Headers.#normalizeName(name), String(value).trim());
+  }
+
+  forEach(callback, thisArg = undefined)
+  {
+    for (const [name, value] of this.entries())
+      callback.call(thisArg, value, name, this);
+  }
+
+  /** in the lexicographic order of the names, like the spec */
+  *entries()
+  {
+    yield* [...this.#entries].sort(([a], [b]) => (a < b ? -1 : a > b ? 1 : 0));
+  }
+
+  *keys()
+  {
+    for (const [name] of this.entries())
+      yield name;
+  }
+
+  *values()
+  {
+    for (const [, value] of this.entries())
+      yield value;
+  }
+
+  [Symbol.iterator]()
+  {
+    return this.entries();
+  }
+}
+
+// exposed
+/**
+ * @see https://fetch.spec.whatwg.org/#request-class
+ */
+class Request
+{
+  /** @type {string | Uint8Array | null} */
+  #body = null;
+  #bodyUsed = false;
+
+  /**
+   * @param {string | URL | Request} input
+   * @param {{ method?: string, headers?: any, body?: any, redirect?: 'follow' | 'manual' | 'error', signal?: any }} init
+   */
+  constructor(input, init = {})
+  {
+    const base = input instanceof Request ? input : null;
+    /** @readonly */
+    this.url = base ? base.url : new URL(String(input)).href;
+
+    const method = String(init.method ?? base?.method ?? 'GET').toUpperCase();
+    if (FORBIDDEN_REQUEST_METHODS.includes(method))
+      throw new TypeError(`the request method ${method} is not allowed`);
+    /** @readonly */
+    this.method = method;
+    /** @readonly */
+    this.headers = new Headers(init.headers ?? base?.headers);
+
+    const redirect = init.redirect ?? base?.redirect ?? 'follow';
+    if (!['follow', 'manual', 'error'].includes(redirect))
+      throw new TypeError(`invalid redirect mode "${redirect}"`);
+    /** @readonly */
+    this.redirect = redirect;
+    /** @readonly */
+    this.signal = init.signal ?? base?.signal ?? null;
+
+    if (init.body !== undefined && init.body !== null)
+    {
+      if (method === 'GET' || method === 'HEAD')
+        throw new TypeError(`a ${method} request cannot have a body`);
+      const { body, contentType } = extractBody(init.body);
+      this.#body = body;
+      if (contentType && !this.headers.has('content-type'))
+        this.headers.set('content-type', contentType);
+    }
+    else if (base)
+    {
+      if (base.#bodyUsed)
+        throw new TypeError('the body of the request was already used');
+      // the body moves to the new request, see https://fetch.spec.whatwg.org/#dom-request step 41
+      this.#body = base.#body;
+      base.#bodyUsed = base.#body !== null;
+    }
+  }
+
+  get bodyUsed()
+  {
+    return this.#bodyUsed;
+  }
+
+  /**
+   * The body, as sent
+   * @returns {string | Uint8Array | null}
+   */
+  _takeBody()
+  {
+    if (this.#bodyUsed)
+      throw new TypeError('the body of the request was already used');
+    this.#bodyUsed = this.#body !== null;
+    return this.#body;
+  }
+
+  async arrayBuffer()
+  {
+    const body = this._takeBody();
+    const bytes = typeof body === 'string' ? utf8Encoder.encode(body) : (body ?? new Uint8Array(0));
+    return bytes.slice().buffer;
+  }
+
+  async text()
+  {
+    const body = this._takeBody();
+    return typeof body === 'string' ? body : utf8Decoder.decode(body ?? new Uint8Array(0));
+  }
+
+  async json()
+  {
+    return JSON.parse(await this.text());
+  }
+}
+
+// exposed
+/**
+ * @see https://fetch.spec.whatwg.org/#response-class
+ */
+class Response
+{
+  /** @type {ResponseBodyStream | null} */
+  #body = null;
+  #bodyUsed = false;
+  #contentLength = 0;
+  #type = 'default';
+  #url = '';
+  #redirected = false;
+
+  /**
+   * @param {any} body
+   * @param {{ status?: number, statusText?: string, headers?: any }} init
+   */
+  constructor(body = null, init = {})
+  {
+    const status = init.status ?? 200;
+    if (!init[networkResponse] && (status < 200 || status > 599))
+      throw new RangeError(`the status ${status} is not in the range 200 to 599`);
+    /** @readonly */
+    this.status = status;
+    /** @readonly */
+    this.statusText = String(init.statusText ?? '');
+    /** @readonly */
+    this.headers = new Headers(init.headers);
+
+    if (init[networkResponse])
+    {
+      const { stream, url, redirected } = init[networkResponse];
+      this.#body = stream;
+      this.#type = 'basic';
+      this.#url = url;
+      this.#redirected = redirected;
+      this.#contentLength = Number(this.headers.get('content-length')) || 0;
+    }
+    else if (body !== null && body !== undefined)
+    {
+      const extracted = extractBody(body);
+      const bytes = typeof extracted.body === 'string' ? utf8Encoder.encode(extracted.body) : extracted.body;
+      this.#body = new ResponseBodyStream(() => {});
+      this.#body._enqueue(bytes);
+      this.#body._close();
+      this.#contentLength = bytes.length;
+      if (extracted.contentType && !this.headers.has('content-type'))
+        this.headers.set('content-type', extracted.contentType);
+    }
+  }
+
+  static error()
+  {
+    const response = new Response(null, { status: 0, [networkResponse]: { stream: null, url: '', redirected: false } });
+    response.#type = 'error';
+    return response;
+  }
+
+  /**
+   * The filtered response of a redirect in the "manual" redirect mode
+   * @see https://fetch.spec.whatwg.org/#concept-filtered-response-opaque-redirect
+   * @param {string} url - the url of the request
+   */
+  static _opaqueRedirect(url)
+  {
+    const response = new Response(null, { status: 0, [networkResponse]: { stream: null, url, redirected: false } });
+    response.#type = 'opaqueredirect';
+    return response;
+  }
+
+  static json(data, init = {})
+  {
+    const headers = new Headers(init.headers);
+    if (!headers.has('content-type'))
+      headers.set('content-type', 'application/json');
+    return new Response(JSON.stringify(data), { ...init, headers });
+  }
+
+  get type()
+  {
+    return this.#type;
+  }
+
+  get url()
+  {
+    return this.#url;
+  }
+
+  get redirected()
+  {
+    return this.#redirected;
+  }
+
+  get ok()
+  {
+    return this.status >= 200 && this.status <= 299;
+  }
+
+  /**
+   * The body as a stream of Uint8Array chunks, consumed as they arrive, or null
+   * @returns {ResponseBodyStream | null}
+   */
+  get body()
+  {
+    return this.#body;
+  }
+
+  get bodyUsed()
+  {
+    return this.#bodyUsed || (this.#body !== null && this.#body.locked);
+  }
+
+  clone()
+  {
+    throw new DOMException('Response.clone() is not supported, the body is streamed without being kept', 'NotSupportedError');
+  }
+
+  /**
+   * Read the whole body, each chunk is copied once into the returned ArrayBuffer
+   * @returns {Promise<ArrayBuffer>}
+   */
+  async arrayBuffer()
+  {
+    if (this.#body === null)
+      return new ArrayBuffer(0);
+    if (this.bodyUsed)
+      throw new TypeError('the body of the response was already read');
+    this.#bodyUsed = true;
+    return readAllBytes(this.#body, this.#contentLength);
+  }
+
+  async bytes()
+  {
+    return new Uint8Array(await this.arrayBuffer());
+  }
+
+  async text()
+  {
+    return utf8Decoder.decode(await this.arrayBuffer());
+  }
+
+  async json()
+  {
+    return JSON.parse(await this.text());
+  }
+}
+
+/**
+ * @param {any} signal
+ */
+function abortReason(signal)
+{
+  return signal.reason ?? new DOMException('The operation was aborted.', 'AbortError');
+}
+
+// exposed
+/**
+ * Send a request, resolving to its Response once the headers are received; the body is then streamed
+ * @see https://fetch.spec.whatwg.org/#fetch-method
+ * @param {string | URL | Request} input
+ * @param {ConstructorParameters<typeof Request>[1]} init
+ * @returns {Promise<Response>}
+ */
+function fetch(input, init = undefined)
+{
+  return new Promise((resolve, reject) =>
+  {
+    const req = input instanceof Request && init === undefined ? input : new Request(input, init);
+    const signal = req.signal;
+    if (signal?.aborted)
+      return reject(abortReason(signal));
+
+    const connectionId = Math.random().toString(16).slice(2, 9);
+    const fetchDebug = (selector) => (...args) => debug(selector)(`Fetch<${connectionId}>:`, ...args);
+
+    /** @type {() => void} */
+    let abortRequest = null;
+    /** @type {ResponseBodyStream} */
+    let stream = null;
+    const onAbort = () =>
+    {
+      const reason = abortReason(signal);
+      if (stream)
+        stream._error(reason);
+      else
+        reject(reason);
+      if (abortRequest)
+        abortRequest();
+    };
+    signal?.addEventListener?.('abort', onAbort);
+    const cleanup = () => signal?.removeEventListener?.('abort', onAbort);
+
+    const processResponse = (response) =>
+    {
+      fetchDebug('fetch:response')(`status ${response.status}`);
+      if (req.redirect === 'error' && response.status >= 300 && response.status < 400)
+      {
+        response.abort();
+        return reject(new TypeError(`fetch failed: ${req.url} redirected while the redirect mode is "error"`));
+      }
+      if (req.redirect === 'manual' && REDIRECT_STATUSES.includes(response.status))
+      {
+        response.abort();
+        return resolve(Response._opaqueRedirect(req.url));
+      }
+      stream = new ResponseBodyStream(() => response.abort());
+      resolve(new Response(null, {
+        status: response.status,
+        statusText: response.statusText,
+        headers: response.headers,
+        [networkResponse]: { stream, url: response.url, redirected: response.redirected },
+      }));
+    };
+
+    request(
+      req.method,
+      req.url,
+      [...req.headers],
+      req._takeBody(),
+      req.redirect,
+      (abort) => (abortRequest = abort),
+      processResponse,
+      (bytes) => stream?._enqueue(bytes),
+      () => stream?._close(),
+      fetchDebug,
+    ).then(() =>
+    {
+      cleanup();
+      if (!stream)
+        reject(signal?.aborted ? abortReason(signal) : new TypeError(`fetch failed: ${req.url}`));
+    }, (error) =>
+    {
+      cleanup();
+      const failure = new TypeError(`fetch failed: ${error?.message ?? error}`);
+      if (stream)
+        stream._error(failure);
+      else
+        reject(failure);
+    });
+  });
+}
+
+/* A side-effect of loading this module is to add fetch and related symbols to the global object */
+if (!globalThis.fetch)
+  globalThis.fetch = fetch;
+if (!globalThis.Headers)
+  globalThis.Headers = Headers;
+if (!globalThis.Request)
+  globalThis.Request = Request;
+if (!globalThis.Response)
+  globalThis.Response = Response;
+
+exports.fetch = fetch;
+exports.Headers = Headers;
+exports.Request = Request;
+exports.Response = Response;
@@ -30,6 +30,36 @@ declare function internalBinding(namespace: "utils"): {
    * @return `undefined` if it's not a proxy
    */
   getProxyDetails<T extends object>(proxy: T): undefined | [target: T, handler: ProxyHandler<T>];
+
+  /**
+   * `btoa` on the native chars of a string
+   * @return `null` if a character is above U+00FF
+   */
+  base64EncodeString(data: string): string | null;
+
+  /**
+   * `atob`, the forgiving-base64 decode of the HTML spec
+   * @return `null` if the string is not valid base64
+   */
+  base64DecodeString(b64: string): string | null;
+
+  /**
+   * Encode the bytes of a buffer
+   * @return `undefined` if the argument is not an ArrayBuffer, SharedArrayBuffer or ArrayBuffer view
+   */
+  base64EncodeBytes(bytes: any): string | undefined;
+
+  /**
+   * Decode base64 leniently like `atob`
+   * @return `null` if the string is not valid base64
+   */
+  base64DecodeBytes(b64: string): Uint8Array | null;
+
+  /**
+   * The structured clone of a value, the ArrayBuffers of `transfer` detached and moved to the clone
+   * @throws DOMException named DataCloneError if the value cannot be cloned
+   */
+  structuredClone<T>(value: T, transfer: ArrayBuffer[] | undefined): T;
 };
 
 declare type TimerDebugInfo = object;
@@ -76,4 +106,107 @@ declare function internalBinding(namespace: "timers"): {
   getAllRefedTimersDebugInfo(): TimerDebugInfo[];
 };
 
+declare type Histogram = {
+  count: number;
+  totalUs: number;
+  maxUs: number;
+  /** bucket `i` counts the durations below 2**i microseconds, the last one everything above */
+  buckets: number[];
+};
+
+declare type Stats = {
+  jobs: { enqueued: number; run: number; drains: number; wait: Histogram; duration: Histogram; };
+  timers: { scheduled: number; fired: number; cancelled: number; lateness: Histogram; };
+  dispatchables: { queued: number; run: number; };
+  scripts: { compiled: number; memoryHits: number; diskHits: number; stored: number; };
+  bridges: { promisesAwaitedByFutures: number; awaitablesAwaitedByPromises: number; };
+  pendingEventLoopJobs: number;
+};
+
+declare function internalBinding(namespace: "metrics"): {
+  /**
+   * Get the counters and latency histograms of the event-loop and job queue bridge, same as `pythonmonkey.stats()` in Python
+   * @param reset zero the counters and histograms after reading them
+   */
+  getStats(reset?: boolean): Stats;
+};
+
+declare function internalBinding(namespace: "fs"): {
+  /**
+   * The mode of a file, or false if it does not exist.
+   * The results are cached for the paths inside node_modules directories, see `clearStatCache`
+   */
+  statSync(filename: string): { mode: number } | false;
+  existsSync(filename: string): boolean;
+  /**
+   * Read a text file like Python's `open(filename, "r", encoding=charset).read()`: decoded from `charset` (UTF-8 by default), with universal newlines
+   */
+  readFileSync(filename: string, charset?: string): string;
+  /**
+   * Forget the cached results of `statSync` and `existsSync`, and the cached resolutions, e.g. after installing packages while the process runs
+   */
+  clearStatCache(): void;
+  /**
+   * The path that `require(specifier)` resolved to from a module of `baseDirectory` with the `searchPaths` (`require.path`,
+   * joined), if it is cached and still a file
+   */
+  getResolution(baseDirectory: string, specifier: string, searchPaths?: string): string | undefined;
+  /**
+   * Remember the path that `require(specifier)` resolves to from a module of `baseDirectory`; only absolute paths are cached
+   */
+  setResolution(baseDirectory: string, specifier: string, resolved: string, searchPaths?: string): void;
+  /**
+   * List the node_modules directories that the modules of a directory can require from, with their packages
+   * @return the number of directories listed
+   */
+  prewarm(directory: string): number;
+  /**
+   * Save the cache to the file set with `pythonmonkey.setRequireCache` or PYTHONMONKEY_REQUIRE_CACHE, if it changed
+   * @return false if the file could not be written
+   */
+  saveCache(): boolean;
+};
+
+declare function internalBinding(namespace: "encoding"): {
+  /**
+   * The UTF-8 bytes of a string, lone surrogates replaced by U+FFFD
+   */
+  encodeUtf8(input: string): Uint8Array;
+
+  /**
+   * Encode as much of a string as fits whole into a buffer
+   * @return `undefined` if the destination is not a Uint8Array
+   */
+  encodeUtf8Into(source: string, destination: Uint8Array): { read: number; written: number } | undefined;
+
+  /**
+   * Decode UTF-8, invalid sequences replaced by U+FFFD, a BOM kept
+   * @return `null` if it is invalid and `fatal` is true, `undefined` if the argument is not an ArrayBuffer, SharedArrayBuffer or ArrayBuffer view
+   */
+  decodeUtf8(bytes: ArrayBuffer | SharedArrayBuffer | ArrayBufferView, fatal: boolean): string | null | undefined;
+};
+
+declare function internalBinding(namespace: "console"): {
+  /**
+   * Write the output of the global console: buffered for stdout, and flushed in batches to `sys.stdout`;
+   * written right away for stderr, after flushing stdout
+   */
+  write(str: string, toStderr: boolean): void;
+
+  /**
+   * Write the buffered stdout output out now
+   */
+  flush(): void;
+};
+
+declare function internalBinding(namespace: "url"): {
+  /**
+   * Create the native URL and URLSearchParams classes, a new pair on each call
+   */
+  createClasses(): {
+    URL: typeof import("url").URL;
+    URLSearchParams: typeof import("url").URLSearchParams;
+  };
+};
+
 export = internalBinding;
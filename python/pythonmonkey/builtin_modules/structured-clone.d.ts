@@ -0,0 +1,15 @@
+/**
+ * @file    structured-clone.d.ts
+ * @brief   TypeScript type declarations for structured-clone.js
+ * @author  agent, agent@local
+ * @date    October 2026
+ * 
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+/**
+ * Deep-copy a value with the structured clone algorithm
+ * @param options the ArrayBuffers of `transfer` are moved to the clone and detached
+ * @see https://html.spec.whatwg.org/multipage/structured-data.html#dom-structuredclone
+ */
+export declare function structuredClone<T>(value: T, options?: { transfer?: Iterable<ArrayBuffer> }): T;
@@ -0,0 +1,33 @@
+/**
+ * @file     structured-clone.js
+ *           Implement the structuredClone global on the native structured clone algorithm of SpiderMonkey
+ *
+ * @author   agent, agent@local
+ * @date     October 2026
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+'use strict';
+
+const internalBinding = require('internal-binding');
+
+const { structuredClone: cloneValue } = internalBinding('utils');
+
+/**
+ * Deep-copy a value with the structured clone algorithm, the one of `postMessage`
+ * @param {any} value
+ * @param {{ transfer?: Iterable<ArrayBuffer> }} options the ArrayBuffers of `transfer` are moved to the clone, without copy, and detached
+ * @see https://html.spec.whatwg.org/multipage/structured-data.html#dom-structuredclone
+ */
+function structuredClone(value, options = undefined)
+{
+  if (arguments.length === 0)
+    throw new TypeError('structuredClone requires 1 argument');
+  const transfer = options?.transfer;
+  return cloneValue(value, transfer === undefined ? undefined : Array.from(transfer));
+}
+
+if (!globalThis.structuredClone)
+  globalThis.structuredClone = structuredClone;
+
+exports.structuredClone = structuredClone;
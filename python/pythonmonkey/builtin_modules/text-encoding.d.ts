@@ -0,0 +1,37 @@
+/**
+ * @file    text-encoding.d.ts
+ * @brief   TypeScript type declarations for text-encoding.js
+ * @author  agent, agent@local
+ * @date    October 2026
+ * 
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+/**
+ * Encode strings to UTF-8
+ * @see https://encoding.spec.whatwg.org/#interface-textencoder
+ */
+export declare class TextEncoder {
+  readonly encoding: 'utf-8';
+  encode(input?: string): Uint8Array;
+  /**
+   * Encode as much of `source` as fits whole into `destination`
+   * @return the UTF-16 code units read and the bytes written
+   */
+  encodeInto(source: string, destination: Uint8Array): { read: number; written: number };
+}
+
+/**
+ * Decode UTF-8, the only encoding supported
+ * @see https://encoding.spec.whatwg.org/#interface-textdecoder
+ */
+export declare class TextDecoder {
+  constructor(label?: string, options?: { fatal?: boolean; ignoreBOM?: boolean });
+  readonly encoding: 'utf-8';
+  readonly fatal: boolean;
+  readonly ignoreBOM: boolean;
+  /**
+   * @param options with `stream`, an incomplete sequence at the end of `input` is kept for the next call
+   */
+  decode(input?: ArrayBuffer | SharedArrayBuffer | ArrayBufferView, options?: { stream?: boolean }): string;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file     text-encoding.js
+ *           Implement the TextEncoder and TextDecoder of the WHATWG Encoding Standard, for UTF-8, on the native codec of internalBinding("encoding")
+ *
+ * @author   agent, agent@local
+ * @date     October 2026
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+'use strict';
+
+const internalBinding = require('internal-binding');
+
+const {
+  encodeUtf8,
+  encodeUtf8Into,
+  decodeUtf8,
+} = internalBinding('encoding');
+
+const utf8Labels = ['unicode-1-1-utf-8', 'unicode11utf8', 'unicode20utf8', 'utf-8', 'utf8', 'x-unicode20utf8'];
+
+/**
+ * The number of bytes of the UTF-8 sequence starting with `lead`, or 0 if it is not a lead byte
+ * @param {number} lead
+ */
+function sequenceLength(lead)
+{
+  if (lead >= 0xC2 && lead <= 0xDF)
+    return 2;
+  if (lead >= 0xE0 && lead <= 0xEF)
+    return 3;
+  if (lead >= 0xF0 && lead <= 0xF4)
+    return 4;
+  return 0;
+}
+
+/**
+ * Whether `byte` validly follows the bytes of a sequence starting with `lead`, `index` being its position in the sequence
+ * @see https://encoding.spec.whatwg.org/#utf-8-decoder
+ */
+function continuesSequence(lead, index, byte)
+{
+  if (index === 1)
+  {
+    if (lead === 0xE0)
+      return byte >= 0xA0 && byte <= 0xBF;
+    if (lead === 0xED)
+      return byte >= 0x80 && byte <= 0x9F;
+    if (lead === 0xF0)
+      return byte >= 0x90 && byte <= 0xBF;
+    if (lead === 0xF4)
+      return byte >= 0x80 && byte <= 0x8F;
+  }
+  return byte >= 0x80 && byte <= 0xBF;
+}
+
+/**
+ * The number of bytes at the end of `bytes` that start a valid sequence but do not complete it
+ * @param {Uint8Array} bytes
+ */
+function incompleteTailLength(bytes)
+{
+  const end = bytes.length;
+  for (let start = end - 1; start >= 0 && start >= end - 3; start--)
+  {
+    const length = sequenceLength(bytes[start]);
+    if (length === 0)
+    {
+      if (bytes[start] >= 0x80 && bytes[start] <= 0xBF)
+        continue; // a continuation byte, look for its lead
+      return 0;
+    }
+    if (end - start >= length)
+      return 0; // complete, or invalid: decoded now
+    for (let i = start + 1; i < end; i++)
+      if (!continuesSequence(bytes[start], i - start, bytes[i]))
+        return 0;
+    return end - start;
+  }
+  return 0;
+}
+
+/**
+ * View any BufferSource as a Uint8Array, copying only the values that are not buffers, e.g. the proxies of Python bytes
+ * @param {ArrayBuffer | SharedArrayBuffer | ArrayBufferView} input
+ * @returns {Uint8Array}
+ */
+function toUint8Array(input)
+{
+  if (input instanceof Uint8Array)
+    return input;
+  if (ArrayBuffer.isView(input))
+    return new Uint8Array(input.buffer, input.byteOffset, input.byteLength);
+  if (input instanceof ArrayBuffer || (typeof SharedArrayBuffer !== 'undefined' && input instanceof SharedArrayBuffer))
+    return new Uint8Array(input);
+  if (input && typeof input === 'object' && typeof input.length === 'number')
+    return Uint8Array.from(input);
+  throw new TypeError('The "input" argument must be an ArrayBuffer or an ArrayBufferView');
+}
+
+/**
+ * @see https://encoding.spec.whatwg.org/#interface-textencoder
+ */
+class TextEncoder
+{
+  get encoding()
+  {
+    return 'utf-8';
+  }
+
+  /**
+   * @param {string} input
+   * @returns {Uint8Array}
+   */
+  encode(input = '')
+  {
+    return encodeUtf8(input);
+  }
+
+  /**
+   * Encode as much of `source` as fits whole into `destination`
+   * @param {string} source
+   * @param {Uint8Array} destination
+   * @returns {{ read: number, written: number }} the UTF-16 code units read and the bytes written
+   */
+  encodeInto(source, destination)
+  {
+    const result = encodeUtf8Into(source, destination);
+    if (result === undefined)
+      throw new TypeError('The "destination" argument must be a Uint8Array');
+    return result;
+  }
+
+  get [Symbol.toStringTag]()
+  {
+    return 'TextEncoder';
+  }
+}
+
+/**
+ * @see https://encoding.spec.whatwg.org/#interface-textdecoder
+ */
+class TextDecoder
+{
+  #fatal;
+  #ignoreBOM;
+  /** the bytes of an incomplete sequence at the end of the last chunk of a stream */
+  #pending = null;
+  /** no text was output since the start of the stream, a BOM is still to be stripped */
+  #atStart = true;
+
+  /**
+   * @param {string} label only the labels of UTF-8 are supported
+   * @param {{ fatal?: boolean, ignoreBOM?: boolean }} options
+   */
+  constructor(label = 'utf-8', options = {})
+  {
+    const normalized = String(label).trim().toLowerCase();
+    if (!utf8Labels.includes(normalized))
+      throw new RangeError(`The "${label}" encoding is not supported`);
+    this.#fatal = Boolean(options?.fatal);
+    this.#ignoreBOM = Boolean(options?.ignoreBOM);
+  }
+
+  get encoding()
+  {
+    return 'utf-8';
+  }
+
+  get fatal()
+  {
+    return this.#fatal;
+  }
+
+  get ignoreBOM()
+  {
+    return this.#ignoreBOM;
+  }
+
+  /**
+   * @param {ArrayBuffer | SharedArrayBuffer | ArrayBufferView} input
+   * @param {{ stream?: boolean }} options with `stream`, an incomplete sequence at the end of `input` is kept for the next call
+   * @returns {string}
+   */
+  decode(input = undefined, options = {})
+  {
+    const stream = Boolean(options?.stream);
+    let bytes = input === undefined ? new Uint8Array(0) : toUint8Array(input);
+    let prefix = '';
+
+    if (this.#pending)
+      [prefix, bytes] = this.#completePending(bytes, stream);
+
+    let incomplete = false;
+    if (!this.#pending)
+    {
+      const tailLength = incompleteTailLength(bytes);
+      if (tailLength > 0)
+      {
+        if (stream)
+          this.#pending = bytes.slice(bytes.length - tailLength);
+        else
+          incomplete = true; // the stream ended in the middle of a sequence, a single U+FFFD
+        bytes = bytes.subarray(0, bytes.length - tailLength);
+      }
+    }
+    let text = bytes.length > 0 ? this.#decodeComplete(bytes) : '';
+    if (incomplete)
+      text += this.#replacement();
+    return this.#stripBOM(prefix + text, stream);
+  }
+
+  /**
+   * Complete the pending sequence with the first bytes of `bytes`
+   * @returns {[string, Uint8Array]} the decoded sequence, and the bytes after it
+   */
+  #completePending(bytes, stream)
+  {
+    const pending = this.#pending;
+    const length = sequenceLength(pending[0]);
+    let taken = 0;
+    while (pending.length + taken < length && taken < bytes.length && continuesSequence(pending[0], pending.length + taken, bytes[taken]))
+      taken++;
+
+    if (pending.length + taken === length)
+    {
+      const sequence = new Uint8Array(length);
+      sequence.set(pending);
+      sequence.set(bytes.subarray(0, taken), pending.length);
+      this.#pending = null;
+      return [this.#decodeComplete(sequence), bytes.subarray(taken)];
+    }
+    if (taken === bytes.length && stream) // still incomplete
+    {
+      const longer = new Uint8Array(pending.length + taken);
+      longer.set(pending);
+      longer.set(bytes, pending.length);
+      this.#pending = longer;
+      return ['', bytes.subarray(taken)];
+    }
+    // invalid, or the end of the stream: the bytes of the sequence become a single U+FFFD, the next one is decoded again
+    this.#pending = null;
+    return [this.#replacement(), bytes.subarray(taken)];
+  }
+
+  #decodeComplete(bytes)
+  {
+    const text = decodeUtf8(bytes, this.#fatal);
+    if (text === null)
+      this.#throwInvalid();
+    return text;
+  }
+
+  #replacement()
+  {
+    if (this.#fatal)
+      this.#throwInvalid();
+    return '\uFFFD';
+  }
+
+  #throwInvalid()
+  {
+    this.#pending = null;
+    this.#atStart = true;
+    throw new TypeError('The encoded data was not valid for encoding utf-8');
+  }
+
+  #stripBOM(text, stream)
+  {
+    if (this.#atStart && text.length > 0)
+    {
+      this.#atStart = false;
+      if (!this.#ignoreBOM && text.charCodeAt(0) === 0xFEFF)
+        text = text.slice(1);
+    }
+    if (!stream)
+      this.#atStart = true;
+    return text;
+  }
+
+  get [Symbol.toStringTag]()
+  {
+    return 'TextDecoder';
+  }
+}
+
+if (!globalThis.TextEncoder)
+  globalThis.TextEncoder = TextEncoder;
+if (!globalThis.TextDecoder)
+  globalThis.TextDecoder = TextDecoder;
+
+exports.TextEncoder = TextEncoder;
+exports.TextDecoder = TextDecoder;
@@ -51,10 +51,10 @@ export declare var URL: {
   new(url: string | URL, base?: string | URL): URL;
   /** [MDN Reference](https://developer.mozilla.org/docs/Web/API/URL/canParse_static) */
   canParse(url: string | URL, base?: string): boolean;
-  /** [MDN Reference](https://developer.mozilla.org/docs/Web/API/URL/createObjectURL_static) @deprecated not implemented by polyfill */
+  /** [MDN Reference](https://developer.mozilla.org/docs/Web/API/URL/createObjectURL_static) @deprecated not implemented */
   // @ts-expect-error types not defined
   createObjectURL(obj: Blob | MediaSource): string;
-  /** [MDN Reference](https://developer.mozilla.org/docs/Web/API/URL/revokeObjectURL_static) @deprecated not implemented by polyfill */
+  /** [MDN Reference](https://developer.mozilla.org/docs/Web/API/URL/revokeObjectURL_static) @deprecated not implemented */
   revokeObjectURL(url: string): void;
 };
 
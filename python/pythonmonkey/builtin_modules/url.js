@@ -1,17 +1,22 @@
 /**
  * @file     url.js
- *           Polyfill the URL and URLSearchParams interfaces 
+ *           Implement the URL and URLSearchParams interfaces of the WHATWG URL Standard, on the native classes of internalBinding("url")
  *
  * @author   Tom Tang <xmader@distributive.network>
  * @date     August 2023
  * 
  * @copyright Copyright (c) 2023 Distributive Corp.
  */
+'use strict';
 
-// Apply polyfills from core-js
-require('./dom-exception');
-require('core-js/actual/url');
-require('core-js/actual/url-search-params');
+const internalBinding = require('internal-binding');
 
-exports.URL = globalThis.URL;
-exports.URLSearchParams = globalThis.URLSearchParams;
+const { URL, URLSearchParams } = internalBinding('url').createClasses();
+
+if (!globalThis.URL)
+  globalThis.URL = URL;
+if (!globalThis.URLSearchParams)
+  globalThis.URLSearchParams = URLSearchParams;
+
+exports.URL = URL;
+exports.URLSearchParams = URLSearchParams;
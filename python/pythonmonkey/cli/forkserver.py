@@ -0,0 +1,170 @@
+#! /usr/bin/env python3
+# @file         forkserver - the fork server of pmjs, and its client
+# @author       agent, agent@local
+# @date         October 2026
+# @copyright Copyright (c) 2026 Distributive Corp.
+#
+# `pmjs --fork-server=SOCKET [-r module]... [script.js]` loads PythonMonkey, the preloaded modules and the script once,
+# then forks a process for each connection to the Unix socket, which starts with everything already loaded and shares
+# the pages of the server copy-on-write. The client only needs the Python standard library, run this file directly:
+#
+#   python3 .../pythonmonkey/cli/forkserver.py SOCKET script.js [arguments]
+#
+# The client sends its arguments, current directory and standard streams to the server, and exits with the code of the
+# forked process. The protocol is one JSON line {"argv": [...], "cwd": "..."} sent along with the file descriptors 0, 1 and 2,
+# the server answers with the exit code as a decimal line once the process exits, or with its negated signal number.
+#
+# Anyone who can connect to the socket runs programs as the user of the server, so it is created readable and writable
+# by that user only. Forking relies on the `os.register_at_fork` handlers that PythonMonkey installs when it is imported:
+# before every `os.fork()` in the process, not only the ones made here, they finish an incremental GC in progress and stop
+# the SpiderMonkey helper threads, the watchdog and the job queue dispatcher, which are started again in both processes.
+
+import sys
+import os
+import json
+import signal
+import socket
+import stat
+
+_maxRequestSize = 1 << 20
+
+
+def connect(path, argv):
+  """
+  Run a program in a process forked by the server listening on `path`, with our standard streams, and return its exit code
+  """
+  with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+    sock.connect(path)
+    request = json.dumps({'argv': argv, 'cwd': os.getcwd()}).encode('utf-8') + b'\n'
+    socket.send_fds(sock, [request], [0, 1, 2])
+    sock.shutdown(socket.SHUT_WR)
+    answer = b''
+    while True:
+      chunk = sock.recv(64)
+      if not chunk:
+        break
+      answer += chunk
+  try:
+    code = int(answer)
+  except ValueError:
+    print("pmjs: the fork server closed the connection", file=sys.stderr)
+    return 1
+  return 128 - code if code < 0 else code  # like a shell reports the processes killed by a signal
+
+
+def _receive(conn):
+  """
+  Read the request of a client, return its arguments, directory and file descriptors
+  """
+  data, fds, _flags, _addr = socket.recv_fds(conn, _maxRequestSize, 3)
+  while not data.endswith(b'\n'):
+    chunk = conn.recv(_maxRequestSize)
+    if not chunk:
+      break
+    data += chunk
+  request = json.loads(data)
+  if len(fds) != 3:
+    raise ValueError("the client did not send its standard streams")
+  return request['argv'], request['cwd'], fds
+
+
+def listen(path):
+  """
+  Create the Unix socket `path` of a server, only accessible by the current user. A socket left by a previous server is
+  replaced, any other file at `path` raises FileExistsError
+  """
+  try:
+    if not stat.S_ISSOCK(os.lstat(path).st_mode):
+      raise FileExistsError("pmjs: %s exists and is not a socket" % path)
+    os.unlink(path)  # left by a previous server
+  except FileNotFoundError:
+    pass
+  listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  umask = os.umask(0o077)  # no window where others could connect before the chmod
+  try:
+    listener.bind(path)
+  except OSError:
+    listener.close()
+    raise
+  finally:
+    os.umask(umask)
+  os.chmod(path, 0o600)
+  listener.listen(128)
+  return listener
+
+
+def serve(path):
+  """
+  Accept the connections to the Unix socket `path` forever, forking a process for each. This returns in the forked processes only,
+  with the arguments of the client, once their standard streams and directory are the ones of the client.
+
+  The runtime must already be warmed up, `pythonmonkey.prefork()` is called here once before the first fork.
+  """
+  import pythonmonkey as pm
+
+  listener = listen(path)
+  pm.prefork()
+
+  children = {}  # pid -> connection, the exit code is written to it
+
+  def reap(signum, frame):
+    while children:
+      try:
+        pid, status = os.waitpid(-1, os.WNOHANG)
+      except ChildProcessError:
+        return
+      if pid == 0:
+        return
+      conn = children.pop(pid, None)
+      if conn is None:
+        continue
+      try:
+        conn.sendall(b'%d\n' % os.waitstatus_to_exitcode(status))
+      except OSError:
+        pass  # the client went away
+      conn.close()
+  signal.signal(signal.SIGCHLD, reap)
+
+  while True:
+    conn, _addr = listener.accept()  # PEP 475, retried after reap runs
+    try:
+      argv, cwd, fds = _receive(conn)
+    except (OSError, ValueError, KeyError) as error:
+      print("pmjs: bad fork server request:", error, file=sys.stderr)
+      conn.close()
+      continue
+
+    sys.stdout.flush()
+    sys.stderr.flush()
+    signal.pthread_sigmask(signal.SIG_BLOCK, [signal.SIGCHLD])  # the child must be in `children` before it is reaped
+    pid = -1
+    try:
+      pid = os.fork()
+      if pid == 0:
+        signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+        signal.pthread_sigmask(signal.SIG_UNBLOCK, [signal.SIGCHLD])
+        listener.close()
+        conn.close()
+        for other in children.values():
+          other.close()
+        for target, fd in enumerate(fds):
+          os.dup2(fd, target)
+          os.close(fd)
+        os.chdir(cwd)
+        return argv
+      children[pid] = conn
+    except OSError as error:
+      print("pmjs: could not fork:", error, file=sys.stderr)
+      conn.close()
+    finally:
+      if pid != 0:
+        signal.pthread_sigmask(signal.SIG_UNBLOCK, [signal.SIGCHLD])
+    for fd in fds:
+      os.close(fd)
+
+
+if __name__ == "__main__":
+  if len(sys.argv) < 3:
+    print("Usage: forkserver.py SOCKET script.js [arguments]", file=sys.stderr)
+    sys.exit(2)
+  sys.exit(connect(sys.argv[1], sys.argv[2:]))
@@ -6,12 +6,15 @@
 
 import sys
 import os
+import atexit
+import time
 import signal
 import getopt
 import readline
 import asyncio
 import pythonmonkey as pm
 from pythonmonkey.lib import pmdb, wtfpm
+from pythonmonkey.cli import forkserver
 
 globalThis = pm.eval("globalThis")
 evalOpts = {'filename': __file__, 'fromPythonFrame': True, 'strict': False}  # type: pm.EvalOptions
@@ -297,11 +300,23 @@ Options:
   --use-strict         evaluate -e, -p, and REPL code in strict mode
   --inspect            enable pmdb, a gdb-like JavaScript debugger interface
   --wtf                enable WTFPythonMonkey, a tool that can detect hanging timers when Ctrl-C is hit
+  --require-cache=...  file of the cache of the module lookups, loaded now and saved at exit
+  --cpu-prof           write a CPU profile of the JS code at exit, in the .cpuprofile format
+  --cpu-prof-dir=...   directory of the CPU profile, the current directory by default
+  --cpu-prof-name=...  file name of the CPU profile, CPU.<date>.<time>.<pid>.0.001.cpuprofile by default
+  --cpu-prof-interval=...
+                       sampling interval of the CPU profile in microseconds, 1000 by default
+  --prewarm-require-cache
+                       list the node_modules directories of the script (or of the current directory) into the
+                       module lookup cache and save it; exits unless a script is given
+  --fork-server=...    load the -r modules and compile the script once, then fork a process running the script for each
+                       connection to this Unix socket, see pythonmonkey/cli/forkserver.py for the client
 
 Environment variables:
 TZ                            specify the timezone configuration
 PMJS_PATH                     ':'-separated list of directories prefixed to the module search path
-PMJS_REPL_HISTORY             path to the persistent REPL history file"""
+PMJS_REPL_HISTORY             path to the persistent REPL history file
+PYTHONMONKEY_REQUIRE_CACHE    default file of the module lookup cache, see --require-cache"""
         )
 
 
@@ -323,6 +338,33 @@ def initGlobalThis():
   return globalInitModule
 
 
+def prewarm(directory):
+  """
+  List the node_modules directories that the modules of the directory and of the module search path can require from,
+  so that resolving modules answers from the listings instead of probing the file system, and save the cache if it has a file
+  """
+  fs = pm.internalBinding('fs')
+  for d in [directory] + (requirePath or []):
+    fs.prewarm(d)
+  if not fs.saveCache():
+    print("pmjs: could not save the module lookup cache", file=sys.stderr)
+
+
+def startCpuProfile(opts):
+  """
+  Start the profiler for --cpu-prof, and write the profile at exit, like `node --cpu-prof` does
+  """
+  options = dict(opts)
+  if "--cpu-prof" not in options:
+    return
+  interval = float(options.get("--cpu-prof-interval", 1000)) / 1e6
+  name = options.get("--cpu-prof-name") or time.strftime("CPU.%Y%m%d.%H%M%S.") + str(os.getpid()) + ".0.001.cpuprofile"
+  directory = options.get("--cpu-prof-dir", os.getcwd())
+  os.makedirs(directory, exist_ok=True)
+  pm.profiler.start(interval)
+  atexit.register(pm.profiler.stop, os.path.join(directory, name))
+
+
 def main():
   """
   Main program entry point
@@ -334,15 +376,21 @@ def main():
 
   try:
     opts, args = getopt.getopt(sys.argv[1:], "hie:p:r:v", ["help", "eval=", "print=",
-                               "require=", "version", "interactive", "use-strict", "inspect", "wtf"])
+                               "require=", "version", "interactive", "use-strict", "inspect", "wtf",
+                               "require-cache=", "prewarm-require-cache", "fork-server=",
+                               "cpu-prof", "cpu-prof-dir=", "cpu-prof-name=", "cpu-prof-interval="])
   except getopt.GetoptError as err:
     # print help information and exit:
     print(err)  # will print something like "option -a not recognized"
     usage()
     sys.exit(2)
+  startCpuProfile(opts)
   output = None
   verbose = False
   enableWTF = False
+  prewarmRequireCache = False
+  requireCacheFile = os.environ.get('PYTHONMONKEY_REQUIRE_CACHE')
+  forkServer = None
   for o, a in opts:
     if o in ("-v", "--version"):
       print(pm.__version__)
@@ -373,9 +421,39 @@ def main():
       pmdb.enable()
     elif o in ("--wtf"):
       enableWTF = True
+    elif o == "--require-cache":
+      pm.setRequireCache(a)
+      requireCacheFile = a
+    elif o == "--prewarm-require-cache":
+      prewarmRequireCache = True
+    elif o == "--fork-server":
+      forkServer = a
+    elif o.startswith("--cpu-prof"):
+      pass  # see startCpuProfile
     else:
       assert False, "unhandled option"
 
+  if prewarmRequireCache:
+    if not requireCacheFile:
+      print("pmjs: --prewarm-require-cache needs a cache file, see --require-cache or PYTHONMONKEY_REQUIRE_CACHE", file=sys.stderr)
+      sys.exit(2)
+    prewarm(os.path.dirname(os.path.abspath(args[0])) if len(args) > 0 else os.getcwd())
+    if len(args) == 0:
+      sys.exit()
+
+  script = None
+  if forkServer:
+    scriptFilename = os.path.abspath(args[0]) if len(args) > 0 else None
+    if scriptFilename:
+      with open(scriptFilename, encoding="utf-8", mode="r") as mainModuleSource:
+        script = pm.compile(mainModuleSource.read(), {'filename': scriptFilename, 'noScriptRval': True})
+    args = forkserver.serve(forkServer)  # returns in the forked processes only
+    sys.argv = sys.argv[:1] + args
+    globalThis.arguments = sys.argv
+    enterRepl = sys.stdin.isatty()
+    if len(args) == 0 or os.path.abspath(args[0]) != scriptFilename:
+      script = None
+
   if (len(args) > 0):
     async def runJS():
       hasUncaughtException = False
@@ -402,7 +480,7 @@ def main():
 
       try:
         globalInitModule.patchGlobalRequire()
-        pm.runProgramModule(args[0], args, requirePath)
+        pm.runProgramModule(args[0], args, requirePath, script)
         await pm.wait()  # blocks until all asynchronous calls finish
         if hasUncaughtException:
           sys.exit(1)
@@ -53,6 +53,13 @@ declare var console: import("console").Console;
 declare var atob: typeof import("base64").atob;
 declare var btoa: typeof import("base64").btoa;
 
+// Expose `TextEncoder`/`TextDecoder` as properties of the global object
+declare var TextEncoder: typeof import("text-encoding").TextEncoder;
+declare var TextDecoder: typeof import("text-encoding").TextDecoder;
+
+// Expose `structuredClone` as a property of the global object
+declare var structuredClone: typeof import("structured-clone").structuredClone;
+
 // Expose `setTimeout`/`clearTimeout` APIs
 declare var setTimeout: typeof import("timers").setTimeout;
 declare var clearTimeout: typeof import("timers").clearTimeout;
@@ -67,6 +74,12 @@ declare var URLSearchParams: typeof import("url").URLSearchParams;
 // Expose `XMLHttpRequest` (XHR) API
 declare var XMLHttpRequest: typeof import("XMLHttpRequest").XMLHttpRequest;
 
+// Expose the fetch API
+declare var fetch: typeof import("fetch").fetch;
+declare var Headers: typeof import("fetch").Headers;
+declare var Request: typeof import("fetch").Request;
+declare var Response: typeof import("fetch").Response;
+
 // Keep this in sync with both https://hg.mozilla.org/releases/mozilla-esr102/file/a03fde6/js/public/Promise.h#l331
 //                        and  https://github.com/nodejs/node/blob/v20.2.0/deps/v8/include/v8-promise.h#L30
 declare enum PromiseState { Pending = 0, Fulfilled = 1, Rejected = 2 }
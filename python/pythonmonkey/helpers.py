@@ -7,6 +7,7 @@
 #
 # @copyright Copyright (c) 2023 Distributive Corp.
 
+import itertools
 from . import pythonmonkey as pm
 evalOpts = {'filename': __file__, 'fromPythonFrame': True}
 
@@ -43,6 +44,19 @@ function pmNewFactory(ctor)
   return (lambda *args: newCtor(list(args)))
 
 
+def mapJS(fn, iterable, chunk=1024):
+  """
+  mapJS function - a lazy `pythonmonkey.callMany`, calling the JS function on the items of the iterable `chunk` at a time
+  as results are consumed, for iterables too large to be held at once
+  """
+  iterator = iter(iterable)
+  while True:
+    results = pm.callMany(fn, itertools.islice(iterator, chunk), chunk=chunk)
+    if not results:
+      return
+    yield from results
+
+
 def simpleUncaughtExceptionHandler(loop, context):
   """
   A simple exception handler for uncaught JS Promise rejections sent to the Python event-loop
@@ -55,7 +69,7 @@ def simpleUncaughtExceptionHandler(loop, context):
 
 
 # List which symbols are exposed to the pythonmonkey module.
-__all__ = ["new", "typeof", "simpleUncaughtExceptionHandler"]
+__all__ = ["new", "typeof", "mapJS", "simpleUncaughtExceptionHandler"]
 
 # Add the non-enumerable properties of globalThis which don't collide with pythonmonkey.so as exports:
 globalThis = pm.eval('globalThis')
@@ -0,0 +1,158 @@
+# @file         http_pool.py - the pooled HTTP connections of fetch() and XMLHttpRequest
+#               The requests share one aiohttp session, so their TCP and TLS connections are reused
+#               across requests, and the origins configured with their own limits get a session each.
+#
+# @author       agent, agent@local
+# @date         October 2026
+#
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import asyncio
+import atexit
+import aiohttp
+import yarl
+from typing import Dict, Optional, Tuple, Union
+
+__all__ = ['configure_fetch', 'close_fetch_sessions']
+
+# the options of every pool
+_OPTION_NAMES = ('limit', 'limit_per_host', 'keepalive_timeout', 'dns_cache_ttl', 'connect_timeout')
+
+_defaults = {
+  'limit': 100,  # connections open at once, 0 for no limit
+  'limit_per_host': 0,  # connections open at once to the same host, port and scheme, 0 for no limit
+  'keepalive_timeout': 5.0,  # seconds an idle connection is kept, 5s is the default of Node.js's `http.globalAgent`
+  'dns_cache_ttl': 10,  # seconds a resolved host name is cached, None to cache it forever, 0 not to cache it
+  'connect_timeout': None,  # seconds to open a connection, None for no limit
+}
+
+# origin -> the options overriding the defaults for its pool
+_origins: Dict[str, dict] = {}
+
+# origin, or None for the shared pool -> (the event-loop of the session, the session)
+_sessions: Dict[Optional[str], Tuple[asyncio.AbstractEventLoop, aiohttp.ClientSession]] = {}
+
+
+def _origin(url: Union[str, yarl.URL]) -> str:
+  return str(yarl.URL(url).origin())
+
+
+def _check_options(options: dict):
+  for name in options:
+    if name not in _OPTION_NAMES:
+      raise TypeError(f"unknown fetch pool option '{name}', expected one of {', '.join(_OPTION_NAMES)}")
+
+
+def _close_session(loop: asyncio.AbstractEventLoop, session: aiohttp.ClientSession):
+  """
+  Close a session once its event-loop gets to it
+  """
+  if session.closed:
+    return
+  if loop.is_closed():
+    session.detach()  # its connections died with their event-loop, only the warning about them is left
+  elif loop.is_running():
+    asyncio.run_coroutine_threadsafe(session.close(), loop)
+  else:
+    try:
+      loop.run_until_complete(session.close())
+    except RuntimeError:  # another event-loop runs on this thread
+      session.detach()
+
+
+def _discard_sessions():
+  """
+  Forget the sessions, they close once their event-loop gets to it and the next requests open new ones
+  """
+  for loop, session in _sessions.values():
+    _close_session(loop, session)
+  _sessions.clear()
+
+
+def _close_sessions_at_shutdown(loop: asyncio.AbstractEventLoop):
+  """
+  Close the sessions of an event-loop when it shuts down, `asyncio.run()` calls `loop.shutdown_asyncgens()` before closing it
+  """
+  if getattr(loop, '_pythonmonkeyClosesFetchSessions', False):
+    return
+  shutdownAsyncgens = loop.shutdown_asyncgens
+
+  async def shutdown_asyncgens():
+    for key, (sessionLoop, session) in list(_sessions.items()):
+      if sessionLoop is loop:
+        del _sessions[key]
+        await session.close()
+    await shutdownAsyncgens()
+
+  try:
+    loop.shutdown_asyncgens = shutdown_asyncgens  # type: ignore
+    loop._pythonmonkeyClosesFetchSessions = True  # type: ignore
+  except AttributeError:  # an event-loop without a __dict__, e.g. of uvloop, has its sessions closed at exit
+    pass
+
+
+atexit.register(_discard_sessions)
+
+
+def configure_fetch(origins: Optional[Dict[str, dict]] = None, **options):
+  """
+  Configure the connection pools of fetch() and XMLHttpRequest: `limit`, `limit_per_host`, `keepalive_timeout`,
+  `dns_cache_ttl` and `connect_timeout` (see `_defaults`) apply to every pool, and `origins` maps an origin
+  like "https://api.example.com" to the options of a pool of its own, e.g.
+    configure_fetch(keepalive_timeout=30, origins={'https://api.example.com': {'limit': 200}})
+  The connections already open are closed. Neither HTTP pipelining nor HTTP/2 are supported by aiohttp,
+  the connections are reused with HTTP/1.1 keep-alive instead.
+  """
+  _check_options(options)
+  normalized = {}
+  for origin, originOptions in (origins or {}).items():
+    _check_options(originOptions)
+    normalized[_origin(origin)] = dict(originOptions)
+  _defaults.update(options)
+  if origins is not None:
+    _origins.clear()
+    _origins.update(normalized)
+  _discard_sessions()
+
+
+async def close_fetch_sessions():
+  """
+  Close the pooled connections of the running event-loop, e.g. before it stops
+  """
+  loop = asyncio.get_running_loop()
+  for key, (sessionLoop, session) in list(_sessions.items()):
+    if sessionLoop is loop:
+      del _sessions[key]
+      await session.close()
+
+
+def session_for(url: Union[str, yarl.URL]) -> aiohttp.ClientSession:
+  """
+  Get the session of the pool of an URL, in the running event-loop
+  """
+  origin = _origin(url)
+  key = origin if origin in _origins else None
+  loop = asyncio.get_running_loop()
+  entry = _sessions.get(key)
+  if entry and entry[0] is loop and not entry[1].closed:
+    return entry[1]
+  if entry:  # the session of another event-loop
+    _close_session(*entry)
+
+  options = {**_defaults, **_origins.get(key, {})} if key else dict(_defaults)
+  dnsCacheTtl = options['dns_cache_ttl']
+  connector = aiohttp.TCPConnector(
+    limit=options['limit'],
+    limit_per_host=options['limit_per_host'],
+    keepalive_timeout=options['keepalive_timeout'],
+    use_dns_cache=dnsCacheTtl != 0,
+    ttl_dns_cache=dnsCacheTtl,
+  )
+  session = aiohttp.ClientSession(
+    connector=connector,
+    # no total timeout, the body of a response may be streamed for long
+    timeout=aiohttp.ClientTimeout(total=None, sock_connect=options['connect_timeout']),
+  )
+  _sessions[key] = (loop, session)
+  _close_sessions_at_shutdown(loop)
+  return session
@@ -1,4 +1,4 @@
-# @file     WTFPythonMonkey - A tool that detects any hanging setTimeout/setInterval timers when Ctrl-C is hit
+# @file     WTFPythonMonkey - A tool that detects any hanging setTimeout/setInterval timers, and the references retained across the bridge, when Ctrl-C is hit
 # @author   Tom Tang <xmader@distributive.network>
 # @date     April 2024
 # @copyright Copyright (c) 2024 Distributive Corp.
@@ -15,6 +15,26 @@ def printTimersDebugInfo():
   }""")(pm.createRequire(__file__))
 
 
+def printRetentionDebugInfo(limit=10):
+  """
+  Print the largest groups of references across the bridge recorded since `pm.trackRetention()`,
+  with the allocation stack seen most often in each group if stacks were sampled
+  """
+  report = pm.retention()
+  if not report['tracking']:
+    print('Retention tracking is off, call pm.trackRetention() or set PYTHONMONKEY_TRACK_RETENTION=0 to record the references')
+    return
+  for title, key, typeKey in (('Python objects held by JS', 'pythonObjects', 'type'), ('JS objects held by Python', 'jsObjects', 'class')):
+    groups = report[key]
+    print(f'{title}: {sum(group["count"] for group in groups)} references')
+    for group in groups[:limit]:
+      print(f'  {group["count"]:>8} x {group[typeKey]} in {group["holder"]}, {group["bytes"]} bytes')
+      if group['stacks']:
+        top = max(group['stacks'], key=lambda stack: stack['count'])
+        print(f'    {top["count"]} allocated at:')
+        print('      ' + top['stack'].rstrip().replace('\n', '\n      '))
+
+
 class WTF:
   """
   WTFPythonMonkey to use as a Python context manager (`with`-statement)
@@ -37,6 +57,8 @@ class WTF:
       return
     elif issubclass(errType, KeyboardInterrupt):  # except KeyboardInterrupt:
       printTimersDebugInfo()
+      if pm.retention()['tracking']:
+        printRetentionDebugInfo()
       return True  # exception suppressed
     else:  # other exceptions
       return False
@@ -0,0 +1,37 @@
+# @file         profiler.py - the sampling CPU profiler of the JS code and of the calls between Python and JS
+#               The profiles are in the .cpuprofile format of `node --cpu-prof`, which the Chrome DevTools,
+#               the Firefox Profiler and speedscope load.
+#
+# @author       agent, agent@local
+# @date         October 2026
+#
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import json
+from typing import Optional
+from . import pythonmonkey as pm
+
+__all__ = ['start', 'stop']
+
+
+def start(interval: float = 0.001):
+  """
+  Start sampling the stacks of the JS code, every `interval` seconds. The stacks include the JS functions, and the calls
+  between Python and JS, e.g. `callPyFunc` for the time JS spends in a Python function, or the proxy traps of the Python objects
+  used by JS. The time spent outside PythonMonkey is counted under `(program)`.
+  Raises RuntimeError if the profiler is already running
+  """
+  pm.startProfiler(interval)
+
+
+def stop(filename: Optional[str] = None) -> dict:
+  """
+  Stop sampling and return the profile, a dict in the .cpuprofile format: `nodes` (the call tree), `samples`, `timeDeltas`,
+  `startTime` and `endTime` in microseconds. It is also written to `filename` if one is given.
+  Raises RuntimeError if the profiler is not running
+  """
+  text = pm.stopProfiler()
+  if filename:
+    with open(filename, 'w', encoding='utf-8') as file:
+      file.write(text)
+  return json.loads(text)
@@ -16,13 +16,50 @@ class EvalOptions(_typing.TypedDict, total=False):
   strict: bool
   module: bool
   fromPythonFrame: bool
+  timeoutMs: float
+  maxHeapBytes: int
 
 # pylint: disable=redefined-builtin
 
 
 def eval(code: str, evalOpts: EvalOptions = {}, /) -> _typing.Any:
   """
-  JavaScript evaluator in Python
+  JavaScript evaluator in Python.
+  With the `module` option, the code is evaluated as an ES module and its namespace object is returned;
+  its `import` declarations are resolved relative to the `filename` option, or to the current directory.
+  The code is terminated with a TimeoutError once it has run for `timeoutMs` milliseconds, and with a MemoryError
+  if the GC heap grows beyond `maxHeapBytes` while it runs; JS `try`/`catch` can't intercept either
+  """
+
+
+def compile(code: str, evalOpts: EvalOptions = {}, /) -> JSScript:
+  """
+  Compile JavaScript code once, with the same options as `eval`, into a JSScript that can be run many times
+  at the cost of its execution only. The `module` option is not supported
+  """
+
+
+def compileAsync(code: str, evalOpts: EvalOptions = {}, /) -> _typing.Awaitable[JSScript]:
+  """
+  Like `compile`, but the code is parsed and compiled by a thread of its own, so that the running asyncio event-loop
+  keeps serving its tasks while a large bundle compiles, e.g. `script = await pm.compileAsync(bundle)`.
+  Syntax errors are raised by the await
+  """
+
+
+def compileWasm(binary: _typing.Union[bytes, bytearray, memoryview], /) -> JSObjectProxy:
+  """
+  Compile a WebAssembly binary into a `WebAssembly.Module`, e.g. for `WebAssembly.Instance(module, imports)`.
+  The most recently compiled modules are cached by their bytes, compiling the same binary again only creates a new Module object sharing the code
+  """
+
+
+def importModule(filename: str, /) -> JSObjectProxy:
+  """
+  Load, link and evaluate the ES module of a file, and return its namespace object. Each file is evaluated once.
+  Imports are resolved like in Node.js: paths relative to the importing module, with the `.mjs` or `.js` extension added if needed,
+  and bare specifiers from the `node_modules` directories above it (a package's `module` or `main` field, or its index).
+  `import.meta.url` and `import.meta.filename` are set
   """
 
 
@@ -45,6 +82,12 @@ def typeof(jsval: _typing.Any, /):
   """
 
 
+def mapJS(fn: _typing.Any, iterable: _typing.Iterable[_typing.Any], chunk: int = 1024) -> _typing.Iterator[_typing.Any]:
+  """
+  Lazy `callMany`: a generator calling the JS function on the items of the iterable `chunk` at a time, as its results are consumed
+  """
+
+
 def wait() -> _typing.Awaitable[None]:
   """
   Block until all asynchronous jobs (Promise/setTimeout/etc.) finish.
@@ -63,9 +106,103 @@ def stop() -> None:
   """
 
 
-def runProgramModule(filename: str, argv: _typing.List[str], extraPaths: _typing.List[str] = []) -> None:
+def stats(reset: bool = False) -> _typing.Dict[str, _typing.Any]:
+  """
+  Get the counters and latency histograms of the work going through PythonMonkey's event-loop bridge:
+  promise jobs enqueued/run and their `wait` (enqueue to run) and `duration` histograms, timers and their lateness,
+  dispatchables, the `eval` scripts compiled or found in the stencil cache, Promise/Future bridges in flight and the pending event-loop jobs.
+  A histogram is a dict of `count`, `totalUs`, `maxUs` and `buckets`, where bucket `i` counts the durations below 2**i microseconds.
+  `hotPaths` counts the conversions by type in each direction (`toJS`, `toPython`), the traps of the JS proxies of Python dicts, lists
+  and objects, and the methods of the Python proxies of JS objects and arrays, summed over the threads; the Profile and DRelease builds
+  add the `time` spent in each, including the nested ones, in `timeUnit` (TSC `cycles` on x86, `ns` elsewhere).
+
+  The same data is available to JS from `internalBinding("metrics").getStats()`.
+  Pass `reset=True` to zero the counters and histograms after reading them.
+  """
+
+
+def startProfiler(interval: float = 0.001) -> None:
+  """
+  Start sampling the JS stacks every `interval` seconds, see `pythonmonkey.profiler.start`
+  """
+
+
+def stopProfiler() -> str:
+  """
+  Stop sampling the JS stacks and return the profile as .cpuprofile JSON, see `pythonmonkey.profiler.stop`
+  """
+
+
+def memoryStats(detailed: bool = False) -> _typing.Dict[str, _typing.Any]:
+  """
+  Get the memory accounting of the JS heap and of the bridge, cheap enough to be sampled regularly:
+  `heap` (the GC heap bytes and chunks), the live proxies in both directions (`proxiesOfPyObjects` by kind, `proxiesOfJSValues` by type),
+  the Python str buffers shared with JS `externalStrings`, the Python and JS memory shared through `buffers`,
+  and the number of `persistentRoots` the proxies hold in the JS heap.
+  `detailed=True` adds a `runtime` breakdown of the GC heap, measured with JS::CollectRuntimeStats, which walks the whole heap
+  """
+
+
+def trackRetention(enabled: bool = True, stackSampleRate: float = 0.0) -> None:
+  """
+  Start or stop recording the references that keep objects alive across the bridge, for `retention()`. Only the references
+  created while recording count; stopping forgets them. `stackSampleRate`, from 0 to 1, is the fraction of the references
+  whose JS and Python allocation stacks are recorded too.
+  Recording starts at import if the `PYTHONMONKEY_TRACK_RETENTION` environment variable is set to the stack sample rate
+  """
+
+
+def retention() -> _typing.Dict[str, _typing.Any]:
+  """
+  Get the live references recorded since `trackRetention()`: the `pythonObjects` held by JS proxies and functions, grouped by
+  `holder` (the proxy handler, or PyObjectHolder for the functions) and `type`, and the `jsObjects` rooted by Python proxies,
+  grouped by `holder` (the proxy type) and JS `class`. Each group has a `count`, the shallow size in `bytes` of its objects,
+  and the sampled allocation `stacks` with their counts; the groups are sorted by size
+  """
+
+
+def setStencilCache(size: int = 256, directory: _typing.Optional[str] = None) -> None:
+  """
+  Configure the cache of the compiled scripts of `eval` (and so of `require`): evaluating the same source with the same options
+  again skips parsing and bytecode generation. `size` is the number of scripts kept in memory, 0 disables the in-memory cache.
+  `directory`, created if needed, also stores the compiled scripts on disk so that later processes start faster;
+  it defaults to the `PYTHONMONKEY_STENCIL_CACHE` environment variable read at import, and None disables the on-disk store.
+  The ES modules are cached too, but not the scripts evaluated from open files
+  """
+
+
+def setRequireCache(path: _typing.Optional[str]) -> None:
+  """
+  Load the cache of the module lookups of `require` and `import` from the file at `path`, and save it back there at exit, so that
+  the next runs of the same program skip listing its node_modules directories and resolving its modules again.
+  A missing file is created at exit; the directories that changed since it was saved are listed again.
+  It defaults to the `PYTHONMONKEY_REQUIRE_CACHE` environment variable read at import, and None stops saving the cache
+  """
+
+
+def runSync(fn: _typing.Any, /, *args: _typing.Any) -> _typing.Any:
+  """
+  Call a JS (async) function with `args` and return the value its promise settles to, raising its rejection.
+  The promise jobs run back-to-back in native code, so CPU-only async code does not cost an event-loop round-trip per `await`.
+  A promise (or Python awaitable) may be passed instead of a function.
+
+  When the promise still waits on timers or I/O once the jobs are exhausted, it is awaited on a private event-loop,
+  or a RuntimeError is raised if an event-loop is already running on this thread.
+  """
+
+
+def runProgramModule(filename: str, argv: _typing.List[str], extraPaths: _typing.List[str] = [], script: _typing.Optional[JSScript] = None) -> None:
   """
   Load and evaluate a program (main) module. Program modules must be written in JavaScript.
+  A `script` compiled from the file with `{'filename': ..., 'noScriptRval': True}` is run instead of reading it again
+  """
+
+
+def callMany(fn: _typing.Any, iterable: _typing.Iterable[_typing.Any], /, *, chunk: int = 1024) -> _typing.List[_typing.Any]:
+  """
+  Call a JS function once per item of an iterable, with the item as its only argument, and return the list of the results.
+  The items are converted to JS `chunk` at a time and the calls of a chunk run back-to-back in native code, which saves most of
+  the per-call cost of calling a JSFunctionProxy in a Python loop. See `pythonmonkey.mapJS` for a lazy version
   """
 
 
@@ -75,9 +212,207 @@ def isCompilableUnit(code: str) -> bool:
   """
 
 
-def collect() -> None:
+def collect(shrinking: bool = False) -> None:
+  """
+  Calls the spidermonkey garbage collector, finishing the incremental collection started by `gcSlice` if there is one.
+  A shrinking collection also compacts the heap and releases the unused memory to the operating system
+  """
+
+
+def gcSlice(budgetMs: float, /) -> bool:
+  """
+  Do up to `budgetMs` milliseconds of garbage collection work, starting an incremental collection if none is in progress.
+  Returns True while the collection is unfinished, e.g. to call it again from idle time between requests
+  """
+
+
+def setGCParameter(name: str, value: int, /) -> None:
+  """
+  Set a tuning parameter of the garbage collector: maxBytes, minNurseryBytes, maxNurseryBytes, incrementalGCEnabled,
+  perZoneGCEnabled, compactingEnabled, sliceTimeBudgetMs, highFrequencyTimeLimit (ms), smallHeapSizeMax and largeHeapSizeMin (MB),
+  highFrequencySmallHeapGrowth, highFrequencyLargeHeapGrowth and lowFrequencyHeapGrowth (percentages, e.g. 150 for 1.5x),
+  or allocationThreshold (MB). maxBytes is unlimited by default.
+  Raises a KeyError for an unknown parameter, and a ValueError for a read-only one or a value the garbage collector rejects,
+  e.g. a growth below 100 or nursery bytes smaller than a page
+  """
+
+
+def getGCParameter(name: str, /) -> int:
+  """
+  Get a tuning parameter of the garbage collector (see `setGCParameter`), or one of the read-only statistics
+  bytes, number (of collections), totalChunks and unusedChunks
+  """
+
+
+def setEngineOptions(**options: _typing.Union[bool, int]) -> None:
+  """
+  Set the JIT tiers of the engine, the flags baselineInterpreter, baseline, ion, offThreadCompilation, nativeRegExp,
+  wasmBaseline and wasmOptimizing, and its warm-up thresholds baselineInterpreterWarmUpThreshold, baselineWarmUpThreshold,
+  ionWarmUpThreshold, ionFrequentBailoutThreshold and inliningMaxBytecodeLength (-1 restores the default of a threshold).
+  e.g. baselineWarmUpThreshold=0 for short-lived tasks, or a low ionWarmUpThreshold for long-running ones.
+  The same options can be set at import time by the PYTHONMONKEY_ENGINE_OPTIONS environment variable,
+  like `ion=false,baselineWarmUpThreshold=0`.
+  The perfMap option, which writes the jitdump of the JIT code for `perf` (`perf record -k 1`, then `perf inject --jit`),
+  can only be turned on by that variable, `PYTHONMONKEY_ENGINE_OPTIONS=perfMap=true`; setting it here raises a ValueError
+  unless it already has that value
+  """
+
+
+def getEngineOptions() -> _typing.Dict[str, _typing.Union[bool, int]]:
+  """
+  Get the JIT tiers and warm-up thresholds of the engine, see `setEngineOptions`
+  """
+
+
+def setLazyStringNormalization(enabled: bool, /) -> None:
+  """
+  When enabled, JS strings containing surrogate pairs are proxied without copying,
+  and only converted to well-formed Python strings when `str()` is called on them
+  """
+
+
+def setReleaseGIL(enabled: bool, /) -> None:
+  """
+  When enabled, the other Python threads keep running while JS code runs: the GIL is handed over every
+  `sys.getswitchinterval()` seconds, between JS operations, like the Python interpreter does between bytecodes.
+  JS calls back into Python with the GIL held as usual. While JS runs, the other threads must not call into PythonMonkey:
+  `eval` and JS function calls from them raise a RuntimeError. Disabled by default.
+  On free-threaded (no-GIL) Python builds, importing pythonmonkey enables the GIL again, with the same rules. If the GIL is forced off
+  (PYTHON_GIL=0), JS only runs on the thread that imported pythonmonkey, and calling into it from other threads always raises
+  a RuntimeError; use a `Worker` to run JS in parallel
+  """
+
+
+def setCollectCrossHeapCycles(enabled: bool, /) -> None:
+  """
+  When enabled, each full Python collection (`gc.collect()` or generation 2) first runs a full, non-incremental JS GC to find the Python objects
+  that JS proxies only hold through the JS heap, so that the reference cycles spanning both heaps, e.g. a Python object holding a JS object
+  whose callback closes over the Python object, are collected. Disabled by default, as the JS GC pauses every full Python collection
+  """
+
+
+def setCopyStridedBuffers(enabled: bool, /) -> None:
+  """
+  When enabled, Python buffers that are not C-contiguous (e.g. numpy slices, Fortran-ordered arrays) are copied into a new C-ordered TypedArray
+  when passed to JS, instead of raising. The copy doesn't share memory with the Python buffer. C-contiguous buffers are always zero-copy
+  """
+
+
+def setCopyImmutableBuffers(enabled: bool, /) -> None:
+  """
+  When enabled, immutable Python buffers (`bytes`, read-only memoryviews) are copied into a new Uint8Array (or the TypedArray of their format)
+  when passed to JS, instead of being wrapped by a read-only proxy. Element access then runs at native TypedArray speed,
+  and writes from JS only change the copy. When disabled (the default), the bytes proxy shares the memory without copying
+  """
+
+
+def setIteratorBatchSize(size: int, /) -> None:
+  """
+  Set the number of items pulled from a Python iterator per native call when JS iterates it, with `for...of` or `next()`.
+  The items are buffered on the JS proxy of the iterator and served from there, so a generator runs ahead of its JS consumer
+  by up to `size` items, and an exception it raises is thrown once the items before it are consumed. 1 (the default) pulls one item per step
+  """
+
+
+def setNumbersAsInt(int32: bool, integral: bool = False, /) -> None:
+  """
+  When `int32` is enabled, JS numbers that the engine stores as 32-bit integers (array indices, counters, bitwise results, ...)
+  are converted to Python ints instead of floats. When `integral` is enabled, so is every integral number within
+  `Number.MAX_SAFE_INTEGER`, except -0. Both are disabled by default, all JS numbers are then converted to floats
+  """
+
+
+def setDatesAsTimestamps(enabled: bool, /) -> None:
+  """
+  When enabled, JS Dates are converted to float timestamps, in seconds since the epoch like `datetime.timestamp()`,
+  instead of timezone-aware datetimes. Invalid Dates become `nan`
+  """
+
+
+def setKeywordArgumentsAsOptions(enabled: bool, /) -> None:
   """
-  Calls the spidermonkey garbage collector
+  When enabled, keyword arguments of calls to JS functions are collected into an object passed as the last argument,
+  i.e. `f(1, b=2)` calls `f(1, { b: 2 })`. When disabled (the default), keyword arguments are ignored
+  """
+
+
+def toPython(value: _typing.Any, /) -> _typing.Any:
+  """
+  Deep-copy a JS value (usually a JSObjectProxy or JSArrayProxy) into plain Python objects.
+  Objects become dicts, arrays become lists, strings become str, typed arrays become memoryviews over a private copy.
+  Shared references and cycles are preserved. Functions, promises and other non-plain values are proxied as usual.
+  The copy doesn't call into JS when it is read, so it is faster to process than the proxies, but doesn't see later changes
+  """
+
+
+def toJS(value: _typing.Any, /) -> _typing.Any:
+  """
+  Deep-copy a Python value into plain JS objects, the mirror of `toPython`.
+  Dicts become objects, lists and tuples become arrays, buffers become typed arrays over a private copy.
+  The result is returned as the usual proxy of the JS copy
+  """
+
+
+def jsonStringify(value: _typing.Any, indent: _typing.Union[int, str, None] = None,
+                  write: _typing.Optional[_typing.Callable[[bytes], _typing.Any]] = None) -> _typing.Optional[bytes]:
+  """
+  `JSON.stringify(value, null, indent)`, encoded to UTF-8 bytes directly from the JS serializer's output,
+  without building a JS string and a Python str in between.
+  When `write` is given, the output is passed to it in chunks of about 64 KiB and None is returned.
+  Returns None when the value has no JSON representation (`JSON.stringify` returns undefined)
+  """
+
+
+def jsonParse(data: _typing.Union[bytes, bytearray, memoryview], /) -> _typing.Any:
+  """
+  `JSON.parse` a UTF-8 encoded buffer without creating a Python str, returning the usual proxy of the result.
+  Combine it with `toPython` to get plain Python objects
+  """
+
+
+def utf8(string: str, /) -> bytes:
+  """
+  Encode a string to UTF-8. A JS string is encoded straight from its chars, in one pass without an intermediate str,
+  its unpaired surrogates becoming U+FFFD; a Python str is encoded like `string.encode('utf-8')`
+  """
+
+
+def writeUtf8(string: str, target: _typing.Any, /) -> int:
+  """
+  Encode a string to UTF-8 like `utf8`, into a writable buffer such as a preallocated bytearray or memoryview, which must be big
+  enough for the whole string, or else by calling `target.write`, in chunks of 64 KiB for the big JS strings.
+  Return the number of bytes written
+  """
+
+
+def prefork() -> None:
+  """
+  Get the warmed-up runtime ready to be the parent of forked worker processes: run the pending promise jobs, compact the JS heap
+  and `gc.freeze()` the Python objects, so that the children share most of the parent's pages copy-on-write.
+  The `os.register_at_fork` handlers installed by the import finish an incremental GC in progress and stop the SpiderMonkey helper threads,
+  the watchdog and the job queue dispatcher before every `os.fork()` in the process, whether or not this was called, and restart the threads
+  in both processes after it. Raises RuntimeError if Workers or the profiler are running
+  """
+
+
+def serialize(value: _typing.Any, /) -> bytes:
+  """
+  Serialize a value with the structured clone algorithm of `structuredClone`, into a compact byte string that can be cached or sent
+  to another process running the same PythonMonkey version. Plain Python data is deep-copied to JS first, the proxies of JS objects
+  serialize their JS object. Shared references and cycles are preserved; functions and other non-cloneable values raise
+  """
+
+
+def deserialize(data: _typing.Union[bytes, bytearray, memoryview], /) -> _typing.Any:
+  """
+  Rebuild a value from the bytes made by `serialize`, returning the usual proxy of the new JS value
+  """
+
+
+def arrayFromBuffer(buffer: _typing.Any, /) -> JSArrayProxy:
+  """
+  Unpack the numbers of a 1-dimensional, C-contiguous buffer (`array.array`, numpy vector, ...) into a new dense JS Array,
+  in one native pass. The reverse of `JSArrayProxy.to_buffer`
   """
 
 
@@ -123,6 +458,114 @@ class JSObjectProxy(dict):
   JavaScript Object proxy dict
   """
 
+  def get_many(self, keys: _typing.Iterable[_typing.Union[str, int]], /) -> list:
+    """
+    Read many properties at once, in one native loop, returning their values in the order of the keys (None for the missing ones)
+    """
+
+  def set_many(self, mapping: _typing.Union[_typing.Mapping[_typing.Any, _typing.Any], _typing.Iterable[_typing.Tuple[_typing.Any, _typing.Any]]], /) -> None:
+    """
+    Set many properties at once, in one native loop. No property is set if one of the keys is not a str or an int
+    """
+
+  def update_fast(self, dict: _typing.Dict[_typing.Any, _typing.Any], /) -> None:
+    """
+    `set_many` of a dict, walked in place
+    """
+
+  def __init__(self) -> None: "deleted"
+
+
+class JSIterableProxy(JSObjectProxy):
+  """
+  JavaScript iterable proxy dict, for the JS objects with an own `[Symbol.iterator]` or `[Symbol.asyncIterator]` method (a data property, no getter is run).
+  Iterating it with `for` (or `async for` for async iterables) runs the JS iteration protocol lazily, the properties stay accessible as a dict.
+  Objects inheriting their iterator method, and JS Proxies, are converted to a plain `JSObjectProxy`
+  """
+
+  def __iter__(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def __aiter__(self) -> _typing.AsyncIterator[_typing.Any]: ...
+
+  def __init__(self) -> None: "deleted"
+
+
+class JSIteratorProxy(JSIterableProxy):
+  """
+  JavaScript iterator proxy dict, for the generators and the builtin iterators (e.g. of an Array, a Map or a Set), stepped with `next()`
+  """
+
+  def __iter__(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def __next__(self) -> _typing.Any: ...
+
+  def __aiter__(self) -> _typing.AsyncIterator[_typing.Any]: ...
+
+  def __anext__(self) -> _typing.Awaitable[_typing.Any]: ...
+
+  def __init__(self) -> None: "deleted"
+
+
+class JSWasmMemoryProxy(JSObjectProxy):
+  """
+  JavaScript `WebAssembly.Memory` proxy dict. It provides the buffer protocol: `memoryview(memory)` (or numpy.frombuffer) shares the
+  current memory of the Wasm instance without copying, and sees the grown memory after `memory.grow()`, unlike a memoryview of an old `memory.buffer`.
+  While a non-shared memory is exported, `memory.grow()` throws a RangeError; release the views (e.g. `with memoryview(memory) as view:`) before growing
+  """
+
+
+class JSMapProxy:
+  """
+  JavaScript Map proxy mapping. The entries are looked up by the JS value of the key (SameValueZero, so objects by identity),
+  `keys()`, `values()` and `items()` return JS iterators of the Map in insertion order
+  """
+
+  def __len__(self) -> int: ...
+
+  def __getitem__(self, key: _typing.Any) -> _typing.Any: ...
+
+  def __setitem__(self, key: _typing.Any, value: _typing.Any) -> None: ...
+
+  def __delitem__(self, key: _typing.Any) -> None: ...
+
+  def __contains__(self, key: _typing.Any) -> bool: ...
+
+  def __iter__(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def get(self, key: _typing.Any, default: _typing.Any = None, /) -> _typing.Any: ...
+
+  def pop(self, key: _typing.Any, default: _typing.Any = ..., /) -> _typing.Any: ...
+
+  def clear(self) -> None: ...
+
+  def keys(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def values(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def items(self) -> _typing.Iterator[list]: ...
+
+  def __init__(self) -> None: "deleted"
+
+
+class JSSetProxy:
+  """
+  JavaScript Set proxy collection, its membership is tested by the JS value of the element (SameValueZero, so objects by identity)
+  """
+
+  def __len__(self) -> int: ...
+
+  def __contains__(self, element: _typing.Any) -> bool: ...
+
+  def __iter__(self) -> _typing.Iterator[_typing.Any]: ...
+
+  def add(self, element: _typing.Any, /) -> None: ...
+
+  def discard(self, element: _typing.Any, /) -> None: ...
+
+  def remove(self, element: _typing.Any, /) -> None: ...
+
+  def clear(self) -> None: ...
+
   def __init__(self) -> None: "deleted"
 
 
@@ -131,6 +574,17 @@ class JSArrayProxy(list):
   JavaScript Array proxy
   """
 
+  def to_list(self) -> list:
+    """
+    Return a new list of all the elements, converted in one pass
+    """
+
+  def to_buffer(self, format: str = 'd', /) -> memoryview:
+    """
+    Pack an array of numbers into a memoryview over a new bytearray, without a Python object per element.
+    `format` is 'd' (float64), 'f' (float32), 'i' (int32) or 'q' (int64). Usable by numpy with `numpy.asarray`
+    """
+
   def __init__(self) -> None: "deleted"
 
 
@@ -156,6 +610,59 @@ class bigint(int):
   """
 
 
+class JSScript():
+  """
+  JavaScript code compiled by `pythonmonkey.compile`
+
+  ```py
+  rule = pm.compile("price * quantity > limit")
+  rule.run({'price': 10, 'quantity': 3, 'limit': 20})  # True
+  ```
+  """
+
+  def run(self, bindings: _typing.Optional[_typing.Dict[str, _typing.Any]] = None) -> _typing.Any:
+    """
+    Run the script and return the value of its last expression. With a dict of bindings, the script runs in a fresh
+    lexical environment where the keys are variables holding the values (coerced as usual, assignments are not written back to the dict),
+    and its top-level let and const declarations are local to that run
+    """
+
+
+class Worker():
+  """
+  JavaScript code running in its own JS runtime on its own thread, so that CPU-bound JS scales across cores.
+  The worker cannot see Python objects: messages are deep copies (structured clones), like Web Workers.
+
+  ```py
+  worker = pm.Worker("onmessage = (event) => postMessage(event.data.map((x) => x * 2))")
+  worker.postMessage([1, 2, 3])
+  worker.getMessage()  # [2.0, 4.0, 6.0]
+  ```
+
+  Inside the worker, `postMessage(value)` sends a message to Python and `close()` stops the worker once the current message is handled.
+  An exception thrown by the worker is raised as a SpiderMonkeyError by `getMessage`.
+  """
+
+  def __init__(self, code: str, filename: str = "<worker>") -> None: ...
+
+  def postMessage(self, value: _typing.Any, /) -> None:
+    """
+    Send a deep copy of value to the worker's `onmessage(event)` handler, as `event.data`
+    """
+
+  def getMessage(self, timeout: _typing.Optional[float] = None) -> _typing.Any:
+    """
+    Wait for the next message posted by the worker and return a deep copy of it, releasing the GIL while waiting.
+    Raises TimeoutError if no message arrives in time, or RuntimeError if the worker has exited.
+    Use `await loop.run_in_executor(None, worker.getMessage)` to wait from asyncio code.
+    """
+
+  def terminate(self) -> None:
+    """
+    Stop the worker, interrupting the JS code it might be running, and wait for its thread to exit
+    """
+
+
 class SpiderMonkeyError(Exception):
   """
   Representing a corresponding JS Error in Python
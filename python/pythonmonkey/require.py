@@ -222,41 +222,14 @@ return bootstrap;
 })(globalThis.python)""", evalOpts)
 
 
-def statSync_inner(filename: str) -> Union[Dict[str, int], bool]:
-  """
-  Inner function for statSync.
-
-  Returns:
-      Union[Dict[str, int], False]: The mode of the file or False if the file doesn't exist.
-  """
-  from os import stat
-  filename = os.path.normpath(filename)
-  if (os.path.exists(filename)):
-    sb = stat(filename)
-    return {'mode': sb.st_mode}
-  else:
-    return False
-
-
-def readFileSync(filename, charset) -> str:
-  """
-  Utility function for reading files.
-  Returns:
-      str: The contents of the file
-  """
-  filename = os.path.normpath(filename)
-  with open(filename, "r", encoding=charset) as fileHnd:
-    return fileHnd.read()
-
-
-def existsSync(filename: str) -> bool:
-  filename = os.path.normpath(filename)
-  return os.path.exists(filename)
-
-
-bootstrap.modules.fs.statSync_inner = statSync_inner
-bootstrap.modules.fs.readFileSync = readFileSync
-bootstrap.modules.fs.existsSync = existsSync
+# The file system lookups of ctx-module are implemented natively, see internalBinding("fs"): the stat results
+# of the paths inside node_modules are cached, and files are memory-mapped
+fsBinding = pm.internalBinding('fs')
+bootstrap.modules.fs.statSync_inner = fsBinding.statSync
+bootstrap.modules.fs.readFileSync = fsBinding.readFileSync
+bootstrap.modules.fs.existsSync = fsBinding.existsSync
+bootstrap.modules.fs.getResolution = fsBinding.getResolution
+bootstrap.modules.fs.setResolution = fsBinding.setResolution
 
 # Read ctx-module module from disk and invoke so that this file is the "main module" and ctx-module has
 # require and exports symbols injected from the bootstrap object above. Current PythonMonkey bugs
@@ -322,6 +295,7 @@ function createRequireInner(filename, bootstrap, extraPaths, isMain)
 {
   const CtxModule = bootstrap.modules['ctx-module'].CtxModule;
   const moduleCache = globalThis.require?.cache || {};
+  const cachingRequireKey = Symbol.for('pythonmonkey.cachingRequire');
 
   function loadPythonModule(module, filename)
   {
@@ -332,7 +306,7 @@ function createRequireInner(filename, bootstrap, extraPaths, isMain)
   if (filename)
     filename = filename.split('\\\\').join('/');
   if (moduleCache[filename])
-    return moduleCache[filename].require;
+    return moduleCache[filename][cachingRequireKey] || moduleCache[filename].require;
 
   const module = new CtxModule(globalThis, filename, moduleCache);
   if (!filename)
@@ -354,12 +328,13 @@ function createRequireInner(filename, bootstrap, extraPaths, isMain)
   module.require.extensions['.py'] = loadPythonModule;
   Object.assign(module.require.extensions, extCopy);
 
+  const require = cachingRequire(module);
   if (isMain)
   {
     globalThis.module = module;
     globalThis.exports = module.exports;
-    globalThis.require = module.require;
-    globalThis.require.main = module;
+    globalThis.require = require;
+    module.require.main = module; /* inherited by the caching require */
     module.loaded = true;
     moduleCache[filename] = module;
   }
@@ -367,7 +342,49 @@ function createRequireInner(filename, bootstrap, extraPaths, isMain)
   if (extraPaths)
     module.require.path.splice(module.require.path.length, 0, ...(extraPaths.split(',')));
 
-  return module.require;
+  return require;
+
+  /**
+   * Wrap the require of a module so that the identifiers it requires are resolved once, through the resolution cache of
+   * internalBinding("fs"), which can be persisted between runs with pythonmonkey.setRequireCache. The properties of the
+   * wrapped require (path, extensions, cache, resolve...) are inherited.
+   */
+  function cachingRequire(module)
+  {
+    const innerRequire = module.require;
+    if (!filename || typeof innerRequire.resolve !== 'function')
+      return innerRequire;
+
+    const fs = bootstrap.modules.fs;
+    const baseDirectory = filename.slice(0, filename.lastIndexOf('/')) || '/';
+    function require(id)
+    {
+      if (typeof id !== 'string' || bootstrap.builtinModules.hasOwnProperty(id))
+        return innerRequire(id);
+
+      /* the resolution also depends on the search paths, which may change after the require is created */
+      const searchPaths = Array.isArray(innerRequire.path) ? innerRequire.path.join('\\u001f') : '';
+      let resolved = fs.getResolution(baseDirectory, id, searchPaths);
+      if (!resolved)
+      {
+        try
+        {
+          resolved = innerRequire.resolve(id);
+        }
+        catch (error)
+        {
+          return innerRequire(id); /* throws the error of require itself */
+        }
+        if (typeof resolved !== 'string' || !/^(\\/|[A-Za-z]:)/.test(resolved))
+          return innerRequire(id);
+        fs.setResolution(baseDirectory, id, resolved, searchPaths);
+      }
+      return innerRequire(resolved);
+    }
+    Object.setPrototypeOf(require, innerRequire);
+    module[cachingRequireKey] = require;
+    return require;
+  }
 })""", evalOpts)
 
 # API: pm.createRequire
@@ -393,23 +410,38 @@ def createRequire(filename, extraPaths: Union[List[str], Literal[False]] = False
 
 
 bootstrap.requireFromDisk = createRequireInner(None, bootstrap, '', False)
-bootstrap.inspect = bootstrap.requireFromDisk('util').inspect
+# util is only loaded when debug() output first needs it
+pm.eval("""'use strict'; (function lazyInspect(bootstrap) {
+  Object.defineProperty(bootstrap, 'inspect', {
+    configurable: true,
+    get() {
+      const inspect = bootstrap.requireFromDisk('util').inspect;
+      Object.defineProperty(bootstrap, 'inspect', { value: inspect, writable: true, configurable: true });
+      return inspect;
+    },
+  });
+})""", evalOpts)(bootstrap)
 
 # API: pm.runProgramModule
 
 
-def runProgramModule(filename, argv, extraPaths=[]):
+def runProgramModule(filename, argv, extraPaths=[], script=None):
   """
   Run the program module. This loads the code from disk, sets up the execution environment, and then
   invokes the program module (aka main module). The program module is different from other modules in that
   1. it cannot return (must throw)
   2. the outermost block scope is the global scope, effectively making its scope a super-global to
      other modules
+
+  A JSScript of the file compiled ahead of time, e.g. by a fork server before forking, is run instead of loading the file.
   """
   fullFilename = os.path.abspath(filename)
   createRequire(fullFilename, extraPaths, True)
   globalThis.__filename = fullFilename
   globalThis.__dirname = os.path.dirname(fullFilename)
+  if script is not None:
+    script.run()
+    return
   with open(fullFilename, encoding="utf-8", mode="r") as mainModuleSource:
     pm.eval(mainModuleSource.read(), {'filename': fullFilename, 'noScriptRval': True})
     # forcibly run in file mode. We shouldn't be getting the last expression of the script as the result value.
@@ -79,7 +79,10 @@ mkdir -p ../../../../_spidermonkey_install/
   --disable-tests \
   $(if [[ "$OSTYPE" == "darwin"* ]]; then echo "--enable-linker=ld64"; fi) \
   --enable-optimize \
+  $(if [[ "$OSTYPE" == "linux"* ]]; then echo "--enable-perf"; fi) \
   --disable-explicit-resource-management
+# enable-perf: Build the perf spewer of the JITs (JS_ION_PERF), which writes the jitdump/perf map of the JIT code when IONPERF is set,
+#              see the perfMap engine option of PythonMonkey
 # disable-explicit-resource-management: Disable the `using` syntax that is enabled by default in SpiderMonkey nightly, otherwise the header files will disagree with the compiled lib .so file
 #                                       when it's using a `IF_EXPLICIT_RESOURCE_MANAGEMENT` macro, e.g., the `enum JSProtoKey` index would be off by 1 (header `JSProto_Uint8Array` 27 will be interpreted as `JSProto_Int8Array` in lib as lib has an extra element)
 #                                       https://bugzilla.mozilla.org/show_bug.cgi?id=1940342
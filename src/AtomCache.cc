@@ -0,0 +1,122 @@
+/**
+ * @file AtomCache.cc
+ * @author agent (agent@local)
+ * @brief Caches of the property keys crossing between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/AtomCache.hh"
+#include "include/ProxyCache.hh" // for the JS::GCPolicy<PyObject *> specialization
+
+#include <jsapi.h>
+#include <js/GCHashTable.h>
+
+#include <Python.h>
+#include "include/pyshim.hh"
+
+using PyStringToIdMap = JS::GCHashMap<PyObject *, JS::PropertyKey, mozilla::DefaultHasher<PyObject *>, js::SystemAllocPolicy>;
+
+// atoms are never moved by the GC, so they can be hashed by address
+using AtomToPyStringMap = JS::GCHashMap<JSString *, PyObject *, mozilla::DefaultHasher<JSString *>, js::SystemAllocPolicy>;
+
+// interned Python str -> jsid, the cache holds a reference to the strings and traces the jsids
+static JS::PersistentRooted<PyStringToIdMap> *pyStringToIdCache = nullptr;
+// JS atom -> interned Python str, the cache traces the atoms and holds a reference to the strings
+static JS::PersistentRooted<AtomToPyStringMap> *atomToPyStringCache = nullptr;
+
+static void clearPyStringToIdCache() {
+  PyStringToIdMap &map = pyStringToIdCache->get();
+  if (!Py_IsFinalizing()) {
+    for (auto iter = map.iter(); !iter.done(); iter.next()) {
+      Py_DECREF(iter.get().key());
+    }
+  }
+  map.clear();
+}
+
+static void clearAtomToPyStringCache() {
+  AtomToPyStringMap &map = atomToPyStringCache->get();
+  if (!Py_IsFinalizing()) {
+    for (auto iter = map.iter(); !iter.done(); iter.next()) {
+      Py_DECREF(iter.get().value());
+    }
+  }
+  map.clear();
+}
+
+bool AtomCache::init(JSContext *cx) {
+  pyStringToIdCache = new JS::PersistentRooted<PyStringToIdMap>(cx);
+  atomToPyStringCache = new JS::PersistentRooted<AtomToPyStringMap>(cx);
+  return pyStringToIdCache && atomToPyStringCache;
+}
+
+void AtomCache::finalize() {
+  if (pyStringToIdCache) {
+    clearPyStringToIdCache();
+  }
+  delete pyStringToIdCache;
+  pyStringToIdCache = nullptr;
+  if (atomToPyStringCache) {
+    clearAtomToPyStringCache();
+  }
+  delete atomToPyStringCache;
+  atomToPyStringCache = nullptr;
+}
+
+bool AtomCache::getId(PyObject *key, JS::MutableHandleId idp) {
+  if (!pyStringToIdCache || !PyUnicode_CHECK_INTERNED(key)) {
+    return false;
+  }
+  auto ptr = pyStringToIdCache->get().lookup(key);
+  if (!ptr) {
+    return false;
+  }
+  idp.set(ptr->value());
+  return true;
+}
+
+void AtomCache::putId(PyObject *key, JS::HandleId id) {
+  if (!pyStringToIdCache || !PyUnicode_CHECK_INTERNED(key)) {
+    return;
+  }
+  PyStringToIdMap &map = pyStringToIdCache->get();
+  if (map.count() >= ATOM_CACHE_MAX_ENTRIES) {
+    clearPyStringToIdCache();
+  }
+  auto ptr = map.lookupForAdd(key);
+  // failing to cache is harmless, the next lookup will just atomize the string again
+  if (!ptr && map.add(ptr, key, id)) {
+    Py_INCREF(key);
+  }
+}
+
+PyObject *AtomCache::getKey(JSString *atom) {
+  if (!atomToPyStringCache) {
+    return NULL;
+  }
+  auto ptr = atomToPyStringCache->get().lookup(atom);
+  if (!ptr) {
+    return NULL;
+  }
+  PyObject *key = ptr->value();
+  Py_INCREF(key);
+  return key;
+}
+
+void AtomCache::putKey(JSString *atom, PyObject *key) {
+  if (!atomToPyStringCache) {
+    return;
+  }
+  AtomToPyStringMap &map = atomToPyStringCache->get();
+  if (map.count() >= ATOM_CACHE_MAX_ENTRIES) {
+    clearAtomToPyStringCache();
+  }
+  auto ptr = map.lookupForAdd(atom);
+  // failing to cache is harmless, the next lookup will just convert the atom again
+  if (!ptr && map.add(ptr, atom, key)) {
+    Py_INCREF(key);
+  }
+}
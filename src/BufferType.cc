@@ -9,17 +9,59 @@
  */
 
 #include "include/BufferType.hh"
+#include "include/ContextOwner.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 #include "include/PyBytesProxyHandler.hh"
+#include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
+#include <js/Array.h>
 #include <js/ArrayBuffer.h>
+#include <js/Utility.h>
+#include <js/SharedArrayBuffer.h>
 #include <js/experimental/TypedData.h>
 #include <js/ScalarType.h>
 
 #include <limits.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
 
 // JS to Python
 
+/**
+ * @brief The exporters of each pinned ArrayBuffer, by the start of its data
+ */
+struct PinCount {
+  size_t exporters;
+  bool unpin; // false if the length was already pinned by someone else, it is left pinned
+};
+static std::unordered_map<void *, PinCount> pinCounts;
+
+/* static */
+void BufferType::pinLength(JSObject *bufObj, void *base) {
+  auto it = pinCounts.find(base);
+  if (it != pinCounts.end()) {
+    it->second.exporters++;
+    return;
+  }
+  pinCounts.emplace(base, PinCount{1, JS::PinArrayBufferOrViewLength(bufObj, true)});
+}
+
+/* static */
+void BufferType::unpinLength(JSObject *bufObj, void *base) {
+  auto it = pinCounts.find(base);
+  if (it == pinCounts.end() || --it->second.exporters > 0) {
+    return;
+  }
+  if (it->second.unpin) {
+    JS::PinArrayBufferOrViewLength(bufObj, false);
+  }
+  pinCounts.erase(it);
+}
+
 /* static */
 const char *BufferType::_toPyBufferFormatCode(JS::Scalar::Type subtype) {
   // floating point types
@@ -57,7 +99,7 @@ const char *BufferType::_toPyBufferFormatCode(JS::Scalar::Type subtype) {
 
 /* static */
 bool BufferType::isSupportedJsTypes(JSObject *obj) {
-  return JS::IsArrayBufferObject(obj) || JS_IsTypedArrayObject(obj);
+  return JS::IsArrayBufferObject(obj) || JS::IsSharedArrayBufferObject(obj) || JS_IsTypedArrayObject(obj);
 }
 
 PyObject *BufferType::getPyObject(JSContext *cx, JS::HandleObject bufObj) {
@@ -66,6 +108,8 @@ PyObject *BufferType::getPyObject(JSContext *cx, JS::HandleObject bufObj) {
     pyObject = fromJsTypedArray(cx, bufObj);
   } else if (JS::IsArrayBufferObject(bufObj)) {
     pyObject = fromJsArrayBuffer(cx, bufObj);
+  } else if (JS::IsSharedArrayBufferObject(bufObj)) {
+    pyObject = fromJsSharedArrayBuffer(cx, bufObj);
   } else {
     // TODO (Tom Tang): Add support for JS [DataView](https://developer.mozilla.org/en-US/docs/Web/JavaScript/Reference/Global_Objects/DataView)
     PyErr_SetString(PyExc_TypeError, "`bufObj` is neither a TypedArray object nor an ArraryBuffer object.");
@@ -79,53 +123,110 @@ PyObject *BufferType::getPyObject(JSContext *cx, JS::HandleObject bufObj) {
 PyObject *BufferType::fromJsTypedArray(JSContext *cx, JS::HandleObject typedArray) {
   JS::Scalar::Type subtype = JS_GetArrayBufferViewType(typedArray);
   auto byteLength = JS_GetTypedArrayByteLength(typedArray);
+  auto byteOffset = JS_GetTypedArrayByteOffset(typedArray);
 
-  // Retrieve/Create the underlying ArrayBuffer object for side-effect.
-  //
-  // If byte length is less than `JS_MaxMovableTypedArraySize()`,
-  // the ArrayBuffer object would be created lazily and the data is stored inline in the TypedArray.
-  // We don't want inline data because the data pointer would be invalidated during a GC as the TypedArray object is moved.
-  bool isSharedMemory;
-  if (!JS_GetArrayBufferViewBuffer(cx, typedArray, &isSharedMemory)) return nullptr;
-
-  uint8_t __destBuf[0] = {}; // we don't care about its value as it's used only if the TypedArray still having inline data
-  uint8_t *data = JS_GetArrayBufferViewFixedData(typedArray, __destBuf, 0 /* making sure we don't copy inline data */);
-  if (data == nullptr) { // shared memory or still having inline data
-    PyErr_SetString(PyExc_TypeError, "PythonMonkey cannot coerce TypedArrays backed by shared memory.");
+  // If byte length is less than `JS_MaxMovableTypedArraySize()`, the data is stored inline in the TypedArray,
+  // and the data pointer would be invalidated during a GC as the TypedArray object is moved. Move it to a malloc'ed ArrayBuffer first.
+  if (!JS::EnsureNonInlineArrayBufferOrView(cx, typedArray)) {
+    setSpiderMonkeyException(cx);
     return nullptr;
   }
 
-  Py_buffer bufInfo = {
-    .buf = data,
-    .obj = NULL /* the exporter PyObject */,
-    .len = (Py_ssize_t)byteLength,
-    .itemsize = (uint8_t)JS::Scalar::byteSize(subtype),
-    .readonly = false,
-    .ndim = 1 /* 1-dimensional array */,
-    .format = (char *)_toPyBufferFormatCode(subtype),
-  };
-  return PyMemoryView_FromBuffer(&bufInfo);
+  void *data;
+  bool isSharedMemory;
+  {
+    JS::AutoCheckCannotGC autoNoGC(cx);
+    data = JS_GetArrayBufferViewData(typedArray, &isSharedMemory, autoNoGC);
+  }
+  return _exportJsBuffer(cx, typedArray, data, byteLength, subtype, (uint8_t *)data - byteOffset, isSharedMemory);
 }
 
 /* static */
 PyObject *BufferType::fromJsArrayBuffer(JSContext *cx, JS::HandleObject arrayBuffer) {
   auto byteLength = JS::GetArrayBufferByteLength(arrayBuffer);
 
-  // TODO (Tom Tang): handle SharedArrayBuffers or disallow them completely
-  bool isSharedMemory; // `JS::GetArrayBufferData` always sets this to `false`
-  JS::AutoCheckCannotGC autoNoGC(cx); // we don't really care about this
-  uint8_t *data = JS::GetArrayBufferData(arrayBuffer, &isSharedMemory, autoNoGC);
-
-  Py_buffer bufInfo = {
-    .buf = data,
-    .obj = NULL /* the exporter PyObject */,
-    .len = (Py_ssize_t)byteLength,
-    .itemsize = 1 /* each element is 1 byte */,
-    .readonly = false,
-    .ndim = 1 /* 1-dimensional array */,
-    .format = (char *)"B" /* uint8 array */,
-  };
-  return PyMemoryView_FromBuffer(&bufInfo);
+  // small ArrayBuffers may store their data inline too
+  if (!JS::EnsureNonInlineArrayBufferOrView(cx, arrayBuffer)) {
+    setSpiderMonkeyException(cx);
+    return nullptr;
+  }
+
+  void *data;
+  {
+    bool isSharedMemory; // `JS::GetArrayBufferData` always sets this to `false`
+    JS::AutoCheckCannotGC autoNoGC(cx);
+    data = JS::GetArrayBufferData(arrayBuffer, &isSharedMemory, autoNoGC);
+  }
+  return _exportJsBuffer(cx, arrayBuffer, data, byteLength, JS::Scalar::Uint8, data, false);
+}
+
+/* static */
+PyObject *BufferType::fromJsSharedArrayBuffer(JSContext *cx, JS::HandleObject sharedArrayBuffer) {
+  size_t byteLength;
+  bool isSharedMemory;
+  uint8_t *data;
+  JS::GetSharedArrayBufferLengthAndData(sharedArrayBuffer, &byteLength, &isSharedMemory, &data);
+
+  // The memory is shared with the JS threads (and workers) that hold the SharedArrayBuffer, writes are not synchronized
+  return _exportJsBuffer(cx, sharedArrayBuffer, data, byteLength, JS::Scalar::Uint8, data, true);
+}
+
+/* static */
+PyObject *BufferType::_exportJsBuffer(JSContext *cx, JS::HandleObject bufObj, void *data, size_t byteLength, JS::Scalar::Type subtype,
+  void *base, bool shared) {
+  JSBufferExporter *exporter = PyObject_New(JSBufferExporter, &JSBufferExporterType);
+  if (!exporter) {
+    return nullptr;
+  }
+  exporter->jsBuffer = RootPool::newRoot(cx, bufObj);
+  exporter->data = data;
+  exporter->byteLength = (Py_ssize_t)byteLength;
+  exporter->itemSize = JS::Scalar::byteSize(subtype);
+  exporter->length = exporter->byteLength / exporter->itemSize;
+  exporter->format = _toPyBufferFormatCode(subtype);
+  // shared memory can't be detached, so there is nothing to pin
+  exporter->pinned = !shared;
+  exporter->pinnedBase = base;
+  MemoryStats::exportedJSBuffers++;
+  MemoryStats::exportedJSBufferBytes += exporter->byteLength;
+  if (exporter->pinned) {
+    pinLength(bufObj, base);
+    MemoryStats::pinnedJSBufferBytes += exporter->byteLength;
+  }
+
+  PyObject *memoryView = PyMemoryView_FromObject((PyObject *)exporter); // the memoryview holds the reference to the exporter
+  Py_DECREF(exporter);
+  return memoryView;
+}
+
+void JSBufferExporterMethodDefinitions::JSBufferExporter_dealloc(JSBufferExporter *self) {
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSBufferExporterMethodDefinitions::JSBufferExporter_dealloc)) {
+    return;
+  }
+  if (self->pinned) {
+    unpinLength(*(self->jsBuffer), self->pinnedBase);
+    MemoryStats::pinnedJSBufferBytes -= self->byteLength;
+  }
+  MemoryStats::exportedJSBuffers--;
+  MemoryStats::exportedJSBufferBytes -= self->byteLength;
+  RootPool::deleteRoot(self->jsBuffer);
+  PyObject_Del(self);
+}
+
+int JSBufferExporterMethodDefinitions::JSBufferExporter_getbuffer(JSBufferExporter *self, Py_buffer *view, int flags) {
+  view->obj = (PyObject *)self;
+  Py_INCREF(self);
+  view->buf = self->data;
+  view->len = self->byteLength;
+  view->readonly = 0;
+  view->itemsize = self->itemSize;
+  view->format = (flags & PyBUF_FORMAT) ? (char *)self->format : NULL;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? &self->length : NULL;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->itemSize : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  return 0;
 }
 
 
@@ -134,6 +235,9 @@ PyObject *BufferType::fromJsArrayBuffer(JSContext *cx, JS::HandleObject arrayBuf
 static PyBytesProxyHandler pyBytesProxyHandler;
 
 
+bool BufferType::copyStridedBuffers = false;
+bool BufferType::copyImmutableBuffers = false;
+
 JSObject *BufferType::toJsTypedArray(JSContext *cx, PyObject *pyObject) {
   Py_INCREF(pyObject);
 
@@ -145,20 +249,55 @@ JSObject *BufferType::toJsTypedArray(JSContext *cx, PyObject *pyObject) {
     PyErr_Clear();     // a PyExc_BufferError was raised
 
     if (PyObject_GetBuffer(pyObject, view, PyBUF_ND /* C-contiguous */ | PyBUF_FORMAT) < 0) {
-      return nullptr;  // a PyExc_BufferError was raised again
+      // a PyExc_BufferError was raised again, or the buffer is not C-contiguous
+      delete view;
+      Py_DECREF(pyObject);
+      if (!copyStridedBuffers) {
+        return nullptr;
+      }
+      PyErr_Clear();
+      return _stridedToJsTypedArray(cx, pyObject);
     }
 
     immutable = true;
   }
-  
-  if (view->ndim != 1) {
-    PyErr_SetString(PyExc_BufferError, "multidimensional arrays are not allowed");
+
+  if (view->ndim == 0 || (view->ndim != 1 && immutable && !copyImmutableBuffers)) {
+    PyErr_SetString(PyExc_BufferError, view->ndim == 0 ? "zero-dimensional buffers are not allowed" : "multidimensional arrays are not allowed");
     BufferType::_releasePyBuffer(view);
     return nullptr;
   }
 
   // Determine the TypedArray's subtype (Uint8Array, Float64Array, ...)
   JS::Scalar::Type subtype = _getPyBufferType(view);
+  // C-contiguous N-d buffers are flattened, their shape is kept to be exposed on the TypedArray
+  std::vector<Py_ssize_t> shape(view->shape, view->shape + view->ndim);
+
+  if (immutable && copyImmutableBuffers) {
+    // a real ArrayBuffer runs the native TypedArray paths, and writes to it can't corrupt the immutable Python object
+    size_t byteLength = view->len;
+    mozilla::UniquePtr<void, JS::FreePolicy> contents(js_malloc(byteLength ? byteLength : 1));
+    if (!contents) {
+      BufferType::_releasePyBuffer(view);
+      Py_DECREF(pyObject);
+      PyErr_NoMemory();
+      return nullptr;
+    }
+    memcpy(contents.get(), view->buf, byteLength);
+    BufferType::_releasePyBuffer(view);
+    Py_DECREF(pyObject);
+
+    JS::RootedObject arrayBufferCopy(cx, JS::NewArrayBufferWithContents(cx, byteLength, std::move(contents)));
+    if (!arrayBufferCopy) {
+      PyErr_SetString(PyExc_MemoryError, "could not create the ArrayBuffer of an immutable buffer");
+      return nullptr;
+    }
+    JS::RootedObject typedArray(cx, _newTypedArrayWithBuffer(cx, subtype, arrayBufferCopy));
+    if (typedArray && shape.size() > 1 && !_defineShape(cx, typedArray, shape)) {
+      return nullptr;
+    }
+    return typedArray;
+  }
 
   JSObject *arrayBuffer;
   if (view->len > 0) {
@@ -173,6 +312,8 @@ JSObject *BufferType::toJsTypedArray(JSContext *cx, PyObject *pyObject) {
     arrayBuffer = JS::NewExternalArrayBuffer(cx,
       view->len /* byteLength */, std::move(dataPtr)
     );
+    MemoryStats::sharedPyBuffers++;
+    MemoryStats::sharedPyBufferBytes += view->len;
   } else { // empty buffer
     arrayBuffer = JS::NewArrayBuffer(cx, 0);
     BufferType::_releasePyBuffer(view); // the buffer is no longer needed since we are creating a brand new empty ArrayBuffer
@@ -180,20 +321,164 @@ JSObject *BufferType::toJsTypedArray(JSContext *cx, PyObject *pyObject) {
 
   if (!immutable) {
     JS::RootedObject arrayBufferRooted(cx, arrayBuffer);
-    return _newTypedArrayWithBuffer(cx, subtype, arrayBufferRooted);
+    JS::RootedObject typedArray(cx, _newTypedArrayWithBuffer(cx, subtype, arrayBufferRooted));
+    if (typedArray && shape.size() > 1 && !_defineShape(cx, typedArray, shape)) {
+      return nullptr;
+    }
+    return typedArray;
   } else {
     JS::RootedValue v(cx);
     JS::RootedObject uint8ArrayPrototype(cx);
     JS_GetClassPrototype(cx, JSProto_Uint8Array, &uint8ArrayPrototype); // so that instanceof will work, not that prototype methods will
-    JSObject *proxy = js::NewProxyObject(cx, &pyBytesProxyHandler, v, uint8ArrayPrototype.get());
+    JS::RootedObject proxy(cx, js::NewProxyObject(cx, &pyBytesProxyHandler, v, uint8ArrayPrototype.get()));
     JS::SetReservedSlot(proxy, PyObjectSlot, JS::PrivateValue(pyObject));
     JS::PersistentRootedObject *arrayBufferPointer = new JS::PersistentRootedObject(cx);
     arrayBufferPointer->set(arrayBuffer);
     JS::SetReservedSlot(proxy, OtherSlot, JS::PrivateValue(arrayBufferPointer));
+    MemoryStats::pyBytesProxies++;
+    Retention::pinPython(cx, pyObject, "PyBytesProxyHandler");
     return proxy;
   }
 }
 
+/**
+ * @brief Read the item at `item` of a native struct format as a JS number
+ */
+template <typename T>
+static inline JS::Value unpackNumber(const char *item) {
+  T value;
+  memcpy(&value, item, sizeof(T));
+  return JS::NumberValue((double)value);
+}
+
+/* static */
+JSObject *BufferType::toJsArray(JSContext *cx, PyObject *pyObject) {
+  Py_buffer view;
+  if (PyObject_GetBuffer(pyObject, &view, PyBUF_ND | PyBUF_FORMAT) < 0) {
+    return nullptr;
+  }
+  if (view.ndim != 1) {
+    PyErr_SetString(PyExc_BufferError, "only 1-dimensional buffers can be unpacked into a JS Array");
+    PyBuffer_Release(&view);
+    return nullptr;
+  }
+
+  const char *format = view.format ? view.format : "B";
+  if (format[0] == '@') { // native byte order, size and alignment
+    format++;
+  }
+  if (strlen(format) != 1) {
+    PyErr_Format(PyExc_TypeError, "unsupported buffer format '%s'", view.format);
+    PyBuffer_Release(&view);
+    return nullptr;
+  }
+
+  Py_ssize_t length = view.len / view.itemsize;
+  JS::RootedValueVector values(cx);
+  if (!values.resize(length)) {
+    PyBuffer_Release(&view);
+    PyErr_NoMemory();
+    return nullptr;
+  }
+  const char *items = (const char *)view.buf;
+  for (Py_ssize_t index = 0; index < length; index++) {
+    const char *item = items + index * view.itemsize;
+    switch (format[0]) {
+    case 'b': values[index].set(unpackNumber<signed char>(item)); break;
+    case 'B': values[index].set(unpackNumber<unsigned char>(item)); break;
+    case 'h': values[index].set(unpackNumber<short>(item)); break;
+    case 'H': values[index].set(unpackNumber<unsigned short>(item)); break;
+    case 'i': values[index].set(unpackNumber<int>(item)); break;
+    case 'I': values[index].set(unpackNumber<unsigned int>(item)); break;
+    case 'l': values[index].set(unpackNumber<long>(item)); break;
+    case 'L': values[index].set(unpackNumber<unsigned long>(item)); break;
+    case 'q': values[index].set(unpackNumber<long long>(item)); break;
+    case 'Q': values[index].set(unpackNumber<unsigned long long>(item)); break;
+    case 'f': values[index].set(unpackNumber<float>(item)); break;
+    case 'd': values[index].set(unpackNumber<double>(item)); break;
+    default:
+      PyErr_Format(PyExc_TypeError, "unsupported buffer format '%s'", view.format);
+      PyBuffer_Release(&view);
+      return nullptr;
+    }
+  }
+  PyBuffer_Release(&view);
+
+  JSObject *array = JS::NewArrayObject(cx, values);
+  if (!array) {
+    PyErr_NoMemory();
+  }
+  return array;
+}
+
+/* static */
+JSObject *BufferType::_stridedToJsTypedArray(JSContext *cx, PyObject *pyObject) {
+  Py_buffer view;
+  if (PyObject_GetBuffer(pyObject, &view, PyBUF_STRIDES | PyBUF_FORMAT) < 0) {
+    return nullptr;
+  }
+  if (view.ndim == 0) {
+    PyErr_SetString(PyExc_BufferError, "zero-dimensional buffers are not allowed");
+    PyBuffer_Release(&view);
+    return nullptr;
+  }
+
+  JS::Scalar::Type subtype = _getPyBufferType(&view);
+  std::vector<Py_ssize_t> shape(view.shape, view.shape + view.ndim);
+
+  // gather the elements into C order, in memory owned by the ArrayBuffer
+  mozilla::UniquePtr<void, JS::FreePolicy> contents(js_malloc(view.len ? view.len : 1));
+  if (!contents) {
+    PyBuffer_Release(&view);
+    PyErr_NoMemory();
+    return nullptr;
+  }
+  int copied = PyBuffer_ToContiguous(contents.get(), &view, view.len, 'C');
+  size_t byteLength = view.len;
+  PyBuffer_Release(&view);
+  if (copied < 0) {
+    return nullptr;
+  }
+
+  JS::RootedObject arrayBuffer(cx, JS::NewArrayBufferWithContents(cx, byteLength, std::move(contents)));
+  if (!arrayBuffer) {
+    PyErr_SetString(PyExc_MemoryError, "could not create the ArrayBuffer of a strided buffer");
+    return nullptr;
+  }
+  JS::RootedObject typedArray(cx, _newTypedArrayWithBuffer(cx, subtype, arrayBuffer));
+  if (typedArray && shape.size() > 1 && !_defineShape(cx, typedArray, shape)) {
+    return nullptr;
+  }
+  return typedArray;
+}
+
+/* static */
+bool BufferType::_defineShape(JSContext *cx, JS::HandleObject typedArray, const std::vector<Py_ssize_t> &shape) {
+  JS::RootedObject shapeArray(cx, JS::NewArrayObject(cx, shape.size()));
+  JS::RootedObject stridesArray(cx, JS::NewArrayObject(cx, shape.size()));
+  if (!shapeArray || !stridesArray) {
+    PyErr_SetString(PyExc_MemoryError, "could not create the shape of a multidimensional buffer");
+    return false;
+  }
+
+  double stride = JS::Scalar::byteSize(JS_GetArrayBufferViewType(typedArray)); // strides in bytes of the C-ordered elements, as in numpy
+  for (size_t dim = shape.size(); dim-- > 0;) {
+    if (!JS_DefineElement(cx, shapeArray, dim, (double)shape[dim], JSPROP_ENUMERATE) ||
+        !JS_DefineElement(cx, stridesArray, dim, stride, JSPROP_ENUMERATE)) {
+      PyErr_SetString(PyExc_MemoryError, "could not create the shape of a multidimensional buffer");
+      return false;
+    }
+    stride *= shape[dim];
+  }
+
+  if (!JS_DefineProperty(cx, typedArray, "shape", shapeArray, JSPROP_READONLY) ||
+      !JS_DefineProperty(cx, typedArray, "strides", stridesArray, JSPROP_READONLY)) {
+    PyErr_SetString(PyExc_MemoryError, "could not define the shape of a multidimensional buffer");
+    return false;
+  }
+  return true;
+}
+
 /* static */
 void BufferType::_releasePyBuffer(Py_buffer *bufView) {
   PyBuffer_Release(bufView);
@@ -202,6 +487,8 @@ void BufferType::_releasePyBuffer(Py_buffer *bufView) {
 
 /* static */
 void BufferType::_releasePyBuffer(void *, void *bufView) {
+  MemoryStats::sharedPyBuffers--;
+  MemoryStats::sharedPyBufferBytes -= ((Py_buffer *)bufView)->len;
   return _releasePyBuffer((Py_buffer *)bufView);
 }
 
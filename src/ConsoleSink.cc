@@ -0,0 +1,181 @@
+/**
+ * @file ConsoleSink.cc
+ * @author agent (agent@local)
+ * @brief Buffered output of the JS console to the Python standard streams
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/ConsoleSink.hh"
+
+#include <jsapi.h>
+#include <js/CharacterEncoding.h>
+#include <js/String.h>
+#include <mozilla/Span.h>
+
+#include <Python.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <string>
+
+size_t ConsoleSink::threshold = 64 * 1024;
+bool ConsoleSink::pending = false;
+
+static std::string stdoutBuffer;
+static bool flushing = false;
+
+/**
+ * @brief Append the UTF-8 bytes of a JS string, lone surrogates replaced by U+FFFD
+ */
+static bool appendUtf8(JSContext *cx, JS::HandleString str, std::string &out) {
+  JS::Rooted<JSLinearString *> linear(cx, JS_EnsureLinearString(cx, str));
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetDeflatedUTF8StringLength(linear);
+  size_t offset = out.size();
+  try {
+    out.resize(offset + length);
+  } catch (const std::bad_alloc &) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+  JS::AutoCheckCannotGC nogc;
+  if (JS::LinearStringHasLatin1Chars(linear) && length == JS::GetLinearStringLength(linear)) { // ASCII
+    memcpy(&out[offset], JS::GetLatin1LinearStringChars(nogc, linear), length);
+  } else {
+    JS::DeflateStringToUTF8Buffer(linear, mozilla::Span(&out[offset], length));
+  }
+  return true;
+}
+
+static void writeToFd(int fd, const char *data, size_t length) {
+  Py_BEGIN_ALLOW_THREADS // a pipe may be full
+  while (length > 0) {
+#ifdef _WIN32
+    int written = _write(fd, data, (unsigned int)(length > INT_MAX ? INT_MAX : length));
+#else
+    ssize_t written = ::write(fd, data, length);
+#endif
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break; // e.g. EPIPE, the output is dropped like Python drops it at exit
+    }
+    data += written;
+    length -= written;
+  }
+  Py_END_ALLOW_THREADS
+}
+
+/**
+ * @brief Write UTF-8 bytes to `sys.<name>`: to its file descriptor if it is still the stream of the process, `sys.__<name>__`,
+ * through its `write` method otherwise
+ */
+static void writeToStream(const char *name, const char *originalName, const char *data, size_t length) {
+  PyObject *stream = PySys_GetObject(name); // borrowed reference
+  if (!stream || stream == Py_None || length == 0) {
+    return;
+  }
+  Py_INCREF(stream); // flushing it may replace it
+
+  if (stream == PySys_GetObject(originalName)) {
+    PyObject *result = PyObject_CallMethod(stream, "flush", NULL); // its own pending text goes first
+    bool flushed = result != NULL;
+    Py_XDECREF(result);
+    int fd = flushed ? PyObject_AsFileDescriptor(stream) : -1;
+    if (fd >= 0) {
+      writeToFd(fd, data, length);
+      Py_DECREF(stream);
+      return;
+    }
+    PyErr_Clear();
+  }
+
+  PyObject *text = PyUnicode_DecodeUTF8(data, length, "replace");
+  if (text) {
+    PyObject *result = PyObject_CallMethod(stream, "write", "O", text);
+    Py_XDECREF(result);
+    Py_DECREF(text);
+  }
+  PyErr_Clear();
+  Py_DECREF(stream);
+}
+
+void ConsoleSink::flush() {
+  if (flushing || stdoutBuffer.empty()) { // flushing again from a `write` method that logs to the JS console
+    return;
+  }
+  flushing = true;
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+
+  std::string batch;
+  batch.swap(stdoutBuffer);
+  pending = false;
+  writeToStream("stdout", "__stdout__", batch.data(), batch.size());
+
+  PyErr_Restore(type, value, traceback);
+  flushing = false;
+}
+
+bool ConsoleSink::write(JSContext *cx, JS::HandleString str, bool toStderr) {
+  if (!toStderr) {
+    if (!appendUtf8(cx, str, stdoutBuffer)) {
+      return false;
+    }
+    pending = !stdoutBuffer.empty();
+    if (stdoutBuffer.size() >= threshold) {
+      flush();
+    }
+    return true;
+  }
+
+  std::string text;
+  if (!appendUtf8(cx, str, text)) {
+    return false;
+  }
+  flushPending(); // keep the order of the two streams on a terminal
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  writeToStream("stderr", "__stderr__", text.data(), text.size());
+  PyErr_Restore(type, value, traceback);
+  return true;
+}
+
+static PyObject *flushAtExit(PyObject *self, PyObject *args) {
+  ConsoleSink::flush();
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef flushAtExitDefinition = {"pythonmonkey_console_flush", flushAtExit, METH_NOARGS, NULL};
+
+bool ConsoleSink::init() {
+  PyObject *atexitModule = PyImport_ImportModule("atexit");
+  if (!atexitModule) {
+    return false;
+  }
+  PyObject *function = PyCFunction_New(&flushAtExitDefinition, NULL);
+  PyObject *result = function ? PyObject_CallMethod(atexitModule, "register", "O", function) : NULL;
+  Py_XDECREF(result);
+  Py_XDECREF(function);
+  Py_DECREF(atexitModule);
+  return result != NULL;
+}
+
+void ConsoleSink::finalize() {
+  std::string().swap(stdoutBuffer);
+  pending = false;
+}
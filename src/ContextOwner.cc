@@ -0,0 +1,119 @@
+/**
+ * @file ContextOwner.cc
+ * @author agent (agent@local)
+ * @brief Keep the JS context, and the registries that go with it, on the thread that owns it when CPython runs without the GIL
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/ContextOwner.hh"
+
+#include "include/GILSwitch.hh"
+
+#include <Python.h>
+#include <pythread.h>
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#ifdef Py_GIL_DISABLED
+static unsigned long ownerThread = 0;
+static std::atomic<bool> gilEnabled = false; // once enabled, by importing pythonmonkey, the GIL stays enabled
+
+/**
+ * @brief Whether the free-threaded interpreter runs with the GIL, re-enabled as the module doesn't declare `Py_MOD_GIL_NOT_USED`
+ * unless the GIL is forced off with PYTHON_GIL=0 or `-X gil=0`
+ */
+static bool isGILEnabled() {
+  if (gilEnabled.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback); // called by the deallocations too
+  PyObject *isEnabled = PySys_GetObject("_is_gil_enabled"); // borrowed reference
+  PyObject *result = isEnabled ? PyObject_CallNoArgs(isEnabled) : NULL;
+  bool enabled = result == Py_True;
+  Py_XDECREF(result);
+  PyErr_Clear();
+  PyErr_Restore(type, value, traceback);
+  if (enabled) {
+    gilEnabled.store(true, std::memory_order_relaxed);
+  }
+  return enabled;
+}
+#endif
+
+// the deallocations deferred by the other threads, in the order they were released
+static std::mutex deferredMutex;
+static std::vector<std::pair<PyObject *, destructor>> deferredDeallocs;
+static std::atomic<bool> hasDeferredDeallocs = false;
+
+void ContextOwner::init() {
+#ifdef Py_GIL_DISABLED
+  ownerThread = PyThread_get_thread_ident();
+#endif
+}
+
+/**
+ * @brief Whether the current thread can use the JS context now
+ *
+ * @param message - set to the reason it can't
+ */
+static bool usable(const char **message) {
+#ifdef Py_GIL_DISABLED
+  // with the GIL, the other threads take turns using the JS context as in the other builds
+  if (!isGILEnabled() && PyThread_get_thread_ident() != ownerThread) {
+    *message = "PythonMonkey's JS context belongs to the thread that imported pythonmonkey, use a pythonmonkey.Worker to run JS on other threads";
+    return false;
+  }
+#endif
+  if (GILSwitch::runningOnAnotherThread()) {
+    // the GIL was handed over, or released by Python code called from JS, the JS context cannot be used by two threads at once
+    *message = "PythonMonkey is already running JS code on another thread";
+    return false;
+  }
+  return true;
+}
+
+bool ContextOwner::check() {
+  const char *message;
+  if (!usable(&message)) {
+    PyErr_SetString(PyExc_RuntimeError, message);
+    return false;
+  }
+  runDeferredDeallocs();
+  return true;
+}
+
+bool ContextOwner::deferDealloc(PyObject *self, destructor dealloc) {
+  const char *message;
+  if (usable(&message)) {
+    return false;
+  }
+  if (PyObject_IS_GC(self)) {
+    PyObject_GC_UnTrack(self); // the cyclic GC must not see the dead object while it waits
+  }
+  std::lock_guard<std::mutex> lock(deferredMutex);
+  deferredDeallocs.emplace_back(self, dealloc);
+  hasDeferredDeallocs.store(true, std::memory_order_release);
+  return true;
+}
+
+void ContextOwner::runDeferredDeallocs() {
+  if (!hasDeferredDeallocs.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::vector<std::pair<PyObject *, destructor>> deallocs;
+  {
+    std::lock_guard<std::mutex> lock(deferredMutex);
+    std::swap(deallocs, deferredDeallocs);
+    hasDeferredDeallocs = false;
+  }
+  for (auto [self, dealloc]: deallocs) {
+    dealloc(self);
+  }
+}
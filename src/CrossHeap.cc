@@ -0,0 +1,306 @@
+/**
+ * @file CrossHeap.cc
+ * @author agent (agent@local)
+ * @brief Collection of the reference cycles that span the Python and the JS heaps
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/CrossHeap.hh"
+
+#include "include/GILSwitch.hh"
+#include "include/ProxyCache.hh"
+#include "include/jsTypeFactory.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/GCAPI.h>
+#include <js/HeapAPI.h>
+#include <js/TracingAPI.h>
+
+#include <Python.h>
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A registered Python proxy, `grayRoot` holds its JS object instead of `root` while a scan runs
+ */
+struct RegisteredProxy {
+  JS::PersistentRootedObject *root;
+  JS::Heap<JSObject *> grayRoot;
+};
+
+static JSContext *crossHeapContext = nullptr;
+static std::unordered_map<PyObject *, RegisteredProxy> proxies; // node-based, so that the JS::Heap roots don't move
+static bool scanning = false;
+// Python proxy -> new references to the Python objects it holds through the JS heap, filled in by the last scan until its Python collection stops
+static std::unordered_map<PyObject *, std::vector<PyObject *>> heldThroughJS;
+
+bool CrossHeap::enabled = false;
+
+/**
+ * @brief Release the references of the Python objects held through the JS heap, once they are out of the map as their deallocation may come back here
+ */
+static void releaseHeld(std::vector<PyObject *> &held) {
+  for (PyObject *object : held) {
+    Py_DECREF(object);
+  }
+}
+
+static void releaseAllHeld() {
+  std::unordered_map<PyObject *, std::vector<PyObject *>> released;
+  released.swap(heldThroughJS);
+  for (auto &entry : released) {
+    releaseHeld(entry.second);
+  }
+}
+
+static PyObject *gcCallbacks = nullptr; // gc.callbacks
+static PyObject *gcCallbackFunction = nullptr;
+
+static bool traceGrayRoots(JSTracer *trc, js::SliceBudget &budget, void *data) {
+  for (auto &entry : proxies) {
+    JS::TraceEdge(trc, &entry.second.grayRoot, "CrossHeap gray root");
+  }
+  return true;
+}
+
+static const uint32_t SHARED = UINT32_MAX;
+
+/**
+ * @brief Walks the gray JS things reachable from each Python proxy in turn, recording the index of the only proxy reaching each one, or SHARED
+ */
+class GrayGraphTracer : public JS::CallbackTracer {
+public:
+  std::unordered_map<void *, uint32_t> owners;
+  std::vector<JS::GCCellPtr> objects; // the gray objects walked
+
+  explicit GrayGraphTracer(JSContext *cx) : JS::CallbackTracer(cx) {}
+
+  void walk(JSObject *root, uint32_t index) {
+    current = index;
+    visit(JS::GCCellPtr(root));
+    while (!stack.empty()) {
+      JS::GCCellPtr thing = stack.back();
+      stack.pop_back();
+      JS::TraceChildren(this, thing);
+    }
+  }
+
+private:
+  uint32_t current = 0;
+  std::vector<JS::GCCellPtr> stack;
+
+  void onChild(JS::GCCellPtr thing, const char *name) override {
+    visit(thing);
+  }
+
+  void visit(JS::GCCellPtr thing) {
+    switch (thing.kind()) {
+    case JS::TraceKind::String:
+    case JS::TraceKind::Symbol:
+    case JS::TraceKind::BigInt:
+      return; // leaves, they can't lead to a Python object
+    default:
+      break;
+    }
+    if (!JS::GCThingIsMarkedGray(thing)) {
+      return; // reachable from JS
+    }
+
+    auto [it, inserted] = owners.try_emplace(thing.asCell(), current);
+    if (inserted && thing.is<JSObject>()) {
+      objects.push_back(thing);
+    } else if (!inserted) {
+      if (it->second == current || it->second == SHARED) {
+        return;
+      }
+      it->second = SHARED; // walk it again, to mark what it reaches as shared too
+    }
+    stack.push_back(thing);
+  }
+};
+
+/**
+ * @brief Find the Python objects held through the JS heap by each Python proxy, with a full JS GC tracing the roots of the proxies gray
+ */
+static void scan() {
+  JSContext *cx = crossHeapContext;
+  if (proxies.empty() || JS::RuntimeHeapIsBusy()) {
+    return;
+  }
+  if (JS::IsIncrementalGCInProgress(cx)) {
+    JS::FinishIncrementalGC(cx, JS::GCReason::API); // its roots were already marked black
+  }
+
+  std::vector<PyObject *> cachedProxies;
+  ProxyCache::takePyProxies(cachedProxies);
+  for (auto &entry : proxies) {
+    entry.second.grayRoot = entry.second.root->get();
+    entry.second.root->set(nullptr);
+  }
+  scanning = true;
+  JS::PrepareForFullGC(cx);
+  JS::NonIncrementalGC(cx, JS::GCOptions::Normal, JS::GCReason::API);
+  scanning = false;
+
+  if (js::AreGCGrayBitsValid(JS_GetRuntime(cx))) {
+    GrayGraphTracer tracer(cx);
+    std::vector<PyObject *> indexedProxies;
+    for (auto &entry : proxies) {
+      JSObject *object = entry.second.grayRoot.unbarrieredGet();
+      if (object) {
+        tracer.walk(object, indexedProxies.size());
+        indexedProxies.push_back(entry.first);
+      }
+    }
+    for (JS::GCCellPtr object : tracer.objects) {
+      uint32_t owner = tracer.owners[object.asCell()];
+      if (owner == SHARED) {
+        continue;
+      }
+      if (PyObject *held = getHeldPyObject(&object.as<JSObject>())) {
+        Py_INCREF(held); // visited by the proxy too, so the reference doesn't keep it alive, but it can't be freed before the collection stops
+        heldThroughJS[indexedProxies[owner]].push_back(held);
+      }
+    }
+  }
+
+  // giving the JS objects back to the black roots unmarks them, and what they reach, gray
+  for (auto &entry : proxies) {
+    entry.second.root->set(entry.second.grayRoot.get());
+    entry.second.grayRoot = nullptr;
+  }
+  for (PyObject *proxy : cachedProxies) {
+    auto it = proxies.find(proxy);
+    if (it != proxies.end()) { // not deallocated by the GC
+      ProxyCache::putPyProxy(*it->second.root, proxy);
+    }
+  }
+}
+
+/**
+ * @brief The callback appended to `gc.callbacks`, scans before each full collection
+ */
+static PyObject *gcCallback(PyObject *self, PyObject *args) {
+  const char *phase;
+  PyObject *info;
+  if (!PyArg_ParseTuple(args, "sO", &phase, &info)) {
+    return NULL;
+  }
+  if (!crossHeapContext) {
+    Py_RETURN_NONE;
+  }
+
+  if (strcmp(phase, "start") == 0) {
+    releaseAllHeld(); // a collection that didn't stop, e.g. interrupted by an exception
+    if (!CrossHeap::enabled) {
+      Py_RETURN_NONE;
+    }
+    PyObject *generation = PyDict_GetItemString(info, "generation"); // borrowed reference
+    if (!generation || PyLong_AsLong(generation) != 2) {
+      Py_RETURN_NONE;
+    }
+    // JS may be running on another thread that handed the GIL over, or, without the GIL, the context may belong to another thread
+    GILSwitch::AutoHandOver handOver;
+    if (!handOver.entered()) {
+      PyErr_Clear();
+      Py_RETURN_NONE;
+    }
+    scan();
+  } else if (!heldThroughJS.empty()) {
+    releaseAllHeld();
+    PyObject *collected = PyDict_GetItemString(info, "collected"); // borrowed reference
+    if (collected && PyLong_AsLong(collected) > 0 && !JS::RuntimeHeapIsBusy()) {
+      JS_GC(crossHeapContext); // release the JS side of the collected cycles
+    }
+  }
+  PyErr_Clear();
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef gcCallbackDefinition = {"pythonmonkey_cross_heap", gcCallback, METH_VARARGS, NULL};
+
+bool CrossHeap::init(JSContext *cx) {
+  JS_SetGrayGCRootsTracer(cx, traceGrayRoots, nullptr);
+  crossHeapContext = cx;
+
+  PyObject *gcModule = PyImport_ImportModule("gc");
+  if (!gcModule) {
+    return false;
+  }
+  gcCallbacks = PyObject_GetAttrString(gcModule, "callbacks");
+  Py_DECREF(gcModule);
+  if (!gcCallbacks) {
+    return false;
+  }
+  gcCallbackFunction = PyCFunction_New(&gcCallbackDefinition, NULL);
+  if (!gcCallbackFunction || PyList_Append(gcCallbacks, gcCallbackFunction) < 0) {
+    return false;
+  }
+  return true;
+}
+
+void CrossHeap::finalize() {
+  if (!crossHeapContext) {
+    return;
+  }
+  JS_SetGrayGCRootsTracer(crossHeapContext, nullptr, nullptr);
+  crossHeapContext = nullptr;
+  releaseAllHeld();
+  proxies.clear();
+
+  if (gcCallbacks && gcCallbackFunction) {
+    Py_ssize_t index = PySequence_Index(gcCallbacks, gcCallbackFunction);
+    if (index >= 0) {
+      PySequence_DelItem(gcCallbacks, index);
+    }
+    PyErr_Clear();
+  }
+  Py_CLEAR(gcCallbackFunction);
+  Py_CLEAR(gcCallbacks);
+}
+
+void CrossHeap::registerProxy(PyObject *proxy, JS::PersistentRootedObject *root) {
+  if (!crossHeapContext) {
+    return;
+  }
+  proxies.try_emplace(proxy, RegisteredProxy{root, nullptr});
+}
+
+void CrossHeap::unregisterProxy(PyObject *proxy) {
+  auto it = proxies.find(proxy);
+  if (it == proxies.end()) {
+    return;
+  }
+  if (scanning) { // deallocated by a finalizer of the scanning GC
+    it->second.root->set(it->second.grayRoot.unbarrieredGet());
+  }
+  proxies.erase(it);
+  auto held = heldThroughJS.find(proxy);
+  if (held != heldThroughJS.end()) {
+    std::vector<PyObject *> released = std::move(held->second);
+    heldThroughJS.erase(held);
+    releaseHeld(released);
+  }
+}
+
+int CrossHeap::traverse(PyObject *proxy, visitproc visit, void *arg) {
+  if (heldThroughJS.empty()) {
+    return 0;
+  }
+  auto it = heldThroughJS.find(proxy);
+  if (it == heldThroughJS.end()) {
+    return 0;
+  }
+  for (PyObject *held : it->second) {
+    Py_VISIT(held); // the reference owned by its JS holder
+    Py_VISIT(held); // the reference taken by the scan
+  }
+  return 0;
+}
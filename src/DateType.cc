@@ -15,42 +15,105 @@
 
 #include <datetime.h>
 
+#include <cmath>
+#include <cstdint>
+
+#define MS_PER_DAY 86400000LL
+
+bool DateType::datesAsTimestamps = false;
+
+/**
+ * @brief Convert days since 1970-01-01 to a proleptic Gregorian date
+ * @see http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+ */
+static void civilFromDays(int64_t days, int64_t *year, int *month, int *day) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const int64_t dayOfEra = days - era * 146097;                                    // [0, 146096]
+  const int64_t yearOfEra = (dayOfEra - dayOfEra/1460 + dayOfEra/36524 - dayOfEra/146096) / 365; // [0, 399]
+  const int64_t dayOfYear = dayOfEra - (365*yearOfEra + yearOfEra/4 - yearOfEra/100);            // [0, 365]
+  const int64_t monthFromMarch = (5*dayOfYear + 2)/153;                            // [0, 11]
+  *day = (int)(dayOfYear - (153*monthFromMarch + 2)/5 + 1);                       // [1, 31]
+  *month = (int)(monthFromMarch < 10 ? monthFromMarch + 3 : monthFromMarch - 9);  // [1, 12]
+  *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+/**
+ * @brief Convert a proleptic Gregorian date to days since 1970-01-01
+ * @see http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+ */
+static int64_t daysFromCivil(int64_t year, int month, int day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const int64_t yearOfEra = year - era * 400;                                        // [0, 399]
+  const int64_t dayOfYear = (153*(month > 2 ? month - 3 : month + 9) + 2)/5 + day - 1; // [0, 365]
+  const int64_t dayOfEra = yearOfEra * 365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;  // [0, 146096]
+  return era * 146097 + dayOfEra - 719468;
+}
+
 PyObject *DateType::getPyObject(JSContext *cx, JS::HandleObject dateObj) {
   if (!PyDateTimeAPI) { PyDateTime_IMPORT; } // for PyDateTime_FromTimestamp
 
-  JS::Rooted<JS::ValueArray<0>> args(cx);
-  JS::Rooted<JS::Value> year(cx);
-  JS::Rooted<JS::Value> month(cx);
-  JS::Rooted<JS::Value> day(cx);
-  JS::Rooted<JS::Value> hour(cx);
-  JS::Rooted<JS::Value> minute(cx);
-  JS::Rooted<JS::Value> second(cx);
-  JS::Rooted<JS::Value> usecond(cx);
-  JS_CallFunctionName(cx, dateObj, "getUTCFullYear", args, &year);
-  JS_CallFunctionName(cx, dateObj, "getUTCMonth", args, &month);
-  JS_CallFunctionName(cx, dateObj, "getUTCDate", args, &day);
-  JS_CallFunctionName(cx, dateObj, "getUTCHours", args, &hour);
-  JS_CallFunctionName(cx, dateObj, "getUTCMinutes", args, &minute);
-  JS_CallFunctionName(cx, dateObj, "getUTCSeconds", args, &second);
-  JS_CallFunctionName(cx, dateObj, "getUTCMilliseconds", args, &usecond);
-
-  PyObject *pyObject = PyDateTimeAPI->DateTime_FromDateAndTime(
-    year.toNumber(), month.toNumber() + 1, day.toNumber(),
-    hour.toNumber(), minute.toNumber(), second.toNumber(),
-    usecond.toNumber() * 1000,
+  double msecSinceEpoch;
+  if (!JS::DateGetMsecSinceEpoch(cx, dateObj, &msecSinceEpoch)) {
+    PyErr_SetString(PyExc_TypeError, "could not read the time value of a JS Date");
+    return NULL;
+  }
+  if (datesAsTimestamps) {
+    return PyFloat_FromDouble(msecSinceEpoch / 1000);
+  }
+  if (std::isnan(msecSinceEpoch)) {
+    PyErr_SetString(PyExc_ValueError, "Invalid Date cannot be converted to a Python datetime");
+    return NULL;
+  }
+
+  // the time value of a Date is an integral number of milliseconds
+  int64_t msec = (int64_t)msecSinceEpoch;
+  int64_t days = msec / MS_PER_DAY;
+  int64_t msecOfDay = msec % MS_PER_DAY;
+  if (msecOfDay < 0) { // floor division for dates before the epoch
+    msecOfDay += MS_PER_DAY;
+    days -= 1;
+  }
+  int64_t year;
+  int month, day;
+  civilFromDays(days, &year, &month, &day);
+  if (year < 1 || year > 9999) {
+    PyErr_Format(PyExc_ValueError, "year %lld is out of range", (long long)year);
+    return NULL;
+  }
+
+  return PyDateTimeAPI->DateTime_FromDateAndTime(
+    (int)year, month, day,
+    (int)(msecOfDay / 3600000), (int)(msecOfDay / 60000 % 60), (int)(msecOfDay / 1000 % 60),
+    (int)(msecOfDay % 1000) * 1000,
     PyDateTime_TimeZone_UTC, // Make the resulting Python datetime object timezone-aware
                              // See https://docs.python.org/3/library/datetime.html#aware-and-naive-objects
     PyDateTimeAPI->DateTimeType
   );
-  Py_INCREF(PyDateTime_TimeZone_UTC);
-
-  return pyObject;
 }
 
 JSObject *DateType::toJsDate(JSContext *cx, PyObject *pyObject) {
+  if (!PyDateTimeAPI) { PyDateTime_IMPORT; }
+
+  // Fast path for plain UTC datetimes, such as the ones made from JS Dates, computed without calling Python methods
+  if (PyDateTime_CheckExact(pyObject) && _PyDateTime_HAS_TZINFO(pyObject) && ((PyDateTime_DateTime *)pyObject)->tzinfo == PyDateTime_TimeZone_UTC) {
+    int64_t days = daysFromCivil(PyDateTime_GET_YEAR(pyObject), PyDateTime_GET_MONTH(pyObject), PyDateTime_GET_DAY(pyObject));
+    int64_t msec = days * MS_PER_DAY +
+                   PyDateTime_DATE_GET_HOUR(pyObject) * 3600000LL +
+                   PyDateTime_DATE_GET_MINUTE(pyObject) * 60000LL +
+                   PyDateTime_DATE_GET_SECOND(pyObject) * 1000LL +
+                   PyDateTime_DATE_GET_MICROSECOND(pyObject) / 1000;
+    return JS::NewDateObject(cx, JS::TimeClip((double)msec));
+  }
+
+  // Naive datetimes are in local time, and other timezones may be arbitrary Python code, let `timestamp()` handle them
   // See https://docs.python.org/3/library/datetime.html#datetime.datetime.timestamp
   PyObject *timestamp = PyObject_CallMethod(pyObject, "timestamp", NULL); // the result is in seconds
+  if (!timestamp) {
+    return nullptr;
+  }
   double milliseconds = PyFloat_AsDouble(timestamp) * 1000;
   Py_DECREF(timestamp);
   return JS::NewDateObject(cx, JS::TimeClip(milliseconds));
-}
\ No newline at end of file
+}
@@ -0,0 +1,308 @@
+/**
+ * @file DeepCopy.cc
+ * @author agent (agent@local)
+ * @brief Eager, structured-clone style conversion of whole object graphs between JS and Python
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/DeepCopy.hh"
+
+#include "include/BufferType.hh"
+#include "include/JSArrayProxy.hh"
+#include "include/JSObjectProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/PyBaseProxyHandler.hh"
+#include "include/StrType.hh"
+#include "include/jsTypeFactory.hh"
+#include "include/pyTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/Array.h>
+#include <js/GCHashTable.h>
+#include <js/Object.h>
+
+#include <Python.h>
+
+#include <cstring>
+#include <unordered_map>
+
+// JS object -> its Python copy (borrowed, owned by the copy being built), so that shared references and cycles are preserved
+using JSObjectToPyCopyMap = JS::GCHashMap<JSObject *, PyObject *, js::StableCellHasher<JSObject *>, js::SystemAllocPolicy>;
+
+// Python object -> index of its JS copy in the rooted vector of copies
+using PyObjectToJSCopyMap = std::unordered_map<PyObject *, size_t>;
+
+/**
+ * @brief Copy the contents of a buffer into a new memoryview of the same format, backed by a private bytearray
+ *
+ * @param view - a memoryview of the buffer
+ * @return PyObject* - a new reference to the copy, or NULL with a Python exception set
+ */
+static PyObject *copyBuffer(PyObject *view) {
+  PyObject *bytes = PyByteArray_FromObject(view);
+  if (!bytes) {
+    return NULL;
+  }
+  PyObject *copy = PyMemoryView_FromObject(bytes);
+  Py_DECREF(bytes);
+  const char *format = PyMemoryView_GET_BUFFER(view)->format;
+  if (copy && format && strcmp(format, "B") != 0) {
+    PyObject *cast = PyObject_CallMethod(copy, "cast", "s", format);
+    Py_DECREF(copy);
+    copy = cast;
+  }
+  return copy;
+}
+
+static PyObject *copyToPython(JSContext *cx, JS::HandleValue value, JS::MutableHandle<JSObjectToPyCopyMap> copies);
+
+static PyObject *copyArrayToPython(JSContext *cx, JS::HandleObject array, JS::MutableHandle<JSObjectToPyCopyMap> copies) {
+  uint32_t length;
+  if (!JS::GetArrayLength(cx, array, &length)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+
+  PyObject *list = PyList_New(length);
+  if (!list) {
+    return NULL;
+  }
+  if (!copies.put(array, list)) {
+    Py_DECREF(list);
+    PyErr_NoMemory();
+    return NULL;
+  }
+
+  JS::RootedValue element(cx);
+  for (uint32_t index = 0; index < length; index++) {
+    if (!JS_GetElement(cx, array, index, &element)) {
+      Py_DECREF(list);
+      setSpiderMonkeyException(cx);
+      return NULL;
+    }
+    PyObject *item = copyToPython(cx, element, copies);
+    if (!item) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, index, item);
+  }
+  return list;
+}
+
+static PyObject *copyObjectToPython(JSContext *cx, JS::HandleObject object, JS::MutableHandle<JSObjectToPyCopyMap> copies) {
+  JS::RootedIdVector ids(cx);
+  if (!js::GetPropertyKeys(cx, object, JSITER_OWNONLY, &ids)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+
+  PyObject *dict = PyDict_New();
+  if (!dict) {
+    return NULL;
+  }
+  if (!copies.put(object, dict)) {
+    Py_DECREF(dict);
+    PyErr_NoMemory();
+    return NULL;
+  }
+
+  JS::RootedId id(cx);
+  JS::RootedValue propertyValue(cx);
+  for (size_t index = 0; index < ids.length(); index++) {
+    id = ids[index];
+    if (!JS_GetPropertyById(cx, object, id, &propertyValue)) {
+      Py_DECREF(dict);
+      setSpiderMonkeyException(cx);
+      return NULL;
+    }
+    PyObject *key = idToKey(cx, id);
+    if (!key) {
+      Py_DECREF(dict);
+      return NULL;
+    }
+    PyObject *item = copyToPython(cx, propertyValue, copies);
+    if (!item || PyDict_SetItem(dict, key, item) < 0) {
+      Py_XDECREF(item);
+      Py_DECREF(key);
+      Py_DECREF(dict);
+      return NULL;
+    }
+    Py_DECREF(item);
+    Py_DECREF(key);
+  }
+  return dict;
+}
+
+static PyObject *copyToPython(JSContext *cx, JS::HandleValue value, JS::MutableHandle<JSObjectToPyCopyMap> copies) {
+  if (value.isString()) {
+    PyObject *string = StrType::getPyObject(cx, value);
+    if (!string || PyUnicode_CheckExact(string)) {
+      return string;
+    }
+    PyObject *copy = PyObject_Str(string); // a JSStringProxy, make a plain str that doesn't keep the JS string alive
+    Py_DECREF(string);
+    return copy;
+  }
+  if (!value.isObject()) {
+    return pyTypeFactory(cx, value);
+  }
+
+  JS::RootedObject object(cx, &value.toObject());
+  if (auto ptr = copies.lookup(object)) {
+    Py_INCREF(ptr->value());
+    return ptr->value();
+  }
+
+  // proxies of Python objects are unwrapped, and the traps of JS proxies are not run by a copy
+  if (JS::GetClass(object)->isProxyObject()) {
+    return pyTypeFactory(cx, value);
+  }
+
+  js::ESClass cls;
+  if (!JS::GetBuiltinClass(cx, object, &cls)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+
+  if (cls != js::ESClass::Array && cls != js::ESClass::Object) {
+    if (!BufferType::isSupportedJsTypes(object)) {
+      return pyTypeFactory(cx, value); // Dates are already copied, functions, promises, ... are proxied
+    }
+    PyObject *view = BufferType::getPyObject(cx, object); // shares the JS memory
+    if (!view) {
+      return NULL;
+    }
+    PyObject *copy = copyBuffer(view);
+    Py_DECREF(view);
+    if (copy && !copies.put(object, copy)) {
+      Py_DECREF(copy);
+      PyErr_NoMemory();
+      return NULL;
+    }
+    return copy;
+  }
+
+  if (Py_EnterRecursiveCall(" while copying a JS value to Python")) {
+    return NULL;
+  }
+  PyObject *copy = cls == js::ESClass::Array ? copyArrayToPython(cx, object, copies) : copyObjectToPython(cx, object, copies);
+  Py_LeaveRecursiveCall();
+  return copy;
+}
+
+PyObject *DeepCopy::toPython(JSContext *cx, JS::HandleValue value) {
+  JS::Rooted<JSObjectToPyCopyMap> copies(cx);
+  return copyToPython(cx, value, &copies);
+}
+
+static bool copyToJS(JSContext *cx, PyObject *object, JS::MutableHandleValue rval, PyObjectToJSCopyMap &indices, JS::MutableHandleObjectVector copies);
+
+static bool copyDictToJS(JSContext *cx, PyObject *dict, JS::HandleObject copy, PyObjectToJSCopyMap &indices, JS::MutableHandleObjectVector copies) {
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  JS::RootedId id(cx);
+  JS::RootedValue propertyValue(cx);
+  while (PyDict_Next(dict, &pos, &key, &value)) {
+    if (!keyToId(key, &id)) {
+      if (PyErr_Occurred()) {
+        return false;
+      }
+      continue; // like the dict proxies, keys that are neither str nor int have no JS property name
+    }
+    if (!copyToJS(cx, value, &propertyValue, indices, copies)) {
+      return false;
+    }
+    if (!JS_DefinePropertyById(cx, copy, id, propertyValue, JSPROP_ENUMERATE)) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool copySequenceToJS(JSContext *cx, PyObject *sequence, JS::HandleObject copy, PyObjectToJSCopyMap &indices, JS::MutableHandleObjectVector copies) {
+  JS::RootedValue element(cx);
+  for (Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE(sequence); index++) {
+    if (!copyToJS(cx, PySequence_Fast_GET_ITEM(sequence, index), &element, indices, copies)) {
+      return false;
+    }
+    if (!JS_DefineElement(cx, copy, index, element, JSPROP_ENUMERATE)) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool copyToJS(JSContext *cx, PyObject *object, JS::MutableHandleValue rval, PyObjectToJSCopyMap &indices, JS::MutableHandleObjectVector copies) {
+  auto it = indices.find(object);
+  if (it != indices.end()) {
+    rval.setObject(*copies[it->second]);
+    return true;
+  }
+
+  bool isDict = PyDict_Check(object) && !PyObject_TypeCheck(object, &JSObjectProxyType);
+  bool isSequence = PyTuple_Check(object) || (PyList_Check(object) && !PyObject_TypeCheck(object, &JSArrayProxyType));
+  bool isBuffer = !isDict && !isSequence && !PyObject_TypeCheck(object, &JSObjectProxyType) && PyObject_CheckBuffer(object);
+  if (!isDict && !isSequence && !isBuffer) {
+    rval.set(jsTypeFactory(cx, object)); // proxies of JS objects are unwrapped, everything else is coerced as usual
+    return !PyErr_Occurred();
+  }
+
+  JS::RootedObject copy(cx);
+  if (isBuffer) {
+    PyObject *view = PyMemoryView_FromObject(object);
+    if (!view) {
+      return false;
+    }
+    PyObject *bufferCopy = copyBuffer(view);
+    Py_DECREF(view);
+    if (!bufferCopy) {
+      return false;
+    }
+    copy = BufferType::toJsTypedArray(cx, bufferCopy); // the typed array keeps the private copy alive
+    Py_DECREF(bufferCopy);
+    if (!copy) {
+      if (!PyErr_Occurred()) {
+        setSpiderMonkeyException(cx);
+      }
+      return false;
+    }
+  }
+  else {
+    copy = isDict ? JS_NewPlainObject(cx) : JS::NewArrayObject(cx, PySequence_Fast_GET_SIZE(object));
+    if (!copy) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+  }
+
+  if (!copies.append(copy)) {
+    PyErr_NoMemory();
+    return false;
+  }
+  indices[object] = copies.length() - 1;
+  rval.setObject(*copy);
+  if (isBuffer) {
+    return true;
+  }
+
+  if (Py_EnterRecursiveCall(" while copying a Python object to JS")) {
+    return false;
+  }
+  bool ok = isDict ? copyDictToJS(cx, object, copy, indices, copies) : copySequenceToJS(cx, object, copy, indices, copies);
+  Py_LeaveRecursiveCall();
+  return ok;
+}
+
+bool DeepCopy::toJS(JSContext *cx, PyObject *object, JS::MutableHandleValue rval) {
+  PyObjectToJSCopyMap indices;
+  JS::RootedObjectVector copies(cx);
+  return copyToJS(cx, object, rval, indices, &copies);
+}
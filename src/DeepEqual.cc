@@ -0,0 +1,589 @@
+/**
+ * @file DeepEqual.cc
+ * @author agent (agent@local)
+ * @brief Structural equality of JS values and Python objects, walked natively instead of through proxies
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/DeepEqual.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/BufferType.hh"
+#include "include/JSArrayProxy.hh"
+#include "include/JSIteratorProxy.hh"
+#include "include/JSObjectProxy.hh"
+#include "include/PyBaseProxyHandler.hh"
+#include "include/jsTypeFactory.hh"
+#include "include/pyTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/Array.h>
+#include <js/Equality.h>
+#include <js/GCHashTable.h>
+#include <js/Object.h>
+#include <js/String.h>
+
+#include <Python.h>
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// JS object -> its index in the walk, a raw pointer can't be a key of the visited set since a GC may move the object during the walk
+using JSObjectIndexMap = JS::GCHashMap<JSObject *, uint32_t, js::StableCellHasher<JSObject *>, js::SystemAllocPolicy>;
+
+// (index of a JS object, Python object or tagged index of a JS object)
+using VisitedPair = std::pair<uintptr_t, uintptr_t>;
+
+struct VisitedPairHasher {
+  size_t operator()(const VisitedPair &pair) const {
+    return std::hash<uintptr_t>()(pair.first) * 31 + std::hash<uintptr_t>()(pair.second);
+  }
+};
+
+/**
+ * @brief The state of a comparison: the pairs already compared, or being compared higher up in a cycle, are taken as equal
+ */
+struct Walk {
+  JS::Rooted<JSObjectIndexMap> indices;
+  std::unordered_set<VisitedPair, VisitedPairHasher> visited;
+  std::vector<PyObject *> held; // the Python objects of the visited pairs, kept alive so that their addresses aren't reused during the walk
+
+  explicit Walk(JSContext *cx) : indices(cx) {}
+
+  ~Walk() {
+    for (PyObject *object : held) {
+      Py_DECREF(object);
+    }
+  }
+};
+
+/**
+ * @brief Get the index of a JS object in the walk, assigning it the next one the first time
+ *
+ * @return bool - false with a Python exception set if out of memory
+ */
+static bool indexOf(Walk &walk, JSObject *obj, uintptr_t *index) {
+  if (auto ptr = walk.indices.lookup(obj)) {
+    *index = ptr->value();
+    return true;
+  }
+  uint32_t next = walk.indices.count();
+  if (!walk.indices.putNew(obj, next)) {
+    PyErr_NoMemory();
+    return false;
+  }
+  *index = next;
+  return true;
+}
+
+/**
+ * @brief Record that a JS object is compared with a Python object
+ *
+ * @return int - 1 if the pair is new, 0 if it was already visited, -1 with a Python exception set
+ */
+static int visit(Walk &walk, JSObject *obj, PyObject *object) {
+  uintptr_t index;
+  if (!indexOf(walk, obj, &index)) {
+    return -1;
+  }
+  if (!walk.visited.insert({index, (uintptr_t)object}).second) {
+    return 0;
+  }
+  Py_INCREF(object);
+  walk.held.push_back(object);
+  return 1;
+}
+
+/**
+ * @brief Record that a JS object is compared with another JS object
+ */
+static int visit(Walk &walk, JSObject *obj, JSObject *other) {
+  uintptr_t index, otherIndex;
+  if (!indexOf(walk, obj, &index) || !indexOf(walk, other, &otherIndex)) {
+    return -1;
+  }
+  return walk.visited.insert({index, (otherIndex << 1) | 1}).second; // Python objects are aligned, their lowest bit is never set
+}
+
+/**
+ * @brief How a JS object is coerced to Python, which decides how it is compared
+ */
+enum class ObjectKind {
+  Array,    // a JSArrayProxy
+  Object,   // a JSObjectProxy
+  PyHeld,   // one of our proxies of a Python object, unwrapped
+  Iterable, // a JSIteratorProxy or JSIterableProxy, compared by identity as its own comparison comes back here
+  Other,    // a function, Date, Map, boxed primitive, ..., compared by Python after being converted
+};
+
+static bool kindOf(JSContext *cx, JS::HandleObject obj, ObjectKind *kind) {
+  if (getHeldPyObject(obj)) {
+    *kind = ObjectKind::PyHeld;
+    return true;
+  }
+
+  js::ESClass cls;
+  if (!JS::GetBuiltinClass(cx, obj, &cls)) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  switch (cls) {
+  case js::ESClass::Array:
+    *kind = ObjectKind::Array;
+    return true;
+  case js::ESClass::Boolean:
+  case js::ESClass::Number:
+  case js::ESClass::BigInt:
+  case js::ESClass::String:
+  case js::ESClass::Date:
+  case js::ESClass::Promise:
+  case js::ESClass::Error:
+  case js::ESClass::Function:
+  case js::ESClass::Map:
+  case js::ESClass::Set:
+    *kind = ObjectKind::Other;
+    return true;
+  default:
+    break;
+  }
+
+  // the same order as pyTypeFactory, everything not converted to something else becomes a JSObjectProxy
+  if (JS_ObjectIsBoundFunction(obj) || BufferType::isSupportedJsTypes(obj)) {
+    *kind = ObjectKind::Other;
+    return true;
+  }
+  bool iterable, async, iterator;
+  if (!JSIteratorProxyMethodDefinitions::isIterable(cx, obj, &iterable, &async, &iterator)) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  *kind = iterable ? ObjectKind::Iterable : ObjectKind::Object;
+  return true;
+}
+
+/**
+ * @brief Compare the Python value of a JS value with a Python object, by Python
+ */
+static int convertedEquals(JSContext *cx, JS::HandleValue value, PyObject *object) {
+  PyObject *converted = pyTypeFactory(cx, value);
+  if (!converted) {
+    return -1;
+  }
+  int equal = PyObject_RichCompareBool(converted, object, Py_EQ);
+  Py_DECREF(converted);
+  return equal;
+}
+
+/**
+ * @brief Compare the Python values of two JS values, by Python
+ */
+static int convertedEquals(JSContext *cx, JS::HandleValue value, JS::HandleValue other) {
+  PyObject *converted = pyTypeFactory(cx, other);
+  if (!converted) {
+    return -1;
+  }
+  int equal = convertedEquals(cx, value, converted);
+  Py_DECREF(converted);
+  return equal;
+}
+
+/**
+ * @brief Whether the type of a Python object is one that JS values are converted to, compared natively.
+ * The `__eq__` of the other types may accept anything, they are given the converted JS value.
+ */
+static bool isNativelyComparable(PyObject *object) {
+  return object == Py_None || object == getPythonMonkeyNull() || PyBool_Check(object) || PyLong_CheckExact(object) || PyFloat_CheckExact(object) ||
+         PyUnicode_Check(object) || PyList_Check(object) || PyTuple_CheckExact(object) || PyDict_Check(object);
+}
+
+/**
+ * @brief Whether a double equals a Python bool, int or float, exactly as Python compares a float with them
+ *
+ * @return int - 1 if equal, 0 if not (or not a number), -1 with a Python exception set
+ */
+static int numberEquals(double number, PyObject *object) {
+  if (PyFloat_Check(object)) {
+    return number == PyFloat_AS_DOUBLE(object);
+  }
+  if (!PyLong_Check(object)) {
+    return 0;
+  }
+  if (!std::isfinite(number) || std::trunc(number) != number) {
+    return 0;
+  }
+  if (std::fabs(number) >= 9223372036854775808.0) { // 2**63, beyond long long
+    PyObject *integer = PyLong_FromDouble(number);
+    if (!integer) {
+      return -1;
+    }
+    int equal = PyObject_RichCompareBool(integer, object, Py_EQ);
+    Py_DECREF(integer);
+    return equal;
+  }
+  int overflow;
+  long long integer = PyLong_AsLongLongAndOverflow(object, &overflow);
+  if (integer == -1 && PyErr_Occurred()) {
+    return -1;
+  }
+  return !overflow && integer == (long long)number;
+}
+
+/**
+ * @brief Whether a JS string equals a Python str, comparing their chars in place.
+ * Surrogate pairs of the JS string are compared as the code points they encode, as they are when converted.
+ *
+ * @return int - 1 if equal, 0 if not, -1 with a Python exception set
+ */
+static int stringEquals(JSContext *cx, JSString *str, PyObject *object) {
+  JSLinearString *linear = JS_EnsureLinearString(cx, str);
+  if (!linear) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+
+  JS::AutoCheckCannotGC nogc;
+  size_t length = JS::GetLinearStringLength(linear);
+  Py_ssize_t pyLength = PyUnicode_GET_LENGTH(object);
+  int kind = PyUnicode_KIND(object);
+  const void *data = PyUnicode_DATA(object);
+
+  if (JS::LinearStringHasLatin1Chars(linear)) {
+    if ((Py_ssize_t)length != pyLength) {
+      return 0;
+    }
+    const JS::Latin1Char *chars = JS::GetLatin1LinearStringChars(nogc, linear);
+    if (kind == PyUnicode_1BYTE_KIND) {
+      return length == 0 || memcmp(chars, data, length) == 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+      if (PyUnicode_READ(kind, data, i) != chars[i]) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  const char16_t *chars = JS::GetTwoByteLinearStringChars(nogc, linear);
+  if (kind != PyUnicode_4BYTE_KIND) { // no code point beyond the BMP, the lengths must match
+    if ((Py_ssize_t)length != pyLength) {
+      return 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+      if (PyUnicode_READ(kind, data, i) != chars[i]) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  Py_ssize_t pyIndex = 0;
+  for (size_t i = 0; i < length; i++, pyIndex++) {
+    if (pyIndex >= pyLength) {
+      return 0;
+    }
+    Py_UCS4 codePoint = chars[i];
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < length && chars[i + 1] >= 0xDC00 && chars[i + 1] <= 0xDFFF) {
+      codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (chars[i + 1] - 0xDC00);
+      i++;
+    }
+    if (PyUnicode_READ(kind, data, pyIndex) != codePoint) {
+      return 0;
+    }
+  }
+  return pyIndex == pyLength;
+}
+
+static int valuesEqual(JSContext *cx, JS::HandleValue value, JS::HandleValue other, Walk &walk);
+static int valueEqualsObject(JSContext *cx, JS::HandleValue value, PyObject *object, Walk &walk);
+
+/**
+ * @brief Compare a JS Array with a Python list, element by element
+ */
+static int arrayEqualsList(JSContext *cx, JS::HandleObject array, PyObject *list, Walk &walk) {
+  int visiting = visit(walk, array, list);
+  if (visiting <= 0) {
+    return visiting < 0 ? -1 : 1;
+  }
+
+  uint32_t length;
+  if (!JS::GetArrayLength(cx, array, &length)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if ((Py_ssize_t)length != PyList_GET_SIZE(list)) {
+    return 0;
+  }
+
+  JS::RootedValue element(cx);
+  for (uint32_t index = 0; index < length; index++) {
+    if (!JS_GetElement(cx, array, index, &element)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    if ((Py_ssize_t)index >= PyList_GET_SIZE(list)) { // a getter shrank the list
+      return 0;
+    }
+    PyObject *item = PyList_GET_ITEM(list, index);
+    Py_INCREF(item);
+    int equal = valueEqualsObject(cx, element, item, walk);
+    Py_DECREF(item);
+    if (equal != 1) {
+      return equal;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Compare the own enumerable properties of a JS object with the items of a Python dict
+ */
+static int objectEqualsDict(JSContext *cx, JS::HandleObject obj, PyObject *dict, Walk &walk) {
+  int visiting = visit(walk, obj, dict);
+  if (visiting <= 0) {
+    return visiting < 0 ? -1 : 1;
+  }
+
+  JS::RootedIdVector ids(cx);
+  if (!js::GetPropertyKeys(cx, obj, JSITER_OWNONLY, &ids)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if ((Py_ssize_t)ids.length() != PyDict_Size(dict)) {
+    return 0;
+  }
+
+  JS::RootedValue propertyValue(cx);
+  for (size_t i = 0; i < ids.length(); i++) {
+    PyObject *key = idToKey(cx, ids[i]);
+    if (!key) {
+      return -1;
+    }
+    PyObject *item = PyDict_GetItemWithError(dict, key);
+    Py_DECREF(key);
+    if (!item) {
+      return PyErr_Occurred() ? -1 : 0;
+    }
+    Py_INCREF(item);
+    if (!JS_GetPropertyById(cx, obj, ids[i], &propertyValue)) {
+      Py_DECREF(item);
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    int equal = valueEqualsObject(cx, propertyValue, item, walk);
+    Py_DECREF(item);
+    if (equal != 1) {
+      return equal;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Compare two JS Arrays, element by element
+ */
+static int arraysEqual(JSContext *cx, JS::HandleObject array, JS::HandleObject other, Walk &walk) {
+  int visiting = visit(walk, array, other);
+  if (visiting <= 0) {
+    return visiting < 0 ? -1 : 1;
+  }
+
+  uint32_t length, otherLength;
+  if (!JS::GetArrayLength(cx, array, &length) || !JS::GetArrayLength(cx, other, &otherLength)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if (length != otherLength) {
+    return 0;
+  }
+
+  JS::RootedValue element(cx);
+  JS::RootedValue otherElement(cx);
+  for (uint32_t index = 0; index < length; index++) {
+    if (!JS_GetElement(cx, array, index, &element) || !JS_GetElement(cx, other, index, &otherElement)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    int equal = valuesEqual(cx, element, otherElement, walk);
+    if (equal != 1) {
+      return equal;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Compare the own enumerable properties of two JS objects
+ */
+static int objectsEqual(JSContext *cx, JS::HandleObject obj, JS::HandleObject other, Walk &walk) {
+  int visiting = visit(walk, obj, other);
+  if (visiting <= 0) {
+    return visiting < 0 ? -1 : 1;
+  }
+
+  JS::RootedIdVector ids(cx);
+  JS::RootedIdVector otherIds(cx);
+  if (!js::GetPropertyKeys(cx, obj, JSITER_OWNONLY, &ids) || !js::GetPropertyKeys(cx, other, JSITER_OWNONLY, &otherIds)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if (ids.length() != otherIds.length()) {
+    return 0;
+  }
+
+  JS::RootedValue propertyValue(cx);
+  JS::RootedValue otherValue(cx);
+  for (size_t i = 0; i < ids.length(); i++) {
+    bool found;
+    if (!JS_HasOwnPropertyById(cx, other, ids[i], &found)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    if (!found) {
+      return 0;
+    }
+    if (!JS_GetPropertyById(cx, obj, ids[i], &propertyValue) || !JS_GetPropertyById(cx, other, ids[i], &otherValue)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    int equal = valuesEqual(cx, propertyValue, otherValue, walk);
+    if (equal != 1) {
+      return equal;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Compare two JS values as their Python values would compare
+ */
+static int valuesEqual(JSContext *cx, JS::HandleValue value, JS::HandleValue other, Walk &walk) {
+  if (value.isObject() && other.isObject()) {
+    if (&value.toObject() == &other.toObject()) {
+      return 1;
+    }
+
+    JS::RootedObject obj(cx, &value.toObject());
+    JS::RootedObject otherObj(cx, &other.toObject());
+    ObjectKind kind, otherKind;
+    if (!kindOf(cx, obj, &kind) || !kindOf(cx, otherObj, &otherKind)) {
+      return -1;
+    }
+    if (kind == ObjectKind::Iterable || otherKind == ObjectKind::Iterable) {
+      return 0; // not the same object
+    }
+    if (kind == ObjectKind::PyHeld || otherKind == ObjectKind::PyHeld || (kind == ObjectKind::Other && otherKind == ObjectKind::Other)) {
+      return convertedEquals(cx, value, other);
+    }
+    if (kind != otherKind) {
+      return 0; // e.g. a list and a dict, or a function and a list
+    }
+
+    if (Py_EnterRecursiveCall(" in comparison")) {
+      return -1;
+    }
+    int equal = kind == ObjectKind::Array ? arraysEqual(cx, obj, otherObj, walk) : objectsEqual(cx, obj, otherObj, walk);
+    Py_LeaveRecursiveCall();
+    return equal;
+  }
+
+  if (value.isObject() || other.isObject()) {
+    JS::RootedObject obj(cx, value.isObject() ? &value.toObject() : &other.toObject());
+    ObjectKind kind;
+    if (!kindOf(cx, obj, &kind)) {
+      return -1;
+    }
+    if (kind == ObjectKind::Array || kind == ObjectKind::Object || kind == ObjectKind::Iterable) {
+      return 0;
+    }
+    return convertedEquals(cx, value, other); // boxed primitives unbox
+  }
+
+  if (value.isNullOrUndefined() || other.isNullOrUndefined()) {
+    return value.isUndefined() == other.isUndefined() && value.isNull() == other.isNull(); // None and pythonmonkey.null
+  }
+  if ((value.isNumber() || value.isBoolean()) && (other.isNumber() || other.isBoolean())) {
+    double number = value.isBoolean() ? value.toBoolean() : value.toNumber();
+    double otherNumber = other.isBoolean() ? other.toBoolean() : other.toNumber();
+    return number == otherNumber; // True == 1.0 in Python
+  }
+  if (value.isString() || other.isString() || (value.isBigInt() && other.isBigInt())) {
+    bool equal;
+    if (!JS::StrictlyEqual(cx, value, other, &equal)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    return equal;
+  }
+  return convertedEquals(cx, value, other); // a BigInt compared with a number, or symbols
+}
+
+/**
+ * @brief Compare a JS value with a Python object, as the Python value of the JS value would compare
+ */
+static int valueEqualsObject(JSContext *cx, JS::HandleValue value, PyObject *object, Walk &walk) {
+  if (PyObject_TypeCheck(object, &JSObjectProxyType) || PyObject_TypeCheck(object, &JSArrayProxyType)) {
+    JS::RootedValue other(cx, JS::ObjectValue(PyObject_TypeCheck(object, &JSObjectProxyType) ?
+      **((JSObjectProxy *)object)->jsObject : **((JSArrayProxy *)object)->jsArray));
+    return valuesEqual(cx, value, other, walk);
+  }
+
+  if (!value.isObject()) {
+    if (!isNativelyComparable(object) || value.isBigInt() || value.isSymbol()) {
+      return convertedEquals(cx, value, object);
+    }
+    if (value.isUndefined()) {
+      return object == Py_None;
+    }
+    if (value.isNull()) {
+      return object == getPythonMonkeyNull();
+    }
+    if (value.isBoolean()) {
+      return numberEquals(value.toBoolean(), object);
+    }
+    if (value.isNumber()) {
+      return numberEquals(value.toNumber(), object);
+    }
+    return PyUnicode_Check(object) ? stringEquals(cx, value.toString(), object) : 0;
+  }
+
+  JS::RootedObject obj(cx, &value.toObject());
+  ObjectKind kind;
+  if (!kindOf(cx, obj, &kind)) {
+    return -1;
+  }
+  switch (kind) {
+  case ObjectKind::PyHeld:
+    return PyObject_RichCompareBool(getHeldPyObject(obj), object, Py_EQ);
+  case ObjectKind::Iterable:
+    return 0; // a proxy of the same object was compared by valuesEqual
+  case ObjectKind::Other:
+    return convertedEquals(cx, value, object);
+  default:
+    break;
+  }
+
+  bool isArray = kind == ObjectKind::Array;
+  if (isArray ? !PyList_Check(object) : !PyDict_Check(object)) {
+    return 0;
+  }
+  if (Py_EnterRecursiveCall(" in comparison")) {
+    return -1;
+  }
+  int equal = isArray ? arrayEqualsList(cx, obj, object, walk) : objectEqualsDict(cx, obj, object, walk);
+  Py_LeaveRecursiveCall();
+  return equal;
+}
+
+int DeepEqual::equals(JSContext *cx, JS::HandleValue value, PyObject *object) {
+  Walk walk(cx);
+  return valueEqualsObject(cx, value, object, walk);
+}
@@ -12,17 +12,34 @@
 #include "include/DictType.hh"
 
 #include "include/JSObjectProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/CrossHeap.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 
 #include <jsapi.h>
 
 
 PyObject *DictType::getPyObject(JSContext *cx, JS::Handle<JS::Value> jsObject) {
-  JSObjectProxy *proxy = (JSObjectProxy *)PyObject_CallObject((PyObject *)&JSObjectProxyType, NULL);
+  JS::RootedObject obj(cx);
+  JS_ValueToObject(cx, jsObject, &obj);
+
+  PyObject *cached = ProxyCache::getPyProxy(obj);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSObjectProxyType)) {
+      return cached;
+    }
+    Py_DECREF(cached); // the object is already proxied as another type, e.g. as a JSArrayProxy
+  }
+
+  JSObjectProxy *proxy = JSObjectProxyMethodDefinitions::allocate();
   if (proxy != NULL) {
-    JS::RootedObject obj(cx);
-    JS_ValueToObject(cx, jsObject, &obj);
-    proxy->jsObject = new JS::PersistentRootedObject(cx);
-    proxy->jsObject->set(obj);
+    proxy->jsObject = RootPool::newRoot(cx, obj);
+    ProxyCache::putPyProxy(obj, (PyObject *)proxy);
+    CrossHeap::registerProxy((PyObject *)proxy, proxy->jsObject);
+    MemoryStats::jsObjectProxies++;
+    Retention::pinJS(cx, (PyObject *)proxy);
     return (PyObject *)proxy;
   }
   return NULL;
@@ -0,0 +1,235 @@
+/**
+ * @file EngineOptions.cc
+ * @author agent (agent@local)
+ * @brief The JIT tiers and thresholds of Spidermonkey, set from the environment at import time or by pythonmonkey.setEngineOptions
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/EngineOptions.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct EngineOption {
+  const char *name;
+  JSJitCompilerOption key;
+  bool flag; // a bool, otherwise a threshold
+};
+
+static const EngineOption engineOptions[] = {
+  {"baselineInterpreter", JSJITCOMPILER_BASELINE_INTERPRETER_ENABLE, true},
+  {"baseline", JSJITCOMPILER_BASELINE_ENABLE, true},
+  {"ion", JSJITCOMPILER_ION_ENABLE, true},
+  {"offThreadCompilation", JSJITCOMPILER_OFFTHREAD_COMPILATION_ENABLE, true},
+  {"nativeRegExp", JSJITCOMPILER_NATIVE_REGEXP_ENABLE, true},
+  {"wasmBaseline", JSJITCOMPILER_WASM_JIT_BASELINE, true},
+  {"wasmOptimizing", JSJITCOMPILER_WASM_JIT_OPTIMIZING, true},
+  {"baselineInterpreterWarmUpThreshold", JSJITCOMPILER_BASELINE_INTERPRETER_WARMUP_TRIGGER, false},
+  {"baselineWarmUpThreshold", JSJITCOMPILER_BASELINE_WARMUP_TRIGGER, false},
+  {"ionWarmUpThreshold", JSJITCOMPILER_ION_NORMAL_WARMUP_TRIGGER, false},
+  {"ionFrequentBailoutThreshold", JSJITCOMPILER_ION_FREQUENT_BAILOUT_THRESHOLD, false},
+  {"inliningMaxBytecodeLength", JSJITCOMPILER_INLINING_BYTECODE_MAX_LENGTH, false},
+};
+
+// the option that is not a JIT compiler option, the perf spewer of the JITs is configured when the engine is initialized
+static const char *PERF_MAP_OPTION = "perfMap";
+static bool perfMapEnabled = false;
+
+// the IONPERF modes the perf spewer of Spidermonkey records, "none" and the other values leave it disabled
+static const char *const perfModes[] = {"func", "src", "ir", "ir-ops"};
+
+static bool isPerfMode(const char *mode) {
+  if (!mode) {
+    return false;
+  }
+  for (const char *perfMode : perfModes) {
+    if (strcmp(perfMode, mode) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static const EngineOption *findEngineOption(const char *name) {
+  for (const EngineOption &option : engineOptions) {
+    if (strcmp(option.name, name) == 0) {
+      return &option;
+    }
+  }
+  PyErr_Format(PyExc_KeyError, "unknown engine option '%s'", name);
+  return nullptr;
+}
+
+/**
+ * @brief Convert a Python value to the value of an option, -1 being the default of a threshold
+ */
+static bool toOptionValue(const EngineOption *option, PyObject *value, uint32_t *valueOut) {
+  if (option->flag) {
+    int truth = PyObject_IsTrue(value);
+    if (truth < 0) {
+      return false;
+    }
+    *valueOut = truth;
+    return true;
+  }
+  if (!PyLong_Check(value) || PyBool_Check(value)) {
+    PyErr_Format(PyExc_TypeError, "the engine option '%s' must be an int", option->name);
+    return false;
+  }
+  long long threshold = PyLong_AsLongLong(value);
+  if (threshold == -1 && PyErr_Occurred()) {
+    return false;
+  }
+  if (threshold < -1 || threshold >= UINT32_MAX) {
+    PyErr_Format(PyExc_OverflowError, "the engine option '%s' must be -1 or fit in 32 bits", option->name);
+    return false;
+  }
+  *valueOut = (uint32_t)threshold; // -1 wraps to UINT32_MAX, which the engine reads as the default
+  return true;
+}
+
+void EngineOptions::initProcess() {
+#ifndef _WIN32
+  const char *environmentOptions = getenv("PYTHONMONKEY_ENGINE_OPTIONS");
+  std::string options = environmentOptions ? std::string(",") + environmentOptions + "," : std::string();
+  bool requested = options.find(",perfMap=true,") != std::string::npos ||
+                   options.find(",perfMap=on,") != std::string::npos ||
+                   options.find(",perfMap=1,") != std::string::npos;
+  if (requested) {
+    setenv("IONPERF", "func", false); // one entry per compiled function, an IONPERF mode set by the user wins
+  }
+  perfMapEnabled = isPerfMode(getenv("IONPERF"));
+#endif
+}
+
+bool EngineOptions::init(JSContext *cx) {
+  const char *environmentOptions = getenv("PYTHONMONKEY_ENGINE_OPTIONS");
+  if (!environmentOptions || !*environmentOptions) {
+    return true;
+  }
+
+  std::vector<std::pair<const EngineOption *, uint32_t>> parsed;
+  std::string options(environmentOptions);
+  size_t start = 0;
+  while (start <= options.size()) {
+    size_t end = options.find(',', start);
+    if (end == std::string::npos) {
+      end = options.size();
+    }
+    std::string entry = options.substr(start, end - start);
+    start = end + 1;
+    if (entry.empty()) {
+      continue;
+    }
+
+    size_t equals = entry.find('=');
+    if (equals == std::string::npos) {
+      PyErr_Format(PyExc_ValueError, "PYTHONMONKEY_ENGINE_OPTIONS: expected name=value, got '%s'", entry.c_str());
+      return false;
+    }
+    std::string name = entry.substr(0, equals);
+    std::string text = entry.substr(equals + 1);
+    if (name == PERF_MAP_OPTION) {
+      continue; // applied by initProcess
+    }
+    const EngineOption *option = findEngineOption(name.c_str());
+    if (!option) {
+      return false;
+    }
+
+    uint32_t value;
+    if (text == "true" || text == "on") {
+      value = 1;
+    } else if (text == "false" || text == "off") {
+      value = 0;
+    } else {
+      char *textEnd;
+      long long number = strtoll(text.c_str(), &textEnd, 10);
+      if (text.empty() || *textEnd || number < -1 || number >= UINT32_MAX || (option->flag && number != 0 && number != 1)) {
+        PyErr_Format(PyExc_ValueError, "PYTHONMONKEY_ENGINE_OPTIONS: invalid value '%s' of '%s'", text.c_str(), name.c_str());
+        return false;
+      }
+      value = (uint32_t)number;
+    }
+    parsed.emplace_back(option, value);
+  }
+
+  for (auto &[option, value] : parsed) {
+    JS_SetGlobalJitCompilerOption(cx, option->key, value);
+  }
+  return true;
+}
+
+bool EngineOptions::set(JSContext *cx, PyObject *options) {
+  // convert them all first, so that an invalid one leaves the engine untouched
+  std::vector<std::pair<const EngineOption *, uint32_t>> converted;
+  PyObject *name, *value;
+  Py_ssize_t position = 0;
+  while (PyDict_Next(options, &position, &name, &value)) {
+    const char *nameChars = PyUnicode_AsUTF8(name);
+    if (!nameChars) {
+      return false;
+    }
+    if (strcmp(nameChars, PERF_MAP_OPTION) == 0) {
+      int truth = PyObject_IsTrue(value);
+      if (truth < 0) {
+        return false;
+      }
+      if ((bool)truth != perfMapEnabled) {
+        PyErr_SetString(PyExc_ValueError, "the engine option 'perfMap' can only be set when PythonMonkey is imported, "
+          "with PYTHONMONKEY_ENGINE_OPTIONS=perfMap=true");
+        return false;
+      }
+      continue;
+    }
+    const EngineOption *option = findEngineOption(nameChars);
+    uint32_t optionValue;
+    if (!option || !toOptionValue(option, value, &optionValue)) {
+      return false;
+    }
+    converted.emplace_back(option, optionValue);
+  }
+
+  for (auto &[option, optionValue] : converted) {
+    JS_SetGlobalJitCompilerOption(cx, option->key, optionValue);
+  }
+  return true;
+}
+
+PyObject *EngineOptions::toPython(JSContext *cx) {
+  PyObject *result = PyDict_New();
+  if (!result) {
+    return NULL;
+  }
+  for (const EngineOption &option : engineOptions) {
+    uint32_t value;
+    if (!JS_GetGlobalJitCompilerOption(cx, option.key, &value)) {
+      continue; // not readable in this build
+    }
+    PyObject *pyValue = option.flag ? PyBool_FromLong(value) : PyLong_FromUnsignedLong(value);
+    if (!pyValue || PyDict_SetItemString(result, option.name, pyValue) < 0) {
+      Py_XDECREF(pyValue);
+      Py_DECREF(result);
+      return NULL;
+    }
+    Py_DECREF(pyValue);
+  }
+  PyObject *perfMap = PyBool_FromLong(perfMapEnabled);
+  if (PyDict_SetItemString(result, PERF_MAP_OPTION, perfMap) < 0) {
+    Py_DECREF(perfMap);
+    Py_DECREF(result);
+    return NULL;
+  }
+  Py_DECREF(perfMap);
+  return result;
+}
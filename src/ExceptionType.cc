@@ -17,30 +17,284 @@
 #include "include/JSObjectProxy.hh"
 
 #include <jsapi.h>
+#include <jsfriendapi.h>
 #include <js/Exception.h>
+#include <js/SavedFrameAPI.h>
+#include <js/Stack.h>
 
 #include <Python.h>
 #include <frameobject.h>
 #include "include/pyshim.hh"
 
+#include <initializer_list>
+#include <sstream>
 
-PyObject *ExceptionType::getPyObject(JSContext *cx, JS::HandleObject error) {
-  // Convert the JS Error object to a Python string
-  JS::RootedValue errValue(cx, JS::ObjectValue(*error)); // err
-  JS::RootedObject errStack(cx, JS::ExceptionStackOrNull(error)); // err.stack
-  PyObject *errStr = getExceptionString(cx, JS::ExceptionStack(cx, errValue, errStack), true);
+#define LAZY_JS_EXCEPTION_ATTR "_jsException"
+#define LAZY_JS_EXCEPTION_CAPSULE_NAME "pythonmonkey.LazyJSException"
+
+/**
+ * @brief The JS exception wrapped by a SpiderMonkeyError, kept alive until its message is needed
+ */
+struct LazyJSException {
+  JS::PersistentRootedValue value;
+  JS::PersistentRootedObject stack;
+  bool printStackUnlessInMessage; // thrown values converted by setSpiderMonkeyException only print the JS stack if their message does not already contain it
 
-  // Construct a new SpiderMonkeyError python object
-  PyObject *pyObject = PyObject_CallOneArg(SpiderMonkeyError, errStr); // _PyErr_CreateException, https://github.com/python/cpython/blob/3.9/Python/errors.c#L100
-  Py_XDECREF(errStr);
+  LazyJSException(JSContext *cx, const JS::ExceptionStack &exceptionStack, bool thrown) :
+    value(cx, exceptionStack.exception()), stack(cx, exceptionStack.stack()), printStackUnlessInMessage(thrown) {}
+};
+
+static void LazyJSException_destructor(PyObject *capsule) {
+  delete (LazyJSException *)PyCapsule_GetPointer(capsule, LAZY_JS_EXCEPTION_CAPSULE_NAME);
+}
 
-  // Preserve the original JS Error object as the Python Exception's `jsError` attribute for lossless two-way conversion
-  PyObject *originalJsErrCapsule = DictType::getPyObject(cx, errValue);
-  PyObject_SetAttrString(pyObject, "jsError", originalJsErrCapsule);
+/**
+ * @brief Get the JS exception wrapped by a SpiderMonkeyError created by ExceptionType::newSpiderMonkeyError
+ *
+ * @return LazyJSException* - the wrapped exception, or nullptr if there is none (no Python exception is left set)
+ */
+static LazyJSException *getLazyJSException(PyObject *self) {
+  if (!PyObject_TypeCheck(self, (PyTypeObject *)SpiderMonkeyError)) {
+    return nullptr;
+  }
+  PyObject *dict = PyObject_GenericGetDict(self, NULL);
+  if (!dict) {
+    PyErr_Clear();
+    return nullptr;
+  }
+  PyObject *capsule = PyDict_GetItemString(dict, LAZY_JS_EXCEPTION_ATTR); // borrowed
+  Py_DECREF(dict);
+  if (!capsule || !PyCapsule_IsValid(capsule, LAZY_JS_EXCEPTION_CAPSULE_NAME)) {
+    return nullptr;
+  }
+  return (LazyJSException *)PyCapsule_GetPointer(capsule, LAZY_JS_EXCEPTION_CAPSULE_NAME);
+}
 
+/**
+ * @brief Format the message of the JS exception wrapped by a SpiderMonkeyError on first use and store it as the exception's `args`
+ *
+ * @return int - 0, or -1 with a Python exception set
+ */
+static int formatLazyArgs(PyObject *self) {
+  LazyJSException *lazy = getLazyJSException(self);
+  PyObject *args = ((PyBaseExceptionObject *)self)->args;
+  if (!lazy || (args && PyTuple_GET_SIZE(args) > 0)) {
+    return 0;
+  }
+
+  JSContext *cx = GLOBAL_CX;
+  bool printStack = true;
+  if (lazy->printStackUnlessInMessage && lazy->value.isObject()) {
+    // check if it is a Python Exception and already has a stack trace
+    JS::RootedObject exnObj(cx, &lazy->value.toObject());
+    JS::RootedValue tmp(cx);
+    if (JS_GetProperty(cx, exnObj, "message", &tmp) && tmp.isString()) {
+      JS::RootedString rootedStr(cx, tmp.toString());
+      JS::UniqueChars message = JS_EncodeStringToUTF8(cx, rootedStr);
+      printStack = !message || strstr(message.get(), "JS Stack Trace") == NULL;
+    }
+    JS_ClearPendingException(cx);
+  }
+
+  PyObject *errStr = getExceptionString(cx, JS::ExceptionStack(cx, lazy->value, lazy->stack), printStack);
+  if (!errStr) {
+    return -1;
+  }
+  PyObject *newArgs = PyTuple_Pack(1, errStr);
+  Py_DECREF(errStr);
+  if (!newArgs) {
+    return -1;
+  }
+  Py_XSETREF(((PyBaseExceptionObject *)self)->args, newArgs);
+  return 0;
+}
+
+/**
+ * @brief SpiderMonkeyError.__str__, the message of the wrapped JS exception
+ */
+static PyObject *SpiderMonkeyError_str(PyObject *Py_UNUSED(unused), PyObject *self) {
+  if (formatLazyArgs(self) < 0) {
+    return NULL;
+  }
+  return ((PyTypeObject *)PyExc_BaseException)->tp_str(self);
+}
+
+/**
+ * @brief SpiderMonkeyError.__repr__, with the message of the wrapped JS exception
+ */
+static PyObject *SpiderMonkeyError_repr(PyObject *Py_UNUSED(unused), PyObject *self) {
+  if (formatLazyArgs(self) < 0) {
+    return NULL;
+  }
+  return ((PyTypeObject *)PyExc_BaseException)->tp_repr(self);
+}
+
+/**
+ * @brief SpiderMonkeyError.__reduce__, pickles and copies the message and the attributes that are not bound to the JS heap
+ */
+static PyObject *SpiderMonkeyError_reduce(PyObject *Py_UNUSED(unused), PyObject *self) {
+  if (formatLazyArgs(self) < 0) {
+    return NULL;
+  }
+  PyObject *args = ((PyBaseExceptionObject *)self)->args;
+  PyObject *dict = ((PyBaseExceptionObject *)self)->dict;
+  if (!dict) {
+    return PyTuple_Pack(2, (PyObject *)Py_TYPE(self), args);
+  }
+  PyObject *state = PyDict_Copy(dict);
+  if (!state) {
+    return NULL;
+  }
+  for (const char *name : {LAZY_JS_EXCEPTION_ATTR, "jsError"}) {
+    if (PyDict_GetItemString(state, name) && PyDict_DelItemString(state, name) < 0) { // borrowed
+      Py_DECREF(state);
+      return NULL;
+    }
+  }
+  PyObject *result = PyTuple_Pack(3, (PyObject *)Py_TYPE(self), args, state);
+  Py_DECREF(state);
+  return result;
+}
+
+/**
+ * @brief The getter of SpiderMonkeyError.args
+ */
+static PyObject *SpiderMonkeyError_getArgs(PyObject *Py_UNUSED(unused), PyObject *self) {
+  if (formatLazyArgs(self) < 0) {
+    return NULL;
+  }
+  PyObject *args = ((PyBaseExceptionObject *)self)->args;
+  Py_INCREF(args);
+  return args;
+}
+
+/**
+ * @brief The setter of SpiderMonkeyError.args, the message formatted lazily is replaced
+ */
+static PyObject *SpiderMonkeyError_setArgs(PyObject *Py_UNUSED(unused), PyObject *args) {
+  PyObject *self, *value;
+  if (!PyArg_ParseTuple(args, "OO", &self, &value)) {
+    return NULL;
+  }
+  PyObject *newArgs = PySequence_Tuple(value);
+  if (!newArgs) {
+    return NULL;
+  }
+  Py_XSETREF(((PyBaseExceptionObject *)self)->args, newArgs);
+  Py_RETURN_NONE;
+}
+
+/**
+ * @brief SpiderMonkeyError.__getattr__, creates the `jsError` proxy of the wrapped JS exception on first use
+ */
+static PyObject *SpiderMonkeyError_getattr(PyObject *Py_UNUSED(unused), PyObject *args) {
+  PyObject *self, *name;
+  if (!PyArg_ParseTuple(args, "OU", &self, &name)) {
+    return NULL;
+  }
+  LazyJSException *lazy = PyUnicode_CompareWithASCIIString(name, "jsError") == 0 ? getLazyJSException(self) : nullptr;
+  if (!lazy) {
+    PyErr_Format(PyExc_AttributeError, "'%.50s' object has no attribute '%U'", Py_TYPE(self)->tp_name, name);
+    return NULL;
+  }
+  // Preserve the original JS value as the `jsError` attribute for lossless back conversion, null and undefined can't be boxed
+  PyObject *originalJsErrCapsule;
+  if (lazy->value.isNullOrUndefined()) {
+    originalJsErrCapsule = Py_None;
+    Py_INCREF(Py_None);
+  } else {
+    originalJsErrCapsule = DictType::getPyObject(GLOBAL_CX, lazy->value);
+  }
+  if (!originalJsErrCapsule || PyObject_SetAttr(self, name, originalJsErrCapsule) < 0) {
+    Py_XDECREF(originalJsErrCapsule);
+    return NULL;
+  }
+  return originalJsErrCapsule;
+}
+
+static PyMethodDef SpiderMonkeyError_str_def = {"__str__", (PyCFunction)SpiderMonkeyError_str, METH_O, NULL};
+static PyMethodDef SpiderMonkeyError_repr_def = {"__repr__", (PyCFunction)SpiderMonkeyError_repr, METH_O, NULL};
+static PyMethodDef SpiderMonkeyError_reduce_def = {"__reduce__", (PyCFunction)SpiderMonkeyError_reduce, METH_O, NULL};
+static PyMethodDef SpiderMonkeyError_getattr_def = {"__getattr__", (PyCFunction)SpiderMonkeyError_getattr, METH_VARARGS, NULL};
+static PyMethodDef SpiderMonkeyError_getArgs_def = {"args", (PyCFunction)SpiderMonkeyError_getArgs, METH_O, NULL};
+static PyMethodDef SpiderMonkeyError_setArgs_def = {"args", (PyCFunction)SpiderMonkeyError_setArgs, METH_VARARGS, NULL};
+
+static int addInstanceMethod(PyObject *dict, PyMethodDef *def) {
+  PyObject *function = PyCFunction_New(def, NULL);
+  if (!function) {
+    return -1;
+  }
+  PyObject *method = PyInstanceMethod_New(function);
+  Py_DECREF(function);
+  if (!method) {
+    return -1;
+  }
+  int res = PyDict_SetItemString(dict, def->ml_name, method);
+  Py_DECREF(method);
+  return res;
+}
+
+/**
+ * @brief Add a property, as the `args` of BaseException are read directly by its own methods, which are all overridden
+ */
+static int addProperty(PyObject *dict, PyMethodDef *getterDef, PyMethodDef *setterDef) {
+  PyObject *getter = PyCFunction_New(getterDef, NULL);
+  PyObject *setter = getter ? PyCFunction_New(setterDef, NULL) : NULL;
+  PyObject *property = setter ? PyObject_CallFunctionObjArgs((PyObject *)&PyProperty_Type, getter, setter, NULL) : NULL;
+  Py_XDECREF(setter);
+  Py_XDECREF(getter);
+  if (!property) {
+    return -1;
+  }
+  int res = PyDict_SetItemString(dict, getterDef->ml_name, property);
+  Py_DECREF(property);
+  return res;
+}
+
+PyObject *ExceptionType::newSpiderMonkeyErrorType() {
+  PyObject *dict = PyDict_New();
+  if (!dict) {
+    return NULL;
+  }
+  if (addInstanceMethod(dict, &SpiderMonkeyError_str_def) < 0 || addInstanceMethod(dict, &SpiderMonkeyError_repr_def) < 0 ||
+      addInstanceMethod(dict, &SpiderMonkeyError_reduce_def) < 0 || addInstanceMethod(dict, &SpiderMonkeyError_getattr_def) < 0 ||
+      addProperty(dict, &SpiderMonkeyError_getArgs_def, &SpiderMonkeyError_setArgs_def) < 0) {
+    Py_DECREF(dict);
+    return NULL;
+  }
+  PyObject *type = PyErr_NewException("pythonmonkey.SpiderMonkeyError", NULL, dict);
+  Py_DECREF(dict);
+  return type;
+}
+
+PyObject *ExceptionType::newSpiderMonkeyError(JSContext *cx, const JS::ExceptionStack &exceptionStack, bool thrown) {
+  PyObject *pyObject = PyObject_CallNoArgs(SpiderMonkeyError);
+  if (!pyObject) {
+    return NULL;
+  }
+  LazyJSException *lazy = new LazyJSException(cx, exceptionStack, thrown);
+  PyObject *capsule = PyCapsule_New(lazy, LAZY_JS_EXCEPTION_CAPSULE_NAME, LazyJSException_destructor);
+  if (!capsule) {
+    delete lazy;
+    Py_DECREF(pyObject);
+    return NULL;
+  }
+  if (PyObject_SetAttrString(pyObject, LAZY_JS_EXCEPTION_ATTR, capsule) < 0) {
+    Py_DECREF(capsule);
+    Py_DECREF(pyObject);
+    return NULL;
+  }
+  Py_DECREF(capsule);
   return pyObject;
 }
 
+PyObject *ExceptionType::getPyObject(JSContext *cx, JS::HandleObject error) {
+  JS::RootedValue errValue(cx, JS::ObjectValue(*error)); // err
+  JS::RootedObject errStack(cx, JS::ExceptionStackOrNull(error)); // err.stack
+  // the message is only formatted when the Python exception is printed or converted to a string
+  return newSpiderMonkeyError(cx, JS::ExceptionStack(cx, errValue, errStack), false);
+}
+
 
 // Generating trace information
 
@@ -78,238 +332,377 @@ tb_print_line_repeated(_PyUnicodeWriter *writer, long cnt)
   return err;
 }
 
-JSObject *ExceptionType::toJsError(JSContext *cx, PyObject *exceptionValue, PyObject *traceBack) {
-  assert(exceptionValue != NULL);
+/**
+ * @brief Format a Python traceback the way the `traceback` module does, without the source lines
+ *
+ * @param traceBack - the traceback, cannot be NULL
+ * @return PyObject* - a new reference to the formatted traceback, or NULL with a Python exception set
+ */
+static PyObject *formatTraceback(PyObject *traceBack) {
+  _PyUnicodeWriter writer;
+  _PyUnicodeWriter_Init(&writer);
 
-  if (PyObject_HasAttrString(exceptionValue, "jsError")) {
-    PyObject *originalJsErrCapsule = PyObject_GetAttrString(exceptionValue, "jsError");
-    if (originalJsErrCapsule && PyObject_TypeCheck(originalJsErrCapsule, &JSObjectProxyType)) {
-      return *((JSObjectProxy *)originalJsErrCapsule)->jsObject;
-    }
-  }
+  PyTracebackObject *tb = (PyTracebackObject *)traceBack;
 
-  // Gather JS context
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wformat-zero-length"
-  JS_ReportErrorASCII(cx, ""); // throw JS error and gather all details
-  #pragma GCC diagnostic pop
+  long limit = PyTraceBack_LIMIT;
 
-  JS::ExceptionStack exceptionStack(cx);
-  if (!JS::GetPendingExceptionStack(cx, &exceptionStack)) {
-    return NULL;
+  PyObject *limitv = PySys_GetObject("tracebacklimit");
+  if (limitv && PyLong_Check(limitv)) {
+    int overflow;
+    limit = PyLong_AsLongAndOverflow(limitv, &overflow);
+    if (overflow > 0) {
+      limit = LONG_MAX;
+    }
+    else if (limit <= 0) {
+      return PyUnicode_New(0, 0);
+    }
   }
-  JS_ClearPendingException(cx);
 
-  std::stringstream stackStream;
-  JS::RootedObject stackObj(cx, exceptionStack.stack());
-  if (stackObj.get()) {
-    JS::RootedString stackStr(cx);
-    JS::BuildStackString(cx, nullptr, stackObj, &stackStr, 2, js::StackFormat::SpiderMonkey);
-    JS::UniqueChars stackStrUtf8 = JS_EncodeStringToUTF8(cx, stackStr);
-    stackStream << "\nJS Stack Trace:\n" << stackStrUtf8.get();
+  PyCodeObject *code = NULL;
+  Py_ssize_t depth = 0;
+  PyObject *last_file = NULL;
+  int last_line = -1;
+  PyObject *last_name = NULL;
+  long cnt = 0;
+  PyTracebackObject *tb1 = tb;
+  int err = 0;
+
+  int res;
+  PyObject *line = PyUnicode_FromString("Traceback (most recent call last):\n");
+  if (line == NULL) {
+    goto error;
+  }
+  res = _PyUnicodeWriter_WriteStr(&writer, line);
+  Py_DECREF(line);
+  if (res < 0) {
+    goto error;
   }
 
+  // TODO should we reverse the stack and put it in the more common, non-python, top-most to bottom-most order? Wait for user feedback on experience
+  while (tb1 != NULL) {
+    depth++;
+    tb1 = tb1->tb_next;
+  }
+  while (tb != NULL && depth > limit) {
+    depth--;
+    tb = tb->tb_next;
+  }
 
-  // Gather Python context
-  PyObject *pyErrType = PyObject_Type(exceptionValue);
-  const char *pyErrTypeName = _PyType_Name((PyTypeObject *)pyErrType);
+#if PY_VERSION_HEX >= 0x03090000
 
-  PyObject *pyErrMsg = PyObject_Str(exceptionValue);
+  while (tb != NULL) {
+    code = PyFrame_GetCode(tb->tb_frame);
 
-  if (traceBack) {
-    _PyUnicodeWriter writer;
-    _PyUnicodeWriter_Init(&writer);
+    int tb_lineno = tb->tb_lineno;
+    if (tb_lineno == -1) {
+      tb_lineno = tb_get_lineno(tb);
+    }
 
-    PyObject *fileName = NULL;
-    int lineno = -1;
+    if (last_file == NULL ||
+        code->co_filename != last_file ||
+        last_line == -1 || tb_lineno != last_line ||
+        last_name == NULL || code->co_name != last_name) {
 
-    PyTracebackObject *tb = (PyTracebackObject *)traceBack;
+      if (cnt > TB_RECURSIVE_CUTOFF) {
+        if (tb_print_line_repeated(&writer, cnt) < 0) {
+          goto error;
+        }
+      }
+      last_file = code->co_filename;
+      last_line = tb_lineno;
+      last_name = code->co_name;
+      cnt = 0;
+    }
 
-    long limit = PyTraceBack_LIMIT;
+    cnt++;
 
-    PyObject *limitv = PySys_GetObject("tracebacklimit");
-    if (limitv && PyLong_Check(limitv)) {
-      int overflow;
-      limit = PyLong_AsLongAndOverflow(limitv, &overflow);
-      if (overflow > 0) {
-        limit = LONG_MAX;
+    if (cnt <= TB_RECURSIVE_CUTOFF) {
+      line = PyUnicode_FromFormat("File \"%U\", line %d, in %U\n", code->co_filename, tb_lineno, code->co_name);
+      if (line == NULL) {
+        goto error;
       }
-      else if (limit <= 0) {
-        return NULL;
+
+      int res = _PyUnicodeWriter_WriteStr(&writer, line);
+      Py_DECREF(line);
+      if (res < 0) {
+        goto error;
       }
     }
 
-    PyCodeObject *code = NULL;
-    Py_ssize_t depth = 0;
-    PyObject *last_file = NULL;
-    int last_line = -1;
-    PyObject *last_name = NULL;
-    long cnt = 0;
-    PyTracebackObject *tb1 = tb;
-    int err = 0;
-
-    int res;
-    PyObject *line = PyUnicode_FromString("Traceback (most recent call last):\n");
-    if (line == NULL) {
-      goto error;
-    }
-    res = _PyUnicodeWriter_WriteStr(&writer, line);
-    Py_DECREF(line);
-    if (res < 0) {
+    Py_CLEAR(code);
+    tb = tb->tb_next;
+  }
+  if (cnt > TB_RECURSIVE_CUTOFF) {
+    if (tb_print_line_repeated(&writer, cnt) < 0) {
       goto error;
     }
+  }
 
-    // TODO should we reverse the stack and put it in the more common, non-python, top-most to bottom-most order? Wait for user feedback on experience
-    while (tb1 != NULL) {
-      depth++;
-      tb1 = tb1->tb_next;
+#else
+
+  while (tb != NULL && err == 0) {
+    if (last_file == NULL ||
+        tb->tb_frame->f_code->co_filename != last_file ||
+        last_line == -1 || tb->tb_lineno != last_line ||
+        last_name == NULL || tb->tb_frame->f_code->co_name != last_name) {
+      if (cnt > TB_RECURSIVE_CUTOFF) {
+        err = tb_print_line_repeated(&writer, cnt);
+      }
+      last_file = tb->tb_frame->f_code->co_filename;
+      last_line = tb->tb_lineno;
+      last_name = tb->tb_frame->f_code->co_name;
+      cnt = 0;
     }
-    while (tb != NULL && depth > limit) {
-      depth--;
-      tb = tb->tb_next;
+    cnt++;
+    if (err == 0 && cnt <= TB_RECURSIVE_CUTOFF) {
+      line = PyUnicode_FromFormat("File \"%U\", line %d, in %U\n", tb->tb_frame->f_code->co_filename, tb->tb_lineno, tb->tb_frame->f_code->co_name);
+      if (line == NULL) {
+        goto error;
+      }
+
+      int res = _PyUnicodeWriter_WriteStr(&writer, line);
+      Py_DECREF(line);
+      if (res < 0) {
+        goto error;
+      }
     }
+    tb = tb->tb_next;
+  }
+  if (err == 0 && cnt > TB_RECURSIVE_CUTOFF) {
+    err = tb_print_line_repeated(&writer, cnt);
+  }
 
-#if PY_VERSION_HEX >= 0x03090000
+  if (err) {
+    goto error;
+  }
 
-    while (tb != NULL) {
-      code = PyFrame_GetCode(tb->tb_frame);
+#endif
 
-      int tb_lineno = tb->tb_lineno;
-      if (tb_lineno == -1) {
-        tb_lineno = tb_get_lineno(tb);
-      }
+  return _PyUnicodeWriter_Finish(&writer);
 
-      if (last_file == NULL ||
-          code->co_filename != last_file ||
-          last_line == -1 || tb_lineno != last_line ||
-          last_name == NULL || code->co_name != last_name) {
+error:
+  _PyUnicodeWriter_Dealloc(&writer);
+  Py_XDECREF(code);
+  return NULL;
+}
 
-        if (cnt > TB_RECURSIVE_CUTOFF) {
-          if (tb_print_line_repeated(&writer, cnt) < 0) {
-            goto error;
-          }
-        }
-        last_file = code->co_filename;
-        last_line = tb_lineno;
-        last_name = code->co_name;
-        cnt = 0;
-      }
+/**
+ * @brief Get the location of the innermost frame of a Python traceback
+ *
+ * @param traceBack - the traceback, cannot be NULL
+ * @param lineno - set to the line number
+ * @return PyObject* - a new reference to the file name
+ */
+static PyObject *tracebackLocation(PyObject *traceBack, int *lineno) {
+  PyTracebackObject *tb = (PyTracebackObject *)traceBack;
+  while (tb->tb_next != NULL) {
+    tb = tb->tb_next;
+  }
+#if PY_VERSION_HEX >= 0x03090000
+  *lineno = tb->tb_lineno == -1 ? tb_get_lineno(tb) : tb->tb_lineno;
+  PyCodeObject *code = PyFrame_GetCode(tb->tb_frame);
+  PyObject *fileName = code->co_filename;
+  Py_INCREF(fileName);
+  Py_DECREF(code);
+  return fileName;
+#else
+  *lineno = tb->tb_lineno;
+  Py_INCREF(tb->tb_frame->f_code->co_filename);
+  return tb->tb_frame->f_code->co_filename;
+#endif
+}
 
-      cnt++;
+// Lazily formatted `message` of the JS Errors converted from Python exceptions
 
-      if (cnt <= TB_RECURSIVE_CUTOFF) {
-        fileName = code->co_filename;
-        lineno = tb_lineno;
+enum PyExceptionHolderSlots {
+  PyExceptionHolderExceptionSlot, // the Python exception
+  PyExceptionHolderTracebackSlot, // its traceback, can be null
+  PyExceptionHolderMessageSlot, // the message once formatted, or the value it was set to
+  PyExceptionHolderSlotCount
+};
 
-        line = PyUnicode_FromFormat("File \"%U\", line %d, in %U\n", fileName, lineno, code->co_name);
-        if (line == NULL) {
-          goto error;
-        }
+/**
+ * @brief Releases the python exception and traceback held in the reserved slots when the holder is finalized
+ */
+static void pyExceptionHolderFinalize(JS::GCContext *gcx, JSObject *holder) {
+  // We cannot call Py_DECREF here when shutting down as the thread state is gone.
+  if (Py_IsFinalizing()) { return; }
 
-        int res = _PyUnicodeWriter_WriteStr(&writer, line);
-        Py_DECREF(line);
-        if (res < 0) {
-          goto error;
-        }
-      }
+  Py_XDECREF(JS::GetMaybePtrFromReservedSlot<PyObject>(holder, PyExceptionHolderExceptionSlot));
+  Py_XDECREF(JS::GetMaybePtrFromReservedSlot<PyObject>(holder, PyExceptionHolderTracebackSlot));
+}
 
-      Py_CLEAR(code);
-      tb = tb->tb_next;
-    }
-    if (cnt > TB_RECURSIVE_CUTOFF) {
-      if (tb_print_line_repeated(&writer, cnt) < 0) {
-        goto error;
-      }
-    }
+static const JSClassOps pyExceptionHolderClassOps = {
+  .finalize = pyExceptionHolderFinalize,
+};
 
-#else
+static const JSClass pyExceptionHolderClass = {
+  "PyExceptionHolder",
+  JSCLASS_HAS_RESERVED_SLOTS(PyExceptionHolderSlotCount) | JSCLASS_FOREGROUND_FINALIZE,
+  &pyExceptionHolderClassOps
+};
 
-    while (tb != NULL && err == 0) {
-      if (last_file == NULL ||
-          tb->tb_frame->f_code->co_filename != last_file ||
-          last_line == -1 || tb->tb_lineno != last_line ||
-          last_name == NULL || tb->tb_frame->f_code->co_name != last_name) {
-        if (cnt > TB_RECURSIVE_CUTOFF) {
-          err = tb_print_line_repeated(&writer, cnt);
-        }
-        last_file = tb->tb_frame->f_code->co_filename;
-        last_line = tb->tb_lineno;
-        last_name = tb->tb_frame->f_code->co_name;
-        cnt = 0;
-      }
-      cnt++;
-      if (err == 0 && cnt <= TB_RECURSIVE_CUTOFF) {
-        fileName = tb->tb_frame->f_code->co_filename;
-        lineno = tb->tb_lineno;
+/**
+ * @brief The setter of the `message` property of the JS Errors converted from Python exceptions, the holder is in the 0th reserved slot of the function
+ */
+static bool lazyMessageSetter(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JSObject *holder = &js::GetFunctionNativeReserved(&args.callee(), 0).toObject();
+  JS::SetReservedSlot(holder, PyExceptionHolderMessageSlot, args.get(0));
+  args.rval().setUndefined();
+  return true;
+}
 
-        line = PyUnicode_FromFormat("File \"%U\", line %d, in %U\n", fileName, lineno, tb->tb_frame->f_code->co_name);
-        if (line == NULL) {
-          goto error;
-        }
+/**
+ * @brief The getter of the `message` property of the JS Errors converted from Python exceptions, the holder is in the 0th reserved slot of the function.
+ * The Python exception string and traceback are only formatted the first time the message is read, and then cached in the holder.
+ */
+static bool lazyMessageGetter(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject holder(cx, &js::GetFunctionNativeReserved(&args.callee(), 0).toObject());
+
+  JS::Value cached = JS::GetReservedSlot(holder, PyExceptionHolderMessageSlot);
+  if (!cached.isUndefined()) {
+    args.rval().set(cached);
+    return true;
+  }
 
-        int res = _PyUnicodeWriter_WriteStr(&writer, line);
-        Py_DECREF(line);
-        if (res < 0) {
-          goto error;
-        }
-      }
-      tb = tb->tb_next;
-    }
-    if (err == 0 && cnt > TB_RECURSIVE_CUTOFF) {
-      err = tb_print_line_repeated(&writer, cnt);
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback); // JS may read the message while a Python exception is being converted
+
+  // Gather Python context
+  PyObject *exceptionValue = JS::GetMaybePtrFromReservedSlot<PyObject>(holder, PyExceptionHolderExceptionSlot);
+  PyObject *traceBack = JS::GetMaybePtrFromReservedSlot<PyObject>(holder, PyExceptionHolderTracebackSlot);
+
+  std::stringstream msgStream;
+  msgStream << "Python " << _PyType_Name(Py_TYPE(exceptionValue)) << ": ";
+  PyObject *pyErrMsg = PyObject_Str(exceptionValue);
+  if (pyErrMsg) {
+    msgStream << PyUnicode_AsUTF8(pyErrMsg);
+    Py_DECREF(pyErrMsg);
+  }
+  if (traceBack) {
+    PyObject *traceBackStr = formatTraceback(traceBack);
+    if (traceBackStr) {
+      msgStream << "\n" << PyUnicode_AsUTF8(traceBackStr);
+      Py_DECREF(traceBackStr);
     }
+  }
+  PyErr_Clear();
+  PyErr_Restore(type, value, traceback);
 
-    if (err) {
-      goto error;
+  // Gather JS context, the stack captured when the Error was created
+  JS::RootedObject stackObj(cx, args.thisv().isObject() ? JS::ExceptionStackOrNull(&args.thisv().toObject()) : nullptr);
+  if (stackObj) {
+    JS::RootedString stackStr(cx);
+    if (!JS::BuildStackString(cx, nullptr, stackObj, &stackStr, 2, js::StackFormat::SpiderMonkey)) {
+      return false;
+    }
+    JS::UniqueChars stackStrUtf8 = JS_EncodeStringToUTF8(cx, stackStr);
+    if (!stackStrUtf8) {
+      return false;
     }
+    msgStream << "\nJS Stack Trace:\n" << stackStrUtf8.get();
+  }
 
-#endif
+  std::string msg = msgStream.str();
+  JSString *message = JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(msg.c_str(), msg.length()));
+  if (!message) {
+    return false;
+  }
+  JS::SetReservedSlot(holder, PyExceptionHolderMessageSlot, JS::StringValue(message));
+  args.rval().setString(message);
+  return true;
+}
 
-    {
-      std::stringstream msgStream;
-      msgStream << "Python " << pyErrTypeName << ": " << PyUnicode_AsUTF8(pyErrMsg) << "\n" << PyUnicode_AsUTF8(_PyUnicodeWriter_Finish(&writer));
-      msgStream << stackStream.str();
-
-      JS::RootedValue rval(cx);
-      JS::RootedString filename(cx, JS_NewStringCopyZ(cx, PyUnicode_AsUTF8(fileName)));
-      JS::RootedString message(cx, JS_NewStringCopyZ(cx, msgStream.str().c_str()));
-      // stack argument cannot be passed in as a string anymore (deprecated), and could not find a proper example using the new argument type
-      if (!JS::CreateError(cx, JSExnType::JSEXN_ERR, nullptr, filename, lineno, JS::ColumnNumberOneOrigin(1), nullptr, message, JS::NothingHandleValue, &rval)) {
-        return NULL;
-      }
+bool ExceptionType::hasLazyMessage(JSContext *cx, JS::HandleObject error) {
+  JS::Rooted<mozilla::Maybe<JS::PropertyDescriptor>> desc(cx);
+  if (!JS_GetOwnPropertyDescriptor(cx, error, "message", &desc)) {
+    JS_ClearPendingException(cx);
+    return false;
+  }
+  return desc.isSome() && desc->hasGetter() && desc->getter() && JS_IsNativeFunction(desc->getter(), lazyMessageGetter);
+}
 
-      Py_DECREF(pyErrType);
-      Py_DECREF(pyErrMsg);
+JSObject *ExceptionType::toJsError(JSContext *cx, PyObject *exceptionValue, PyObject *traceBack) {
+  assert(exceptionValue != NULL);
 
-      return rval.toObjectOrNull();
-    }
+  LazyJSException *lazy = getLazyJSException(exceptionValue);
+  if (lazy && lazy->value.isObject()) {
+    return &lazy->value.toObject();
+  }
+  // a thrown primitive goes through its `jsError` proxy, like the attribute set on any other exception
 
-  error:
-    _PyUnicodeWriter_Dealloc(&writer);
-    Py_XDECREF(code);
+  if (PyObject_HasAttrString(exceptionValue, "jsError")) {
+    PyObject *originalJsErrCapsule = PyObject_GetAttrString(exceptionValue, "jsError");
+    if (originalJsErrCapsule && PyObject_TypeCheck(originalJsErrCapsule, &JSObjectProxyType)) {
+      return *((JSObjectProxy *)originalJsErrCapsule)->jsObject;
+    }
   }
 
-  // gather additional JS context details
-  JS::ErrorReportBuilder reportBuilder(cx);
-  if (!reportBuilder.init(cx, exceptionStack, JS::ErrorReportBuilder::WithSideEffects)) {
+  // Gather JS context, only the SavedFrame objects: the stack string is built by SpiderMonkey when `stack` is read
+  JS::RootedObject stackObj(cx);
+  if (!JS::CaptureCurrentStack(cx, &stackObj)) {
     return NULL;
   }
-  JSErrorReport *errorReport = reportBuilder.report();
 
-  std::stringstream msgStream;
-  msgStream << "Python " << pyErrTypeName << ": " << PyUnicode_AsUTF8(pyErrMsg);
-  msgStream << stackStream.str();
+  // Gather the location of the error
+  JS::RootedString filename(cx);
+  uint32_t lineno = 0;
+  if (traceBack) {
+    int tbLineno;
+    PyObject *fileName = tracebackLocation(traceBack, &tbLineno);
+    const char *fileNameUtf8 = PyUnicode_AsUTF8(fileName);
+    if (fileNameUtf8) {
+      filename = JS_NewStringCopyUTF8Z(cx, JS::ConstUTF8CharsZ(fileNameUtf8, strlen(fileNameUtf8)));
+      lineno = tbLineno;
+    }
+    PyErr_Clear();
+    Py_DECREF(fileName);
+  }
+  else if (stackObj) {
+    JS::SavedFrameResult result = JS::GetSavedFrameSource(cx, nullptr, stackObj, &filename);
+    if (result == JS::SavedFrameResult::Ok) {
+      JS::GetSavedFrameLine(cx, nullptr, stackObj, &lineno);
+    }
+  }
+  if (!filename) {
+    filename = JS_GetEmptyString(cx); // cannot be null
+  }
 
+  // The message is defined below as an accessor
   JS::RootedValue rval(cx);
-  JS::RootedString filename(cx, JS_NewStringCopyZ(cx, "")); // cannot be null or omitted, but is overriden by the errorReport
-  JS::RootedString message(cx, JS_NewStringCopyZ(cx, msgStream.str().c_str()));
-  // filename cannot be null
-  if (!JS::CreateError(cx, JSExnType::JSEXN_ERR, nullptr, filename, 0, JS::ColumnNumberOneOrigin(1), errorReport, message, JS::NothingHandleValue, &rval)) {
+  JS::RootedString message(cx);
+  if (!JS::CreateError(cx, JSExnType::JSEXN_ERR, stackObj, filename, lineno, JS::ColumnNumberOneOrigin(1), nullptr, message, JS::NothingHandleValue, &rval)) {
     return NULL;
   }
+  JS::RootedObject error(cx, &rval.toObject());
 
-  Py_DECREF(pyErrType);
-  Py_DECREF(pyErrMsg);
+  // Keep the Python exception and traceback around to format the message if it is ever read
+  JS::RootedObject holder(cx, JS_NewObject(cx, &pyExceptionHolderClass));
+  if (!holder) {
+    return NULL;
+  }
+  Py_INCREF(exceptionValue);
+  JS::SetReservedSlot(holder, PyExceptionHolderExceptionSlot, JS::PrivateValue((void *)exceptionValue));
+  Py_XINCREF(traceBack);
+  JS::SetReservedSlot(holder, PyExceptionHolderTracebackSlot, JS::PrivateValue((void *)traceBack));
 
-  return rval.toObjectOrNull();
-}
\ No newline at end of file
+  JSFunction *getter = js::NewFunctionWithReserved(cx, lazyMessageGetter, 0, 0, "message");
+  if (!getter) {
+    return NULL;
+  }
+  JS::RootedObject getterObj(cx, JS_GetFunctionObject(getter));
+  js::SetFunctionNativeReserved(getterObj, 0, JS::ObjectValue(*holder));
+  JSFunction *setter = js::NewFunctionWithReserved(cx, lazyMessageSetter, 1, 0, "message");
+  if (!setter) {
+    return NULL;
+  }
+  JS::RootedObject setterObj(cx, JS_GetFunctionObject(setter));
+  js::SetFunctionNativeReserved(setterObj, 0, JS::ObjectValue(*holder));
+  if (!JS_DefineProperty(cx, error, "message", getterObj, setterObj, 0)) {
+    return NULL;
+  }
+
+  return error;
+}
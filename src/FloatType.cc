@@ -10,8 +10,26 @@
 
 #include "include/FloatType.hh"
 
+#include <cmath>
+
+bool FloatType::int32AsInt = false;
+bool FloatType::integralAsInt = false;
+
 PyObject *FloatType::getPyObject(double n) {
-  PyObject *doubleVal = Py_BuildValue("d", n);
-  Py_INCREF(doubleVal);
-  return doubleVal;
+  return PyFloat_FromDouble(n);
+}
+
+PyObject *FloatType::getPyObject(const JS::Value &number) {
+  if (number.isInt32()) {
+    if (int32AsInt || integralAsInt) {
+      return PyLong_FromLong(number.toInt32());
+    }
+    return PyFloat_FromDouble(number.toInt32());
+  }
+
+  double n = number.toDouble();
+  if (integralAsInt && std::trunc(n) == n && std::fabs(n) <= MAX_SAFE_INTEGER && !(n == 0 && std::signbit(n))) {
+    return PyLong_FromLongLong((long long)n);
+  }
+  return PyFloat_FromDouble(n);
 }
\ No newline at end of file
@@ -15,7 +15,10 @@
 
 
 PyObject *FuncType::getPyObject(JSContext *cx, JS::HandleValue fval) {
-  JSFunctionProxy *proxy = (JSFunctionProxy *)PyObject_CallObject((PyObject *)&JSFunctionProxyType, NULL);
+  JSFunctionProxy *proxy = (JSFunctionProxy *)JSFunctionProxyMethodDefinitions::JSFunctionProxy_new(&JSFunctionProxyType, NULL, NULL);
+  if (!proxy) {
+    return NULL;
+  }
   proxy->jsFunc->set(&fval.toObject());
   return (PyObject *)proxy;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+/**
+ * @file GILSwitch.cc
+ * @author agent (agent@local)
+ * @brief Hand the GIL over to the other Python threads at regular intervals while JS code runs
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/GILSwitch.hh"
+
+#include "include/ContextOwner.hh"
+#include "include/ConsoleSink.hh"
+
+#include <jsapi.h>
+
+#include <Python.h>
+#include <pythread.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+bool GILSwitch::enabled = false;
+
+static JSContext *switchCx = nullptr;
+static unsigned long jsThread = 0; // the thread running JS, while `depth > 0`
+static size_t depth = 0; // nesting of the entry points currently running JS, only changed while holding the GIL
+
+/**
+ * @brief The state of the ticker thread that requests the interrupts, leaked as the thread may still wait on it at exit
+ */
+struct Ticker {
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool running = false; // JS is running, and the GIL should be handed over
+  bool started = false;
+  std::chrono::duration<double> interval = std::chrono::milliseconds(5);
+};
+static Ticker *ticker = new Ticker();
+
+static void tickerThread(void *Py_UNUSED(unused)) {
+  std::unique_lock<std::mutex> lock(ticker->mutex);
+  for (;;) {
+    ticker->changed.wait(lock, [] { return ticker->running; });
+    // a call that returns within the interval is not interrupted at all
+    if (!ticker->changed.wait_for(lock, ticker->interval, [] { return !ticker->running; })) {
+      JS_RequestInterruptCallback(switchCx); // may be called from any thread
+    }
+  }
+}
+
+static void setTickerRunning(bool running) {
+  {
+    std::lock_guard<std::mutex> lock(ticker->mutex);
+    ticker->running = running;
+  }
+  ticker->changed.notify_all();
+}
+
+static bool handOverGIL(JSContext *Py_UNUSED(cx)) {
+  if (depth == 0 || !GILSwitch::enabled) {
+    return true; // another interrupt, e.g. requested just after the JS code returned
+  }
+  // the other threads waiting for the GIL take it now, see FORCE_SWITCHING in CPython's ceval_gil.c
+  PyThreadState *threadState = PyEval_SaveThread();
+  PyEval_RestoreThread(threadState);
+  return true;
+}
+
+bool GILSwitch::init(JSContext *cx) {
+  switchCx = cx;
+  return JS_AddInterruptCallback(cx, handOverGIL);
+}
+
+bool GILSwitch::setEnabled(bool enable) {
+  if (enable) {
+    PyObject *sys = PyImport_ImportModule("sys");
+    PyObject *interval = sys ? PyObject_CallMethod(sys, "getswitchinterval", NULL) : NULL;
+    Py_XDECREF(sys);
+    if (!interval) {
+      return false;
+    }
+    double seconds = PyFloat_AsDouble(interval);
+    Py_DECREF(interval);
+    if (seconds == -1 && PyErr_Occurred()) {
+      return false;
+    }
+
+    bool startTicker;
+    {
+      std::lock_guard<std::mutex> lock(ticker->mutex);
+      ticker->interval = std::chrono::duration<double>(seconds);
+      startTicker = !ticker->started;
+      ticker->started = true;
+    }
+    if (startTicker && PyThread_start_new_thread(tickerThread, nullptr) == (unsigned long)-1) {
+      ticker->started = false;
+      PyErr_SetString(PyExc_RuntimeError, "PythonMonkey could not start the thread handing the GIL over");
+      return false;
+    }
+  }
+  enabled = enable;
+  setTickerRunning(enabled && depth > 0);
+  return true;
+}
+
+bool GILSwitch::runningOnAnotherThread() {
+  return depth > 0 && jsThread != PyThread_get_thread_ident();
+}
+
+GILSwitch::AutoHandOver::AutoHandOver() : _entered(true) {
+  if (!ContextOwner::check()) { // also raises if JS is running on another thread
+    _entered = false;
+    return;
+  }
+  if (depth++ == 0) {
+    jsThread = PyThread_get_thread_ident();
+    if (enabled) {
+      setTickerRunning(true);
+    }
+  }
+}
+
+GILSwitch::AutoHandOver::~AutoHandOver() {
+  if (_entered && --depth == 0) {
+    if (enabled) {
+      setTickerRunning(false);
+    }
+    ConsoleSink::flushPending(); // the end of the job, its console output goes out before Python prints
+    ContextOwner::runDeferredDeallocs(); // the proxies released by the other threads while the GIL was handed over
+  }
+}
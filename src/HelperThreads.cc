@@ -0,0 +1,113 @@
+/**
+ * @file HelperThreads.cc
+ * @author agent (agent@local)
+ * @brief The threads running the off-thread tasks of SpiderMonkey (background GC, JIT and Wasm compilation, ...)
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/HelperThreads.hh"
+
+#include <js/HelperThreadAPI.h>
+
+#include <Python.h>
+#include <pythread.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static const size_t helperStackSize = 2 * 1024 * 1024; // as much as the threads of SpiderMonkey's internal pool get
+
+/**
+ * @brief The state of the helper threads, leaked as they may still wait on it at exit
+ */
+struct HelperPool {
+  std::mutex mutex;
+  std::condition_variable dispatched; // a task was dispatched, or the threads are stopping
+  std::condition_variable exited; // a thread exited
+  size_t pendingTasks = 0; // dispatched, each is run by one `JS::RunHelperThreadTask` call
+  size_t liveThreads = 0;
+  bool stopping = false;
+};
+static HelperPool *pool = new HelperPool();
+static size_t threadCount = 0;
+
+static void dispatchTask(JS::DispatchReason Py_UNUSED(reason)) {
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->pendingTasks++;
+  }
+  pool->dispatched.notify_one();
+}
+
+/**
+ * @brief A helper thread, it never touches Python. It only exits once no task is pending, so stopping the threads drains the tasks
+ */
+static void helperThread(void *Py_UNUSED(unused)) {
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  for (;;) {
+    pool->dispatched.wait(lock, [] { return pool->pendingTasks > 0 || pool->stopping; });
+    if (pool->pendingTasks == 0) {
+      break;
+    }
+    pool->pendingTasks--;
+    lock.unlock();
+    JS::RunHelperThreadTask();
+    lock.lock();
+  }
+  pool->liveThreads--;
+  pool->exited.notify_all();
+}
+
+static bool startThreads() {
+  // PyThread_start_new_thread is the portable way to choose the stack size of a native thread, it then goes back to the one of Python threads
+  size_t pythonStackSize = PyThread_get_stacksize();
+  PyThread_set_stacksize(helperStackSize);
+  bool ok = true;
+  for (size_t i = 0; i < threadCount && ok; i++) {
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      pool->liveThreads++;
+    }
+    if (PyThread_start_new_thread(helperThread, nullptr) == (unsigned long)-1) {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      pool->liveThreads--;
+      ok = i > 0; // fewer threads only make the tasks wait longer
+    }
+  }
+  PyThread_set_stacksize(pythonStackSize);
+  if (!ok) {
+    PyErr_SetString(PyExc_RuntimeError, "PythonMonkey could not start the SpiderMonkey helper threads");
+  }
+  return ok;
+}
+
+bool HelperThreads::init() {
+  threadCount = std::max(2u, std::thread::hardware_concurrency());
+  JS::SetHelperThreadTaskCallback(dispatchTask, threadCount, helperStackSize);
+  return startThreads();
+}
+
+void HelperThreads::quiesce() {
+  {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->stopping = true;
+    pool->dispatched.notify_all();
+    pool->exited.wait(lock, [] { return pool->liveThreads == 0; });
+  }
+}
+
+bool HelperThreads::restart() {
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    if (!pool->stopping) {
+      return true;
+    }
+    pool->stopping = false;
+  }
+  return startThreads();
+}
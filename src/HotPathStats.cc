@@ -0,0 +1,119 @@
+/**
+ * @file HotPathStats.cc
+ * @author agent (agent@local)
+ * @brief Per-thread counters, and cycle timers in the Profile and DRelease builds, of the conversions and of the proxy traps and methods
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/HotPathStats.hh"
+
+#include <Python.h>
+
+#include <mutex>
+
+struct HotPathName {
+  const char *group;
+  const char *name;
+};
+
+static const HotPathName hotPathNames[HotPathStats::COUNTERS] = {
+#define PYTHONMONKEY_HOT_PATH_NAME(group, name) {#group, #name},
+  PYTHONMONKEY_HOT_PATHS(PYTHONMONKEY_HOT_PATH_NAME)
+#undef PYTHONMONKEY_HOT_PATH_NAME
+};
+
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+#ifdef PYTHONMONKEY_HOT_PATH_TSC
+static const char *timeUnit = "cycles";
+#else
+static const char *timeUnit = "ns";
+#endif
+#endif
+
+static std::mutex blocksMutex;
+static HotPathStats::Block *blocks = nullptr; // the block of each thread that counted, never freed
+
+HotPathStats::Block *HotPathStats::attachThread() {
+  Block *block = new Block();
+  std::lock_guard<std::mutex> lock(blocksMutex);
+  block->next = blocks;
+  blocks = block;
+  threadBlock = block;
+  return block;
+}
+
+/**
+ * @brief Add the totals of one kind of value to a dict of groups
+ */
+static bool groupTotals(PyObject *groups, const uint64_t *totals) {
+  for (size_t index = 0; index < HotPathStats::COUNTERS; index++) {
+    PyObject *group = PyDict_GetItemString(groups, hotPathNames[index].group); // borrowed reference
+    if (!group) {
+      group = PyDict_New();
+      if (!group || PyDict_SetItemString(groups, hotPathNames[index].group, group) < 0) {
+        Py_XDECREF(group);
+        return false;
+      }
+      Py_DECREF(group); // the dict of groups holds it
+    }
+    PyObject *value = PyLong_FromUnsignedLongLong(totals[index]);
+    if (!value || PyDict_SetItemString(group, hotPathNames[index].name, value) < 0) {
+      Py_XDECREF(value);
+      return false;
+    }
+    Py_DECREF(value);
+  }
+  return true;
+}
+
+PyObject *HotPathStats::toPython() {
+  uint64_t counts[COUNTERS] = {};
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+  uint64_t ticks[COUNTERS] = {};
+#endif
+  {
+    std::lock_guard<std::mutex> lock(blocksMutex);
+    for (Block *block = blocks; block; block = block->next) {
+      for (size_t index = 0; index < COUNTERS; index++) {
+        counts[index] += block->counts[index].load(std::memory_order_relaxed);
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+        ticks[index] += block->ticks[index].load(std::memory_order_relaxed);
+#endif
+      }
+    }
+  }
+
+  PyObject *result = PyDict_New();
+  if (!result || !groupTotals(result, counts)) {
+    Py_XDECREF(result);
+    return NULL;
+  }
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+  PyObject *time = PyDict_New();
+  bool ok = time && groupTotals(time, ticks) && PyDict_SetItemString(result, "time", time) == 0;
+  Py_XDECREF(time);
+  PyObject *unit = ok ? PyUnicode_FromString(timeUnit) : NULL;
+  ok = unit && PyDict_SetItemString(result, "timeUnit", unit) == 0;
+  Py_XDECREF(unit);
+  if (!ok) {
+    Py_DECREF(result);
+    return NULL;
+  }
+#endif
+  return result;
+}
+
+void HotPathStats::reset() {
+  std::lock_guard<std::mutex> lock(blocksMutex);
+  for (Block *block = blocks; block; block = block->next) {
+    for (size_t index = 0; index < COUNTERS; index++) {
+      block->counts[index].store(0, std::memory_order_relaxed);
+#ifdef PYTHONMONKEY_HOT_PATH_TIMERS
+      block->ticks[index].store(0, std::memory_order_relaxed);
+#endif
+    }
+  }
+}
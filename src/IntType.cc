@@ -68,10 +68,10 @@ static inline bool PythonLong_IsNegative(const PyLongObject *op) {
 }
 
 
-PyObject *IntType::getPyObject(JSContext *cx, JS::BigInt *bigint) {
-  // Get the sign bit
-  bool isNegative = BigIntIsNegative(bigint);
-
+/**
+ * @brief Convert the magnitude of a JS BigInt to a Python int by reinterpreting its digits as a little-endian byte array
+ */
+static PyObject *bigIntMagnitudeToPyLong(JS::BigInt *bigint) {
   // Read the digits count in this JS BigInt
   //    see https://hg.mozilla.org/releases/mozilla-esr102/file/tip/js/src/vm/BigIntType.h#l48
   //        https://hg.mozilla.org/releases/mozilla-esr102/file/tip/js/src/gc/Cell.h#l623
@@ -96,7 +96,25 @@ PyObject *IntType::getPyObject(JSContext *cx, JS::BigInt *bigint) {
   // If the native endianness is also little-endian,
   // we now have consecutive bytes of 8-bit "digits" in little-endian order
   const uint8_t *bytes = const_cast<const uint8_t *>((uint8_t *)jsDigits);
-  PyObject *pyIntObj = _PyLong_FromByteArray(bytes, jsDigitCount * JS_DIGIT_BYTE, true, false);
+  return _PyLong_FromByteArray(bytes, jsDigitCount * JS_DIGIT_BYTE, true, false);
+}
+
+PyObject *IntType::getPyObject(JSContext *cx, JS::BigInt *bigint) {
+  PyObject *pyIntObj;
+  bool isNegative = false;
+  int64_t int64Value;
+  uint64_t uint64Value;
+  if (JS::BigIntFits(bigint, &int64Value)) { // fast path for the common 64-bit values, e.g. IDs and timestamps
+    pyIntObj = PyLong_FromLongLong(int64Value);
+  } else if (JS::BigIntFits(bigint, &uint64Value)) {
+    pyIntObj = PyLong_FromUnsignedLongLong(uint64Value);
+  } else {
+    isNegative = BigIntIsNegative(bigint);
+    pyIntObj = bigIntMagnitudeToPyLong(bigint);
+  }
+  if (!pyIntObj) {
+    return NULL;
+  }
 
   // Cast to a pythonmonkey.bigint to differentiate it from a normal Python int,
   //  allowing Py<->JS two-way BigInt conversion.
@@ -105,7 +123,7 @@ PyObject *IntType::getPyObject(JSContext *cx, JS::BigInt *bigint) {
   Py_DECREF(pyIntObj);
 
   // Set the sign bit
-  if (isNegative) {
+  if (pyObject && isNegative) {
     PythonLong_SetSign((PyLongObject *)pyObject, -1);
   }
 
@@ -113,6 +131,23 @@ PyObject *IntType::getPyObject(JSContext *cx, JS::BigInt *bigint) {
 }
 
 JS::BigInt *IntType::toJsBigInt(JSContext *cx, PyObject *pyObject) {
+  // Fast paths for ints that fit in 64 bits, without touching the int's internals
+  int overflow;
+  long long int64Value = PyLong_AsLongLongAndOverflow(pyObject, &overflow);
+  if (int64Value == -1 && PyErr_Occurred()) {
+    return nullptr;
+  }
+  if (!overflow) {
+    return JS::NumberToBigInt(cx, int64Value);
+  }
+  if (overflow > 0) {
+    unsigned long long uint64Value = PyLong_AsUnsignedLongLong(pyObject);
+    if (uint64Value != (unsigned long long)-1 || !PyErr_Occurred()) {
+      return JS::NumberToBigInt(cx, uint64Value);
+    }
+    PyErr_Clear(); // OverflowError, more than 64 bits
+  }
+
   // Figure out how many 64-bit "digits" we would have for JS BigInt
   //    see https://github.com/python/cpython/blob/3.9/Modules/_randommodule.c#L306
   size_t bitCount = _PyLong_NumBits(pyObject);
@@ -129,7 +164,7 @@ JS::BigInt *IntType::toJsBigInt(JSContext *cx, PyObject *pyObject) {
   JS::BigInt *bigint = nullptr;
   if (jsDigitCount <= 1) {
     // Fast path for int fits in one js_digit_t (uint64 on 64-bit OS)
-    bigint = JS::detail::BigIntFromUint64(cx, PyLong_AsUnsignedLongLong(pyObject));
+    bigint = JS::NumberToBigInt(cx, PyLong_AsUnsignedLongLong(pyObject));
   } else {
     // Convert to bytes of 8-bit "digits" in **big-endian** order
     size_t byteCount = (size_t)JS_DIGIT_BYTE * jsDigitCount;
@@ -161,7 +196,9 @@ JS::BigInt *IntType::toJsBigInt(JSContext *cx, PyObject *pyObject) {
 
     // Set the sign bit
     // https://hg.mozilla.org/releases/mozilla-esr102/file/tip/js/src/vm/BigIntType.cpp#l1801
-    /* flagsField */ ((uint32_t *)bigint)[0] |= SIGN_BIT_MASK;
+    if (bigint) {
+      /* flagsField */ ((uint32_t *)bigint)[0] |= SIGN_BIT_MASK;
+    }
   }
 
   return bigint;
@@ -11,21 +11,29 @@
 
 #include "include/JSArrayIterProxy.hh"
 
+#include "include/ContextOwner.hh"
 #include "include/JSArrayProxy.hh"
 
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
 
 #include "include/pyTypeFactory.hh"
+#include "include/RootPool.hh"
 
 #include <jsapi.h>
 
 #include <Python.h>
 
+#include <algorithm>
+
 
 void JSArrayIterProxyMethodDefinitions::JSArrayIterProxy_dealloc(JSArrayIterProxy *self)
 {
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSArrayIterProxyMethodDefinitions::JSArrayIterProxy_dealloc)) {
+    return;
+  }
   PyObject_GC_UnTrack(self);
   Py_XDECREF(self->it.it_seq);
+  RootPool::deleteRoot(self->block);
   PyObject_GC_Del(self);
 }
 
@@ -58,10 +66,20 @@ PyObject *JSArrayIterProxyMethodDefinitions::JSArrayIterProxy_next(JSArrayIterPr
     }
   }
   else {
-    if (self->it.it_index < JSArrayProxyMethodDefinitions::JSArrayProxy_length((JSArrayProxy *)seq)) {
-      JS::RootedValue elementVal(GLOBAL_CX);
-      JS_GetElement(GLOBAL_CX, *(((JSArrayProxy *)seq)->jsArray), self->it.it_index++, &elementVal);
-      return pyTypeFactory(GLOBAL_CX, elementVal);
+    Py_ssize_t length = JSArrayProxyMethodDefinitions::JSArrayProxy_length((JSArrayProxy *)seq);
+    if (self->it.it_index < length) {
+      Py_ssize_t blockIndex = self->it.it_index - self->blockStart;
+      if (blockIndex < 0 || blockIndex >= (Py_ssize_t)self->block->length()) {
+        // refill the block, writes made to the array after a block was read are seen from the next block on
+        Py_ssize_t blockEnd = std::min(self->it.it_index + JS_ARRAY_ELEMENTS_BLOCK_SIZE, length);
+        if (!JSArrayProxyMethodDefinitions::JSArrayProxy_get_elements((JSArrayProxy *)seq, self->it.it_index, blockEnd, self->block)) {
+          return NULL;
+        }
+        self->blockStart = self->it.it_index;
+        blockIndex = 0;
+      }
+      self->it.it_index++;
+      return pyTypeFactory(GLOBAL_CX, (*self->block)[blockIndex]);
     }
   }
 
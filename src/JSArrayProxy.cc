@@ -11,6 +11,12 @@
 
 #include "include/JSArrayProxy.hh"
 
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/DeepEqual.hh"
+#include "include/FreeList.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
 #include "include/JSArrayIterProxy.hh"
 
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
@@ -18,6 +24,9 @@
 #include "include/pyTypeFactory.hh"
 #include "include/PyBaseProxyHandler.hh"
 #include "include/JSFunctionProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/RootPool.hh"
+#include "include/HotPathStats.hh"
 
 #include <jsapi.h>
 #include <jsfriendapi.h>
@@ -25,36 +34,81 @@
 #include <Python.h>
 #include "include/pyshim.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+static FreeList freeProxies;
+
+JSArrayProxy *JSArrayProxyMethodDefinitions::allocate() {
+  PyObject *proxy = freeProxies.pop(&JSArrayProxyType);
+  if (proxy) {
+    PyObject_GC_Track(proxy);
+    return (JSArrayProxy *)proxy;
+  }
+  return (JSArrayProxy *)PyObject_CallObject((PyObject *)&JSArrayProxyType, NULL);
+}
 
 void JSArrayProxyMethodDefinitions::JSArrayProxy_dealloc(JSArrayProxy *self)
 {
-  self->jsArray->set(nullptr);
-  delete self->jsArray;
+  Retention::unpinJS((PyObject *)self);
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSArrayProxyMethodDefinitions::JSArrayProxy_dealloc)) {
+    return;
+  }
+  CrossHeap::unregisterProxy((PyObject *)self);
+  MemoryStats::jsArrayProxies--;
+  ProxyCache::removePyProxy(*(self->jsArray), (PyObject *)self);
+  RootPool::deleteRoot(self->jsArray);
+  self->jsArray = nullptr;
   PyObject_GC_UnTrack(self);
-  PyObject_GC_Del(self);
+  // the list storage is unused, the items are the ones of the JS array, unless something wrote to it with the PyList APIs
+  if (self->list.ob_item != NULL || self->list.allocated != 0 || !freeProxies.push((PyObject *)self)) {
+    PyObject_GC_Del(self);
+  }
 }
 
 int JSArrayProxyMethodDefinitions::JSArrayProxy_traverse(JSArrayProxy *self, visitproc visit, void *arg)
 {
-  // Nothing to be done
-  return 0;
+  return CrossHeap::traverse((PyObject *)self, visit, arg);
 }
 
 int JSArrayProxyMethodDefinitions::JSArrayProxy_clear(JSArrayProxy *self)
 {
-  // Nothing to be done
+  // The cycle is broken by clearing the other Python objects in it, the JS array stays rooted until the proxy is deallocated
   return 0;
 }
 
 Py_ssize_t JSArrayProxyMethodDefinitions::JSArrayProxy_length(JSArrayProxy *self)
 {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, length);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
   uint32_t length;
   JS::GetArrayLength(GLOBAL_CX, *(self->jsArray), &length);
   return (Py_ssize_t)length;
 }
 
+bool JSArrayProxyMethodDefinitions::JSArrayProxy_get_elements(JSArrayProxy *self, uint32_t begin, uint32_t end, JS::MutableHandleValueVector values) {
+  if (!values.resize(end - begin)) {
+    PyErr_NoMemory();
+    return false;
+  }
+  js::ElementAdder adder(GLOBAL_CX, values.begin(), end - begin, js::ElementAdder::GetElement);
+  if (!js::GetElementsWithAdder(GLOBAL_CX, *(self->jsArray), *(self->jsArray), begin, end, &adder)) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return false;
+  }
+  return true;
+}
+
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_get(JSArrayProxy *self, PyObject *key)
 {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, get);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) {
     PyErr_SetString(PyExc_AttributeError, "JSArrayProxy property name must be of type str or int");
@@ -62,24 +116,18 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_get(JSArrayProxy *self, Py
   }
 
   // look through the methods for dispatch and return key if no method found
-  for (size_t index = 0;; index++) {
-    const char *methodName = JSArrayProxyType.tp_methods[index].ml_name;
-    if (methodName == NULL || !PyUnicode_Check(key)) {   // reached end of list
-      JS::RootedValue value(GLOBAL_CX);
-      JS_GetPropertyById(GLOBAL_CX, *(self->jsArray), id, &value);
-      if (value.isUndefined() && PyUnicode_Check(key)) {
-        if (strcmp("__class__", PyUnicode_AsUTF8(key)) == 0) {
-          return PyObject_GenericGetAttr((PyObject *)self, key);
-        }
-      }
-      return pyTypeFactory(GLOBAL_CX, value);
-    }
-    else {
-      if (strcmp(methodName, PyUnicode_AsUTF8(key)) == 0) {
-        return PyObject_GenericGetAttr((PyObject *)self, key);
-      }
+  if (PyUnicode_Check(key) && isMethodName(&JSArrayProxyType, key)) {
+    return PyObject_GenericGetAttr((PyObject *)self, key);
+  }
+
+  JS::RootedValue value(GLOBAL_CX);
+  JS_GetPropertyById(GLOBAL_CX, *(self->jsArray), id, &value);
+  if (value.isUndefined() && PyUnicode_Check(key)) {
+    if (strcmp("__class__", PyUnicode_AsUTF8(key)) == 0) {
+      return PyObject_GenericGetAttr((PyObject *)self, key);
     }
   }
+  return pyTypeFactory(GLOBAL_CX, value);
 }
 
 // private
@@ -98,6 +146,10 @@ static PyObject *list_slice(JSArrayProxy *self, Py_ssize_t ilow, Py_ssize_t ihig
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_get_subscript(JSArrayProxy *self, PyObject *key)
 {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, getSubscript);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (PyIndex_Check(key)) {
     Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
     if (index == -1 && PyErr_Occurred()) {
@@ -265,6 +317,10 @@ static int list_ass_slice(JSArrayProxy *self, Py_ssize_t ilow, Py_ssize_t ihigh,
 
 int JSArrayProxyMethodDefinitions::JSArrayProxy_assign_key(JSArrayProxy *self, PyObject *key, PyObject *value)
 {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, assignKey);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
   if (PyIndex_Check(key)) {
     Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
     if (index == -1 && PyErr_Occurred()) {
@@ -414,19 +470,42 @@ int JSArrayProxyMethodDefinitions::JSArrayProxy_assign_key(JSArrayProxy *self, P
   }
 }
 
+/**
+ * @brief Get an item of the list on the right side of a comparison, read from the JS Array if it is a JSArrayProxy
+ *
+ * @return PyObject* - a new reference to the item, or NULL with an exception set
+ */
+static PyObject *comparedItem(PyObject *list, Py_ssize_t index) {
+  if (PyObject_TypeCheck(list, &JSArrayProxyType)) {
+    JS::RootedValue elementVal(GLOBAL_CX);
+    if (!JS_GetElement(GLOBAL_CX, *(((JSArrayProxy *)list)->jsArray), index, &elementVal)) {
+      setSpiderMonkeyException(GLOBAL_CX);
+      return NULL;
+    }
+    return pyTypeFactory(GLOBAL_CX, elementVal);
+  }
+  PyObject *item = PyList_GET_ITEM(list, index);
+  Py_INCREF(item);
+  return item;
+}
+
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_richcompare(JSArrayProxy *self, PyObject *other, int op)
 {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, richcompare);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (!PyList_Check(self) || !PyList_Check(other)) {
     Py_RETURN_NOTIMPLEMENTED;
   }
 
-  if (self == (JSArrayProxy *)other && (op == Py_EQ || op == Py_NE)) {
-    if (op == Py_EQ) {
-      Py_RETURN_TRUE;
-    }
-    else {
-      Py_RETURN_FALSE;
+  if (op == Py_EQ || op == Py_NE) {
+    JS::RootedValue selfValue(GLOBAL_CX, JS::ObjectValue(**(self->jsArray)));
+    int isEqual = DeepEqual::equals(GLOBAL_CX, selfValue, other);
+    if (isEqual < 0) {
+      return NULL;
     }
+    return PyBool_FromLong(op == Py_EQ ? isEqual : !isEqual);
   }
 
   Py_ssize_t selfLength = JSArrayProxy_length(self);
@@ -438,80 +517,44 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_richcompare(JSArrayProxy *
     otherLength = Py_SIZE(other);
   }
 
-  if (selfLength != otherLength && (op == Py_EQ || op == Py_NE)) {
-    /* Shortcut: if the lengths differ, the lists differ */
-    if (op == Py_EQ) {
-      Py_RETURN_FALSE;
-    }
-    else {
-      Py_RETURN_TRUE;
-    }
-  }
-
   JS::RootedValue elementVal(GLOBAL_CX);
 
   Py_ssize_t index;
   /* Search for the first index where items are different */
   for (index = 0; index < selfLength && index < otherLength; index++) {
-    JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal);
-
-    PyObject *leftItem = pyTypeFactory(GLOBAL_CX, elementVal);
-    PyObject *rightItem;
-
-    bool needToDecRefRightItem;
-    if (PyObject_TypeCheck(other, &JSArrayProxyType)) {
-      JS_GetElement(GLOBAL_CX, *(((JSArrayProxy *)other)->jsArray), index, &elementVal);
-      rightItem = pyTypeFactory(GLOBAL_CX, elementVal);
-      needToDecRefRightItem = true;
-    } else {
-      rightItem = ((PyListObject *)other)->ob_item[index];
-      needToDecRefRightItem = false;
-    }
-
-    if (leftItem == rightItem) {
-      continue;
-    }
-
-    Py_INCREF(leftItem);
-    Py_INCREF(rightItem);
-    int k = PyObject_RichCompareBool(leftItem, rightItem, Py_EQ);
-    Py_DECREF(leftItem);
-    Py_DECREF(rightItem);
-    if (k < 0) {
+    if (!JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal)) {
+      setSpiderMonkeyException(GLOBAL_CX);
       return NULL;
     }
-    if (!k) {
-      break;
+    PyObject *rightItem = comparedItem(other, index);
+    if (!rightItem) {
+      return NULL;
     }
-
-    Py_DECREF(leftItem);
-    if (needToDecRefRightItem) {
+    int k = DeepEqual::equals(GLOBAL_CX, elementVal, rightItem);
+    if (k != 1) {
+      if (k == 0) {
+        /* Compare the first item that differs again using the proper operator */
+        PyObject *leftItem = pyTypeFactory(GLOBAL_CX, elementVal);
+        PyObject *result = leftItem ? PyObject_RichCompare(leftItem, rightItem, op) : NULL;
+        Py_XDECREF(leftItem);
+        Py_DECREF(rightItem);
+        return result;
+      }
       Py_DECREF(rightItem);
+      return NULL;
     }
+    Py_DECREF(rightItem);
   }
 
-  if (index >= selfLength || index >= otherLength) {
-    /* No more items to compare -- compare sizes */
-    Py_RETURN_RICHCOMPARE(selfLength, otherLength, op);
-  }
-
-  /* We have an item that differs -- shortcuts for EQ/NE */
-  if (op == Py_EQ) {
-    Py_RETURN_FALSE;
-  }
-  else if (op == Py_NE) {
-    Py_RETURN_TRUE;
-  }
-
-  JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal);
-  /* Compare the final item again using the proper operator */
-  PyObject *pyElementVal = pyTypeFactory(GLOBAL_CX, elementVal);
-  PyObject *result = PyObject_RichCompare(pyElementVal, ((PyListObject *)other)->ob_item[index], op);
-  Py_DECREF(pyElementVal);
-  return result;
+  /* No more items to compare -- compare sizes */
+  Py_RETURN_RICHCOMPARE(selfLength, otherLength, op);
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_repr(JSArrayProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, repr);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t selfLength = JSArrayProxy_length(self);
 
   if (selfLength == 0) {
@@ -580,6 +623,10 @@ error:
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_iter(JSArrayProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, iter);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JSArrayIterProxy *iterator = PyObject_GC_New(JSArrayIterProxy, &JSArrayIterProxyType);
   if (iterator == NULL) {
     return NULL;
@@ -588,11 +635,17 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_iter(JSArrayProxy *self) {
   iterator->it.it_index = 0;
   Py_INCREF(self);
   iterator->it.it_seq = (PyListObject *)self;
+  iterator->block = RootPool::newValueVectorRoot(GLOBAL_CX);
+  iterator->blockStart = 0;
   PyObject_GC_Track(iterator);
   return (PyObject *)iterator;
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_iter_reverse(JSArrayProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, reversed);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JSArrayIterProxy *iterator = PyObject_GC_New(JSArrayIterProxy, &JSArrayIterProxyType);
   if (iterator == NULL) {
     return NULL;
@@ -601,11 +654,17 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_iter_reverse(JSArrayProxy
   iterator->it.it_index = JSArrayProxyMethodDefinitions::JSArrayProxy_length(self) - 1;
   Py_INCREF(self);
   iterator->it.it_seq = (PyListObject *)self;
+  iterator->block = nullptr;
+  iterator->blockStart = 0;
   PyObject_GC_Track(iterator);
   return (PyObject *)iterator;
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_concat(JSArrayProxy *self, PyObject *value) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, concat);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   // value must be a list
   if (!PyList_Check(value)) {
     PyErr_Format(PyExc_TypeError, "can only concatenate list (not \"%.200s\") to list", Py_TYPE(value)->tp_name);
@@ -661,6 +720,9 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_concat(JSArrayProxy *self,
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_repeat(JSArrayProxy *self, Py_ssize_t n) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   const Py_ssize_t input_size = JSArrayProxy_length(self);
   if (input_size == 0 || n <= 0) {
     return PyList_New(0);
@@ -688,24 +750,37 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_repeat(JSArrayProxy *self,
 }
 
 int JSArrayProxyMethodDefinitions::JSArrayProxy_contains(JSArrayProxy *self, PyObject *element) {
-  Py_ssize_t index;
-  int cmp;
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, contains);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
+  int cmp = 0;
 
   Py_ssize_t numElements = JSArrayProxy_length(self);
 
-  JS::RootedValue elementVal(GLOBAL_CX);
-  for (index = 0, cmp = 0; cmp == 0 && index < numElements; ++index) {
-    JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal);
-    PyObject *item = pyTypeFactory(GLOBAL_CX, elementVal);
-    Py_INCREF(item);
-    cmp = PyObject_RichCompareBool(item, element, Py_EQ);
-    Py_DECREF(item);
-    Py_DECREF(item);
+  // read the elements in blocks rather than one JS_GetElement at a time
+  JS::RootedValueVector block(GLOBAL_CX);
+  for (Py_ssize_t blockStart = 0; cmp == 0 && blockStart < numElements; blockStart += JS_ARRAY_ELEMENTS_BLOCK_SIZE) {
+    Py_ssize_t blockEnd = std::min(blockStart + JS_ARRAY_ELEMENTS_BLOCK_SIZE, numElements);
+    if (!JSArrayProxy_get_elements(self, blockStart, blockEnd, &block)) {
+      return -1;
+    }
+    for (size_t index = 0; cmp == 0 && index < block.length(); ++index) {
+      PyObject *item = pyTypeFactory(GLOBAL_CX, block[index]);
+      if (!item) {
+        return -1;
+      }
+      cmp = PyObject_RichCompareBool(item, element, Py_EQ);
+      Py_DECREF(item);
+    }
   }
   return cmp;
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_inplace_concat(JSArrayProxy *self, PyObject *value) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t selfLength = JSArrayProxy_length(self);
   Py_ssize_t valueLength = Py_SIZE(value);
 
@@ -726,6 +801,9 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_inplace_concat(JSArrayProx
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_inplace_repeat(JSArrayProxy *self, Py_ssize_t n) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t input_size = JSArrayProxy_length(self);
   if (input_size == 0 || n == 1) {
     Py_INCREF(self);
@@ -759,11 +837,17 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_inplace_repeat(JSArrayProx
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_clear_method(JSArrayProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::SetArrayLength(GLOBAL_CX, *(self->jsArray), 0);
   Py_RETURN_NONE;
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_copy(JSArrayProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::Rooted<JS::ValueArray<2>> jArgs(GLOBAL_CX);
   jArgs[0].setInt32(0);
   jArgs[1].setInt32(JSArrayProxy_length(self));
@@ -776,6 +860,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_copy(JSArrayProxy *self) {
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_append(JSArrayProxy *self, PyObject *value) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, append);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t len = JSArrayProxy_length(self);
 
   JS::SetArrayLength(GLOBAL_CX, *(self->jsArray), len + 1);
@@ -786,6 +874,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_append(JSArrayProxy *self,
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_insert(JSArrayProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, insert);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *return_value = NULL;
   Py_ssize_t index;
   PyObject *value;
@@ -835,6 +927,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_insert(JSArrayProxy *self,
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_extend(JSArrayProxy *self, PyObject *iterable) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, extend);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (PyList_CheckExact(iterable) || PyTuple_CheckExact(iterable) || (PyObject *)self == iterable) {
     iterable = PySequence_Fast(iterable, "argument must be iterable");
     if (!iterable) {
@@ -898,6 +994,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_extend(JSArrayProxy *self,
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_pop(JSArrayProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, pop);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t index = -1;
 
   if (!_PyArg_CheckPositional("pop", nargs, 0, 1)) {
@@ -953,6 +1053,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_pop(JSArrayProxy *self, Py
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_remove(JSArrayProxy *self, PyObject *value) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, remove);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t selfSize = JSArrayProxy_length(self);
 
   JS::RootedValue elementVal(GLOBAL_CX);
@@ -984,6 +1088,10 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_remove(JSArrayProxy *self,
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_index(JSArrayProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, index);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *value;
   Py_ssize_t start = 0;
   Py_ssize_t stop = PY_SSIZE_T_MAX;
@@ -1042,28 +1150,160 @@ skip_optional:
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_count(JSArrayProxy *self, PyObject *value) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, count);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   Py_ssize_t count = 0;
 
   Py_ssize_t length = JSArrayProxy_length(self);
-  JS::RootedValue elementVal(GLOBAL_CX);
-  for (Py_ssize_t index = 0; index < length; index++) {
-    JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal);
-    PyObject *obj = pyTypeFactory(GLOBAL_CX, elementVal);
-    Py_INCREF(obj);
-    int cmp = PyObject_RichCompareBool(obj, value, Py_EQ);
-    Py_DECREF(obj);
-    Py_DECREF(obj);
-    if (cmp > 0) {
-      count++;
-    }
-    else if (cmp < 0) {
+  // read the elements in blocks rather than one JS_GetElement at a time
+  JS::RootedValueVector block(GLOBAL_CX);
+  for (Py_ssize_t blockStart = 0; blockStart < length; blockStart += JS_ARRAY_ELEMENTS_BLOCK_SIZE) {
+    Py_ssize_t blockEnd = std::min(blockStart + JS_ARRAY_ELEMENTS_BLOCK_SIZE, length);
+    if (!JSArrayProxy_get_elements(self, blockStart, blockEnd, &block)) {
       return NULL;
     }
+    for (size_t index = 0; index < block.length(); index++) {
+      PyObject *obj = pyTypeFactory(GLOBAL_CX, block[index]);
+      if (!obj) {
+        return NULL;
+      }
+      int cmp = PyObject_RichCompareBool(obj, value, Py_EQ);
+      Py_DECREF(obj);
+      if (cmp > 0) {
+        count++;
+      }
+      else if (cmp < 0) {
+        return NULL;
+      }
+    }
   }
   return PyLong_FromSsize_t(count);
 }
 
+/**
+ * @brief Store a JS number as an item of a packed buffer
+ *
+ * @return false if the value is not a number representable in the format, with a Python exception set
+ */
+static bool packNumber(char format, const JS::Value &value, Py_ssize_t index, char *dest) {
+  if (!value.isNumber()) {
+    PyErr_Format(PyExc_TypeError, "to_buffer expects an array of numbers, the element at index %zd is not a number", index);
+    return false;
+  }
+  double number = value.toNumber();
+  switch (format) {
+  case 'd':
+    memcpy(dest, &number, sizeof(double));
+    return true;
+  case 'f': {
+      float item = (float)number;
+      memcpy(dest, &item, sizeof(float));
+      return true;
+    }
+  case 'i':
+    if (value.isInt32() || (std::trunc(number) == number && number >= INT32_MIN && number <= INT32_MAX)) {
+      int32_t item = value.isInt32() ? value.toInt32() : (int32_t)number;
+      memcpy(dest, &item, sizeof(int32_t));
+      return true;
+    }
+    break;
+  case 'q':
+    if (std::trunc(number) == number && number >= -9223372036854775808.0 && number < 9223372036854775808.0) {
+      int64_t item = (int64_t)number;
+      memcpy(dest, &item, sizeof(int64_t));
+      return true;
+    }
+    break;
+  }
+  PyErr_Format(PyExc_ValueError, "the element at index %zd is not representable in format '%c'", index, format);
+  return false;
+}
+
+PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_to_buffer(JSArrayProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  if (!_PyArg_CheckPositional("to_buffer", nargs, 0, 1)) {
+    return NULL;
+  }
+
+  char format = 'd';
+  if (nargs >= 1) {
+    const char *formatString = PyUnicode_Check(args[0]) ? PyUnicode_AsUTF8(args[0]) : NULL;
+    if (!formatString || strlen(formatString) != 1 || !strchr("dfiq", formatString[0])) {
+      PyErr_SetString(PyExc_ValueError, "to_buffer format must be one of 'd', 'f', 'i' or 'q'");
+      return NULL;
+    }
+    format = formatString[0];
+  }
+  Py_ssize_t itemSize = (format == 'd' || format == 'q') ? 8 : 4;
+
+  Py_ssize_t length = JSArrayProxy_length(self);
+  PyObject *bytes = PyByteArray_FromStringAndSize(NULL, length * itemSize);
+  if (!bytes) {
+    return NULL;
+  }
+  char *data = PyByteArray_AS_STRING(bytes);
+
+  JS::RootedValueVector block(GLOBAL_CX);
+  for (Py_ssize_t blockStart = 0; blockStart < length; blockStart += JS_ARRAY_ELEMENTS_BLOCK_SIZE) {
+    Py_ssize_t blockEnd = std::min(blockStart + JS_ARRAY_ELEMENTS_BLOCK_SIZE, length);
+    if (!JSArrayProxy_get_elements(self, blockStart, blockEnd, &block)) {
+      Py_DECREF(bytes);
+      return NULL;
+    }
+    for (size_t index = 0; index < block.length(); index++) {
+      Py_ssize_t itemIndex = blockStart + index;
+      if (!packNumber(format, block[index], itemIndex, data + itemIndex * itemSize)) {
+        Py_DECREF(bytes);
+        return NULL;
+      }
+    }
+  }
+
+  PyObject *view = PyMemoryView_FromObject(bytes);
+  Py_DECREF(bytes);
+  if (!view) {
+    return NULL;
+  }
+  const char formatString[] = {format, '\0'};
+  PyObject *cast = PyObject_CallMethod(view, "cast", "s", formatString);
+  Py_DECREF(view);
+  return cast;
+}
+
+PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_to_list(JSArrayProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  Py_ssize_t length = JSArrayProxy_length(self);
+
+  JS::RootedValueVector elements(GLOBAL_CX);
+  if (!JSArrayProxy_get_elements(self, 0, length, &elements)) {
+    return NULL;
+  }
+
+  PyObject *list = PyList_New(length);
+  if (!list) {
+    return NULL;
+  }
+  for (Py_ssize_t index = 0; index < length; index++) {
+    PyObject *item = pyTypeFactory(GLOBAL_CX, elements[index]);
+    if (!item) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, index, item);
+  }
+  return list;
+}
+
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_reverse(JSArrayProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (JSArrayProxy_length(self) > 1) {
     JS::RootedValue jReturnedArray(GLOBAL_CX);
     if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "reverse", JS::HandleValueArray::empty(), &jReturnedArray)) {
@@ -1076,111 +1316,143 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_reverse(JSArrayProxy *self
 }
 
 // private
-static bool sort_compare_key_func(JSContext *cx, unsigned argc, JS::Value *vp) {
-  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
-
-  JS::RootedObject callee(cx, &args.callee());
-
-  JS::RootedValue keyFunc(cx);
-  if (!JS_GetProperty(cx, callee, "_key_func_param", &keyFunc)) {
-    PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-    return false;
-  }
-  PyObject *keyfunc = (PyObject *)keyFunc.toPrivate();
-
-  JS::RootedValue reverseValue(cx);
-  if (!JS_GetProperty(cx, callee, "_reverse_param", &reverseValue)) {
-    PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-    return false;
-  }
-  bool reverse = reverseValue.toBoolean();
-
-  JS::RootedValue elementVal0(cx, args[0]);
-  PyObject *args_0 = pyTypeFactory(cx, elementVal0);
-  PyObject *args_0_result = PyObject_CallFunction(keyfunc, "O", args_0);
-  Py_DECREF(args_0);
-  if (!args_0_result) {
-    return false;
+/**
+ * @brief Convert the elements of the array once, and call `keyfunc` once per element unless it is None,
+ * skipping the undefined elements and the holes, which Array.prototype.sort never compares either
+ *
+ * @param self - the JSArrayProxy
+ * @param length - the length of the array before sorting
+ * @param keyfunc - the key function, or None to compare the elements themselves
+ * @param values - appended the sorted elements, in their order in the array
+ * @param undefinedCount - set to the number of undefined elements, not counting the holes
+ * @return PyObject* - a new reference to the list of the keys of `values`, or NULL with a Python exception set
+ */
+static PyObject *sortKeys(JSArrayProxy *self, Py_ssize_t length, PyObject *keyfunc, JS::MutableHandle<JS::StackGCVector<JS::Value>> values, Py_ssize_t *undefinedCount) {
+  if (!values.reserve(length)) {
+    PyErr_NoMemory();
+    return NULL;
   }
 
-  JS::RootedValue elementVal1(cx, args[1]);
-  PyObject *args_1 = pyTypeFactory(cx, elementVal1);
-  PyObject *args_1_result = PyObject_CallFunction(keyfunc, "O", args_1);
-  Py_DECREF(args_1);
-  if (!args_1_result) {
-    return false;
+  PyObject *keys = PyList_New(0);
+  if (!keys) {
+    return NULL;
   }
-
-  int cmp = PyObject_RichCompareBool(args_0_result, args_1_result, Py_LT);
-  if (cmp > 0) {
-    args.rval().setInt32(reverse ? 1 : -1);
-  } else if (cmp == 0) {
-    cmp = PyObject_RichCompareBool(args_0_result, args_1_result, Py_EQ);
-    if (cmp > 0) {
-      args.rval().setInt32(0);
+  *undefinedCount = 0;
+  JS::RootedValue elementVal(GLOBAL_CX);
+  for (Py_ssize_t index = 0; index < length; index++) {
+    if (!JS_GetElement(GLOBAL_CX, *(self->jsArray), index, &elementVal)) {
+      setSpiderMonkeyException(GLOBAL_CX);
+      Py_DECREF(keys);
+      return NULL;
     }
-    else if (cmp == 0) {
-      args.rval().setInt32(reverse ? -1 : 1);
+    if (elementVal.isUndefined()) {
+      bool present;
+      if (!JS_HasElement(GLOBAL_CX, *(self->jsArray), index, &present)) {
+        setSpiderMonkeyException(GLOBAL_CX);
+        Py_DECREF(keys);
+        return NULL;
+      }
+      if (present) {
+        (*undefinedCount)++;
+      }
+      continue;
     }
-    else {
-      return false;
+    values.infallibleAppend(elementVal);
+    PyObject *key = pyTypeFactory(GLOBAL_CX, elementVal);
+    if (key && keyfunc != Py_None) {
+      PyObject *element = key;
+      key = PyObject_CallOneArg(keyfunc, element);
+      Py_DECREF(element);
     }
+    if (!key || PyList_Append(keys, key) < 0) {
+      Py_XDECREF(key);
+      Py_DECREF(keys);
+      return NULL;
+    }
+    Py_DECREF(key);
   }
-  else {
-    return false;
-  }
-
-  return true;
+  return keys;
 }
 
 // private
-static bool sort_compare_default(JSContext *cx, unsigned argc, JS::Value *vp) {
-  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
-
-  JS::RootedObject callee(cx, &args.callee());
-  JS::RootedValue reverseValue(cx);
-  if (!JS_GetProperty(cx, callee, "_reverse_param", &reverseValue)) {
-    PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
+/**
+ * @brief Sort the array the way list.sort does: each key is computed once, the indices of the keys are sorted by list.sort
+ * itself, which is stable, honours `reverse` and compares with `<`, then the elements are written back permuted in a single pass,
+ * followed by the undefined elements and the holes, within the length of the array once the keys are computed
+ *
+ * @param self - the JSArrayProxy
+ * @param keyfunc - the key function, or None to compare the elements themselves
+ * @param reverse - sort in descending order
+ * @return true - the array is sorted
+ * @return false - a Python exception was set, the array is unchanged unless `keyfunc` modified it
+ */
+static bool sortByKeys(JSArrayProxy *self, PyObject *keyfunc, bool reverse) {
+  Py_ssize_t length = JSArrayProxyMethodDefinitions::JSArrayProxy_length(self);
+  JS::RootedVector<JS::Value> values(GLOBAL_CX);
+  Py_ssize_t undefinedCount;
+  PyObject *keys = sortKeys(self, length, keyfunc, &values, &undefinedCount);
+  if (!keys) {
     return false;
   }
-  bool reverse = reverseValue.toBoolean();
-
-  JS::RootedValue elementVal0(cx, args[0]);
-  PyObject *args_0 = pyTypeFactory(cx, elementVal0);
 
-  JS::RootedValue elementVal1(cx, args[1]);
-  PyObject *args_1 = pyTypeFactory(cx, elementVal1);
+  Py_ssize_t count = PyList_GET_SIZE(keys);
+  PyObject *order = PyList_New(count);
+  for (Py_ssize_t index = 0; order && index < count; index++) {
+    PyObject *position = PyLong_FromSsize_t(index);
+    if (!position) {
+      Py_CLEAR(order);
+      break;
+    }
+    PyList_SET_ITEM(order, index, position);
+  }
+  PyObject *getKey = order ? PyObject_GetAttrString(keys, "__getitem__") : NULL;
+  PyObject *sort = getKey ? PyObject_GetAttrString(order, "sort") : NULL;
+  PyObject *sortArgs = sort ? PyTuple_New(0) : NULL;
+  PyObject *sortKwargs = sortArgs ? Py_BuildValue("{s:O,s:O}", "key", getKey, "reverse", reverse ? Py_True : Py_False) : NULL;
+  PyObject *sorted = sortKwargs ? PyObject_Call(sort, sortArgs, sortKwargs) : NULL;
+  Py_XDECREF(sortKwargs);
+  Py_XDECREF(sortArgs);
+  Py_XDECREF(sort);
+  Py_XDECREF(getKey);
+  Py_DECREF(keys);
+  if (!sorted) {
+    Py_XDECREF(order);
+    return false;
+  }
+  Py_DECREF(sorted);
 
-  int cmp = PyObject_RichCompareBool(args_0, args_1, Py_LT);
-  if (cmp > 0) {
-    args.rval().setInt32(reverse ? 1 : -1);
+  // the key function may have shrunk the array, which must not grow back to its old length
+  Py_ssize_t newLength = JSArrayProxyMethodDefinitions::JSArrayProxy_length(self);
+  if (newLength > length) {
+    newLength = length;
   }
-  else if (cmp == 0) {
-    cmp = PyObject_RichCompareBool(args_0, args_1, Py_EQ);
-    if (cmp > 0) {
-      args.rval().setInt32(0);
-    }
-    else if (cmp == 0) {
-      args.rval().setInt32(reverse ? -1 : 1);
+  JS::RootedValue elementVal(GLOBAL_CX);
+  for (Py_ssize_t index = 0; index < newLength; index++) {
+    bool ok;
+    if (index < count) {
+      elementVal.set(values[PyLong_AsSsize_t(PyList_GET_ITEM(order, index))]);
+      ok = JS_SetElement(GLOBAL_CX, *(self->jsArray), index, elementVal);
+    } else if (index < count + undefinedCount) {
+      elementVal.setUndefined();
+      ok = JS_SetElement(GLOBAL_CX, *(self->jsArray), index, elementVal);
+    } else {
+      ok = JS_DeleteElement(GLOBAL_CX, *(self->jsArray), index);
     }
-    else {
-      Py_DECREF(args_0);
-      Py_DECREF(args_1);
+    if (!ok) {
+      setSpiderMonkeyException(GLOBAL_CX);
+      Py_DECREF(order);
       return false;
     }
   }
-  else {
-    Py_DECREF(args_0);
-    Py_DECREF(args_1);
-    return false;
-  }
-
-  Py_DECREF(args_0);
-  Py_DECREF(args_1);
+  Py_DECREF(order);
   return true;
 }
 
 PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_sort(JSArrayProxy *self, PyObject *args, PyObject *kwargs) {
+  PYTHONMONKEY_HOT_PATH(JSArrayProxy, sort);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   static const char *const _keywords[] = {"key", "reverse", NULL};
 
   PyObject *keyfunc = Py_None;
@@ -1191,121 +1463,45 @@ PyObject *JSArrayProxyMethodDefinitions::JSArrayProxy_sort(JSArrayProxy *self, P
 
   if (JSArrayProxy_length(self) > 1) {
     JS::RootedValue jReturnedArray(GLOBAL_CX);
-    if (keyfunc != Py_None) {
-      if (PyFunction_Check(keyfunc)) {
-        // we got a python key function, check if two-argument js style or standard python 1-arg
-        PyObject *code = PyFunction_GetCode(keyfunc);
-        if (((PyCodeObject *)code)->co_argcount == 1) {
-          // adapt to python style, provide js-style comp wrapper that does it the python way, which is < based with calls to keyFunc
-          JS::RootedObject funObj(GLOBAL_CX, JS_GetFunctionObject(JS_NewFunction(GLOBAL_CX, sort_compare_key_func, 2, 0, NULL)));
-
-          JS::RootedValue privateValue(GLOBAL_CX, JS::PrivateValue(keyfunc));
-          if (!JS_SetProperty(GLOBAL_CX, funObj, "_key_func_param", privateValue)) {  // JS::SetReservedSlot(functionObj, KeyFuncSlot, JS::PrivateValue(keyfunc)); does not work
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            return NULL;
-          }
-
-          JS::RootedValue reverseValue(GLOBAL_CX);
-          reverseValue.setBoolean(reverse);
-          if (!JS_SetProperty(GLOBAL_CX, funObj, "_reverse_param", reverseValue)) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            return NULL;
-          }
-
-          JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
-          jArgs[0].setObject(*funObj);
-          if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
-            if (!PyErr_Occurred()) {
-              PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            }
-            return NULL;
-          }
-
-          // cleanup
-          if (!JS_DeleteProperty(GLOBAL_CX, funObj, "_key_func_param")) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            return NULL;
-          }
-
-          if (!JS_DeleteProperty(GLOBAL_CX, funObj, "_reverse_param")) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            return NULL;
-          }
-        }
-        else {
-          // two-arg js-style
-          JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
-          jArgs[0].set(jsTypeFactory(GLOBAL_CX, keyfunc));
-          if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-            return NULL;
-          }
-
-          if (reverse) {
-            JSArrayProxy_reverse(self);
-          }
-        }
-      }
-      else if (PyObject_TypeCheck(keyfunc, &JSFunctionProxyType)) {
-        JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
-        jArgs[0].setObject(**((JSFunctionProxy *)keyfunc)->jsFunc);
-        if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
-          PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-          return NULL;
-        }
-
-        if (reverse) {
-          JSArrayProxy_reverse(self);
-        }
-      }
-      else if (PyCFunction_Check(keyfunc)) {
-        JS::RootedObject funObj(GLOBAL_CX, JS_GetFunctionObject(JS_NewFunction(GLOBAL_CX, sort_compare_key_func, 2, 0, NULL)));
-
-        JS::RootedValue privateValue(GLOBAL_CX, JS::PrivateValue(keyfunc));
-        if (!JS_SetProperty(GLOBAL_CX, funObj, "_key_func_param", privateValue)) {  // JS::SetReservedSlot(functionObj, KeyFuncSlot, JS::PrivateValue(keyfunc)); does not work
-          PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-          return NULL;
-        }
-
-        JS::RootedValue reverseValue(GLOBAL_CX);
-        reverseValue.setBoolean(reverse);
-        if (!JS_SetProperty(GLOBAL_CX, funObj, "_reverse_param", reverseValue)) {
-          PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-          return NULL;
-        }
-
-        JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
-        jArgs[0].setObject(*funObj);
-        if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
-          if (!PyErr_Occurred()) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
-          }
-          return NULL;
-        }
-      }
-      else {
-        PyErr_Format(PyExc_TypeError, "'%.200s' object is not callable", Py_TYPE(keyfunc)->tp_name);
+    if (keyfunc == Py_None) {
+      if (!sortByKeys(self, Py_None, reverse)) {
         return NULL;
       }
     }
-    else {
-      // adapt to python style, provide js-style comp wrapper that does it the python way, which is < based
-      JSFunction *cmpFunction = JS_NewFunction(GLOBAL_CX, sort_compare_default, 2, 0, NULL);
-      JS::RootedObject funObj(GLOBAL_CX, JS_GetFunctionObject(cmpFunction));
-
-      JS::RootedValue reverseValue(GLOBAL_CX);
-      reverseValue.setBoolean(reverse);
-      if (!JS_SetProperty(GLOBAL_CX, funObj, "_reverse_param", reverseValue)) {
+    else if (PyFunction_Check(keyfunc) && ((PyCodeObject *)PyFunction_GetCode(keyfunc))->co_argcount != 1) {
+      // two-arg js-style comparison function
+      JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
+      jArgs[0].set(jsTypeFactory(GLOBAL_CX, keyfunc));
+      if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
         PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
         return NULL;
       }
 
+      if (reverse) {
+        JSArrayProxy_reverse(self);
+      }
+    }
+    else if (PyObject_TypeCheck(keyfunc, &JSFunctionProxyType)) {
       JS::Rooted<JS::ValueArray<1>> jArgs(GLOBAL_CX);
-      jArgs[0].setObject(*funObj);
+      jArgs[0].set(jsTypeFactory(GLOBAL_CX, keyfunc));
       if (!JS_CallFunctionName(GLOBAL_CX, *(self->jsArray), "sort", jArgs, &jReturnedArray)) {
         PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSArrayProxyType.tp_name);
         return NULL;
       }
+
+      if (reverse) {
+        JSArrayProxy_reverse(self);
+      }
+    }
+    else if (PyCallable_Check(keyfunc)) {
+      // python style key function, e.g. a one-arg function, a builtin or a bound method
+      if (!sortByKeys(self, keyfunc, reverse)) {
+        return NULL;
+      }
+    }
+    else {
+      PyErr_Format(PyExc_TypeError, "'%.200s' object is not callable", Py_TYPE(keyfunc)->tp_name);
+      return NULL;
     }
   }
   Py_RETURN_NONE;
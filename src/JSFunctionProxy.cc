@@ -9,52 +9,160 @@
  */
 
 #include "include/JSFunctionProxy.hh"
+#include "include/JSMethodProxy.hh"
 
+#include "include/ContextOwner.hh"
+#include "include/FreeList.hh"
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/GILSwitch.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
+#include "include/Profiler.hh"
 #include "include/jsTypeFactory.hh"
 #include "include/pyTypeFactory.hh"
+#include "include/PyBaseProxyHandler.hh"
 #include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
+#include <js/ValueArray.h>
 
 #include <Python.h>
+#include "include/pyshim.hh"
+
+bool JSFunctionProxyMethodDefinitions::keywordArgumentsAsOptions = false;
+
+static FreeList freeProxies;
 
 void JSFunctionProxyMethodDefinitions::JSFunctionProxy_dealloc(JSFunctionProxy *self)
 {
-  delete self->jsFunc;
+  Retention::unpinJS((PyObject *)self);
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSFunctionProxyMethodDefinitions::JSFunctionProxy_dealloc)) {
+    return;
+  }
+  RootPool::deleteRoot(self->jsFunc);
+  RootPool::deleteRoot(self->jsThis);
+  RootPool::deleteRoot(self->jsBound);
+  MemoryStats::jsFunctionProxies--;
+  if (Py_TYPE(self) != &JSFunctionProxyType || !freeProxies.push((PyObject *)self)) {
+    Py_TYPE(self)->tp_free((PyObject *)self);
+  }
 }
 
 PyObject *JSFunctionProxyMethodDefinitions::JSFunctionProxy_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds) {
-  JSFunctionProxy *self = (JSFunctionProxy *)subtype->tp_alloc(subtype, 0);
+  JSFunctionProxy *self = subtype == &JSFunctionProxyType ? (JSFunctionProxy *)freeProxies.pop(subtype) : nullptr;
+  if (!self) {
+    self = (JSFunctionProxy *)subtype->tp_alloc(subtype, 0);
+  }
   if (self) {
-    self->jsFunc = new JS::PersistentRootedObject(GLOBAL_CX);
+    self->jsFunc = RootPool::newRoot(GLOBAL_CX);
+    self->jsThis = nullptr;
+    self->jsBound = nullptr;
+    MemoryStats::jsFunctionProxies++;
+    Retention::pinJS(GLOBAL_CX, (PyObject *)self);
+    self->vectorcall = JSFunctionProxy_vectorcall;
   }
   return (PyObject *)self;
 }
 
 PyObject *JSFunctionProxyMethodDefinitions::JSFunctionProxy_call(PyObject *self, PyObject *args, PyObject *kwargs) {
+  return PyVectorcall_Call(self, args, kwargs);
+}
+
+PyObject *JSFunctionProxyMethodDefinitions::JSFunctionProxy_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf, PyObject *kwnames) {
+  ProfilerLabel profilerLabel("JSFunctionProxy_call");
   JSContext *cx = GLOBAL_CX;
-  JS::RootedValue jsFunc(GLOBAL_CX, JS::ObjectValue(**((JSFunctionProxy *)self)->jsFunc));
-  JSObject *jsFuncObj = jsFunc.toObjectOrNull();
-  JS::RootedObject thisObj(GLOBAL_CX, JS::CurrentGlobalOrNull(GLOBAL_CX)); // if jsFunc is not bound, assume `this` is `globalThis`
-
-  JS::RootedVector<JS::Value> jsArgsVector(cx);
-  Py_ssize_t nargs = PyTuple_Size(args);
-  for (size_t i = 0; i < nargs; i++) {
-    JS::Value jsValue = jsTypeFactory(cx, PyTuple_GetItem(args, i));
+  JSFunctionProxy *proxy = (JSFunctionProxy *)self;
+  JS::RootedValue jsFunc(cx, JS::ObjectValue(**proxy->jsFunc));
+  // if jsFunc is not bound, assume `this` is `globalThis`
+  JS::RootedObject thisObj(cx, proxy->jsThis ? proxy->jsThis->get() : JS::CurrentGlobalOrNull(cx));
+  return callJSFunction(cx, thisObj, jsFunc, args, nargsf, kwnames);
+}
+
+/**
+ * @brief Convert python arguments in the vectorcall layout to JS values
+ *
+ * @param cx - javascript context pointer
+ * @param jsArg - rooted scratch value
+ * @param jsArgs - where to store the JS values, must have room for `nargs` values, plus one if `kwnames` is passed to JS
+ * @param args - positional args, followed by the values of the keyword args
+ * @param nargs - number of positional args
+ * @param kwnames - tuple of the names of the keyword args, or NULL if they are not passed to JS
+ * @return true - the arguments were converted
+ * @return false - an exception was set
+ */
+static bool convertArgs(JSContext *cx, JS::MutableHandleValue jsArg, JS::Value *jsArgs, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+  for (Py_ssize_t i = 0; i < nargs; i++) {
+    jsArgs[i] = jsTypeFactory(cx, args[i]);
     if (PyErr_Occurred()) { // Check if an exception has already been set in the flow of control
-      return NULL; // Fail-fast
+      return false; // Fail-fast
     }
-    if (!jsArgsVector.append(jsValue)) {
+  }
+
+  if (kwnames) { // collect the keyword args into a trailing options object
+    JS::RootedObject options(cx, JS_NewPlainObject(cx));
+    if (!options) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+    Py_ssize_t nkwargs = PyTuple_GET_SIZE(kwnames);
+    for (Py_ssize_t i = 0; i < nkwargs; i++) {
+      JS::RootedId nameId(cx);
+      if (!keyToId(PyTuple_GET_ITEM(kwnames, i), &nameId)) {
+        setSpiderMonkeyException(cx);
+        return false;
+      }
+      jsArg.set(jsTypeFactory(cx, args[nargs + i]));
+      if (PyErr_Occurred()) {
+        return false;
+      }
+      if (!JS_SetPropertyById(cx, options, nameId, jsArg)) {
+        setSpiderMonkeyException(cx);
+        return false;
+      }
+    }
+    jsArgs[nargs].setObject(*options);
+  }
+
+  return true;
+}
+
+PyObject *JSFunctionProxyMethodDefinitions::callJSFunction(JSContext *cx, JS::HandleObject thisObj, JS::HandleValue jsFunc, PyObject *const *args, size_t nargsf, PyObject *kwnames) {
+  Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+  if (kwnames && (!keywordArgumentsAsOptions || PyTuple_GET_SIZE(kwnames) == 0)) {
+    kwnames = NULL; // keyword arguments are ignored
+  }
+  size_t argc = nargs + (kwnames ? 1 : 0);
+
+  GILSwitch::AutoHandOver handOver;
+  if (!handOver.entered()) {
+    return NULL;
+  }
+
+  JS::RootedValue jsArg(cx);
+  JS::RootedValue jsReturnVal(cx);
+  bool ok;
+  if (argc <= JS_FUNC_SMALL_ARGS_COUNT) { // use an inline rooted buffer for the common case
+    JS::RootedValueArray<JS_FUNC_SMALL_ARGS_COUNT> jsArgs(cx);
+    if (!convertArgs(cx, &jsArg, &jsArgs[0], args, nargs, kwnames)) {
+      return NULL;
+    }
+    ok = JS_CallFunctionValue(cx, thisObj, jsFunc, JS::HandleValueArray::subarray(jsArgs, 0, argc), &jsReturnVal);
+  }
+  else {
+    JS::RootedVector<JS::Value> jsArgs(cx);
+    if (!jsArgs.resize(argc)) {
       // out of memory
       setSpiderMonkeyException(cx);
       return NULL;
     }
+    if (!convertArgs(cx, &jsArg, jsArgs.begin(), args, nargs, kwnames)) {
+      return NULL;
+    }
+    ok = JS_CallFunctionValue(cx, thisObj, jsFunc, jsArgs, &jsReturnVal);
   }
 
-  JS::HandleValueArray jsArgs(jsArgsVector);
-  JS::RootedValue jsReturnVal(cx);
-  if (!JS_CallFunctionValue(cx, thisObj, jsFunc, jsArgs, &jsReturnVal)) {
+  if (!ok) {
     setSpiderMonkeyException(cx);
     return NULL;
   }
@@ -64,4 +172,120 @@ PyObject *JSFunctionProxyMethodDefinitions::JSFunctionProxy_call(PyObject *self,
   }
 
   return pyTypeFactory(cx, jsReturnVal);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Pull up to `chunk` items of a Python iterator and convert them to JS values
+ *
+ * @return bool - false with an exception set if the iterator or a conversion failed, `jsArgs` is left empty once the iterator is exhausted
+ */
+static bool convertChunk(JSContext *cx, PyObject *iterator, Py_ssize_t chunk, JS::MutableHandleValueVector jsArgs) {
+  jsArgs.clear();
+  while ((Py_ssize_t)jsArgs.length() < chunk) {
+    PyObject *item = PyIter_Next(iterator);
+    if (!item) {
+      return !PyErr_Occurred();
+    }
+    JS::Value jsArg = jsTypeFactory(cx, item);
+    Py_DECREF(item);
+    if (PyErr_Occurred()) {
+      return false;
+    }
+    if (!jsArgs.append(jsArg)) {
+      setSpiderMonkeyException(cx); // out of memory
+      return false;
+    }
+  }
+  return true;
+}
+
+PyObject *JSFunctionProxyMethodDefinitions::callMany(JSContext *cx, PyObject *func, PyObject *iterable, Py_ssize_t chunk) {
+  ProfilerLabel profilerLabel("callMany");
+  JS::RootedValue jsFunc(cx);
+  JS::RootedObject thisObj(cx, JS::CurrentGlobalOrNull(cx));
+  if (PyObject_TypeCheck(func, &JSFunctionProxyType)) {
+    JSFunctionProxy *proxy = (JSFunctionProxy *)func;
+    jsFunc.setObject(**proxy->jsFunc);
+    if (proxy->jsThis) {
+      thisObj.set(*proxy->jsThis);
+    }
+  } else if (PyObject_TypeCheck(func, &JSMethodProxyType)) {
+    JSMethodProxy *proxy = (JSMethodProxy *)func;
+    jsFunc.setObject(**proxy->jsFunc);
+    JS::RootedValue selfValue(cx, jsTypeFactory(cx, proxy->self));
+    if (PyErr_Occurred() || !JS_ValueToObject(cx, selfValue, &thisObj)) {
+      return NULL;
+    }
+  } else {
+    jsFunc.set(jsTypeFactory(cx, func));
+    if (PyErr_Occurred()) {
+      return NULL;
+    }
+  }
+  if (!jsFunc.isObject() || !JS::IsCallable(&jsFunc.toObject())) {
+    PyErr_Format(PyExc_TypeError, "callMany() expects a function, not %s", Py_TYPE(func)->tp_name);
+    return NULL;
+  }
+
+  PyObject *iterator = PyObject_GetIter(iterable);
+  if (!iterator) {
+    return NULL;
+  }
+  PyObject *results = PyList_New(0);
+  if (!results) {
+    Py_DECREF(iterator);
+    return NULL;
+  }
+
+  JS::RootedVector<JS::Value> jsArgs(cx);
+  JS::RootedVector<JS::Value> jsResults(cx);
+  for (;;) {
+    if (!convertChunk(cx, iterator, chunk, &jsArgs)) {
+      goto error;
+    }
+    size_t length = jsArgs.length();
+    if (length == 0) {
+      break;
+    }
+    if (!jsResults.resize(length)) {
+      setSpiderMonkeyException(cx); // out of memory
+      goto error;
+    }
+
+    {
+      GILSwitch::AutoHandOver handOver;
+      if (!handOver.entered()) {
+        goto error;
+      }
+      for (size_t i = 0; i < length; i++) {
+        if (!JS_CallFunctionValue(cx, thisObj, jsFunc, JS::HandleValueArray::subarray(jsArgs, i, 1), jsResults[i])) {
+          setSpiderMonkeyException(cx);
+          goto error;
+        }
+        if (PyErr_Occurred()) { // raised by a Python function called from JS
+          goto error;
+        }
+      }
+    }
+
+    for (size_t i = 0; i < length; i++) {
+      PyObject *result = pyTypeFactory(cx, jsResults[i]);
+      if (!result || PyList_Append(results, result) < 0) {
+        Py_XDECREF(result);
+        goto error;
+      }
+      Py_DECREF(result);
+    }
+    if ((Py_ssize_t)length < chunk) {
+      break; // the iterator is exhausted
+    }
+  }
+
+  Py_DECREF(iterator);
+  return results;
+
+error:
+  Py_DECREF(iterator);
+  Py_DECREF(results);
+  return NULL;
+}
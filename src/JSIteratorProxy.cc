@@ -0,0 +1,299 @@
+/**
+ * @file JSIteratorProxy.cc
+ * @author agent (agent@local)
+ * @brief JSIteratorProxy is a custom C-implemented python type that derives from JSObjectProxy. It proxies the JS iterables, iterators and
+ * generators, and iterates them with the JS iteration protocol
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSIteratorProxy.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/ProxyCache.hh"
+#include "include/RootPool.hh"
+#include "include/PromiseType.hh"
+#include "include/pyTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/Promise.h>
+#include <js/Proxy.h>
+#include <js/Symbol.h>
+
+#include <Python.h>
+
+#include <cstring>
+
+void JSIteratorProxyMethodDefinitions::JSIteratorProxy_dealloc(JSIteratorProxy *self)
+{
+  Retention::unpinJS((PyObject *)self); // before the deferral, as for a JSObjectProxy
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSIteratorProxyMethodDefinitions::JSIteratorProxy_dealloc)) {
+    return;
+  }
+  delete self->next;
+  self->next = nullptr;
+  JSObjectProxyMethodDefinitions::JSObjectProxy_dealloc(&self->object);
+}
+
+/**
+ * @brief Get a well-known symbol method of a JS object
+ *
+ * @return bool - false if the lookup threw, `method` is left undefined if the object has no such method
+ */
+static bool getSymbolMethod(JSContext *cx, JS::HandleObject obj, JS::SymbolCode code, JS::MutableHandleValue method) {
+  JS::RootedId id(cx, JS::PropertyKey::Symbol(JS::GetWellKnownSymbol(cx, code)));
+  if (!JS_GetPropertyById(cx, obj, id, method)) {
+    return false;
+  }
+  if (!method.isObject() || !JS::IsCallable(&method.toObject())) {
+    method.setUndefined();
+  }
+  return true;
+}
+
+// the classes of the generators and of the builtin iterators, which are their own iterators
+static const char *const iteratorClassNames[] = {
+  "Generator", "Array Iterator", "Map Iterator", "Set Iterator", "String Iterator", "RegExp String Iterator", "Iterator Helper",
+  "Wrap For Valid Iterator",
+};
+static const char *const asyncIteratorClassNames[] = {"AsyncGenerator", "Async Iterator Helper"};
+
+template<size_t N>
+static bool hasClassName(const char *name, const char *const (&names)[N]) {
+  for (const char *candidate : names) {
+    if (strcmp(name, candidate) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Whether a JS object has an own data property holding a function, without running any getter
+ *
+ * @return bool - false with a JS exception pending if the lookup failed
+ */
+static bool hasOwnMethod(JSContext *cx, JS::HandleObject obj, JS::SymbolCode code, bool *found) {
+  JS::RootedId id(cx, JS::PropertyKey::Symbol(JS::GetWellKnownSymbol(cx, code)));
+  JS::Rooted<mozilla::Maybe<JS::PropertyDescriptor>> desc(cx);
+  if (!JS_GetOwnPropertyDescriptorById(cx, obj, id, &desc)) {
+    return false;
+  }
+  *found = desc.isSome() && desc->isDataDescriptor() && desc->value().isObject() && JS::IsCallable(&desc->value().toObject());
+  return true;
+}
+
+bool JSIteratorProxyMethodDefinitions::isIterable(JSContext *cx, JS::HandleObject obj, bool *iterable, bool *async, bool *iterator) {
+  *iterable = false;
+  if (js::IsProxy(obj)) {
+    return true; // a JS Proxy or a wrapper, whose traps are only run by accessing the dict
+  }
+
+  const char *className = JS::GetClass(obj)->name;
+  if (hasClassName(className, iteratorClassNames) || hasClassName(className, asyncIteratorClassNames)) {
+    *iterable = *iterator = true;
+    *async = hasClassName(className, asyncIteratorClassNames);
+    return true;
+  }
+
+  *iterator = false;
+  if (!hasOwnMethod(cx, obj, JS::SymbolCode::iterator, iterable)) {
+    return false;
+  }
+  if (*iterable) {
+    *async = false;
+    return true;
+  }
+  if (!hasOwnMethod(cx, obj, JS::SymbolCode::asyncIterator, iterable)) {
+    return false;
+  }
+  *async = true;
+  return true;
+}
+
+/**
+ * @brief Create a proxy of a JS iterable, cached as the proxy of its object if `cache`
+ */
+static PyObject *newProxy(JSContext *cx, JS::HandleObject obj, bool async, bool iterator, bool cache) {
+  PyTypeObject *type = iterator ? &JSIteratorProxyType : &JSIterableProxyType;
+  JSIteratorProxy *proxy = (JSIteratorProxy *)PyObject_CallObject((PyObject *)type, NULL);
+  if (proxy != NULL) {
+    proxy->object.jsObject = RootPool::newRoot(cx, obj);
+    proxy->next = nullptr;
+    proxy->async = async;
+    if (cache) {
+      ProxyCache::putPyProxy(obj, (PyObject *)proxy);
+    }
+    CrossHeap::registerProxy((PyObject *)proxy, proxy->object.jsObject);
+    MemoryStats::jsObjectProxies++;
+    Retention::pinJS(cx, (PyObject *)proxy);
+    return (PyObject *)proxy;
+  }
+  return NULL;
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::getPyObject(JSContext *cx, JS::HandleObject obj, bool async, bool iterator) {
+  PyObject *cached = ProxyCache::getPyProxy(obj);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSObjectProxyType)) {
+      return cached; // the proxy keeps its identity, even if the object became iterable since it was proxied
+    }
+    Py_DECREF(cached);
+  }
+  return newProxy(cx, obj, async, iterator, true);
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::getIteratorPyObject(JSContext *cx, JS::HandleObject obj, bool async) {
+  PyObject *cached = ProxyCache::getPyProxy(obj);
+  if (cached) {
+    if (Py_TYPE(cached) == &JSIteratorProxyType && ((JSIteratorProxy *)cached)->async == async) {
+      return cached;
+    }
+    Py_DECREF(cached); // e.g. an iterable returning itself from `[Symbol.iterator]()`, its proxy is not replaced
+    return newProxy(cx, obj, async, true, false);
+  }
+  return newProxy(cx, obj, async, true, true);
+}
+
+/**
+ * @brief Call the iterator method of the JS object of a proxy, `[Symbol.iterator]` or `[Symbol.asyncIterator]`
+ *
+ * @return PyObject* - self if the object is its own iterator or has no such method (it is then the iterator handed out by another one),
+ * a new JSIteratorProxy of the iterator otherwise, or NULL with an exception set
+ */
+static PyObject *getIterator(JSIteratorProxy *self, JS::SymbolCode code, bool async) {
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedObject obj(cx, *(self->object.jsObject));
+  JS::RootedValue method(cx);
+  if (!getSymbolMethod(cx, obj, code, &method)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  if (method.isUndefined()) {
+    if (self->async != async || Py_TYPE(self) != &JSIteratorProxyType) {
+      PyErr_Format(PyExc_TypeError, "the JS object is not %s iterable", async ? "async" : "sync");
+      return NULL;
+    }
+    Py_INCREF(self);
+    return (PyObject *)self;
+  }
+
+  JS::RootedValue iterator(cx);
+  JS::RootedValue thisValue(cx, JS::ObjectValue(*obj));
+  if (!JS::Call(cx, thisValue, method, JS::HandleValueArray::empty(), &iterator)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  if (!iterator.isObject()) {
+    PyErr_SetString(PyExc_TypeError, "the JS iterator is not an object");
+    return NULL;
+  }
+  if (&iterator.toObject() == obj && self->async == async && Py_TYPE(self) == &JSIteratorProxyType) {
+    Py_INCREF(self);
+    return (PyObject *)self;
+  }
+  JS::RootedObject iteratorObj(cx, &iterator.toObject());
+  return JSIteratorProxyMethodDefinitions::getIteratorPyObject(cx, iteratorObj, async);
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::JSIteratorProxy_iter(JSIteratorProxy *self) {
+  if (self->async) {
+    PyErr_SetString(PyExc_TypeError, "the JS object is an async iterable, iterate it with `async for`");
+    return NULL;
+  }
+  return getIterator(self, JS::SymbolCode::iterator, false);
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::JSIteratorProxy_aiter(JSIteratorProxy *self) {
+  return getIterator(self, JS::SymbolCode::asyncIterator, true);
+}
+
+/**
+ * @brief Call the `next` method of the JS iterator of a proxy, looked up once
+ *
+ * @return bool - false with a Python exception set if the call threw, or if the object is not an iterator
+ */
+static bool callNext(JSIteratorProxy *self, JS::MutableHandleValue result) {
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedObject obj(cx, *(self->object.jsObject));
+  if (!self->next) {
+    JS::RootedValue next(cx);
+    if (!JS_GetProperty(cx, obj, "next", &next)) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+    if (!next.isObject() || !JS::IsCallable(&next.toObject())) {
+      PyErr_SetString(PyExc_TypeError, "the JS object is not an iterator, its next property is not a function");
+      return false;
+    }
+    self->next = new JS::PersistentRootedValue(cx, next);
+  }
+
+  JS::RootedValue thisValue(cx, JS::ObjectValue(*obj));
+  if (!JS::Call(cx, thisValue, *(self->next), JS::HandleValueArray::empty(), result)) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  return true;
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::JSIteratorProxy_iternext(JSIteratorProxy *self) {
+  JSContext *cx = GLOBAL_CX;
+  if (self->async) {
+    PyErr_SetString(PyExc_TypeError, "the JS object is an async iterator, iterate it with `async for`");
+    return NULL;
+  }
+
+  JS::RootedValue result(cx);
+  if (!callNext(self, &result)) {
+    return NULL;
+  }
+  if (!result.isObject()) {
+    PyErr_SetString(PyExc_TypeError, "the JS iterator result is not an object");
+    return NULL;
+  }
+
+  // unpack the iterator result without creating a proxy for it
+  JS::RootedObject resultObj(cx, &result.toObject());
+  JS::RootedValue done(cx);
+  if (!JS_GetProperty(cx, resultObj, "done", &done)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  if (JS::ToBoolean(done)) {
+    return NULL; // StopIteration
+  }
+  JS::RootedValue value(cx);
+  if (!JS_GetProperty(cx, resultObj, "value", &value)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  return pyTypeFactory(cx, value);
+}
+
+PyObject *JSIteratorProxyMethodDefinitions::JSIteratorProxy_anext(JSIteratorProxy *self) {
+  JSContext *cx = GLOBAL_CX;
+  if (!self->async) {
+    PyErr_SetString(PyExc_TypeError, "the JS object is not an async iterator, iterate it with `for`");
+    return NULL;
+  }
+
+  JS::RootedValue result(cx);
+  if (!callNext(self, &result)) {
+    return NULL;
+  }
+  JS::RootedObject promise(cx, JS::CallOriginalPromiseResolve(cx, result)); // the result itself if it is a Promise
+  if (!promise) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  return PromiseType::getIteratorValuePyObject(cx, promise);
+}
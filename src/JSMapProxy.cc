@@ -0,0 +1,291 @@
+/**
+ * @file JSMapProxy.cc
+ * @author agent (agent@local)
+ * @brief JSMapProxy is a custom C-implemented python type that proxies a JS Map as a Python mapping, its entries being looked up
+ * by `JS::MapGet`/`JS::MapHas` with the JS value of the Python key rather than by a property name
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSMapProxy.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/JSIteratorProxy.hh"
+#include "include/MemoryStats.hh"
+#include "include/ProxyCache.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
+#include "include/jsTypeFactory.hh"
+#include "include/pyTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <js/MapAndSet.h>
+
+#include <Python.h>
+
+void JSMapProxyMethodDefinitions::JSMapProxy_dealloc(JSMapProxy *self)
+{
+  Retention::unpinJS((PyObject *)self);
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSMapProxyMethodDefinitions::JSMapProxy_dealloc)) {
+    return;
+  }
+  CrossHeap::unregisterProxy((PyObject *)self);
+  MemoryStats::jsObjectProxies--;
+  ProxyCache::removePyProxy(*(self->jsMap), (PyObject *)self);
+  RootPool::deleteRoot(self->jsMap);
+  PyObject_GC_UnTrack(self);
+  PyObject_GC_Del(self);
+}
+
+int JSMapProxyMethodDefinitions::JSMapProxy_traverse(JSMapProxy *self, visitproc visit, void *arg)
+{
+  return CrossHeap::traverse((PyObject *)self, visit, arg);
+}
+
+int JSMapProxyMethodDefinitions::JSMapProxy_clear(JSMapProxy *self)
+{
+  // The cycle is broken by clearing the other Python objects in it, the JS Map stays rooted until the proxy is deallocated
+  return 0;
+}
+
+PyObject *JSMapProxyMethodDefinitions::getPyObject(JSContext *cx, JS::HandleObject map) {
+  PyObject *cached = ProxyCache::getPyProxy(map);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSMapProxyType)) {
+      return cached;
+    }
+    Py_DECREF(cached); // the Map is already proxied as another type, e.g. as a JSObjectProxy
+  }
+
+  JSMapProxy *proxy = PyObject_GC_New(JSMapProxy, &JSMapProxyType);
+  if (proxy == NULL) {
+    return NULL;
+  }
+  proxy->jsMap = RootPool::newRoot(cx, map);
+  ProxyCache::putPyProxy(map, (PyObject *)proxy);
+  CrossHeap::registerProxy((PyObject *)proxy, proxy->jsMap);
+  MemoryStats::jsObjectProxies++;
+  Retention::pinJS(cx, (PyObject *)proxy);
+  PyObject_GC_Track(proxy);
+  return (PyObject *)proxy;
+}
+
+Py_ssize_t JSMapProxyMethodDefinitions::JSMapProxy_length(JSMapProxy *self)
+{
+  return JS::MapSize(GLOBAL_CX, *(self->jsMap));
+}
+
+/**
+ * @brief Look up the entry of a key
+ *
+ * @return int - 1 if the Map has an entry for the key, its value is then set, 0 if not, -1 with an exception set
+ */
+static int lookUp(JSMapProxy *self, PyObject *key, JS::MutableHandleValue value) {
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsKey(cx, jsTypeFactory(cx, key));
+  if (!JS::MapGet(cx, *(self->jsMap), jsKey, value)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if (!value.isUndefined()) {
+    return 1;
+  }
+  bool found; // an entry can hold undefined
+  if (!JS::MapHas(cx, *(self->jsMap), jsKey, &found)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  return found;
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_get(JSMapProxy *self, PyObject *key)
+{
+  JS::RootedValue value(GLOBAL_CX);
+  int found = lookUp(self, key, &value);
+  if (found < 0) {
+    return NULL;
+  }
+  if (!found) {
+    PyErr_SetObject(PyExc_KeyError, key);
+    return NULL;
+  }
+  return pyTypeFactory(GLOBAL_CX, value);
+}
+
+int JSMapProxyMethodDefinitions::JSMapProxy_assign(JSMapProxy *self, PyObject *key, PyObject *value)
+{
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsKey(cx, jsTypeFactory(cx, key));
+  if (value) { // we are setting a value
+    JS::RootedValue jsValue(cx, jsTypeFactory(cx, value));
+    if (!JS::MapSet(cx, *(self->jsMap), jsKey, jsValue)) {
+      setSpiderMonkeyException(cx);
+      return -1;
+    }
+    return 0;
+  }
+
+  bool deleted;
+  if (!JS::MapDelete(cx, *(self->jsMap), jsKey, &deleted)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  if (!deleted) {
+    PyErr_SetObject(PyExc_KeyError, key);
+    return -1;
+  }
+  return 0;
+}
+
+int JSMapProxyMethodDefinitions::JSMapProxy_contains(JSMapProxy *self, PyObject *key)
+{
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsKey(cx, jsTypeFactory(cx, key));
+  bool found;
+  if (!JS::MapHas(cx, *(self->jsMap), jsKey, &found)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  return found;
+}
+
+/**
+ * @brief Proxy one of the iterators of a Map, `map.keys()`, `map.values()` or `map.entries()`
+ */
+static PyObject *mapIterator(JSMapProxy *self, bool (*getIterator)(JSContext *, JS::HandleObject, JS::MutableHandleValue)) {
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue iterator(cx);
+  if (!getIterator(cx, *(self->jsMap), &iterator)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  JS::RootedObject iteratorObj(cx, &iterator.toObject());
+  return JSIteratorProxyMethodDefinitions::getIteratorPyObject(cx, iteratorObj, false);
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_iter(JSMapProxy *self)
+{
+  return mapIterator(self, JS::MapKeys);
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_repr(JSMapProxy *self)
+{
+  int status = Py_ReprEnter((PyObject *)self);
+  if (status != 0) {
+    return status > 0 ? PyUnicode_FromString("{...}") : NULL;
+  }
+
+  PyObject *parts = PyList_New(0);
+  PyObject *entries = parts ? mapIterator(self, JS::MapEntries) : NULL;
+  PyObject *iterator = entries ? PyObject_GetIter(entries) : NULL;
+  Py_XDECREF(entries);
+  PyObject *result = NULL;
+  if (iterator) {
+    PyObject *entry;
+    while ((entry = PyIter_Next(iterator))) { // `[key, value]` JSArrayProxy lists, whose items are read from the JS Array
+      PyObject *key = PySequence_GetItem(entry, 0);
+      PyObject *value = key ? PySequence_GetItem(entry, 1) : NULL;
+      PyObject *part = value ? PyUnicode_FromFormat("%R: %R", key, value) : NULL;
+      Py_XDECREF(key);
+      Py_XDECREF(value);
+      Py_DECREF(entry);
+      if (!part || PyList_Append(parts, part) < 0) {
+        Py_XDECREF(part);
+        break;
+      }
+      Py_DECREF(part);
+    }
+    Py_DECREF(iterator);
+  }
+  if (parts && !PyErr_Occurred()) {
+    PyObject *separator = PyUnicode_FromString(", ");
+    PyObject *joined = separator ? PyUnicode_Join(separator, parts) : NULL;
+    Py_XDECREF(separator);
+    if (joined) {
+      result = PyUnicode_FromFormat("{%U}", joined);
+      Py_DECREF(joined);
+    }
+  }
+  Py_XDECREF(parts);
+  Py_ReprLeave((PyObject *)self);
+  return result;
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_get_method(JSMapProxy *self, PyObject *args)
+{
+  PyObject *key;
+  PyObject *defaultValue = Py_None;
+  if (!PyArg_ParseTuple(args, "O|O:get", &key, &defaultValue)) {
+    return NULL;
+  }
+
+  JS::RootedValue value(GLOBAL_CX);
+  int found = lookUp(self, key, &value);
+  if (found < 0) {
+    return NULL;
+  }
+  if (!found) {
+    Py_INCREF(defaultValue);
+    return defaultValue;
+  }
+  return pyTypeFactory(GLOBAL_CX, value);
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_pop_method(JSMapProxy *self, PyObject *args)
+{
+  PyObject *key;
+  PyObject *defaultValue = NULL;
+  if (!PyArg_ParseTuple(args, "O|O:pop", &key, &defaultValue)) {
+    return NULL;
+  }
+
+  JS::RootedValue value(GLOBAL_CX);
+  int found = lookUp(self, key, &value);
+  if (found < 0) {
+    return NULL;
+  }
+  if (!found) {
+    if (defaultValue) {
+      Py_INCREF(defaultValue);
+      return defaultValue;
+    }
+    PyErr_SetObject(PyExc_KeyError, key);
+    return NULL;
+  }
+
+  PyObject *result = pyTypeFactory(GLOBAL_CX, value);
+  if (result && JSMapProxy_assign(self, key, NULL) < 0) {
+    Py_DECREF(result);
+    return NULL;
+  }
+  return result;
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_clear_method(JSMapProxy *self)
+{
+  if (!JS::MapClear(GLOBAL_CX, *(self->jsMap))) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_keys_method(JSMapProxy *self)
+{
+  return mapIterator(self, JS::MapKeys);
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_values_method(JSMapProxy *self)
+{
+  return mapIterator(self, JS::MapValues);
+}
+
+PyObject *JSMapProxyMethodDefinitions::JSMapProxy_items_method(JSMapProxy *self)
+{
+  return mapIterator(self, JS::MapEntries);
+}
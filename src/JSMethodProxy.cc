@@ -10,19 +10,29 @@
 
 #include "include/JSMethodProxy.hh"
 
+#include "include/ContextOwner.hh"
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
 #include "include/jsTypeFactory.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 #include "include/pyTypeFactory.hh"
 #include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
 
 #include <Python.h>
+#include "include/pyshim.hh"
 
 void JSMethodProxyMethodDefinitions::JSMethodProxy_dealloc(JSMethodProxy *self)
 {
-  delete self->jsFunc;
-  return;
+  Retention::unpinJS((PyObject *)self);
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSMethodProxyMethodDefinitions::JSMethodProxy_dealloc)) {
+    return;
+  }
+  RootPool::deleteRoot(self->jsFunc);
+  MemoryStats::jsMethodProxies--;
+  Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
 PyObject *JSMethodProxyMethodDefinitions::JSMethodProxy_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds) {
@@ -36,43 +46,24 @@ PyObject *JSMethodProxyMethodDefinitions::JSMethodProxy_new(PyTypeObject *subtyp
   JSMethodProxy *self = (JSMethodProxy *)subtype->tp_alloc(subtype, 0);
   if (self) {
     self->self = im_self;
-    self->jsFunc = new JS::PersistentRootedObject(GLOBAL_CX);
-    self->jsFunc->set(*(jsFunctionProxy->jsFunc));
+    self->jsFunc = RootPool::newRoot(GLOBAL_CX, *(jsFunctionProxy->jsFunc));
+    self->vectorcall = JSMethodProxy_vectorcall;
+    MemoryStats::jsMethodProxies++;
+    Retention::pinJS(GLOBAL_CX, (PyObject *)self);
   }
 
   return (PyObject *)self;
 }
 
 PyObject *JSMethodProxyMethodDefinitions::JSMethodProxy_call(PyObject *self, PyObject *args, PyObject *kwargs) {
+  return PyVectorcall_Call(self, args, kwargs);
+}
+
+PyObject *JSMethodProxyMethodDefinitions::JSMethodProxy_vectorcall(PyObject *self, PyObject *const *args, size_t nargsf, PyObject *kwnames) {
   JSContext *cx = GLOBAL_CX;
-  JS::RootedValue jsFunc(GLOBAL_CX, JS::ObjectValue(**((JSMethodProxy *)self)->jsFunc));
+  JS::RootedValue jsFunc(cx, JS::ObjectValue(**((JSMethodProxy *)self)->jsFunc));
   JS::RootedValue selfValue(cx, jsTypeFactory(cx, ((JSMethodProxy *)self)->self));
   JS::RootedObject selfObject(cx);
   JS_ValueToObject(cx, selfValue, &selfObject);
-
-  JS::RootedVector<JS::Value> jsArgsVector(cx);
-  for (size_t i = 0; i < PyTuple_Size(args); i++) {
-    JS::Value jsValue = jsTypeFactory(cx, PyTuple_GetItem(args, i));
-    if (PyErr_Occurred()) { // Check if an exception has already been set in the flow of control
-      return NULL; // Fail-fast
-    }
-    if (!jsArgsVector.append(jsValue)) {
-      // out of memory
-      setSpiderMonkeyException(cx);
-      return NULL;
-    }
-  }
-
-  JS::HandleValueArray jsArgs(jsArgsVector);
-  JS::RootedValue jsReturnVal(cx);
-  if (!JS_CallFunctionValue(cx, selfObject, jsFunc, jsArgs, &jsReturnVal)) {
-    setSpiderMonkeyException(cx);
-    return NULL;
-  }
-
-  if (PyErr_Occurred()) {
-    return NULL;
-  }
-
-  return pyTypeFactory(cx, jsReturnVal);
-}
\ No newline at end of file
+  return JSFunctionProxyMethodDefinitions::callJSFunction(cx, selfObject, jsFunc, args, nargsf, kwnames);
+}
@@ -0,0 +1,423 @@
+/**
+ * @file JSONStringify.cc
+ * @author agent (agent@local)
+ * @brief The native encoder behind `JSON.stringify` of the proxies of Python dicts and lists
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSONStringify.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/HotPathStats.hh"
+#include "include/JSArrayProxy.hh"
+#include "include/JSObjectProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/PyBaseProxyHandler.hh"
+#include "include/PyDictProxyHandler.hh"
+#include "include/PyListProxyHandler.hh"
+#include "include/PyMapProxyHandler.hh"
+
+#include <jsapi.h>
+#include <js/Conversions.h>
+#include <js/Proxy.h>
+
+#include <Python.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define JSON_MAX_DEPTH 1000 // deeper trees are left to the original JSON.stringify, which reports the too much recursion
+#define JSON_KEPT_BUFFER_CAPACITY (1 << 20) // code units of the output buffer kept allocated between the calls
+
+static JS::PersistentRootedObject *originalStringify = nullptr;
+
+static std::u16string output; // reused by all the calls, there is no reentrancy as the encoder runs no JS or Python code
+static std::u16string ucs4Scratch;
+
+static PyObject *toJSONKey = nullptr;
+
+enum class Encoded {
+  value,     // written to the output
+  undefined, // skipped in an object, `null` in an array
+  bail       // left to the original JSON.stringify
+};
+
+/**
+ * @brief Append a string quoted and escaped like QuoteJSONString, https://tc39.es/ecma262/#sec-quotejsonstring
+ *
+ * @tparam CharT - the code units, Latin-1 or UTF-16
+ */
+template<typename CharT>
+static void quote(const CharT *chars, size_t length) {
+  static const char16_t hexDigits[] = u"0123456789abcdef";
+  output.push_back(u'"');
+  for (size_t i = 0; i < length; i++) {
+    char16_t c = chars[i];
+    switch (c) {
+    case u'"': output.append(u"\\\""); continue;
+    case u'\\': output.append(u"\\\\"); continue;
+    case u'\b': output.append(u"\\b"); continue;
+    case u'\f': output.append(u"\\f"); continue;
+    case u'\n': output.append(u"\\n"); continue;
+    case u'\r': output.append(u"\\r"); continue;
+    case u'\t': output.append(u"\\t"); continue;
+    default: break;
+    }
+    bool escape = c < 0x20;
+    if (c >= 0xD800 && c <= 0xDFFF) { // only the lone surrogates are escaped
+      if (c <= 0xDBFF && i + 1 < length && chars[i + 1] >= 0xDC00 && chars[i + 1] <= 0xDFFF) {
+        output.push_back(c);
+        output.push_back(chars[++i]);
+        continue;
+      }
+      escape = true;
+    }
+    if (escape) {
+      const char16_t escaped[] = {u'\\', u'u', hexDigits[c >> 12], hexDigits[(c >> 8) & 0xF], hexDigits[(c >> 4) & 0xF], hexDigits[c & 0xF]};
+      output.append(escaped, 6);
+    } else {
+      output.push_back(c);
+    }
+  }
+  output.push_back(u'"');
+}
+
+/**
+ * @brief Append a str as the JS string jsTypeFactory makes of it, a UCS-4 str being transcoded to UTF-16 first
+ */
+static void quoteString(PyObject *str) {
+  Py_ssize_t length = PyUnicode_GET_LENGTH(str);
+  switch (PyUnicode_KIND(str)) {
+  case PyUnicode_1BYTE_KIND:
+    quote(PyUnicode_1BYTE_DATA(str), length);
+    break;
+  case PyUnicode_2BYTE_KIND:
+    quote((const char16_t *)PyUnicode_2BYTE_DATA(str), length);
+    break;
+  default: {
+      const Py_UCS4 *chars = PyUnicode_4BYTE_DATA(str);
+      ucs4Scratch.clear();
+      for (Py_ssize_t i = 0; i < length; i++) {
+        Py_UCS4 c = chars[i];
+        if (c > 0xFFFF) {
+          c -= 0x10000;
+          ucs4Scratch.push_back((char16_t)(0xD800 + (c >> 10)));
+          ucs4Scratch.push_back((char16_t)(0xDC00 + (c & 0x3FF)));
+        } else {
+          ucs4Scratch.push_back((char16_t)c);
+        }
+      }
+      quote(ucs4Scratch.data(), ucs4Scratch.size());
+      break;
+    }
+  }
+}
+
+static void appendASCII(const char *chars) {
+  for (; *chars; chars++) {
+    output.push_back((char16_t)*chars);
+  }
+}
+
+/**
+ * @brief The state of one serialization, the gap and the current indent of SerializeJSONObject and SerializeJSONArray
+ */
+struct Encoder {
+  std::u16string gap;
+  std::u16string indent;
+  std::vector<PyObject *> stack; // the dicts and lists being serialized, to leave the cycles to the original JSON.stringify
+
+  Encoded value(PyObject *value);
+  Encoded object(PyObject *dict);
+  Encoded array(PyObject *list);
+
+  void newline() {
+    output.push_back(u'\n');
+    output.append(indent);
+  }
+
+  bool isOnStack(PyObject *container) {
+    for (PyObject *item : stack) {
+      if (item == container) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/**
+ * @brief Whether a dict or list is proxied in JS by the handler JSON.stringify would see it through, a dict first proxied while
+ * it had no str keys being a JS Map
+ */
+static bool hasPlainProxy(PyObject *container) {
+  JSObject *proxy = ProxyCache::getJSProxy(container);
+  if (!proxy) {
+    return !PyDict_Check(container) || !PyMapProxyHandler::isMapLike(container);
+  }
+  const void *family = js::GetProxyHandler(proxy)->family();
+  return family == &PyDictProxyHandler::family || family == &PyListProxyHandler::family;
+}
+
+Encoded Encoder::value(PyObject *value) {
+  if (PyBool_Check(value)) {
+    appendASCII(value == Py_True ? "true" : "false");
+    return Encoded::value;
+  }
+  if (PyLong_Check(value)) {
+    if (PyObject_TypeCheck(value, (PyTypeObject *)getPythonMonkeyBigInt()) || _PyLong_NumBits(value) > 53) {
+      return Encoded::bail; // a BigInt, or an int too big for a Number, both of which throw
+    }
+    char digits[24];
+    snprintf(digits, sizeof(digits), "%lld", PyLong_AsLongLong(value));
+    appendASCII(digits);
+    return Encoded::value;
+  }
+  if (PyFloat_Check(value)) {
+    double number = PyFloat_AS_DOUBLE(value);
+    if (!std::isfinite(number)) {
+      appendASCII("null");
+      return Encoded::value;
+    }
+    char digits[JS::MaximumNumberToStringLength];
+    JS::NumberToString(number, digits);
+    appendASCII(digits);
+    return Encoded::value;
+  }
+  if (PyUnicode_Check(value)) { // a JSStringProxy too, its chars can't move as nothing here can GC
+    quoteString(value);
+    return Encoded::value;
+  }
+  if (value == Py_None || PyMethod_Check(value) || PyFunction_Check(value) || PyCFunction_Check(value)) {
+    return Encoded::undefined;
+  }
+  if (value == getPythonMonkeyNull()) {
+    appendASCII("null");
+    return Encoded::value;
+  }
+  if (PyObject_TypeCheck(value, &JSObjectProxyType) || PyObject_TypeCheck(value, &JSArrayProxyType)) {
+    return Encoded::bail; // the JS objects may have toJSON methods, getters, ...
+  }
+  if (PyDict_Check(value) || PyList_Check(value)) {
+    if (!hasPlainProxy(value) || isOnStack(value) || stack.size() >= JSON_MAX_DEPTH) {
+      return Encoded::bail;
+    }
+    stack.push_back(value);
+    Encoded result = PyDict_Check(value) ? object(value) : array(value);
+    stack.pop_back();
+    return result;
+  }
+  return Encoded::bail;
+}
+
+Encoded Encoder::object(PyObject *dict) {
+  // the proxy would call the toJSON item of the dict
+  PyObject *toJSON = PyDict_GetItemWithError(dict, toJSONKey);
+  if (toJSON || PyErr_Occurred()) {
+    PyErr_Clear();
+    return Encoded::bail;
+  }
+
+  size_t start = output.size();
+  std::u16string stepback = indent;
+  indent.append(gap);
+  output.push_back(u'{');
+  bool empty = true;
+  PyObject *key, *item;
+  Py_ssize_t pos = 0;
+  while (PyDict_Next(dict, &pos, &key, &item)) {
+    if (!PyUnicode_Check(key)) {
+      return Encoded::bail; // the int keys are named by their index and the other keys are skipped, leave it to the proxy
+    }
+    size_t mark = output.size();
+    if (!empty) {
+      output.push_back(u',');
+    }
+    if (!gap.empty()) {
+      newline();
+    }
+    quoteString(key);
+    output.push_back(u':');
+    if (!gap.empty()) {
+      output.push_back(u' ');
+    }
+    Encoded result = value(item);
+    if (result == Encoded::bail) {
+      return result;
+    }
+    if (result == Encoded::undefined) {
+      output.resize(mark);
+    } else {
+      empty = false;
+    }
+  }
+  indent = stepback;
+  if (empty) {
+    output.resize(start);
+    output.append(u"{}");
+    return Encoded::value;
+  }
+  if (!gap.empty()) {
+    newline();
+  }
+  output.push_back(u'}');
+  return Encoded::value;
+}
+
+Encoded Encoder::array(PyObject *list) {
+  if (PyList_GET_SIZE(list) == 0) {
+    output.append(u"[]");
+    return Encoded::value;
+  }
+  std::u16string stepback = indent;
+  indent.append(gap);
+  output.push_back(u'[');
+  for (Py_ssize_t i = 0; i < PyList_GET_SIZE(list); i++) {
+    if (i > 0) {
+      output.push_back(u',');
+    }
+    if (!gap.empty()) {
+      newline();
+    }
+    Encoded result = value(PyList_GET_ITEM(list, i));
+    if (result == Encoded::bail) {
+      return result;
+    }
+    if (result == Encoded::undefined) {
+      appendASCII("null");
+    }
+  }
+  indent = stepback;
+  if (!gap.empty()) {
+    newline();
+  }
+  output.push_back(u']');
+  return Encoded::value;
+}
+
+/**
+ * @brief The gap of JSON.stringify, https://tc39.es/ecma262/#sec-json.stringify steps 5 to 8
+ *
+ * @return bool - false if `space` is a boxed Number or String, left to the original JSON.stringify
+ */
+static bool getGap(JSContext *cx, JS::HandleValue space, std::u16string &gap) {
+  if (space.isNumber()) {
+    double spaces = std::trunc(space.toNumber());
+    size_t count = spaces >= 10 ? 10 : (spaces >= 1 ? (size_t)spaces : 0); // NaN is 0
+    gap.assign(count, u' ');
+    return true;
+  }
+  if (space.isString()) {
+    JSString *str = space.toString();
+    size_t length = JS_GetStringLength(str);
+    for (size_t i = 0; i < length && i < 10; i++) {
+      char16_t c;
+      if (!JS_GetStringCharAt(cx, str, i, &c)) {
+        return false;
+      }
+      gap.push_back(c);
+    }
+    return true;
+  }
+  return !space.isObject();
+}
+
+/**
+ * @brief Whether a toJSON method was added to Object.prototype or Array.prototype, which JSON.stringify would call on every proxy
+ */
+static bool prototypesHaveToJSON(JSContext *cx, bool *found) {
+  JS::RootedObject arrayPrototype(cx);
+  if (!JS_GetClassPrototype(cx, JSProto_Array, &arrayPrototype)) {
+    return false;
+  }
+  return JS_HasProperty(cx, arrayPrototype, "toJSON", found); // Object.prototype is on its prototype chain
+}
+
+bool JSONStringify::stringify(JSContext *cx, PyObject *value, JS::HandleValue space, JS::MutableHandleValue rval, bool *handled) {
+  *handled = false;
+  Encoder encoder;
+  bool found;
+  if (!getGap(cx, space, encoder.gap) || !prototypesHaveToJSON(cx, &found) || found) {
+    return !JS_IsExceptionPending(cx);
+  }
+
+  output.clear();
+  if (encoder.value(value) != Encoded::value) {
+    return true;
+  }
+  JSString *str = JS_NewUCStringCopyN(cx, output.data(), output.size());
+  if (output.capacity() > JSON_KEPT_BUFFER_CAPACITY) {
+    std::u16string().swap(output);
+  }
+  if (!str) {
+    return false;
+  }
+  rval.setString(str);
+  *handled = true;
+  return true;
+}
+
+/**
+ * @brief The dict or list behind a proxy made by jsTypeFactory, or nullptr for the other values
+ */
+static PyObject *proxiedContainer(JS::HandleValue value) {
+  if (!value.isObject() || !js::IsProxy(&value.toObject())) {
+    return nullptr;
+  }
+  const void *family = js::GetProxyHandler(&value.toObject())->family();
+  if (family != &PyDictProxyHandler::family && family != &PyListProxyHandler::family) {
+    return nullptr;
+  }
+  return JS::GetMaybePtrFromReservedSlot<PyObject>(&value.toObject(), PyObjectSlot);
+}
+
+/**
+ * @brief `JSON.stringify(value, replacer, space)`
+ */
+static bool stringify(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  PyObject *container = proxiedContainer(args.get(0));
+  if (container && !args.get(1).isObject()) { // a replacer is a function or an array
+    bool handled;
+    if (!JSONStringify::stringify(cx, container, args.get(2), args.rval(), &handled)) {
+      return false;
+    }
+    if (handled) {
+      PYTHONMONKEY_HOT_PATH(JSONStringify, fast);
+      return true;
+    }
+    PYTHONMONKEY_HOT_PATH(JSONStringify, fallback);
+  }
+  JS::RootedValue original(cx, JS::ObjectValue(**originalStringify));
+  return JS::Call(cx, args.thisv(), original, args, args.rval());
+}
+
+bool JSONStringify::init(JSContext *cx, JS::HandleObject global) {
+  toJSONKey = PyUnicode_InternFromString("toJSON");
+  if (!toJSONKey) {
+    return false;
+  }
+  JS::RootedValue jsonValue(cx);
+  if (!JS_GetProperty(cx, global, "JSON", &jsonValue) || !jsonValue.isObject()) {
+    return false;
+  }
+  JS::RootedObject json(cx, &jsonValue.toObject());
+  JS::RootedValue original(cx);
+  if (!JS_GetProperty(cx, json, "stringify", &original) || !original.isObject()) {
+    return false;
+  }
+  originalStringify = new JS::PersistentRootedObject(cx, &original.toObject());
+  // writable, configurable and not enumerable like the builtin
+  return JS_DefineFunction(cx, json, "stringify", stringify, 3, 0);
+}
+
+void JSONStringify::finalize() {
+  delete originalStringify;
+  originalStringify = nullptr;
+  Py_CLEAR(toJSONKey);
+}
@@ -51,41 +51,11 @@ int JSObjectItemsProxyMethodDefinitions::JSObjectItemsProxy_clear(JSObjectItemsP
 }
 
 PyObject *JSObjectItemsProxyMethodDefinitions::JSObjectItemsProxy_iter(JSObjectItemsProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = false;
-  iterator->it.it_index = 0;
-  iterator->it.kind = KIND_ITEMS;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_ITEMS, false);
 }
 
 PyObject *JSObjectItemsProxyMethodDefinitions::JSObjectItemsProxy_iter_reverse(JSObjectItemsProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = true;
-  iterator->it.it_index = JSObjectItemsProxyMethodDefinitions::JSObjectItemsProxy_length(self) - 1;
-  iterator->it.kind = KIND_ITEMS;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_ITEMS, true);
 }
 
 PyObject *JSObjectItemsProxyMethodDefinitions::JSObjectItemsProxy_repr(JSObjectItemsProxy *self) {
@@ -11,6 +11,7 @@
 
 #include "include/JSObjectIterProxy.hh"
 
+#include "include/ContextOwner.hh"
 #include "include/JSObjectProxy.hh"
 
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
@@ -18,6 +19,9 @@
 #include "include/pyTypeFactory.hh"
 
 #include "include/PyDictProxyHandler.hh"
+#include "include/RootPool.hh"
+
+#include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
 
@@ -28,7 +32,10 @@
 
 void JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_dealloc(JSObjectIterProxy *self)
 {
-  delete self->it.props;
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_dealloc)) {
+    return;
+  }
+  RootPool::deleteRoot(self->it.props);
   PyObject_GC_UnTrack(self);
   Py_XDECREF(self->it.di_dict);
   PyObject_GC_Del(self);
@@ -49,86 +56,75 @@ PyObject *JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_iter(JSObjectIte
   return (PyObject *)&self->it;
 }
 
+PyObject *JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(PyDictObject *dict, int kind, bool reversed) {
+  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
+  if (iterator == NULL) {
+    return NULL;
+  }
+  iterator->it.kind = kind;
+  iterator->it.reversed = reversed;
+  Py_INCREF(dict);
+  iterator->it.di_dict = dict;
+  iterator->it.props = RootPool::newIdVectorRoot(GLOBAL_CX);
+  // Get **enumerable** own properties
+  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)dict)->jsObject), JSITER_OWNONLY, iterator->it.props)) {
+    PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectIterProxyType.tp_name);
+    Py_DECREF(iterator);
+    return NULL;
+  }
+  iterator->it.it_index = reversed ? iterator->it.props->length() - 1 : 0;
+  PyObject_GC_Track(iterator);
+  return (PyObject *)iterator;
+}
+
 PyObject *JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_nextkey(JSObjectIterProxy *self) {
   PyDictObject *dict = self->it.di_dict;
   if (dict == NULL) {
     return NULL;
   }
 
-  if (self->it.reversed) {
-    if (self->it.it_index >= 0) {
-      JS::HandleId id = (*(self->it.props))[(self->it.it_index)--];
-      PyObject *key = idToKey(GLOBAL_CX, id);
-      PyObject *value;
-
-      if (self->it.kind != KIND_KEYS) {
-        JS::RootedValue jsVal(GLOBAL_CX);
-        JS_GetPropertyById(GLOBAL_CX, *(((JSObjectProxy *)(self->it.di_dict))->jsObject), id, &jsVal);
-        value = pyTypeFactory(GLOBAL_CX, jsVal);
-      }
-
-      PyObject *ret;
-      if (self->it.kind == KIND_ITEMS) {
-        ret = PyTuple_Pack(2, key, value);
-      }
-      else if (self->it.kind == KIND_VALUES) {
-        ret = value;
-      }
-      else {
-        ret = key;
-      }
-
-      Py_INCREF(ret);
-      if (self->it.kind != KIND_KEYS) {
-        Py_DECREF(value);
-      }
-
-      return ret;
-    }
-  } else {
-    if (self->it.it_index < JSObjectProxyMethodDefinitions::JSObjectProxy_length((JSObjectProxy *)dict)) {
-      JS::HandleId id = (*(self->it.props))[(self->it.it_index)++];
-      PyObject *key = idToKey(GLOBAL_CX, id);
-      PyObject *value;
-
-      if (self->it.kind != KIND_KEYS) {
-        JS::RootedValue jsVal(GLOBAL_CX);
-        JS_GetPropertyById(GLOBAL_CX, *(((JSObjectProxy *)(self->it.di_dict))->jsObject), id, &jsVal);
-        value = pyTypeFactory(GLOBAL_CX, jsVal);
-      }
-
-      PyObject *ret;
-      if (self->it.kind == KIND_ITEMS) {
-        ret = PyTuple_Pack(2, key, value);
-      }
-      else if (self->it.kind == KIND_VALUES) {
-        ret = value;
-      }
-      else {
-        ret = key;
-      }
-
-      Py_INCREF(ret);
-      if (self->it.kind != KIND_KEYS) {
-        Py_DECREF(value);
-      }
-
-      return ret;
-    }
+  // the keys were snapshotted when the iterator was created, so the object isn't re-enumerated on each step
+  bool exhausted = self->it.reversed ? self->it.it_index < 0 : (size_t)self->it.it_index >= self->it.props->length();
+  if (exhausted) {
+    self->it.di_dict = NULL;
+    Py_DECREF(dict);
+    return NULL;
   }
 
-  self->it.di_dict = NULL;
-  Py_DECREF(dict);
-  return NULL;
+  JS::HandleId id = (*(self->it.props))[self->it.reversed ? (self->it.it_index)-- : (self->it.it_index)++];
+
+  if (self->it.kind == KIND_KEYS) {
+    return idToKey(GLOBAL_CX, id);
+  }
+
+  JS::RootedValue jsVal(GLOBAL_CX);
+  if (!JS_GetPropertyById(GLOBAL_CX, *(((JSObjectProxy *)dict)->jsObject), id, &jsVal)) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  PyObject *value = pyTypeFactory(GLOBAL_CX, jsVal);
+  if (self->it.kind == KIND_VALUES || value == NULL) {
+    return value;
+  }
+
+  PyObject *key = idToKey(GLOBAL_CX, id);
+  if (key == NULL) {
+    Py_DECREF(value);
+    return NULL;
+  }
+  PyObject *ret = PyTuple_Pack(2, key, value);
+  Py_DECREF(key);
+  Py_DECREF(value);
+  return ret;
 }
 
 PyObject *JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_len(JSObjectIterProxy *self) {
   Py_ssize_t len;
   if (self->it.di_dict) {
-    len = JSObjectProxyMethodDefinitions::JSObjectProxy_length((JSObjectProxy *)self->it.di_dict) - self->it.it_index;
+    len = self->it.reversed ? self->it.it_index + 1 : (Py_ssize_t)self->it.props->length() - self->it.it_index;
     if (len >= 0) {
       return PyLong_FromSsize_t(len);
     }
   }
   return PyLong_FromLong(0);
-}
\ No newline at end of file
+}
@@ -161,41 +161,11 @@ PyObject *JSObjectKeysProxyMethodDefinitions::JSObjectKeysProxy_richcompare(JSOb
 }
 
 PyObject *JSObjectKeysProxyMethodDefinitions::JSObjectKeysProxy_iter(JSObjectKeysProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = false;
-  iterator->it.it_index = 0;
-  iterator->it.kind = KIND_KEYS;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_KEYS, false);
 }
 
 PyObject *JSObjectKeysProxyMethodDefinitions::JSObjectKeysProxy_iter_reverse(JSObjectKeysProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = true;
-  iterator->it.it_index = JSObjectKeysProxyMethodDefinitions::JSObjectKeysProxy_length(self) - 1;
-  iterator->it.kind = KIND_KEYS;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_KEYS, true);
 }
 
 PyObject *JSObjectKeysProxyMethodDefinitions::JSObjectKeysProxy_repr(JSObjectKeysProxy *self) {
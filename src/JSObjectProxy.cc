@@ -10,6 +10,12 @@
 
 #include "include/JSObjectProxy.hh"
 
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/DeepEqual.hh"
+#include "include/FreeList.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
 #include "include/JSObjectIterProxy.hh"
 
 #include "include/JSObjectKeysProxy.hh"
@@ -22,6 +28,11 @@
 #include "include/PyBaseProxyHandler.hh"
 
 #include "include/JSFunctionProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/RootPool.hh"
+#include "include/HotPathStats.hh"
+#include "include/AtomCache.hh"
+#include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
 #include <jsfriendapi.h>
@@ -31,16 +42,26 @@
 
 #include <object.h>
 
+#include <unordered_map>
+#include <vector>
+
 JSContext *GLOBAL_CX; /**< pointer to PythonMonkey's JSContext */
 
 bool keyToId(PyObject *key, JS::MutableHandleId idp) {
   if (PyUnicode_Check(key)) { // key is str type
+    if (AtomCache::getId(key, idp)) { // interned attribute name already atomized
+      return true;
+    }
     JS::RootedString idString(GLOBAL_CX);
     Py_ssize_t length;
     const char *keyStr = PyUnicode_AsUTF8AndSize(key, &length);
     JS::UTF8Chars utf8Chars(keyStr, length);
     idString.set(JS_NewStringCopyUTF8N(GLOBAL_CX, utf8Chars));
-    return JS_StringToId(GLOBAL_CX, idString, idp);
+    if (!JS_StringToId(GLOBAL_CX, idString, idp)) {
+      return false;
+    }
+    AtomCache::putId(key, idp);
+    return true;
   } else if (PyLong_Check(key)) { // key is int type
     uint32_t keyAsInt = PyLong_AsUnsignedLong(key); // TODO raise OverflowError if the value of pylong is out of range for a unsigned long
     return JS_IndexToId(GLOBAL_CX, keyAsInt, idp);
@@ -49,28 +70,86 @@ bool keyToId(PyObject *key, JS::MutableHandleId idp) {
   }
 }
 
+bool isMethodName(PyTypeObject *type, PyObject *key) {
+  static std::unordered_map<PyTypeObject *, PyObject *> methodNameSets;
+
+  PyObject *&methodNames = methodNameSets[type];
+  if (!methodNames) {
+    methodNames = PySet_New(NULL);
+    for (PyMethodDef *method = type->tp_methods; method && method->ml_name; method++) {
+      PyObject *methodName = PyUnicode_InternFromString(method->ml_name);
+      PySet_Add(methodNames, methodName);
+      Py_DECREF(methodName);
+    }
+  }
+
+  return PySet_Contains(methodNames, key) == 1;
+}
+
+static FreeList freeProxies;
+
+/**
+ * @brief Whether the dict storage of a proxy is still the one of a new empty dict, so that its memory can be reused as is.
+ * It is unless something wrote to it with the PyDict APIs, bypassing the proxy
+ */
+static bool hasEmptyDictStorage(JSObjectProxy *self) {
+  static PyDictKeysObject *emptyKeys = nullptr; // shared by all the new empty dicts
+  if (!emptyKeys) {
+    PyObject *empty = PyDict_New();
+    if (!empty) {
+      PyErr_Clear();
+      return false;
+    }
+    emptyKeys = ((PyDictObject *)empty)->ma_keys;
+    Py_DECREF(empty);
+  }
+  return self->dict.ma_used == 0 && self->dict.ma_keys == emptyKeys && self->dict.ma_values == NULL;
+}
+
+JSObjectProxy *JSObjectProxyMethodDefinitions::allocate() {
+  PyObject *proxy = freeProxies.pop(&JSObjectProxyType);
+  if (proxy) {
+    PyObject_GC_Track(proxy);
+    return (JSObjectProxy *)proxy;
+  }
+  return (JSObjectProxy *)PyObject_CallObject((PyObject *)&JSObjectProxyType, NULL);
+}
+
 void JSObjectProxyMethodDefinitions::JSObjectProxy_dealloc(JSObjectProxy *self)
 {
-  self->jsObject->set(nullptr);
-  delete self->jsObject;
+  Retention::unpinJS((PyObject *)self); // before the deferral, so that the report never sees a proxy being deallocated
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSObjectProxyMethodDefinitions::JSObjectProxy_dealloc)) {
+    return;
+  }
+  CrossHeap::unregisterProxy((PyObject *)self);
+  MemoryStats::jsObjectProxies--;
+  ProxyCache::removePyProxy(*(self->jsObject), (PyObject *)self);
+  RootPool::deleteRoot(self->jsObject);
+  self->jsObject = nullptr;
   PyObject_GC_UnTrack(self);
-  PyObject_GC_Del(self);
+  // the subtypes (JSIteratorProxy, ...) are bigger
+  if (Py_TYPE(self) != &JSObjectProxyType || !hasEmptyDictStorage(self) || !freeProxies.push((PyObject *)self)) {
+    PyObject_GC_Del(self);
+  }
 }
 
 int JSObjectProxyMethodDefinitions::JSObjectProxy_traverse(JSObjectProxy *self, visitproc visit, void *arg)
 {
-  // Nothing to be done
-  return 0;
+  return CrossHeap::traverse((PyObject *)self, visit, arg);
 }
 
 int JSObjectProxyMethodDefinitions::JSObjectProxy_clear(JSObjectProxy *self)
 {
-  // Nothing to be done
+  // The cycle is broken by clearing the other Python objects in it, the JS object stays rooted until the proxy is deallocated
   return 0;
 }
 
 Py_ssize_t JSObjectProxyMethodDefinitions::JSObjectProxy_length(JSObjectProxy *self)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, length);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
   JS::RootedIdVector props(GLOBAL_CX);
   if (!js::GetPropertyKeys(GLOBAL_CX, *(self->jsObject), JSITER_OWNONLY, &props))
   {
@@ -82,68 +161,72 @@ Py_ssize_t JSObjectProxyMethodDefinitions::JSObjectProxy_length(JSObjectProxy *s
 
 static inline PyObject *getKey(JSObjectProxy *self, PyObject *key, JS::HandleId id, bool checkPropertyShadowsMethod) {
   // look through the methods for dispatch
-  for (size_t index = 0;; index++) {
-    const char *methodName = JSObjectProxyType.tp_methods[index].ml_name;
-    if (methodName == NULL || !PyUnicode_Check(key)) {
+  if (PyUnicode_Check(key) && isMethodName(&JSObjectProxyType, key)) {
+    if (checkPropertyShadowsMethod) {
+      // just make sure no property is shadowing a method by name
       JS::RootedValue value(GLOBAL_CX);
       JS_GetPropertyById(GLOBAL_CX, *(self->jsObject), id, &value);
-      // if value is a JSFunction, bind `this` to self
-      /* (Caleb Aikens) its potentially problematic to bind it like this since if the function
-       * ever gets assigned to another object like so:
-       *
-       * jsObjA.func = jsObjB.func
-       * jsObjA.func() # `this` will be jsObjB not jsObjA
-       *
-       * It will be bound to the wrong object, however I can't find a better way to do this,
-       * and even pyodide works this way weirdly enough:
-       * https://github.com/pyodide/pyodide/blob/ee863a7f7907dfb6ee4948bde6908453c9d7ac43/src/core/jsproxy.c#L388
-       *
-       * if the user wants to get an unbound JS function to bind later, they will have to get it without accessing it through
-       * a JSObjectProxy (such as via pythonmonkey.eval or as the result of some other function)
-       */
-      if (value.isObject()) {
-        JS::RootedObject valueObject(GLOBAL_CX);
-        JS_ValueToObject(GLOBAL_CX, value, &valueObject);
-        js::ESClass cls;
-        JS::GetBuiltinClass(GLOBAL_CX, valueObject, &cls);
-        if (cls == js::ESClass::Function) {
-          JS::Rooted<JS::ValueArray<1>> args(GLOBAL_CX);
-          args[0].setObject(*((*(self->jsObject)).get()));
-          JS::RootedValue boundFunction(GLOBAL_CX);
-          if (!JS_CallFunctionName(GLOBAL_CX, valueObject, "bind", args, &boundFunction)) {
-            PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
-            return NULL;
-          }
-          value.set(boundFunction);
-        }
-      }
-      else if (value.isUndefined() && PyUnicode_Check(key)) {
-        if (strcmp("__class__", PyUnicode_AsUTF8(key)) == 0) {
-          return PyObject_GenericGetAttr((PyObject *)self, key);
-        }
+      if (!value.isUndefined()) {
+        return pyTypeFactory(GLOBAL_CX, value);
       }
-
-      return pyTypeFactory(GLOBAL_CX, value);
     }
-    else {
-      if (strcmp(methodName, PyUnicode_AsUTF8(key)) == 0) {
-        if (checkPropertyShadowsMethod) {
-          // just make sure no property is shadowing a method by name
-          JS::RootedValue value(GLOBAL_CX);
-          JS_GetPropertyById(GLOBAL_CX, *(self->jsObject), id, &value);
-          if (!value.isUndefined()) {
-            return pyTypeFactory(GLOBAL_CX, value);
-          }
-        }
 
-        return PyObject_GenericGetAttr((PyObject *)self, key);
+    return PyObject_GenericGetAttr((PyObject *)self, key);
+  }
+
+  JS::RootedValue value(GLOBAL_CX);
+  JS_GetPropertyById(GLOBAL_CX, *(self->jsObject), id, &value);
+  // if value is a JSFunction, bind `this` to self
+  /* (Caleb Aikens) its potentially problematic to bind it like this since if the function
+   * ever gets assigned to another object like so:
+   *
+   * jsObjA.func = jsObjB.func
+   * jsObjA.func() # `this` will be jsObjB not jsObjA
+   *
+   * It will be bound to the wrong object, however I can't find a better way to do this,
+   * and even pyodide works this way weirdly enough:
+   * https://github.com/pyodide/pyodide/blob/ee863a7f7907dfb6ee4948bde6908453c9d7ac43/src/core/jsproxy.c#L388
+   *
+   * if the user wants to get an unbound JS function to bind later, they will have to get it without accessing it through
+   * a JSObjectProxy (such as via pythonmonkey.eval or as the result of some other function)
+   */
+  if (value.isObject()) {
+    JS::RootedObject valueObject(GLOBAL_CX);
+    JS_ValueToObject(GLOBAL_CX, value, &valueObject);
+    js::ESClass cls;
+    JS::GetBuiltinClass(GLOBAL_CX, valueObject, &cls);
+    if (cls == js::ESClass::Function) {
+      PyObject *function = pyTypeFactory(GLOBAL_CX, value);
+      // rather than allocating a JS bound function on every access, the JSFunctionProxy remembers `this`,
+      // calls are made with it directly and `bind` is only called if the function is passed back to JS
+      if (function && PyObject_TypeCheck(function, &JSFunctionProxyType)) {
+        JSFunctionProxy *functionProxy = (JSFunctionProxy *)function;
+        if (!functionProxy->jsThis) {
+          functionProxy->jsThis = RootPool::newRoot(GLOBAL_CX, *(self->jsObject));
+        } else if (functionProxy->jsThis->get() != *(self->jsObject)) { // the cached proxy was read from another object
+          functionProxy->jsThis->set(*(self->jsObject));
+          RootPool::deleteRoot(functionProxy->jsBound);
+          functionProxy->jsBound = nullptr;
+        }
       }
+      return function;
     }
   }
+  else if (value.isUndefined() && PyUnicode_Check(key)) {
+    if (strcmp("__class__", PyUnicode_AsUTF8(key)) == 0) {
+      return PyObject_GenericGetAttr((PyObject *)self, key);
+    }
+  }
+
+  return pyTypeFactory(GLOBAL_CX, value);
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get(JSObjectProxy *self, PyObject *key)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, get);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) {
     PyErr_SetString(PyExc_AttributeError, "JSObjectProxy property name must be of type str or int");
@@ -155,6 +238,10 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get(JSObjectProxy *self,
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get_subscript(JSObjectProxy *self, PyObject *key)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, getSubscript);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) {
     PyErr_SetString(PyExc_AttributeError, "JSObjectProxy property name must be of type str or int");
@@ -166,6 +253,10 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get_subscript(JSObjectPr
 
 int JSObjectProxyMethodDefinitions::JSObjectProxy_contains(JSObjectProxy *self, PyObject *key)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, contains);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) {
     PyErr_SetString(PyExc_AttributeError, "JSObjectProxy property name must be of type str or int");
@@ -188,6 +279,10 @@ static inline void assignKeyValue(JSObjectProxy *self, PyObject *key, JS::Handle
 
 int JSObjectProxyMethodDefinitions::JSObjectProxy_assign(JSObjectProxy *self, PyObject *key, PyObject *value)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, assign);
+  if (!ContextOwner::check()) {
+    return -1;
+  }
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) { // invalid key
     PyErr_SetString(PyExc_AttributeError, "JSObjectProxy property name must be of type str or int");
@@ -201,111 +296,35 @@ int JSObjectProxyMethodDefinitions::JSObjectProxy_assign(JSObjectProxy *self, Py
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_richcompare(JSObjectProxy *self, PyObject *other, int op)
 {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, richcompare);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (op != Py_EQ && op != Py_NE) {
     Py_RETURN_NOTIMPLEMENTED;
   }
 
-  std::unordered_map<PyObject *, PyObject *> visited;
-
-  bool isEqual = JSObjectProxy_richcompare_helper(self, other, visited);
-  switch (op)
-  {
-  case Py_EQ:
-    return PyBool_FromLong(isEqual);
-  case Py_NE:
-    return PyBool_FromLong(!isEqual);
-  default:
+  JS::RootedValue selfValue(GLOBAL_CX, JS::ObjectValue(**(self->jsObject)));
+  int isEqual = DeepEqual::equals(GLOBAL_CX, selfValue, other);
+  if (isEqual < 0) {
     return NULL;
   }
-}
-
-bool JSObjectProxyMethodDefinitions::JSObjectProxy_richcompare_helper(JSObjectProxy *self, PyObject *other, std::unordered_map<PyObject *, PyObject *> &visited)
-{
-  if (!(Py_TYPE(other)->tp_iter) && !PySequence_Check(other) & !PyMapping_Check(other)) { // if other is not a container
-    return false;
-  }
-
-  if ((visited.find((PyObject *)self) != visited.end() && visited[(PyObject *)self] == other) ||
-      (visited.find((PyObject *)other) != visited.end() && visited[other] == (PyObject *)self)
-  ) // if we've already compared these before, skip
-  {
-    return true;
-  }
-
-  visited.insert({{(PyObject *)self, other}});
-
-  if (Py_TYPE((PyObject *)self) == Py_TYPE(other)) {
-    JS::RootedValue selfVal(GLOBAL_CX, JS::ObjectValue(**(self->jsObject)));
-    JS::RootedValue otherVal(GLOBAL_CX, JS::ObjectValue(**(*(JSObjectProxy *)other).jsObject));
-    if (selfVal.asRawBits() == otherVal.asRawBits()) {
-      return true;
-    }
-    bool *isEqual;
-  }
-
-  JS::RootedIdVector props(GLOBAL_CX);
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(self->jsObject), JSITER_OWNONLY, &props))
-  {
-    PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
-    return false;
-  }
-
-  // iterate recursively through members of self and check for equality
-  size_t length = props.length();
-  for (size_t i = 0; i < length; i++)
-  {
-    JS::HandleId id = props[i];
-    JS::RootedValue key(GLOBAL_CX);
-    key.setString(id.toString());
-
-    PyObject *pyKey = pyTypeFactory(GLOBAL_CX, key);
-    PyObject *pyVal1 = PyObject_GetItem((PyObject *)self, pyKey);
-    PyObject *pyVal2 = PyObject_GetItem((PyObject *)other, pyKey);
-    Py_DECREF(pyKey);
-    if (!pyVal2) { // if other.key is NULL then not equal
-      return false;
-    }
-    if (pyVal1 && Py_TYPE(pyVal1) == &JSObjectProxyType) { // if either subvalue is a JSObjectProxy, we need to pass around our visited map
-      if (!JSObjectProxy_richcompare_helper((JSObjectProxy *)pyVal1, pyVal2, visited))
-      {
-        return false;
-      }
-    }
-    else if (pyVal2 && Py_TYPE(pyVal2) == &JSObjectProxyType) {
-      if (!JSObjectProxy_richcompare_helper((JSObjectProxy *)pyVal2, pyVal1, visited))
-      {
-        return false;
-      }
-    }
-    else if (PyObject_RichCompare(pyVal1, pyVal2, Py_EQ) == Py_False) {
-      return false;
-    }
-  }
-
-  return true;
+  return PyBool_FromLong(op == Py_EQ ? isEqual : !isEqual);
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_iter(JSObjectProxy *self) {
-  // key iteration
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.it_index = 0;
-  iterator->it.reversed = false;
-  iterator->it.kind = KIND_KEYS;
-  Py_INCREF(self);
-  iterator->it.di_dict = (PyDictObject *)self;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(self->jsObject), JSITER_OWNONLY, iterator->it.props)) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, iter);
+  if (!ContextOwner::check()) {
     return NULL;
   }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  // key iteration
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new((PyDictObject *)self, KIND_KEYS, false);
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_iter_next(JSObjectProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *key = PyUnicode_FromString("next");
   JS::RootedId id(GLOBAL_CX);
   if (!keyToId(key, &id)) {
@@ -320,7 +339,7 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_iter_next(JSObjectProxy
     return NULL;
   }
 
-  PyObject *retVal = JSFunctionProxyMethodDefinitions::JSFunctionProxy_call(nextFunction, PyTuple_New(0), NULL);
+  PyObject *retVal = PyObject_CallObject(nextFunction, NULL);
   Py_DECREF(nextFunction);
   if (retVal == NULL) {
     return NULL;
@@ -343,6 +362,10 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_iter_next(JSObjectProxy
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_repr(JSObjectProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, repr);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   // Detect cyclic objects
   PyObject *objPtr = PyLong_FromVoidPtr(self->jsObject->get());
   // For `Py_ReprEnter`, we must get a same PyObject when visiting the same JSObject.
@@ -474,12 +497,113 @@ error:
   return NULL;
 }
 
+/**
+ * @brief Resolve the property ids of many keys, before any property is touched
+ *
+ * @return bool - false with an AttributeError set if a key is not a str or an int
+ */
+static bool resolveIds(PyObject *const *keys, size_t length, JS::MutableHandleIdVector ids) {
+  if (!ids.reserve(length)) {
+    PyErr_NoMemory();
+    return false;
+  }
+  JS::RootedId id(GLOBAL_CX);
+  for (size_t index = 0; index < length; index++) {
+    if (!keyToId(keys[index], &id) || PyErr_Occurred()) { // e.g. a negative int overflowing the index
+      if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_AttributeError, "JSObjectProxy property name must be of type str or int");
+      }
+      return false;
+    }
+    ids.infallibleAppend(id);
+  }
+  return true;
+}
+
+/**
+ * @brief Set many properties in one native loop, then release the references to the keys and values
+ *
+ * @param self - The JSObjectProxy
+ * @param keys - new references to the keys
+ * @param values - new references to the values, in the order of the keys
+ * @return int - 0 on success, -1 with an exception set, no property is set if a key is invalid
+ */
+static int assignAll(JSObjectProxy *self, std::vector<PyObject *> &keys, std::vector<PyObject *> &values) {
+  int result = 0;
+  JS::RootedIdVector ids(GLOBAL_CX);
+  if (!resolveIds(keys.data(), keys.size(), &ids)) {
+    result = -1;
+  } else {
+    JS::RootedValue jValue(GLOBAL_CX);
+    for (size_t index = 0; index < values.size(); index++) {
+      jValue.set(jsTypeFactory(GLOBAL_CX, values[index]));
+      if (!JS_SetPropertyById(GLOBAL_CX, *(self->jsObject), ids[index], jValue)) { // e.g. a setter threw
+        setSpiderMonkeyException(GLOBAL_CX);
+        result = -1;
+        break;
+      }
+    }
+  }
+
+  for (PyObject *key : keys) {
+    Py_DECREF(key);
+  }
+  for (PyObject *value : values) {
+    Py_DECREF(value);
+  }
+  keys.clear();
+  values.clear();
+  return result;
+}
+
+/**
+ * @brief Set the items of a dict, walking it in place, or assign the properties of a JSObjectProxy with Object.assign
+ */
+static int assignDict(JSObjectProxy *self, PyObject *dict) {
+  if (PyObject_TypeCheck(dict, &JSObjectProxyType)) { // its items are the properties of its JS object
+    JS::Rooted<JS::ValueArray<2>> args(GLOBAL_CX);
+    args[0].setObjectOrNull(*(self->jsObject));
+    args[1].setObjectOrNull(*(((JSObjectProxy *)dict)->jsObject));
+
+    JS::RootedObject global(GLOBAL_CX, JS::GetNonCCWObjectGlobal(*(self->jsObject)));
+
+    // call Object.assign
+    JS::RootedValue Object(GLOBAL_CX);
+    if (!JS_GetProperty(GLOBAL_CX, global, "Object", &Object)) {
+      PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
+      return -1;
+    }
+
+    JS::RootedObject rootedObject(GLOBAL_CX, Object.toObjectOrNull());
+    JS::RootedValue ret(GLOBAL_CX);
+    if (!JS_CallFunctionName(GLOBAL_CX, rootedObject, "assign", args, &ret)) {
+      PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
+      return -1;
+    }
+    return 0;
+  }
+
+  std::vector<PyObject *> keys, values;
+  keys.reserve(PyDict_Size(dict));
+  values.reserve(PyDict_Size(dict));
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  while (PyDict_Next(dict, &pos, &key, &value)) { // the references are taken as converting the values may run Python code
+    Py_INCREF(key);
+    Py_INCREF(value);
+    keys.push_back(key);
+    values.push_back(value);
+  }
+  return assignAll(self, keys, values);
+}
+
 // private
 static int mergeFromSeq2(JSObjectProxy *self, PyObject *seq2) {
   PyObject *it;         /* iter(seq2) */
   Py_ssize_t i;         /* index into seq2 of current element */
   PyObject *item;       /* seq2[i] */
   PyObject *fast;       /* item as a 2-tuple or 2-list */
+  std::vector<PyObject *> keys, values; /* the pairs, set together once they are all read */
 
   it = PyObject_GetIter(seq2);
   if (it == NULL)
@@ -521,31 +645,32 @@ static int mergeFromSeq2(JSObjectProxy *self, PyObject *seq2) {
     value = PySequence_Fast_GET_ITEM(fast, 1);
     Py_INCREF(key);
     Py_INCREF(value);
+    keys.push_back(key);
+    values.push_back(value);
 
-    if (JSObjectProxyMethodDefinitions::JSObjectProxy_assign(self, key, value) < 0) {
-      Py_DECREF(key);
-      Py_DECREF(value);
-      goto Fail;
-    }
-
-    Py_DECREF(key);
-    Py_DECREF(value);
     Py_DECREF(fast);
     Py_DECREF(item);
   }
 
-  i = 0;
-  goto Return;
+  Py_DECREF(it);
+  return assignAll(self, keys, values);
 Fail:
   Py_XDECREF(item);
   Py_XDECREF(fast);
-  i = -1;
-Return:
   Py_DECREF(it);
-  return Py_SAFE_DOWNCAST(i, Py_ssize_t, int);
+  for (PyObject *key : keys) {
+    Py_DECREF(key);
+  }
+  for (PyObject *value : values) {
+    Py_DECREF(value);
+  }
+  return -1;
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_or(JSObjectProxy *self, PyObject *other) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   #if PY_VERSION_HEX < 0x03090000
   // | is not supported on dicts in python3.8 or less, so only allow if both
   // operands are JSObjectProxy
@@ -588,25 +713,11 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_or(JSObjectProxy *self,
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_ior(JSObjectProxy *self, PyObject *other) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   if (PyDict_Check(other)) {
-    JS::Rooted<JS::ValueArray<2>> args(GLOBAL_CX);
-    args[0].setObjectOrNull(*(self->jsObject));
-    JS::RootedValue jValueOther(GLOBAL_CX, jsTypeFactory(GLOBAL_CX, other));
-    args[1].setObject(jValueOther.toObject());
-
-    JS::RootedObject global(GLOBAL_CX, JS::GetNonCCWObjectGlobal(*(self->jsObject)));
-
-    // call Object.assign
-    JS::RootedValue Object(GLOBAL_CX);
-    if (!JS_GetProperty(GLOBAL_CX, global, "Object", &Object)) {
-      PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
-      return NULL;
-    }
-
-    JS::RootedObject rootedObject(GLOBAL_CX, Object.toObjectOrNull());
-    JS::RootedValue ret(GLOBAL_CX);
-    if (!JS_CallFunctionName(GLOBAL_CX, rootedObject, "assign", args, &ret)) {
-      PyErr_Format(PyExc_SystemError, "%s JSAPI call failed", JSObjectProxyType.tp_name);
+    if (assignDict(self, other) < 0) {
       return NULL;
     }
   }
@@ -621,6 +732,10 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_ior(JSObjectProxy *self,
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get_method(JSObjectProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, getMethod);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *key;
   PyObject *default_value = Py_None;
 
@@ -646,6 +761,10 @@ skip_optional:
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_setdefault_method(JSObjectProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, setdefault);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *key;
   PyObject *default_value = Py_None;
 
@@ -678,6 +797,10 @@ skip_optional:
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_pop_method(JSObjectProxy *self, PyObject *const *args, Py_ssize_t nargs) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, pop);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *key;
   PyObject *default_value = NULL;
 
@@ -716,6 +839,9 @@ skip_optional:
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_clear_method(JSObjectProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::RootedIdVector props(GLOBAL_CX);
   if (!js::GetPropertyKeys(GLOBAL_CX, *(self->jsObject), JSITER_OWNONLY, &props))
   {
@@ -733,6 +859,9 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_clear_method(JSObjectPro
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_copy_method(JSObjectProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::Rooted<JS::ValueArray<2>> args(GLOBAL_CX);
   args[0].setObjectOrNull(JS_NewPlainObject(GLOBAL_CX));
   args[1].setObjectOrNull(*(self->jsObject));
@@ -756,6 +885,10 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_copy_method(JSObjectProx
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_update_method(JSObjectProxy *self, PyObject *args, PyObject *kwds) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, update);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   PyObject *arg = NULL;
   int result = 0;
 
@@ -764,32 +897,117 @@ PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_update_method(JSObjectPr
   }
   else if (arg != NULL) {
     if (PyDict_CheckExact(arg) || PyObject_TypeCheck(arg, &JSObjectProxyType)) {
-      JSObjectProxyMethodDefinitions::JSObjectProxy_ior((JSObjectProxy *)self, arg);
-      result = 0;
+      result = assignDict(self, arg);
     } else { // iterable
       result = mergeFromSeq2((JSObjectProxy *)self, arg);
-      if (result < 0) {
-        return NULL;
-      }
+    }
+    if (result < 0) {
+      return NULL;
     }
   }
 
   if (result == 0 && kwds != NULL) {
-    if (PyArg_ValidateKeywordArguments(kwds)) {
-      JSObjectProxyMethodDefinitions::JSObjectProxy_ior((JSObjectProxy *)self, kwds);
+    if (!PyArg_ValidateKeywordArguments(kwds) || assignDict(self, kwds) < 0) {
+      return NULL;
+    }
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_get_many_method(JSObjectProxy *self, PyObject *keys) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, getMany);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  PyObject *fast = PySequence_Fast(keys, "get_many() argument must be an iterable of keys");
+  if (!fast) {
+    return NULL;
+  }
+  Py_ssize_t length = PySequence_Fast_GET_SIZE(fast);
+  PyObject **items = PySequence_Fast_ITEMS(fast);
+
+  JS::RootedIdVector ids(GLOBAL_CX);
+  if (!resolveIds(items, length, &ids)) {
+    Py_DECREF(fast);
+    return NULL;
+  }
+
+  PyObject *result = PyList_New(length);
+  JS::RootedId id(GLOBAL_CX);
+  for (Py_ssize_t index = 0; result && index < length; index++) {
+    id.set(ids[index]);
+    PyObject *value = getKey(self, items[index], id, true);
+    if (!value) {
+      Py_CLEAR(result);
+      break;
     }
+    PyList_SET_ITEM(result, index, value);
+  }
+  Py_DECREF(fast);
+  return result;
+}
+
+PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_set_many_method(JSObjectProxy *self, PyObject *mapping) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, setMany);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  int result;
+  if (PyDict_Check(mapping)) {
+    result = assignDict(self, mapping);
+  }
+  else if (PyMapping_Check(mapping) && PyObject_HasAttrString(mapping, "keys")) {
+    PyObject *items = PyMapping_Items(mapping);
+    if (!items) {
+      return NULL;
+    }
+    result = mergeFromSeq2(self, items);
+    Py_DECREF(items);
+  }
+  else { // (key, value) pairs
+    result = mergeFromSeq2(self, mapping);
+  }
+  if (result < 0) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_update_fast_method(JSObjectProxy *self, PyObject *dict) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, setMany);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  if (!PyDict_Check(dict)) {
+    PyErr_Format(PyExc_TypeError, "update_fast() argument must be a dict, not %.200s", Py_TYPE(dict)->tp_name);
+    return NULL;
+  }
+  if (assignDict(self, dict) < 0) {
+    return NULL;
   }
   Py_RETURN_NONE;
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_keys_method(JSObjectProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, keys);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   return PyDictView_New((PyObject *)self, &JSObjectKeysProxyType);
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_values_method(JSObjectProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, values);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   return PyDictView_New((PyObject *)self, &JSObjectValuesProxyType);
 }
 
 PyObject *JSObjectProxyMethodDefinitions::JSObjectProxy_items_method(JSObjectProxy *self) {
+  PYTHONMONKEY_HOT_PATH(JSObjectProxy, items);
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   return PyDictView_New((PyObject *)self, &JSObjectItemsProxyType);
 }
\ No newline at end of file
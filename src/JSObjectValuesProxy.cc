@@ -89,41 +89,11 @@ static int all_contained_in(PyObject *self, PyObject *other) {
 }
 
 PyObject *JSObjectValuesProxyMethodDefinitions::JSObjectValuesProxy_iter(JSObjectValuesProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = false;
-  iterator->it.it_index = 0;
-  iterator->it.kind = KIND_VALUES;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_VALUES, false);
 }
 
 PyObject *JSObjectValuesProxyMethodDefinitions::JSObjectValuesProxy_iter_reverse(JSObjectValuesProxy *self) {
-  JSObjectIterProxy *iterator = PyObject_GC_New(JSObjectIterProxy, &JSObjectIterProxyType);
-  if (iterator == NULL) {
-    return NULL;
-  }
-  iterator->it.reversed = true;
-  iterator->it.it_index = JSObjectValuesProxyMethodDefinitions::JSObjectValuesProxy_length(self) - 1;
-  iterator->it.kind = KIND_VALUES;
-  Py_INCREF(self->dv.dv_dict);
-  iterator->it.di_dict = self->dv.dv_dict;
-  iterator->it.props = new JS::PersistentRootedIdVector(GLOBAL_CX);
-  // Get **enumerable** own properties
-  if (!js::GetPropertyKeys(GLOBAL_CX, *(((JSObjectProxy *)(self->dv.dv_dict))->jsObject), JSITER_OWNONLY, iterator->it.props)) {
-    return NULL;
-  }
-  PyObject_GC_Track(iterator);
-  return (PyObject *)iterator;
+  return JSObjectIterProxyMethodDefinitions::JSObjectIterProxy_new(self->dv.dv_dict, KIND_VALUES, true);
 }
 
 PyObject *JSObjectValuesProxyMethodDefinitions::JSObjectValuesProxy_repr(JSObjectValuesProxy *self) {
@@ -0,0 +1,313 @@
+/**
+ * @file JSScriptHandle.cc
+ * @author agent (agent@local)
+ * @brief JSScriptHandle is a custom C-implemented python type. It holds a script compiled once by pythonmonkey.compile, to be run many times.
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSScriptHandle.hh"
+
+#include "include/ContextOwner.hh"
+#include "include/GILSwitch.hh"
+#include "include/JobQueue.hh"
+#include "include/PyBaseProxyHandler.hh"
+#include "include/PyEventLoop.hh"
+#include "include/StencilCache.hh"
+#include "include/jsTypeFactory.hh"
+#include "include/pyTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+
+#include <jsapi.h>
+#include <js/CompilationAndEvaluation.h>
+#include <js/CompileOptions.h>
+#include <js/Promise.h>
+#include <js/SourceText.h>
+#include <js/experimental/CompileScript.h>
+#include <js/experimental/JSStencil.h>
+#include <mozilla/RefPtr.h>
+
+#include <Python.h>
+#include <pythread.h>
+
+/**
+ * @brief Wrap a compiled script into a new JSScriptHandle
+ */
+static PyObject *newScriptHandle(JSContext *cx, PyObject *code, const JS::ReadOnlyCompileOptions &options, JS::HandleScript script) {
+  JS::OwningCompileOptions *ownedOptions = new JS::OwningCompileOptions(cx);
+  if (!ownedOptions->copy(cx, options)) {
+    delete ownedOptions;
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+
+  JSScriptHandle *self = (JSScriptHandle *)JSScriptHandleType.tp_alloc(&JSScriptHandleType, 0);
+  if (!self) {
+    delete ownedOptions;
+    return NULL;
+  }
+  Py_INCREF(code);
+  self->code = code;
+  self->options = ownedOptions;
+  self->script = new JS::PersistentRootedScript(cx, script);
+  self->scriptWithBindings = nullptr;
+  return (PyObject *)self;
+}
+
+PyObject *JSScriptHandleMethodDefinitions::compile(JSContext *cx, PyObject *code, const JS::ReadOnlyCompileOptions &options) {
+  Py_ssize_t codeLength;
+  const char *codeChars = PyUnicode_AsUTF8AndSize(code, &codeLength);
+  if (!codeChars) {
+    return NULL;
+  }
+
+  JS::RootedScript script(cx, StencilCache::compile(cx, options, codeChars, codeLength));
+  if (!script) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  return newScriptHandle(cx, code, options, script);
+}
+
+// the native stack the parser may use on the compiling thread, well below the default stack size of the Python threads
+static const size_t OFF_THREAD_STACK_QUOTA = 1024 * 1024;
+
+/**
+ * @brief A script being compiled by `compileOffThread`. Its members other than the stencil and the FrontendContext are only touched with the GIL held
+ */
+class OffThreadCompile : public JS::Dispatchable {
+public:
+  JSContext *cx;
+  PyObject *code; // keeps `chars` alive
+  PyObject *future;
+  JS::OwningCompileOptions options;
+  const char *chars;
+  size_t length;
+  JS::FrontendContext *fc = nullptr;
+  RefPtr<JS::Stencil> stencil;
+
+  explicit OffThreadCompile(JSContext *cx) : cx(cx), options(cx) {}
+
+  /**
+   * @brief Instantiate the stencil and settle the future, called by the event-loop
+   */
+  void run(JSContext *cx, MaybeShuttingDown maybeShuttingDown) override {
+    if (maybeShuttingDown == JS::Dispatchable::ShuttingDown) { // the Python objects may be gone already
+      JS::DestroyFrontendContext(fc);
+      delete this;
+      return;
+    }
+
+    PyEventLoop::Future pyFuture(future); // takes the reference
+    if (!pyFuture.isCancelled()) {
+      PyObject *result = NULL;
+      if (stencil) {
+        JS::RootedScript script(cx, StencilCache::instantiate(cx, options, chars, length, stencil));
+        if (script) {
+          result = newScriptHandle(cx, code, options, script);
+        }
+      } else if (fc) {
+        JS::ConvertFrontendErrorsToRuntimeErrors(cx, fc, options); // the syntax errors become the pending JS exception
+      } else {
+        JS_ReportOutOfMemory(cx);
+      }
+
+      if (result) {
+        pyFuture.setResult(result);
+        Py_DECREF(result);
+      } else {
+        setSpiderMonkeyException(cx);
+        PyObject *type, *value, *traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        PyErr_NormalizeException(&type, &value, &traceback);
+        if (value) {
+          pyFuture.setException(value);
+        }
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(traceback);
+      }
+    }
+    PyErr_Clear();
+
+    Py_DECREF(code);
+    JS::DestroyFrontendContext(fc);
+    delete this;
+  }
+};
+
+/**
+ * @brief The compiling thread, it only uses the FrontendContext, not the JSContext nor Python
+ */
+static void compileOffThread(void *data) {
+  OffThreadCompile *task = (OffThreadCompile *)data;
+  task->fc = JS::NewFrontendContext();
+  if (task->fc) {
+    JS::SetNativeStackQuota(task->fc, OFF_THREAD_STACK_QUOTA);
+    JS::SourceText<mozilla::Utf8Unit> source;
+    if (source.init(task->fc, task->chars, task->length, JS::SourceOwnership::Borrowed)) {
+      task->stencil = JS::CompileGlobalScriptToStencil(task->fc, task->options, source);
+    }
+  }
+  JobQueue::dispatchToEventLoop(task->cx, task);
+}
+
+PyObject *JSScriptHandleMethodDefinitions::compileAsync(JSContext *cx, PyObject *code, const JS::ReadOnlyCompileOptions &options) {
+  Py_ssize_t codeLength;
+  const char *codeChars = PyUnicode_AsUTF8AndSize(code, &codeLength);
+  if (!codeChars) {
+    return NULL;
+  }
+
+  PyEventLoop loop = PyEventLoop::getRunningLoop();
+  if (!loop.initialized()) {
+    return NULL;
+  }
+  PyEventLoop::Future future = loop.createFuture();
+
+  if (StencilCache::contains(options, codeChars, codeLength)) { // only instantiated, not worth a thread
+    PyObject *script = compile(cx, code, options);
+    if (!script) {
+      return NULL;
+    }
+    future.setResult(script);
+    Py_DECREF(script);
+    return future.getFutureObject();
+  }
+
+  OffThreadCompile *task = new OffThreadCompile(cx);
+  if (!task->options.copy(cx, options)) {
+    delete task;
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  Py_INCREF(code);
+  task->code = code;
+  task->future = future.getFutureObject();
+  task->chars = codeChars;
+  task->length = codeLength;
+  if (PyThread_start_new_thread(compileOffThread, task) == (unsigned long)-1) {
+    Py_DECREF(task->code);
+    Py_DECREF(task->future);
+    delete task;
+    PyErr_SetString(PyExc_RuntimeError, "PythonMonkey could not start the compiling thread");
+    return NULL;
+  }
+  return future.getFutureObject();
+}
+
+void JSScriptHandleMethodDefinitions::JSScriptHandle_dealloc(JSScriptHandle *self) {
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSScriptHandleMethodDefinitions::JSScriptHandle_dealloc)) {
+    return;
+  }
+  delete self->script;
+  delete self->scriptWithBindings;
+  delete self->options;
+  Py_XDECREF(self->code);
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/**
+ * @brief Compile the variant of the script that runs with an environment chain, scripts of the global scope cannot
+ */
+static JSScript *compileWithBindings(JSContext *cx, JSScriptHandle *self) {
+  Py_ssize_t codeLength;
+  const char *codeChars = PyUnicode_AsUTF8AndSize(self->code, &codeLength);
+  JS::SourceText<mozilla::Utf8Unit> source;
+  if (!source.init(cx, codeChars, codeLength, JS::SourceOwnership::Borrowed)) {
+    return nullptr;
+  }
+  JS::CompileOptions options(cx, *self->options);
+  options.setNonSyntacticScope(true);
+  return JS::Compile(cx, options, source);
+}
+
+/**
+ * @brief Make the object holding the bindings of a run, it is the innermost environment of the script
+ */
+static JSObject *makeBindings(JSContext *cx, PyObject *bindings) {
+  JS::RootedObject environment(cx, JS_NewPlainObject(cx));
+  if (!environment) {
+    setSpiderMonkeyException(cx);
+    return nullptr;
+  }
+
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  JS::RootedId id(cx);
+  JS::RootedValue jsValue(cx);
+  while (PyDict_Next(bindings, &pos, &key, &value)) {
+    if (!PyUnicode_Check(key) || !keyToId(key, &id)) {
+      if (!PyErr_Occurred()) {
+        PyErr_SetString(PyExc_TypeError, "the names of the bindings of a script must be str");
+      }
+      return nullptr;
+    }
+    jsValue.set(jsTypeFactory(cx, value));
+    if (PyErr_Occurred()) {
+      return nullptr;
+    }
+    if (!JS_DefinePropertyById(cx, environment, id, jsValue, JSPROP_ENUMERATE)) {
+      setSpiderMonkeyException(cx);
+      return nullptr;
+    }
+  }
+  return environment;
+}
+
+PyObject *JSScriptHandleMethodDefinitions::JSScriptHandle_run(JSScriptHandle *self, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"bindings", NULL};
+  PyObject *bindings = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", (char **)kwlist, &bindings)) {
+    return NULL;
+  }
+  if (bindings != Py_None && !PyDict_Check(bindings)) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.JSScript.run expects a dict of bindings");
+    return NULL;
+  }
+
+  JS::RootedValue rval(GLOBAL_CX);
+  GILSwitch::AutoHandOver handOver;
+  if (!handOver.entered()) {
+    return NULL;
+  }
+
+  if (bindings == Py_None) {
+    if (!JS_ExecuteScript(GLOBAL_CX, *self->script, &rval)) {
+      setSpiderMonkeyException(GLOBAL_CX);
+      return NULL;
+    }
+  } else {
+    if (!self->scriptWithBindings) {
+      JS::RootedScript script(GLOBAL_CX, compileWithBindings(GLOBAL_CX, self));
+      if (!script) {
+        setSpiderMonkeyException(GLOBAL_CX);
+        return NULL;
+      }
+      self->scriptWithBindings = new JS::PersistentRootedScript(GLOBAL_CX, script);
+    }
+
+    JS::RootedObjectVector environmentChain(GLOBAL_CX);
+    JS::RootedObject environment(GLOBAL_CX, makeBindings(GLOBAL_CX, bindings));
+    if (!environment) {
+      return NULL;
+    }
+    if (!environmentChain.append(environment)) {
+      PyErr_NoMemory();
+      return NULL;
+    }
+    if (!JS_ExecuteScript(GLOBAL_CX, environmentChain, *self->scriptWithBindings, &rval)) {
+      setSpiderMonkeyException(GLOBAL_CX);
+      return NULL;
+    }
+  }
+
+  PyObject *returnValue = pyTypeFactory(GLOBAL_CX, rval);
+  if (!returnValue && !PyErr_Occurred()) {
+    Py_RETURN_NONE;
+  }
+  return returnValue;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file JSSetProxy.cc
+ * @author agent (agent@local)
+ * @brief JSSetProxy is a custom C-implemented python type that proxies a JS Set as a Python set-like collection, its membership being
+ * tested by `JS::SetHas` with the JS value of the Python element
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSSetProxy.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/JSIteratorProxy.hh"
+#include "include/MemoryStats.hh"
+#include "include/ProxyCache.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
+#include "include/jsTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <js/MapAndSet.h>
+
+#include <Python.h>
+
+void JSSetProxyMethodDefinitions::JSSetProxy_dealloc(JSSetProxy *self)
+{
+  Retention::unpinJS((PyObject *)self);
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSSetProxyMethodDefinitions::JSSetProxy_dealloc)) {
+    return;
+  }
+  CrossHeap::unregisterProxy((PyObject *)self);
+  MemoryStats::jsObjectProxies--;
+  ProxyCache::removePyProxy(*(self->jsSet), (PyObject *)self);
+  RootPool::deleteRoot(self->jsSet);
+  PyObject_GC_UnTrack(self);
+  PyObject_GC_Del(self);
+}
+
+int JSSetProxyMethodDefinitions::JSSetProxy_traverse(JSSetProxy *self, visitproc visit, void *arg)
+{
+  return CrossHeap::traverse((PyObject *)self, visit, arg);
+}
+
+int JSSetProxyMethodDefinitions::JSSetProxy_clear(JSSetProxy *self)
+{
+  // The cycle is broken by clearing the other Python objects in it, the JS Set stays rooted until the proxy is deallocated
+  return 0;
+}
+
+PyObject *JSSetProxyMethodDefinitions::getPyObject(JSContext *cx, JS::HandleObject set) {
+  PyObject *cached = ProxyCache::getPyProxy(set);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSSetProxyType)) {
+      return cached;
+    }
+    Py_DECREF(cached); // the Set is already proxied as another type, e.g. as a JSObjectProxy
+  }
+
+  JSSetProxy *proxy = PyObject_GC_New(JSSetProxy, &JSSetProxyType);
+  if (proxy == NULL) {
+    return NULL;
+  }
+  proxy->jsSet = RootPool::newRoot(cx, set);
+  ProxyCache::putPyProxy(set, (PyObject *)proxy);
+  CrossHeap::registerProxy((PyObject *)proxy, proxy->jsSet);
+  MemoryStats::jsObjectProxies++;
+  Retention::pinJS(cx, (PyObject *)proxy);
+  PyObject_GC_Track(proxy);
+  return (PyObject *)proxy;
+}
+
+Py_ssize_t JSSetProxyMethodDefinitions::JSSetProxy_length(JSSetProxy *self)
+{
+  return JS::SetSize(GLOBAL_CX, *(self->jsSet));
+}
+
+int JSSetProxyMethodDefinitions::JSSetProxy_contains(JSSetProxy *self, PyObject *element)
+{
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsElement(cx, jsTypeFactory(cx, element));
+  bool found;
+  if (!JS::SetHas(cx, *(self->jsSet), jsElement, &found)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  return found;
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_iter(JSSetProxy *self)
+{
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue iterator(cx);
+  if (!JS::SetValues(cx, *(self->jsSet), &iterator)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  JS::RootedObject iteratorObj(cx, &iterator.toObject());
+  return JSIteratorProxyMethodDefinitions::getIteratorPyObject(cx, iteratorObj, false);
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_repr(JSSetProxy *self)
+{
+  if (JSSetProxy_length(self) == 0) {
+    return PyUnicode_FromString("set()");
+  }
+  int status = Py_ReprEnter((PyObject *)self);
+  if (status != 0) {
+    return status > 0 ? PyUnicode_FromString("{...}") : NULL;
+  }
+
+  PyObject *result = NULL;
+  PyObject *elements = PySequence_List((PyObject *)self); // iterates the proxy
+  if (elements) {
+    PyObject *listRepr = PyObject_Repr(elements);
+    PyObject *items = listRepr ? PyUnicode_Substring(listRepr, 1, PyUnicode_GET_LENGTH(listRepr) - 1) : NULL; // "[1, 2]" to "1, 2"
+    if (items) {
+      result = PyUnicode_FromFormat("{%U}", items);
+      Py_DECREF(items);
+    }
+    Py_XDECREF(listRepr);
+    Py_DECREF(elements);
+  }
+  Py_ReprLeave((PyObject *)self);
+  return result;
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_add_method(JSSetProxy *self, PyObject *element)
+{
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsElement(cx, jsTypeFactory(cx, element));
+  if (!JS::SetAdd(cx, *(self->jsSet), jsElement)) {
+    setSpiderMonkeyException(cx);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+/**
+ * @brief Delete an element of the Set
+ *
+ * @return int - 1 if it was an element, 0 if not, -1 with an exception set
+ */
+static int deleteElement(JSSetProxy *self, PyObject *element) {
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedValue jsElement(cx, jsTypeFactory(cx, element));
+  bool deleted;
+  if (!JS::SetDelete(cx, *(self->jsSet), jsElement, &deleted)) {
+    setSpiderMonkeyException(cx);
+    return -1;
+  }
+  return deleted;
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_discard_method(JSSetProxy *self, PyObject *element)
+{
+  if (deleteElement(self, element) < 0) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_remove_method(JSSetProxy *self, PyObject *element)
+{
+  int deleted = deleteElement(self, element);
+  if (deleted < 0) {
+    return NULL;
+  }
+  if (!deleted) {
+    PyErr_SetObject(PyExc_KeyError, element);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject *JSSetProxyMethodDefinitions::JSSetProxy_clear_method(JSSetProxy *self)
+{
+  if (!JS::SetClear(GLOBAL_CX, *(self->jsSet))) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
@@ -10,20 +10,50 @@
 
 #include "include/JSStringProxy.hh"
 
+#include "include/ContextOwner.hh"
+#include "include/FreeList.hh"
+#include "include/RootPool.hh"
 #include "include/StrType.hh"
 
 std::unordered_set<JSStringProxy *> jsStringProxies;
+std::unordered_set<JSStringProxy *> nurseryJSStringProxies;
 extern JSContext *GLOBAL_CX;
 
+static FreeList freeProxies;
+
+JSStringProxy *JSStringProxyMethodDefinitions::allocate() {
+  PyObject *proxy = freeProxies.pop(&JSStringProxyType);
+  if (proxy) {
+    return (JSStringProxy *)proxy;
+  }
+  return PyObject_New(JSStringProxy, &JSStringProxyType);
+}
 
 void JSStringProxyMethodDefinitions::JSStringProxy_dealloc(JSStringProxy *self)
 {
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSStringProxyMethodDefinitions::JSStringProxy_dealloc)) {
+    return;
+  }
   jsStringProxies.erase(self);
-  delete self->jsString;
+  nurseryJSStringProxies.erase(self);
+  RootPool::deleteRoot(self->jsString);
+  if (!freeProxies.push((PyObject *)self)) {
+    PyObject_Del(self);
+  }
 }
 
 PyObject *JSStringProxyMethodDefinitions::JSStringProxy_copy_method(JSStringProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
   JS::RootedString selfString(GLOBAL_CX, ((JSStringProxy *)self)->jsString->toString());
   JS::RootedValue selfStringValue(GLOBAL_CX, JS::StringValue(selfString));
   return StrType::proxifyString(GLOBAL_CX, selfStringValue);
-}
\ No newline at end of file
+}
+
+PyObject *JSStringProxyMethodDefinitions::JSStringProxy_str(JSStringProxy *self) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return StrType::toWellFormed((PyObject *)self);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file JSWasmMemoryProxy.cc
+ * @author agent (agent@local)
+ * @brief JSWasmMemoryProxy is a custom C-implemented python type that derives from JSObjectProxy. It proxies a `WebAssembly.Memory`,
+ * and exports the current memory of the Wasm instance as a writable Python buffer, across `memory.grow()`
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSWasmMemoryProxy.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/BufferType.hh"
+#include "include/ContextOwner.hh"
+#include "include/CrossHeap.hh"
+#include "include/MemoryStats.hh"
+#include "include/ProxyCache.hh"
+#include "include/RootPool.hh"
+#include "include/Retention.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <js/ArrayBuffer.h>
+#include <js/SharedArrayBuffer.h>
+
+#include <Python.h>
+
+#include <cstring>
+
+void JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_dealloc(JSWasmMemoryProxy *self)
+{
+  Retention::unpinJS((PyObject *)self); // before the deferral, as for a JSObjectProxy
+  if (ContextOwner::deferDealloc((PyObject *)self, (destructor)JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_dealloc)) {
+    return;
+  }
+  JSObjectProxyMethodDefinitions::JSObjectProxy_dealloc(&self->object);
+}
+
+bool JSWasmMemoryProxyMethodDefinitions::isWasmMemory(JSObject *obj) {
+  return strcmp(JS::GetClass(obj)->name, "WebAssembly.Memory") == 0;
+}
+
+PyObject *JSWasmMemoryProxyMethodDefinitions::getPyObject(JSContext *cx, JS::HandleObject obj) {
+  PyObject *cached = ProxyCache::getPyProxy(obj);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSWasmMemoryProxyType)) {
+      return cached;
+    }
+    Py_DECREF(cached); // the object is already proxied as another type
+  }
+
+  JSWasmMemoryProxy *proxy = (JSWasmMemoryProxy *)PyObject_CallObject((PyObject *)&JSWasmMemoryProxyType, NULL);
+  if (proxy != NULL) {
+    proxy->object.jsObject = RootPool::newRoot(cx, obj);
+    proxy->buffer = nullptr;
+    proxy->exports = 0;
+    proxy->pinnedBytes = 0;
+    ProxyCache::putPyProxy(obj, (PyObject *)proxy);
+    CrossHeap::registerProxy((PyObject *)proxy, proxy->object.jsObject);
+    MemoryStats::jsObjectProxies++;
+    Retention::pinJS(cx, (PyObject *)proxy);
+    return (PyObject *)proxy;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Find the memory of the Wasm instance, pinning it if it is not shared. Only looked up by the first export of a non-shared Memory,
+ * the next ones reuse its ArrayBuffer, which can't be replaced while it is pinned
+ *
+ * @return bool - false with a Python exception set if the `buffer` of the Memory could not be got
+ */
+static bool currentMemory(JSWasmMemoryProxy *self, void **data, size_t *byteLength) {
+  JSContext *cx = GLOBAL_CX;
+  bool isSharedMemory;
+  if (self->buffer) {
+    JS::AutoCheckCannotGC autoNoGC(cx);
+    *byteLength = JS::GetArrayBufferByteLength(*(self->buffer));
+    *data = JS::GetArrayBufferData(*(self->buffer), &isSharedMemory, autoNoGC);
+    return true;
+  }
+
+  JS::RootedObject memory(cx, *(self->object.jsObject));
+  JS::RootedValue bufferValue(cx);
+  if (!JS_GetProperty(cx, memory, "buffer", &bufferValue)) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  JS::RootedObject buffer(cx, bufferValue.isObject() ? &bufferValue.toObject() : nullptr);
+  if (buffer && JS::IsSharedArrayBufferObject(buffer)) {
+    uint8_t *bytes;
+    JS::GetSharedArrayBufferLengthAndData(buffer, byteLength, &isSharedMemory, &bytes);
+    *data = bytes; // grown in place, the base pointer of the exports taken before a grow stays valid
+    return true;
+  }
+  if (!buffer || !JS::IsArrayBufferObject(buffer)) {
+    PyErr_SetString(PyExc_BufferError, "the buffer of the WebAssembly.Memory is not an ArrayBuffer");
+    return false;
+  }
+
+  {
+    JS::AutoCheckCannotGC autoNoGC(cx);
+    *byteLength = JS::GetArrayBufferByteLength(buffer);
+    *data = JS::GetArrayBufferData(buffer, &isSharedMemory, autoNoGC);
+  }
+  self->buffer = RootPool::newRoot(cx, buffer);
+  BufferType::pinLength(buffer, *data); // counted with the memoryviews of `memory.buffer` made by BufferType
+  self->pinnedBytes = (Py_ssize_t)*byteLength;
+  MemoryStats::pinnedJSBufferBytes += self->pinnedBytes;
+  return true;
+}
+
+static void releaseMemory(JSWasmMemoryProxy *self) {
+  if (self->exports > 0 || !self->buffer) {
+    return;
+  }
+  void *data;
+  {
+    bool isSharedMemory;
+    JS::AutoCheckCannotGC autoNoGC(GLOBAL_CX);
+    data = JS::GetArrayBufferData(*(self->buffer), &isSharedMemory, autoNoGC);
+  }
+  BufferType::unpinLength(*(self->buffer), data); // `buffer` is only kept for non-shared memory, which is always pinned
+  MemoryStats::pinnedJSBufferBytes -= self->pinnedBytes;
+  self->pinnedBytes = 0;
+  RootPool::deleteRoot(self->buffer);
+  self->buffer = nullptr;
+}
+
+int JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_getbuffer(JSWasmMemoryProxy *self, Py_buffer *view, int flags) {
+  void *data;
+  size_t byteLength;
+  if (!ContextOwner::check() || !currentMemory(self, &data, &byteLength)) {
+    view->obj = NULL;
+    return -1;
+  }
+  if (PyBuffer_FillInfo(view, (PyObject *)self, data, (Py_ssize_t)byteLength, 0, flags) < 0) {
+    releaseMemory(self);
+    return -1;
+  }
+  self->exports++;
+  MemoryStats::exportedJSBuffers++;
+  MemoryStats::exportedJSBufferBytes += view->len;
+  return 0;
+}
+
+void JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_releasebuffer(JSWasmMemoryProxy *self, Py_buffer *view) {
+  self->exports--;
+  MemoryStats::exportedJSBuffers--;
+  MemoryStats::exportedJSBufferBytes -= view->len;
+  releaseMemory(self);
+}
@@ -0,0 +1,497 @@
+/**
+ * @file JSWorker.cc
+ * @author agent (agent@local)
+ * @brief JSWorker is a custom C-implemented python type. It runs JS code in an isolated JS runtime on its own thread, exchanging structured clones with Python.
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/JSWorker.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/DeepCopy.hh"
+#include "include/setSpiderMonkeyException.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/CompilationAndEvaluation.h>
+#include <js/ContextOptions.h>
+#include <js/ErrorReport.h>
+#include <js/Exception.h>
+#include <js/GCVector.h>
+#include <js/Promise.h>
+#include <js/SourceText.h>
+#include <js/StructuredClone.h>
+
+#include <Python.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+/**
+ * @brief A message between Python and a worker: a structured clone, or the description of an exception thrown by the worker
+ */
+struct WorkerMessage {
+  std::unique_ptr<JSAutoStructuredCloneBuffer> clone; // null for an exception
+  std::string error;
+};
+
+/**
+ * @brief The state shared by a JSWorker and its native thread
+ */
+struct WorkerThread {
+  std::string code;
+  std::string filename;
+  std::mutex mutex; // guards everything below
+  std::condition_variable changed; // a message was posted either way, or the worker is closing or has exited
+  std::deque<WorkerMessage> inbox; // Python -> worker
+  std::deque<WorkerMessage> outbox; // worker -> Python
+  JSContext *cx = nullptr; // the worker's context while it is alive, to interrupt it
+  bool closing = false;
+  bool exited = false;
+  std::thread thread;
+};
+
+/**
+ * @brief The job queue of a worker's context, drained after the worker's code and after each message it handles
+ */
+class WorkerJobQueue : public JS::JobQueue {
+public:
+  explicit WorkerJobQueue(JSContext *cx) : jobs(new JS::PersistentRooted<JobVector>(cx)) {}
+
+  /**
+   * @brief Unroot the jobs, must be called before the context is destroyed, while the queue must outlive it
+   */
+  void finalize() {
+    jobs.reset();
+  }
+
+  bool getHostDefinedData(JSContext *cx, JS::MutableHandle<JSObject *> data) const override {
+    data.set(nullptr);
+    return true;
+  }
+
+  bool enqueuePromiseJob(JSContext *cx, JS::HandleObject promise, JS::HandleObject job, JS::HandleObject allocationSite, JS::HandleObject incumbentGlobal) override {
+    if (!jobs->append(job)) {
+      JS_ReportOutOfMemory(cx);
+      return false;
+    }
+    return true;
+  }
+
+  void runJobs(JSContext *cx) override {
+    (void)drain(cx, nullptr);
+  }
+
+  bool empty() const override {
+    return !jobs || jobs->empty();
+  }
+
+  bool isDrainingStopped() const override {
+    return false;
+  }
+
+  /**
+   * @brief Run the jobs, and the ones they enqueue, until the queue is empty
+   *
+   * @param cx - the worker's context
+   * @param worker - where to post the exceptions thrown by the jobs, or nullptr to drop them
+   * @return false - the worker was terminated
+   */
+  bool drain(JSContext *cx, WorkerThread *worker);
+
+private:
+  using JobVector = JS::GCVector<JSObject *, 0, js::SystemAllocPolicy>;
+  std::unique_ptr<JS::PersistentRooted<JobVector>> jobs;
+
+  /**
+   * @brief The job queue set aside while the Debugger API runs its own code, restored when destroyed
+   */
+  class SavedQueue : public JS::JobQueue::SavedJobQueue {
+  public:
+    SavedQueue(JSContext *cx, WorkerJobQueue *jobQueue) : jobQueue(jobQueue), saved(cx) {
+      std::swap(saved.get(), jobQueue->jobs->get());
+    }
+    ~SavedQueue() {
+      std::swap(saved.get(), jobQueue->jobs->get());
+    }
+  private:
+    WorkerJobQueue *jobQueue;
+    JS::PersistentRooted<JobVector> saved;
+  };
+
+  js::UniquePtr<JS::JobQueue::SavedJobQueue> saveJobQueue(JSContext *cx) override {
+    auto saved = js::MakeUnique<SavedQueue>(cx, this);
+    if (!saved) {
+      JS_ReportOutOfMemory(cx);
+    }
+    return saved;
+  }
+};
+
+/**
+ * @brief Post the pending exception of the worker's context to Python
+ *
+ * @param cx - the worker's context
+ * @param worker - the worker
+ * @return false - there is no pending exception, the code was interrupted to terminate the worker
+ */
+static bool postException(JSContext *cx, WorkerThread *worker) {
+  JS::ExceptionStack exceptionStack(cx);
+  if (!JS::StealPendingExceptionStack(cx, &exceptionStack)) {
+    return false;
+  }
+
+  WorkerMessage message;
+  JS::ErrorReportBuilder report(cx);
+  if (report.init(cx, exceptionStack, JS::ErrorReportBuilder::WithSideEffects) && report.toStringResult()) {
+    message.error = report.toStringResult().c_str();
+    if (report.report() && report.report()->filename.c_str()) {
+      message.error += "\n    at " + std::string(report.report()->filename.c_str()) + ":" + std::to_string(report.report()->lineno);
+    }
+  } else {
+    message.error = "uncaught exception in the worker";
+  }
+  JS_ClearPendingException(cx); // in case building the report threw
+
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->outbox.push_back(std::move(message));
+  }
+  worker->changed.notify_all();
+  return true;
+}
+
+bool WorkerJobQueue::drain(JSContext *cx, WorkerThread *worker) {
+  JS::RootedObject job(cx);
+  JS::RootedValue unused_rval(cx);
+  for (size_t index = 0; index < jobs->length(); index++) {
+    job = jobs->get()[index];
+    JSAutoRealm ar(cx, job);
+    if (!JS::Call(cx, JS::UndefinedHandleValue, job, JS::HandleValueArray::empty(), &unused_rval)) {
+      bool interrupted = worker ? !postException(cx, worker) : !JS_IsExceptionPending(cx);
+      JS_ClearPendingException(cx);
+      if (interrupted) {
+        jobs->clear();
+        return false;
+      }
+    }
+  }
+  jobs->clear();
+  return true;
+}
+
+static bool workerPostMessage(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  WorkerThread *worker = (WorkerThread *)JS_GetContextPrivate(cx);
+
+  auto clone = std::make_unique<JSAutoStructuredCloneBuffer>(JS::StructuredCloneScope::DifferentProcess, nullptr, nullptr);
+  if (!clone->write(cx, args.get(0))) {
+    return false; // DataCloneError
+  }
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->outbox.push_back({std::move(clone), std::string()});
+  }
+  worker->changed.notify_all();
+
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool workerClose(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  WorkerThread *worker = (WorkerThread *)JS_GetContextPrivate(cx);
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->closing = true; // the worker exits once the current message is handled
+  }
+  worker->changed.notify_all();
+
+  args.rval().setUndefined();
+  return true;
+}
+
+static JSFunctionSpec workerFunctions[] = {
+  JS_FN("postMessage", workerPostMessage, 1, 0),
+  JS_FN("close", workerClose, 0, 0),
+  JS_FS_END
+};
+
+static bool interruptWorker(JSContext *cx) {
+  WorkerThread *worker = (WorkerThread *)JS_GetContextPrivate(cx);
+  std::lock_guard<std::mutex> lock(worker->mutex);
+  return !worker->closing; // returning false stops the running JS code with an uncatchable exception
+}
+
+/**
+ * @brief Evaluate the worker's code, then hand it the messages sent by Python until it is closed or terminated
+ *
+ * @param cx - the worker's context
+ * @param worker - the worker
+ * @param jobQueue - the job queue of the worker's context
+ */
+static void runWorkerInContext(JSContext *cx, WorkerThread *worker, WorkerJobQueue *jobQueue) {
+  static JSClass workerGlobalClass = {"global", JSCLASS_GLOBAL_FLAGS, &JS::DefaultGlobalClassOps};
+  JS::RealmOptions options;
+  JS::RootedObject global(cx, JS_NewGlobalObject(cx, &workerGlobalClass, nullptr, JS::FireOnNewGlobalHook, options));
+  if (!global) {
+    postException(cx, worker);
+    return;
+  }
+  JSAutoRealm ar(cx, global);
+  if (!JS_DefineFunctions(cx, global, workerFunctions)) {
+    postException(cx, worker);
+    return;
+  }
+
+  JS::CompileOptions compileOptions(cx);
+  compileOptions.setFileAndLine(worker->filename.c_str(), 1);
+  JS::SourceText<mozilla::Utf8Unit> source;
+  JS::RootedValue rval(cx);
+  if (!source.init(cx, worker->code.c_str(), worker->code.length(), JS::SourceOwnership::Borrowed) ||
+      !JS::Evaluate(cx, compileOptions, source, &rval)) {
+    if (!postException(cx, worker)) {
+      return;
+    }
+  }
+
+  JS::RootedValue data(cx);
+  JS::RootedValue onmessage(cx);
+  JS::RootedObject event(cx);
+  for (;;) {
+    if (!jobQueue->drain(cx, worker)) {
+      return;
+    }
+
+    WorkerMessage message;
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      worker->changed.wait(lock, [worker] { return worker->closing || !worker->inbox.empty(); });
+      if (worker->closing) {
+        return;
+      }
+      message = std::move(worker->inbox.front());
+      worker->inbox.pop_front();
+    }
+
+    // Like Web Workers, the message is dispatched to `onmessage({ data })`, and dropped if there is no handler
+    bool ok = message.clone->read(cx, &data) && JS_GetProperty(cx, global, "onmessage", &onmessage);
+    if (ok && onmessage.isObject() && JS::IsCallable(&onmessage.toObject())) {
+      event = JS_NewPlainObject(cx);
+      ok = event && JS_DefineProperty(cx, event, "data", data, JSPROP_ENUMERATE);
+      if (ok) {
+        JS::RootedValueArray<1> args(cx);
+        args[0].setObject(*event);
+        ok = JS_CallFunctionValue(cx, global, onmessage, args, &rval);
+      }
+    }
+    if (!ok && !postException(cx, worker)) {
+      return;
+    }
+  }
+}
+
+static std::atomic<size_t> runningWorkers(0);
+
+/**
+ * @brief The native thread of a worker, it never touches Python
+ */
+static void runWorker(WorkerThread *worker) {
+  JSContext *cx = JS_NewContext(JS::DefaultHeapMaxBytes);
+  if (cx) {
+    JS::ContextOptionsRef(cx)
+    .setWasm(true)
+    .setAsmJS(true)
+    .setAsyncStack(true);
+    JS_SetGCParameter(cx, JSGC_MAX_BYTES, (uint32_t)-1);
+    JS_SetContextPrivate(cx, worker);
+    JS_AddInterruptCallback(cx, interruptWorker);
+
+    WorkerJobQueue *jobQueue = new WorkerJobQueue(cx);
+    JS::SetJobQueue(cx, jobQueue);
+    if (JS::InitSelfHostedCode(cx)) {
+      bool closing;
+      {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->cx = cx;
+        closing = worker->closing;
+      }
+      if (!closing) {
+        runWorkerInContext(cx, worker, jobQueue);
+      }
+    } else {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->outbox.push_back({nullptr, "Spidermonkey could not initialize self-hosted code in the worker."});
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->cx = nullptr;
+    }
+    jobQueue->finalize();
+    JS_DestroyContext(cx);
+    delete jobQueue;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (!cx) {
+      worker->outbox.push_back({nullptr, "Spidermonkey could not create a JS context for the worker."});
+    }
+    worker->exited = true;
+  }
+  runningWorkers--;
+  worker->changed.notify_all();
+}
+
+/**
+ * @brief Terminate a worker, interrupting its JS code, and wait for its thread to exit
+ */
+static void stopWorker(WorkerThread *worker) {
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->closing = true;
+    if (worker->cx) {
+      JS_RequestInterruptCallback(worker->cx); // may be called from any thread
+    }
+  }
+  worker->changed.notify_all();
+
+  if (worker->thread.joinable()) {
+    Py_BEGIN_ALLOW_THREADS
+    worker->thread.join();
+    Py_END_ALLOW_THREADS
+  }
+}
+
+PyObject *JSWorkerMethodDefinitions::JSWorker_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"code", "filename", NULL};
+  const char *code;
+  Py_ssize_t codeLength;
+  const char *filename = "<worker>";
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s#|s", (char **)kwlist, &code, &codeLength, &filename)) {
+    return NULL;
+  }
+
+  JSWorker *self = (JSWorker *)type->tp_alloc(type, 0);
+  if (!self) {
+    return NULL;
+  }
+  self->worker = new WorkerThread();
+  self->worker->code.assign(code, codeLength);
+  self->worker->filename = filename;
+  runningWorkers++;
+  self->worker->thread = std::thread(runWorker, self->worker);
+  return (PyObject *)self;
+}
+
+void JSWorkerMethodDefinitions::JSWorker_dealloc(JSWorker *self) {
+  if (self->worker) {
+    stopWorker(self->worker);
+    delete self->worker;
+  }
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *JSWorkerMethodDefinitions::JSWorker_postMessage(JSWorker *self, PyObject *value) {
+  JS::RootedValue jsValue(GLOBAL_CX);
+  if (!DeepCopy::toJS(GLOBAL_CX, value, &jsValue)) {
+    return NULL;
+  }
+  auto clone = std::make_unique<JSAutoStructuredCloneBuffer>(JS::StructuredCloneScope::DifferentProcess, nullptr, nullptr);
+  if (!clone->write(GLOBAL_CX, jsValue)) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+
+  WorkerThread *worker = self->worker;
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->closing || worker->exited) {
+      PyErr_SetString(PyExc_RuntimeError, "pythonmonkey.Worker: the worker has exited");
+      return NULL;
+    }
+    worker->inbox.push_back({std::move(clone), std::string()});
+  }
+  worker->changed.notify_all();
+  Py_RETURN_NONE;
+}
+
+PyObject *JSWorkerMethodDefinitions::JSWorker_getMessage(JSWorker *self, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"timeout", NULL};
+  PyObject *timeoutObj = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", (char **)kwlist, &timeoutObj)) {
+    return NULL;
+  }
+  double timeout = -1; // wait forever
+  if (timeoutObj != Py_None) {
+    timeout = PyFloat_AsDouble(timeoutObj);
+    if (timeout == -1 && PyErr_Occurred()) {
+      return NULL;
+    }
+    if (timeout < 0) {
+      timeout = 0;
+    }
+  }
+
+  WorkerThread *worker = self->worker;
+  WorkerMessage message;
+  bool received = false;
+  bool exited = false;
+  Py_BEGIN_ALLOW_THREADS
+  {
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    auto ready = [worker] { return !worker->outbox.empty() || worker->exited; };
+    if (timeout < 0) {
+      worker->changed.wait(lock, ready);
+    } else {
+      worker->changed.wait_for(lock, std::chrono::duration<double>(timeout), ready);
+    }
+    if (!worker->outbox.empty()) {
+      message = std::move(worker->outbox.front());
+      worker->outbox.pop_front();
+      received = true;
+    }
+    exited = worker->exited;
+  }
+  Py_END_ALLOW_THREADS
+
+  if (!received) {
+    if (exited) {
+      PyErr_SetString(PyExc_RuntimeError, "pythonmonkey.Worker: the worker has exited");
+    } else {
+      PyErr_SetString(PyExc_TimeoutError, "pythonmonkey.Worker: no message was posted by the worker in time");
+    }
+    return NULL;
+  }
+  if (!message.clone) {
+    PyErr_SetString(SpiderMonkeyError, message.error.c_str());
+    return NULL;
+  }
+
+  JS::RootedValue value(GLOBAL_CX);
+  if (!message.clone->read(GLOBAL_CX, &value)) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  return DeepCopy::toPython(GLOBAL_CX, value);
+}
+
+PyObject *JSWorkerMethodDefinitions::JSWorker_terminate(JSWorker *self, PyObject *Py_UNUSED(args)) {
+  stopWorker(self->worker);
+  Py_RETURN_NONE;
+}
+
+size_t JSWorkerMethodDefinitions::running() {
+  return runningWorkers;
+}
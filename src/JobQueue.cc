@@ -11,19 +11,27 @@
 #include "include/JobQueue.hh"
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
 
+#include "include/GILSwitch.hh"
+#include "include/Metrics.hh"
 #include "include/PyEventLoop.hh"
 #include "include/pyTypeFactory.hh"
 #include "include/PromiseType.hh"
+#include "include/setSpiderMonkeyException.hh"
 
 #include <Python.h>
 
 #include <jsfriendapi.h>
 #include <mozilla/Unused.h>
 
+#include <condition_variable>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 JobQueue::JobQueue(JSContext *cx) {
   finalizationRegistryCallbacks = new JS::PersistentRooted<FunctionVector>(cx);   // Leaks but it's OK since freed at process exit
+  jobs = new JS::PersistentRooted<JobVector>(cx); // ditto
 }
 
 bool JobQueue::getHostDefinedData(JSContext *cx, JS::MutableHandle<JSObject *> data) const {
@@ -31,45 +39,185 @@ bool JobQueue::getHostDefinedData(JSContext *cx, JS::MutableHandle<JSObject *> d
   return true; // `true` indicates no error
 }
 
+static PyObject *callDrainJobs(PyObject *jobQueuePtr, PyObject *Py_UNUSED(unused)) {
+  JobQueue *jobQueue = (JobQueue *)PyLong_AsVoidPtr(jobQueuePtr);
+  if (!jobQueue->drain(GLOBAL_CX)) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef callDrainJobsDef = {"JsDrainJobs", callDrainJobs, METH_NOARGS, NULL};
+
 bool JobQueue::enqueuePromiseJob(JSContext *cx,
   [[maybe_unused]] JS::HandleObject promise,
   JS::HandleObject job,
   [[maybe_unused]] JS::HandleObject allocationSite,
   JS::HandleObject incumbentGlobal) {
 
-  // Convert the `job` JS function to a Python function for event-loop callback
-  JS::RootedValue jobv(cx, JS::ObjectValue(*job));
-  PyObject *callback = pyTypeFactory(cx, jobv);
+  // While draining, the job simply runs after the ones already queued, in the same event-loop callback
+  if (!draining) {
+    PyEventLoop loop = PyEventLoop::getRunningLoop();
+    if (!loop.initialized()) return false;
+
+    // Send a single drain of the queue to the running Python event-loop, unless one is already pending on it
+    if (loop._loop != drainLoop) {
+      PyObject *jobQueue = PyLong_FromVoidPtr(this);
+      if (!jobQueue) return false;
+      PyObject *drainFn = PyCFunction_New(&callDrainJobsDef, jobQueue);
+      Py_DECREF(jobQueue);
+      if (!drainFn) return false;
+      loop.enqueue(drainFn);
+      Py_DECREF(drainFn);
+      Py_XDECREF(drainLoop);
+      drainLoop = loop._loop;
+      Py_INCREF(drainLoop);
+    }
+  }
 
-  // Send job to the running Python event-loop
-  PyEventLoop loop = PyEventLoop::getRunningLoop();
-  if (!loop.initialized()) return false;
+  if (!jobs->append(job)) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+  enqueuedAt.push_back(Metrics::now());
+  Metrics::jobsEnqueued++;
 
   // Inform the JS runtime that the job queue is no longer empty
   JS::JobQueueMayNotBeEmpty(cx);
+  return true;
+}
 
-  loop.enqueue(callback);
+bool JobQueue::drain(JSContext *cx, size_t first) {
+  GILSwitch::AutoHandOver handOver;
+  if (!handOver.entered()) {
+    return false;
+  }
 
-  Py_DECREF(callback);
-  return true;
+  bool nested = draining; // a job called back into Python, which drains the jobs it enqueued itself, see `callSync`
+  if (!nested && first == 0) {
+    Py_CLEAR(drainLoop);
+  }
+  draining = true;
+  Metrics::drains++;
+
+  // Run the jobs in FIFO order, including the ones they enqueue, until the queue is empty, like a microtask checkpoint
+  JS::RootedObject job(cx);
+  JS::RootedValue unused_rval(cx);
+  size_t index = first;
+  bool ok = true;
+  for (; index < jobs->length(); index++) {
+    job = jobs->get()[index];
+    JSAutoRealm ar(cx, job);
+    uint64_t startedAt = Metrics::now();
+    Metrics::jobWait.record(startedAt - enqueuedAt[index]);
+    ok = JS::Call(cx, JS::UndefinedHandleValue, job, JS::HandleValueArray::empty(), &unused_rval);
+    Metrics::jobRun.record(Metrics::now() - startedAt);
+    Metrics::jobsRun++;
+    if (!ok) {
+      index++;
+      break;
+    }
+  }
+  jobs->get().erase(jobs->get().begin() + first, jobs->get().begin() + index);
+  enqueuedAt.erase(enqueuedAt.begin() + first, enqueuedAt.begin() + index);
+  draining = nested;
+
+  if (!ok && nested) {
+    setSpiderMonkeyException(cx); // the remaining jobs are left to the outer drain
+  } else if (!ok) {
+    // Report the error as the event-loop callback's, and leave the remaining jobs to a new drain
+    setSpiderMonkeyException(cx);
+    if (!jobs->empty()) {
+      PyObject *type, *value, *traceback;
+      PyErr_Fetch(&type, &value, &traceback);
+      PyEventLoop loop = PyEventLoop::getRunningLoop();
+      if (loop.initialized()) {
+        PyObject *jobQueue = PyLong_FromVoidPtr(this);
+        PyObject *drainFn = jobQueue ? PyCFunction_New(&callDrainJobsDef, jobQueue) : NULL;
+        Py_XDECREF(jobQueue);
+        if (drainFn) {
+          loop.enqueue(drainFn);
+          Py_DECREF(drainFn);
+          drainLoop = loop._loop;
+          Py_INCREF(drainLoop);
+        }
+      }
+      PyErr_Restore(type, value, traceback);
+    }
+  }
+  return ok;
+}
+
+bool JobQueue::callSync(JSContext *cx, JS::HandleValue fn, const JS::HandleValueArray &args, JS::MutableHandleValue rval) {
+  // The jobs enqueued by the call are not sent to the Python event-loop, but run right after it by `drain`
+  size_t first = jobs->length();
+  bool wasDraining = draining;
+  draining = true;
+  bool ok;
+  {
+    GILSwitch::AutoHandOver handOver;
+    if (!handOver.entered()) {
+      draining = wasDraining;
+      return false;
+    }
+    ok = JS::Call(cx, JS::UndefinedHandleValue, fn, args, rval);
+  }
+  draining = wasDraining;
+
+  if (!ok) {
+    setSpiderMonkeyException(cx);
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback); // the jobs already enqueued still run, the call's exception is reported instead of theirs
+    if (!drain(cx, first)) {
+      PyErr_Clear();
+    }
+    PyErr_Restore(type, value, traceback);
+    return false;
+  }
+  return drain(cx, first);
 }
 
 void JobQueue::runJobs(JSContext *cx) {
-  // Do nothing
+  if (!draining && !drain(cx)) {
+    PyErr_Clear(); // there is nowhere to report it, the Debugger only wants the queue to be drained
+  }
 }
 
 bool JobQueue::empty() const {
-  // TODO (Tom Tang): implement using `get_running_loop` and getting job count on loop???
-  return true; // see https://hg.mozilla.org/releases/mozilla-esr128/file/tip/js/src/builtin/Promise.cpp#l6946
+  return jobs->empty();
 }
 
 bool JobQueue::isDrainingStopped() const {
-  // TODO (Tom Tang): implement this by detecting if the Python event-loop is still running
-  return false;
+  return false; // the queue is always drained until empty
 }
 
+/**
+ * @brief The job queue set aside while the Debugger API runs its own code, restored when destroyed
+ */
+class JobQueue::SavedQueue : public JS::JobQueue::SavedJobQueue {
+public:
+  SavedQueue(JSContext *cx, JobQueue *jobQueue) : jobQueue(jobQueue), saved(cx), draining(jobQueue->draining) {
+    std::swap(saved.get(), jobQueue->jobs->get());
+    std::swap(savedEnqueuedAt, jobQueue->enqueuedAt);
+    jobQueue->draining = false;
+  }
+
+  ~SavedQueue() {
+    MOZ_ASSERT(jobQueue->jobs->empty(), "the job queue must be empty before it can be restored");
+    std::swap(saved.get(), jobQueue->jobs->get());
+    std::swap(savedEnqueuedAt, jobQueue->enqueuedAt);
+    jobQueue->draining = draining;
+  }
+
+private:
+  JobQueue *jobQueue;
+  JS::PersistentRooted<JobVector> saved;
+  std::vector<uint64_t> savedEnqueuedAt;
+  bool draining;
+};
+
 js::UniquePtr<JS::JobQueue::SavedJobQueue> JobQueue::saveJobQueue(JSContext *cx) {
-  auto saved = js::MakeUnique<JS::JobQueue::SavedJobQueue>();
+  auto saved = js::MakeUnique<SavedQueue>(cx, this);
   if (!saved) {
     JS_ReportOutOfMemory(cx);
     return NULL;
@@ -87,44 +235,110 @@ bool JobQueue::init(JSContext *cx) {
 static PyObject *callDispatchFunc(PyObject *dispatchFuncTuple, PyObject *Py_UNUSED(unused)) {
   JSContext *cx = (JSContext *)PyLong_AsVoidPtr(PyTuple_GetItem(dispatchFuncTuple, 0));
   JS::Dispatchable *dispatchable = (JS::Dispatchable *)PyLong_AsVoidPtr(PyTuple_GetItem(dispatchFuncTuple, 1));
+  Metrics::dispatchablesRun++;
   dispatchable->run(cx, JS::Dispatchable::NotShuttingDown);
   Py_RETURN_NONE;
 }
 
 static PyMethodDef callDispatchFuncDef = {"JsDispatchCallable", callDispatchFunc, METH_NOARGS, NULL};
 
+/**
+ * @brief The dispatchables sent by SpiderMonkey helper threads, waiting for the dispatcher thread to forward them to the main event-loop
+ */
+struct DispatchQueue {
+  std::mutex mutex;
+  std::condition_variable available;
+  std::vector<std::pair<JSContext *, JS::Dispatchable *>> pending;
+  bool dispatcherStarted = false;
+};
+
+static DispatchQueue *dispatchQueue = new DispatchQueue(); // Leaks but it's OK since freed at process exit, the dispatcher thread may still wait on it
+
+/**
+ * @brief The single long-lived thread that sends the dispatchables to the Python event-loop on the main thread.
+ * Sending them from the JS helper threads themselves may cause deadlocks, as they would wait for the GIL.
+ */
+static void dispatcherThread(void *Py_UNUSED(unused)) {
+  std::vector<std::pair<JSContext *, JS::Dispatchable *>> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(dispatchQueue->mutex);
+      dispatchQueue->available.wait(lock, [] { return !dispatchQueue->pending.empty(); });
+      std::swap(batch, dispatchQueue->pending);
+    }
+
+    // We cannot call the Python API when shutting down as the thread state is gone.
+    if (Py_IsFinalizing()) { return; }
+
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    for (auto [cx, dispatchable]: batch) {
+      PyObject *dispatchFuncTuple = Py_BuildValue("(NN)", PyLong_FromVoidPtr(cx), PyLong_FromVoidPtr(dispatchable));
+      PyObject *pyFunc = PyCFunction_New(&callDispatchFuncDef, dispatchFuncTuple);
+      Py_XDECREF(dispatchFuncTuple);
+      if (!pyFunc || !sendJobToMainLoop(pyFunc)) {
+        PyErr_Print();
+      }
+      Py_XDECREF(pyFunc);
+    }
+    PyGILState_Release(gstate);
+    batch.clear();
+  }
+}
+
 bool JobQueue::dispatchToEventLoop(void *closure, JS::Dispatchable *dispatchable) {
   JSContext *cx = (JSContext *)closure;
 
-  // The `dispatchToEventLoop` function is running in a helper thread, so
-  // we must acquire the Python GIL (global interpreter lock)
-  //    see https://docs.python.org/3/c-api/init.html#non-python-created-threads
-  PyGILState_STATE gstate = PyGILState_Ensure();
+  // The `dispatchToEventLoop` function is running in a helper thread, it only hands the dispatchable over without touching Python
+  bool startDispatcher;
+  {
+    std::lock_guard<std::mutex> lock(dispatchQueue->mutex);
+    dispatchQueue->pending.emplace_back(cx, dispatchable);
+    Metrics::dispatchablesQueued++;
+    startDispatcher = !std::exchange(dispatchQueue->dispatcherStarted, true);
+  }
+  dispatchQueue->available.notify_one();
 
-  PyObject *dispatchFuncTuple = PyTuple_Pack(2, PyLong_FromVoidPtr(cx), PyLong_FromVoidPtr(dispatchable));
-  PyObject *pyFunc = PyCFunction_New(&callDispatchFuncDef, dispatchFuncTuple);
+  if (startDispatcher) {
+    // the GIL is not needed to start a thread, see https://docs.python.org/3/c-api/init.html#non-python-created-threads
+    PyThread_start_new_thread(dispatcherThread, nullptr);
+  }
+  return true;
+}
 
-  // Avoid using the current, JS helper thread to send jobs to event-loop as it may cause deadlock
-  PyThread_start_new_thread((void (*)(void *)) &sendJobToMainLoop, pyFunc);
+void JobQueue::prepareFork() {
+  dispatchQueue->mutex.lock();
+}
 
-  PyGILState_Release(gstate);
-  return true;
+void JobQueue::afterFork(bool inChild) {
+  if (!inChild) {
+    dispatchQueue->mutex.unlock();
+    return;
+  }
+
+  DispatchQueue *childQueue = new DispatchQueue(); // the queue of the parent is left locked and leaked, its dispatcher thread isn't copied
+  childQueue->pending = dispatchQueue->pending;
+  dispatchQueue = childQueue;
+  if (!dispatchQueue->pending.empty()) {
+    dispatchQueue->dispatcherStarted = true;
+    PyThread_start_new_thread(dispatcherThread, nullptr);
+  }
 }
 
 bool sendJobToMainLoop(PyObject *pyFunc) {
   PyGILState_STATE gstate = PyGILState_Ensure();
 
-  // Send job to the running Python event-loop on cx's thread (the main thread)
-  PyEventLoop loop = PyEventLoop::getMainLoop();
-  if (!loop.initialized()) {
-    PyGILState_Release(gstate);
-    return false;
+  bool sent;
+  { // the `Py_XDECREF` Python API call in `PyEventLoop`'s destructor must happen before we hand over the GIL by `PyGILState_Release`
+    // Send job to the running Python event-loop on cx's thread (the main thread)
+    PyEventLoop loop = PyEventLoop::getMainLoop();
+    sent = loop.initialized();
+    if (sent) {
+      loop.enqueue(pyFunc);
+    }
   }
-  loop.enqueue(pyFunc);
 
-  loop._loop = nullptr; // the `Py_XDECREF` Python API call in `PyEventLoop`'s destructor will not be accessible once we hand over the GIL by `PyGILState_Release`
   PyGILState_Release(gstate);
-  return true;
+  return sent;
 }
 
 void JobQueue::promiseRejectionTracker(JSContext *cx,
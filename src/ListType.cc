@@ -12,13 +12,29 @@
 #include "include/ListType.hh"
 
 #include "include/JSArrayProxy.hh"
+#include "include/ProxyCache.hh"
+#include "include/CrossHeap.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 
 
 PyObject *ListType::getPyObject(JSContext *cx, JS::HandleObject jsArrayObj) {
-  JSArrayProxy *proxy = (JSArrayProxy *)PyObject_CallObject((PyObject *)&JSArrayProxyType, NULL);
+  PyObject *cached = ProxyCache::getPyProxy(jsArrayObj);
+  if (cached) {
+    if (PyObject_TypeCheck(cached, &JSArrayProxyType)) {
+      return cached;
+    }
+    Py_DECREF(cached); // the array is already proxied as another type, e.g. as a JSObjectProxy
+  }
+
+  JSArrayProxy *proxy = JSArrayProxyMethodDefinitions::allocate();
   if (proxy != NULL) {
-    proxy->jsArray = new JS::PersistentRootedObject(cx);
-    proxy->jsArray->set(jsArrayObj);
+    proxy->jsArray = RootPool::newRoot(cx, jsArrayObj);
+    ProxyCache::putPyProxy(jsArrayObj, (PyObject *)proxy);
+    CrossHeap::registerProxy((PyObject *)proxy, proxy->jsArray);
+    MemoryStats::jsArrayProxies++;
+    Retention::pinJS(cx, (PyObject *)proxy);
     return (PyObject *)proxy;
   }
   return NULL;
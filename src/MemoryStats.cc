@@ -0,0 +1,134 @@
+/**
+ * @file MemoryStats.cc
+ * @author agent (agent@local)
+ * @brief Accounting of the memory of the JS heap and of the memory held across the Python <-> JS bridge
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/MemoryStats.hh"
+
+#include "include/JSStringProxy.hh"
+#include "include/PyBytesProxyHandler.hh"
+#include "include/PyDictProxyHandler.hh"
+#include "include/PyIterableProxyHandler.hh"
+#include "include/PyListProxyHandler.hh"
+#include "include/PyMapProxyHandler.hh"
+#include "include/PyObjectProxyHandler.hh"
+
+#include <jsapi.h>
+#include <js/GCAPI.h>
+#include <js/MemoryMetrics.h>
+
+#include <Python.h>
+
+#if defined(__APPLE__)
+  #include <malloc/malloc.h>
+#else
+  #include <malloc.h>
+#endif
+
+void MemoryStats::countPyProxy(const void *family, int64_t delta) {
+  if (family == &PyDictProxyHandler::family || family == &PyMapProxyHandler::family) {
+    pyDictProxies += delta;
+  } else if (family == &PyListProxyHandler::family) {
+    pyListProxies += delta;
+  } else if (family == &PyIterableProxyHandler::family) {
+    pyIterableProxies += delta;
+  } else if (family == &PyBytesProxyHandler::family) {
+    pyBytesProxies += delta;
+  } else {
+    pyObjectProxies += delta;
+  }
+}
+
+size_t MemoryStats::mallocSizeOf(const void *ptr) {
+  if (!ptr) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#elif defined(_WIN32)
+  return _msize((void *)ptr);
+#else
+  return malloc_usable_size((void *)ptr);
+#endif
+}
+
+/**
+ * @brief JS::CollectRuntimeStats requires a subclass, PythonMonkey has no extra per-zone or per-realm data to measure
+ */
+class BridgeRuntimeStats : public JS::RuntimeStats {
+public:
+  BridgeRuntimeStats() : JS::RuntimeStats(MemoryStats::mallocSizeOf) {}
+
+  void initExtraZoneStats(JS::Zone *zone, JS::ZoneStats *zStats, const JS::AutoRequireNoGC &nogc) override {}
+  void initExtraRealmStats(JS::Realm *realm, JS::RealmStats *realmStats, const JS::AutoRequireNoGC &nogc) override {}
+};
+
+static PyObject *runtimeStatsToPython(JSContext *cx) {
+  BridgeRuntimeStats rtStats;
+  if (!JS::CollectRuntimeStats(cx, &rtStats, nullptr, false)) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  return Py_BuildValue("{sKsKsKsKsKsK}",
+    "gcHeapChunkTotal", (unsigned long long)rtStats.gcHeapChunkTotal,
+    "gcHeapGCThings", (unsigned long long)rtStats.gcHeapGCThings,
+    "gcHeapUnusedChunks", (unsigned long long)rtStats.gcHeapUnusedChunks,
+    "gcHeapUnusedArenas", (unsigned long long)rtStats.gcHeapUnusedArenas,
+    "gcHeapChunkAdmin", (unsigned long long)rtStats.gcHeapChunkAdmin,
+    "gcHeapDecommittedPages", (unsigned long long)rtStats.gcHeapDecommittedPages
+  );
+}
+
+PyObject *MemoryStats::toPython(JSContext *cx, bool detailed) {
+  long long jsStrings = (long long)jsStringProxies.size();
+  // one root per Python proxy, exported buffer, and JS proxy of an immutable Python buffer (its ArrayBuffer)
+  long long persistentRoots = jsObjectProxies + jsArrayProxies + jsFunctionProxies + jsMethodProxies + jsStrings + exportedJSBuffers + pyBytesProxies;
+
+  PyObject *result = Py_BuildValue("{s{sKsKsKsKsK}s{sLsLsLsLsL}s{sLsLsLsLsL}s{sLsL}s{sLsLsLsLsL}sL}",
+    "heap",
+    "gcBytes", (unsigned long long)JS_GetGCParameter(cx, JSGC_BYTES),
+    "gcMaxBytes", (unsigned long long)JS_GetGCParameter(cx, JSGC_MAX_BYTES),
+    "gcNumber", (unsigned long long)JS_GetGCParameter(cx, JSGC_NUMBER),
+    "totalChunks", (unsigned long long)JS_GetGCParameter(cx, JSGC_TOTAL_CHUNKS),
+    "unusedChunks", (unsigned long long)JS_GetGCParameter(cx, JSGC_UNUSED_CHUNKS),
+    "proxiesOfPyObjects",
+    "dict", (long long)pyDictProxies,
+    "list", (long long)pyListProxies,
+    "object", (long long)pyObjectProxies,
+    "iterable", (long long)pyIterableProxies,
+    "bytes", (long long)pyBytesProxies,
+    "proxiesOfJSValues",
+    "object", (long long)jsObjectProxies,
+    "array", (long long)jsArrayProxies,
+    "function", (long long)jsFunctionProxies,
+    "method", (long long)jsMethodProxies,
+    "string", jsStrings,
+    "externalStrings",
+    "count", (long long)externalStrings,
+    "bytes", (long long)externalStringBytes,
+    "buffers",
+    "sharedPyBuffers", (long long)sharedPyBuffers,
+    "sharedPyBufferBytes", (long long)sharedPyBufferBytes,
+    "exportedJSBuffers", (long long)exportedJSBuffers,
+    "exportedJSBufferBytes", (long long)exportedJSBufferBytes,
+    "pinnedJSBufferBytes", (long long)pinnedJSBufferBytes,
+    "persistentRoots", persistentRoots
+  );
+  if (!result || !detailed) {
+    return result;
+  }
+
+  PyObject *runtime = runtimeStatsToPython(cx);
+  if (!runtime || PyDict_SetItemString(result, "runtime", runtime) < 0) {
+    Py_XDECREF(runtime);
+    Py_DECREF(result);
+    return NULL;
+  }
+  Py_DECREF(runtime);
+  return result;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file Metrics.cc
+ * @author agent (agent@local)
+ * @brief Counters and latency histograms of the work going through the event-loop and job queue bridge
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/Metrics.hh"
+#include "include/HotPathStats.hh"
+#include "include/PyEventLoop.hh"
+
+#include <Python.h>
+
+void Metrics::Histogram::record(uint64_t nanoseconds) {
+  uint64_t microseconds = nanoseconds / 1000;
+  size_t bucket = 0;
+  while (bucket < BUCKETS - 1 && microseconds >= ((uint64_t)1 << bucket)) {
+    bucket++;
+  }
+  buckets[bucket]++;
+  count++;
+  totalNs += nanoseconds;
+  if (nanoseconds > maxNs) {
+    maxNs = nanoseconds;
+  }
+}
+
+PyObject *Metrics::Histogram::toPython() const {
+  PyObject *bucketList = PyList_New(BUCKETS);
+  if (!bucketList) {
+    return NULL;
+  }
+  for (size_t index = 0; index < BUCKETS; index++) {
+    PyList_SET_ITEM(bucketList, index, PyLong_FromUnsignedLongLong(buckets[index]));
+  }
+  return Py_BuildValue("{sKsdsdsN}",
+    "count", (unsigned long long)count,
+    "totalUs", totalNs / 1000.0,
+    "maxUs", maxNs / 1000.0,
+    "buckets", bucketList
+  );
+}
+
+PyObject *Metrics::toPython() {
+  PyObject *result = Py_BuildValue("{s{sKsKsKsNsN}s{sKsKsKsN}s{sKsK}s{sKsKsKsK}s{sLsL}si}",
+    "jobs",
+    "enqueued", (unsigned long long)jobsEnqueued,
+    "run", (unsigned long long)jobsRun,
+    "drains", (unsigned long long)drains,
+    "wait", jobWait.toPython(),
+    "duration", jobRun.toPython(),
+    "timers",
+    "scheduled", (unsigned long long)timersScheduled,
+    "fired", (unsigned long long)timersFired,
+    "cancelled", (unsigned long long)timersCancelled,
+    "lateness", timerLateness.toPython(),
+    "dispatchables",
+    "queued", (unsigned long long)dispatchablesQueued.load(),
+    "run", (unsigned long long)dispatchablesRun,
+    "scripts",
+    "compiled", (unsigned long long)stencilsCompiled,
+    "memoryHits", (unsigned long long)stencilMemoryHits,
+    "diskHits", (unsigned long long)stencilDiskHits,
+    "stored", (unsigned long long)stencilsStored,
+    "bridges",
+    "promisesAwaitedByFutures", (long long)promisesAwaitedByFutures,
+    "awaitablesAwaitedByPromises", (long long)awaitablesAwaitedByPromises,
+    "pendingEventLoopJobs", PyEventLoop::_locker ? PyEventLoop::_locker->getCounter() : 0
+  );
+  if (!result) {
+    return NULL;
+  }
+  PyObject *hotPaths = HotPathStats::toPython();
+  if (!hotPaths || PyDict_SetItemString(result, "hotPaths", hotPaths) < 0) {
+    Py_XDECREF(hotPaths);
+    Py_DECREF(result);
+    return NULL;
+  }
+  Py_DECREF(hotPaths);
+  return result;
+}
+
+void Metrics::reset() {
+  jobsEnqueued = jobsRun = drains = 0;
+  jobWait = Histogram();
+  jobRun = Histogram();
+  timersScheduled = timersFired = timersCancelled = 0;
+  timerLateness = Histogram();
+  dispatchablesQueued = 0;
+  dispatchablesRun = 0;
+  stencilsCompiled = stencilMemoryHits = stencilDiskHits = stencilsStored = 0;
+  HotPathStats::reset();
+}
@@ -0,0 +1,435 @@
+/**
+ * @file ModuleLoader.cc
+ * @author agent (agent@local)
+ * @brief Native loading of ES modules, and the cached file system lookups of the module loaders
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/ModuleLoader.hh"
+
+#include "include/jsTypeFactory.hh"
+#include "include/RequireCache.hh"
+#include "include/StencilCache.hh"
+
+#include <jsapi.h>
+#include <js/CompileOptions.h>
+#include <js/JSON.h>
+#include <js/Modules.h>
+#include <js/Promise.h>
+#include <js/String.h>
+
+#include <Python.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+/**
+ * @brief The contents of a file, memory-mapped where possible so that the compiler reads the page cache directly
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+      return;
+    }
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      contents.append(buffer, count);
+    }
+    fclose(file);
+    opened = true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+      length = sb.st_size;
+      if (length == 0) {
+        opened = true;
+      } else {
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        opened = mapping != MAP_FAILED;
+        if (!opened) {
+          mapping = nullptr;
+        }
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (mapping) {
+      munmap(mapping, length);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool ok() const {
+    return opened;
+  }
+
+#ifdef _WIN32
+  const char *data() const {
+    return contents.data();
+  }
+
+  size_t size() const {
+    return contents.size();
+  }
+private:
+  std::string contents;
+#else
+  const char *data() const {
+    return mapping ? (const char *)mapping : "";
+  }
+
+  size_t size() const {
+    return length;
+  }
+private:
+  void *mapping = nullptr;
+  size_t length = 0;
+#endif
+  bool opened = false;
+};
+
+// the module records of the files loaded so far, by absolute path
+static std::unordered_map<std::string, JS::PersistentRootedObject *> modules;
+
+static inline bool isFile(int mode) {
+  return mode != -1 && (mode & S_IFMT) == S_IFREG;
+}
+
+static inline bool isDirectory(int mode) {
+  return mode != -1 && (mode & S_IFMT) == S_IFDIR;
+}
+
+int ModuleLoader::statMode(const std::string &path) {
+  return RequireCache::statMode(path);
+}
+
+void ModuleLoader::clearStatCache() {
+  RequireCache::clear();
+}
+
+JSString *ModuleLoader::readFile(JSContext *cx, const std::string &path) {
+  MappedFile file(path);
+  if (!file.ok()) {
+    JS_ReportErrorUTF8(cx, "ENOENT: no such file or directory, open '%s'", path.c_str());
+    return nullptr;
+  }
+  return JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(file.data(), file.size()));
+}
+
+/**
+ * @brief Whether a Python codec name is UTF-8, e.g. "utf-8", "UTF8" or "utf_8"
+ */
+static bool isUtf8Charset(const char *charset) {
+  std::string name;
+  for (const char *c = charset; *c; c++) {
+    if (*c != '-' && *c != '_') {
+      name += (char)tolower((unsigned char)*c);
+    }
+  }
+  return name == "utf8";
+}
+
+JSString *ModuleLoader::readTextFile(JSContext *cx, const std::string &path, const char *charset) {
+  MappedFile file(path);
+  if (!file.ok()) {
+    JS_ReportErrorUTF8(cx, "ENOENT: no such file or directory, open '%s'", path.c_str());
+    return nullptr;
+  }
+
+  const char *chars = file.data();
+  size_t length = file.size();
+  PyObject *decoded = NULL;
+  if (charset && !isUtf8Charset(charset)) {
+    Py_ssize_t decodedLength;
+    decoded = PyUnicode_Decode(chars, length, charset, "strict");
+    chars = decoded ? PyUnicode_AsUTF8AndSize(decoded, &decodedLength) : NULL;
+    if (!chars) {
+      Py_XDECREF(decoded);
+      setPyException(cx);
+      return nullptr;
+    }
+    length = decodedLength;
+  }
+
+  // the universal newlines of Python's text files
+  std::string text;
+  text.reserve(length);
+  for (size_t index = 0; index < length; index++) {
+    if (chars[index] == '\r') {
+      text += '\n';
+      if (index + 1 < length && chars[index + 1] == '\n') {
+        index++;
+      }
+    } else {
+      text += chars[index];
+    }
+  }
+  Py_XDECREF(decoded);
+  return JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(text.data(), text.size()));
+}
+
+/**
+ * @brief Get the entry point of a package from the `module` or `main` field of its package.json
+ */
+static std::string packageEntryPoint(JSContext *cx, const std::filesystem::path &directory) {
+  std::string packageJson = (directory / "package.json").string();
+  if (!isFile(ModuleLoader::statMode(packageJson))) {
+    return std::string();
+  }
+  JS::RootedString contents(cx, ModuleLoader::readFile(cx, packageJson));
+  JS::RootedValue package(cx);
+  if (!contents || !JS_ParseJSON(cx, contents, &package) || !package.isObject()) {
+    JS_ClearPendingException(cx); // an invalid package.json is ignored, like a missing one
+    return std::string();
+  }
+  JS::RootedObject packageObject(cx, &package.toObject());
+  JS::RootedValue entryPoint(cx);
+  for (const char *field : {"module", "main"}) {
+    if (!JS_GetProperty(cx, packageObject, field, &entryPoint)) {
+      JS_ClearPendingException(cx);
+      return std::string();
+    }
+    if (entryPoint.isString()) {
+      JS::RootedString entryPointString(cx, entryPoint.toString());
+      JS::UniqueChars chars = JS_EncodeStringToUTF8(cx, entryPointString);
+      return chars ? std::string(chars.get()) : std::string();
+    }
+  }
+  return std::string();
+}
+
+/**
+ * @brief Find the file of a module: the exact path, then with the .mjs and .js extensions, then the entry point or index of a directory
+ */
+static std::string resolveFile(JSContext *cx, const std::filesystem::path &candidate) {
+  std::string path = candidate.lexically_normal().string();
+  for (const char *extension : {"", ".mjs", ".js"}) {
+    if (isFile(ModuleLoader::statMode(path + extension))) {
+      return path + extension;
+    }
+  }
+  if (!isDirectory(ModuleLoader::statMode(path))) {
+    return std::string();
+  }
+
+  std::string entryPoint = packageEntryPoint(cx, candidate);
+  if (!entryPoint.empty()) {
+    std::string resolved = resolveFile(cx, candidate / entryPoint);
+    if (!resolved.empty()) {
+      return resolved;
+    }
+  }
+  for (const char *index : {"index.mjs", "index.js"}) {
+    std::string indexPath = (candidate / index).lexically_normal().string();
+    if (isFile(ModuleLoader::statMode(indexPath))) {
+      return indexPath;
+    }
+  }
+  return std::string();
+}
+
+/**
+ * @brief Resolve the specifier of an import: paths are relative to the importing module, bare specifiers are searched in the node_modules directories above it
+ */
+static std::string resolveSpecifier(JSContext *cx, std::string specifier, const std::filesystem::path &baseDirectory) {
+  if (specifier.rfind("file://", 0) == 0) {
+    specifier.erase(0, 7);
+  }
+  std::filesystem::path specifierPath(specifier);
+  if (specifierPath.is_absolute() || specifier.rfind("./", 0) == 0 || specifier.rfind("../", 0) == 0 || specifier == "." || specifier == "..") {
+    return resolveFile(cx, baseDirectory / specifierPath);
+  }
+
+  for (std::filesystem::path directory = baseDirectory;; directory = directory.parent_path()) {
+    if (directory.filename() != "node_modules") {
+      std::string resolved = resolveFile(cx, directory / "node_modules" / specifierPath);
+      if (!resolved.empty()) {
+        return resolved;
+      }
+    }
+    if (directory == directory.parent_path()) {
+      return std::string();
+    }
+  }
+}
+
+/**
+ * @brief Get the directory of the importing module from its private value, its filename, or the current directory for scripts
+ */
+static std::filesystem::path referrerDirectory(JSContext *cx, JS::HandleValue referencingPrivate) {
+  std::error_code error;
+  if (referencingPrivate.isString()) {
+    JS::RootedString filenameString(cx, referencingPrivate.toString());
+    JS::UniqueChars filename = JS_EncodeStringToUTF8(cx, filenameString);
+    if (filename) {
+      std::filesystem::path directory = std::filesystem::absolute(filename.get(), error).parent_path();
+      if (!error && isDirectory(ModuleLoader::statMode(directory.string()))) {
+        return directory;
+      }
+    }
+    JS_ClearPendingException(cx);
+  }
+  return std::filesystem::current_path(error);
+}
+
+static JSObject *resolveHook(JSContext *cx, JS::HandleValue referencingPrivate, JS::HandleObject moduleRequest) {
+  JS::RootedString specifierString(cx, JS::GetModuleRequestSpecifier(cx, moduleRequest));
+  if (!specifierString) {
+    return nullptr;
+  }
+  JS::UniqueChars specifier = JS_EncodeStringToUTF8(cx, specifierString);
+  if (!specifier) {
+    return nullptr;
+  }
+
+  std::filesystem::path baseDirectory = referrerDirectory(cx, referencingPrivate);
+  std::string path = RequireCache::getResolution("import", baseDirectory.string(), "", specifier.get());
+  if (path.empty()) {
+    path = resolveSpecifier(cx, specifier.get(), baseDirectory);
+    if (!path.empty()) {
+      RequireCache::setResolution("import", baseDirectory.string(), "", specifier.get(), path);
+    }
+  }
+  if (path.empty()) {
+    JS_ReportErrorUTF8(cx, "Cannot find module '%s' imported from %s", specifier.get(), baseDirectory.string().c_str());
+    return nullptr;
+  }
+  return ModuleLoader::loadModule(cx, path);
+}
+
+static bool dynamicImportHook(JSContext *cx, JS::HandleValue referencingPrivate, JS::HandleObject moduleRequest, JS::HandleObject promise) {
+  JS::RootedObject module(cx, resolveHook(cx, referencingPrivate, moduleRequest));
+  JS::RootedObject evaluationPromise(cx);
+  JS::RootedValue rval(cx);
+  if (module && JS::ModuleLink(cx, module) && JS::ModuleEvaluate(cx, module, &rval) && rval.isObject()) {
+    evaluationPromise = &rval.toObject();
+  }
+  // rejects the import with the pending exception if there is no evaluation promise
+  return JS::FinishDynamicModuleImport(cx, evaluationPromise, referencingPrivate, moduleRequest, promise);
+}
+
+static bool metadataHook(JSContext *cx, JS::HandleValue privateValue, JS::HandleObject metaObject) {
+  if (!privateValue.isString()) {
+    return true;
+  }
+  JS::RootedString filename(cx, privateValue.toString());
+  JS::RootedString scheme(cx, JS_NewStringCopyZ(cx, "file://"));
+  if (!scheme) {
+    return false;
+  }
+  JS::RootedString url(cx, JS_ConcatStrings(cx, scheme, filename));
+  return url &&
+         JS_DefineProperty(cx, metaObject, "url", url, JSPROP_ENUMERATE) &&
+         JS_DefineProperty(cx, metaObject, "filename", filename, JSPROP_ENUMERATE);
+}
+
+bool ModuleLoader::init(JSContext *cx) {
+  JSRuntime *rt = JS_GetRuntime(cx);
+  JS::SetModuleResolveHook(rt, resolveHook);
+  JS::SetModuleDynamicImportHook(rt, dynamicImportHook);
+  JS::SetModuleMetadataHook(rt, metadataHook);
+  RequireCache::init();
+  return true;
+}
+
+void ModuleLoader::finalize() {
+  for (auto &[path, module] : modules) {
+    delete module;
+  }
+  modules.clear();
+  RequireCache::finalize();
+}
+
+JSObject *ModuleLoader::compileModule(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length) {
+  JS::RootedObject module(cx, StencilCache::compileModule(cx, options, chars, length));
+  if (!module) {
+    return nullptr;
+  }
+  const char *filename = options.filename().c_str();
+  if (filename) {
+    JSString *filenameString = JS_NewStringCopyUTF8Z(cx, JS::ConstUTF8CharsZ(filename, strlen(filename)));
+    if (!filenameString) {
+      return nullptr;
+    }
+    JS::SetModulePrivate(module, JS::StringValue(filenameString));
+  }
+  return module;
+}
+
+JSObject *ModuleLoader::loadModule(JSContext *cx, const std::string &path) {
+  std::error_code error;
+  std::string absolutePath = std::filesystem::absolute(path, error).lexically_normal().string();
+  if (error) {
+    absolutePath = path;
+  }
+  auto found = modules.find(absolutePath);
+  if (found != modules.end()) {
+    return *found->second;
+  }
+
+  MappedFile file(absolutePath);
+  if (!file.ok()) {
+    JS_ReportErrorUTF8(cx, "Cannot find module '%s'", absolutePath.c_str());
+    return nullptr;
+  }
+  JS::CompileOptions options(cx);
+  options.setFileAndLine(absolutePath.c_str(), 1);
+  JS::RootedObject module(cx, compileModule(cx, options, file.data(), file.size()));
+  if (!module) {
+    return nullptr;
+  }
+  modules[absolutePath] = new JS::PersistentRootedObject(cx, module);
+  return module;
+}
+
+JSObject *ModuleLoader::evaluateModule(JSContext *cx, JS::HandleObject module) {
+  if (!JS::ModuleLink(cx, module)) {
+    return nullptr;
+  }
+  JS::RootedValue rval(cx);
+  if (!JS::ModuleEvaluate(cx, module, &rval)) {
+    return nullptr;
+  }
+  if (rval.isObject()) { // the evaluation promise, already settled unless the module uses top-level await
+    JS::RootedObject promise(cx, &rval.toObject());
+    if (JS::IsPromiseObject(promise) && JS::GetPromiseState(promise) == JS::PromiseState::Rejected) {
+      JS::SetSettledPromiseIsHandled(cx, promise);
+      JS::RootedValue reason(cx, JS::GetPromiseResult(promise));
+      JS_SetPendingException(cx, reason);
+      return nullptr;
+    }
+  }
+  return JS::GetModuleNamespace(cx, module);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file Prefork.cc
+ * @author agent (agent@local)
+ * @brief Make the JS runtime safe to fork, so that a warmed-up process can fork workers sharing its heaps copy-on-write
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/Prefork.hh"
+
+#include "include/modules/pythonmonkey/pythonmonkey.hh"
+#include "include/ContextOwner.hh"
+#include "include/HelperThreads.hh"
+#include "include/JSWorker.hh"
+#include "include/Profiler.hh"
+#include "include/Watchdog.hh"
+
+#include <jsapi.h>
+#include <js/GCAPI.h>
+
+#include <Python.h>
+
+static PyObject *beforeFork(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
+  // the background sweeping of an incremental GC would otherwise be left half-done in the child
+  if (ContextOwner::check()) {
+    if (JS::IsIncrementalGCInProgress(GLOBAL_CX)) {
+      JS::FinishIncrementalGC(GLOBAL_CX, JS::GCReason::API);
+    }
+  } else {
+    PyErr_Clear(); // forking from another thread of a free-threaded build, the GC can't be finished from here
+  }
+  HelperThreads::quiesce();
+  Watchdog::prepareFork();
+  JobQueue::prepareFork();
+  Py_RETURN_NONE;
+}
+
+static PyObject *afterForkInParent(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
+  JobQueue::afterFork(false);
+  Watchdog::afterFork(false);
+  if (!HelperThreads::restart()) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *afterForkInChild(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
+  JobQueue::afterFork(true);
+  Watchdog::afterFork(true);
+  if (!HelperThreads::restart()) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyMethodDef beforeForkDef = {"beforeFork", beforeFork, METH_NOARGS, NULL};
+static PyMethodDef afterForkInParentDef = {"afterForkInParent", afterForkInParent, METH_NOARGS, NULL};
+static PyMethodDef afterForkInChildDef = {"afterForkInChild", afterForkInChild, METH_NOARGS, NULL};
+
+bool Prefork::init() {
+  PyObject *os = PyImport_ImportModule("os");
+  if (!os) {
+    return false;
+  }
+  PyObject *registerAtFork = PyObject_GetAttrString(os, "register_at_fork");
+  Py_DECREF(os);
+  if (!registerAtFork) {
+    PyErr_Clear(); // Windows
+    return true;
+  }
+
+  PyObject *args = PyTuple_New(0);
+  PyObject *kwargs = Py_BuildValue("{s:N,s:N,s:N}",
+    "before", PyCFunction_New(&beforeForkDef, NULL),
+    "after_in_parent", PyCFunction_New(&afterForkInParentDef, NULL),
+    "after_in_child", PyCFunction_New(&afterForkInChildDef, NULL));
+  PyObject *ret = args && kwargs ? PyObject_Call(registerAtFork, args, kwargs) : NULL;
+  Py_XDECREF(args);
+  Py_XDECREF(kwargs);
+  Py_DECREF(registerAtFork);
+  Py_XDECREF(ret);
+  return ret != NULL;
+}
+
+bool Prefork::prepare(JSContext *cx, JobQueue *jobQueue) {
+  if (!ContextOwner::check()) {
+    return false;
+  }
+  size_t workers = JSWorkerMethodDefinitions::running();
+  if (workers) {
+    PyErr_Format(PyExc_RuntimeError, "pythonmonkey.prefork: %zu Worker(s) still running, their threads would not be in the forked processes", workers);
+    return false;
+  }
+  if (Profiler::active) {
+    PyErr_SetString(PyExc_RuntimeError, "pythonmonkey.prefork: the profiler is running, its sampler thread would not be in the forked processes");
+    return false;
+  }
+
+  if (!jobQueue->empty() && !jobQueue->drain(cx)) {
+    return false;
+  }
+
+  // compacting moves the live objects together, the children then dirty fewer of the pages they share with the parent
+  JS::PrepareForFullGC(cx);
+  JS::NonIncrementalGC(cx, JS::GCOptions::Shrink, JS::GCReason::API);
+
+  // the Python cyclic GC of the children would otherwise write to the headers of all the objects inherited from the parent
+  PyGC_Collect();
+  PyObject *gc = PyImport_ImportModule("gc");
+  PyObject *ret = gc ? PyObject_CallMethod(gc, "freeze", NULL) : NULL;
+  Py_XDECREF(gc);
+  Py_XDECREF(ret);
+  return ret != NULL;
+}
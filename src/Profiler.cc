@@ -0,0 +1,365 @@
+/**
+ * @file Profiler.cc
+ * @author agent (agent@local)
+ * @brief Sampling CPU profiler of the JS code and of the bridge between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/Profiler.hh"
+
+#include <jsapi.h>
+#include <js/ProfilingFrameIterator.h>
+#include <js/ProfilingStack.h>
+
+#include <Python.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+bool Profiler::active = false;
+
+static JSContext *profiledCx = nullptr;
+static std::thread::id profiledThread;
+// set once and kept, the label frames pushed while the profiler ran are popped after it stops
+static js::ProfilingStack *profilingStack = nullptr;
+static bool interruptCallbackAdded = false;
+
+// the ticks of the sampler thread not recorded yet
+static std::atomic<uint32_t> pendingTicks(0);
+
+static std::thread samplerThread;
+static std::mutex samplerMutex;
+static std::condition_variable samplerWakeup;
+static bool samplerStopping = false;
+static std::chrono::microseconds samplingInterval;
+
+/**
+ * @brief A node of the call tree: the frames of a stack, from the root
+ */
+struct ProfileNode {
+  std::string frame;
+  bool native;
+  size_t parent;
+  uint64_t hitCount = 0;
+  std::unordered_map<std::string, size_t> children;
+  std::vector<size_t> childOrder; // in the order they were first sampled
+};
+
+static std::deque<ProfileNode> nodes;
+static std::vector<size_t> samples; // the ids of the sampled leaves
+static std::vector<int64_t> timeDeltas; // in microseconds, from the previous sample
+static std::chrono::steady_clock::time_point startTime;
+static std::chrono::steady_clock::time_point lastSampleTime;
+
+static size_t childNode(size_t parent, const std::string &frame, bool native) {
+  auto found = nodes[parent].children.find(frame);
+  if (found != nodes[parent].children.end()) {
+    return found->second;
+  }
+  size_t id = nodes.size();
+  nodes.push_back(ProfileNode{frame, native, parent});
+  nodes[parent].children.emplace(frame, id);
+  nodes[parent].childOrder.push_back(id);
+  return id;
+}
+
+struct SampledFrame {
+  std::string frame;
+  bool native;
+};
+
+/**
+ * @brief The current stack of the profiled context, outermost frame first
+ */
+static std::vector<SampledFrame> currentStack() {
+  // the JIT frames, innermost first
+  struct JitFrame {
+    const char *label;
+    void *stackAddress;
+  };
+  std::vector<JitFrame> jitFrames;
+  const uint32_t maxFramesPerIteration = 16;
+  JS::ProfilingFrameIterator::Frame extracted[maxFramesPerIteration];
+  // without register state, the iterator starts from the last JIT frame that the profiler instrumentation recorded
+  for (JS::ProfilingFrameIterator iterator(profiledCx, JS::ProfilingFrameIterator::RegisterState()); !iterator.done(); ++iterator) {
+    uint32_t count = iterator.extractStack(extracted, 0, maxFramesPerIteration);
+    for (uint32_t index = 0; index < count; index++) {
+      if (extracted[index].label) {
+        jitFrames.push_back({extracted[index].label, extracted[index].stackAddress});
+      }
+    }
+  }
+
+  // merge them with the frames of the profiling stack, which grows towards lower addresses like the native stack:
+  // the JS frames of the profiling stack are interpreted frames, inner to the label frame below them
+  std::vector<SampledFrame> stack;
+  uint32_t size = std::min(profilingStack->stackSize(), profilingStack->stackCapacity());
+  uintptr_t lastLabelAddress = UINTPTR_MAX;
+  size_t jitIndex = jitFrames.size();
+  for (uint32_t index = 0; index < size;) {
+    const js::ProfilingStackFrame &frame = profilingStack->frames[index];
+    uintptr_t address = frame.isJsFrame() ? lastLabelAddress : (uintptr_t)frame.stackAddress();
+    if (jitIndex > 0 && (uintptr_t)jitFrames[jitIndex - 1].stackAddress > address) {
+      jitIndex--;
+      stack.push_back({jitFrames[jitIndex].label, false});
+      continue;
+    }
+    index++;
+    if (frame.isOSRFrame()) { // the interpreted frame went on in JIT code, its JIT frame stands for it
+      continue;
+    }
+    if (frame.isJsFrame()) {
+      stack.push_back({frame.dynamicString() ? frame.dynamicString() : frame.label(), false});
+    } else {
+      lastLabelAddress = address;
+      stack.push_back({frame.label(), true});
+    }
+  }
+  while (jitIndex > 0) {
+    jitIndex--;
+    stack.push_back({jitFrames[jitIndex].label, false});
+  }
+  return stack;
+}
+
+void Profiler::sample() {
+  uint32_t ticks = pendingTicks.exchange(0);
+  if (ticks == 0 || !active || std::this_thread::get_id() != profiledThread) {
+    return;
+  }
+
+  size_t leaf = 0; // the root
+  std::vector<SampledFrame> stack = currentStack();
+  if (stack.empty()) {
+    leaf = childNode(0, "(program)", true);
+  }
+  for (const SampledFrame &frame : stack) {
+    leaf = childNode(leaf, frame.frame, frame.native);
+  }
+  nodes[leaf].hitCount += ticks;
+
+  // one sample per tick: the ticks recorded late are spread back from now at the sampling interval
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - lastSampleTime).count();
+  int64_t interval = samplingInterval.count();
+  int64_t first = std::max<int64_t>(elapsed - interval * (ticks - 1), 0);
+  for (uint32_t tick = 0; tick < ticks; tick++) {
+    samples.push_back(leaf);
+    timeDeltas.push_back(tick == 0 ? first : interval);
+  }
+  lastSampleTime = now;
+}
+
+bool Profiler::pushLabel(const char *label, void *stackAddress) {
+  if (std::this_thread::get_id() != profiledThread) { // e.g. a worker
+    return false;
+  }
+  if (pendingTicks.load(std::memory_order_relaxed)) {
+    sample(); // the ticks up to here belong to the stack below the label
+  }
+  profilingStack->pushLabelFrame(label, nullptr, stackAddress, JS::ProfilingCategoryPair::OTHER);
+  return true;
+}
+
+void Profiler::popLabel() {
+  if (pendingTicks.load(std::memory_order_relaxed)) {
+    sample(); // e.g. the time a Python function called from JS took
+  }
+  profilingStack->pop();
+}
+
+static bool sampleOnInterrupt(JSContext *cx) {
+  if (cx == profiledCx) {
+    Profiler::sample();
+  }
+  return true;
+}
+
+static void samplerLoop() {
+  std::unique_lock<std::mutex> lock(samplerMutex);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  for (;;) {
+    next += samplingInterval;
+    if (samplerWakeup.wait_until(lock, next, [] { return samplerStopping; })) {
+      return;
+    }
+    if (pendingTicks.fetch_add(1) == 0) {
+      JS_RequestInterruptCallback(profiledCx); // may be called from any thread
+    }
+  }
+}
+
+bool Profiler::start(JSContext *cx, double interval) {
+  if (active) {
+    PyErr_SetString(PyExc_RuntimeError, "the profiler is already running");
+    return false;
+  }
+  if (!(interval > 0)) {
+    PyErr_SetString(PyExc_ValueError, "the sampling interval must be > 0");
+    return false;
+  }
+  if (!profilingStack) {
+    profilingStack = new js::ProfilingStack();
+    js::SetContextProfilingStack(cx, profilingStack);
+  }
+  if (!interruptCallbackAdded) {
+    if (!JS_AddInterruptCallback(cx, sampleOnInterrupt)) {
+      PyErr_NoMemory();
+      return false;
+    }
+    interruptCallbackAdded = true;
+  }
+
+  profiledCx = cx;
+  profiledThread = std::this_thread::get_id();
+  samplingInterval = std::max(std::chrono::microseconds((int64_t)(interval * 1e6)), std::chrono::microseconds(10));
+  nodes.clear();
+  nodes.push_back(ProfileNode{"(root)", true, 0});
+  samples.clear();
+  timeDeltas.clear();
+  startTime = lastSampleTime = std::chrono::steady_clock::now();
+  pendingTicks = 0;
+
+  js::EnableContextProfilingStack(cx, true); // also instruments the JIT code, discarding the code compiled so far
+  active = true;
+  samplerStopping = false;
+  samplerThread = std::thread(samplerLoop);
+  return true;
+}
+
+static void stopSampler() {
+  {
+    std::lock_guard<std::mutex> lock(samplerMutex);
+    samplerStopping = true;
+  }
+  samplerWakeup.notify_all();
+  if (samplerThread.joinable()) {
+    samplerThread.join();
+  }
+  Profiler::active = false;
+  js::EnableContextProfilingStack(profiledCx, false);
+  pendingTicks = 0;
+}
+
+static void appendJsonString(std::string &json, const std::string &value) {
+  json += '"';
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+      json += (char)c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json += escaped;
+    } else {
+      json += (char)c;
+    }
+  }
+  json += '"';
+}
+
+/**
+ * @brief Split a JS frame label of SpiderMonkey, `name (url:line:column)` or `url:line:column`, into the fields of a call frame
+ */
+static void parseFrame(const std::string &frame, std::string &functionName, std::string &url, long &line, long &column) {
+  std::string location = frame;
+  functionName.clear();
+  size_t open = frame.rfind(" (");
+  if (open != std::string::npos && frame.back() == ')') {
+    functionName = frame.substr(0, open);
+    location = frame.substr(open + 2, frame.size() - open - 3);
+  }
+  url = location;
+  line = column = -1;
+  size_t columnSeparator = location.rfind(':');
+  size_t lineSeparator = columnSeparator == std::string::npos || columnSeparator == 0 ? std::string::npos : location.rfind(':', columnSeparator - 1);
+  if (lineSeparator != std::string::npos) {
+    char *end;
+    long parsedLine = strtol(location.c_str() + lineSeparator + 1, &end, 10);
+    if (*end == ':') {
+      long parsedColumn = strtol(end + 1, &end, 10);
+      if (*end == '\0') {
+        url = location.substr(0, lineSeparator);
+        line = parsedLine - 1; // the call frames of the format are 0-based
+        column = parsedColumn - 1;
+      }
+    }
+  }
+}
+
+static std::string profileJson() {
+  std::unordered_map<std::string, size_t> scriptIds;
+  std::string json = "{\"nodes\":[";
+  for (size_t id = 0; id < nodes.size(); id++) {
+    const ProfileNode &node = nodes[id];
+    std::string functionName = node.frame, url;
+    long line = -1, column = -1;
+    if (!node.native) {
+      parseFrame(node.frame, functionName, url, line, column);
+    }
+    size_t scriptId = url.empty() ? 0 : scriptIds.emplace(url, scriptIds.size() + 1).first->second;
+
+    json += id == 0 ? "" : ",";
+    json += "{\"id\":" + std::to_string(id + 1) + ",\"callFrame\":{\"functionName\":";
+    appendJsonString(json, functionName);
+    json += ",\"scriptId\":\"" + std::to_string(scriptId) + "\",\"url\":";
+    appendJsonString(json, url);
+    json += ",\"lineNumber\":" + std::to_string(line) + ",\"columnNumber\":" + std::to_string(column) + "}";
+    json += ",\"hitCount\":" + std::to_string(node.hitCount) + ",\"children\":[";
+    for (size_t index = 0; index < node.childOrder.size(); index++) {
+      json += (index ? "," : "") + std::to_string(node.childOrder[index] + 1);
+    }
+    json += "]}";
+  }
+
+  int64_t start = std::chrono::duration_cast<std::chrono::microseconds>(startTime.time_since_epoch()).count();
+  int64_t end = std::chrono::duration_cast<std::chrono::microseconds>(lastSampleTime.time_since_epoch()).count();
+  json += "],\"startTime\":" + std::to_string(start) + ",\"endTime\":" + std::to_string(end) + ",\"samples\":[";
+  for (size_t index = 0; index < samples.size(); index++) {
+    json += (index ? "," : "") + std::to_string(samples[index] + 1);
+  }
+  json += "],\"timeDeltas\":[";
+  for (size_t index = 0; index < timeDeltas.size(); index++) {
+    json += (index ? "," : "") + std::to_string(timeDeltas[index]);
+  }
+  json += "]}";
+  return json;
+}
+
+PyObject *Profiler::stop() {
+  if (!active) {
+    PyErr_SetString(PyExc_RuntimeError, "the profiler is not running");
+    return NULL;
+  }
+  sample(); // the ticks of the calls up to here
+  stopSampler();
+  lastSampleTime = std::max(lastSampleTime, startTime);
+  std::string json = profileJson();
+  nodes.clear();
+  std::vector<size_t>().swap(samples);
+  std::vector<int64_t>().swap(timeDeltas);
+  return PyUnicode_FromStringAndSize(json.data(), json.size());
+}
+
+void Profiler::finalize() {
+  if (active) {
+    stopSampler();
+  }
+  nodes.clear();
+  std::vector<size_t>().swap(samples);
+  std::vector<int64_t>().swap(timeDeltas);
+}
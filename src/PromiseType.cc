@@ -11,12 +11,16 @@
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
 #include "include/PromiseType.hh"
 #include "include/DictType.hh"
+#include "include/Metrics.hh"
 #include "include/PyEventLoop.hh"
+#include "include/ProxyCache.hh"
 #include "include/pyTypeFactory.hh"
 #include "include/jsTypeFactory.hh"
+#include "include/PyIterableProxyHandler.hh"
 
 #include <jsapi.h>
 #include <jsfriendapi.h>
+#include <js/GCHashTable.h>
 #include <js/Promise.h>
 
 #include <Python.h>
@@ -26,19 +30,51 @@
 #define PY_FUTURE_OBJ_SLOT 0
 #define PROMISE_OBJ_SLOT 1
 
-static bool onResolvedCb(JSContext *cx, unsigned argc, JS::Value *vp) {
-  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
-
+/**
+ * @brief Settle the Python asyncio.Future of a reaction of a JS Promise by the Promise's result
+ *
+ * @param iteratorResult - whether the Promise's fulfilled value is an iterator result `{value, done}`, settling the Future by its value,
+ * or with StopAsyncIteration once done
+ */
+static bool settleFuture(JSContext *cx, JS::CallArgs &args, bool iteratorResult) {
   // Get the Promise state
   JS::Value promiseObjVal = js::GetFunctionNativeReserved(&args.callee(), PROMISE_OBJ_SLOT);
   JS::RootedObject promise(cx, &promiseObjVal.toObject());
-  JS::PromiseState state = JS::GetPromiseState(promise);
+  bool fulfilled = JS::GetPromiseState(promise) == JS::PromiseState::Fulfilled;
+
+  // Get the `asyncio.Future` Python object from function's reserved slot
+  JS::Value futureObjVal = js::GetFunctionNativeReserved(&args.callee(), PY_FUTURE_OBJ_SLOT);
+  PyObject *futureObj = (PyObject *)(futureObjVal.toPrivate());
+  PyEventLoop::Future future = PyEventLoop::Future(futureObj); // will decrease the reference count of `futureObj` in its destructor when the callback ends
+  Metrics::promisesAwaitedByFutures--;
+
+  JS::RootedValue resultArg(cx, args[0]);
+  if (iteratorResult && fulfilled) {
+    JS::RootedValue done(cx);
+    if (!resultArg.isObject()) {
+      JS_ReportErrorASCII(cx, "the iterator result is not an object");
+    } else {
+      JS::RootedObject iteratorResultObj(cx, &resultArg.toObject());
+      if (JS_GetProperty(cx, iteratorResultObj, "done", &done) && !JS::ToBoolean(done)) {
+        JS_GetProperty(cx, iteratorResultObj, "value", &resultArg);
+      }
+    }
+    if (JS_IsExceptionPending(cx)) { // reading the iterator result threw, the Future raises it instead
+      fulfilled = false;
+      JS_GetPendingException(cx, &resultArg);
+      JS_ClearPendingException(cx);
+    } else if (JS::ToBoolean(done)) {
+      PyObject *stop = PyObject_CallObject(PyExc_StopAsyncIteration, NULL);
+      future.setException(stop);
+      Py_XDECREF(stop);
+      return true;
+    }
+  }
 
   // Convert the Promise's result (either fulfilled resolution or rejection reason) to a Python object
   //  The result might be another JS function, so we must keep them alive
-  JS::RootedValue resultArg(cx, args[0]);
   PyObject *result = pyTypeFactory(cx, resultArg);
-  if (state == JS::PromiseState::Rejected && !PyExceptionInstance_Check(result)) {
+  if (!fulfilled && !PyExceptionInstance_Check(result)) {
     // Wrap the result object into a SpiderMonkeyError object
     // because only *Exception objects can be thrown in Python `raise` statement and alike
     PyObject *wrapped = PyObject_CallOneArg(SpiderMonkeyError, result); // wrapped = SpiderMonkeyError(result)
@@ -49,15 +85,10 @@ static bool onResolvedCb(JSContext *cx, unsigned argc, JS::Value *vp) {
     result = wrapped;
   }
 
-  // Get the `asyncio.Future` Python object from function's reserved slot
-  JS::Value futureObjVal = js::GetFunctionNativeReserved(&args.callee(), PY_FUTURE_OBJ_SLOT);
-  PyObject *futureObj = (PyObject *)(futureObjVal.toPrivate());
-
   // Settle the Python asyncio.Future by the Promise's result
-  PyEventLoop::Future future = PyEventLoop::Future(futureObj); // will decrease the reference count of `futureObj` in its destructor when the `onResolvedCb` function ends
-  if (state == JS::PromiseState::Fulfilled) {
+  if (fulfilled) {
     future.setResult(result);
-  } else { // state == JS::PromiseState::Rejected
+  } else {
     future.setException(result);
   }
 
@@ -66,33 +97,116 @@ static bool onResolvedCb(JSContext *cx, unsigned argc, JS::Value *vp) {
   return true;
 }
 
-PyObject *PromiseType::getPyObject(JSContext *cx, JS::HandleObject promise) {
+static bool onResolvedCb(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return settleFuture(cx, args, false);
+}
+
+static bool onIteratorResultCb(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return settleFuture(cx, args, true);
+}
+
+/**
+ * @brief Create a Python asyncio.Future settled by a reaction of a JS Promise
+ */
+static PyObject *promiseToFuture(JSContext *cx, JS::HandleObject promise, JSNative onSettled) {
   // Create a python asyncio.Future on the running python event-loop
   PyEventLoop loop = PyEventLoop::getRunningLoop();
   if (!loop.initialized()) return NULL;
   PyEventLoop::Future future = loop.createFuture(); // ref count == 1
 
-  // Callbacks to settle the Python asyncio.Future once the JS Promise is resolved
-  JS::RootedObject onResolved = JS::RootedObject(cx, (JSObject *)js::NewFunctionWithReserved(cx, onResolvedCb, 1, 0, NULL));
+  // One function settles the Python asyncio.Future whether the JS Promise is fulfilled or rejected,
+  //    a reaction is only called with the Promise's result, so the Future and the Promise are kept in its reserved slots
+  JS::RootedObject onResolved = JS::RootedObject(cx, (JSObject *)js::NewFunctionWithReserved(cx, onSettled, 1, 0, NULL));
   js::SetFunctionNativeReserved(onResolved, PY_FUTURE_OBJ_SLOT, JS::PrivateValue(future.getFutureObject())); // ref count == 2
   js::SetFunctionNativeReserved(onResolved, PROMISE_OBJ_SLOT, JS::ObjectValue(*promise));
   JS::AddPromiseReactions(cx, promise, onResolved, onResolved);
+  Metrics::promisesAwaitedByFutures++;
 
   return future.getFutureObject(); // must be a new reference, ref count == 3
-  // Here the ref count for the `future` object is 3, but will immediately decrease to 2 in `PyEventLoop::Future`'s destructor when the `PromiseType::getPyObject` function ends
+  // Here the ref count for the `future` object is 3, but will immediately decrease to 2 in `PyEventLoop::Future`'s destructor when the function ends
   // Leaving one reference for the returned Python object, and another one for the `onResolved` callback function
 }
 
-// Callback to resolve or reject the JS Promise when the Future is done
-static PyObject *futureOnDoneCallback(PyObject *futureCallbackTuple, PyObject *args) {
-  JSContext *cx = (JSContext *)PyLong_AsVoidPtr(PyTuple_GetItem(futureCallbackTuple, 0));
-  JS::PersistentRootedObject *rootedPtr = (JS::PersistentRootedObject *)PyLong_AsVoidPtr(PyTuple_GetItem(futureCallbackTuple, 1));
-  JS::HandleObject promise = *rootedPtr;
-  PyObject *futureObj = PyTuple_GetItem(args, 0); // the callback is called with the Future object as its only argument
-                                                  // see https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.add_done_callback
-  PyEventLoop::Future future = PyEventLoop::Future(futureObj);
+PyObject *PromiseType::getPyObject(JSContext *cx, JS::HandleObject promise) {
+  return promiseToFuture(cx, promise, onResolvedCb);
+}
+
+PyObject *PromiseType::getIteratorValuePyObject(JSContext *cx, JS::HandleObject promise) {
+  return promiseToFuture(cx, promise, onIteratorResultCb);
+}
+
+// asyncio.Future -> the JS Promise to settle once it is done, the table owns a reference to each Future
+using FutureToPromiseMap = JS::GCHashMap<PyObject *, JSObject *, mozilla::DefaultHasher<PyObject *>, js::SystemAllocPolicy>;
+
+// one rooted table for all the pending Promises, instead of a heap-allocated root per Promise
+static JS::PersistentRooted<FutureToPromiseMap> *pendingPromises = nullptr;
+
+// the pending Promises of the iterator results of async iterators, settled with `{value, done}`
+static JS::PersistentRooted<FutureToPromiseMap> *pendingIteratorResults = nullptr;
+
+bool PromiseType::init(JSContext *cx) {
+  pendingPromises = new JS::PersistentRooted<FutureToPromiseMap>(cx);
+  pendingIteratorResults = new JS::PersistentRooted<FutureToPromiseMap>(cx);
+  return pendingPromises != nullptr && pendingIteratorResults != nullptr;
+}
+
+static void destroyPendingTable(JS::PersistentRooted<FutureToPromiseMap> *&table) {
+  if (!table) {
+    return;
+  }
+  if (!Py_IsFinalizing()) {
+    for (auto iter = table->get().iter(); !iter.done(); iter.next()) {
+      Py_DECREF(iter.get().key());
+    }
+  }
+  delete table;
+  table = nullptr;
+}
+
+void PromiseType::finalize() {
+  destroyPendingTable(pendingPromises);
+  destroyPendingTable(pendingIteratorResults);
+}
+
+/**
+ * @brief Resolve a JS Promise with a value, or with the iterator result `{value, done: false}` of it
+ */
+static void resolvePromise(JSContext *cx, JS::HandleObject promise, JS::HandleValue value, bool iteratorResult) {
+  if (!iteratorResult) {
+    JS::ResolvePromise(cx, promise, value);
+    return;
+  }
+  JS::RootedObject result(cx, PyIterableProxyHandler::newIteratorResult(cx, value, false));
+  if (result) {
+    JS::ResolvePromise(cx, promise, JS::RootedValue(cx, JS::ObjectValue(*result)));
+  }
+}
+
+/**
+ * @brief Resolve or reject the JS Promise of a table when its Future is done
+ *
+ * @param table - the table of pending Promises the Future is in
+ * @param futureObj - the Future
+ * @param iteratorResult - whether the Promise is settled with an iterator result, `{done: true}` once the Future raised StopAsyncIteration
+ */
+static void settlePromise(JS::PersistentRooted<FutureToPromiseMap> *table, PyObject *futureObj, bool iteratorResult) {
+  if (!table) {
+    return;
+  }
+  auto ptr = table->get().lookup(futureObj);
+  if (!ptr) {
+    return;
+  }
+
+  JSContext *cx = GLOBAL_CX;
+  JS::RootedObject promise(cx, ptr->value());
+  table->get().remove(ptr);
+  PyEventLoop::Future future = PyEventLoop::Future(futureObj); // takes over the reference owned by the table
 
   PyEventLoop::_locker->decCounter();
+  Metrics::awaitablesAwaitedByPromises--;
 
   PyObject *exception = future.getException();
   if (exception == NULL || PyErr_Occurred()) { // awaitable is cancelled, `futureObj.exception()` raises a CancelledError
@@ -104,40 +218,81 @@ static PyObject *futureOnDoneCallback(PyObject *futureCallbackTuple, PyObject *a
     Py_XDECREF(errType); Py_XDECREF(errValue); Py_XDECREF(traceback);
   } else if (exception == Py_None) { // no exception set on this awaitable, safe to get result, otherwise the exception will be raised when calling `futureObj.result()`
     PyObject *result = future.getResult();
-    JS::ResolvePromise(cx, promise, JS::RootedValue(cx, jsTypeFactorySafe(cx, result)));
+    resolvePromise(cx, promise, JS::RootedValue(cx, jsTypeFactorySafe(cx, result)), iteratorResult);
     Py_DECREF(result);
+  } else if (iteratorResult && PyErr_GivenExceptionMatches(exception, PyExc_StopAsyncIteration)) { // the async iterator is exhausted
+    JS::RootedObject result(cx, PyIterableProxyHandler::newIteratorResult(cx, JS::UndefinedHandleValue, true));
+    if (result) {
+      JS::ResolvePromise(cx, promise, JS::RootedValue(cx, JS::ObjectValue(*result)));
+    }
   } else { // having exception set, to reject the promise
     JS::RejectPromise(cx, promise, JS::RootedValue(cx, jsTypeFactorySafe(cx, exception)));
   }
   Py_XDECREF(exception); // cleanup
+}
 
-  delete rootedPtr; // no longer needed to be rooted, clean it up
-
-  // Py_DECREF(futureObj) // would cause bug, because `Future` constructor didn't increase futureObj's ref count, but the destructor will decrease it
+// Callbacks to resolve or reject the JS Promise when the Future is done
+static PyObject *futureOnDoneCallback(PyObject *Py_UNUSED(self), PyObject *futureObj) {
+  // the callback is called with the Future object as its only argument
+  //    see https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.add_done_callback
+  settlePromise(pendingPromises, futureObj, false);
   Py_RETURN_NONE;
 }
-static PyMethodDef futureCallbackDef = {"futureOnDoneCallback", futureOnDoneCallback, METH_VARARGS, NULL};
+static PyMethodDef futureCallbackDef = {"futureOnDoneCallback", futureOnDoneCallback, METH_O, NULL};
 
-JSObject *PromiseType::toJsPromise(JSContext *cx, PyObject *pyObject) {
-  // Create a new JS Promise object
-  JSObject *promise = JS::NewPromiseObject(cx, nullptr);
+static PyObject *iteratorResultOnDoneCallback(PyObject *Py_UNUSED(self), PyObject *futureObj) {
+  settlePromise(pendingIteratorResults, futureObj, true);
+  Py_RETURN_NONE;
+}
+static PyMethodDef iteratorResultCallbackDef = {"iteratorResultOnDoneCallback", iteratorResultOnDoneCallback, METH_O, NULL};
 
+/**
+ * @brief Convert a Python awaitable to a JS Promise pending in a table, settled by the done callback of the table
+ */
+static JSObject *awaitableToPromise(JSContext *cx, PyObject *pyObject, JS::PersistentRooted<FutureToPromiseMap> *table, PyObject *onDoneCb) {
   // Convert the python awaitable to an asyncio.Future object
   PyEventLoop loop = PyEventLoop::getRunningLoop();
   if (!loop.initialized()) return nullptr;
   PyEventLoop::Future future = loop.ensureFuture(pyObject);
+  PyObject *futureObj = future.getFutureObject(); // the reference owned by the table
+  if (!futureObj || !table) {
+    Py_XDECREF(futureObj);
+    return nullptr;
+  }
+
+  // An asyncio.Future that is converted again settles the same JS Promise
+  auto ptr = table->get().lookupForAdd(futureObj);
+  if (ptr) {
+    Py_DECREF(futureObj);
+    return ptr->value();
+  }
+
+  // Create a new JS Promise object
+  JS::RootedObject promise(cx, JS::NewPromiseObject(cx, nullptr));
+  if (!promise || !table->get().add(ptr, futureObj, promise)) {
+    Py_DECREF(futureObj);
+    return nullptr;
+  }
 
   PyEventLoop::_locker->incCounter();
+  Metrics::awaitablesAwaitedByPromises++;
 
-  // Resolve or Reject the JS Promise once the python awaitable is done
-  JS::PersistentRooted<JSObject *> *rootedPtr = new JS::PersistentRooted<JSObject *>(cx, promise); // `promise` is required to be rooted from here to the end of onDoneCallback
-  PyObject *futureCallbackTuple = PyTuple_Pack(2, PyLong_FromVoidPtr(cx), PyLong_FromVoidPtr(rootedPtr));
-  PyObject *onDoneCb = PyCFunction_New(&futureCallbackDef, futureCallbackTuple);
+  // Resolve or Reject the JS Promise once the python awaitable is done,
+  //    the same callback is shared by every Future as it finds the Promise by the Future it is called with
   future.addDoneCallback(onDoneCb);
-  Py_INCREF(pyObject);
   return promise;
 }
 
+JSObject *PromiseType::toJsPromise(JSContext *cx, PyObject *pyObject) {
+  static PyObject *onDoneCb = PyCFunction_New(&futureCallbackDef, NULL);
+  return awaitableToPromise(cx, pyObject, pendingPromises, onDoneCb);
+}
+
+JSObject *PromiseType::toJsIteratorResultPromise(JSContext *cx, PyObject *pyObject) {
+  static PyObject *onDoneCb = PyCFunction_New(&iteratorResultCallbackDef, NULL);
+  return awaitableToPromise(cx, pyObject, pendingIteratorResults, onDoneCb);
+}
+
 bool PythonAwaitable_Check(PyObject *obj) {
   // see https://docs.python.org/3/c-api/typeobj.html#c.PyAsyncMethods
   PyTypeObject *tp = Py_TYPE(obj);
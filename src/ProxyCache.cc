@@ -0,0 +1,102 @@
+/**
+ * @file ProxyCache.cc
+ * @author agent (agent@local)
+ * @brief Identity-preserving caches of the proxies created when coercing objects between Python and JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/ProxyCache.hh"
+
+#include <jsapi.h>
+#include <js/GCHashTable.h>
+#include <js/SweepingAPI.h>
+
+#include <Python.h>
+
+using PyObjectToJSProxyMap = JS::GCHashMap<PyObject *, JS::Heap<JSObject *>, mozilla::DefaultHasher<PyObject *>, js::SystemAllocPolicy>;
+using JSObjectToPyProxyMap = JS::GCHashMap<JSObject *, PyObject *, js::StableCellHasher<JSObject *>, js::SystemAllocPolicy>;
+
+// Python object -> JS proxy, weakly holding the proxy, entries for dead proxies are swept by the GC
+static JS::WeakCache<PyObjectToJSProxyMap> *pyObjectToJSProxyCache = nullptr;
+// JS object -> Python proxy, the JS object is already kept alive by the Python proxy's PersistentRootedObject
+static JS::PersistentRooted<JSObjectToPyProxyMap> *jsObjectToPyProxyCache = nullptr;
+
+bool ProxyCache::init(JSContext *cx) {
+  pyObjectToJSProxyCache = new JS::WeakCache<PyObjectToJSProxyMap>(JS_GetRuntime(cx));
+  jsObjectToPyProxyCache = new JS::PersistentRooted<JSObjectToPyProxyMap>(cx);
+  return pyObjectToJSProxyCache && jsObjectToPyProxyCache;
+}
+
+void ProxyCache::finalize() {
+  delete pyObjectToJSProxyCache;
+  pyObjectToJSProxyCache = nullptr;
+  delete jsObjectToPyProxyCache;
+  jsObjectToPyProxyCache = nullptr;
+}
+
+JSObject *ProxyCache::getJSProxy(PyObject *pyObject) {
+  if (!pyObjectToJSProxyCache) {
+    return nullptr;
+  }
+  auto ptr = pyObjectToJSProxyCache->lookup(pyObject); // the WeakCache read barrier skips entries that are about to be swept
+  if (!ptr) {
+    return nullptr;
+  }
+  return ptr->value(); // JS::Heap exposes the proxy to active JS
+}
+
+void ProxyCache::putJSProxy(PyObject *pyObject, JSObject *proxy) {
+  if (!pyObjectToJSProxyCache) {
+    return;
+  }
+  // failing to cache is harmless, the next coercion will just create a new proxy
+  (void)pyObjectToJSProxyCache->put(pyObject, proxy);
+}
+
+PyObject *ProxyCache::getPyProxy(JSObject *jsObject) {
+  if (!jsObjectToPyProxyCache) {
+    return NULL;
+  }
+  auto ptr = jsObjectToPyProxyCache->get().lookup(jsObject);
+  if (!ptr) {
+    return NULL;
+  }
+  PyObject *proxy = ptr->value();
+  Py_INCREF(proxy);
+  return proxy;
+}
+
+void ProxyCache::putPyProxy(JSObject *jsObject, PyObject *proxy) {
+  if (!jsObjectToPyProxyCache) {
+    return;
+  }
+  // keep the first proxy created, e.g. an Array coerced to a JSObjectProxy for an exception's `jsError` must not replace its JSArrayProxy
+  auto ptr = jsObjectToPyProxyCache->get().lookupForAdd(jsObject);
+  if (!ptr) {
+    // failing to cache is harmless, the next coercion will just create a new proxy
+    (void)jsObjectToPyProxyCache->get().add(ptr, jsObject, proxy);
+  }
+}
+
+void ProxyCache::removePyProxy(JSObject *jsObject, PyObject *proxy) {
+  if (!jsObjectToPyProxyCache || !jsObject) {
+    return;
+  }
+  auto ptr = jsObjectToPyProxyCache->get().lookup(jsObject);
+  if (ptr && ptr->value() == proxy) {
+    jsObjectToPyProxyCache->get().remove(ptr);
+  }
+}
+
+void ProxyCache::takePyProxies(std::vector<PyObject *> &proxies) {
+  if (!jsObjectToPyProxyCache) {
+    return;
+  }
+  for (auto iter = jsObjectToPyProxyCache->get().iter(); !iter.done(); iter.next()) {
+    proxies.push_back(iter.get().value());
+  }
+  jsObjectToPyProxyCache->get().clear();
+}
@@ -10,13 +10,49 @@
 
 
 #include "include/PyBaseProxyHandler.hh"
+#include "include/AtomCache.hh"
 
 #include <jsapi.h>
+#include <js/String.h>
 
 #include <Python.h>
 
 
+/**
+ * @brief Convert a JS string to a Python string directly from its Latin-1 or two-byte chars, without a UTF-8 detour
+ */
+static PyObject *linearStringToPyString(JSContext *cx, JSString *str) {
+  JS::AutoCheckCannotGC nogc;
+  size_t length;
+  if (JS::StringHasLatin1Chars(str)) {
+    const JS::Latin1Char *chars = JS_GetLatin1StringCharsAndLength(cx, nogc, str, &length);
+    return PyUnicode_FromKindAndData(PyUnicode_1BYTE_KIND, chars, length);
+  }
+  const char16_t *chars = JS_GetTwoByteStringCharsAndLength(cx, nogc, str, &length);
+  // surrogate pairs are combined, and lone surrogates replaced by U+FFFD as `JS_EncodeStringToUTF8` would
+  int byteorder = PY_LITTLE_ENDIAN ? -1 : 1;
+  return PyUnicode_DecodeUTF16((const char *)chars, length * sizeof(char16_t), "replace", &byteorder);
+}
+
 PyObject *idToKey(JSContext *cx, JS::HandleId id) {
+  if (id.isString()) { // string ids are atoms, cache their interned Python strings
+    JSString *atom = id.toString();
+    PyObject *key = AtomCache::getKey(atom);
+    if (key) {
+      return key;
+    }
+    key = linearStringToPyString(cx, atom);
+    if (!key) {
+      return NULL;
+    }
+    PyUnicode_InternInPlace(&key);
+    AtomCache::putKey(atom, key);
+    return key;
+  }
+  else if (id.isInt()) {
+    return PyUnicode_FromFormat("%d", id.toInt());
+  }
+
   JS::RootedValue idv(cx, js::IdToValue(id));
   JS::RootedString idStr(cx);
   if (!id.isSymbol()) { // `JS::ToString` returns `nullptr` for JS symbols
@@ -32,6 +68,64 @@ PyObject *idToKey(JSContext *cx, JS::HandleId id) {
   return PyUnicode_FromString(chars.get());
 }
 
+/**
+ * @brief Get the method holder object of a method table in the current global, creating it on first use
+ */
+static JSObject *getMethodHolder(JSContext *cx, GlobalSlots globalSlot, const JSMethodDef *methods, const JSSymbolMethodDef *symbolMethods) {
+  JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+  JS::Value holderValue = JS::GetReservedSlot(global, globalSlot);
+  if (holderValue.isObject()) {
+    return &holderValue.toObject();
+  }
+
+  // no prototype, so that e.g. `toString` isn't found on Object.prototype for tables that don't define it
+  JS::RootedObject holder(cx, JS_NewObjectWithGivenProto(cx, nullptr, nullptr));
+  if (!holder) {
+    return nullptr;
+  }
+  for (const JSMethodDef *method = methods; method->name; method++) {
+    if (!JS_DefineFunction(cx, holder, method->name, method->call, method->nargs, JSPROP_ENUMERATE)) {
+      return nullptr;
+    }
+  }
+  for (const JSSymbolMethodDef *method = symbolMethods; method && method->call; method++) {
+    JS::RootedId symbolId(cx, JS::PropertyKey::Symbol(JS::GetWellKnownSymbol(cx, method->code)));
+    if (!JS_DefineFunctionById(cx, holder, symbolId, method->call, method->nargs, JSPROP_ENUMERATE)) {
+      return nullptr;
+    }
+  }
+  JS::SetReservedSlot(global, globalSlot, JS::ObjectValue(*holder));
+  return holder;
+}
+
+bool getProxyMethod(JSContext *cx, GlobalSlots globalSlot, const JSMethodDef *methods, const JSSymbolMethodDef *symbolMethods,
+  JS::HandleId id, JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc, bool *found) {
+  *found = false;
+  if (!id.isString() && !id.isSymbol()) {
+    return true;
+  }
+
+  JS::RootedObject holder(cx, getMethodHolder(cx, globalSlot, methods, symbolMethods));
+  if (!holder) {
+    return false;
+  }
+
+  JS::Rooted<mozilla::Maybe<JS::PropertyDescriptor>> methodDesc(cx);
+  if (!JS_GetOwnPropertyDescriptorById(cx, holder, id, &methodDesc)) {
+    return false;
+  }
+  if (methodDesc.isSome()) {
+    desc.set(mozilla::Some(
+      JS::PropertyDescriptor::Data(
+        methodDesc->value(),
+        {JS::PropertyAttribute::Enumerable}
+      )
+    ));
+    *found = true;
+  }
+  return true;
+}
+
 bool idToIndex(JSContext *cx, JS::HandleId id, Py_ssize_t *index) {
   if (id.isInt()) { // int-like strings have already been automatically converted to ints
     *index = id.toInt();
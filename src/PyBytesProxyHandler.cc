@@ -252,6 +252,11 @@ static JSMethodDef array_methods[] = {
   {NULL, NULL, 0}
 };
 
+static JSSymbolMethodDef array_symbol_methods[] = {
+  {JS::SymbolCode::iterator, array_values, 0},
+  {JS::SymbolCode::iterator, NULL, 0}
+};
+
 
 bool PyBytesProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::HandleValue v, JS::HandleValue receiver,
@@ -273,26 +278,12 @@ bool PyBytesProxyHandler::getOwnPropertyDescriptor(
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
 ) const {
   // see if we're calling a function
-  if (id.isString()) {
-    for (size_t index = 0;; index++) {
-      bool isThatFunction;
-      const char *methodName = array_methods[index].name;
-      if (methodName == NULL) {
-        break;
-      }
-      else if (JS_StringEqualsAscii(cx, id.toString(), methodName, &isThatFunction) && isThatFunction) {
-        JSFunction *newFunction = JS_NewFunction(cx, array_methods[index].call, array_methods[index].nargs, 0, NULL);
-        if (!newFunction) return false;
-        JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-        desc.set(mozilla::Some(
-          JS::PropertyDescriptor::Data(
-            JS::ObjectValue(*funObj),
-            {JS::PropertyAttribute::Enumerable}
-          )
-        ));
-        return true;
-      }
-    }
+  bool isMethod;
+  if (!getProxyMethod(cx, PyBytesMethodsSlot, array_methods, array_symbol_methods, id, desc, &isMethod)) {
+    return false;
+  }
+  if (isMethod) {
+    return true;
   }
 
   if (id.isString()) {
@@ -373,23 +364,8 @@ bool PyBytesProxyHandler::getOwnPropertyDescriptor(
     }
   }
 
-  if (id.isSymbol()) {
-    JS::RootedSymbol rootedSymbol(cx, id.toSymbol());
-
-    if (JS::GetSymbolCode(rootedSymbol) == JS::SymbolCode::iterator) {
-      JSFunction *newFunction = JS_NewFunction(cx, array_values, 0, 0, NULL);
-      if (!newFunction) return false;
-      JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-      desc.set(mozilla::Some(
-        JS::PropertyDescriptor::Data(
-          JS::ObjectValue(*funObj),
-          {JS::PropertyAttribute::Enumerable}
-        )
-      ));
-    } else {
-      desc.set(mozilla::Nothing());
-    }
-
+  if (id.isSymbol()) { // Symbol.iterator is in the method table
+    desc.set(mozilla::Nothing());
     return true;
   }
 
@@ -11,6 +11,8 @@
 #include "include/PyDictProxyHandler.hh"
 
 #include "include/jsTypeFactory.hh"
+#include "include/Profiler.hh"
+#include "include/HotPathStats.hh"
 #include "include/pyTypeFactory.hh"
 
 #include <jsapi.h>
@@ -26,17 +28,59 @@
 
 const char PyDictProxyHandler::family = 0;
 
+/**
+ * @brief Look up the item of a property key, integer keys being looked up as ints when the dict has no such str key
+ *
+ * @return PyObject* - a borrowed reference to the item, or NULL (without an exception set if the key wasn't present)
+ */
+static PyObject *getItem(JSContext *cx, PyObject *self, JS::HandleId id) {
+  PyObject *attrName = idToKey(cx, id);
+  PyObject *item = PyDict_GetItemWithError(self, attrName);
+  if (!item && !PyErr_Occurred() && id.isInt()) { // ownPropertyKeys names the int keys by their index
+    PyObject *index = PyLong_FromLong(id.toInt());
+    item = PyDict_GetItemWithError(self, index);
+    Py_DECREF(index);
+  }
+  return item;
+}
+
 bool PyDictProxyHandler::ownPropertyKeys(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  ProfilerLabel profilerLabel("PyDictProxyHandler::ownPropertyKeys");
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, ownPropertyKeys);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  PyObject *keys = PyDict_Keys(self);
-
-  size_t length = PyList_Size(keys);
+  if (!props.reserve(PyDict_Size(self))) {
+    return false; // out of memory
+  }
 
-  return handleOwnPropertyKeys(cx, keys, length, props);
+  // walk the dict in place rather than copying its keys to a list
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  JS::RootedId jsId(cx);
+  while (PyDict_Next(self, &pos, &key, &value)) {
+    if (PyLong_Check(key)) {
+      int overflow;
+      long index = PyLong_AsLongAndOverflow(key, &overflow);
+      if (overflow || index < 0) {
+        PyErr_Clear();
+        continue; // not an array index, JS can't name it
+      }
+      if (index <= INT32_MAX) {
+        props.infallibleAppend(JS::PropertyKey::Int(index)); // no string is created for integer keys
+        continue;
+      }
+    }
+    if (!keyToId(key, &jsId)) {
+      continue; // skip over keys that are not str or int
+    }
+    props.infallibleAppend(jsId);
+  }
+  return true;
 }
 
 bool PyDictProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyDictProxyHandler::delete_");
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, delete);
   PyObject *attrName = idToKey(cx, id);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
   if (PyDict_DelItem(self, attrName) < 0) {
@@ -47,6 +91,7 @@ bool PyDictProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::Hand
 
 bool PyDictProxyHandler::has(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   bool *bp) const {
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, has);
   return hasOwn(cx, proxy, id, bp);
 }
 
@@ -54,9 +99,10 @@ bool PyDictProxyHandler::getOwnPropertyDescriptor(
   JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
 ) const {
-  PyObject *attrName = idToKey(cx, id);
+  ProfilerLabel profilerLabel("PyDictProxyHandler::getOwnPropertyDescriptor");
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, getOwnPropertyDescriptor);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  PyObject *item = PyDict_GetItemWithError(self, attrName); // returns NULL without an exception set if the key wasn’t present.
+  PyObject *item = getItem(cx, self, id); // returns NULL without an exception set if the key wasn’t present.
 
   return handleGetOwnPropertyDescriptor(cx, id, desc, item);
 }
@@ -64,6 +110,8 @@ bool PyDictProxyHandler::getOwnPropertyDescriptor(
 bool PyDictProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::HandleValue v, JS::HandleValue receiver,
   JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyDictProxyHandler::set");
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, set);
   JS::RootedValue rootedV(cx, v);
   PyObject *attrName = idToKey(cx, id);
 
@@ -79,20 +127,23 @@ bool PyDictProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::HandleId
 
 bool PyDictProxyHandler::enumerate(JSContext *cx, JS::HandleObject proxy,
   JS::MutableHandleIdVector props) const {
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, enumerate);
   return this->ownPropertyKeys(cx, proxy, props);
 }
 
 bool PyDictProxyHandler::hasOwn(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   bool *bp) const {
-  PyObject *attrName = idToKey(cx, id);
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, hasOwn);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  *bp = PyDict_Contains(self, attrName) == 1;
+  *bp = getItem(cx, self, id) != NULL;
+  PyErr_Clear(); // a failing lookup counts as a miss
   return true;
 }
 
 bool PyDictProxyHandler::getOwnEnumerablePropertyKeys(
   JSContext *cx, JS::HandleObject proxy,
   JS::MutableHandleIdVector props) const {
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, getOwnEnumerablePropertyKeys);
   return this->ownPropertyKeys(cx, proxy, props);
 }
 
@@ -100,6 +151,7 @@ bool PyDictProxyHandler::defineProperty(JSContext *cx, JS::HandleObject proxy,
   JS::HandleId id,
   JS::Handle<JS::PropertyDescriptor> desc,
   JS::ObjectOpResult &result) const {
+  PYTHONMONKEY_HOT_PATH(PyDictProxyHandler, defineProperty);
   // Block direct `Object.defineProperty` since we already have the `set` method
   return result.failInvalidDescriptor();
 }
@@ -10,8 +10,12 @@
 
 
 #include "include/PyEventLoop.hh"
+#include "include/Metrics.hh"
 
 #include <Python.h>
+#include "include/pyshim.hh"
+
+#include <algorithm>
 
 /**
  * @brief Wrapper to decrement the counter of queueing event-loop jobs after the job finishes
@@ -33,102 +37,256 @@ static PyObject *eventLoopJobWrapper(PyObject *jobFn, PyObject *Py_UNUSED(_)) {
 }
 static PyMethodDef loopJobWrapperDef = {"eventLoopJobWrapper", eventLoopJobWrapper, METH_NOARGS, NULL};
 
-static PyObject *_enqueueWithDelay(PyObject *_loop, PyEventLoop::AsyncHandle::id_t handleId, PyObject *jobFn, double delaySeconds, bool repeat);
+
+PyEventLoop::AsyncHandle PyEventLoop::enqueue(PyObject *jobFn) {
+  PyEventLoop::_locker->incCounter();
+  PyObject *wrapper = PyCFunction_New(&loopJobWrapperDef, jobFn);
+  // Enqueue job to the Python event-loop
+  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.call_soon
+  PyObject *asyncHandle = PyObject_CallMethod(_loop, "call_soon_threadsafe", "O", wrapper);
+  return PyEventLoop::AsyncHandle(asyncHandle);
+}
 
 /**
- * @brief Wrapper to remove the reference of the timer after the job finishes
+ * @brief An entry of the timer heap. Entries are not removed when their timer is cleared or rescheduled, but skipped once at the top
  */
-static PyObject *timerJobWrapper(PyObject *jobFn, PyObject *args) {
-  PyObject *_loop = PyTuple_GetItem(args, 0);
-  PyEventLoop::AsyncHandle::id_t handleId = PyLong_AsLong(PyTuple_GetItem(args, 1));
-  double delaySeconds = PyFloat_AsDouble(PyTuple_GetItem(args, 2));
-  bool repeat = (bool)PyLong_AsLong(PyTuple_GetItem(args, 3));
+struct TimerEntry {
+  double deadline;
+  uint64_t seq; // timers expiring at the same time run in the order they were scheduled
+  PyEventLoop::AsyncHandle::id_t id;
+};
+
+static inline bool laterTimer(const TimerEntry &a, const TimerEntry &b) {
+  return a.deadline > b.deadline || (a.deadline == b.deadline && a.seq > b.seq);
+}
 
-  PyObject *ret = PyObject_CallObject(jobFn, NULL); // jobFn()
-  Py_XDECREF(ret); // don't care about its return value
+static std::vector<TimerEntry> timerHeap; // a min-heap on the deadlines
+static uint64_t timerSeq = 0;
+static size_t staleTimerEntries = 0; // entries of cleared timers, the heap is compacted when they make up most of it
+static PyObject *timerLoop = nullptr; // the Python event-loop the timers are scheduled on
+static PyObject *armedHandle = nullptr; // the `asyncio.TimerHandle` firing at the earliest deadline
+static double armedDeadline = 0;
+static double clockResolution = 0;
+
+static double loopTime(PyObject *loop) {
+  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.time
+  PyObject *time = PyObject_CallMethod(loop, "time", NULL);
+  double seconds = time ? PyFloat_AsDouble(time) : 0;
+  Py_XDECREF(time);
+  return seconds;
+}
 
-  PyObject *errType, *errValue, *traceback; // we can't call any Python code unless the error indicator is clear
-  PyErr_Fetch(&errType, &errValue, &traceback);
-  // Making sure a `AsyncHandle::fromId` call is close to its `handle`'s use.
-  // We need to ensure the memory block doesn't move for reallocation before we can use the pointer,
-  // as we could have multiple new `setTimeout` calls to expand the `_timeoutIdMap` vector while running the job function in parallel.
-  auto handle = PyEventLoop::AsyncHandle::fromId(handleId);
-  if (repeat && !handle->cancelled()) {
-    _enqueueWithDelay(_loop, handleId, jobFn, delaySeconds, repeat);
-  } else {
-    handle->removeRef();
+static bool isLiveTimerEntry(const TimerEntry &entry) {
+  auto handle = PyEventLoop::AsyncHandle::fromId(entry.id);
+  return handle && handle->_scheduledFor(entry.deadline);
+}
+
+static void cancelArmedHandle() {
+  if (armedHandle) {
+    Py_XDECREF(PyObject_CallMethod(armedHandle, "cancel", NULL));
+    Py_CLEAR(armedHandle);
   }
+}
 
-  if (errType != NULL) { // PyErr_Occurred()
-    PyErr_Restore(errType, errValue, traceback);
-    return NULL;
-  } else {
-    Py_RETURN_NONE;
+/* static */
+bool PyEventLoop::_armTimers() {
+  while (!timerHeap.empty() && !isLiveTimerEntry(timerHeap.front())) {
+    std::pop_heap(timerHeap.begin(), timerHeap.end(), laterTimer);
+    timerHeap.pop_back();
+    if (staleTimerEntries > 0) staleTimerEntries--;
   }
+  if (timerHeap.empty()) {
+    cancelArmedHandle();
+    return true;
+  }
+
+  double deadline = timerHeap.front().deadline;
+  if (armedHandle && armedDeadline <= deadline) {
+    return true; // will fire in time, and re-arm for the rest
+  }
+  cancelArmedHandle();
+
+  static PyMethodDef fireTimersDef = {"pythonmonkeyTimers", _fireTimers, METH_NOARGS, NULL};
+  PyObject *fireFn = PyCFunction_New(&fireTimersDef, NULL);
+  if (!fireFn) {
+    return false;
+  }
+  // Schedule the heap to the Python event-loop
+  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.call_at
+  armedHandle = PyObject_CallMethod(timerLoop, "call_at", "dO", deadline, fireFn);
+  Py_DECREF(fireFn);
+  armedDeadline = deadline;
+  return armedHandle != NULL;
 }
-static PyMethodDef timerJobWrapperDef = {"timerJobWrapper", timerJobWrapper, METH_VARARGS, NULL};
 
-PyEventLoop::AsyncHandle PyEventLoop::enqueue(PyObject *jobFn) {
-  PyEventLoop::_locker->incCounter();
-  PyObject *wrapper = PyCFunction_New(&loopJobWrapperDef, jobFn);
-  // Enqueue job to the Python event-loop
-  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.call_soon
-  PyObject *asyncHandle = PyObject_CallMethod(_loop, "call_soon_threadsafe", "O", wrapper);
-  return PyEventLoop::AsyncHandle(asyncHandle);
+/**
+ * @brief Report an exception raised by a timer's job function the way asyncio reports the exceptions of its callbacks, and carry on with the other timers
+ */
+static void reportTimerException(PyObject *loop, PyObject *jobFn) {
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyErr_NormalizeException(&type, &value, &traceback);
+  if (traceback) {
+    PyException_SetTraceback(value, traceback);
+  }
+  PyObject *context = Py_BuildValue("{s:N,s:O}", "message", PyUnicode_FromFormat("Exception in callback %R", jobFn), "exception", value);
+  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.call_exception_handler
+  PyObject *ret = context ? PyObject_CallMethod(loop, "call_exception_handler", "O", context) : NULL;
+  if (!ret) {
+    PyErr_WriteUnraisable(jobFn);
+  }
+  Py_XDECREF(ret);
+  Py_XDECREF(context);
+  Py_XDECREF(type);
+  Py_XDECREF(value);
+  Py_XDECREF(traceback);
 }
 
-static PyObject *_enqueueWithDelay(PyObject *_loop, PyEventLoop::AsyncHandle::id_t handleId, PyObject *jobFn, double delaySeconds, bool repeat) {
-  PyObject *wrapper = PyCFunction_New(&timerJobWrapperDef, jobFn);
-  // Schedule job to the Python event-loop
-  //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.call_later
-  PyObject *asyncHandle = PyObject_CallMethod(_loop, "call_later", "dOOIdb", delaySeconds, wrapper, _loop, handleId, delaySeconds, repeat); // https://docs.python.org/3/c-api/arg.html#c.Py_BuildValue
-  if (!asyncHandle) {
-    return nullptr; // RuntimeError
+/* static */
+PyObject *PyEventLoop::_fireTimers(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
+  Py_CLEAR(armedHandle);
+  PyObject *loop = timerLoop;
+  Py_INCREF(loop);
+
+  // Run all the timers that expired together in this single callback, asyncio considers the callbacks within the clock resolution as due
+  double firedAt = loopTime(loop);
+  double now = firedAt + clockResolution;
+  while (!timerHeap.empty() && timerHeap.front().deadline <= now) {
+    TimerEntry entry = timerHeap.front();
+    std::pop_heap(timerHeap.begin(), timerHeap.end(), laterTimer);
+    timerHeap.pop_back();
+    auto handle = AsyncHandle::fromId(entry.id);
+    if (!handle || !handle->_scheduledFor(entry.deadline)) {
+      if (staleTimerEntries > 0) staleTimerEntries--;
+      continue;
+    }
+
+    if (!handle->_repeat) {
+      handle->_scheduled = false; // finished, ref'ing it in the job function has no effect
+    }
+    Metrics::timersFired++;
+    Metrics::timerLateness.record(firedAt > entry.deadline ? (uint64_t)((firedAt - entry.deadline) * 1e9) : 0);
+    PyObject *jobFn = handle->_handle;
+    Py_INCREF(jobFn);
+    PyObject *ret = PyObject_CallObject(jobFn, NULL); // jobFn()
+    Py_XDECREF(ret); // don't care about its return value
+    bool stop = false;
+    if (!ret) {
+      if (PyErr_ExceptionMatches(PyExc_Exception)) {
+        reportTimerException(loop, jobFn);
+      } else {
+        stop = true; // SystemExit or KeyboardInterrupt, propagate it like asyncio does
+      }
+    }
+    Py_DECREF(jobFn);
+
+    PyObject *errType, *errValue, *traceback; // we can't call any Python code unless the error indicator is clear
+    PyErr_Fetch(&errType, &errValue, &traceback);
+    // The timer is gone if the job function cleared it, e.g. `clearInterval` called in the callback
+    handle = AsyncHandle::fromId(entry.id);
+    if (handle) {
+      if (handle->_repeat && handle->_scheduled) {
+        handle->_deadline = loopTime(loop) + handle->_delaySeconds;
+        timerHeap.push_back({handle->_deadline, timerSeq++, entry.id});
+        std::push_heap(timerHeap.begin(), timerHeap.end(), laterTimer);
+      } else {
+        handle->removeRef();
+        AsyncHandle::release(entry.id);
+      }
+    }
+    if (stop) {
+      _armTimers();
+      PyErr_Restore(errType, errValue, traceback);
+      Py_DECREF(loop);
+      return NULL;
+    }
   }
 
-  auto handle = PyEventLoop::AsyncHandle::fromId(handleId);
-  Py_XDECREF(handle->swap(asyncHandle));
+  bool ok = _armTimers();
+  Py_DECREF(loop);
+  if (!ok) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
 
-  return asyncHandle;
+/* static */
+void PyEventLoop::_dropTimers() {
+  cancelArmedHandle();
+  for (const TimerEntry &entry: timerHeap) {
+    auto handle = AsyncHandle::fromId(entry.id);
+    if (handle && handle->_scheduledFor(entry.deadline)) {
+      handle->_scheduled = false;
+      handle->removeRef();
+      AsyncHandle::release(entry.id);
+    }
+  }
+  timerHeap.clear();
+  staleTimerEntries = 0;
 }
 
 PyEventLoop::AsyncHandle::id_t PyEventLoop::enqueueWithDelay(PyObject *jobFn, double delaySeconds, bool repeat) {
+  if (timerLoop != _loop) { // the timers scheduled on a previous event-loop would never have run anyway
+    _dropTimers();
+    Py_XDECREF(timerLoop);
+    timerLoop = _loop;
+    Py_INCREF(timerLoop);
+    PyObject *resolution = PyObject_GetAttrString(_loop, "_clock_resolution"); // see https://github.com/python/cpython/blob/v3.9.16/Lib/asyncio/base_events.py#L1837
+    clockResolution = resolution ? PyFloat_AsDouble(resolution) : 0;
+    Py_XDECREF(resolution);
+    PyErr_Clear();
+  }
+
   auto handleId = PyEventLoop::AsyncHandle::newEmpty();
-  if (!_enqueueWithDelay(_loop, handleId, jobFn, delaySeconds, repeat)) {
+  auto handle = PyEventLoop::AsyncHandle::fromId(handleId);
+  Py_INCREF(jobFn);
+  Py_XDECREF(handle->swap(jobFn));
+  handle->_isTimer = true;
+  handle->_repeat = repeat;
+  handle->_delaySeconds = delaySeconds;
+  handle->_deadline = loopTime(_loop) + delaySeconds;
+  handle->_scheduled = true;
+  Metrics::timersScheduled++;
+
+  timerHeap.push_back({handle->_deadline, timerSeq++, handleId});
+  std::push_heap(timerHeap.begin(), timerHeap.end(), laterTimer);
+  if (!_armTimers()) {
     PyErr_Print(); // RuntimeError: Non-thread-safe operation invoked on an event loop other than the current one
   }
-  auto handle = PyEventLoop::AsyncHandle::fromId(handleId);
+
   handle->addRef();
   return handleId;
 }
 
 PyEventLoop::Future PyEventLoop::createFuture() {
   //    https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.loop.create_future
-  PyObject *futureObj = PyObject_CallMethod(_loop, "create_future", NULL);
+  static PyObject *createFutureName = PyUnicode_InternFromString("create_future");
+  PyObject *futureObj = PyObject_CallMethodObjArgs(_loop, createFutureName, NULL);
   return PyEventLoop::Future(futureObj);
 }
 
 PyEventLoop::Future PyEventLoop::ensureFuture(PyObject *awaitable) {
-  PyObject *asyncio = PyImport_ImportModule("asyncio");
+  // `asyncio.ensure_future` is looked up once, the module will not be reloaded while PythonMonkey is using it
+  static PyObject *ensureFutureFn = nullptr;
+  static PyObject *loopKwnames = nullptr;
+  if (!ensureFutureFn) {
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (!asyncio) {
+      return PyEventLoop::Future(nullptr);
+    }
+    ensureFutureFn = PyObject_GetAttrString(asyncio, "ensure_future");
+    Py_DECREF(asyncio);
+    if (!ensureFutureFn) {
+      return PyEventLoop::Future(nullptr);
+    }
+    loopKwnames = Py_BuildValue("(s)", "loop");
+  }
 
-  PyObject *ensure_future_fn = PyObject_GetAttrString(asyncio, "ensure_future"); // ensure_future_fn = asyncio.ensure_future
-  // instead of a simpler `PyObject_CallMethod`, only the `PyObject_Call` API function can be used here because `loop` is a keyword-only argument
+  // `loop` is a keyword-only argument
   //    see https://docs.python.org/3.9/library/asyncio-future.html#asyncio.ensure_future
-  //        https://docs.python.org/3/c-api/call.html#object-calling-api
-  PyObject *args = PyTuple_New(1);
-  PyTuple_SetItem(args, 0, awaitable);
-  PyObject *kwargs = PyDict_New();
-  PyDict_SetItemString(kwargs, "loop", _loop);
-  PyObject *futureObj = PyObject_Call(ensure_future_fn, args, kwargs); // futureObj = ensure_future_fn(awaitable, loop=_loop)
-
-  // clean up
-  Py_DECREF(asyncio);
-  Py_DECREF(ensure_future_fn);
-  Py_DECREF(args);
-  Py_DECREF(kwargs);
-
-  Py_INCREF(futureObj); // needs to be kept alive as `PyEventLoop::Future` will decrease the reference count in its destructor
-  return PyEventLoop::Future(futureObj);
+  PyObject *args[] = {awaitable, _loop};
+  PyObject *futureObj = PyObject_Vectorcall(ensureFutureFn, args, 1, loopKwnames); // futureObj = asyncio.ensure_future(awaitable, loop=_loop)
+  return PyEventLoop::Future(futureObj); // `awaitable` is borrowed, and the new reference to `futureObj` is owned by the wrapper
 }
 
 /* static */
@@ -232,7 +390,80 @@ PyEventLoop PyEventLoop::getRunningLoop() {
   return _getLoopOnThread(_getCurrentThread());
 }
 
+/* static */
+PyEventLoop::AsyncHandle::id_t PyEventLoop::AsyncHandle::newEmpty() {
+  std::lock_guard<std::mutex> lock(_timeoutIdMapMutex);
+  uint32_t index;
+  if (!_freeSlots.empty()) {
+    index = _freeSlots.back();
+    _freeSlots.pop_back();
+  } else {
+    index = _timeoutIdMap.size();
+    _timeoutIdMap.emplace_back(nullptr);
+  }
+  AsyncHandle &handle = _timeoutIdMap[index];
+  Py_INCREF(Py_None);
+  handle._handle = Py_None;
+  return ((id_t)handle._generation << 32) | index;
+}
+
+/* static */
+PyEventLoop::AsyncHandle *PyEventLoop::AsyncHandle::fromId(id_t timeoutID) {
+  uint32_t index = (uint32_t)timeoutID;
+  std::lock_guard<std::mutex> lock(_timeoutIdMapMutex);
+  if (index >= _timeoutIdMap.size()) {
+    return nullptr; // invalid timeoutID
+  }
+  AsyncHandle &handle = _timeoutIdMap[index];
+  if (!handle._handle || handle._generation != (timeoutID >> 32)) {
+    return nullptr; // released, maybe reused by another timer
+  }
+  return &handle;
+}
+
+/* static */
+void PyEventLoop::AsyncHandle::release(id_t timeoutID) {
+  PyObject *handleObject, *debugInfo;
+  {
+    std::lock_guard<std::mutex> lock(_timeoutIdMapMutex);
+    uint32_t index = (uint32_t)timeoutID;
+    if (index >= _timeoutIdMap.size()) {
+      return;
+    }
+    AsyncHandle &handle = _timeoutIdMap[index];
+    if (!handle._handle || handle._generation != (timeoutID >> 32)) {
+      return; // already released
+    }
+    handleObject = std::exchange(handle._handle, nullptr);
+    debugInfo = std::exchange(handle._debugInfo, nullptr);
+    handle._refed = false;
+    handle._scheduled = false;
+    handle._generation = handle._generation % 0x1FFFFF + 1; // IDs stay below 2^53
+    _freeSlots.push_back(index);
+  }
+  Py_XDECREF(handleObject);
+  Py_XDECREF(debugInfo);
+}
+
 void PyEventLoop::AsyncHandle::cancel() {
+  if (!_handle) {
+    return; // released
+  }
+
+  if (_isTimer) { // O(1), its entry in the timer heap is skipped when it gets to the top
+    if (_scheduled) {
+      _scheduled = false;
+      Metrics::timersCancelled++;
+      removeRef();
+      if (++staleTimerEntries > 64 && staleTimerEntries > timerHeap.size() / 2) { // compact the heap when most of it is made of cleared timers, e.g. debouncing
+        timerHeap.erase(std::remove_if(timerHeap.begin(), timerHeap.end(), [](const TimerEntry &entry) { return !isLiveTimerEntry(entry); }), timerHeap.end());
+        std::make_heap(timerHeap.begin(), timerHeap.end(), laterTimer);
+        staleTimerEntries = 0;
+      }
+    }
+    return;
+  }
+
   if (!_finishedOrCancelled()) {
     removeRef(); // automatically unref at finish
   }
@@ -244,13 +475,16 @@ void PyEventLoop::AsyncHandle::cancel() {
 
 /* static */
 bool PyEventLoop::AsyncHandle::cancelAll() {
-  for (AsyncHandle &handle: _timeoutIdMap) {
+  for (AsyncHandle &handle: _timeoutIdMap) { // the timers are not released, `pm.stop` may be followed by a new event-loop reusing the JS Timeout objects
     handle.cancel();
   }
   return true;
 }
 
 bool PyEventLoop::AsyncHandle::cancelled() {
+  if (_isTimer) {
+    return !_scheduled;
+  }
   // https://docs.python.org/3/library/asyncio-eventloop.html#asyncio.Handle.cancelled
   PyObject *ret = PyObject_CallMethod(_handle, "cancelled", NULL); // returns Python bool
   bool cancelled = ret == Py_True;
@@ -259,6 +493,12 @@ bool PyEventLoop::AsyncHandle::cancelled() {
 }
 
 bool PyEventLoop::AsyncHandle::_finishedOrCancelled() {
+  if (!_handle) {
+    return true; // released
+  }
+  if (_isTimer) {
+    return !_scheduled;
+  }
   PyObject *scheduled = PyObject_GetAttrString(_handle, "_scheduled"); // this attribute only exists on asyncio.TimerHandle returned by loop.call_later
                                                                        // NULL if no such attribute (on a strict asyncio.Handle returned by loop.call_soon)
   bool notScheduled = scheduled && scheduled == Py_False; // not scheduled means the job function has already been executed or canceled
@@ -268,25 +508,29 @@ bool PyEventLoop::AsyncHandle::_finishedOrCancelled() {
 
 void PyEventLoop::Future::setResult(PyObject *result) {
   // https://docs.python.org/3/library/asyncio-future.html#asyncio.Future.set_result
-  PyObject *ret = PyObject_CallMethod(_future, "set_result", "O", result); // returns None
+  static PyObject *setResultName = PyUnicode_InternFromString("set_result");
+  PyObject *ret = PyObject_CallMethodObjArgs(_future, setResultName, result, NULL); // returns None
   Py_XDECREF(ret);
 }
 
 void PyEventLoop::Future::setException(PyObject *exception) {
   // https://docs.python.org/3/library/asyncio-future.html#asyncio.Future.set_exception
-  PyObject *ret = PyObject_CallMethod(_future, "set_exception", "O", exception); // returns None
+  static PyObject *setExceptionName = PyUnicode_InternFromString("set_exception");
+  PyObject *ret = PyObject_CallMethodObjArgs(_future, setExceptionName, exception, NULL); // returns None
   Py_XDECREF(ret);
 }
 
 void PyEventLoop::Future::addDoneCallback(PyObject *cb) {
   // https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.add_done_callback
-  PyObject *ret = PyObject_CallMethod(_future, "add_done_callback", "O", cb); // returns None
+  static PyObject *addDoneCallbackName = PyUnicode_InternFromString("add_done_callback");
+  PyObject *ret = PyObject_CallMethodObjArgs(_future, addDoneCallbackName, cb, NULL); // returns None
   Py_XDECREF(ret);
 }
 
 bool PyEventLoop::Future::isCancelled() {
   // https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.cancelled
-  PyObject *ret = PyObject_CallMethod(_future, "cancelled", NULL); // returns Python bool
+  static PyObject *cancelledName = PyUnicode_InternFromString("cancelled");
+  PyObject *ret = PyObject_CallMethodObjArgs(_future, cancelledName, NULL); // returns Python bool
   bool cancelled = ret == Py_True;
   Py_XDECREF(ret);
   return cancelled;
@@ -294,10 +538,12 @@ bool PyEventLoop::Future::isCancelled() {
 
 PyObject *PyEventLoop::Future::getResult() {
   // https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.result
-  return PyObject_CallMethod(_future, "result", NULL);
+  static PyObject *resultName = PyUnicode_InternFromString("result");
+  return PyObject_CallMethodObjArgs(_future, resultName, NULL);
 }
 
 PyObject *PyEventLoop::Future::getException() {
   // https://docs.python.org/3.9/library/asyncio-future.html#asyncio.Future.exception
-  return PyObject_CallMethod(_future, "exception", NULL);
+  static PyObject *exceptionName = PyUnicode_InternFromString("exception");
+  return PyObject_CallMethodObjArgs(_future, exceptionName, NULL);
 }
@@ -12,46 +12,183 @@
 #include "include/PyIterableProxyHandler.hh"
 
 #include "include/jsTypeFactory.hh"
+#include "include/PromiseType.hh"
 
 #include <jsapi.h>
+#include <js/Array.h>
+#include <js/Promise.h>
 
 #include <Python.h>
 
-
+#include <algorithm>
 
 const char PyIterableProxyHandler::family = 0;
 
+size_t PyIterableProxyHandler::batchSize = 1;
 
-static bool iter_next(JSContext *cx, JS::CallArgs args, PyObject *it) {
+JSObject *PyIterableProxyHandler::newIteratorResult(JSContext *cx, JS::HandleValue value, bool done) {
   JS::RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result) return nullptr;
 
-  PyObject *(*iternext)(PyObject *) = *Py_TYPE(it)->tp_iternext;
+  JS::RootedValue doneValue(cx, JS::BooleanValue(done));
+  if (!JS_SetProperty(cx, result, "done", doneValue)) return nullptr;
+  if (!done && !JS_SetProperty(cx, result, "value", value)) return nullptr;
+  return result;
+}
 
-  PyObject *item = iternext(it);
+/**
+ * @brief Get the next item of a Python iterator
+ *
+ * @return PyObject* - a new reference to the item, or NULL once exhausted, with the Python exception set if the iterator raised
+ */
+static PyObject *pyIterNext(PyObject *it) {
+  PyObject *item = Py_TYPE(it)->tp_iternext(it);
 
-  if (item == NULL) {
-    if (PyErr_Occurred()) {
-      if (PyErr_ExceptionMatches(PyExc_StopIteration) ||
-          PyErr_ExceptionMatches(PyExc_SystemError)) {      // TODO this handles a result like   SystemError: Objects/dictobject.c:1778: bad argument to internal function. Why are we getting that?
-        PyErr_Clear();
-      }
-      else {
-        return false;
+  if (item == NULL && PyErr_Occurred()) {
+    if (PyErr_ExceptionMatches(PyExc_StopIteration) ||
+        PyErr_ExceptionMatches(PyExc_SystemError)) {      // TODO this handles a result like   SystemError: Objects/dictobject.c:1778: bad argument to internal function. Why are we getting that?
+      PyErr_Clear();
+    }
+  }
+  return item;
+}
+
+// IteratorBuffer, the items prefetched from a Python iterator, kept in the OtherSlot of its proxy once batchSize > 1
+
+enum {
+  IteratorBufferSlotItems,      // the JS Array of the items of the last batch
+  IteratorBufferSlotCursor,     // the index of the next item to serve
+  IteratorBufferSlotDone,       // the Python iterator is exhausted or raised
+  IteratorBufferSlotException,  // the JS exception the Python iterator raised, thrown once the items pulled before it are served
+  IteratorBufferSlotCount
+};
+
+static JSClass iteratorBufferClass = {"IteratorBuffer", JSCLASS_HAS_RESERVED_SLOTS(IteratorBufferSlotCount)};
+
+/**
+ * @brief Pull the next batch of items from a Python iterator into its buffer, raising the Python exception only once its items are served
+ */
+static bool fillIteratorBuffer(JSContext *cx, PyObject *it, JS::HandleObject buffer) {
+  size_t batchSize = std::max<size_t>(PyIterableProxyHandler::batchSize, 1);
+  JS::RootedValueVector items(cx);
+  if (!items.reserve(batchSize)) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+
+  while (items.length() < batchSize) {
+    PyObject *item = pyIterNext(it);
+    if (!item) {
+      if (PyErr_Occurred()) {
+        if (!setPyException(cx)) {
+          // a SystemExit, left raised: returning false without a pending JS exception terminates the JS code uncatchably,
+          // so that the Python caller gets the SystemExit; the exhausted buffer keeps the iterator from being pulled again
+          JS::SetReservedSlot(buffer, IteratorBufferSlotDone, JS::BooleanValue(true));
+          JS::SetReservedSlot(buffer, IteratorBufferSlotItems, JS::NullValue());
+          return false;
+        }
+        JS::RootedValue exception(cx);
+        if (!JS_GetPendingException(cx, &exception)) {
+          return false;
+        }
+        JS_ClearPendingException(cx);
+        JS::SetReservedSlot(buffer, IteratorBufferSlotException, exception);
       }
+      JS::SetReservedSlot(buffer, IteratorBufferSlotDone, JS::BooleanValue(true));
+      break;
     }
+    items.infallibleAppend(jsTypeFactory(cx, item));
+    Py_DECREF(item);
+  }
 
-    JS::RootedValue done(cx, JS::BooleanValue(true));
-    if (!JS_SetProperty(cx, result, "done", done)) return false;
-    args.rval().setObject(*result);
-    return result;
+  JS::RootedObject array(cx, JS::NewArrayObject(cx, items));
+  if (!array) {
+    return false;
   }
+  JS::SetReservedSlot(buffer, IteratorBufferSlotItems, JS::ObjectValue(*array));
+  JS::SetReservedSlot(buffer, IteratorBufferSlotCursor, JS::Int32Value(0));
+  return true;
+}
 
-  JS::RootedValue done(cx, JS::BooleanValue(false));
-  if (!JS_SetProperty(cx, result, "done", done)) return false;
+/**
+ * @brief Serve the next item of a Python iterator from the buffer of its proxy, pulling a batch when the buffer is empty
+ */
+static bool nextBufferedItem(JSContext *cx, JS::HandleObject proxy, PyObject *it, JS::MutableHandleValue value, bool *done) {
+  JS::RootedObject buffer(cx);
+  JS::Value bufferValue = JS::GetReservedSlot(proxy, OtherSlot);
+  if (bufferValue.isObject()) {
+    buffer = &bufferValue.toObject();
+  } else {
+    buffer = JS_NewObject(cx, &iteratorBufferClass);
+    if (!buffer) {
+      return false;
+    }
+    JS::SetReservedSlot(buffer, IteratorBufferSlotItems, JS::NullValue());
+    JS::SetReservedSlot(buffer, IteratorBufferSlotCursor, JS::Int32Value(0));
+    JS::SetReservedSlot(buffer, IteratorBufferSlotDone, JS::BooleanValue(false));
+    JS::SetReservedSlot(proxy, OtherSlot, JS::ObjectValue(*buffer));
+  }
 
-  JS::RootedValue value(cx, jsTypeFactory(cx, item));
-  if (!JS_SetProperty(cx, result, "value", value)) return false;
+  JS::RootedObject items(cx, JS::GetReservedSlot(buffer, IteratorBufferSlotItems).toObjectOrNull());
+  uint32_t cursor = JS::GetReservedSlot(buffer, IteratorBufferSlotCursor).toInt32();
+  uint32_t length = 0;
+  if (items && !JS::GetArrayLength(cx, items, &length)) {
+    return false;
+  }
+
+  if (cursor >= length && !JS::GetReservedSlot(buffer, IteratorBufferSlotDone).toBoolean()) {
+    if (!fillIteratorBuffer(cx, it, buffer)) {
+      return false;
+    }
+    items = &JS::GetReservedSlot(buffer, IteratorBufferSlotItems).toObject();
+    cursor = 0;
+    if (!JS::GetArrayLength(cx, items, &length)) {
+      return false;
+    }
+  }
+
+  if (cursor >= length) {
+    JS::RootedValue exception(cx, JS::GetReservedSlot(buffer, IteratorBufferSlotException));
+    if (!exception.isUndefined()) {
+      JS::SetReservedSlot(buffer, IteratorBufferSlotException, JS::UndefinedValue());
+      JS_SetPendingException(cx, exception);
+      return false;
+    }
+    *done = true;
+    return true;
+  }
+
+  if (!JS_GetElement(cx, items, cursor, value)) {
+    return false;
+  }
+  JS::SetReservedSlot(buffer, IteratorBufferSlotCursor, JS::Int32Value(cursor + 1));
+  *done = false;
+  return true;
+}
 
+static bool iter_next(JSContext *cx, JS::CallArgs args, JS::HandleObject proxy) {
+  PyObject *it = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+
+  JS::RootedValue value(cx);
+  bool done;
+  if (PyIterableProxyHandler::batchSize > 1 || JS::GetReservedSlot(proxy, OtherSlot).isObject()) { // keep serving a buffer once there is one
+    if (!nextBufferedItem(cx, proxy, it, &value, &done)) {
+      return false;
+    }
+  } else {
+    PyObject *item = pyIterNext(it);
+    if (item == NULL && PyErr_Occurred()) {
+      return false;
+    }
+    done = item == NULL;
+    if (item) {
+      value = jsTypeFactory(cx, item);
+      Py_DECREF(item);
+    }
+  }
+
+  JSObject *result = PyIterableProxyHandler::newIteratorResult(cx, value, done);
+  if (!result) return false;
   args.rval().setObject(*result);
   return true;
 }
@@ -61,9 +198,7 @@ static bool iterable_next(JSContext *cx, unsigned argc, JS::Value *vp) {
   JS::RootedObject thisObj(cx);
   if (!args.computeThis(cx, &thisObj)) return false;
 
-  PyObject *it = JS::GetMaybePtrFromReservedSlot<PyObject>(thisObj, PyObjectSlot);
-
-  return iter_next(cx, args, it);
+  return iter_next(cx, args, thisObj);
 }
 
 static bool toPrimitive(JSContext *cx, unsigned argc, JS::Value *vp) {
@@ -115,7 +250,7 @@ static JSMethodDef iterable_methods[] = {
 // IterableIterator
 
 enum {
-  IterableIteratorSlotIterableObject,
+  IterableIteratorSlotIterableObject, // the proxy of the Python iterator, whose buffer is shared with its own `next()`
   IterableIteratorSlotCount
 };
 
@@ -126,9 +261,9 @@ static bool iterator_next(JSContext *cx, unsigned argc, JS::Value *vp) {
   JS::RootedObject thisObj(cx);
   if (!args.computeThis(cx, &thisObj)) return false;
 
-  PyObject *it = JS::GetMaybePtrFromReservedSlot<PyObject>(thisObj, IterableIteratorSlotIterableObject);
+  JS::RootedObject proxy(cx, &JS::GetReservedSlot(thisObj, IterableIteratorSlotIterableObject).toObject());
 
-  return iter_next(cx, args, it);
+  return iter_next(cx, args, proxy);
 }
 
 static JSFunctionSpec iterable_iterator_methods[] = {
@@ -179,8 +314,6 @@ static bool iterable_values(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-
   JS::RootedObject global(cx, JS::GetNonCCWObjectGlobal(proxy));
 
   JS::RootedValue constructor_val(cx);
@@ -202,37 +335,116 @@ static bool iterable_values(JSContext *cx, unsigned argc, JS::Value *vp) {
   if (!JS::Construct(cx, constructor_val, JS::HandleValueArray::empty(), &obj)) return false;
   if (!obj) return false;
 
-  JS::SetReservedSlot(obj, IterableIteratorSlotIterableObject, JS::PrivateValue((void *)self));
+  JS::SetReservedSlot(obj, IterableIteratorSlotIterableObject, JS::ObjectValue(*proxy));
 
   args.rval().setObject(*obj);
   return true;
 }
 
+static JSSymbolMethodDef iterable_symbol_methods[] = {
+  {JS::SymbolCode::iterator, iterable_values, 0},
+  {JS::SymbolCode::toPrimitive, toPrimitive, 0},
+  {JS::SymbolCode::iterator, NULL, 0}
+};
+
+
+// async iterables, the proxy holds the Python object itself rather than an iterator of it
+
+static bool async_iterable_next(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+  JS::RootedObject proxy(cx, JS::ToObject(cx, args.thisv()));
+  if (!proxy) {
+    return false;
+  }
+
+  PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+  PyAsyncMethods *asyncMethods = Py_TYPE(self)->tp_as_async;
+  if (!asyncMethods->am_anext) {
+    JS_ReportErrorASCII(cx, "'%s' object is an async iterable but not an async iterator, call its [Symbol.asyncIterator]() first", Py_TYPE(self)->tp_name);
+    return false;
+  }
+
+  PyObject *awaitable = asyncMethods->am_anext(self);
+  if (!awaitable) {
+    if (!PyErr_ExceptionMatches(PyExc_StopAsyncIteration)) {
+      setPyException(cx);
+      return false;
+    }
+    PyErr_Clear(); // raised by `__anext__` itself rather than by its awaitable
+    JS::RootedObject result(cx, PyIterableProxyHandler::newIteratorResult(cx, JS::UndefinedHandleValue, true));
+    if (!result) return false;
+    JS::RootedValue resultValue(cx, JS::ObjectValue(*result));
+    JSObject *promise = JS::CallOriginalPromiseResolve(cx, resultValue);
+    if (!promise) return false;
+    args.rval().setObject(*promise);
+    return true;
+  }
+
+  JSObject *promise = PromiseType::toJsIteratorResultPromise(cx, awaitable);
+  Py_DECREF(awaitable);
+  if (!promise) {
+    if (PyErr_Occurred()) {
+      setPyException(cx); // e.g. no running event-loop
+    }
+    return false;
+  }
+  args.rval().setObject(*promise);
+  return true;
+}
+
+static bool async_iterable_values(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+
+  JS::RootedObject proxy(cx, JS::ToObject(cx, args.thisv()));
+  if (!proxy) {
+    return false;
+  }
+
+  PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+  unaryfunc aiter = Py_TYPE(self)->tp_as_async->am_aiter;
+  if (!aiter) { // an async iterator without `__aiter__`
+    args.rval().setObject(*proxy);
+    return true;
+  }
+
+  PyObject *iterator = aiter(self);
+  if (!iterator) {
+    setPyException(cx);
+    return false;
+  }
+  args.rval().set(jsTypeFactory(cx, iterator));
+  Py_DECREF(iterator);
+  return true;
+}
+
+static JSMethodDef async_iterable_methods[] = {
+  {"next", async_iterable_next, 0},
+  {"valueOf", iterable_valueOf, 0},
+  {NULL, NULL, 0}
+};
+
+static JSSymbolMethodDef async_iterable_symbol_methods[] = {
+  {JS::SymbolCode::asyncIterator, async_iterable_values, 0},
+  {JS::SymbolCode::toPrimitive, toPrimitive, 0},
+  {JS::SymbolCode::asyncIterator, NULL, 0}
+};
+
 bool PyIterableProxyHandler::getOwnPropertyDescriptor(
   JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
 ) const {
-  // see if we're calling a function
-  if (id.isString()) {
-    for (size_t index = 0;; index++) {
-      bool isThatFunction;
-      const char *methodName = iterable_methods[index].name;
-      if (methodName == NULL) {
-        break;
-      }
-      else if (JS_StringEqualsAscii(cx, id.toString(), methodName, &isThatFunction) && isThatFunction) {
-        JSFunction *newFunction = JS_NewFunction(cx, iterable_methods[index].call, iterable_methods[index].nargs, 0, NULL);
-        if (!newFunction) return false;
-        JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-        desc.set(mozilla::Some(
-          JS::PropertyDescriptor::Data(
-            JS::ObjectValue(*funObj),
-            {JS::PropertyAttribute::Enumerable}
-          )
-        ));
-        return true;
-      }
-    }
+  PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+
+  // see if we're calling a function, the proxied objects that are not Python iterators are async iterables
+  bool isMethod;
+  bool isAsync = !PyIter_Check(self);
+  if (!getProxyMethod(cx, isAsync ? PyAsyncIterableMethodsSlot : PyIterableMethodsSlot,
+    isAsync ? async_iterable_methods : iterable_methods, isAsync ? async_iterable_symbol_methods : iterable_symbol_methods, id, desc, &isMethod)) {
+    return false;
+  }
+  if (isMethod) {
+    return true;
   }
 
   // "constructor" property
@@ -259,39 +471,7 @@ bool PyIterableProxyHandler::getOwnPropertyDescriptor(
     return true;
   }
 
-  // symbol property
-  if (id.isSymbol()) {
-    JS::RootedSymbol rootedSymbol(cx, id.toSymbol());
-    JS::SymbolCode symbolCode = JS::GetSymbolCode(rootedSymbol);
-
-    if (symbolCode == JS::SymbolCode::iterator) {
-      JSFunction *newFunction = JS_NewFunction(cx, iterable_values, 0, 0, NULL);
-      if (!newFunction) return false;
-      JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-      desc.set(mozilla::Some(
-        JS::PropertyDescriptor::Data(
-          JS::ObjectValue(*funObj),
-          {JS::PropertyAttribute::Enumerable}
-        )
-      ));
-      return true;
-    }
-    else if (symbolCode == JS::SymbolCode::toPrimitive) {
-      JSFunction *newFunction = JS_NewFunction(cx, toPrimitive, 0, 0, nullptr);
-      if (!newFunction) return false;
-      JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-      desc.set(mozilla::Some(
-        JS::PropertyDescriptor::Data(
-          JS::ObjectValue(*funObj),
-          {JS::PropertyAttribute::Enumerable}
-        )
-      ));
-      return true;
-    }
-  }
-
   PyObject *attrName = idToKey(cx, id);
-  PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
   PyObject *item = PyObject_GetAttr(self, attrName);
   if (!item && PyErr_ExceptionMatches(PyExc_AttributeError)) {
     PyErr_Clear(); // clear error, we will be returning undefined in this case
@@ -14,6 +14,10 @@
 #include "include/jsTypeFactory.hh"
 #include "include/JSArrayProxy.hh"
 #include "include/JSFunctionProxy.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/Profiler.hh"
+#include "include/HotPathStats.hh"
 #include "include/pyTypeFactory.hh"
 
 #include <jsapi.h>
@@ -26,6 +30,9 @@
 #include <Python.h>
 #include "include/pyshim.hh"
 
+#include <algorithm>
+#include <vector>
+
 
 const char PyListProxyHandler::family = 0;
 
@@ -52,6 +59,154 @@ static bool makeNewPyMethod(JSContext *cx, JS::MutableHandleValue function, JS::
   return true;
 }
 
+// private util
+/**
+ * @brief The callback of an iteration method, called on the elements of the python list one after the other.
+ * A callback wrapping a python callable is called directly with the python element, index and list, instead of with JS values that
+ * callPyFunc would convert back; the other callbacks are called through JS, with the same rooted argument array for all the elements
+ */
+class PyListCallback {
+public:
+  PyListCallback(JSContext *cx, PyObject *self, JS::HandleValue callBack, JS::HandleObject thisArg) :
+    cx(cx), self(self), callBack(cx, callBack), thisArg(cx, thisArg), selfValue(cx), jArgs(cx), reduceArgs(cx), accumulator(cx) {
+    pyFunc = getWrappedPyFunc(&callBack.toObject(), &shape);
+    if (!pyFunc) {
+      selfValue.set(jsTypeFactory(cx, self));
+    }
+  }
+
+  ~PyListCallback() {
+    Py_XDECREF(item);
+    Py_XDECREF(pyAccumulator);
+  }
+
+  PyListCallback(const PyListCallback &) = delete;
+  PyListCallback &operator=(const PyListCallback &) = delete;
+
+  /**
+   * @brief Call `callbackfn(element, index, list)`
+   *
+   * @param index - the index of the element, which must be in the list
+   * @param rval - set to the result
+   * @return true - the callback returned
+   * @return false - it threw, and the exception is set on the JSContext
+   */
+  bool call(Py_ssize_t index, JS::MutableHandleValue rval) {
+    if (!pyFunc) {
+      jArgs[0].set(jsTypeFactory(cx, PyList_GET_ITEM(self, index)));
+      jArgs[1].setInt32(index);
+      jArgs[2].set(selfValue);
+      return JS_CallFunctionValue(cx, thisArg, callBack, jArgs, rval);
+    }
+
+    Py_XDECREF(item);
+    item = PyList_GET_ITEM(self, index);
+    Py_INCREF(item); // the callback may remove it from the list
+    PyObject *pyRval;
+    if (!callPython(item, index, &pyRval)) {
+      return false;
+    }
+    rval.set(pyRval ? jsTypeFactory(cx, pyRval) : JS::UndefinedValue());
+    Py_XDECREF(pyRval);
+    return true;
+  }
+
+  /**
+   * @brief Get the element passed to the last `call`, converted to JS
+   */
+  JS::Value element() {
+    return pyFunc ? jsTypeFactory(cx, item) : jArgs[0].get();
+  }
+
+  /**
+   * @brief Set the accumulator of `reduce`
+   */
+  void setAccumulator(JS::HandleValue value) {
+    accumulator.set(value);
+    Py_CLEAR(pyAccumulator);
+  }
+
+  /**
+   * @brief Set the accumulator to the result of `callbackfn(accumulator, element, index, list)`. The accumulator of a python callable
+   * stays a python object between the calls
+   *
+   * @param index - the index of the element, which must be in the list
+   * @return true - the callback returned
+   * @return false - it threw, and the exception is set on the JSContext
+   */
+  bool reduce(Py_ssize_t index) {
+    if (!pyFunc) {
+      reduceArgs[0].set(accumulator);
+      reduceArgs[1].set(jsTypeFactory(cx, PyList_GET_ITEM(self, index)));
+      reduceArgs[2].setInt32(index);
+      reduceArgs[3].set(selfValue);
+      return JS_CallFunctionValue(cx, nullptr, callBack, reduceArgs, &accumulator);
+    }
+
+    if (!pyAccumulator) {
+      pyAccumulator = pyTypeFactory(cx, accumulator);
+      if (!pyAccumulator) {
+        setPyException(cx);
+        return false;
+      }
+    }
+    PyObject *element = PyList_GET_ITEM(self, index);
+    Py_INCREF(element);
+    PyObject *pyRval;
+    bool ok = callPython(element, index, &pyRval, pyAccumulator);
+    Py_DECREF(element);
+    if (!ok) {
+      return false;
+    }
+    Py_DECREF(pyAccumulator);
+    if (!pyRval) {
+      pyRval = Py_None;
+      Py_INCREF(pyRval);
+    }
+    pyAccumulator = pyRval;
+    return true;
+  }
+
+  /**
+   * @brief Get the accumulator of `reduce`, converted to JS
+   */
+  JS::Value getAccumulator() {
+    return pyAccumulator ? jsTypeFactory(cx, pyAccumulator) : accumulator.get();
+  }
+
+private:
+  bool callPython(PyObject *element, Py_ssize_t index, PyObject **pyRval, PyObject *accumulated = nullptr) {
+    PyObject *pyIndex = PyLong_FromSsize_t(index);
+    if (!pyIndex) {
+      setPyException(cx);
+      return false;
+    }
+    bool ok;
+    if (accumulated) {
+      PyObject *pyArgs[4] = {accumulated, element, pyIndex, self};
+      ok = callWrappedPyFunc(cx, pyFunc, shape, pyArgs, 4, pyRval);
+    } else {
+      PyObject *pyArgs[3] = {element, pyIndex, self};
+      ok = callWrappedPyFunc(cx, pyFunc, shape, pyArgs, 3, pyRval);
+    }
+    Py_DECREF(pyIndex);
+    return ok;
+  }
+
+  JSContext *cx;
+  PyObject *self;
+  JS::RootedValue callBack;
+  JS::RootedObject thisArg;
+  JS::RootedValue selfValue; // the JS value of the list, only for the JS callbacks
+  JS::Rooted<JS::ValueArray<3>> jArgs;
+  JS::Rooted<JS::ValueArray<4>> reduceArgs;
+  JS::RootedValue accumulator;
+  PyObject *pyFunc = nullptr; // the python callable of the callback, borrowed from callBack
+  PyFuncArgShape shape;
+  PyObject *item = nullptr; // the element of the last call to the python callable
+  PyObject *pyAccumulator = nullptr; // the accumulator of the python callable
+};
+
 static bool array_reverse(JSContext *cx, unsigned argc, JS::Value *vp) {
   JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
 
@@ -699,10 +854,8 @@ static bool array_forEach(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   Py_ssize_t len = PyList_GET_SIZE(self);
@@ -726,12 +879,9 @@ static bool array_forEach(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
-  for (Py_ssize_t index = 0; index < len; index++) {
-    jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
   }
@@ -766,10 +916,8 @@ static bool array_map(JSContext *cx, unsigned argc, JS::Value *vp) {
   JSObject *retArray = JS::NewArrayObject(cx, len);
   JS::RootedObject rootedRetArray(cx, retArray);
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedObject rootedThisArg(cx);
@@ -791,19 +939,18 @@ static bool array_map(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
-  for (Py_ssize_t index = 0; index < len; index++) {
-    jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    JS_SetElement(cx, rootedRetArray, index, rval);
+    if (!JS_SetElement(cx, rootedRetArray, index, rval)) {
+      return false;
+    }
   }
 
-  args.rval().setObject(*retArray);
+  args.rval().setObject(*rootedRetArray);
   return true;
 }
 
@@ -827,10 +974,8 @@ static bool array_filter(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedValueVector retVector(cx);
@@ -854,19 +999,15 @@ static bool array_filter(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
   Py_ssize_t len = PyList_GET_SIZE(self);
-  for (Py_ssize_t index = 0, toIndex = 0; index < len; index++) {
-    JS::Value item = jsTypeFactory(cx, PyList_GetItem(self, index));
-    jArgs[0].set(item);
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    if (rval.toBoolean()) {
-      if (!retVector.append(item)) {
+    if (JS::ToBoolean(rval)) {
+      if (!retVector.append(callback.element())) {
         return false;
       }
     }
@@ -899,39 +1040,30 @@ static bool array_reduce(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
-
-  JS::Rooted<JS::ValueArray<4>> jArgs(cx);
-  JS::RootedValue *accumulator;
+  PyListCallback callback(cx, self, callBack, nullptr);
 
   Py_ssize_t len = PyList_GET_SIZE(self);
 
   if (args.length() > 1) {
-    accumulator = new JS::RootedValue(cx, args[1].get());
+    callback.setAccumulator(args[1]);
   }
   else {
     if (len == 0) {
       JS_ReportErrorNumberASCII(cx, js::GetErrorMessage, nullptr, JSMSG_EMPTY_ARRAY_REDUCE);
       return false;
     }
-    accumulator = new JS::RootedValue(cx, jsTypeFactory(cx, PyList_GetItem(self, 0)));
+    JS::RootedValue first(cx, jsTypeFactory(cx, PyList_GET_ITEM(self, 0)));
+    callback.setAccumulator(first);
   }
 
-  for (Py_ssize_t index = args.length() > 1 ? 0 : 1; index < len; index++) {
-    jArgs[0].set(*accumulator);
-    jArgs[1].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[2].setInt32(index);
-    jArgs[3].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, nullptr, callBack, jArgs, accumulator)) {
-      delete accumulator;
+  for (Py_ssize_t index = args.length() > 1 ? 0 : 1; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.reduce(index)) {
       return false;
     }
   }
 
-  args.rval().set(accumulator->get());
-  delete accumulator;
+  args.rval().set(callback.getAccumulator());
   return true;
 }
 
@@ -955,37 +1087,33 @@ static bool array_reduceRight(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
-
-  JS::Rooted<JS::ValueArray<4>> jArgs(cx);
-  JS::RootedValue accumulator(cx);
+  PyListCallback callback(cx, self, callBack, nullptr);
 
   Py_ssize_t len = PyList_GET_SIZE(self);
 
   if (args.length() > 1) {
-    accumulator.set(args[1].get());
+    callback.setAccumulator(args[1]);
   }
   else {
     if (len == 0) {
       JS_ReportErrorNumberASCII(cx, js::GetErrorMessage, nullptr, JSMSG_EMPTY_ARRAY_REDUCE);
       return false;
     }
-    accumulator.set(jsTypeFactory(cx, PyList_GetItem(self, len - 1)));
+    JS::RootedValue last(cx, jsTypeFactory(cx, PyList_GET_ITEM(self, len - 1)));
+    callback.setAccumulator(last);
   }
 
   for (int64_t index = args.length() > 1 ? len - 1 : len - 2; index >= 0; index--) {
-    jArgs[0].set(accumulator);
-    jArgs[1].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[2].setInt32(index);
-    jArgs[3].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, nullptr, callBack, jArgs, &accumulator)) {
+    if (index >= PyList_GET_SIZE(self)) { // the callback removed elements
+      continue;
+    }
+    if (!callback.reduce(index)) {
       return false;
     }
   }
 
-  args.rval().set(accumulator.get());
+  args.rval().set(callback.getAccumulator());
   return true;
 }
 
@@ -1009,10 +1137,8 @@ static bool array_some(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedObject rootedThisArg(cx);
@@ -1034,17 +1160,14 @@ static bool array_some(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
   Py_ssize_t len = PyList_GET_SIZE(self);
-  for (Py_ssize_t index = 0, toIndex = 0; index < len; index++) {
-    jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    if (rval.toBoolean()) {
+    if (JS::ToBoolean(rval)) {
       args.rval().setBoolean(true);
       return true;
     }
@@ -1074,10 +1197,8 @@ static bool array_every(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedObject rootedThisArg(cx);
@@ -1099,17 +1220,14 @@ static bool array_every(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
   Py_ssize_t len = PyList_GET_SIZE(self);
-  for (Py_ssize_t index = 0, toIndex = 0; index < len; index++) {
-    jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    if (!rval.toBoolean()) {
+    if (!JS::ToBoolean(rval)) {
       args.rval().setBoolean(false);
       return true;
     }
@@ -1139,10 +1257,8 @@ static bool array_find(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedObject rootedThisArg(cx);
@@ -1164,19 +1280,15 @@ static bool array_find(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
   Py_ssize_t len = PyList_GET_SIZE(self);
-  for (Py_ssize_t index = 0, toIndex = 0; index < len; index++) {
-    JS::Value item = jsTypeFactory(cx, PyList_GetItem(self, index));
-    jArgs[0].set(item);
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    if (rval.toBoolean()) {
-      args.rval().set(item);
+    if (JS::ToBoolean(rval)) {
+      args.rval().set(callback.element());
       return true;
     }
   }
@@ -1205,10 +1317,8 @@ static bool array_findIndex(JSContext *cx, unsigned argc, JS::Value *vp) {
     return false;
   }
 
-  JS::RootedValue selfValue(cx, jsTypeFactory(cx, self));
   JS::RootedValue callBack(cx, callbackfn);
 
-  JS::Rooted<JS::ValueArray<3>> jArgs(cx);
   JS::RootedValue rval(cx);
 
   JS::RootedObject rootedThisArg(cx);
@@ -1230,17 +1340,14 @@ static bool array_findIndex(JSContext *cx, unsigned argc, JS::Value *vp) {
     rootedThisArg.set(nullptr);
   }
 
+  PyListCallback callback(cx, self, callBack, rootedThisArg);
   Py_ssize_t len = PyList_GET_SIZE(self);
-  for (Py_ssize_t index = 0, toIndex = 0; index < len; index++) {
-    jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(self, index)));
-    jArgs[1].setInt32(index);
-    jArgs[2].set(selfValue);
-
-    if (!JS_CallFunctionValue(cx, rootedThisArg, callBack, jArgs, &rval)) {
+  for (Py_ssize_t index = 0; index < len && index < PyList_GET_SIZE(self); index++) {
+    if (!callback.call(index, &rval)) {
       return false;
     }
 
-    if (rval.toBoolean()) {
+    if (JS::ToBoolean(rval)) {
       args.rval().setInt32(index);
       return true;
     }
@@ -1622,112 +1729,95 @@ static bool array_valueOf(JSContext *cx, unsigned argc, JS::Value *vp) {
 //////   Sorting
 
 
-static void swapItems(PyObject *list, int i, int j) {
-  if (i != j) {
-    PyObject *list_i = PyList_GetItem(list, i);
-    PyObject *list_j = PyList_GetItem(list, j);
-    Py_INCREF(list_i);
-    Py_INCREF(list_j);
-    PyList_SetItem(list, i, list_j);
-    PyList_SetItem(list, j, list_i);
-  }
-}
-
-static int invokeCallBack(PyObject *list, int index, JS::HandleValue leftValue, JSContext *cx, JS::HandleFunction callBack) {
-  JS::Rooted<JS::ValueArray<2>> jArgs(cx);
-
-  jArgs[0].set(jsTypeFactory(cx, PyList_GetItem(list, index)));
-  jArgs[1].set(leftValue);
-
-  JS::RootedValue retVal(cx);
-  if (!JS_CallFunction(cx, nullptr, callBack, jArgs, &retVal)) {
-    throw "JS_CallFunction failed";
-  }
-
-  if (!retVal.isNumber()) {
-    PyErr_Format(PyExc_TypeError, "incorrect compare function return type");
-    return 0;
-  }
-
-  return retVal.toInt32();
-}
-
-// Adapted from Kernigan&Ritchie's C book
-static void quickSort(PyObject *list, int left, int right, JSContext *cx, JS::HandleFunction callBack) {
-
-  if (left >= right) {
-    // base case
-    return;
-  }
-
-  swapItems(list, left, (left + right) / 2);
-
-  JS::RootedValue leftValue(cx, jsTypeFactory(cx, PyList_GetItem(list, left)));
-
-  int last = left;
-  for (int index = left + 1; index <= right; index++) {
-    int result = invokeCallBack(list, index, leftValue, cx, callBack);
-    if (PyErr_Occurred()) {
-      return;
-    }
-    if (result < 0) {
-      swapItems(list, ++last, index);
-    }
-  }
-
-  swapItems(list, left, last);
-
-  quickSort(list, left, last - 1, cx, callBack);
-
-  quickSort(list, last + 1, right, cx, callBack);
-}
-
-// private
-static bool js_sort_compare_default(JSContext *cx, unsigned argc, JS::Value *vp) {
-  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
-
-  JS::RootedValue leftVal(cx, args[0]);
-  JS::RootedValue rightVal(cx, args[1]);
+/**
+ * @brief State shared by the comparisons of a sort, the elements are converted to JS once up-front
+ */
+struct ArraySortState {
+  JSContext *cx;
+  JS::HandleValue comparefn;          // the compare function, or undefined for the default string comparison
+  JS::HandleValueVector values;       // the JS values of the elements being sorted
+  JS::Handle<JS::StackGCVector<JSString *>> keys; // the string keys of the elements, precomputed for the default comparison
+};
 
-  // check for undefined
-  if (leftVal.isNullOrUndefined()) {
-    if (rightVal.isNullOrUndefined()) {
-      args.rval().setInt32(0);
-    }
-    else {
-      args.rval().setInt32(1);
+/**
+ * @brief Compare the elements at indices a and b of the sort buffer
+ *
+ * @param state - the state of the sort
+ * @param a - index of the left element
+ * @param b - index of the right element
+ * @param lessOrEqual - set to whether the left element sorts before or with the right one
+ * @return true - the comparison succeeded
+ * @return false - the compare function threw, or returned a non-number
+ */
+static bool sortCompare(ArraySortState &state, size_t a, size_t b, bool *lessOrEqual) {
+  if (state.comparefn.isUndefined()) {
+    int32_t cmpResult;
+    if (!JS_CompareStrings(state.cx, state.keys[a], state.keys[b], &cmpResult)) {
+      return false;
     }
-    return true;
-  }
-  else if (rightVal.isNullOrUndefined()) {
-    args.rval().setInt32(-1);
+    *lessOrEqual = cmpResult <= 0;
     return true;
   }
 
-  JS::RootedObject leftObject(cx);
-  if (!JS_ValueToObject(cx, leftVal, &leftObject)) {
-    return false;
-  }
-  JS::RootedValue leftToStringVal(cx);
-  if (!JS_CallFunctionName(cx, leftObject, "toString", JS::HandleValueArray::empty(), &leftToStringVal)) {
+  JS::Rooted<JS::ValueArray<2>> jArgs(state.cx);
+  jArgs[0].set(state.values[a]);
+  jArgs[1].set(state.values[b]);
+  JS::RootedValue retVal(state.cx);
+  if (!JS::Call(state.cx, JS::UndefinedHandleValue, state.comparefn, jArgs, &retVal)) {
     return false;
   }
 
-  JS::RootedObject rightObject(cx);
-  if (!JS_ValueToObject(cx, rightVal, &rightObject)) {
-    return false;
-  }
-  JS::RootedValue rightToStringVal(cx);
-  if (!JS_CallFunctionName(cx, rightObject, "toString", JS::HandleValueArray::empty(), &rightToStringVal)) {
+  if (!retVal.isNumber()) {
+    PyErr_Format(PyExc_TypeError, "incorrect compare function return type");
     return false;
   }
 
-  int32_t cmpResult;
-  if (!JS_CompareStrings(cx, leftToStringVal.toString(), rightToStringVal.toString(), &cmpResult)) {
-    return false;
-  }
+  *lessOrEqual = !(retVal.toNumber() > 0); // NaN compares as equal
+  return true;
+}
 
-  args.rval().setInt32(cmpResult);
+/**
+ * @brief Stable bottom-up merge sort of a permutation of the sort buffer's indices.
+ * Runs that are already in order are merged with a single comparison, so sorted input is linear
+ *
+ * @param state - the state of the sort
+ * @param perm - the permutation to sort
+ * @param scratch - a buffer of the same length as perm
+ * @param length - length of perm
+ * @param sorted - set to whichever of perm or scratch holds the sorted permutation
+ * @return true - the sort succeeded
+ * @return false - a comparison failed
+ */
+static bool mergeSort(ArraySortState &state, size_t *perm, size_t *scratch, size_t length, size_t **sorted) {
+  for (size_t width = 1; width < length; width *= 2) {
+    for (size_t left = 0; left < length; left += 2 * width) {
+      size_t mid = std::min(left + width, length);
+      size_t right = std::min(left + 2 * width, length);
+      size_t i = left, j = mid, k = left;
+
+      bool alreadyOrdered = true;
+      if (mid < right && !sortCompare(state, perm[mid - 1], perm[mid], &alreadyOrdered)) {
+        return false;
+      }
+      if (!alreadyOrdered) {
+        while (i < mid && j < right) {
+          bool lessOrEqual;
+          if (!sortCompare(state, perm[i], perm[j], &lessOrEqual)) {
+            return false;
+          }
+          scratch[k++] = lessOrEqual ? perm[i++] : perm[j++];
+        }
+      }
+      while (i < mid) {
+        scratch[k++] = perm[i++];
+      }
+      while (j < right) {
+        scratch[k++] = perm[j++];
+      }
+    }
+    std::swap(perm, scratch);
+  }
+  *sorted = perm;
   return true;
 }
 
@@ -1740,38 +1830,83 @@ static bool array_sort(JSContext *cx, unsigned argc, JS::Value *vp) {
   }
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
 
+  JS::RootedValue comparefn(cx);
+  if (args.length() > 0 && !args[0].isUndefined()) {
+    if (!args[0].isObject() || !JS::IsCallable(&args[0].toObject())) {
+      JS_ReportErrorNumberASCII(cx, js::GetErrorMessage, nullptr, JSMSG_BAD_SORT_ARG);
+      return false;
+    }
+    comparefn.set(args[0]);
+  }
+
   Py_ssize_t len = PyList_GET_SIZE(self);
 
   if (len > 1) {
-    if (args.length() < 1) {
-      JS::RootedFunction funObj(cx, JS_NewFunction(cx, js_sort_compare_default, 2, 0, NULL));
-
-      try {
-        quickSort(self, 0, len - 1, cx, funObj);
-      } catch (const char *message) {
-        return false;
-      }
+    // snapshot the elements, the compare function may mutate the list
+    PyObject *items = PyList_GetSlice(self, 0, len);
+    if (!items) {
+      return false;
     }
-    else {
-      JS::Value callbackfn = args[0].get();
 
-      if (!callbackfn.isObject() || !JS::IsCallable(&callbackfn.toObject())) {
-        JS_ReportErrorNumberASCII(cx, js::GetErrorMessage, nullptr, JSMSG_BAD_SORT_ARG);
-        return false;
+    // convert each element once, undefined elements are sorted to the end without being compared
+    JS::RootedValueVector values(cx);
+    JS::RootedVector<JSString *> keys(cx);
+    std::vector<size_t> perm;
+    std::vector<size_t> undefinedIndices;
+    if (!values.resize(len) || (comparefn.isUndefined() && !keys.resize(len))) {
+      Py_DECREF(items);
+      JS_ReportOutOfMemory(cx);
+      return false;
+    }
+    perm.reserve(len);
+    for (Py_ssize_t index = 0; index < len; index++) {
+      values[index].set(jsTypeFactory(cx, PyList_GET_ITEM(items, index)));
+      if (values[index].isUndefined()) {
+        undefinedIndices.push_back(index);
+        continue;
       }
-
-      JS::RootedValue callBack(cx, callbackfn);
-      JS::RootedFunction rootedFun(cx, JS_ValueToFunction(cx, callBack));
-      try {
-        quickSort(self, 0, len - 1, cx, rootedFun);
-      } catch (const char *message) {
-        return false;
+      if (comparefn.isUndefined()) {
+        JSString *key = JS::ToString(cx, values[index]);
+        if (!key) {
+          Py_DECREF(items);
+          return false;
+        }
+        keys[index].set(key);
       }
+      perm.push_back(index);
     }
-  }
 
-  if (PyErr_Occurred()) {
-    return false;
+    ArraySortState state = {cx, comparefn, values, keys};
+    std::vector<size_t> scratch(perm.size());
+    size_t *sorted;
+    if (!mergeSort(state, perm.data(), scratch.data(), perm.size(), &sorted)) {
+      Py_DECREF(items);
+      return false;
+    }
+
+    // write the permutation back in one pass
+    PyObject *sortedItems = PyList_New(len);
+    if (!sortedItems) {
+      Py_DECREF(items);
+      return false;
+    }
+    Py_ssize_t outIndex = 0;
+    for (size_t index = 0; index < perm.size(); index++) {
+      PyObject *item = PyList_GET_ITEM(items, sorted[index]);
+      Py_INCREF(item);
+      PyList_SET_ITEM(sortedItems, outIndex++, item);
+    }
+    for (size_t index : undefinedIndices) {
+      PyObject *item = PyList_GET_ITEM(items, index);
+      Py_INCREF(item);
+      PyList_SET_ITEM(sortedItems, outIndex++, item);
+    }
+    int result = PyList_SetSlice(self, 0, PyList_GET_SIZE(self), sortedItems);
+    Py_DECREF(sortedItems);
+    Py_DECREF(items);
+    if (result < 0) {
+      return false;
+    }
   }
 
   // return ref to self
@@ -1991,32 +2126,26 @@ static JSMethodDef array_methods[] = {
   {NULL, NULL, 0}
 };
 
+static JSSymbolMethodDef array_symbol_methods[] = {
+  {JS::SymbolCode::iterator, array_values, 0},
+  {JS::SymbolCode::iterator, NULL, 0}
+};
+
 
 bool PyListProxyHandler::getOwnPropertyDescriptor(
   JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
 ) const {
+  ProfilerLabel profilerLabel("PyListProxyHandler::getOwnPropertyDescriptor");
+  PYTHONMONKEY_HOT_PATH(PyListProxyHandler, getOwnPropertyDescriptor);
   // see if we're calling a function
-  if (id.isString()) {
-    for (size_t index = 0;; index++) {
-      bool isThatFunction;
-      const char *methodName = array_methods[index].name;
-      if (methodName == NULL) {   // reached end of list
-        break;
-      }
-      else if (JS_StringEqualsAscii(cx, id.toString(), methodName, &isThatFunction) && isThatFunction) {
-        JSFunction *newFunction = JS_NewFunction(cx, array_methods[index].call, array_methods[index].nargs, 0, NULL);
-        if (!newFunction) return false;
-        JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-        desc.set(mozilla::Some(
-          JS::PropertyDescriptor::Data(
-            JS::ObjectValue(*funObj),
-            {JS::PropertyAttribute::Enumerable}
-          )
-        ));
-        return true;
-      }
-    }
+  bool isMethod;
+  if (!getProxyMethod(cx, PyListMethodsSlot, array_methods, array_symbol_methods, id, desc, &isMethod)) {
+    return false;
+  }
+  if (isMethod) {
+    PYTHONMONKEY_HOT_PATH(PyListProxyHandler, methodLookup);
+    return true;
   }
 
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
@@ -2055,24 +2184,6 @@ bool PyListProxyHandler::getOwnPropertyDescriptor(
     return true;
   }
 
-  // symbol property
-  if (id.isSymbol()) {
-    JS::RootedSymbol rootedSymbol(cx, id.toSymbol());
-
-    if (JS::GetSymbolCode(rootedSymbol) == JS::SymbolCode::iterator) {
-      JSFunction *newFunction = JS_NewFunction(cx, array_values, 0, 0, NULL);
-      if (!newFunction) return false;
-      JS::RootedObject funObj(cx, JS_GetFunctionObject(newFunction));
-      desc.set(mozilla::Some(
-        JS::PropertyDescriptor::Data(
-          JS::ObjectValue(*funObj),
-          {JS::PropertyAttribute::Enumerable}
-        )
-      ));
-      return true;
-    }
-  }
-
   // item
   Py_ssize_t index;
   PyObject *item;
@@ -2093,8 +2204,10 @@ void PyListProxyHandler::finalize(JS::GCContext *gcx, JSObject *proxy) const {
   // We cannot call Py_DECREF here when shutting down as the thread state is gone.
   // Then, when shutting down, there is only on reference left, and we don't need
   // to free the object since the entire process memory is being released.
+  MemoryStats::countPyProxy(family(), -1);
   if (!Py_IsFinalizing()) {
     PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+    Retention::unpinPython(self, Retention::handlerName(family()));
     Py_DECREF(self);
   }
 }
@@ -2103,6 +2216,8 @@ bool PyListProxyHandler::defineProperty(
   JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::Handle<JS::PropertyDescriptor> desc, JS::ObjectOpResult &result
 ) const {
+  ProfilerLabel profilerLabel("PyListProxyHandler::defineProperty");
+  PYTHONMONKEY_HOT_PATH(PyListProxyHandler, defineProperty);
   Py_ssize_t index;
   if (!idToIndex(cx, id, &index)) { // not an int-like property key
     return result.failBadIndex();
@@ -2136,6 +2251,8 @@ bool PyListProxyHandler::defineProperty(
 }
 
 bool PyListProxyHandler::ownPropertyKeys(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  ProfilerLabel profilerLabel("PyListProxyHandler::ownPropertyKeys");
+  PYTHONMONKEY_HOT_PATH(PyListProxyHandler, ownPropertyKeys);
   // Modified from https://hg.mozilla.org/releases/mozilla-esr102/file/3b574e1/dom/base/RemoteOuterWindowProxy.cpp#l137
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
   int32_t length = PyList_Size(self);
@@ -2152,6 +2269,8 @@ bool PyListProxyHandler::ownPropertyKeys(JSContext *cx, JS::HandleObject proxy,
 }
 
 bool PyListProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::HandleId id, JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyListProxyHandler::delete_");
+  PYTHONMONKEY_HOT_PATH(PyListProxyHandler, delete);
   Py_ssize_t index;
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
   if (!idToIndex(cx, id, &index)) {
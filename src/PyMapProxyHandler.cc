@@ -0,0 +1,391 @@
+/**
+ * @file PyMapProxyHandler.cc
+ * @author agent (agent@local)
+ * @brief Struct for creating JS Map-like proxy objects for the Python dicts whose keys are not strings
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/PyMapProxyHandler.hh"
+
+#include "include/jsTypeFactory.hh"
+#include "include/pyTypeFactory.hh"
+
+#include <jsapi.h>
+#include <js/Proxy.h>
+#include <js/Symbol.h>
+
+#include <Python.h>
+
+const char PyMapProxyHandler::family = 0;
+
+bool PyMapProxyHandler::isMapLike(PyObject *dict) {
+  if (PyDict_Size(dict) == 0) {
+    return false;
+  }
+  PyObject *key, *value;
+  Py_ssize_t pos = 0;
+  while (PyDict_Next(dict, &pos, &key, &value)) {
+    if (PyUnicode_Check(key)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Get the Python dict of the `this` of a Map method
+ *
+ * @return PyObject* - a borrowed reference to the dict, or NULL with a JS exception set if `this` is not one of our Map proxies
+ */
+static PyObject *getSelf(JSContext *cx, JS::CallArgs &args, JS::MutableHandleObject proxy) {
+  if (!args.thisv().isObject() || !js::IsProxy(&args.thisv().toObject()) ||
+      js::GetProxyHandler(&args.thisv().toObject())->family() != &PyMapProxyHandler::family) {
+    JS_ReportErrorASCII(cx, "the Map method is not called on a proxy of a Python dict");
+    return NULL;
+  }
+  proxy.set(&args.thisv().toObject());
+  return JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+}
+
+/**
+ * @brief Convert a JS Map key to its Python dict key, JS Arrays become tuples so that they can be hashed
+ *
+ * @return PyObject* - a new reference to the key, or NULL with a Python exception set
+ */
+static PyObject *toPyKey(JSContext *cx, JS::HandleValue key) {
+  PyObject *pyKey = pyTypeFactory(cx, key);
+  if (pyKey && PyList_Check(pyKey)) {
+    PyObject *tuple = PySequence_Tuple(pyKey); // not PyList_AsTuple, a JSArrayProxy keeps its items in the JS Array
+    Py_DECREF(pyKey);
+    return tuple;
+  }
+  return pyKey;
+}
+
+/**
+ * @brief Look up a key of a dict
+ *
+ * @return int - 1 if the key is in the dict, 0 if it isn't or is unhashable, -1 with a Python exception set otherwise
+ */
+static int lookUp(PyObject *self, PyObject *pyKey, PyObject **item) {
+  *item = PyDict_GetItemWithError(self, pyKey); // borrowed reference
+  if (*item) {
+    return 1;
+  }
+  if (PyErr_Occurred()) {
+    if (!PyErr_ExceptionMatches(PyExc_TypeError)) {
+      return -1;
+    }
+    PyErr_Clear(); // an unhashable key, e.g. a JS object, as a JS Map would, there is no such entry
+  }
+  return 0;
+}
+
+static bool map_get(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  PyObject *pyKey = toPyKey(cx, args.get(0));
+  if (!pyKey) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *item;
+  int found = lookUp(self, pyKey, &item);
+  Py_DECREF(pyKey);
+  if (found < 0) {
+    setPyException(cx);
+    return false;
+  }
+  if (found) {
+    args.rval().set(jsTypeFactory(cx, item));
+  } else {
+    args.rval().setUndefined();
+  }
+  return true;
+}
+
+static bool map_has(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  PyObject *pyKey = toPyKey(cx, args.get(0));
+  if (!pyKey) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *item;
+  int found = lookUp(self, pyKey, &item);
+  Py_DECREF(pyKey);
+  if (found < 0) {
+    setPyException(cx);
+    return false;
+  }
+  args.rval().setBoolean(found);
+  return true;
+}
+
+static bool map_set(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  PyObject *pyKey = toPyKey(cx, args.get(0));
+  if (!pyKey) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *value = pyTypeFactory(cx, args.get(1));
+  if (!value) {
+    Py_DECREF(pyKey);
+    setPyException(cx);
+    return false;
+  }
+  int status = PyDict_SetItem(self, pyKey, value);
+  Py_DECREF(pyKey);
+  Py_DECREF(value);
+  if (status < 0) {
+    setPyException(cx); // e.g. an unhashable key
+    return false;
+  }
+  args.rval().setObject(*proxy);
+  return true;
+}
+
+static bool map_delete(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  PyObject *pyKey = toPyKey(cx, args.get(0));
+  if (!pyKey) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *item;
+  int found = lookUp(self, pyKey, &item);
+  if (found > 0 && PyDict_DelItem(self, pyKey) < 0) {
+    found = -1;
+  }
+  Py_DECREF(pyKey);
+  if (found < 0) {
+    setPyException(cx);
+    return false;
+  }
+  args.rval().setBoolean(found);
+  return true;
+}
+
+static bool map_clear(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  PyDict_Clear(self);
+  args.rval().setUndefined();
+  return true;
+}
+
+/**
+ * @brief Return a JS iterator of the Python iterator `iter(iterable)`, consumed lazily as the JS Map iterators are
+ */
+static bool returnIterator(JSContext *cx, JS::CallArgs &args, PyObject *iterable) {
+  if (!iterable) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *iterator = PyObject_GetIter(iterable);
+  Py_DECREF(iterable);
+  if (!iterator) {
+    setPyException(cx);
+    return false;
+  }
+  args.rval().set(jsTypeFactory(cx, iterator));
+  Py_DECREF(iterator);
+  return true;
+}
+
+static bool map_keys(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  Py_INCREF(self);
+  return returnIterator(cx, args, self);
+}
+
+static bool map_values(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  return returnIterator(cx, args, PyObject_CallMethod(self, "values", NULL));
+}
+
+static bool map_entries(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  // `map(list, self.items())`, the entries are lists so that they reach JS as Arrays, which can be destructured
+  PyObject *items = PyObject_CallMethod(self, "items", NULL);
+  if (!items) {
+    setPyException(cx);
+    return false;
+  }
+  PyObject *entries = PyObject_CallFunctionObjArgs((PyObject *)&PyMap_Type, (PyObject *)&PyList_Type, items, NULL);
+  Py_DECREF(items);
+  return returnIterator(cx, args, entries);
+}
+
+static bool map_forEach(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject proxy(cx);
+  PyObject *self = getSelf(cx, args, &proxy);
+  if (!self) {
+    return false;
+  }
+
+  if (!args.get(0).isObject() || !JS::IsCallable(&args.get(0).toObject())) {
+    JS_ReportErrorASCII(cx, "Map.prototype.forEach: the callback is not a function");
+    return false;
+  }
+  JS::RootedValue callback(cx, args.get(0));
+  JS::RootedValue thisArg(cx, args.get(1));
+
+  PyObject *items = PyDict_Items(self); // a snapshot, the callback may mutate the dict
+  if (!items) {
+    setPyException(cx);
+    return false;
+  }
+  Py_ssize_t length = PyList_GET_SIZE(items);
+  JS::Rooted<JS::ValueArray<3>> callArgs(cx);
+  JS::RootedValue ignored(cx);
+  for (Py_ssize_t index = 0; index < length; index++) {
+    PyObject *item = PyList_GET_ITEM(items, index);
+    callArgs[0].set(jsTypeFactory(cx, PyTuple_GET_ITEM(item, 1)));
+    callArgs[1].set(jsTypeFactory(cx, PyTuple_GET_ITEM(item, 0)));
+    callArgs[2].setObject(*proxy);
+    if (!JS::Call(cx, thisArg, callback, callArgs, &ignored)) {
+      Py_DECREF(items);
+      return false;
+    }
+  }
+  Py_DECREF(items);
+  args.rval().setUndefined();
+  return true;
+}
+
+static JSMethodDef map_methods[] = {
+  {"get", map_get, 1},
+  {"has", map_has, 1},
+  {"set", map_set, 2},
+  {"delete", map_delete, 1},
+  {"clear", map_clear, 0},
+  {"keys", map_keys, 0},
+  {"values", map_values, 0},
+  {"entries", map_entries, 0},
+  {"forEach", map_forEach, 1},
+  {NULL, NULL, 0}
+};
+
+static JSSymbolMethodDef map_symbol_methods[] = {
+  {JS::SymbolCode::iterator, map_entries, 0},
+  {JS::SymbolCode::iterator, NULL, 0}
+};
+
+bool PyMapProxyHandler::getOwnPropertyDescriptor(
+  JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+  JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
+) const {
+  bool isMethod;
+  if (!getProxyMethod(cx, PyMapMethodsSlot, map_methods, map_symbol_methods, id, desc, &isMethod)) {
+    return false;
+  }
+  if (isMethod) {
+    return true;
+  }
+
+  bool isSizeProperty;
+  if (id.isString() && JS_StringEqualsLiteral(cx, id.toString(), "size", &isSizeProperty) && isSizeProperty) {
+    PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+    desc.set(mozilla::Some(
+      JS::PropertyDescriptor::Data(
+        JS::NumberValue((double)PyDict_Size(self)),
+        {JS::PropertyAttribute::Enumerable}
+      )
+    ));
+    return true;
+  }
+
+  desc.set(mozilla::Nothing()); // the other properties, e.g. Symbol.toStringTag, are found on Map.prototype
+  return true;
+}
+
+bool PyMapProxyHandler::ownPropertyKeys(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  return true;
+}
+
+bool PyMapProxyHandler::getOwnEnumerablePropertyKeys(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  return true;
+}
+
+bool PyMapProxyHandler::enumerate(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  return true;
+}
+
+bool PyMapProxyHandler::hasOwn(JSContext *cx, JS::HandleObject proxy, JS::HandleId id, bool *bp) const {
+  JS::Rooted<mozilla::Maybe<JS::PropertyDescriptor>> desc(cx);
+  if (!getOwnPropertyDescriptor(cx, proxy, id, &desc)) {
+    return false;
+  }
+  *bp = desc.isSome();
+  return true;
+}
+
+bool PyMapProxyHandler::has(JSContext *cx, JS::HandleObject proxy, JS::HandleId id, bool *bp) const {
+  return hasOwn(cx, proxy, id, bp);
+}
+
+bool PyMapProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::HandleId id, JS::ObjectOpResult &result) const {
+  return result.succeed(); // the methods and `size` are not deletable, but not own data either
+}
+
+bool PyMapProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+  JS::HandleValue v, JS::HandleValue receiver, JS::ObjectOpResult &result) const {
+  return result.failReadOnly(); // the entries are set with `set()`, properties would not reach the dict
+}
+
+bool PyMapProxyHandler::defineProperty(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
+  JS::Handle<JS::PropertyDescriptor> desc, JS::ObjectOpResult &result) const {
+  return result.failInvalidDescriptor();
+}
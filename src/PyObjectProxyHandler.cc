@@ -11,7 +11,12 @@
 #include "include/PyObjectProxyHandler.hh"
 
 #include "include/jsTypeFactory.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/Profiler.hh"
+#include "include/HotPathStats.hh"
 #include "include/pyTypeFactory.hh"
+#include "include/TypeLayoutCache.hh"
 
 #include <jsapi.h>
 #include <jsfriendapi.h>
@@ -43,19 +48,18 @@ bool PyObjectProxyHandler::handleOwnPropertyKeys(JSContext *cx, PyObject *keys,
 
 bool PyObjectProxyHandler::handleGetOwnPropertyDescriptor(JSContext *cx, JS::HandleId id,
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc, PyObject *item) {
-  // see if we're calling a function
+  // see if we're calling a function, the ids are atoms so comparing them needs no encoding
   if (id.isString()) {
-    JS::UniqueChars idString = JS_EncodeStringToUTF8(cx, JS::RootedString(cx, id.toString()));
-    const char *methodName = idString.get();
+    JSLinearString *methodName = JS_ASSERT_STRING_IS_LINEAR(id.toString());
 
-    if (!strcmp(methodName, "toString") || !strcmp(methodName, "toLocaleString") || !strcmp(methodName, "valueOf")) {
+    if (JS_LinearStringEqualsLiteral(methodName, "toString") || JS_LinearStringEqualsLiteral(methodName, "toLocaleString") || JS_LinearStringEqualsLiteral(methodName, "valueOf")) {
       JS::RootedObject objectPrototype(cx);
       if (!JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype)) {
         return false;
       }
 
       JS::RootedValue Object_Prototype_Method(cx);
-      if (!JS_GetProperty(cx, objectPrototype, methodName, &Object_Prototype_Method)) {
+      if (!JS_GetPropertyById(cx, objectPrototype, id, &Object_Prototype_Method)) {
         return false;
       }
 
@@ -89,40 +93,33 @@ void PyObjectProxyHandler::finalize(JS::GCContext *gcx, JSObject *proxy) const {
   // We cannot call Py_DECREF here when shutting down as the thread state is gone.
   // Then, when shutting down, there is only on reference left, and we don't need
   // to free the object since the entire process memory is being released.
+  MemoryStats::countPyProxy(family(), -1);
   if (!Py_IsFinalizing()) {
     PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
+    Retention::unpinPython(self, Retention::handlerName(family()));
     Py_DECREF(self);
   }
 }
 
 bool PyObjectProxyHandler::ownPropertyKeys(JSContext *cx, JS::HandleObject proxy, JS::MutableHandleIdVector props) const {
+  ProfilerLabel profilerLabel("PyObjectProxyHandler::ownPropertyKeys");
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, ownPropertyKeys);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  PyObject *keys = PyObject_Dir(self);
-
-  if (keys != nullptr) {
-    size_t keysLength = PyList_Size(keys);
-
-    PyObject *nonDunderKeys = PyList_New(0);
-    for (size_t i = 0; i < keysLength; i++) {
-      PyObject *key = PyList_GetItem(keys, i);
-      if (PyObject_CallMethod(key, "startswith", "(s)", "__") == Py_False) { // if key starts with "__", ignore it
-        PyList_Append(nonDunderKeys, key);
-      }
-    }
-
-    return handleOwnPropertyKeys(cx, nonDunderKeys, PyList_Size(nonDunderKeys), props);
+  PyObject *keys = TypeLayoutCache::publicNames(self);
+  if (!keys) {
+    PyErr_Clear();
+    return true;
   }
-  else {
-    if (PyErr_Occurred()) {
-      PyErr_Clear();
-    }
 
-    return handleOwnPropertyKeys(cx, PyList_New(0), 0, props);
-  }
+  bool success = handleOwnPropertyKeys(cx, keys, PyList_GET_SIZE(keys), props);
+  Py_DECREF(keys);
+  return success;
 }
 
 bool PyObjectProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyObjectProxyHandler::delete_");
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, delete);
   PyObject *attrName = idToKey(cx, id);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
   if (PyObject_SetAttr(self, attrName, NULL) < 0) {
@@ -133,6 +130,7 @@ bool PyObjectProxyHandler::delete_(JSContext *cx, JS::HandleObject proxy, JS::Ha
 
 bool PyObjectProxyHandler::has(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   bool *bp) const {
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, has);
   return hasOwn(cx, proxy, id, bp);
 }
 
@@ -140,19 +138,23 @@ bool PyObjectProxyHandler::getOwnPropertyDescriptor(
   JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::MutableHandle<mozilla::Maybe<JS::PropertyDescriptor>> desc
 ) const {
+  ProfilerLabel profilerLabel("PyObjectProxyHandler::getOwnPropertyDescriptor");
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, getOwnPropertyDescriptor);
   PyObject *attrName = idToKey(cx, id);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  PyObject *item = PyObject_GetAttr(self, attrName);
-  if (!item && PyErr_ExceptionMatches(PyExc_AttributeError)) {
-    PyErr_Clear(); // clear error, we will be returning undefined in this case
-  }
+  PyObject *item = TypeLayoutCache::getAttr(self, attrName); // NULL without an error if missing, we will be returning undefined in this case
+  Py_DECREF(attrName);
 
-  return handleGetOwnPropertyDescriptor(cx, id, desc, item);
+  bool success = handleGetOwnPropertyDescriptor(cx, id, desc, item);
+  Py_XDECREF(item);
+  return success;
 }
 
 bool PyObjectProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   JS::HandleValue v, JS::HandleValue receiver,
   JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyObjectProxyHandler::set");
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, set);
   JS::RootedValue rootedV(cx, v);
   PyObject *attrName = idToKey(cx, id);
 
@@ -168,20 +170,30 @@ bool PyObjectProxyHandler::set(JSContext *cx, JS::HandleObject proxy, JS::Handle
 
 bool PyObjectProxyHandler::enumerate(JSContext *cx, JS::HandleObject proxy,
   JS::MutableHandleIdVector props) const {
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, enumerate);
   return this->ownPropertyKeys(cx, proxy, props);
 }
 
 bool PyObjectProxyHandler::hasOwn(JSContext *cx, JS::HandleObject proxy, JS::HandleId id,
   bool *bp) const {
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, hasOwn);
   PyObject *attrName = idToKey(cx, id);
   PyObject *self = JS::GetMaybePtrFromReservedSlot<PyObject>(proxy, PyObjectSlot);
-  *bp = PyObject_HasAttr(self, attrName) == 1;
+  PyObject *item = TypeLayoutCache::getAttr(self, attrName);
+  Py_DECREF(attrName);
+  *bp = item != NULL;
+  if (item) {
+    Py_DECREF(item);
+  } else {
+    PyErr_Clear(); // as PyObject_HasAttr does
+  }
   return true;
 }
 
 bool PyObjectProxyHandler::getOwnEnumerablePropertyKeys(
   JSContext *cx, JS::HandleObject proxy,
   JS::MutableHandleIdVector props) const {
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, getOwnEnumerablePropertyKeys);
   return this->ownPropertyKeys(cx, proxy, props);
 }
 
@@ -189,6 +201,8 @@ bool PyObjectProxyHandler::defineProperty(JSContext *cx, JS::HandleObject proxy,
   JS::HandleId id,
   JS::Handle<JS::PropertyDescriptor> desc,
   JS::ObjectOpResult &result) const {
+  ProfilerLabel profilerLabel("PyObjectProxyHandler::defineProperty");
+  PYTHONMONKEY_HOT_PATH(PyObjectProxyHandler, defineProperty);
   // Block direct `Object.defineProperty` since we already have the `set` method
   return result.failInvalidDescriptor();
 }
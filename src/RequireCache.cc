@@ -0,0 +1,448 @@
+/**
+ * @file RequireCache.cc
+ * @author agent (agent@local)
+ * @brief Cache of the file system lookups and of the module resolutions of the module loaders, optionally persisted between runs
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/RequireCache.hh"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+// the mode of the entries whose type the listing does not tell, e.g. symlinks: they are stat'd when they are looked up
+static const int UNKNOWN_MODE = 0;
+
+// the packages of a node_modules tree are not nested deeper than this, it also stops symlink cycles
+static const int MAX_PREWARM_DEPTH = 16;
+
+static const char *CACHE_FILE_HEADER = "pythonmonkey-require-cache 2";
+
+struct DirectoryListing {
+  long long mtime;
+  std::unordered_map<std::string, int> entries;
+};
+
+// the listings of the directories inside node_modules, by path
+static std::unordered_map<std::string, DirectoryListing> directories;
+// the modes of the existing paths inside node_modules that no listing answers for, and of the symlinks in the listings;
+// a missing path is not remembered, so that a package installed while the process runs is found
+static std::unordered_map<std::string, int> statCache;
+// the resolved paths, by loader, directory of the requiring module, search paths and module identifier
+static std::unordered_map<std::string, std::string> resolutions;
+
+static std::filesystem::path cacheFile;
+// whether the cache differs from its file
+static bool changed = false;
+
+static inline bool isFile(int mode) {
+  return mode != -1 && (mode & S_IFMT) == S_IFREG;
+}
+
+static inline bool isDirectory(int mode) {
+  return mode != -1 && (mode & S_IFMT) == S_IFDIR;
+}
+
+static inline bool insideNodeModules(const std::string &path) {
+  return path.find("node_modules") != std::string::npos;
+}
+
+static int statPath(const std::string &path) {
+  struct stat sb;
+  return stat(path.c_str(), &sb) == 0 ? (int)sb.st_mode : -1;
+}
+
+static bool modificationTime(const std::string &directory, long long &mtime) {
+  std::error_code error;
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(directory, error);
+  mtime = (long long)time.time_since_epoch().count();
+  return !error;
+}
+
+/**
+ * @brief stat a path, remembering its mode if it exists
+ */
+static int cachedStatPath(const std::string &path) {
+  int mode = statPath(path);
+  if (mode != -1) {
+    statCache[path] = mode;
+  }
+  return mode;
+}
+
+/**
+ * @brief The modification time and size of a file, which tell whether a resolution saved to it is still valid
+ */
+static bool fileSignature(const std::string &path, long long &mtime, long long &size) {
+  std::error_code error;
+  uintmax_t fileSize = std::filesystem::file_size(path, error);
+  if (error || !modificationTime(path, mtime)) {
+    return false;
+  }
+  size = (long long)fileSize;
+  return true;
+}
+
+static std::string resolutionKey(const std::string &kind, const std::string &baseDirectory, const std::string &searchPaths,
+  const std::string &specifier) {
+  return kind + '\t' + baseDirectory + '\t' + searchPaths + '\t' + specifier;
+}
+
+/**
+ * @brief List a directory, without a `stat` call per entry where the platform tells the types of the entries
+ *
+ * @return DirectoryListing* - the listing, or nullptr if the directory cannot be listed
+ */
+static DirectoryListing *listDirectory(const std::string &directory) {
+  DirectoryListing listing;
+  if (!modificationTime(directory, listing.mtime)) { // before listing, so that a concurrent change makes the listing stale
+    return nullptr;
+  }
+  std::error_code error;
+  std::filesystem::directory_iterator iterator(directory, error);
+  for (; !error && iterator != std::filesystem::directory_iterator(); iterator.increment(error)) {
+    std::error_code typeError;
+    std::filesystem::file_type type = iterator->symlink_status(typeError).type();
+    int mode = type == std::filesystem::file_type::regular ? S_IFREG : type == std::filesystem::file_type::directory ? S_IFDIR : UNKNOWN_MODE;
+    listing.entries.emplace(iterator->path().filename().string(), mode);
+  }
+  if (error) {
+    return nullptr;
+  }
+  changed = true;
+  return &(directories[directory] = std::move(listing));
+}
+
+/**
+ * @brief Answer for a path from the listing of its directory, or from an ancestor that is known not to be a directory
+ *
+ * @return true - `mode` is the mode of the path
+ * @return false - no listing answers for the path
+ */
+static bool knownMode(const std::filesystem::path &path, int &mode) {
+  std::filesystem::path parent = path.parent_path();
+  std::string parentString = parent.string();
+  if (parent == path || path.filename().empty() || !insideNodeModules(parentString)) {
+    return false;
+  }
+
+  auto listing = directories.find(parentString);
+  if (listing == directories.end()) {
+    int parentMode;
+    bool parentKnown = knownMode(parent, parentMode);
+    if (!parentKnown) {
+      auto found = statCache.find(parentString);
+      parentKnown = found != statCache.end();
+      parentMode = parentKnown ? found->second : -1;
+    }
+    if (parentKnown && !isDirectory(parentMode)) { // e.g. the candidates of a package that is not installed
+      mode = -1;
+      return true;
+    }
+    return false;
+  }
+
+  auto entry = listing->second.entries.find(path.filename().string());
+  if (entry == listing->second.entries.end()) {
+    // a missing entry is only trusted while the directory is unchanged, its mtime is checked instead of probing the path
+    long long mtime;
+    if (!modificationTime(parentString, mtime)) {
+      return false;
+    }
+    if (mtime != listing->second.mtime) {
+      DirectoryListing *fresh = listDirectory(parentString);
+      if (!fresh) {
+        return false;
+      }
+      entry = fresh->entries.find(path.filename().string());
+      if (entry == fresh->entries.end()) {
+        mode = -1;
+        return true;
+      }
+      mode = entry->second != UNKNOWN_MODE ? entry->second : cachedStatPath(path.string());
+      return true;
+    }
+    mode = -1;
+  } else if (entry->second != UNKNOWN_MODE) {
+    mode = entry->second;
+  } else { // the listing keeps the entry unknown, the target of a symlink may change between runs
+    std::string pathString = path.string();
+    auto found = statCache.find(pathString);
+    mode = found != statCache.end() ? found->second : cachedStatPath(pathString);
+  }
+  return true;
+}
+
+int RequireCache::statMode(const std::string &path) {
+  if (!insideNodeModules(path)) {
+    return statPath(path);
+  }
+  std::filesystem::path fsPath(path);
+  int mode;
+  if (knownMode(fsPath, mode)) {
+    return mode;
+  }
+  auto found = statCache.find(path);
+  if (found != statCache.end()) {
+    return found->second;
+  }
+
+  // the other candidates of a module are in the same directory: list it once instead of probing them one by one
+  std::string parent = fsPath.parent_path().string();
+  if (!fsPath.filename().empty() && insideNodeModules(parent)) {
+    if (listDirectory(parent) && knownMode(fsPath, mode)) {
+      return mode;
+    }
+    cachedStatPath(parent); // not a directory, if it is a file the paths below it do not exist either
+  }
+  return cachedStatPath(path);
+}
+
+void RequireCache::clear() {
+  directories.clear();
+  statCache.clear();
+  resolutions.clear();
+  changed = true;
+}
+
+std::string RequireCache::getResolution(const std::string &kind, const std::string &baseDirectory, const std::string &searchPaths,
+  const std::string &specifier) {
+  auto found = resolutions.find(resolutionKey(kind, baseDirectory, searchPaths, specifier));
+  if (found == resolutions.end()) {
+    return std::string();
+  }
+  if (!isFile(statMode(found->second))) {
+    resolutions.erase(found);
+    changed = true;
+    return std::string();
+  }
+  return found->second;
+}
+
+void RequireCache::setResolution(const std::string &kind, const std::string &baseDirectory, const std::string &searchPaths,
+  const std::string &specifier, const std::string &resolved) {
+  std::string &entry = resolutions[resolutionKey(kind, baseDirectory, searchPaths, specifier)];
+  if (entry != resolved) {
+    entry = resolved;
+    changed = true;
+  }
+}
+
+static bool ensureListed(const std::string &directory) {
+  return directories.count(directory) || listDirectory(directory);
+}
+
+static size_t listNodeModules(const std::filesystem::path &nodeModules, int depth);
+
+static size_t listPackage(const std::filesystem::path &package, int depth) {
+  if (!ensureListed(package.string())) {
+    return 0;
+  }
+  std::filesystem::path nested = package / "node_modules";
+  return 1 + (isDirectory(RequireCache::statMode(nested.string())) ? listNodeModules(nested, depth + 1) : 0);
+}
+
+static std::vector<std::string> entryNames(const std::string &directory) {
+  std::vector<std::string> names;
+  for (const auto &[name, mode] : directories[directory].entries) {
+    if (name[0] != '.') { // .bin, .package-lock.json
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+static size_t listNodeModules(const std::filesystem::path &nodeModules, int depth) {
+  if (depth > MAX_PREWARM_DEPTH || !ensureListed(nodeModules.string())) {
+    return 0;
+  }
+  size_t count = 1;
+  for (const std::string &name : entryNames(nodeModules.string())) {
+    std::filesystem::path entry = nodeModules / name;
+    if (!isDirectory(RequireCache::statMode(entry.string()))) {
+      continue;
+    }
+    if (name[0] != '@') {
+      count += listPackage(entry, depth);
+    } else if (ensureListed(entry.string())) { // a scope, its packages are one level below
+      count++;
+      for (const std::string &scopedName : entryNames(entry.string())) {
+        std::filesystem::path package = entry / scopedName;
+        if (isDirectory(RequireCache::statMode(package.string()))) {
+          count += listPackage(package, depth);
+        }
+      }
+    }
+  }
+  return count;
+}
+
+size_t RequireCache::prewarm(const std::string &directory) {
+  std::error_code error;
+  std::filesystem::path start = std::filesystem::absolute(directory, error).lexically_normal();
+  if (error) {
+    return 0;
+  }
+  size_t count = 0;
+  for (std::filesystem::path current = start;; current = current.parent_path()) {
+    if (current.filename() != "node_modules") {
+      std::filesystem::path nodeModules = current / "node_modules";
+      if (isDirectory(statMode(nodeModules.string()))) {
+        count += listNodeModules(nodeModules, 0);
+      }
+    }
+    if (current == current.parent_path()) {
+      return count;
+    }
+  }
+}
+
+static std::vector<std::string> splitFields(const std::string &line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  for (size_t tab; (tab = line.find('\t', start)) != std::string::npos; start = tab + 1) {
+    fields.push_back(line.substr(start, tab - start));
+  }
+  fields.push_back(line.substr(start));
+  return fields;
+}
+
+static bool hasSeparator(const std::string &field) {
+  return field.find_first_of("\t\n\r") != std::string::npos;
+}
+
+/**
+ * @brief Load the listings of the directories that did not change since they were saved, and the resolutions into them that are still files
+ */
+static void load(const std::filesystem::path &path) {
+  std::ifstream file(path);
+  std::string line;
+  if (!file || !std::getline(file, line) || line != CACHE_FILE_HEADER) {
+    return;
+  }
+
+  bool dropped = false;
+  DirectoryListing *listing = nullptr;
+  std::vector<std::vector<std::string>> savedResolutions;
+  while (std::getline(file, line)) {
+    std::vector<std::string> fields = splitFields(line);
+    if (fields[0] == "D" && fields.size() == 3) {
+      listing = nullptr;
+      long long savedTime = strtoll(fields[1].c_str(), nullptr, 10);
+      long long currentTime;
+      if (directories.count(fields[2])) {
+        continue; // listed by this process already
+      }
+      if (modificationTime(fields[2], currentTime) && currentTime == savedTime) {
+        listing = &directories[fields[2]];
+        listing->mtime = savedTime;
+      } else {
+        dropped = true;
+      }
+    } else if (fields[0] == "E" && fields.size() == 3) {
+      if (listing) {
+        listing->entries.emplace(fields[2], atoi(fields[1].c_str()));
+      }
+    } else if (fields[0] == "R" && fields.size() == 8) {
+      savedResolutions.push_back(std::move(fields));
+    }
+  }
+
+  for (const std::vector<std::string> &resolution : savedResolutions) {
+    const std::string &resolved = resolution[5];
+    long long mtime, size;
+    // the file itself is checked too: it may have been replaced without changing its directory
+    bool unchanged = fileSignature(resolved, mtime, size) &&
+                     mtime == strtoll(resolution[6].c_str(), nullptr, 10) && size == strtoll(resolution[7].c_str(), nullptr, 10);
+    if (unchanged && directories.count(std::filesystem::path(resolved).parent_path().string()) && isFile(RequireCache::statMode(resolved))) {
+      resolutions.emplace(resolutionKey(resolution[1], resolution[2], resolution[3], resolution[4]), resolved);
+    } else {
+      dropped = true;
+    }
+  }
+  changed = changed || dropped;
+}
+
+bool RequireCache::save() {
+  if (cacheFile.empty() || !changed) {
+    return true;
+  }
+  std::filesystem::path temporaryPath = cacheFile;
+  temporaryPath += "." + std::to_string(std::random_device()()) + ".tmp";
+  std::ofstream file(temporaryPath, std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+
+  file << CACHE_FILE_HEADER << '\n';
+  for (const auto &[directory, listing] : directories) {
+    if (hasSeparator(directory) || !std::filesystem::path(directory).is_absolute()) {
+      continue;
+    }
+    file << "D\t" << listing.mtime << '\t' << directory << '\n';
+    for (const auto &[name, mode] : listing.entries) {
+      if (!hasSeparator(name)) {
+        file << "E\t" << mode << '\t' << name << '\n';
+      }
+    }
+  }
+  // only the resolutions into the saved listings: their modification time tells whether they are still valid
+  for (const auto &[key, resolved] : resolutions) {
+    std::string directory = std::filesystem::path(resolved).parent_path().string();
+    bool oneLine = key.find_first_of("\n\r") == std::string::npos && !hasSeparator(resolved);
+    long long mtime, size;
+    if (oneLine && std::filesystem::path(resolved).is_absolute() && directories.count(directory) && fileSignature(resolved, mtime, size)) {
+      file << "R\t" << key << '\t' << resolved << '\t' << mtime << '\t' << size << '\n';
+    }
+  }
+  file.close();
+
+  std::error_code error;
+  if (file.fail()) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  std::filesystem::rename(temporaryPath, cacheFile, error); // atomic, concurrent runs never read a partial file
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  changed = false;
+  return true;
+}
+
+void RequireCache::setFile(const std::string &path) {
+  cacheFile = path;
+  if (!cacheFile.empty()) {
+    load(cacheFile);
+  }
+}
+
+void RequireCache::init() {
+  const char *environmentFile = getenv("PYTHONMONKEY_REQUIRE_CACHE");
+  if (environmentFile && *environmentFile) {
+    setFile(environmentFile);
+  }
+}
+
+void RequireCache::finalize() {
+  save();
+  directories.clear();
+  statCache.clear();
+  resolutions.clear();
+  cacheFile.clear();
+  changed = false;
+}
@@ -0,0 +1,375 @@
+/**
+ * @file Retention.cc
+ * @author agent (agent@local)
+ * @brief Tracking of the references across the Python <-> JS bridge that keep objects alive, for leak hunting
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/Retention.hh"
+
+#include "include/JSArrayProxy.hh"
+#include "include/JSFunctionProxy.hh"
+#include "include/JSMapProxy.hh"
+#include "include/JSMethodProxy.hh"
+#include "include/JSObjectProxy.hh"
+#include "include/JSSetProxy.hh"
+#include "include/MemoryStats.hh"
+#include "include/PyBytesProxyHandler.hh"
+#include "include/PyDictProxyHandler.hh"
+#include "include/PyIterableProxyHandler.hh"
+#include "include/PyListProxyHandler.hh"
+#include "include/PyMapProxyHandler.hh"
+#include "include/PyObjectProxyHandler.hh"
+
+#include <jsapi.h>
+#include <js/Stack.h>
+#include <js/UbiNode.h>
+
+#include <Python.h>
+#include <frameobject.h>
+#include "include/pyshim.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define RETENTION_STACK_FRAMES 16 // frames of each language recorded in a sampled allocation stack
+
+struct PythonPin {
+  const char *holder;
+  const std::string *stack; // interned in `stacks`, or nullptr if not sampled
+};
+
+// finalizers may run on a GC helper thread, and the Python proxies may be deallocated on any thread holding the GIL
+static std::mutex pinsMutex;
+static std::unordered_multimap<PyObject *, PythonPin> pythonPins; // a Python object may be held by several JS things
+static std::unordered_map<PyObject *, const std::string *> jsPins; // the Python proxies, to their allocation stacks
+static std::unordered_set<std::string> stacks;
+
+static double stackSampleRate = 0.0;
+static uint64_t stackSampleInterval = 0; // a stack every `stackSampleInterval` pins, none if 0
+static uint64_t pinsUntilSample = 0; // only updated by the pins, which hold the GIL
+
+void Retention::init() {
+  const char *rate = getenv("PYTHONMONKEY_TRACK_RETENTION");
+  if (rate && *rate) {
+    setTracking(true, strtod(rate, nullptr));
+  }
+}
+
+void Retention::setTracking(bool enabled, double sampleRate) {
+  std::lock_guard<std::mutex> lock(pinsMutex);
+  if (!enabled) {
+    tracking = false;
+    pythonPins.clear();
+    jsPins.clear();
+    stacks.clear();
+    stackSampleRate = 0.0;
+    stackSampleInterval = 0;
+    return;
+  }
+  stackSampleRate = std::isnan(sampleRate) ? 0.0 : std::clamp(sampleRate, 0.0, 1.0);
+  stackSampleInterval = stackSampleRate > 0.0 ? (uint64_t)std::llround(1.0 / stackSampleRate) : 0;
+  pinsUntilSample = stackSampleInterval;
+  tracking = true;
+}
+
+void Retention::finalize() {
+  setTracking(false, 0.0);
+}
+
+const char *Retention::handlerName(const void *family) {
+  if (family == &PyDictProxyHandler::family) {
+    return "PyDictProxyHandler";
+  } else if (family == &PyListProxyHandler::family) {
+    return "PyListProxyHandler";
+  } else if (family == &PyIterableProxyHandler::family) {
+    return "PyIterableProxyHandler";
+  } else if (family == &PyBytesProxyHandler::family) {
+    return "PyBytesProxyHandler";
+  } else if (family == &PyMapProxyHandler::family) {
+    return "PyMapProxyHandler";
+  }
+  return "PyObjectProxyHandler";
+}
+
+/**
+ * @brief Whether the stack of the current pin is sampled
+ */
+static bool sampleStack() {
+  if (stackSampleInterval == 0 || --pinsUntilSample > 0) {
+    return false;
+  }
+  pinsUntilSample = stackSampleInterval;
+  return true;
+}
+
+/**
+ * @brief Describe the innermost JS frames, then the innermost Python frames, most recent call first
+ */
+static std::string captureStack(JSContext *cx) {
+  std::string stack;
+
+  JS::AutoSaveExceptionState savedException(cx); // the stack is informative, a failure to capture it must not fail the conversion
+  JS::RootedObject stackObj(cx);
+  if (JS::CaptureCurrentStack(cx, &stackObj, JS::StackCapture(JS::MaxFrames(RETENTION_STACK_FRAMES))) && stackObj) {
+    JS::RootedString stackStr(cx);
+    if (JS::BuildStackString(cx, nullptr, stackObj, &stackStr, 2, js::StackFormat::SpiderMonkey)) {
+      JS::UniqueChars stackUtf8 = JS_EncodeStringToUTF8(cx, stackStr);
+      if (stackUtf8) {
+        stack.append("JS:\n").append(stackUtf8.get());
+      }
+    }
+  }
+
+  PyObject *type, *value, *traceback;
+  PyErr_Fetch(&type, &value, &traceback);
+  PyFrameObject *frame = PyEval_GetFrame(); // borrowed reference
+  Py_XINCREF(frame);
+  if (frame) {
+    stack.append("Python:\n");
+  }
+  for (int depth = 0; frame && depth < RETENTION_STACK_FRAMES; depth++) {
+    PyCodeObject *code = PyFrame_GetCode(frame);
+    const char *filename = PyUnicode_AsUTF8(code->co_filename);
+    const char *name = PyUnicode_AsUTF8(code->co_name);
+    stack.append("  ").append(name ? name : "?").append(" (").append(filename ? filename : "?").append(":")
+    .append(std::to_string(PyFrame_GetLineNumber(frame))).append(")\n");
+    Py_DECREF(code);
+    PyFrameObject *back = PyFrame_GetBack(frame);
+    Py_DECREF(frame);
+    frame = back;
+  }
+  Py_XDECREF(frame);
+  PyErr_Clear();
+  PyErr_Restore(type, value, traceback);
+
+  return stack;
+}
+
+void Retention::recordPython(JSContext *cx, PyObject *pyObject, const char *holder) {
+  std::string stack;
+  bool sampled = cx && sampleStack();
+  if (sampled) {
+    stack = captureStack(cx);
+  }
+  std::lock_guard<std::mutex> lock(pinsMutex);
+  if (!tracking) { // stopped by another thread while the stack was captured
+    return;
+  }
+  const std::string *interned = sampled ? &*stacks.insert(std::move(stack)).first : nullptr;
+  pythonPins.emplace(pyObject, PythonPin{holder, interned});
+}
+
+void Retention::forgetPython(PyObject *pyObject, const char *holder) {
+  std::lock_guard<std::mutex> lock(pinsMutex);
+  auto range = pythonPins.equal_range(pyObject);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (strcmp(it->second.holder, holder) == 0) {
+      pythonPins.erase(it);
+      return;
+    }
+  }
+}
+
+void Retention::recordJS(JSContext *cx, PyObject *proxy) {
+  std::string stack;
+  bool sampled = cx && sampleStack();
+  if (sampled) {
+    stack = captureStack(cx);
+  }
+  std::lock_guard<std::mutex> lock(pinsMutex);
+  if (!tracking) {
+    return;
+  }
+  jsPins[proxy] = sampled ? &*stacks.insert(std::move(stack)).first : nullptr;
+}
+
+void Retention::forgetJS(PyObject *proxy) {
+  std::lock_guard<std::mutex> lock(pinsMutex);
+  jsPins.erase(proxy);
+}
+
+/**
+ * @brief A recorded reference, copied out of the maps so that it can be measured without holding the mutex
+ */
+struct PinSnapshot {
+  PyObject *object; // the Python object pinned by JS, or the Python proxy pinning a JS object; a new reference
+  const char *holder; // the Python pins only, the proxy type is found when measuring
+  std::string stack;
+};
+
+struct RetentionGroup {
+  size_t count = 0;
+  size_t bytes = 0;
+  std::map<std::string, size_t> stacks;
+};
+
+typedef std::map<std::pair<std::string, std::string>, RetentionGroup> RetentionGroups; // by (holder, type)
+
+/**
+ * @brief Find the JS object rooted by a Python proxy, the JSObjectProxy and JSArrayProxy types being named after dict and list
+ *
+ * @param proxy - the Python proxy
+ * @param obj - set to the JS object, or nullptr if there is none yet
+ * @return const char* - the name of the proxy type
+ */
+static const char *pinnedJSObject(PyObject *proxy, JSObject **obj) {
+  JS::PersistentRootedObject *root = nullptr;
+  const char *name = Py_TYPE(proxy)->tp_name;
+  if (PyObject_TypeCheck(proxy, &JSArrayProxyType)) {
+    root = ((JSArrayProxy *)proxy)->jsArray;
+    name = "JSArrayProxy";
+  } else if (PyObject_TypeCheck(proxy, &JSObjectProxyType)) {
+    root = ((JSObjectProxy *)proxy)->jsObject;
+    name = "JSObjectProxy";
+  } else if (PyObject_TypeCheck(proxy, &JSMethodProxyType)) {
+    root = ((JSMethodProxy *)proxy)->jsFunc;
+    name = "JSMethodProxy";
+  } else if (PyObject_TypeCheck(proxy, &JSFunctionProxyType)) {
+    root = ((JSFunctionProxy *)proxy)->jsFunc;
+    name = "JSFunctionProxy";
+  } else if (PyObject_TypeCheck(proxy, &JSMapProxyType)) {
+    root = ((JSMapProxy *)proxy)->jsMap;
+  } else if (PyObject_TypeCheck(proxy, &JSSetProxyType)) {
+    root = ((JSSetProxy *)proxy)->jsSet;
+  }
+  *obj = root ? root->get() : nullptr;
+  return name;
+}
+
+/**
+ * @brief Convert the groups to a Python list of dicts, sorted by decreasing size
+ */
+static PyObject *groupsToPython(const RetentionGroups &groups, const char *typeKey) {
+  std::vector<const RetentionGroups::value_type *> sorted;
+  for (const auto &group : groups) {
+    sorted.push_back(&group);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [](const RetentionGroups::value_type *a, const RetentionGroups::value_type *b) {
+    return a->second.bytes > b->second.bytes;
+  });
+
+  PyObject *list = PyList_New(0);
+  if (!list) {
+    return NULL;
+  }
+  for (const RetentionGroups::value_type *group : sorted) {
+    PyObject *stackList = PyList_New(0);
+    if (!stackList) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    for (const auto &stack : group->second.stacks) {
+      PyObject *entry = Py_BuildValue("{s:n,s:s#}", "count", (Py_ssize_t)stack.second, "stack", stack.first.c_str(), (Py_ssize_t)stack.first.size());
+      if (!entry || PyList_Append(stackList, entry) < 0) {
+        Py_XDECREF(entry);
+        Py_DECREF(stackList);
+        Py_DECREF(list);
+        return NULL;
+      }
+      Py_DECREF(entry);
+    }
+    PyObject *item = Py_BuildValue("{s:s,s:s,s:n,s:n,s:N}",
+      "holder", group->first.first.c_str(),
+      typeKey, group->first.second.c_str(),
+      "count", (Py_ssize_t)group->second.count,
+      "bytes", (Py_ssize_t)group->second.bytes,
+      "stacks", stackList
+    );
+    if (!item || PyList_Append(list, item) < 0) {
+      Py_XDECREF(item);
+      Py_DECREF(list);
+      return NULL;
+    }
+    Py_DECREF(item);
+  }
+  return list;
+}
+
+PyObject *Retention::toPython() {
+  std::vector<PinSnapshot> pythonSnapshot, jsSnapshot;
+  double sampleRate;
+  bool enabled;
+  {
+    std::lock_guard<std::mutex> lock(pinsMutex);
+    enabled = tracking;
+    sampleRate = stackSampleRate;
+    pythonSnapshot.reserve(pythonPins.size());
+    for (const auto &pin : pythonPins) {
+      Py_INCREF(pin.first);
+      pythonSnapshot.push_back({pin.first, pin.second.holder, pin.second.stack ? *pin.second.stack : std::string()});
+    }
+    jsSnapshot.reserve(jsPins.size());
+    for (const auto &pin : jsPins) {
+      Py_INCREF(pin.first);
+      jsSnapshot.push_back({pin.first, nullptr, pin.second ? *pin.second : std::string()});
+    }
+  }
+
+  // measure the Python objects with sys.getsizeof, which also counts the GC header and calls __sizeof__
+  RetentionGroups pythonGroups;
+  PyObject *getsizeof = PySys_GetObject("getsizeof"); // borrowed reference
+  for (const PinSnapshot &pin : pythonSnapshot) {
+    RetentionGroup &group = pythonGroups[{pin.holder, Py_TYPE(pin.object)->tp_name}];
+    group.count++;
+    PyObject *size = getsizeof ? PyObject_CallOneArg(getsizeof, pin.object) : NULL;
+    if (size) {
+      size_t bytes = PyLong_AsSize_t(size);
+      if (bytes != (size_t)-1) { // a negative or huge result of __sizeof__ counts as empty
+        group.bytes += bytes;
+      }
+      Py_DECREF(size);
+    }
+    PyErr_Clear(); // objects whose __sizeof__ fails count as empty
+    if (!pin.stack.empty()) {
+      group.stacks[pin.stack]++;
+    }
+  }
+
+  // measure the JS objects with the size of their ubi::Node, the GC cell and the malloc'd slots and elements
+  RetentionGroups jsGroups;
+  for (const PinSnapshot &pin : jsSnapshot) {
+    JSObject *obj;
+    const char *holder = pinnedJSObject(pin.object, &obj);
+    RetentionGroup &group = jsGroups[{holder, obj ? JS::GetClass(obj)->name : "(none)"}];
+    group.count++;
+    if (obj) {
+      group.bytes += JS::ubi::Node(obj).size(MemoryStats::mallocSizeOf);
+    }
+    if (!pin.stack.empty()) {
+      group.stacks[pin.stack]++;
+    }
+  }
+
+  for (const PinSnapshot &pin : pythonSnapshot) {
+    Py_DECREF(pin.object);
+  }
+  for (const PinSnapshot &pin : jsSnapshot) {
+    Py_DECREF(pin.object);
+  }
+
+  PyObject *pythonObjects = groupsToPython(pythonGroups, "type");
+  PyObject *jsObjects = pythonObjects ? groupsToPython(jsGroups, "class") : NULL;
+  if (!jsObjects) {
+    Py_XDECREF(pythonObjects);
+    return NULL;
+  }
+  return Py_BuildValue("{s:O,s:d,s:N,s:N}",
+    "tracking", enabled ? Py_True : Py_False,
+    "stackSampleRate", sampleRate,
+    "pythonObjects", pythonObjects,
+    "jsObjects", jsObjects
+  );
+}
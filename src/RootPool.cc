@@ -0,0 +1,152 @@
+/**
+ * @file RootPool.cc
+ * @author agent (agent@local)
+ * @brief Pool of the persistent roots of the JS values held by the Python proxies
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/RootPool.hh"
+
+#include <jsapi.h>
+
+#include <vector>
+
+static const size_t SLAB_SIZE = 256;
+
+/**
+ * @brief The roots of one type, the slabs are never freed: a root lives as long as the process once linked
+ */
+template<typename T>
+struct Pool {
+  std::vector<JS::PersistentRooted<T> *> slabs;
+  std::vector<JS::PersistentRooted<T> *> freeRoots;
+  bool finalized = false;
+
+  JS::PersistentRooted<T> *acquire(JSContext *cx, const T &initial) {
+    if (finalized) {
+      return new JS::PersistentRooted<T>(cx, initial); // leaked, the proxies made during shutdown are never deallocated
+    }
+    if (freeRoots.empty()) {
+      JS::PersistentRooted<T> *slab = new JS::PersistentRooted<T>[SLAB_SIZE];
+      slabs.push_back(slab);
+      for (size_t i = SLAB_SIZE; i > 0; i--) {
+        slab[i - 1].init(JS::RootingContext::get(cx));
+        freeRoots.push_back(&slab[i - 1]);
+      }
+    }
+    JS::PersistentRooted<T> *root = freeRoots.back();
+    freeRoots.pop_back();
+    root->set(initial);
+    return root;
+  }
+
+  void release(JS::PersistentRooted<T> *root) {
+    if (!root || finalized) {
+      return;
+    }
+    root->set(JS::SafelyInitialized<T>::create()); // a cleared root costs nothing to trace
+    freeRoots.push_back(root);
+  }
+
+  void clear() {
+    for (JS::PersistentRooted<T> *slab : slabs) {
+      for (size_t i = 0; i < SLAB_SIZE; i++) {
+        slab[i].set(JS::SafelyInitialized<T>::create());
+      }
+    }
+    freeRoots.clear();
+    finalized = true;
+  }
+};
+
+/**
+ * @brief The roots of the vectors of one type, allocated one by one as they are used by fewer proxies, the iterators.
+ * A released vector is emptied but keeps its buffer if it is small, so that the next iterator doesn't allocate one either.
+ */
+template<typename T>
+struct VectorPool {
+  static const size_t MAX_FREE = 64;
+  static const size_t MAX_KEPT_CAPACITY = 1024;
+  std::vector<JS::PersistentRooted<T> *> freeRoots;
+  bool finalized = false;
+
+  JS::PersistentRooted<T> *acquire(JSContext *cx) {
+    if (finalized || freeRoots.empty()) {
+      return new JS::PersistentRooted<T>(cx); // leaked once finalized, as for the slabs
+    }
+    JS::PersistentRooted<T> *root = freeRoots.back();
+    freeRoots.pop_back();
+    return root;
+  }
+
+  void release(JS::PersistentRooted<T> *root) {
+    if (!root || finalized) {
+      return;
+    }
+    if (freeRoots.size() == MAX_FREE) {
+      delete root;
+      return;
+    }
+    if (root->get().capacity() > MAX_KEPT_CAPACITY) {
+      root->get().clearAndFree();
+    } else {
+      root->get().clear();
+    }
+    freeRoots.push_back(root);
+  }
+
+  void clear() {
+    for (JS::PersistentRooted<T> *root : freeRoots) {
+      root->get().clearAndFree();
+    }
+    freeRoots.clear();
+    finalized = true;
+  }
+};
+
+static Pool<JSObject *> objectRoots;
+static Pool<JS::Value> valueRoots;
+static VectorPool<JS::StackGCVector<jsid>> idVectorRoots;
+static VectorPool<JS::StackGCVector<JS::Value>> valueVectorRoots;
+
+JS::PersistentRootedObject *RootPool::newRoot(JSContext *cx, JSObject *obj) {
+  return objectRoots.acquire(cx, obj);
+}
+
+JS::PersistentRootedValue *RootPool::newValueRoot(JSContext *cx, const JS::Value &value) {
+  return valueRoots.acquire(cx, value);
+}
+
+void RootPool::deleteRoot(JS::PersistentRootedObject *root) {
+  objectRoots.release(root);
+}
+
+void RootPool::deleteRoot(JS::PersistentRootedValue *root) {
+  valueRoots.release(root);
+}
+
+JS::PersistentRootedIdVector *RootPool::newIdVectorRoot(JSContext *cx) {
+  return idVectorRoots.acquire(cx);
+}
+
+JS::PersistentRootedValueVector *RootPool::newValueVectorRoot(JSContext *cx) {
+  return valueVectorRoots.acquire(cx);
+}
+
+void RootPool::deleteRoot(JS::PersistentRootedIdVector *root) {
+  idVectorRoots.release(root);
+}
+
+void RootPool::deleteRoot(JS::PersistentRootedValueVector *root) {
+  valueVectorRoots.release(root);
+}
+
+void RootPool::finalize() {
+  objectRoots.clear();
+  valueRoots.clear();
+  idVectorRoots.clear();
+  valueVectorRoots.clear();
+}
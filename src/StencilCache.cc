@@ -0,0 +1,360 @@
+/**
+ * @file StencilCache.cc
+ * @author agent (agent@local)
+ * @brief Cache of the compiled stencils of the scripts evaluated by pythonmonkey.eval, in memory and optionally on disk
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/StencilCache.hh"
+
+#include "include/Metrics.hh"
+
+#include <jsapi.h>
+#include <js/BuildId.h>
+#include <js/CompileOptions.h>
+#include <js/SourceText.h>
+#include <js/Transcoding.h>
+#include <js/experimental/JSStencil.h>
+#include <mozilla/RefPtr.h>
+
+#include <Python.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <random>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#ifndef PYTHONMONKEY_VERSION
+#define PYTHONMONKEY_VERSION "0"
+#endif
+
+// encoded stencils are only decoded by the same build of PythonMonkey and the same version of SpiderMonkey,
+// as a rebuilt engine can be loaded by an unchanged object file
+static std::string buildId;
+static std::string environmentDirectory;
+static const char FILE_MAGIC[8] = {'P', 'M', 'S', 'T', 'N', 'C', 'L', '2'};
+
+struct Entry {
+  std::string key;
+  std::string source; // compared on each hit, the key only has the hash of the source
+  RefPtr<JS::Stencil> stencil;
+};
+
+static size_t maxEntries = 256;
+static std::filesystem::path directory;
+
+// most recently used first
+static std::list<Entry> entries;
+static std::unordered_map<std::string, std::list<Entry>::iterator> entriesByKey;
+
+static bool getBuildId(JS::BuildIdCharVector *vector) {
+  return vector->append(buildId.data(), buildId.size());
+}
+
+/**
+ * @brief 64-bit FNV-1a, stable across processes unlike std::hash, so it can name the files of the on-disk store
+ */
+static uint64_t hashBytes(const char *bytes, size_t length, uint64_t hash = 0xcbf29ce484222325ULL) {
+  for (size_t index = 0; index < length; index++) {
+    hash = (hash ^ (unsigned char)bytes[index]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * @brief The cache key of a script: the hash and length of its source, and the options that change its stencil
+ */
+static std::string makeKey(const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length) {
+  char header[96];
+  snprintf(header, sizeof(header), "%016llx:%zu:%u:%u:%d%d%d%d%d:",
+    (unsigned long long)hashBytes(chars, length), length,
+    options.lineno, options.column.oneOriginValue(),
+    options.isRunOnce, options.noScriptRval, options.mutedErrors(), options.forceStrictMode(), options.selfHostingMode);
+  std::string key(header);
+  if (const char *filename = options.filename().c_str()) {
+    key += filename;
+  }
+  return key;
+}
+
+/**
+ * @brief Find the entry of a key, if it was compiled from the same source
+ */
+static std::list<Entry>::iterator findEntry(const std::string &key, const char *chars, size_t length) {
+  auto found = entriesByKey.find(key);
+  if (found == entriesByKey.end() || found->second->source.compare(0, std::string::npos, chars, length) != 0) {
+    return entries.end();
+  }
+  return found->second;
+}
+
+static void remember(const std::string &key, const char *chars, size_t length, JS::Stencil *stencil) {
+  if (maxEntries == 0) {
+    return;
+  }
+  auto colliding = entriesByKey.find(key);
+  if (colliding != entriesByKey.end()) { // another source with the same hash
+    entries.erase(colliding->second);
+  }
+  entries.push_front(Entry{key, std::string(chars, length), stencil});
+  entriesByKey[key] = entries.begin();
+  while (entries.size() > maxEntries) {
+    entriesByKey.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+static std::filesystem::path storePath(const std::string &key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.stencil", (unsigned long long)hashBytes(key.data(), key.size()));
+  return directory / name;
+}
+
+/**
+ * @brief Read the stencil stored for a key, the file starts with the magic, the full key and the source to rule out hash collisions
+ */
+static already_AddRefed<JS::Stencil> readStencil(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const std::string &key,
+  const char *chars, size_t length) {
+  FILE *file = fopen(storePath(key).string().c_str(), "rb");
+  if (!file) {
+    return nullptr;
+  }
+
+  std::string contents;
+  char buffer[65536];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, count);
+  }
+  fclose(file);
+
+  size_t headerLength = sizeof(FILE_MAGIC) + key.size() + 1 + length;
+  if (contents.size() <= headerLength ||
+      memcmp(contents.data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 ||
+      contents.compare(sizeof(FILE_MAGIC), key.size() + 1, key.c_str(), key.size() + 1) != 0 ||
+      contents.compare(sizeof(FILE_MAGIC) + key.size() + 1, length, chars, length) != 0) {
+    return nullptr;
+  }
+
+  JS::DecodeOptions decodeOptions(options);
+  JS::TranscodeRange range((const uint8_t *)contents.data() + headerLength, contents.size() - headerLength);
+  JS::Stencil *stencil = nullptr;
+  if (JS::DecodeStencil(cx, decodeOptions, range, &stencil) != JS::TranscodeResult::Ok) {
+    JS_ClearPendingException(cx); // stale or corrupted, compiled again and overwritten
+    return nullptr;
+  }
+  return already_AddRefed<JS::Stencil>(stencil);
+}
+
+/**
+ * @brief Store the stencil of a key, through a temporary file renamed into place so that concurrent processes never read a partial file
+ */
+static bool writeStencil(JSContext *cx, JS::Stencil *stencil, const std::string &key, const char *chars, size_t length) {
+  JS::TranscodeBuffer buffer;
+  if (JS::EncodeStencil(cx, stencil, buffer) != JS::TranscodeResult::Ok) {
+    JS_ClearPendingException(cx);
+    return false;
+  }
+
+  std::filesystem::path path = storePath(key);
+  std::filesystem::path temporaryPath = path;
+  temporaryPath += "." + std::to_string(std::random_device()()) + ".tmp";
+  FILE *file = fopen(temporaryPath.string().c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  bool ok = fwrite(FILE_MAGIC, 1, sizeof(FILE_MAGIC), file) == sizeof(FILE_MAGIC) &&
+            fwrite(key.c_str(), 1, key.size() + 1, file) == key.size() + 1 &&
+            fwrite(chars, 1, length, file) == length &&
+            fwrite(buffer.begin(), 1, buffer.length(), file) == buffer.length();
+  ok = fclose(file) == 0 && ok;
+
+  std::error_code error;
+  if (ok) {
+    std::filesystem::rename(temporaryPath, path, error);
+  }
+  if (!ok || error) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+}
+
+bool StencilCache::init() {
+  buildId = "pythonmonkey-" PYTHONMONKEY_VERSION " " __DATE__ " " __TIME__ " ";
+  buildId += JS_GetImplementationVersion();
+  JS::SetProcessBuildIdOp(getBuildId);
+
+  const char *environmentValue = getenv("PYTHONMONKEY_STENCIL_CACHE");
+  if (environmentValue && *environmentValue) {
+    std::error_code error;
+    std::filesystem::create_directories(environmentValue, error);
+    if (!error) { // an unusable directory only disables the on-disk store
+      environmentDirectory = environmentValue;
+      directory = environmentDirectory;
+    }
+  }
+  return true;
+}
+
+const std::string &StencilCache::defaultDirectory() {
+  return environmentDirectory;
+}
+
+// the encoded self-hosted stencil, the runtime may keep pointers to it so it lives as long as the process
+static std::string selfHostedCache;
+
+static std::filesystem::path selfHostedCachePath() {
+  char name[48];
+  snprintf(name, sizeof(name), "selfhosted-%016llx.stencil", (unsigned long long)hashBytes(buildId.data(), buildId.size()));
+  return directory / name;
+}
+
+static bool writeSelfHostedCache(JSContext *cx, JS::SelfHostedCache data) {
+  std::filesystem::path path = selfHostedCachePath();
+  std::filesystem::path temporaryPath = path;
+  temporaryPath += "." + std::to_string(std::random_device()()) + ".tmp";
+  FILE *file = fopen(temporaryPath.string().c_str(), "wb");
+  if (file) {
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    std::error_code error;
+    if (ok) {
+      std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!ok || error) {
+      std::filesystem::remove(temporaryPath, error);
+    }
+  }
+  return true; // the store is an optimization, failing to write it is not an error
+}
+
+bool StencilCache::initSelfHostedCode(JSContext *cx) {
+  if (directory.empty()) {
+    return JS::InitSelfHostedCode(cx);
+  }
+
+  FILE *file = fopen(selfHostedCachePath().string().c_str(), "rb");
+  if (file) {
+    char buffer[65536];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      selfHostedCache.append(buffer, count);
+    }
+    fclose(file);
+  }
+  // a missing or stale cache (rejected by its build id) is compiled again, then written
+  JS::SelfHostedCache cache((const uint8_t *)selfHostedCache.data(), selfHostedCache.size());
+  return JS::InitSelfHostedCode(cx, cache, writeSelfHostedCache);
+}
+
+void StencilCache::finalize() {
+  entriesByKey.clear();
+  entries.clear();
+}
+
+/**
+ * @brief Get the stencil of a script or module from the cache, or compile it and remember it
+ */
+static already_AddRefed<JS::Stencil> getStencil(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length, bool isModule) {
+  std::string key = makeKey(options, chars, length);
+  if (isModule) {
+    key.insert(0, "module:");
+  }
+
+  auto found = findEntry(key, chars, length);
+  if (found != entries.end()) {
+    entries.splice(entries.begin(), entries, found);
+    Metrics::stencilMemoryHits++;
+    return do_AddRef(found->stencil);
+  }
+
+  RefPtr<JS::Stencil> stencil;
+  if (!directory.empty()) {
+    stencil = readStencil(cx, options, key, chars, length);
+    if (stencil) {
+      Metrics::stencilDiskHits++;
+    }
+  }
+
+  if (!stencil) {
+    JS::SourceText<mozilla::Utf8Unit> source;
+    if (!source.init(cx, chars, length, JS::SourceOwnership::Borrowed)) {
+      return nullptr;
+    }
+    stencil = isModule ? JS::CompileModuleScriptToStencil(cx, options, source) : JS::CompileGlobalScriptToStencil(cx, options, source);
+    if (!stencil) {
+      return nullptr;
+    }
+    Metrics::stencilsCompiled++;
+    if (!directory.empty() && writeStencil(cx, stencil, key, chars, length)) {
+      Metrics::stencilsStored++;
+    }
+  }
+
+  remember(key, chars, length, stencil);
+  return stencil.forget();
+}
+
+JSScript *StencilCache::compile(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length) {
+  RefPtr<JS::Stencil> stencil = getStencil(cx, options, chars, length, false);
+  if (!stencil) {
+    return nullptr;
+  }
+  JS::InstantiateOptions instantiateOptions(options);
+  return JS::InstantiateGlobalStencil(cx, instantiateOptions, stencil);
+}
+
+bool StencilCache::contains(const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length) {
+  return findEntry(makeKey(options, chars, length), chars, length) != entries.end();
+}
+
+JSScript *StencilCache::instantiate(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length, JS::Stencil *stencil) {
+  std::string key = makeKey(options, chars, length);
+  if (findEntry(key, chars, length) == entries.end()) {
+    Metrics::stencilsCompiled++;
+    if (!directory.empty() && writeStencil(cx, stencil, key, chars, length)) {
+      Metrics::stencilsStored++;
+    }
+    remember(key, chars, length, stencil);
+  }
+  JS::InstantiateOptions instantiateOptions(options);
+  return JS::InstantiateGlobalStencil(cx, instantiateOptions, stencil);
+}
+
+JSObject *StencilCache::compileModule(JSContext *cx, const JS::ReadOnlyCompileOptions &options, const char *chars, size_t length) {
+  RefPtr<JS::Stencil> stencil = getStencil(cx, options, chars, length, true);
+  if (!stencil) {
+    return nullptr;
+  }
+  JS::InstantiateOptions instantiateOptions(options);
+  return JS::InstantiateModuleStencil(cx, instantiateOptions, stencil);
+}
+
+bool StencilCache::configure(size_t newMaxEntries, const std::string &newDirectory) {
+  if (!newDirectory.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(newDirectory, error);
+    if (error) {
+      PyErr_Format(PyExc_OSError, "cannot create the stencil cache directory %s: %s", newDirectory.c_str(), error.message().c_str());
+      return false;
+    }
+  }
+  directory = newDirectory;
+
+  maxEntries = newMaxEntries;
+  while (entries.size() > maxEntries) {
+    entriesByKey.erase(entries.back().key);
+    entries.pop_back();
+  }
+  return true;
+}
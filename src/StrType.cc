@@ -10,11 +10,24 @@
 
 #include "include/StrType.hh"
 #include "include/JSStringProxy.hh"
+#include "include/RootPool.hh"
 #include "include/jsTypeFactory.hh"
+#include "include/setSpiderMonkeyException.hh"
 
 #include <jsapi.h>
+#include <js/CharacterEncoding.h>
 #include <js/String.h>
 
+#include <cstring>
+#include <string>
+#include <tuple>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
 #define PY_UNICODE_HAS_WSTR (PY_VERSION_HEX < 0x030c0000) // Python version is less than 3.12
 
 #define HIGH_SURROGATE_START 0xD800
@@ -22,6 +35,8 @@
 #define LOW_SURROGATE_START 0xDC00
 #define LOW_SURROGATE_END 0xDFFF
 
+#define UTF8_WRITE_CHUNK_SIZE 65536 // bytes passed to each call of the write method of writeUTF8
+
 #define PY_ASCII_OBJECT_CAST(op) ((PyASCIIObject *)(op))
 #define PY_COMPACT_UNICODE_OBJECT_CAST(op) ((PyCompactUnicodeObject *)(op))
 #define PY_UNICODE_OBJECT_CAST(op) ((PyUnicodeObject *)(op))
@@ -45,7 +60,28 @@
  * @brief check if UTF-16 encoded `chars` contain a surrogate pair
  */
 static bool containsSurrogatePair(const char16_t *chars, size_t length) {
-  for (size_t i = 0; i < length; i++) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // a code unit is a surrogate iff (c & 0xF800) == 0xD800, test 8 of them at a time
+  const __m128i surrogateMask = _mm_set1_epi16((short)0xF800);
+  const __m128i surrogateTag = _mm_set1_epi16((short)HIGH_SURROGATE_START);
+  for (; i + 8 <= length; i += 8) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(chars + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(block, surrogateMask), surrogateTag))) {
+      return true;
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint16x8_t surrogateMask = vdupq_n_u16(0xF800);
+  const uint16x8_t surrogateTag = vdupq_n_u16(HIGH_SURROGATE_START);
+  for (; i + 8 <= length; i += 8) {
+    uint16x8_t block = vld1q_u16((const uint16_t *)(chars + i));
+    if (vmaxvq_u16(vceqq_u16(vandq_u16(block, surrogateMask), surrogateTag))) {
+      return true;
+    }
+  }
+#endif
+  for (; i < length; i++) {
     if (Py_UNICODE_IS_SURROGATE(chars[i])) {
       return true;
     }
@@ -57,19 +93,28 @@ static bool containsSurrogatePair(const char16_t *chars, size_t length) {
  * @brief check if the Latin-1 encoded `chars` only contain ascii characters
  */
 static bool containsOnlyAscii(const JS::Latin1Char *chars, size_t length) {
-  for (size_t i = 0; i < length; i++) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // the high bit of every byte is collected by movemask, test 16 of them at a time
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(chars + i));
+    if (_mm_movemask_epi8(block)) return false;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t block = vld1q_u8(chars + i);
+    if (vmaxvq_u8(block) >= 128) return false;
+  }
+#endif
+  for (; i < length; i++) {
     if (chars[i] >= 128) return false;
   }
   return true;
 }
 
-/**
- * @brief creates new UCS4-encoded pyObject string. This must be called by the user if the original JSString contains any surrogate pairs
- *
- * @return PyObject* - the UCS4-encoding of the pyObject string
- *
- */
-static PyObject *asUCS4(PyObject *pyString) {
+bool StrType::lazySurrogateNormalization = false;
+
+PyObject *StrType::asUCS4(PyObject *pyString) {
   if (PyUnicode_KIND(pyString) != PyUnicode_2BYTE_KIND) {
     // return a new reference to match the behaviour of `PyUnicode_FromKindAndData`
     Py_INCREF(pyString);
@@ -113,16 +158,18 @@ PyObject *StrType::proxifyString(JSContext *cx, JS::HandleValue strVal) {
 
   size_t length = JS::GetLinearStringLength(lstr);
 
-  JSStringProxy *pyString = PyObject_New(JSStringProxy, &JSStringProxyType); // new reference
+  JSStringProxy *pyString = JSStringProxyMethodDefinitions::allocate(); // new reference
 
   if (pyString == NULL) {
     return NULL;
   }
 
   JS::RootedObject obj(cx);
-  pyString->jsString = new JS::PersistentRootedValue(cx);
-  pyString->jsString->setString((JSString *)lstr);
+  pyString->jsString = RootPool::newValueRoot(cx, JS::StringValue((JSString *)lstr));
   jsStringProxies.insert(pyString);
+  if (JSStringProxyIsInNursery(pyString)) {
+    nurseryJSStringProxies.insert(pyString);
+  }
 
   // Initialize as legacy string (https://github.com/python/cpython/blob/v3.12.0b1/Include/cpython/unicodeobject.h#L78-L93)
   // see https://github.com/python/cpython/blob/v3.11.3/Objects/unicodeobject.c#L1230-L1245
@@ -179,11 +226,16 @@ PyObject *StrType::proxifyString(JSContext *cx, JS::HandleValue strVal) {
     PY_UNICODE_OBJECT_READY(pyString) = 1;
   #endif
 
-    if (containsSurrogatePair(chars, length)) {
+    // In lazy mode the proxy stays zero-copy, and the UCS4 conversion is deferred to `StrType::toWellFormed`
+    if (!lazySurrogateNormalization && containsSurrogatePair(chars, length)) {
       // We must convert to UCS4 here because Python does not support decoding string containing surrogate pairs to bytes
       PyObject *ucs4Obj = asUCS4((PyObject *)pyString); // convert to a new PyUnicodeObject with UCS4 data
       if (!ucs4Obj) {
-        // conversion fails, keep the original `pyString`
+        if (PyErr_Occurred()) { // out of memory
+          Py_DECREF(pyString);
+          return NULL;
+        }
+        // unpaired surrogates, keep the original `pyString`
         return (PyObject *)pyString;
       }
       Py_DECREF(pyString);
@@ -194,6 +246,20 @@ PyObject *StrType::proxifyString(JSContext *cx, JS::HandleValue strVal) {
   return (PyObject *)pyString;
 }
 
+PyObject *StrType::toWellFormed(PyObject *pyString) {
+  if (PyUnicode_KIND(pyString) == PyUnicode_2BYTE_KIND && containsSurrogatePair((const char16_t *)PyUnicode_2BYTE_DATA(pyString), PyUnicode_GET_LENGTH(pyString))) {
+    PyObject *ucs4Obj = asUCS4(pyString);
+    if (ucs4Obj) {
+      return ucs4Obj;
+    }
+    if (PyErr_Occurred()) { // out of memory
+      return NULL;
+    }
+    // contains unpaired surrogates, there is no well-formed view, so make a plain copy like `str()` would
+  }
+  return PyUnicode_Type.tp_str(pyString);
+}
+
 PyObject *StrType::getPyObject(JSContext *cx, JS::HandleValue str) {
   const PythonExternalString *callbacks;
   const char16_t *ucs2Buffer{};
@@ -212,3 +278,157 @@ PyObject *StrType::getPyObject(JSContext *cx, JS::HandleValue str) {
 
   return proxifyString(cx, str);
 }
+
+/**
+ * @brief The linear JSString of a JSStringProxy, and the length of its UTF-8 encoding
+ *
+ * @return bool - false with a Python exception set if the string could not be linearized
+ */
+static bool utf8Source(JSContext *cx, PyObject *pyString, JS::MutableHandleString str, size_t *utf8Length, bool *ascii) {
+  str.set(((JSStringProxy *)pyString)->jsString->toString());
+  JSLinearString *lstr = JS_EnsureLinearString(cx, str);
+  if (!lstr) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(lstr);
+  JS::AutoCheckCannotGC nogc;
+  *ascii = JS::LinearStringHasLatin1Chars(lstr) && containsOnlyAscii(JS::GetLatin1LinearStringChars(nogc, lstr), length);
+  *utf8Length = *ascii ? length : JS::GetDeflatedUTF8StringLength(lstr);
+  return true;
+}
+
+/**
+ * @brief Encode a whole JSString into a buffer of its UTF-8 length, the ASCII strings being copied as they are
+ */
+static bool encodeUTF8(JSContext *cx, JS::HandleString str, bool ascii, char *buffer, size_t utf8Length) {
+  if (ascii) { // the chars may have moved if the allocation of the buffer ran a GC, get them again
+    JS::AutoCheckCannotGC nogc;
+    JSLinearString *lstr = JS_ASSERT_STRING_IS_LINEAR(str);
+    memcpy(buffer, JS::GetLatin1LinearStringChars(nogc, lstr), utf8Length);
+    return true;
+  }
+  if (JS_EncodeStringToUTF8BufferPartial(cx, str, mozilla::Span(buffer, utf8Length)).isNothing()) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  return true;
+}
+
+PyObject *StrType::toUTF8(JSContext *cx, PyObject *pyString) {
+  if (!PyObject_TypeCheck(pyString, &JSStringProxyType)) {
+    return PyUnicode_AsUTF8String(pyString);
+  }
+  JS::RootedString str(cx);
+  size_t utf8Length;
+  bool ascii;
+  if (!utf8Source(cx, pyString, &str, &utf8Length, &ascii)) {
+    return NULL;
+  }
+  PyObject *bytes = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)utf8Length);
+  if (!bytes) {
+    return NULL;
+  }
+  if (!encodeUTF8(cx, str, ascii, PyBytes_AS_STRING(bytes), utf8Length)) {
+    Py_DECREF(bytes);
+    return NULL;
+  }
+  return bytes;
+}
+
+/**
+ * @brief Pass the UTF-8 of a JSString to a write method, in chunks of at most UTF8_WRITE_CHUNK_SIZE bytes
+ */
+static bool writeUTF8Chunks(JSContext *cx, JS::HandleString str, PyObject *write) {
+  std::string chunk(UTF8_WRITE_CHUNK_SIZE, '\0');
+  size_t length = JS_GetStringLength(str);
+  size_t offset = 0;
+  JS::RootedString rest(cx);
+  while (offset < length) {
+    rest.set(offset ? JS_NewDependentString(cx, str, offset, length - offset) : str.get());
+    if (!rest) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+    auto encoded = JS_EncodeStringToUTF8BufferPartial(cx, rest, mozilla::Span(chunk.data(), chunk.size()));
+    if (encoded.isNothing()) {
+      setSpiderMonkeyException(cx);
+      return false;
+    }
+    auto [read, written] = *encoded;
+    offset += read;
+    PyObject *bytes = PyBytes_FromStringAndSize(chunk.data(), (Py_ssize_t)written);
+    if (!bytes) {
+      return false;
+    }
+    PyObject *result = PyObject_CallOneArg(write, bytes);
+    Py_DECREF(bytes);
+    if (!result) {
+      return false;
+    }
+    Py_DECREF(result);
+  }
+  return true;
+}
+
+Py_ssize_t StrType::writeUTF8(JSContext *cx, PyObject *pyString, PyObject *target) {
+  bool isJSString = PyObject_TypeCheck(pyString, &JSStringProxyType);
+  JS::RootedString str(cx);
+  size_t utf8Length = 0;
+  bool ascii = false;
+  PyObject *bytes = NULL; // the encoding of a Python str
+  if (isJSString) {
+    if (!utf8Source(cx, pyString, &str, &utf8Length, &ascii)) {
+      return -1;
+    }
+  } else {
+    bytes = PyUnicode_AsUTF8String(pyString);
+    if (!bytes) {
+      return -1;
+    }
+    utf8Length = PyBytes_GET_SIZE(bytes);
+  }
+
+  if (PyObject_CheckBuffer(target)) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(target, &view, PyBUF_WRITABLE) < 0) {
+      Py_XDECREF(bytes);
+      return -1;
+    }
+    bool ok = true;
+    if ((size_t)view.len < utf8Length) {
+      PyErr_Format(PyExc_ValueError, "pythonmonkey.writeUtf8 needs a buffer of %zu bytes, got %zd", utf8Length, view.len);
+      ok = false;
+    } else if (isJSString) {
+      ok = encodeUTF8(cx, str, ascii, (char *)view.buf, utf8Length);
+    } else {
+      memcpy(view.buf, PyBytes_AS_STRING(bytes), utf8Length);
+    }
+    PyBuffer_Release(&view);
+    Py_XDECREF(bytes);
+    return ok ? (Py_ssize_t)utf8Length : -1;
+  }
+
+  PyObject *write = PyObject_GetAttrString(target, "write");
+  if (!write) {
+    Py_XDECREF(bytes);
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.writeUtf8 expects a writable buffer or an object with a write method");
+    return -1;
+  }
+  bool ok;
+  if (!isJSString) {
+    PyObject *result = PyObject_CallOneArg(write, bytes);
+    Py_XDECREF(result);
+    ok = result != NULL;
+  } else if (utf8Length <= UTF8_WRITE_CHUNK_SIZE) {
+    bytes = StrType::toUTF8(cx, pyString);
+    PyObject *result = bytes ? PyObject_CallOneArg(write, bytes) : NULL;
+    Py_XDECREF(result);
+    ok = result != NULL;
+  } else {
+    ok = writeUTF8Chunks(cx, str, write);
+  }
+  Py_DECREF(write);
+  Py_XDECREF(bytes);
+  return ok ? (Py_ssize_t)utf8Length : -1;
+}
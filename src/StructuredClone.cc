@@ -0,0 +1,94 @@
+/**
+ * @file StructuredClone.cc
+ * @author agent (agent@local)
+ * @brief The structuredClone global, and the serialization of JS values to bytes on the structured clone wire format
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/StructuredClone.hh"
+
+#include <jsapi.h>
+#include <js/StructuredClone.h>
+
+#include <Python.h>
+
+#include <cstring>
+
+/**
+ * @brief Throw `new DOMException(message, "DataCloneError")`, as the HTML spec requires, instead of the generic Error of SpiderMonkey
+ */
+static void reportDataCloneError(JSContext *cx, uint32_t errorId, void *closure, const char *errorMessage) {
+  JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+  JS::RootedValue constructor(cx);
+  JS::RootedString message(cx, JS_NewStringCopyZ(cx, errorMessage ? errorMessage : "The value could not be cloned"));
+  JS::RootedString name(cx, JS_NewStringCopyZ(cx, "DataCloneError"));
+  if (!message || !name || !JS_GetProperty(cx, global, "DOMException", &constructor)) {
+    return;
+  }
+  if (!constructor.isObject()) {
+    JS_ReportErrorUTF8(cx, "%s", errorMessage ? errorMessage : "The value could not be cloned");
+    return;
+  }
+  JS::RootedValueArray<2> args(cx);
+  args[0].setString(message);
+  args[1].setString(name);
+  JS::RootedObject exception(cx);
+  if (JS::Construct(cx, constructor, args, &exception)) {
+    JS::RootedValue exceptionValue(cx, JS::ObjectValue(*exception));
+    JS_SetPendingException(cx, exceptionValue);
+  }
+}
+
+static const JSStructuredCloneCallbacks cloneCallbacks = {
+  nullptr, // read
+  nullptr, // write
+  reportDataCloneError,
+  nullptr, // readTransfer
+  nullptr, // writeTransfer
+  nullptr, // freeTransfer
+  nullptr, // canTransfer
+  nullptr, // sabCloned
+};
+
+bool StructuredClone::clone(JSContext *cx, JS::HandleValue value, JS::HandleValue transfer, JS::MutableHandleValue rval) {
+  JSAutoStructuredCloneBuffer buffer(JS::StructuredCloneScope::SameProcess, &cloneCallbacks, nullptr);
+  return buffer.write(cx, value, transfer, JS::CloneDataPolicy(), &cloneCallbacks, nullptr) &&
+         buffer.read(cx, rval, JS::CloneDataPolicy(), &cloneCallbacks, nullptr);
+}
+
+PyObject *StructuredClone::serialize(JSContext *cx, JS::HandleValue value) {
+  JSAutoStructuredCloneBuffer buffer(JS::StructuredCloneScope::DifferentProcess, nullptr, nullptr);
+  if (!buffer.write(cx, value)) {
+    return NULL;
+  }
+
+  const JSStructuredCloneData &data = buffer.data();
+  PyObject *bytes = PyBytes_FromStringAndSize(NULL, data.Size());
+  if (!bytes) {
+    return NULL;
+  }
+  char *out = PyBytes_AS_STRING(bytes);
+  data.ForEachDataChunk([&](const char *chunk, size_t size) {
+    memcpy(out, chunk, size);
+    out += size;
+    return true;
+  });
+  return bytes;
+}
+
+bool StructuredClone::deserialize(JSContext *cx, const char *data, size_t length, JS::MutableHandleValue rval) {
+  JSStructuredCloneData cloneData(JS::StructuredCloneScope::DifferentProcess);
+  if (length % 8 != 0) { // the format is a sequence of 64-bit words
+    JS_ReportErrorASCII(cx, "The serialized data is truncated");
+    return false;
+  }
+  if (!cloneData.AppendBytes(data, length)) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+  return JS_ReadStructuredClone(cx, cloneData, JS_STRUCTURED_CLONE_VERSION, JS::StructuredCloneScope::DifferentProcess,
+    rval, JS::CloneDataPolicy(), nullptr, nullptr);
+}
@@ -0,0 +1,325 @@
+/**
+ * @file TypeLayoutCache.cc
+ * @author agent (agent@local)
+ * @brief Cache of the attribute layout of the Python types whose objects are proxied into JS
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/TypeLayoutCache.hh"
+
+#include <Python.h>
+#include <structmember.h>
+#include "include/pyshim.hh"
+
+#include <unordered_map>
+
+/**
+ * @brief How an attribute name resolves on the objects of a type
+ */
+struct TypeAttribute {
+  enum Kind {
+    Member,         // a `__slots__` slot or another object member, read at `offset`
+    DataDescriptor, // e.g. a property, `descr` is called
+    Instance        // the instance `__dict__`, then `descr` if it is not NULL: a method, a non-data descriptor or a class attribute
+  } kind;
+  Py_ssize_t offset = 0;
+  int memberType = 0; // T_OBJECT_EX reads a NULL slot as a missing attribute, T_OBJECT as None
+  PyObject *descr = nullptr; // a reference owned by the cache
+};
+
+struct TypeLayout {
+  unsigned int versionTag = 0;
+  bool defaultDir = false; // `__dir__` is object.__dir__, so dir() of an object is its `__dict__` and dir() of its type
+  PyObject *publicNames = nullptr; // the sorted names of dir() of the type that do not start with "__", computed on the first enumeration
+  PyObject *publicNameSet = nullptr;
+  std::unordered_map<PyObject *, TypeAttribute> attributes; // by interned name, the cache holds a reference to the names
+};
+
+static std::unordered_map<PyTypeObject *, TypeLayout> layouts; // the cache holds a reference to the types
+
+static void clearAttributes(TypeLayout &layout) {
+  for (auto &attribute : layout.attributes) {
+    Py_DECREF(attribute.first);
+    Py_XDECREF(attribute.second.descr);
+  }
+  layout.attributes.clear();
+  Py_CLEAR(layout.publicNames);
+  Py_CLEAR(layout.publicNameSet);
+}
+
+static void clearLayouts() {
+  if (!Py_IsFinalizing()) {
+    for (auto &entry : layouts) {
+      clearAttributes(entry.second);
+      Py_DECREF((PyObject *)entry.first);
+    }
+  }
+  layouts.clear();
+}
+
+void TypeLayoutCache::finalize() {
+  clearLayouts();
+}
+
+/**
+ * @brief Whether the type has a version tag, which is assigned on demand and reset when it is modified
+ */
+static bool hasVersionTag(PyTypeObject *type) {
+#if PY_VERSION_HEX >= 0x030c0000 // Python version is 3.12 or higher
+  return type->tp_version_tag != 0 || PyUnstable_Type_AssignVersionTag(type);
+#else
+  return PyType_HasFeature(type, Py_TPFLAGS_VALID_VERSION_TAG);
+#endif
+}
+
+/**
+ * @brief Get the layout of a type, reset if the type was modified since it was cached
+ *
+ * @return TypeLayout* - the layout, or nullptr if the type has no version tag to validate it
+ */
+static TypeLayout *layoutOf(PyTypeObject *type) {
+  if (!hasVersionTag(type)) {
+    return nullptr;
+  }
+
+  auto found = layouts.find(type);
+  if (found != layouts.end()) {
+    if (found->second.versionTag == type->tp_version_tag) {
+      return &found->second;
+    }
+    clearAttributes(found->second);
+  } else {
+    if (layouts.size() >= TYPE_LAYOUT_CACHE_MAX_TYPES) {
+      clearLayouts();
+    }
+    Py_INCREF((PyObject *)type);
+    found = layouts.emplace(type, TypeLayout()).first;
+  }
+
+  static PyObject *dirName = PyUnicode_InternFromString("__dir__");
+  static PyObject *objectDir = _PyType_Lookup(&PyBaseObject_Type, dirName); // borrowed reference, object is immortal
+  TypeLayout &layout = found->second;
+  layout.defaultDir = _PyType_Lookup(type, dirName) == objectDir;
+  layout.versionTag = type->tp_version_tag; // after the lookups, which may assign it
+  return &layout;
+}
+
+/**
+ * @brief Resolve an attribute name on a type, as PyObject_GenericGetAttr does
+ */
+static TypeAttribute resolveAttribute(PyTypeObject *type, PyObject *name) {
+  TypeAttribute attribute;
+  attribute.kind = TypeAttribute::Instance;
+  PyObject *descr = _PyType_Lookup(type, name); // borrowed reference
+  if (!descr) {
+    return attribute;
+  }
+
+  if (Py_TYPE(descr)->tp_descr_get && Py_TYPE(descr)->tp_descr_set) { // data descriptor, found before the instance `__dict__`
+    if (Py_TYPE(descr) == &PyMemberDescr_Type) {
+      PyMemberDef *member = ((PyMemberDescrObject *)descr)->d_member;
+      if ((member->type == T_OBJECT_EX || member->type == T_OBJECT) && (member->flags & ~READONLY) == 0) { // not audited nor relative
+        attribute.kind = TypeAttribute::Member;
+        attribute.offset = member->offset;
+        attribute.memberType = member->type;
+        return attribute;
+      }
+    }
+    attribute.kind = TypeAttribute::DataDescriptor;
+  }
+  Py_INCREF(descr);
+  attribute.descr = descr;
+  return attribute;
+}
+
+/**
+ * @brief Clear an AttributeError, the handlers report missing attributes as undefined
+ */
+static PyObject *missingIsNull(PyObject *value) {
+  if (!value && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+    PyErr_Clear();
+  }
+  return value;
+}
+
+/**
+ * @brief Get the value of a descriptor or class attribute found on the type, keeping it alive while its `__get__` runs, since the code it runs may empty the cache
+ */
+static PyObject *getDescriptor(PyObject *descr, PyObject *object) {
+  Py_INCREF(descr);
+  descrgetfunc get = Py_TYPE(descr)->tp_descr_get;
+  PyObject *value;
+  if (get) {
+    value = get(descr, object, (PyObject *)Py_TYPE(object));
+  } else {
+    value = descr;
+    Py_INCREF(value);
+  }
+  Py_DECREF(descr);
+  return missingIsNull(value);
+}
+
+PyObject *TypeLayoutCache::getAttr(PyObject *object, PyObject *name) {
+  PyTypeObject *type = Py_TYPE(object);
+  if (type->tp_getattro != PyObject_GenericGetAttr || !PyUnicode_CheckExact(name) || !PyUnicode_CHECK_INTERNED(name)) {
+    return missingIsNull(PyObject_GetAttr(object, name)); // `__getattribute__` or `__getattr__` are overridden, or the name is not a cache key
+  }
+  TypeLayout *layout = layoutOf(type);
+  if (!layout) {
+    return missingIsNull(PyObject_GenericGetAttr(object, name));
+  }
+
+  auto found = layout->attributes.find(name);
+  if (found == layout->attributes.end()) {
+    if (layout->attributes.size() >= TYPE_LAYOUT_CACHE_MAX_ATTRIBUTES) {
+      clearAttributes(*layout);
+    }
+    Py_INCREF(name);
+    found = layout->attributes.emplace(name, resolveAttribute(type, name)).first;
+  }
+  const TypeAttribute &attribute = found->second;
+
+  switch (attribute.kind) {
+  case TypeAttribute::Member: {
+      PyObject *value = *(PyObject **)((char *)object + attribute.offset);
+      if (!value) {
+        if (attribute.memberType == T_OBJECT_EX) {
+          return NULL; // an unset slot
+        }
+        value = Py_None;
+      }
+      Py_INCREF(value);
+      return value;
+    }
+  case TypeAttribute::DataDescriptor:
+    return getDescriptor(attribute.descr, object);
+  case TypeAttribute::Instance:
+    break;
+  }
+
+#if PY_VERSION_HEX < 0x030b0000 // Python version is less than 3.11
+  PyObject **dictPtr = type->tp_dictoffset ? _PyObject_GetDictPtr(object) : NULL;
+  if (dictPtr && *dictPtr) {
+    PyObject *value = PyDict_GetItemWithError(*dictPtr, name); // borrowed reference
+    if (value) {
+      Py_INCREF(value);
+      return value;
+    }
+    if (PyErr_Occurred()) {
+      return NULL;
+    }
+  }
+  return attribute.descr ? getDescriptor(attribute.descr, object) : NULL;
+#else
+  // the instance attributes may be stored inline rather than in a dict, which CPython's generic lookup reads without creating the dict
+  return missingIsNull(PyObject_GenericGetAttr(object, name));
+#endif
+}
+
+/**
+ * @return bool - whether the name does not start with "__"
+ */
+static bool isPublicName(PyObject *name) {
+  if (!PyUnicode_Check(name)) {
+    return false;
+  }
+  return PyUnicode_GET_LENGTH(name) < 2 || PyUnicode_READ_CHAR(name, 0) != '_' || PyUnicode_READ_CHAR(name, 1) != '_';
+}
+
+/**
+ * @brief Keep the public names of a list of names, as a new list
+ */
+static PyObject *filterPublicNames(PyObject *names) {
+  PyObject *publicNames = PyList_New(0);
+  if (!publicNames) {
+    return NULL;
+  }
+  for (Py_ssize_t index = 0; index < PyList_GET_SIZE(names); index++) {
+    PyObject *name = PyList_GET_ITEM(names, index);
+    if (isPublicName(name) && PyList_Append(publicNames, name) < 0) {
+      Py_DECREF(publicNames);
+      return NULL;
+    }
+  }
+  return publicNames;
+}
+
+/**
+ * @brief Get the public names of dir() of an object, uncached
+ */
+static PyObject *dirPublicNames(PyObject *object) {
+  PyObject *names = PyObject_Dir(object);
+  if (!names) {
+    return NULL;
+  }
+  PyObject *publicNames = filterPublicNames(names);
+  Py_DECREF(names);
+  return publicNames;
+}
+
+PyObject *TypeLayoutCache::publicNames(PyObject *object) {
+  PyTypeObject *type = Py_TYPE(object);
+  TypeLayout *layout = type->tp_getattro == PyObject_GenericGetAttr ? layoutOf(type) : nullptr;
+  if (!layout || !layout->defaultDir) {
+    return dirPublicNames(object);
+  }
+
+  if (!layout->publicNames) {
+    PyObject *publicNames = dirPublicNames((PyObject *)type); // the names object.__dir__ merges from the class and its bases
+    PyObject *publicNameSet = publicNames ? PySet_New(publicNames) : NULL;
+    if (!publicNameSet) {
+      Py_XDECREF(publicNames);
+      return NULL;
+    }
+    layout = layoutOf(type); // dir() may have run code modifying the type
+    if (!layout) {
+      Py_DECREF(publicNames);
+      Py_DECREF(publicNameSet);
+      return dirPublicNames(object);
+    }
+    Py_XDECREF(layout->publicNames);
+    Py_XDECREF(layout->publicNameSet);
+    layout->publicNames = publicNames;
+    layout->publicNameSet = publicNameSet;
+  }
+  PyObject *publicNameSet = layout->publicNameSet;
+  Py_INCREF(publicNameSet); // reading the `__dict__` may empty the cache
+  PyObject *names = PyList_GetSlice(layout->publicNames, 0, PyList_GET_SIZE(layout->publicNames));
+  if (!names) {
+    Py_DECREF(publicNameSet);
+    return NULL;
+  }
+
+  PyObject *dict = type->tp_dictoffset ? PyObject_GenericGetDict(object, NULL) : NULL;
+  if (!dict) {
+    PyErr_Clear(); // no `__dict__`, e.g. a `__slots__` class
+    Py_DECREF(publicNameSet);
+    return names;
+  }
+  bool added = false;
+  PyObject *key, *value;
+  Py_ssize_t position = 0;
+  while (PyDict_Next(dict, &position, &key, &value)) {
+    if (!isPublicName(key)) {
+      continue;
+    }
+    int known = PySet_Contains(publicNameSet, key);
+    if (known < 0 || (known == 0 && PyList_Append(names, key) < 0)) {
+      Py_DECREF(dict);
+      Py_DECREF(publicNameSet);
+      Py_DECREF(names);
+      return NULL;
+    }
+    added |= known == 0;
+  }
+  Py_DECREF(dict);
+  Py_DECREF(publicNameSet);
+  if (added && PyList_Sort(names) < 0) {
+    Py_DECREF(names);
+    return NULL;
+  }
+  return names;
+}
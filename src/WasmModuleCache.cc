@@ -0,0 +1,122 @@
+/**
+ * @file WasmModuleCache.cc
+ * @author agent (agent@local)
+ * @brief Cache of the compiled WebAssembly modules, keyed by the bytes of their binary
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/WasmModuleCache.hh"
+
+#include <jsapi.h>
+#include <js/experimental/TypedData.h>
+#include <js/WasmModule.h>
+#include <mozilla/RefPtr.h>
+
+#include <Python.h>
+
+#include <cstring>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct Entry {
+  size_t hash;
+  std::string bytes; // compared on lookup, a hash collision must not hand out the code of another binary
+  RefPtr<JS::WasmModule> module;
+};
+
+size_t WasmModuleCache::maxEntries = 32;
+
+// most recently used first
+static std::list<Entry> entries;
+static std::unordered_map<size_t, std::list<Entry>::iterator> entriesByHash;
+
+/**
+ * @brief Find the module compiled from the same bytes, and move it to the front
+ */
+static RefPtr<JS::WasmModule> lookup(size_t hash, const uint8_t *bytes, size_t length) {
+  auto found = entriesByHash.find(hash);
+  if (found == entriesByHash.end()) {
+    return nullptr;
+  }
+  const std::string &cached = found->second->bytes;
+  if (cached.size() != length || memcmp(cached.data(), bytes, length) != 0) {
+    return nullptr;
+  }
+  entries.splice(entries.begin(), entries, found->second);
+  return entries.front().module;
+}
+
+static void remember(size_t hash, const uint8_t *bytes, size_t length, RefPtr<JS::WasmModule> module) {
+  if (WasmModuleCache::maxEntries == 0 || entriesByHash.count(hash)) {
+    return; // the slot of the hash is kept by the binary that was cached first
+  }
+  entries.push_front(Entry{hash, std::string((const char *)bytes, length), module});
+  entriesByHash[hash] = entries.begin();
+  while (entries.size() > WasmModuleCache::maxEntries) {
+    entriesByHash.erase(entries.back().hash);
+    entries.pop_back();
+  }
+}
+
+/**
+ * @brief `new WebAssembly.Module(bytes)` in the current global
+ */
+static JSObject *compileModule(JSContext *cx, const uint8_t *bytes, size_t length) {
+  JS::RootedObject global(cx, JS::CurrentGlobalOrNull(cx));
+  JS::RootedValue webAssembly(cx);
+  if (!JS_GetProperty(cx, global, "WebAssembly", &webAssembly)) {
+    return nullptr;
+  }
+  if (!webAssembly.isObject()) {
+    JS_ReportErrorASCII(cx, "WebAssembly is not available");
+    return nullptr;
+  }
+  JS::RootedObject webAssemblyObj(cx, &webAssembly.toObject());
+  JS::RootedValue moduleConstructor(cx);
+  if (!JS_GetProperty(cx, webAssemblyObj, "Module", &moduleConstructor)) {
+    return nullptr;
+  }
+
+  JS::RootedObject binary(cx, JS_NewUint8Array(cx, length));
+  if (!binary) {
+    return nullptr;
+  }
+  {
+    bool isSharedMemory;
+    JS::AutoCheckCannotGC autoNoGC(cx);
+    memcpy(JS_GetUint8ArrayData(binary, &isSharedMemory, autoNoGC), bytes, length);
+  }
+
+  JS::RootedValueArray<1> args(cx);
+  args[0].setObject(*binary);
+  JS::RootedObject module(cx);
+  if (!JS::Construct(cx, moduleConstructor, args, &module)) {
+    return nullptr;
+  }
+  return module;
+}
+
+JSObject *WasmModuleCache::compile(JSContext *cx, const uint8_t *bytes, size_t length) {
+  size_t hash = std::hash<std::string_view>{}(std::string_view((const char *)bytes, length));
+  RefPtr<JS::WasmModule> cached = lookup(hash, bytes, length);
+  if (cached) {
+    return cached->createObject(cx);
+  }
+
+  JS::RootedObject module(cx, compileModule(cx, bytes, length));
+  if (module) {
+    remember(hash, bytes, length, JS::GetWasmModule(module));
+  }
+  return module;
+}
+
+void WasmModuleCache::finalize() {
+  entriesByHash.clear();
+  entries.clear();
+}
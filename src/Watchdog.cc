@@ -0,0 +1,209 @@
+/**
+ * @file Watchdog.cc
+ * @author agent (agent@local)
+ * @brief Execution time and heap size limits of the JS code run by pythonmonkey.eval
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ *
+ */
+
+#include "include/Watchdog.hh"
+
+#include <jsapi.h>
+#include <js/GCAPI.h>
+
+#include <Python.h>
+#include <pythread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+static JSContext *watchdogCx = nullptr;
+
+/**
+ * @brief The state of the watchdog thread, leaked as the thread may still wait on it at exit
+ */
+struct WatchdogState {
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool started = false;
+  bool armed = false; // limited JS code is running
+  std::chrono::steady_clock::time_point deadline;
+  double timeoutMs = 0; // the limit the deadline was computed from, for the error message
+};
+static WatchdogState *state = new WatchdogState();
+
+static std::atomic<bool> timedOut(false); // set by the watchdog thread, consumed by the interrupt callback
+// the heap limit is only used on the JS thread
+static uint64_t heapLimit = 0; // of the innermost AutoLimit lowering JSGC_MAX_BYTES, 0 if none
+static bool heapExceeded = false;
+
+static void watchdogThread(void *Py_UNUSED(unused)) {
+  std::unique_lock<std::mutex> lock(state->mutex);
+  for (;;) {
+    state->changed.wait(lock, [] { return state->armed; });
+    std::chrono::steady_clock::time_point deadline = state->deadline;
+    // woken up early when the limited code returns, or when a nested limit moves the deadline
+    if (!state->changed.wait_until(lock, deadline, [deadline] { return !state->armed || state->deadline != deadline; })) {
+      state->armed = false;
+      timedOut = true;
+      JS_RequestInterruptCallback(watchdogCx); // may be called from any thread
+    }
+  }
+}
+
+static void setTimeoutError() {
+  double timeoutMs;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    timeoutMs = state->timeoutMs;
+  }
+  char message[96];
+  snprintf(message, sizeof(message), "the JS code ran for more than %g ms", timeoutMs);
+  PyErr_SetString(PyExc_TimeoutError, message);
+}
+
+static void setHeapError() {
+  PyErr_Format(PyExc_MemoryError, "the JS code exceeded the heap limit of %llu bytes", (unsigned long long)heapLimit);
+}
+
+/**
+ * @brief Terminate the JS code, which can't catch it, once a limit is exceeded
+ */
+static bool interruptOnLimit(JSContext *Py_UNUSED(cx)) {
+  if (timedOut.exchange(false)) {
+    if (!PyErr_Occurred()) {
+      setTimeoutError();
+    }
+    return false;
+  }
+  if (heapExceeded) {
+    heapExceeded = false;
+    if (!PyErr_Occurred()) {
+      setHeapError();
+    }
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief The JS code may catch the out of memory exception, so it is terminated at the next interrupt check
+ */
+static void onOutOfMemory(JSContext *cx, void *Py_UNUSED(data)) {
+  if (heapLimit) {
+    heapExceeded = true;
+    JS_RequestInterruptCallback(cx);
+  }
+}
+
+bool Watchdog::init(JSContext *cx) {
+  watchdogCx = cx;
+  JS::SetOutOfMemoryCallback(cx, onOutOfMemory, nullptr);
+  return JS_AddInterruptCallback(cx, interruptOnLimit);
+}
+
+void Watchdog::prepareFork() {
+  state->mutex.lock();
+}
+
+void Watchdog::afterFork(bool inChild) {
+  if (!inChild) {
+    state->mutex.unlock();
+    return;
+  }
+
+  // the condition variable may still count the waiting thread of the parent, the child starts over with a new state
+  WatchdogState *childState = new WatchdogState();
+  childState->armed = state->armed;
+  childState->deadline = state->deadline;
+  childState->timeoutMs = state->timeoutMs;
+  state = childState; // the state of the parent is left locked and leaked
+  if (state->armed) {
+    state->started = PyThread_start_new_thread(watchdogThread, nullptr) != (unsigned long)-1;
+  }
+}
+
+Watchdog::AutoLimit::AutoLimit(double timeoutMs, uint64_t maxHeapBytes) {
+  if (timeoutMs > 0) {
+    bool startThread;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      startThread = !state->started;
+      state->started = true;
+    }
+    if (startThread && PyThread_start_new_thread(watchdogThread, nullptr) == (unsigned long)-1) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->started = false;
+      PyErr_SetString(PyExc_RuntimeError, "PythonMonkey could not start the watchdog thread");
+      _failed = true;
+      return;
+    }
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(timeoutMs));
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      _previousArmed = state->armed;
+      _previousDeadline = state->deadline;
+      _previousTimeoutMs = state->timeoutMs;
+      if (!state->armed || deadline < state->deadline) {
+        state->deadline = deadline;
+        state->timeoutMs = timeoutMs;
+      }
+      state->armed = true;
+    }
+    state->changed.notify_all();
+    _armed = true;
+  }
+
+  if (maxHeapBytes > 0) {
+    _previousMaxBytes = JS_GetGCParameter(watchdogCx, JSGC_MAX_BYTES);
+    _previousHeapLimit = heapLimit;
+    uint32_t limit = (uint32_t)std::min<uint64_t>(maxHeapBytes, UINT32_MAX);
+    if (limit < _previousMaxBytes) {
+      JS_SetGCParameter(watchdogCx, JSGC_MAX_BYTES, limit);
+      heapLimit = limit;
+    }
+    _limitsHeap = true;
+  }
+}
+
+Watchdog::AutoLimit::~AutoLimit() {
+  if (_armed) {
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->armed = _previousArmed;
+      state->deadline = _previousDeadline;
+      state->timeoutMs = _previousTimeoutMs;
+      timedOut = false; // a deadline of the enclosing limit that passed meanwhile fires again
+    }
+    state->changed.notify_all();
+  }
+  if (_limitsHeap) {
+    JS_SetGCParameter(watchdogCx, JSGC_MAX_BYTES, _previousMaxBytes);
+    heapLimit = _previousHeapLimit;
+    heapExceeded = false;
+  }
+}
+
+bool Watchdog::AutoLimit::exceeded() {
+  if (_limitsHeap && heapExceeded) { // the code failed with the out of memory exception before the interrupt
+    heapExceeded = false;
+    JS_ClearPendingException(watchdogCx);
+    PyErr_Clear();
+    setHeapError();
+    return true;
+  }
+  if (_armed && timedOut.exchange(false)) {
+    JS_ClearPendingException(watchdogCx);
+    PyErr_Clear();
+    setTimeoutError();
+    return true;
+  }
+  return false;
+}
@@ -25,6 +25,16 @@ JSObject *getInternalBindingsByNamespace(JSContext *cx, JSLinearString *namespac
     return createInternalBindingsForNamespace(cx, InternalBinding::utils);
   } else if (JS_LinearStringEqualsLiteral(namespaceStr, "timers")) {
     return createInternalBindingsForNamespace(cx, InternalBinding::timers);
+  } else if (JS_LinearStringEqualsLiteral(namespaceStr, "metrics")) {
+    return createInternalBindingsForNamespace(cx, InternalBinding::metrics);
+  } else if (JS_LinearStringEqualsLiteral(namespaceStr, "fs")) {
+    return createInternalBindingsForNamespace(cx, InternalBinding::fs);
+  } else if (JS_LinearStringEqualsLiteral(namespaceStr, "encoding")) {
+    return createInternalBindingsForNamespace(cx, InternalBinding::encoding);
+  } else if (JS_LinearStringEqualsLiteral(namespaceStr, "console")) {
+    return createInternalBindingsForNamespace(cx, InternalBinding::console);
+  } else if (JS_LinearStringEqualsLiteral(namespaceStr, "url")) {
+    return createInternalBindingsForNamespace(cx, InternalBinding::url);
   } else { // not found
     return nullptr;
   }
@@ -0,0 +1,41 @@
+/**
+ * @file console.cc
+ * @author agent (agent@local)
+ * @brief Implement functions in `internalBinding("console")`
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+#include "include/internalBinding.hh"
+#include "include/ConsoleSink.hh"
+
+#include <jsapi.h>
+#include <js/Conversions.h>
+
+/**
+ * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
+ *    `declare function internalBinding(namespace: "console")`
+ */
+
+static bool write(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str || !ConsoleSink::write(cx, str, JS::ToBoolean(args.get(1)))) {
+    return false;
+  }
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool flush(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  ConsoleSink::flush();
+  args.rval().setUndefined();
+  return true;
+}
+
+JSFunctionSpec InternalBinding::console[] = {
+  JS_FN("write", write, 2, 0),
+  JS_FN("flush", flush, 0, 0),
+  JS_FS_END
+};
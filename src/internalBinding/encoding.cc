@@ -0,0 +1,220 @@
+/**
+ * @file encoding.cc
+ * @author agent (agent@local)
+ * @brief Implement functions in `internalBinding("encoding")`, the UTF-8 codec of TextEncoder and TextDecoder
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+#include "include/internalBinding.hh"
+
+#include <jsapi.h>
+#include <js/ArrayBufferMaybeShared.h>
+#include <js/CharacterEncoding.h>
+#include <js/String.h>
+#include <js/Wrapper.h>
+#include <js/experimental/TypedData.h>
+#include <mozilla/Maybe.h>
+#include <mozilla/Span.h>
+#include <mozilla/Utf8.h>
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+/**
+ * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
+ *    `declare function internalBinding(namespace: "encoding")`
+ */
+
+/**
+ * @brief Unwrap an ArrayBuffer, SharedArrayBuffer or ArrayBuffer view
+ *
+ * @return the unwrapped object, or nullptr for other values
+ */
+static JSObject *unwrapBufferSource(JS::HandleValue value, bool *isView) {
+  if (!value.isObject()) {
+    return nullptr;
+  }
+  JSObject *buffer = js::CheckedUnwrapStatic(&value.toObject());
+  if (!buffer) {
+    return nullptr;
+  }
+  *isView = JS_IsArrayBufferViewObject(buffer);
+  if (!*isView && !JS::IsArrayBufferObjectMaybeShared(buffer)) {
+    return nullptr;
+  }
+  return buffer;
+}
+
+static size_t bufferSourceLength(JSObject *buffer, bool isView) {
+  if (isView) {
+    return JS_GetArrayBufferViewByteLength(buffer);
+  }
+  size_t length;
+  bool isShared;
+  uint8_t *data;
+  JS::GetArrayBufferMaybeSharedLengthAndData(buffer, &length, &isShared, &data);
+  return length;
+}
+
+static const uint8_t *bufferSourceData(JSObject *buffer, bool isView, const JS::AutoCheckCannotGC &nogc) {
+  bool isShared;
+  return isView
+    ? (const uint8_t *)JS_GetArrayBufferViewData(buffer, &isShared, nogc)
+    : JS::GetArrayBufferMaybeSharedData(buffer, &isShared, nogc);
+}
+
+static bool isAscii(const uint8_t *bytes, size_t length) {
+  uint8_t bits = 0;
+  for (size_t index = 0; index < length; index++) { // branchless, so that the compiler vectorizes it
+    bits |= bytes[index];
+  }
+  return bits < 0x80;
+}
+
+/**
+ * @brief `TextEncoder.prototype.encode`, the UTF-8 bytes of a string in a new Uint8Array, lone surrogates replaced by U+FFFD
+ */
+static bool encodeUtf8(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str) {
+    return false;
+  }
+  JS::Rooted<JSLinearString *> linear(cx, JS_EnsureLinearString(cx, str));
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetDeflatedUTF8StringLength(linear);
+
+  JS::RootedObject bytes(cx, JS_NewUint8Array(cx, length));
+  if (!bytes) {
+    return false;
+  }
+  {
+    JS::AutoCheckCannotGC nogc;
+    bool isShared;
+    char *data = (char *)JS_GetUint8ArrayData(bytes, &isShared, nogc);
+    if (JS::LinearStringHasLatin1Chars(linear) && length == JS::GetLinearStringLength(linear)) { // ASCII, the bytes are the chars
+      memcpy(data, JS::GetLatin1LinearStringChars(nogc, linear), length);
+    } else {
+      JS::DeflateStringToUTF8Buffer(linear, mozilla::Span(data, length));
+    }
+  }
+  args.rval().setObject(*bytes);
+  return true;
+}
+
+/**
+ * @brief `TextEncoder.prototype.encodeInto`, returns `{ read, written }`, or undefined if the destination is not a Uint8Array
+ */
+static bool encodeUtf8Into(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str) {
+    return false;
+  }
+  args.rval().setUndefined();
+  if (!args.get(1).isObject()) {
+    return true;
+  }
+  JS::RootedObject destination(cx, js::CheckedUnwrapStatic(&args.get(1).toObject()));
+  if (!destination || !JS_IsUint8Array(destination)) {
+    return true;
+  }
+
+  mozilla::Maybe<std::tuple<size_t, size_t>> counts;
+  {
+    JS::AutoCheckCannotGC nogc;
+    bool isShared;
+    size_t length = JS_GetTypedArrayLength(destination);
+    char *data = (char *)JS_GetUint8ArrayData(destination, &isShared, nogc);
+    counts = JS_EncodeStringToUTF8BufferPartial(cx, str, mozilla::Span(data, length)); // stops before a char that does not fit whole
+  }
+  if (!counts) {
+    JS_ReportOutOfMemory(cx);
+    return false;
+  }
+  auto [read, written] = *counts;
+
+  JS::RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result ||
+      !JS_DefineProperty(cx, result, "read", (double)read, JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, result, "written", (double)written, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  args.rval().setObject(*result);
+  return true;
+}
+
+/**
+ * @brief `TextDecoder.prototype.decode` on complete UTF-8 sequences, invalid ones replaced by U+FFFD.
+ * Returns null if they are invalid and `fatal` is true, or undefined if the argument is not an ArrayBuffer, SharedArrayBuffer or ArrayBuffer view
+ */
+static bool decodeUtf8(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  bool fatal = JS::ToBoolean(args.get(1));
+  args.rval().setUndefined();
+  bool isView;
+  JS::RootedObject buffer(cx, unwrapBufferSource(args.get(0), &isView));
+  if (!buffer) {
+    return true;
+  }
+  size_t length = bufferSourceLength(buffer, isView);
+  if (length == 0) {
+    args.rval().setString(JS_GetEmptyString(cx));
+    return true;
+  }
+
+  // the chars are converted into the malloc'd buffer adopted by the new string: JS_NewStringCopyUTF8N would read the bytes,
+  // which may move, while it can GC
+  JS::UniqueLatin1Chars latin1;
+  JS::UniqueTwoByteChars twoByte;
+  size_t decodedLength = 0;
+  bool valid = true;
+  {
+    JS::AutoCheckCannotGC nogc;
+    const uint8_t *bytes = bufferSourceData(buffer, isView, nogc);
+    JS::UTF8Chars utf8((const char *)bytes, length);
+    if (isAscii(bytes, length)) {
+      latin1.reset(js_pod_malloc<JS::Latin1Char>(length));
+      if (latin1) {
+        memcpy(latin1.get(), bytes, length);
+        decodedLength = length;
+      }
+    } else if (!(valid = mozilla::IsUtf8(mozilla::Span((const char *)bytes, length))) && fatal) {
+      // nothing to decode
+    } else if (valid && JS::FindSmallestEncoding(utf8) == JS::SmallestEncoding::Latin1) {
+      latin1.reset(JS::UTF8CharsToNewLatin1CharsZ(cx, utf8, &decodedLength, js::MallocArena).get());
+    } else {
+      twoByte.reset(JS::LossyUTF8CharsToNewTwoByteCharsZ(cx, utf8, &decodedLength, js::MallocArena).get());
+    }
+  }
+  if (!valid && fatal) {
+    args.rval().setNull();
+    return true;
+  }
+  if (!latin1 && !twoByte) {
+    if (!JS_IsExceptionPending(cx)) {
+      JS_ReportOutOfMemory(cx);
+    }
+    return false;
+  }
+  JSString *decoded = latin1
+    ? JS_NewLatin1String(cx, std::move(latin1), decodedLength)
+    : JS_NewUCString(cx, std::move(twoByte), decodedLength);
+  if (!decoded) {
+    return false;
+  }
+  args.rval().setString(decoded);
+  return true;
+}
+
+JSFunctionSpec InternalBinding::encoding[] = {
+  JS_FN("encodeUtf8", encodeUtf8, 1, 0),
+  JS_FN("encodeUtf8Into", encodeUtf8Into, 2, 0),
+  JS_FN("decodeUtf8", decodeUtf8, 2, 0),
+  JS_FS_END
+};
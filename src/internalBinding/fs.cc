@@ -0,0 +1,161 @@
+/**
+ * @file fs.cc
+ * @author agent (agent@local)
+ * @brief Implement functions in `internalBinding("fs")`
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+#include "include/internalBinding.hh"
+#include "include/ModuleLoader.hh"
+#include "include/RequireCache.hh"
+
+#include <jsapi.h>
+#include <js/Conversions.h>
+#include <js/String.h>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
+ *    `declare function internalBinding(namespace: "fs")`
+ */
+
+static bool getStringArgument(JSContext *cx, const JS::CallArgs &args, unsigned index, std::string &value) {
+  JS::RootedString str(cx, JS::ToString(cx, args.get(index)));
+  if (!str) {
+    return false;
+  }
+  JS::UniqueChars chars = JS_EncodeStringToUTF8(cx, str);
+  if (!chars) {
+    return false;
+  }
+  value = chars.get();
+  return true;
+}
+
+static bool getPathArgument(JSContext *cx, const JS::CallArgs &args, std::string &path, unsigned index = 0) {
+  if (!getStringArgument(cx, args, index, path)) {
+    return false;
+  }
+  path = std::filesystem::path(path).lexically_normal().string();
+  return true;
+}
+
+static bool statSync(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string path;
+  if (!getPathArgument(cx, args, path)) {
+    return false;
+  }
+
+  int mode = ModuleLoader::statMode(path);
+  if (mode == -1) {
+    args.rval().setBoolean(false);
+    return true;
+  }
+  JS::RootedObject stats(cx, JS_NewPlainObject(cx));
+  if (!stats || !JS_DefineProperty(cx, stats, "mode", mode, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  args.rval().setObject(*stats);
+  return true;
+}
+
+static bool existsSync(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string path;
+  if (!getPathArgument(cx, args, path)) {
+    return false;
+  }
+  args.rval().setBoolean(ModuleLoader::statMode(path) != -1);
+  return true;
+}
+
+static bool readFileSync(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string path;
+  if (!getPathArgument(cx, args, path)) {
+    return false;
+  }
+  std::string charset;
+  if (!args.get(1).isNullOrUndefined() && !getStringArgument(cx, args, 1, charset)) {
+    return false;
+  }
+  JSString *contents = ModuleLoader::readTextFile(cx, path, charset.empty() ? nullptr : charset.c_str());
+  if (!contents) {
+    return false;
+  }
+  args.rval().setString(contents);
+  return true;
+}
+
+static bool clearStatCache(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  ModuleLoader::clearStatCache();
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool getResolution(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string baseDirectory, specifier, searchPaths;
+  if (!getPathArgument(cx, args, baseDirectory) || !getStringArgument(cx, args, 1, specifier) ||
+      (!args.get(2).isUndefined() && !getStringArgument(cx, args, 2, searchPaths))) {
+    return false;
+  }
+  std::string resolved = RequireCache::getResolution("require", baseDirectory, searchPaths, specifier);
+  if (resolved.empty()) {
+    args.rval().setUndefined();
+    return true;
+  }
+  JSString *resolvedString = JS_NewStringCopyUTF8N(cx, JS::UTF8Chars(resolved.data(), resolved.size()));
+  if (!resolvedString) {
+    return false;
+  }
+  args.rval().setString(resolvedString);
+  return true;
+}
+
+static bool setResolution(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string baseDirectory, specifier, resolved, searchPaths;
+  if (!getPathArgument(cx, args, baseDirectory) || !getStringArgument(cx, args, 1, specifier) || !getPathArgument(cx, args, resolved, 2) ||
+      (!args.get(3).isUndefined() && !getStringArgument(cx, args, 3, searchPaths))) {
+    return false;
+  }
+  if (std::filesystem::path(resolved).is_absolute()) { // not the names of the builtin modules
+    RequireCache::setResolution("require", baseDirectory, searchPaths, specifier, resolved);
+  }
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool prewarm(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::string directory;
+  if (!getPathArgument(cx, args, directory)) {
+    return false;
+  }
+  args.rval().setNumber((double)RequireCache::prewarm(directory));
+  return true;
+}
+
+static bool saveCache(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  args.rval().setBoolean(RequireCache::save());
+  return true;
+}
+
+JSFunctionSpec InternalBinding::fs[] = {
+  JS_FN("statSync", statSync, 1, 0),
+  JS_FN("existsSync", existsSync, 1, 0),
+  JS_FN("readFileSync", readFileSync, 2, 0),
+  JS_FN("clearStatCache", clearStatCache, 0, 0),
+  JS_FN("getResolution", getResolution, 3, 0),
+  JS_FN("setResolution", setResolution, 4, 0),
+  JS_FN("prewarm", prewarm, 1, 0),
+  JS_FN("saveCache", saveCache, 0, 0),
+  JS_FS_END
+};
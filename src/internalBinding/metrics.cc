@@ -0,0 +1,44 @@
+/**
+ * @file metrics.cc
+ * @author agent (agent@local)
+ * @brief Implement functions in `internalBinding("metrics")`
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+#include "include/internalBinding.hh"
+#include "include/DeepCopy.hh"
+#include "include/Metrics.hh"
+
+#include <jsapi.h>
+#include <js/Conversions.h>
+
+#include <Python.h>
+
+/**
+ * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
+ *    `declare function internalBinding(namespace: "metrics")`
+ */
+
+static bool getStats(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  bool reset = JS::ToBoolean(args.get(0));
+
+  PyObject *stats = Metrics::toPython();
+  if (reset) {
+    Metrics::reset();
+  }
+  bool ok = stats && DeepCopy::toJS(cx, stats, args.rval());
+  Py_XDECREF(stats);
+  if (!ok) {
+    PyErr_Clear();
+    JS_ReportErrorASCII(cx, "PythonMonkey could not collect its metrics");
+    return false;
+  }
+  return true;
+}
+
+JSFunctionSpec InternalBinding::metrics[] = {
+  JS_FN("getStats", getStats, 1, 0),
+  JS_FS_END
+};
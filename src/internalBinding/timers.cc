@@ -17,6 +17,16 @@
 
 using AsyncHandle = PyEventLoop::AsyncHandle;
 
+/**
+ * @brief Convert a JS number to a timeoutID, NaN, negative or too large values give an invalid timeoutID
+ */
+static inline AsyncHandle::id_t toTimeoutId(double timeoutID) {
+  if (!(timeoutID >= 0 && timeoutID < 9007199254740992.0)) { // 2^53
+    return 0; // generations start at 1
+  }
+  return (AsyncHandle::id_t)timeoutID;
+}
+
 /**
  * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
  *    `declare function internalBinding(namespace: "timers")`
@@ -59,12 +69,13 @@ static bool cancelByTimeoutId(JSContext *cx, unsigned argc, JS::Value *vp) {
   args.rval().setUndefined();
 
   // Retrieve the AsyncHandle by `timeoutID`
-  AsyncHandle *handle = AsyncHandle::fromId((uint32_t)timeoutID);
+  AsyncHandle *handle = AsyncHandle::fromId(toTimeoutId(timeoutID));
   if (!handle) return true; // does nothing on invalid timeoutID
 
-  // Cancel this job on the Python event-loop
+  // Cancel this job on the Python event-loop, its slot can then be reused by another timer
   handle->cancel();
   handle->removeRef();
+  AsyncHandle::release(toTimeoutId(timeoutID));
 
   return true;
 }
@@ -74,10 +85,8 @@ static bool timerHasRef(JSContext *cx, unsigned argc, JS::Value *vp) {
   double timeoutID = args.get(0).toNumber();
 
   // Retrieve the AsyncHandle by `timeoutID`
-  AsyncHandle *handle = AsyncHandle::fromId((uint32_t)timeoutID);
-  if (!handle) return false; // error no such timeoutID
-
-  args.rval().setBoolean(handle->hasRef());
+  AsyncHandle *handle = AsyncHandle::fromId(toTimeoutId(timeoutID));
+  args.rval().setBoolean(handle && handle->hasRef()); // finished or cleared timers have been released
   return true;
 }
 
@@ -86,10 +95,8 @@ static bool timerAddRef(JSContext *cx, unsigned argc, JS::Value *vp) {
   double timeoutID = args.get(0).toNumber();
 
   // Retrieve the AsyncHandle by `timeoutID`
-  AsyncHandle *handle = AsyncHandle::fromId((uint32_t)timeoutID);
-  if (!handle) return false; // error no such timeoutID
-
-  handle->addRef();
+  AsyncHandle *handle = AsyncHandle::fromId(toTimeoutId(timeoutID));
+  if (handle) handle->addRef(); // does nothing on finished or cleared timers
 
   args.rval().setUndefined();
   return true;
@@ -100,10 +107,8 @@ static bool timerRemoveRef(JSContext *cx, unsigned argc, JS::Value *vp) {
   double timeoutID = args.get(0).toNumber();
 
   // Retrieve the AsyncHandle by `timeoutID`
-  AsyncHandle *handle = AsyncHandle::fromId((uint32_t)timeoutID);
-  if (!handle) return false; // error no such timeoutID
-
-  handle->removeRef();
+  AsyncHandle *handle = AsyncHandle::fromId(toTimeoutId(timeoutID));
+  if (handle) handle->removeRef(); // does nothing on finished or cleared timers
 
   args.rval().setUndefined();
   return true;
@@ -114,8 +119,11 @@ static bool getDebugInfo(JSContext *cx, unsigned argc, JS::Value *vp) {
   double timeoutID = args.get(0).toNumber();
 
   // Retrieve the AsyncHandle by `timeoutID`
-  AsyncHandle *handle = AsyncHandle::fromId((uint32_t)timeoutID);
-  if (!handle) return false; // error no such timeoutID
+  AsyncHandle *handle = AsyncHandle::fromId(toTimeoutId(timeoutID));
+  if (!handle) { // finished or cleared timers have been released
+    args.rval().setUndefined();
+    return true;
+  }
 
   JS::Value debugInfo = jsTypeFactory(cx, handle->getDebugInfo());
   args.rval().set(debugInfo);
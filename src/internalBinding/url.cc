@@ -0,0 +1,2459 @@
+/**
+ * @file url.cc
+ * @author agent (agent@local)
+ * @brief Implement `internalBinding("url")`, the URL and URLSearchParams classes of the WHATWG URL Standard
+ *
+ * @copyright Copyright (c) 2026 Distributive Corp.
+ */
+
+#include "include/internalBinding.hh"
+
+#include <jsapi.h>
+#include <jsfriendapi.h>
+#include <js/Array.h>
+#include <js/ForOfIterator.h>
+#include <js/Object.h>
+#include <js/PropertySpec.h>
+#include <js/String.h>
+#include <js/Symbol.h>
+#include <js/friend/ErrorMessages.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
+ *    `declare function internalBinding(namespace: "url")`
+ *
+ * The parser follows the state machine of https://url.spec.whatwg.org/#concept-basic-url-parser on the code points of the input.
+ * The components of a URL record are kept serialized, as ASCII strings, so that the getters only copy them to a JS string, and the
+ * href is serialized on first use and cached until the URL changes.
+ */
+
+static const char32_t EOF_CODE_POINT = 0xFFFFFFFF;
+
+static const char *INVALID_SCHEME = "Invalid scheme";
+static const char *INVALID_AUTHORITY = "Invalid authority";
+static const char *INVALID_HOST = "Invalid host";
+static const char *INVALID_PORT = "Invalid port";
+
+static const JSErrorFormatString typeErrorFormat = {"URLTypeError", "{0}", 1, JSEXN_TYPEERR};
+
+static const JSErrorFormatString *getTypeErrorMessage(void *userRef, const unsigned errorNumber) {
+  return &typeErrorFormat;
+}
+
+/**
+ * @brief Throw a TypeError with the messages of the core-js polyfill that these classes replace
+ */
+static void reportTypeError(JSContext *cx, const char *message) {
+  JS_ReportErrorNumberASCII(cx, getTypeErrorMessage, nullptr, 0, message);
+}
+
+static inline bool isAsciiAlpha(char32_t c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool isAsciiDigit(char32_t c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline bool isAsciiHexDigit(char32_t c) {
+  return isAsciiDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline char32_t toAsciiLower(char32_t c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline int hexValue(char32_t c) {
+  return isAsciiDigit(c) ? c - '0' : (int)(toAsciiLower(c) - 'a' + 10);
+}
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/**
+ * @brief The percent-encode sets, each one includes the ones after it, except for the special-query and fragment sets
+ */
+enum class EncodeSet {
+  FormUrlencoded,
+  Component,
+  Userinfo,
+  Path,
+  Query,
+  SpecialQuery,
+  Fragment,
+  C0Control,
+};
+
+static bool inEncodeSet(char32_t c, EncodeSet set) {
+  if (c < 0x20 || c > 0x7E) {
+    return true;
+  }
+  switch (set) {
+  case EncodeSet::FormUrlencoded:
+    if (c == '!' || (c >= '\'' && c <= ')') || c == '~') return true;
+    [[fallthrough]];
+  case EncodeSet::Component:
+    if ((c >= '$' && c <= '&') || c == '+' || c == ',') return true;
+    [[fallthrough]];
+  case EncodeSet::Userinfo:
+    if (c == '/' || c == ':' || c == ';' || c == '=' || c == '@' || (c >= '[' && c <= '^') || c == '|') return true;
+    [[fallthrough]];
+  case EncodeSet::Path:
+    if (c == '?' || c == '`' || c == '{' || c == '}') return true;
+    [[fallthrough]];
+  case EncodeSet::Query:
+    return c == ' ' || c == '"' || c == '#' || c == '<' || c == '>';
+  case EncodeSet::SpecialQuery:
+    return c == ' ' || c == '"' || c == '#' || c == '<' || c == '>' || c == '\'';
+  case EncodeSet::Fragment:
+    return c == ' ' || c == '"' || c == '<' || c == '>' || c == '`';
+  case EncodeSet::C0Control:
+    return false;
+  }
+  return false;
+}
+
+static void appendUtf8(std::string &out, char32_t c) {
+  if (c < 0x80) {
+    out += (char)c;
+  } else if (c < 0x800) {
+    out += (char)(0xC0 | (c >> 6));
+    out += (char)(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    out += (char)(0xE0 | (c >> 12));
+    out += (char)(0x80 | ((c >> 6) & 0x3F));
+    out += (char)(0x80 | (c & 0x3F));
+  } else {
+    out += (char)(0xF0 | (c >> 18));
+    out += (char)(0x80 | ((c >> 12) & 0x3F));
+    out += (char)(0x80 | ((c >> 6) & 0x3F));
+    out += (char)(0x80 | (c & 0x3F));
+  }
+}
+
+static void appendUtf16(std::u16string &out, char32_t c) {
+  if (c < 0x10000) {
+    out += (char16_t)c;
+  } else {
+    out += (char16_t)(0xD800 + ((c - 0x10000) >> 10));
+    out += (char16_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+  }
+}
+
+/**
+ * @brief Append a code point, UTF-8 percent-encoded if it is in the set
+ */
+static void percentEncode(std::string &out, char32_t c, EncodeSet set) {
+  if (!inEncodeSet(c, set)) {
+    out += (char)c;
+    return;
+  }
+  std::string bytes;
+  appendUtf8(bytes, c);
+  for (unsigned char byte : bytes) {
+    out += '%';
+    out += HEX_DIGITS[byte >> 4];
+    out += HEX_DIGITS[byte & 0xF];
+  }
+}
+
+static std::string percentDecode(std::string_view input) {
+  std::string out;
+  out.reserve(input.size());
+  for (size_t index = 0; index < input.size(); index++) {
+    if (input[index] == '%' && index + 2 < input.size() && isAsciiHexDigit(input[index + 1]) && isAsciiHexDigit(input[index + 2])) {
+      out += (char)(hexValue(input[index + 1]) * 16 + hexValue(input[index + 2]));
+      index += 2;
+    } else {
+      out += input[index];
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief UTF-8 decode without BOM, each maximal invalid subpart replaced by U+FFFD
+ */
+static std::u32string decodeUtf8(std::string_view bytes) {
+  std::u32string out;
+  out.reserve(bytes.size());
+  size_t index = (bytes.size() >= 3 && bytes.substr(0, 3) == "\xEF\xBB\xBF") ? 3 : 0;
+  while (index < bytes.size()) {
+    uint8_t lead = bytes[index++];
+    if (lead < 0x80) {
+      out += lead;
+      continue;
+    }
+    size_t needed;
+    char32_t codePoint;
+    uint8_t lower = 0x80, upper = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      needed = 1;
+      codePoint = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      needed = 2;
+      codePoint = lead & 0xF;
+      lower = lead == 0xE0 ? 0xA0 : 0x80;
+      upper = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      needed = 3;
+      codePoint = lead & 0x7;
+      lower = lead == 0xF0 ? 0x90 : 0x80;
+      upper = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      out += 0xFFFD;
+      continue;
+    }
+    size_t seen = 0;
+    while (seen < needed && index < bytes.size() && (uint8_t)bytes[index] >= lower && (uint8_t)bytes[index] <= upper) {
+      codePoint = (codePoint << 6) | (bytes[index] & 0x3F);
+      lower = 0x80;
+      upper = 0xBF;
+      index++;
+      seen++;
+    }
+    out += seen == needed ? codePoint : 0xFFFD;
+  }
+  return out;
+}
+
+/**
+ * @brief The code points of `ToString(value)`, lone surrogates replaced by U+FFFD
+ */
+static bool toCodePoints(JSContext *cx, JS::HandleValue value, std::u32string &out) {
+  JS::RootedString str(cx, JS::ToString(cx, value));
+  if (!str) {
+    return false;
+  }
+  JSLinearString *linear = JS_EnsureLinearString(cx, str);
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(linear);
+  out.clear();
+  out.reserve(length);
+  JS::AutoCheckCannotGC nogc;
+  if (JS::LinearStringHasLatin1Chars(linear)) {
+    const JS::Latin1Char *chars = JS::GetLatin1LinearStringChars(nogc, linear);
+    out.assign(chars, chars + length);
+    return true;
+  }
+  const char16_t *chars = JS::GetTwoByteLinearStringChars(nogc, linear);
+  for (size_t index = 0; index < length; index++) {
+    char32_t c = chars[index];
+    if (c >= 0xD800 && c <= 0xDBFF && index + 1 < length && chars[index + 1] >= 0xDC00 && chars[index + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (chars[++index] - 0xDC00);
+    } else if (c >= 0xD800 && c <= 0xDFFF) {
+      c = 0xFFFD;
+    }
+    out += c;
+  }
+  return true;
+}
+
+/**
+ * @brief `ToString(value)` as a USVString, lone surrogates replaced by U+FFFD
+ */
+static bool toUSVString(JSContext *cx, JS::HandleValue value, std::u16string &out) {
+  JS::RootedString str(cx, JS::ToString(cx, value));
+  if (!str) {
+    return false;
+  }
+  JSLinearString *linear = JS_EnsureLinearString(cx, str);
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(linear);
+  out.resize(length);
+  JS::AutoCheckCannotGC nogc;
+  if (JS::LinearStringHasLatin1Chars(linear)) {
+    const JS::Latin1Char *chars = JS::GetLatin1LinearStringChars(nogc, linear);
+    std::copy(chars, chars + length, out.begin());
+    return true;
+  }
+  const char16_t *chars = JS::GetTwoByteLinearStringChars(nogc, linear);
+  for (size_t index = 0; index < length; index++) {
+    char16_t c = chars[index];
+    if (c >= 0xD800 && c <= 0xDBFF && index + 1 < length && chars[index + 1] >= 0xDC00 && chars[index + 1] <= 0xDFFF) {
+      out[index] = c;
+      out[index + 1] = chars[index + 1];
+      index++;
+    } else {
+      out[index] = (c >= 0xD800 && c <= 0xDFFF) ? 0xFFFD : c;
+    }
+  }
+  return true;
+}
+
+static bool returnString(JSContext *cx, JS::CallArgs &args, std::string_view ascii) {
+  JSString *str = JS_NewStringCopyN(cx, ascii.data(), ascii.size());
+  if (!str) {
+    return false;
+  }
+  args.rval().setString(str);
+  return true;
+}
+
+static JSString *newString(JSContext *cx, const std::u16string &chars) {
+  return JS_NewUCStringCopyN(cx, chars.data(), chars.size());
+}
+
+/**
+ * @brief A URL record, https://url.spec.whatwg.org/#concept-url
+ */
+struct URLRecord {
+  std::string scheme;
+  std::string username;
+  std::string password;
+  bool hasHost = false;
+  std::string host;                 // serialized: a domain, an IPv4 address, an IPv6 address in brackets, an opaque host or empty
+  int32_t port = -1;                // -1 if null
+  bool hasOpaquePath = false;
+  std::string opaquePath;
+  std::vector<std::string> path;    // the segments if the path is not opaque
+  bool hasQuery = false;
+  std::string query;
+  bool hasFragment = false;
+  std::string fragment;
+
+  mutable std::string href;
+  mutable bool hrefValid = false;
+
+  bool isSpecial() const;
+  bool includesCredentials() const {
+    return !username.empty() || !password.empty();
+  }
+  bool cannotHaveUsernamePasswordPort() const {
+    return !hasHost || host.empty() || scheme == "file";
+  }
+  const std::string &serialize() const;
+  void serializePath(std::string &out) const;
+};
+
+/**
+ * @return the default port of a scheme, -1 if it is not special or has none, -2 if it is not special
+ */
+static int32_t defaultPort(std::string_view scheme) {
+  if (scheme == "http" || scheme == "ws") return 80;
+  if (scheme == "https" || scheme == "wss") return 443;
+  if (scheme == "ftp") return 21;
+  if (scheme == "file") return -1;
+  return -2;
+}
+
+static bool isSpecialScheme(std::string_view scheme) {
+  return defaultPort(scheme) != -2;
+}
+
+bool URLRecord::isSpecial() const {
+  return isSpecialScheme(scheme);
+}
+
+void URLRecord::serializePath(std::string &out) const {
+  if (hasOpaquePath) {
+    out += opaquePath;
+    return;
+  }
+  for (const std::string &segment : path) {
+    out += '/';
+    out += segment;
+  }
+}
+
+const std::string &URLRecord::serialize() const {
+  if (hrefValid) {
+    return href;
+  }
+  href.clear();
+  href += scheme;
+  href += ':';
+  if (hasHost) {
+    href += "//";
+    if (includesCredentials()) {
+      href += username;
+      if (!password.empty()) {
+        href += ':';
+        href += password;
+      }
+      href += '@';
+    }
+    href += host;
+    if (port >= 0) {
+      href += ':';
+      href += std::to_string(port);
+    }
+  } else if (!hasOpaquePath && path.size() > 1 && path[0].empty()) {
+    href += "/.";
+  }
+  serializePath(href);
+  if (hasQuery) {
+    href += '?';
+    href += query;
+  }
+  if (hasFragment) {
+    href += '#';
+    href += fragment;
+  }
+  hrefValid = true;
+  return href;
+}
+
+static void stripTrailingSpacesFromOpaquePath(URLRecord &url) {
+  if (url.hasOpaquePath && !url.hasQuery && !url.hasFragment) {
+    url.opaquePath.erase(url.opaquePath.find_last_not_of(' ') + 1);
+  }
+}
+
+template<typename Chars>
+static bool isWindowsDriveLetter(const Chars &chars, bool normalized = false) {
+  return chars.size() == 2 && isAsciiAlpha(chars[0]) && (chars[1] == ':' || (!normalized && chars[1] == '|'));
+}
+
+static bool startsWithWindowsDriveLetter(const std::u32string &input, ptrdiff_t pointer) {
+  size_t remaining = input.size() - pointer;
+  if (remaining < 2 || !isWindowsDriveLetter(input.substr(pointer, 2))) {
+    return false;
+  }
+  if (remaining == 2) {
+    return true;
+  }
+  char32_t c = input[pointer + 2];
+  return c == '/' || c == '\\' || c == '?' || c == '#';
+}
+
+static void shortenPath(URLRecord &url) {
+  if (url.scheme == "file" && url.path.size() == 1 && isWindowsDriveLetter(url.path[0], true)) {
+    return;
+  }
+  if (!url.path.empty()) {
+    url.path.pop_back();
+  }
+}
+
+static bool equalsAsciiLowercase(std::string_view str, std::string_view lowercase) {
+  return str.size() == lowercase.size() &&
+         std::equal(str.begin(), str.end(), lowercase.begin(), [](char a, char b) { return toAsciiLower(a) == (char32_t)b; });
+}
+
+static bool isSingleDotSegment(std::string_view segment) {
+  return segment == "." || equalsAsciiLowercase(segment, "%2e");
+}
+
+static bool isDoubleDotSegment(std::string_view segment) {
+  return segment == ".." || equalsAsciiLowercase(segment, ".%2e") || equalsAsciiLowercase(segment, "%2e.") ||
+         equalsAsciiLowercase(segment, "%2e%2e");
+}
+
+static bool isForbiddenHostCodePoint(char32_t c) {
+  switch (c) {
+  case 0x00: case 0x09: case 0x0A: case 0x0D: case ' ': case '#': case '/': case ':': case '<': case '>': case '?': case '@':
+  case '[': case '\\': case ']': case '^': case '|':
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool isForbiddenDomainCodePoint(char32_t c) {
+  return isForbiddenHostCodePoint(c) || c <= 0x1F || c == '%' || c == 0x7F;
+}
+
+/**
+ * @brief Parse the address of an IPv6 host, between its brackets, and serialize it in its compressed form
+ */
+static bool parseIPv6(std::u32string_view input, std::string &host) {
+  uint16_t address[8] = {0};
+  int pieceIndex = 0;
+  int compress = -1;
+  size_t pointer = 0;
+  auto c = [&]() { return pointer < input.size() ? input[pointer] : EOF_CODE_POINT; };
+
+  if (c() == ':') {
+    if (pointer + 1 >= input.size() || input[pointer + 1] != ':') return false;
+    pointer += 2;
+    compress = ++pieceIndex;
+  }
+  while (c() != EOF_CODE_POINT) {
+    if (pieceIndex == 8) return false;
+    if (c() == ':') {
+      if (compress != -1) return false;
+      pointer++;
+      compress = ++pieceIndex;
+      continue;
+    }
+    uint32_t value = 0;
+    size_t length = 0;
+    while (length < 4 && isAsciiHexDigit(c())) {
+      value = value * 0x10 + hexValue(c());
+      pointer++;
+      length++;
+    }
+    if (c() == '.') { // an IPv4 address in the last two pieces
+      if (length == 0) return false;
+      pointer -= length;
+      if (pieceIndex > 6) return false;
+      int numbersSeen = 0;
+      while (c() != EOF_CODE_POINT) {
+        int ipv4Piece = -1;
+        if (numbersSeen > 0) {
+          if (c() == '.' && numbersSeen < 4) pointer++;
+          else return false;
+        }
+        if (!isAsciiDigit(c())) return false;
+        while (isAsciiDigit(c())) {
+          int number = c() - '0';
+          if (ipv4Piece == -1) ipv4Piece = number;
+          else if (ipv4Piece == 0) return false;
+          else ipv4Piece = ipv4Piece * 10 + number;
+          if (ipv4Piece > 255) return false;
+          pointer++;
+        }
+        address[pieceIndex] = address[pieceIndex] * 0x100 + ipv4Piece;
+        numbersSeen++;
+        if (numbersSeen == 2 || numbersSeen == 4) pieceIndex++;
+      }
+      if (numbersSeen != 4) return false;
+      break;
+    } else if (c() == ':') {
+      pointer++;
+      if (c() == EOF_CODE_POINT) return false;
+    } else if (c() != EOF_CODE_POINT) {
+      return false;
+    }
+    address[pieceIndex++] = value;
+  }
+  if (compress != -1) {
+    int swaps = pieceIndex - compress;
+    pieceIndex = 7;
+    while (pieceIndex != 0 && swaps > 0) {
+      std::swap(address[pieceIndex], address[compress + swaps - 1]);
+      pieceIndex--;
+      swaps--;
+    }
+  } else if (pieceIndex != 8) {
+    return false;
+  }
+
+  // the first longest run of at least two zero pieces is compressed
+  int compressed = -1, longest = 1;
+  for (int index = 0; index < 8;) {
+    int end = index;
+    while (end < 8 && address[end] == 0) end++;
+    if (end - index > longest) {
+      compressed = index;
+      longest = end - index;
+    }
+    index = end > index ? end : index + 1;
+  }
+  host = "[";
+  for (int index = 0; index < 8; index++) {
+    if (index == compressed) {
+      host += index == 0 ? "::" : ":";
+      index += longest - 1;
+      continue;
+    }
+    char piece[5];
+    snprintf(piece, sizeof(piece), "%x", address[index]);
+    host += piece;
+    if (index != 7) host += ':';
+  }
+  host += ']';
+  return true;
+}
+
+/**
+ * @return false if the part is not an IPv4 number, decimal, octal with a leading 0 or hexadecimal with a leading 0x
+ */
+static bool parseIPv4Number(std::string_view part, uint64_t &value) {
+  if (part.empty()) return false;
+  int radix = 10;
+  if (part.size() >= 2 && part[0] == '0' && (part[1] == 'x' || part[1] == 'X')) {
+    radix = 16;
+    part.remove_prefix(2);
+  } else if (part.size() >= 2 && part[0] == '0') {
+    radix = 8;
+    part.remove_prefix(1);
+  }
+  value = 0;
+  for (char c : part) {
+    int digit;
+    if (radix == 16 && isAsciiHexDigit(c)) digit = hexValue(c);
+    else if (isAsciiDigit(c) && c - '0' < radix) digit = c - '0';
+    else return false;
+    value = std::min<uint64_t>(value * radix + digit, 1ull << 40); // saturated, all that matters is that it is too big
+  }
+  return true;
+}
+
+static std::vector<std::string_view> splitOnDots(std::string_view input) {
+  std::vector<std::string_view> parts;
+  size_t start = 0;
+  while (true) {
+    size_t dot = input.find('.', start);
+    parts.push_back(input.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start));
+    if (dot == std::string_view::npos) return parts;
+    start = dot + 1;
+  }
+}
+
+static bool endsInANumber(std::string_view domain) {
+  std::vector<std::string_view> parts = splitOnDots(domain);
+  if (parts.back().empty()) {
+    if (parts.size() == 1) return false;
+    parts.pop_back();
+  }
+  std::string_view last = parts.back();
+  if (!last.empty() && std::all_of(last.begin(), last.end(), [](char c) { return isAsciiDigit(c); })) {
+    return true;
+  }
+  uint64_t value;
+  return parseIPv4Number(last, value);
+}
+
+static bool parseIPv4(std::string_view domain, std::string &host) {
+  std::vector<std::string_view> parts = splitOnDots(domain);
+  if (parts.back().empty() && parts.size() > 1) {
+    parts.pop_back();
+  }
+  if (parts.size() > 4) return false;
+  std::vector<uint64_t> numbers;
+  for (std::string_view part : parts) {
+    uint64_t value;
+    if (!parseIPv4Number(part, value)) return false;
+    numbers.push_back(value);
+  }
+  for (size_t index = 0; index + 1 < numbers.size(); index++) {
+    if (numbers[index] > 255) return false;
+  }
+  if (numbers.back() >= (1ull << (8 * (5 - numbers.size())))) return false;
+  uint64_t ipv4 = numbers.back();
+  for (size_t index = 0; index + 1 < numbers.size(); index++) {
+    ipv4 += numbers[index] << (8 * (3 - index));
+  }
+  host = std::to_string(ipv4 >> 24) + '.' + std::to_string((ipv4 >> 16) & 0xFF) + '.' +
+         std::to_string((ipv4 >> 8) & 0xFF) + '.' + std::to_string(ipv4 & 0xFF);
+  return true;
+}
+
+static char punycodeDigit(uint32_t digit) {
+  return digit < 26 ? 'a' + digit : '0' + (digit - 26);
+}
+
+static uint32_t punycodeAdapt(uint32_t delta, uint32_t numPoints, bool firstTime) {
+  delta = firstTime ? delta / 700 : delta / 2;
+  delta += delta / numPoints;
+  uint32_t k = 0;
+  while (delta > ((36 - 1) * 26) / 2) {
+    delta /= 36 - 1;
+    k += 36;
+  }
+  return k + (36 * delta) / (delta + 38);
+}
+
+/**
+ * @brief Append the Punycode of a label, RFC 3492
+ *
+ * @return false on overflow
+ */
+static bool punycodeEncode(const std::u32string &label, std::string &out) {
+  uint32_t n = 128, delta = 0, bias = 72;
+  size_t basicCount = 0;
+  for (char32_t c : label) {
+    if (c < 0x80) {
+      out += (char)c;
+      basicCount++;
+    }
+  }
+  size_t handled = basicCount;
+  if (basicCount > 0) {
+    out += '-';
+  }
+  while (handled < label.size()) {
+    uint32_t m = UINT32_MAX;
+    for (char32_t c : label) {
+      if (c >= n && c < m) m = c;
+    }
+    if ((m - n) > (UINT32_MAX - delta) / (handled + 1)) return false;
+    delta += (m - n) * (handled + 1);
+    n = m;
+    for (char32_t c : label) {
+      if (c < n && ++delta == 0) return false;
+      if (c == n) {
+        uint32_t q = delta;
+        for (uint32_t k = 36;; k += 36) {
+          uint32_t t = k <= bias ? 1 : (k >= bias + 26 ? 26 : k - bias);
+          if (q < t) break;
+          out += punycodeDigit(t + (q - t) % (36 - t));
+          q = (q - t) / (36 - t);
+        }
+        out += punycodeDigit(q);
+        bias = punycodeAdapt(delta, handled + 1, handled == basicCount);
+        delta = 0;
+        handled++;
+      }
+    }
+    delta++;
+    n++;
+  }
+  return true;
+}
+
+// the original `String.prototype.normalize` and `String.prototype.toLowerCase`, captured by InternalBinding::initUrl or
+// createClasses, so that a user script replacing them does not change the parsed hosts
+static JS::PersistentRootedValue *stringNormalize = nullptr;
+static JS::PersistentRootedValue *stringToLowerCase = nullptr;
+
+/**
+ * @brief Capture a method of the String prototype
+ */
+static bool captureStringMethod(JSContext *cx, const char *name, JS::PersistentRootedValue **method) {
+  if (*method) {
+    return true;
+  }
+  JS::RootedObject stringPrototype(cx);
+  JS::RootedValue value(cx);
+  if (!JS_GetClassPrototype(cx, JSProto_String, &stringPrototype) || !JS_GetProperty(cx, stringPrototype, name, &value)) {
+    return false;
+  }
+  *method = new JS::PersistentRootedValue(cx, value);
+  return true;
+}
+
+bool InternalBinding::initUrl(JSContext *cx) {
+  return captureStringMethod(cx, "normalize", &stringNormalize) && captureStringMethod(cx, "toLowerCase", &stringToLowerCase);
+}
+
+void InternalBinding::finalizeUrl() {
+  delete stringNormalize;
+  stringNormalize = nullptr;
+  delete stringToLowerCase;
+  stringToLowerCase = nullptr;
+}
+
+/**
+ * @brief Call a captured method of the String prototype on a string
+ */
+static bool callStringMethod(JSContext *cx, JS::MutableHandleValue str, JS::PersistentRootedValue *method, const char *argument) {
+  JS::RootedValueArray<1> args(cx);
+  if (argument) {
+    JSString *argumentStr = JS_NewStringCopyZ(cx, argument);
+    if (!argumentStr) {
+      return false;
+    }
+    args[0].setString(argumentStr);
+  }
+  return JS::Call(cx, str, *method, argument ? JS::HandleValueArray(args) : JS::HandleValueArray::empty(), str);
+}
+
+/**
+ * @brief The UTS #46 ToASCII of a domain, with its mapping of non-ASCII domains approximated by the NFKC normalization and the
+ * lowercasing of the engine: the Intl data of SpiderMonkey already has the Unicode tables, the exact IDNA mapping ones are not exposed
+ *
+ * @param failure - set to the error message if the domain is invalid
+ * @return false with a JS exception pending on failure
+ */
+static bool domainToAscii(JSContext *cx, const std::u32string &domain, std::string &result, const char **failure) {
+  result.clear();
+  if (std::all_of(domain.begin(), domain.end(), [](char32_t codePoint) { return codePoint < 0x80; })) {
+    for (char32_t c : domain) {
+      result += (char)toAsciiLower(c);
+    }
+  } else {
+    std::u16string chars;
+    for (char32_t c : domain) {
+      appendUtf16(chars, c);
+    }
+    JS::RootedValue mappedValue(cx);
+    JSString *str = newString(cx, chars);
+    if (!str) {
+      return false;
+    }
+    mappedValue.setString(str);
+    std::u32string mapped;
+    if (!callStringMethod(cx, &mappedValue, stringNormalize, "NFKC") || !callStringMethod(cx, &mappedValue, stringToLowerCase, nullptr) ||
+        !toCodePoints(cx, mappedValue, mapped)) {
+      return false;
+    }
+
+    std::u32string label;
+    for (size_t index = 0; index <= mapped.size(); index++) {
+      char32_t c = index < mapped.size() ? mapped[index] : EOF_CODE_POINT;
+      if (c == 0x00AD || c == 0x200B || c == 0x2060 || c == 0xFEFF || (c >= 0xFE00 && c <= 0xFE0F)) {
+        continue; // ignored by the mapping
+      }
+      if (c != '.' && c != 0x3002 && c != EOF_CODE_POINT) {
+        label += c;
+        continue;
+      }
+      if (std::all_of(label.begin(), label.end(), [](char32_t codePoint) { return codePoint < 0x80; })) {
+        result.append(label.begin(), label.end());
+      } else {
+        result += "xn--";
+        if (!punycodeEncode(label, result)) {
+          *failure = INVALID_HOST;
+          return true;
+        }
+      }
+      if (c != EOF_CODE_POINT) {
+        result += '.';
+      }
+      label.clear();
+    }
+  }
+  if (result.empty()) {
+    *failure = INVALID_HOST;
+  }
+  return true;
+}
+
+/**
+ * @brief The host parser, https://url.spec.whatwg.org/#concept-host-parser
+ *
+ * @param failure - set to the error message if the host is invalid
+ * @return false with a JS exception pending on failure
+ */
+static bool parseHost(JSContext *cx, const std::u32string &input, bool isOpaque, std::string &host, const char **failure) {
+  if (!input.empty() && input[0] == '[') {
+    if (input.back() != ']' || !parseIPv6(std::u32string_view(input).substr(1, input.size() - 2), host)) {
+      *failure = INVALID_HOST;
+    }
+    return true;
+  }
+  host.clear();
+  if (isOpaque) {
+    for (char32_t c : input) {
+      if (isForbiddenHostCodePoint(c)) {
+        *failure = INVALID_HOST;
+        return true;
+      }
+      percentEncode(host, c, EncodeSet::C0Control);
+    }
+    return true;
+  }
+
+  std::string bytes;
+  for (char32_t c : input) {
+    appendUtf8(bytes, c);
+  }
+  std::string asciiDomain;
+  if (!domainToAscii(cx, decodeUtf8(percentDecode(bytes)), asciiDomain, failure)) {
+    return false;
+  }
+  if (*failure) {
+    return true;
+  }
+  for (char c : asciiDomain) {
+    if (isForbiddenDomainCodePoint((unsigned char)c)) {
+      *failure = INVALID_HOST;
+      return true;
+    }
+  }
+  if (endsInANumber(asciiDomain)) {
+    if (!parseIPv4(asciiDomain, host)) {
+      *failure = INVALID_HOST;
+    }
+    return true;
+  }
+  host = std::move(asciiDomain);
+  return true;
+}
+
+enum class State {
+  None,
+  SchemeStart,
+  Scheme,
+  NoScheme,
+  SpecialRelativeOrAuthority,
+  PathOrAuthority,
+  Relative,
+  RelativeSlash,
+  SpecialAuthoritySlashes,
+  SpecialAuthorityIgnoreSlashes,
+  Authority,
+  Host,
+  Hostname,
+  Port,
+  File,
+  FileSlash,
+  FileHost,
+  PathStart,
+  Path,
+  OpaquePath,
+  Query,
+  Fragment,
+};
+
+/**
+ * @brief The basic URL parser, https://url.spec.whatwg.org/#concept-basic-url-parser
+ *
+ * @param input - the code points of the input
+ * @param base - the base URL, or nullptr
+ * @param url - the URL to parse into, reset unless `stateOverride` is given, which is how the setters change a part of a URL
+ * @param stateOverride - the state to start in, State::None for none
+ * @param failure - set to the error message if the input is not a valid URL, or is not valid for the setter, and left null otherwise
+ * @return false with a JS exception pending on failure
+ */
+static bool basicParse(JSContext *cx, std::u32string input, const URLRecord *base, URLRecord &url, State stateOverride, const char **failure) {
+  *failure = nullptr;
+  const bool override = stateOverride != State::None;
+  if (!override) {
+    url = URLRecord();
+    size_t end = input.size();
+    while (end > 0 && input[end - 1] <= 0x20) end--;
+    size_t begin = 0;
+    while (begin < end && input[begin] <= 0x20) begin++;
+    input = input.substr(begin, end - begin);
+  }
+  input.erase(std::remove_if(input.begin(), input.end(), [](char32_t c) { return c == 0x09 || c == 0x0A || c == 0x0D; }), input.end());
+  url.hrefValid = false;
+
+  State state = override ? stateOverride : State::SchemeStart;
+  std::u32string buffer;
+  std::string pathBuffer;
+  bool atSignSeen = false, insideBrackets = false, passwordTokenSeen = false;
+  const ptrdiff_t length = input.size();
+
+  for (ptrdiff_t pointer = 0;; pointer++) {
+    const char32_t c = pointer < length ? input[pointer] : EOF_CODE_POINT;
+    const bool special = url.isSpecial();
+    const bool endOfAuthority = c == EOF_CODE_POINT || c == '/' || c == '?' || c == '#' || (special && c == '\\');
+
+    switch (state) {
+    case State::None:
+      break;
+
+    case State::SchemeStart:
+      if (isAsciiAlpha(c)) {
+        buffer += toAsciiLower(c);
+        state = State::Scheme;
+      } else if (!override) {
+        state = State::NoScheme;
+        pointer--;
+      } else {
+        *failure = INVALID_SCHEME;
+        return true;
+      }
+      break;
+
+    case State::Scheme:
+      if (isAsciiAlpha(c) || isAsciiDigit(c) || c == '+' || c == '-' || c == '.') {
+        buffer += toAsciiLower(c);
+      } else if (c == ':') {
+        std::string scheme(buffer.begin(), buffer.end());
+        if (override) {
+          if (url.isSpecial() != isSpecialScheme(scheme) ||
+              ((url.includesCredentials() || url.port >= 0) && scheme == "file") ||
+              (url.scheme == "file" && url.hasHost && url.host.empty())) {
+            return true;
+          }
+        }
+        url.scheme = std::move(scheme);
+        if (override) {
+          if (url.port == defaultPort(url.scheme)) {
+            url.port = -1;
+          }
+          return true;
+        }
+        buffer.clear();
+        if (url.scheme == "file") {
+          state = State::File;
+        } else if (url.isSpecial() && base && base->scheme == url.scheme) {
+          state = State::SpecialRelativeOrAuthority;
+        } else if (url.isSpecial()) {
+          state = State::SpecialAuthoritySlashes;
+        } else if (pointer + 1 < length && input[pointer + 1] == '/') {
+          state = State::PathOrAuthority;
+          pointer++;
+        } else {
+          url.hasOpaquePath = true;
+          state = State::OpaquePath;
+        }
+      } else if (!override) {
+        buffer.clear();
+        state = State::NoScheme;
+        pointer = -1;
+      } else {
+        *failure = INVALID_SCHEME;
+        return true;
+      }
+      break;
+
+    case State::NoScheme:
+      if (!base || (base->hasOpaquePath && c != '#')) {
+        *failure = INVALID_SCHEME;
+        return true;
+      } else if (base->hasOpaquePath) {
+        url.scheme = base->scheme;
+        url.hasOpaquePath = true;
+        url.opaquePath = base->opaquePath;
+        url.hasQuery = base->hasQuery;
+        url.query = base->query;
+        url.hasFragment = true;
+        state = State::Fragment;
+      } else {
+        state = base->scheme != "file" ? State::Relative : State::File;
+        pointer--;
+      }
+      break;
+
+    case State::SpecialRelativeOrAuthority:
+      if (c == '/' && pointer + 1 < length && input[pointer + 1] == '/') {
+        state = State::SpecialAuthorityIgnoreSlashes;
+        pointer++;
+      } else {
+        state = State::Relative;
+        pointer--;
+      }
+      break;
+
+    case State::PathOrAuthority:
+      if (c == '/') {
+        state = State::Authority;
+      } else {
+        state = State::Path;
+        pointer--;
+      }
+      break;
+
+    case State::Relative:
+      url.scheme = base->scheme;
+      if (c == '/' || (url.isSpecial() && c == '\\')) {
+        state = State::RelativeSlash;
+      } else {
+        url.username = base->username;
+        url.password = base->password;
+        url.hasHost = base->hasHost;
+        url.host = base->host;
+        url.port = base->port;
+        url.path = base->path;
+        url.hasQuery = base->hasQuery;
+        url.query = base->query;
+        if (c == '?') {
+          url.hasQuery = true;
+          url.query.clear();
+          state = State::Query;
+        } else if (c == '#') {
+          url.hasFragment = true;
+          state = State::Fragment;
+        } else if (c != EOF_CODE_POINT) {
+          url.hasQuery = false;
+          url.query.clear();
+          shortenPath(url);
+          state = State::Path;
+          pointer--;
+        }
+      }
+      break;
+
+    case State::RelativeSlash:
+      if (special && (c == '/' || c == '\\')) {
+        state = State::SpecialAuthorityIgnoreSlashes;
+      } else if (c == '/') {
+        state = State::Authority;
+      } else {
+        url.username = base->username;
+        url.password = base->password;
+        url.hasHost = base->hasHost;
+        url.host = base->host;
+        url.port = base->port;
+        state = State::Path;
+        pointer--;
+      }
+      break;
+
+    case State::SpecialAuthoritySlashes:
+      state = State::SpecialAuthorityIgnoreSlashes;
+      if (c == '/' && pointer + 1 < length && input[pointer + 1] == '/') {
+        pointer++;
+      } else {
+        pointer--;
+      }
+      break;
+
+    case State::SpecialAuthorityIgnoreSlashes:
+      if (c != '/' && c != '\\') {
+        state = State::Authority;
+        pointer--;
+      }
+      break;
+
+    case State::Authority:
+      if (c == '@') {
+        if (atSignSeen) {
+          buffer.insert(0, U"%40");
+        }
+        atSignSeen = true;
+        for (char32_t codePoint : buffer) {
+          if (codePoint == ':' && !passwordTokenSeen) {
+            passwordTokenSeen = true;
+            continue;
+          }
+          percentEncode(passwordTokenSeen ? url.password : url.username, codePoint, EncodeSet::Userinfo);
+        }
+        buffer.clear();
+      } else if (endOfAuthority) {
+        if (atSignSeen && buffer.empty()) {
+          *failure = INVALID_AUTHORITY;
+          return true;
+        }
+        pointer -= (ptrdiff_t)buffer.size() + 1;
+        buffer.clear();
+        state = State::Host;
+      } else {
+        buffer += c;
+      }
+      break;
+
+    case State::Host:
+    case State::Hostname:
+      if (override && url.scheme == "file") {
+        pointer--;
+        state = State::FileHost;
+      } else if (c == ':' && !insideBrackets) {
+        if (buffer.empty()) {
+          *failure = INVALID_HOST;
+          return true;
+        }
+        if (stateOverride == State::Hostname) {
+          return true;
+        }
+        std::string host;
+        if (!parseHost(cx, buffer, !special, host, failure)) {
+          return false;
+        }
+        if (*failure) {
+          return true;
+        }
+        url.hasHost = true;
+        url.host = std::move(host);
+        buffer.clear();
+        state = State::Port;
+      } else if (endOfAuthority) {
+        pointer--;
+        if (special && buffer.empty()) {
+          *failure = INVALID_HOST;
+          return true;
+        } else if (override && buffer.empty() && (url.includesCredentials() || url.port >= 0)) {
+          return true;
+        }
+        std::string host;
+        if (!parseHost(cx, buffer, !special, host, failure)) {
+          return false;
+        }
+        if (*failure) {
+          return true;
+        }
+        url.hasHost = true;
+        url.host = std::move(host);
+        buffer.clear();
+        state = State::PathStart;
+        if (override) {
+          return true;
+        }
+      } else {
+        if (c == '[') insideBrackets = true;
+        if (c == ']') insideBrackets = false;
+        buffer += c;
+      }
+      break;
+
+    case State::Port:
+      if (isAsciiDigit(c)) {
+        buffer += c;
+      } else if (endOfAuthority || override) {
+        if (!buffer.empty()) {
+          uint32_t port = 0;
+          for (char32_t digit : buffer) {
+            port = port * 10 + (digit - '0');
+            if (port > 65535) {
+              *failure = INVALID_PORT;
+              return true;
+            }
+          }
+          url.port = (int32_t)port == defaultPort(url.scheme) ? -1 : (int32_t)port;
+          buffer.clear();
+          if (override) {
+            return true;
+          }
+        }
+        if (override) {
+          *failure = INVALID_PORT;
+          return true;
+        }
+        state = State::PathStart;
+        pointer--;
+      } else {
+        *failure = INVALID_PORT;
+        return true;
+      }
+      break;
+
+    case State::File:
+      url.scheme = "file";
+      url.hasHost = true;
+      url.host.clear();
+      if (c == '/' || c == '\\') {
+        state = State::FileSlash;
+      } else if (base && base->scheme == "file") {
+        url.hasHost = base->hasHost;
+        url.host = base->host;
+        url.path = base->path;
+        url.hasQuery = base->hasQuery;
+        url.query = base->query;
+        if (c == '?') {
+          url.hasQuery = true;
+          url.query.clear();
+          state = State::Query;
+        } else if (c == '#') {
+          url.hasFragment = true;
+          state = State::Fragment;
+        } else if (c != EOF_CODE_POINT) {
+          url.hasQuery = false;
+          url.query.clear();
+          if (!startsWithWindowsDriveLetter(input, pointer)) {
+            shortenPath(url);
+          } else {
+            url.path.clear();
+          }
+          state = State::Path;
+          pointer--;
+        }
+      } else {
+        state = State::Path;
+        pointer--;
+      }
+      break;
+
+    case State::FileSlash:
+      if (c == '/' || c == '\\') {
+        state = State::FileHost;
+      } else {
+        if (base && base->scheme == "file") {
+          url.hasHost = base->hasHost;
+          url.host = base->host;
+          if (!startsWithWindowsDriveLetter(input, pointer) && !base->path.empty() && isWindowsDriveLetter(base->path[0], true)) {
+            url.path.push_back(base->path[0]);
+          }
+        }
+        state = State::Path;
+        pointer--;
+      }
+      break;
+
+    case State::FileHost:
+      if (c == EOF_CODE_POINT || c == '/' || c == '\\' || c == '?' || c == '#') {
+        pointer--;
+        if (!override && isWindowsDriveLetter(buffer)) {
+          pathBuffer.assign(buffer.begin(), buffer.end()); // the drive letter is the first segment of the path
+          buffer.clear();
+          state = State::Path;
+        } else if (buffer.empty()) {
+          url.hasHost = true;
+          url.host.clear();
+          if (override) {
+            return true;
+          }
+          state = State::PathStart;
+        } else {
+          std::string host;
+          if (!parseHost(cx, buffer, false, host, failure)) {
+            return false;
+          }
+          if (*failure) {
+            return true;
+          }
+          url.hasHost = true;
+          url.host = host == "localhost" ? "" : std::move(host);
+          if (override) {
+            return true;
+          }
+          buffer.clear();
+          state = State::PathStart;
+        }
+      } else {
+        buffer += c;
+      }
+      break;
+
+    case State::PathStart:
+      if (special) {
+        state = State::Path;
+        if (c != '/' && c != '\\') {
+          pointer--;
+        }
+      } else if (!override && c == '?') {
+        url.hasQuery = true;
+        url.query.clear();
+        state = State::Query;
+      } else if (!override && c == '#') {
+        url.hasFragment = true;
+        url.fragment.clear();
+        state = State::Fragment;
+      } else if (c != EOF_CODE_POINT) {
+        state = State::Path;
+        if (c != '/') {
+          pointer--;
+        }
+      } else if (override && !url.hasHost) {
+        url.path.emplace_back();
+      }
+      break;
+
+    case State::Path:
+      if (c == EOF_CODE_POINT || c == '/' || (special && c == '\\') || (!override && (c == '?' || c == '#'))) {
+        const bool slash = c == '/' || (special && c == '\\');
+        if (isDoubleDotSegment(pathBuffer)) {
+          shortenPath(url);
+          if (!slash) {
+            url.path.emplace_back();
+          }
+        } else if (isSingleDotSegment(pathBuffer)) {
+          if (!slash) {
+            url.path.emplace_back();
+          }
+        } else {
+          if (url.scheme == "file" && url.path.empty() && isWindowsDriveLetter(pathBuffer)) {
+            pathBuffer[1] = ':';
+          }
+          url.path.push_back(pathBuffer);
+        }
+        pathBuffer.clear();
+        if (c == '?') {
+          url.hasQuery = true;
+          url.query.clear();
+          state = State::Query;
+        } else if (c == '#') {
+          url.hasFragment = true;
+          url.fragment.clear();
+          state = State::Fragment;
+        }
+      } else {
+        percentEncode(pathBuffer, c, EncodeSet::Path);
+      }
+      break;
+
+    case State::OpaquePath:
+      if (c == '?') {
+        url.hasQuery = true;
+        url.query.clear();
+        state = State::Query;
+      } else if (c == '#') {
+        url.hasFragment = true;
+        url.fragment.clear();
+        state = State::Fragment;
+      } else if (c != EOF_CODE_POINT) {
+        percentEncode(url.opaquePath, c, EncodeSet::C0Control);
+      }
+      break;
+
+    case State::Query:
+      if (!override && c == '#') {
+        url.hasFragment = true;
+        url.fragment.clear();
+        state = State::Fragment;
+      } else if (c != EOF_CODE_POINT) {
+        percentEncode(url.query, c, special ? EncodeSet::SpecialQuery : EncodeSet::Query);
+      }
+      break;
+
+    case State::Fragment:
+      if (c != EOF_CODE_POINT) {
+        percentEncode(url.fragment, c, EncodeSet::Fragment);
+      }
+      break;
+    }
+
+    if (pointer >= length) {
+      return true;
+    }
+  }
+}
+
+/**
+ * @brief Parse `new URL(url, base)`
+ *
+ * @param failure - set to the error message if either is not a valid URL
+ * @return false with a JS exception pending on failure
+ */
+static bool parseURL(JSContext *cx, JS::HandleValue urlValue, JS::HandleValue baseValue, URLRecord &url, const char **failure) {
+  std::u32string input, baseInput;
+  if (!toCodePoints(cx, urlValue, input) || (!baseValue.isUndefined() && !toCodePoints(cx, baseValue, baseInput))) {
+    return false;
+  }
+  if (baseValue.isUndefined()) {
+    return basicParse(cx, std::move(input), nullptr, url, State::None, failure);
+  }
+  URLRecord base;
+  if (!basicParse(cx, std::move(baseInput), nullptr, base, State::None, failure)) {
+    return false;
+  }
+  return *failure || basicParse(cx, std::move(input), &base, url, State::None, failure);
+}
+
+/**
+ * @brief The ASCII serialization of the origin of a URL, https://url.spec.whatwg.org/#concept-url-origin
+ */
+static bool serializeOrigin(JSContext *cx, const URLRecord &url, std::string &origin) {
+  if (url.scheme == "blob") {
+    std::string path;
+    url.serializePath(path);
+    URLRecord pathURL;
+    const char *failure;
+    if (!basicParse(cx, std::u32string(path.begin(), path.end()), nullptr, pathURL, State::None, &failure)) {
+      return false;
+    }
+    if (!failure && (pathURL.scheme == "http" || pathURL.scheme == "https")) {
+      return serializeOrigin(cx, pathURL, origin);
+    }
+    origin = "null";
+    return true;
+  }
+  if (!url.isSpecial() || url.scheme == "file") {
+    origin = "null";
+    return true;
+  }
+  origin = url.scheme + "://" + url.host;
+  if (url.port >= 0) {
+    origin += ':';
+    origin += std::to_string(url.port);
+  }
+  return true;
+}
+
+using SearchParamsList = std::vector<std::pair<std::u16string, std::u16string>>;
+
+static std::u16string decodeFormComponent(std::string_view bytes) {
+  std::string plusReplaced(bytes);
+  std::replace(plusReplaced.begin(), plusReplaced.end(), '+', ' ');
+  std::u16string out;
+  for (char32_t c : decodeUtf8(percentDecode(plusReplaced))) {
+    appendUtf16(out, c);
+  }
+  return out;
+}
+
+/**
+ * @brief The application/x-www-form-urlencoded parser, https://url.spec.whatwg.org/#concept-urlencoded-parser
+ */
+static void parseFormUrlencoded(std::string_view input, SearchParamsList &list) {
+  list.clear();
+  size_t start = 0;
+  while (start <= input.size()) {
+    size_t end = std::min(input.find('&', start), input.size());
+    if (end > start) {
+      std::string_view sequence = input.substr(start, end - start);
+      size_t equals = sequence.find('=');
+      list.emplace_back(decodeFormComponent(sequence.substr(0, equals)),
+        equals == std::string_view::npos ? std::u16string() : decodeFormComponent(sequence.substr(equals + 1)));
+    }
+    start = end + 1;
+  }
+}
+
+static void serializeFormComponent(std::string &out, const std::u16string &str) {
+  for (size_t index = 0; index < str.size(); index++) {
+    char32_t c = str[index];
+    if (c >= 0xD800 && c <= 0xDBFF && index + 1 < str.size() && str[index + 1] >= 0xDC00 && str[index + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (str[++index] - 0xDC00);
+    }
+    if (c == ' ') {
+      out += '+';
+    } else {
+      percentEncode(out, c, EncodeSet::FormUrlencoded);
+    }
+  }
+}
+
+/**
+ * @brief The application/x-www-form-urlencoded serializer, https://url.spec.whatwg.org/#concept-urlencoded-serializer
+ */
+static std::string serializeFormUrlencoded(const SearchParamsList &list) {
+  std::string out;
+  bool first = true;
+  for (const auto &[name, value] : list) {
+    if (!first) {
+      out += '&';
+    }
+    first = false;
+    serializeFormComponent(out, name);
+    out += '=';
+    serializeFormComponent(out, value);
+  }
+  return out;
+}
+
+static std::string toUtf8(const std::u16string &str) {
+  std::string out;
+  for (size_t index = 0; index < str.size(); index++) {
+    char32_t c = str[index];
+    if (c >= 0xD800 && c <= 0xDBFF && index + 1 < str.size() && str[index + 1] >= 0xDC00 && str[index + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (str[++index] - 0xDC00);
+    }
+    appendUtf8(out, c);
+  }
+  return out;
+}
+
+enum {
+  URLSlotRecord,
+  URLSlotSearchParams, // the URLSearchParams once it has been got, and URLSearchParams.prototype until then
+  URLSlotCount
+};
+
+enum {
+  URLPrototypeSlotSearchParamsPrototype,
+  URLPrototypeSlotCount
+};
+
+enum {
+  SearchParamsSlotList,
+  SearchParamsSlotURL,               // the URL whose query the list is, or undefined
+  SearchParamsSlotIteratorPrototype,
+  SearchParamsSlotCount
+};
+
+enum {
+  SearchParamsPrototypeSlotIteratorPrototype,
+  SearchParamsPrototypeSlotCount
+};
+
+enum {
+  SearchParamsIteratorSlotParams,    // undefined once the iterator is done
+  SearchParamsIteratorSlotIndex,
+  SearchParamsIteratorSlotKind,
+  SearchParamsIteratorSlotCount
+};
+
+enum IteratorKind {
+  ITERATOR_KIND_ENTRIES,
+  ITERATOR_KIND_KEYS,
+  ITERATOR_KIND_VALUES,
+};
+
+static void urlFinalize(JS::GCContext *gcx, JSObject *obj) {
+  delete JS::GetMaybePtrFromReservedSlot<URLRecord>(obj, URLSlotRecord);
+}
+
+static void searchParamsFinalize(JS::GCContext *gcx, JSObject *obj) {
+  delete JS::GetMaybePtrFromReservedSlot<SearchParamsList>(obj, SearchParamsSlotList);
+}
+
+static const JSClassOps urlClassOps = {
+  .finalize = urlFinalize,
+};
+
+static const JSClassOps searchParamsClassOps = {
+  .finalize = searchParamsFinalize,
+};
+
+static const JSClass urlClass = {
+  "URL",
+  JSCLASS_HAS_RESERVED_SLOTS(URLSlotCount) | JSCLASS_BACKGROUND_FINALIZE,
+  &urlClassOps
+};
+
+static const JSClass urlPrototypeClass = {"URLPrototype", JSCLASS_HAS_RESERVED_SLOTS(URLPrototypeSlotCount)};
+
+static const JSClass searchParamsClass = {
+  "URLSearchParams",
+  JSCLASS_HAS_RESERVED_SLOTS(SearchParamsSlotCount) | JSCLASS_BACKGROUND_FINALIZE,
+  &searchParamsClassOps
+};
+
+static const JSClass searchParamsPrototypeClass = {"URLSearchParamsPrototype", JSCLASS_HAS_RESERVED_SLOTS(SearchParamsPrototypeSlotCount)};
+
+static const JSClass searchParamsIteratorClass = {"URLSearchParams Iterator", JSCLASS_HAS_RESERVED_SLOTS(SearchParamsIteratorSlotCount)};
+
+static bool requireArguments(JSContext *cx, const JS::CallArgs &args, unsigned count) {
+  if (args.length() < count) {
+    reportTypeError(cx, "Not enough arguments");
+    return false;
+  }
+  return true;
+}
+
+static URLRecord *thisURL(JSContext *cx, const JS::CallArgs &args) {
+  if (args.thisv().isObject() && JS::GetClass(&args.thisv().toObject()) == &urlClass) {
+    return JS::GetMaybePtrFromReservedSlot<URLRecord>(&args.thisv().toObject(), URLSlotRecord);
+  }
+  reportTypeError(cx, "Incompatible receiver, URL required");
+  return nullptr;
+}
+
+static SearchParamsList *thisSearchParams(JSContext *cx, const JS::CallArgs &args) {
+  if (args.thisv().isObject() && JS::GetClass(&args.thisv().toObject()) == &searchParamsClass) {
+    return JS::GetMaybePtrFromReservedSlot<SearchParamsList>(&args.thisv().toObject(), SearchParamsSlotList);
+  }
+  reportTypeError(cx, "Incompatible receiver, URLSearchParams required");
+  return nullptr;
+}
+
+/**
+ * @brief Make the list of the URLSearchParams of a URL, if it was got, the one of its new query
+ */
+static void updateSearchParams(JSObject *urlObj, const URLRecord &url) {
+  JS::Value params = JS::GetReservedSlot(urlObj, URLSlotSearchParams);
+  if (params.isObject() && JS::GetClass(&params.toObject()) == &searchParamsClass) {
+    SearchParamsList *list = JS::GetMaybePtrFromReservedSlot<SearchParamsList>(&params.toObject(), SearchParamsSlotList);
+    if (url.hasQuery) {
+      parseFormUrlencoded(url.query, *list);
+    } else {
+      list->clear();
+    }
+  }
+}
+
+/**
+ * @brief The update steps of a URLSearchParams, which set the query of its URL
+ */
+static void updateURL(JSObject *paramsObj, const SearchParamsList &list) {
+  JS::Value urlValue = JS::GetReservedSlot(paramsObj, SearchParamsSlotURL);
+  if (!urlValue.isObject()) {
+    return;
+  }
+  URLRecord *url = JS::GetMaybePtrFromReservedSlot<URLRecord>(&urlValue.toObject(), URLSlotRecord);
+  url->query = serializeFormUrlencoded(list);
+  url->hasQuery = !url->query.empty();
+  url->hrefValid = false;
+  stripTrailingSpacesFromOpaquePath(*url);
+}
+
+static bool URLConstructor(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!args.isConstructing()) {
+    reportTypeError(cx, "Incorrect invocation");
+    return false;
+  }
+  if (!requireArguments(cx, args, 1)) {
+    return false;
+  }
+
+  auto url = std::make_unique<URLRecord>();
+  const char *failure;
+  if (!parseURL(cx, args[0], args.get(1), *url, &failure)) {
+    return false;
+  }
+  if (failure) {
+    reportTypeError(cx, failure);
+    return false;
+  }
+
+  // URL.prototype keeps URLSearchParams.prototype, for the `searchParams` made on first use
+  JS::RootedObject callee(cx, &args.callee());
+  JS::RootedValue prototype(cx);
+  if (!JS_GetProperty(cx, callee, "prototype", &prototype)) {
+    return false;
+  }
+  JS::RootedObject obj(cx, JS_NewObjectForConstructor(cx, &urlClass, args));
+  if (!obj) {
+    return false;
+  }
+  JS::SetReservedSlot(obj, URLSlotRecord, JS::PrivateValue(url.release()));
+  if (prototype.isObject() && JS::GetClass(&prototype.toObject()) == &urlPrototypeClass) {
+    JS::SetReservedSlot(obj, URLSlotSearchParams, JS::GetReservedSlot(&prototype.toObject(), URLPrototypeSlotSearchParamsPrototype));
+  }
+  args.rval().setObject(*obj);
+  return true;
+}
+
+static bool url_canParse(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!requireArguments(cx, args, 1)) {
+    return false;
+  }
+  URLRecord url;
+  const char *failure;
+  if (!parseURL(cx, args[0], args.get(1), url, &failure)) {
+    return false;
+  }
+  args.rval().setBoolean(!failure);
+  return true;
+}
+
+static bool url_getHref(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->serialize());
+}
+
+static bool url_setHref(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  URLRecord parsed;
+  const char *failure;
+  if (!basicParse(cx, std::move(input), nullptr, parsed, State::None, &failure)) {
+    return false;
+  }
+  if (failure) {
+    reportTypeError(cx, failure);
+    return false;
+  }
+  *url = std::move(parsed);
+  updateSearchParams(&args.thisv().toObject(), *url);
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool url_getOrigin(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::string origin;
+  return url && serializeOrigin(cx, *url, origin) && returnString(cx, args, origin);
+}
+
+static bool url_getProtocol(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->scheme + ':');
+}
+
+/**
+ * @brief Run the basic URL parser with a state override on the URL of a setter, its failures are ignored
+ */
+static bool overrideURL(JSContext *cx, JS::CallArgs &args, URLRecord *url, std::u32string input, State stateOverride) {
+  const char *failure;
+  if (!basicParse(cx, std::move(input), nullptr, *url, stateOverride, &failure)) {
+    return false;
+  }
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool url_setProtocol(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  input += ':';
+  return overrideURL(cx, args, url, std::move(input), State::SchemeStart);
+}
+
+static bool url_getUsername(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->username);
+}
+
+static bool setUserinfo(JSContext *cx, JS::CallArgs &args, bool isPassword) {
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  if (!url->cannotHaveUsernamePasswordPort()) {
+    std::string &userinfo = isPassword ? url->password : url->username;
+    userinfo.clear();
+    for (char32_t c : input) {
+      percentEncode(userinfo, c, EncodeSet::Userinfo);
+    }
+    url->hrefValid = false;
+  }
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool url_setUsername(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return setUserinfo(cx, args, false);
+}
+
+static bool url_getPassword(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->password);
+}
+
+static bool url_setPassword(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return setUserinfo(cx, args, true);
+}
+
+static bool url_getHost(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  if (!url) {
+    return false;
+  }
+  if (!url->hasHost || url->port < 0) {
+    return returnString(cx, args, url->host);
+  }
+  return returnString(cx, args, url->host + ':' + std::to_string(url->port));
+}
+
+static bool setHost(JSContext *cx, JS::CallArgs &args, State stateOverride) {
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  if (url->hasOpaquePath) {
+    args.rval().setUndefined();
+    return true;
+  }
+  return overrideURL(cx, args, url, std::move(input), stateOverride);
+}
+
+static bool url_setHost(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return setHost(cx, args, State::Host);
+}
+
+static bool url_getHostname(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->host);
+}
+
+static bool url_setHostname(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return setHost(cx, args, State::Hostname);
+}
+
+static bool url_getPort(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->port < 0 ? std::string() : std::to_string(url->port));
+}
+
+static bool url_setPort(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  args.rval().setUndefined();
+  if (url->cannotHaveUsernamePasswordPort()) {
+    return true;
+  }
+  if (input.empty()) {
+    url->port = -1;
+    url->hrefValid = false;
+    return true;
+  }
+  return overrideURL(cx, args, url, std::move(input), State::Port);
+}
+
+static bool url_getPathname(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::string pathname;
+  if (url) {
+    url->serializePath(pathname);
+  }
+  return url && returnString(cx, args, pathname);
+}
+
+static bool url_setPathname(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  if (url->hasOpaquePath) {
+    args.rval().setUndefined();
+    return true;
+  }
+  url->path.clear();
+  return overrideURL(cx, args, url, std::move(input), State::PathStart);
+}
+
+static bool url_getSearch(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->query.empty() ? std::string() : '?' + url->query);
+}
+
+static bool url_setSearch(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  url->hasQuery = false;
+  url->query.clear();
+  url->hrefValid = false;
+  if (input.empty()) {
+    stripTrailingSpacesFromOpaquePath(*url);
+  } else {
+    url->hasQuery = true;
+    if (!overrideURL(cx, args, url, input[0] == '?' ? input.substr(1) : std::move(input), State::Query)) {
+      return false;
+    }
+  }
+  updateSearchParams(&args.thisv().toObject(), *url);
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool url_getSearchParams(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  if (!url) {
+    return false;
+  }
+  JS::RootedObject urlObj(cx, &args.thisv().toObject());
+  JS::RootedValue params(cx, JS::GetReservedSlot(urlObj, URLSlotSearchParams));
+  if (!params.isObject()) {
+    reportTypeError(cx, "Incompatible receiver, URL required");
+    return false;
+  }
+  if (JS::GetClass(&params.toObject()) != &searchParamsClass) {
+    JS::RootedObject prototype(cx, &params.toObject());
+    JSObject *paramsObj = JS_NewObjectWithGivenProto(cx, &searchParamsClass, prototype);
+    if (!paramsObj) {
+      return false;
+    }
+    SearchParamsList *list = new SearchParamsList();
+    if (url->hasQuery) {
+      parseFormUrlencoded(url->query, *list);
+    }
+    JS::SetReservedSlot(paramsObj, SearchParamsSlotList, JS::PrivateValue(list));
+    JS::SetReservedSlot(paramsObj, SearchParamsSlotURL, JS::ObjectValue(*urlObj));
+    JS::SetReservedSlot(paramsObj, SearchParamsSlotIteratorPrototype,
+      JS::GetReservedSlot(prototype, SearchParamsPrototypeSlotIteratorPrototype));
+    params.setObject(*paramsObj);
+    JS::SetReservedSlot(urlObj, URLSlotSearchParams, params);
+  }
+  args.rval().set(params);
+  return true;
+}
+
+static bool url_getHash(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  return url && returnString(cx, args, url->fragment.empty() ? std::string() : '#' + url->fragment);
+}
+
+static bool url_setHash(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  URLRecord *url = thisURL(cx, args);
+  std::u32string input;
+  if (!url || !toCodePoints(cx, args.get(0), input)) {
+    return false;
+  }
+  url->hasFragment = false;
+  url->fragment.clear();
+  url->hrefValid = false;
+  args.rval().setUndefined();
+  if (input.empty()) {
+    stripTrailingSpacesFromOpaquePath(*url);
+    return true;
+  }
+  url->hasFragment = true;
+  return overrideURL(cx, args, url, input[0] == '#' ? input.substr(1) : std::move(input), State::Fragment);
+}
+
+static const JSPropertySpec urlProperties[] = {
+  JS_PSGS("href", url_getHref, url_setHref, JSPROP_ENUMERATE),
+  JS_PSG("origin", url_getOrigin, JSPROP_ENUMERATE),
+  JS_PSGS("protocol", url_getProtocol, url_setProtocol, JSPROP_ENUMERATE),
+  JS_PSGS("username", url_getUsername, url_setUsername, JSPROP_ENUMERATE),
+  JS_PSGS("password", url_getPassword, url_setPassword, JSPROP_ENUMERATE),
+  JS_PSGS("host", url_getHost, url_setHost, JSPROP_ENUMERATE),
+  JS_PSGS("hostname", url_getHostname, url_setHostname, JSPROP_ENUMERATE),
+  JS_PSGS("port", url_getPort, url_setPort, JSPROP_ENUMERATE),
+  JS_PSGS("pathname", url_getPathname, url_setPathname, JSPROP_ENUMERATE),
+  JS_PSGS("search", url_getSearch, url_setSearch, JSPROP_ENUMERATE),
+  JS_PSG("searchParams", url_getSearchParams, JSPROP_ENUMERATE),
+  JS_PSGS("hash", url_getHash, url_setHash, JSPROP_ENUMERATE),
+  JS_STRING_SYM_PS(toStringTag, "URL", JSPROP_READONLY),
+  JS_PS_END
+};
+
+static const JSFunctionSpec urlMethods[] = {
+  JS_FN("toJSON", url_getHref, 0, JSPROP_ENUMERATE),
+  JS_FN("toString", url_getHref, 0, JSPROP_ENUMERATE),
+  JS_FS_END
+};
+
+static const JSFunctionSpec urlStaticMethods[] = {
+  JS_FN("canParse", url_canParse, 1, JSPROP_ENUMERATE),
+  JS_FS_END
+};
+
+/**
+ * @brief Fill the list of a new URLSearchParams from a sequence of pairs, a record, another URLSearchParams or a query string
+ */
+static bool initSearchParams(JSContext *cx, JS::HandleValue init, SearchParamsList &list) {
+  if (init.isUndefined()) {
+    return true;
+  }
+  if (!init.isObject()) {
+    std::u16string query;
+    if (!toUSVString(cx, init, query)) {
+      return false;
+    }
+    parseFormUrlencoded(toUtf8(!query.empty() && query[0] == '?' ? query.substr(1) : query), list);
+    return true;
+  }
+
+  JS::RootedObject initObj(cx, &init.toObject());
+  if (JS::GetClass(initObj) == &searchParamsClass) {
+    list = *JS::GetMaybePtrFromReservedSlot<SearchParamsList>(initObj, SearchParamsSlotList);
+    return true;
+  }
+
+  JS::ForOfIterator pairs(cx);
+  if (!pairs.init(init, JS::ForOfIterator::AllowNonIterable)) {
+    return false;
+  }
+  if (pairs.valueIsIterable()) {
+    JS::RootedValue pair(cx), item(cx);
+    while (true) {
+      bool done;
+      if (!pairs.next(&pair, &done)) {
+        return false;
+      }
+      if (done) {
+        return true;
+      }
+      JS::ForOfIterator items(cx);
+      if (!pair.isObject() || !items.init(pair, JS::ForOfIterator::AllowNonIterable) || !items.valueIsIterable()) {
+        if (!JS_IsExceptionPending(cx)) {
+          reportTypeError(cx, "Expected sequence with length 2");
+        }
+        return false;
+      }
+      std::vector<std::u16string> strings;
+      while (true) {
+        if (!items.next(&item, &done)) {
+          return false;
+        }
+        if (done) {
+          break;
+        }
+        strings.emplace_back();
+        if (!toUSVString(cx, item, strings.back())) {
+          return false;
+        }
+      }
+      if (strings.size() != 2) {
+        reportTypeError(cx, "Expected sequence with length 2");
+        return false;
+      }
+      list.emplace_back(std::move(strings[0]), std::move(strings[1]));
+    }
+  }
+
+  JS::RootedIdVector ids(cx);
+  if (!js::GetPropertyKeys(cx, initObj, JSITER_OWNONLY, &ids)) {
+    return false;
+  }
+  JS::RootedId id(cx);
+  JS::RootedValue key(cx), value(cx);
+  for (size_t index = 0; index < ids.length(); index++) {
+    id = ids[index];
+    std::u16string name, string;
+    if (!JS_IdToValue(cx, id, &key) || !JS_GetPropertyById(cx, initObj, id, &value) ||
+        !toUSVString(cx, key, name) || !toUSVString(cx, value, string)) {
+      return false;
+    }
+    list.emplace_back(std::move(name), std::move(string));
+  }
+  return true;
+}
+
+static bool URLSearchParamsConstructor(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!args.isConstructing()) {
+    reportTypeError(cx, "Incorrect invocation");
+    return false;
+  }
+
+  JS::RootedObject callee(cx, &args.callee());
+  JS::RootedValue prototype(cx);
+  if (!JS_GetProperty(cx, callee, "prototype", &prototype)) {
+    return false;
+  }
+  JS::RootedObject obj(cx, JS_NewObjectForConstructor(cx, &searchParamsClass, args));
+  if (!obj) {
+    return false;
+  }
+  SearchParamsList *list = new SearchParamsList();
+  JS::SetReservedSlot(obj, SearchParamsSlotList, JS::PrivateValue(list)); // before any JS runs, freed by the finalizer if init throws
+  if (prototype.isObject() && JS::GetClass(&prototype.toObject()) == &searchParamsPrototypeClass) {
+    JS::SetReservedSlot(obj, SearchParamsSlotIteratorPrototype,
+      JS::GetReservedSlot(&prototype.toObject(), SearchParamsPrototypeSlotIteratorPrototype));
+  }
+  if (!initSearchParams(cx, args.get(0), *list)) {
+    return false;
+  }
+  args.rval().setObject(*obj);
+  return true;
+}
+
+static bool searchParams_getSize(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  if (!list) {
+    return false;
+  }
+  args.rval().setNumber((double)list->size());
+  return true;
+}
+
+static bool searchParams_append(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  std::u16string name, value;
+  if (!list || !requireArguments(cx, args, 2) || !toUSVString(cx, args[0], name) || !toUSVString(cx, args[1], value)) {
+    return false;
+  }
+  list->emplace_back(std::move(name), std::move(value));
+  updateURL(&args.thisv().toObject(), *list);
+  args.rval().setUndefined();
+  return true;
+}
+
+/**
+ * @brief Read the name, and the value if it is given and not undefined, of `delete` and `has`
+ */
+static SearchParamsList *nameAndValue(JSContext *cx, const JS::CallArgs &args, std::u16string &name, std::u16string &value, bool *hasValue) {
+  SearchParamsList *list = thisSearchParams(cx, args);
+  if (!list || !requireArguments(cx, args, 1) || !toUSVString(cx, args[0], name)) {
+    return nullptr;
+  }
+  *hasValue = !args.get(1).isUndefined();
+  if (*hasValue && !toUSVString(cx, args[1], value)) {
+    return nullptr;
+  }
+  return list;
+}
+
+static bool searchParams_delete(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::u16string name, value;
+  bool hasValue;
+  SearchParamsList *list = nameAndValue(cx, args, name, value, &hasValue);
+  if (!list) {
+    return false;
+  }
+  list->erase(std::remove_if(list->begin(), list->end(), [&](const auto &pair) {
+    return pair.first == name && (!hasValue || pair.second == value);
+  }), list->end());
+  updateURL(&args.thisv().toObject(), *list);
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool searchParams_get(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  std::u16string name;
+  if (!list || !requireArguments(cx, args, 1) || !toUSVString(cx, args[0], name)) {
+    return false;
+  }
+  for (const auto &pair : *list) {
+    if (pair.first == name) {
+      JSString *value = newString(cx, pair.second);
+      if (!value) {
+        return false;
+      }
+      args.rval().setString(value);
+      return true;
+    }
+  }
+  args.rval().setNull();
+  return true;
+}
+
+static bool searchParams_getAll(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  std::u16string name;
+  if (!list || !requireArguments(cx, args, 1) || !toUSVString(cx, args[0], name)) {
+    return false;
+  }
+  JS::RootedValueVector values(cx);
+  for (const auto &pair : *list) {
+    if (pair.first == name) {
+      JSString *value = newString(cx, pair.second);
+      if (!value || !values.append(JS::StringValue(value))) {
+        return false;
+      }
+    }
+  }
+  JSObject *array = JS::NewArrayObject(cx, values);
+  if (!array) {
+    return false;
+  }
+  args.rval().setObject(*array);
+  return true;
+}
+
+static bool searchParams_has(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  std::u16string name, value;
+  bool hasValue;
+  SearchParamsList *list = nameAndValue(cx, args, name, value, &hasValue);
+  if (!list) {
+    return false;
+  }
+  args.rval().setBoolean(std::any_of(list->begin(), list->end(), [&](const auto &pair) {
+    return pair.first == name && (!hasValue || pair.second == value);
+  }));
+  return true;
+}
+
+static bool searchParams_set(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  std::u16string name, value;
+  if (!list || !requireArguments(cx, args, 2) || !toUSVString(cx, args[0], name) || !toUSVString(cx, args[1], value)) {
+    return false;
+  }
+  auto first = std::find_if(list->begin(), list->end(), [&](const auto &pair) { return pair.first == name; });
+  if (first == list->end()) {
+    list->emplace_back(std::move(name), std::move(value));
+  } else {
+    first->second = std::move(value);
+    list->erase(std::remove_if(first + 1, list->end(), [&](const auto &pair) { return pair.first == name; }), list->end());
+  }
+  updateURL(&args.thisv().toObject(), *list);
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool searchParams_sort(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  if (!list) {
+    return false;
+  }
+  // by the code units of the names, std::u16string compares char16_t
+  std::stable_sort(list->begin(), list->end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+  updateURL(&args.thisv().toObject(), *list);
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool searchParams_toString(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  return list && returnString(cx, args, serializeFormUrlencoded(*list));
+}
+
+static bool searchParams_forEach(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  SearchParamsList *list = thisSearchParams(cx, args);
+  if (!list || !requireArguments(cx, args, 1)) {
+    return false;
+  }
+  if (!args[0].isObject() || !JS::IsCallable(&args[0].toObject())) {
+    JS_ReportErrorNumberASCII(cx, js::GetErrorMessage, nullptr, JSMSG_NOT_FUNCTION, "forEach: callback");
+    return false;
+  }
+  JS::RootedValue callback(cx, args[0]);
+  JS::RootedValue thisArg(cx, args.get(1));
+  JS::RootedValue rval(cx);
+  JS::RootedValueArray<3> callbackArgs(cx);
+  callbackArgs[2].set(args.thisv());
+  // by index on the live list, which the callback or a change of the URL may modify
+  for (size_t index = 0; index < list->size(); index++) {
+    JSString *name = newString(cx, (*list)[index].first);
+    if (!name) {
+      return false;
+    }
+    callbackArgs[1].setString(name);
+    JSString *value = newString(cx, (*list)[index].second);
+    if (!value) {
+      return false;
+    }
+    callbackArgs[0].setString(value);
+    if (!JS::Call(cx, thisArg, callback, callbackArgs, &rval)) {
+      return false;
+    }
+  }
+  args.rval().setUndefined();
+  return true;
+}
+
+static bool createIterator(JSContext *cx, unsigned argc, JS::Value *vp, IteratorKind kind) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!thisSearchParams(cx, args)) {
+    return false;
+  }
+  JS::RootedObject params(cx, &args.thisv().toObject());
+  JS::RootedValue prototype(cx, JS::GetReservedSlot(params, SearchParamsSlotIteratorPrototype));
+  JS::RootedObject prototypeObj(cx, prototype.isObject() ? &prototype.toObject() : nullptr);
+  JSObject *iterator = JS_NewObjectWithGivenProto(cx, &searchParamsIteratorClass, prototypeObj);
+  if (!iterator) {
+    return false;
+  }
+  JS::SetReservedSlot(iterator, SearchParamsIteratorSlotParams, JS::ObjectValue(*params));
+  JS::SetReservedSlot(iterator, SearchParamsIteratorSlotIndex, JS::Int32Value(0));
+  JS::SetReservedSlot(iterator, SearchParamsIteratorSlotKind, JS::Int32Value(kind));
+  args.rval().setObject(*iterator);
+  return true;
+}
+
+static bool searchParams_entries(JSContext *cx, unsigned argc, JS::Value *vp) {
+  return createIterator(cx, argc, vp, ITERATOR_KIND_ENTRIES);
+}
+
+static bool searchParams_keys(JSContext *cx, unsigned argc, JS::Value *vp) {
+  return createIterator(cx, argc, vp, ITERATOR_KIND_KEYS);
+}
+
+static bool searchParams_values(JSContext *cx, unsigned argc, JS::Value *vp) {
+  return createIterator(cx, argc, vp, ITERATOR_KIND_VALUES);
+}
+
+/**
+ * @brief `next` of the iterators, which read the pair at their index in the live list, no copy of the list is made
+ */
+static bool searchParamsIterator_next(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  if (!args.thisv().isObject() || JS::GetClass(&args.thisv().toObject()) != &searchParamsIteratorClass) {
+    reportTypeError(cx, "Incompatible receiver, URLSearchParams Iterator required");
+    return false;
+  }
+  JS::RootedObject iterator(cx, &args.thisv().toObject());
+  JS::RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result) {
+    return false;
+  }
+  JS::RootedValue value(cx);
+  JS::Value params = JS::GetReservedSlot(iterator, SearchParamsIteratorSlotParams);
+  SearchParamsList *list = params.isObject() ? JS::GetMaybePtrFromReservedSlot<SearchParamsList>(&params.toObject(), SearchParamsSlotList) : nullptr;
+  size_t index = JS::GetReservedSlot(iterator, SearchParamsIteratorSlotIndex).toInt32();
+  bool done = !list || index >= list->size();
+
+  if (done) {
+    JS::SetReservedSlot(iterator, SearchParamsIteratorSlotParams, JS::UndefinedValue());
+  } else {
+    JS::SetReservedSlot(iterator, SearchParamsIteratorSlotIndex, JS::Int32Value(index + 1));
+    int32_t kind = JS::GetReservedSlot(iterator, SearchParamsIteratorSlotKind).toInt32();
+    JS::RootedString name(cx, kind == ITERATOR_KIND_VALUES ? JS_GetEmptyString(cx) : newString(cx, (*list)[index].first));
+    JS::RootedString string(cx, kind == ITERATOR_KIND_KEYS ? JS_GetEmptyString(cx) : newString(cx, (*list)[index].second));
+    if (!name || !string) {
+      return false;
+    }
+    if (kind == ITERATOR_KIND_ENTRIES) {
+      JS::RootedValueArray<2> pair(cx);
+      pair[0].setString(name);
+      pair[1].setString(string);
+      JSObject *array = JS::NewArrayObject(cx, pair);
+      if (!array) {
+        return false;
+      }
+      value.setObject(*array);
+    } else {
+      value.setString(kind == ITERATOR_KIND_KEYS ? name : string);
+    }
+  }
+  JS::RootedValue doneValue(cx, JS::BooleanValue(done));
+  if (!JS_DefineProperty(cx, result, "value", value, JSPROP_ENUMERATE) ||
+      !JS_DefineProperty(cx, result, "done", doneValue, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  args.rval().setObject(*result);
+  return true;
+}
+
+static const JSPropertySpec searchParamsProperties[] = {
+  JS_PSG("size", searchParams_getSize, JSPROP_ENUMERATE),
+  JS_STRING_SYM_PS(toStringTag, "URLSearchParams", JSPROP_READONLY),
+  JS_PS_END
+};
+
+static const JSFunctionSpec searchParamsMethods[] = {
+  JS_FN("append", searchParams_append, 2, JSPROP_ENUMERATE),
+  JS_FN("delete", searchParams_delete, 1, JSPROP_ENUMERATE),
+  JS_FN("get", searchParams_get, 1, JSPROP_ENUMERATE),
+  JS_FN("getAll", searchParams_getAll, 1, JSPROP_ENUMERATE),
+  JS_FN("has", searchParams_has, 1, JSPROP_ENUMERATE),
+  JS_FN("set", searchParams_set, 2, JSPROP_ENUMERATE),
+  JS_FN("sort", searchParams_sort, 0, JSPROP_ENUMERATE),
+  JS_FN("toString", searchParams_toString, 0, JSPROP_ENUMERATE),
+  JS_FN("forEach", searchParams_forEach, 1, JSPROP_ENUMERATE),
+  JS_FN("entries", searchParams_entries, 0, JSPROP_ENUMERATE),
+  JS_FN("keys", searchParams_keys, 0, JSPROP_ENUMERATE),
+  JS_FN("values", searchParams_values, 0, JSPROP_ENUMERATE),
+  JS_FS_END
+};
+
+static const JSPropertySpec searchParamsIteratorProperties[] = {
+  JS_STRING_SYM_PS(toStringTag, "URLSearchParams Iterator", JSPROP_READONLY),
+  JS_PS_END
+};
+
+static const JSFunctionSpec searchParamsIteratorMethods[] = {
+  JS_FN("next", searchParamsIterator_next, 0, JSPROP_ENUMERATE),
+  JS_FS_END
+};
+
+/**
+ * @brief Create new URL and URLSearchParams classes, returned as the `URL` and `URLSearchParams` properties of a new object
+ */
+static bool createClasses(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject classes(cx, JS_NewObjectWithGivenProto(cx, nullptr, nullptr));
+  JS::RootedObject objectPrototype(cx), iteratorPrototype(cx);
+  if (!classes || !InternalBinding::initUrl(cx) || !JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype) ||
+      !JS_GetClassPrototype(cx, JSProto_Iterator, &iteratorPrototype)) {
+    return false;
+  }
+
+  JS::RootedObject searchParamsIteratorPrototype(cx, JS_NewObjectWithGivenProto(cx, nullptr, iteratorPrototype));
+  if (!searchParamsIteratorPrototype ||
+      !JS_DefineFunctions(cx, searchParamsIteratorPrototype, searchParamsIteratorMethods) ||
+      !JS_DefineProperties(cx, searchParamsIteratorPrototype, searchParamsIteratorProperties)) {
+    return false;
+  }
+
+  JS::RootedObject searchParamsPrototype(cx, JS_InitClass(cx, classes,
+    &searchParamsPrototypeClass, objectPrototype,
+    "URLSearchParams",
+    URLSearchParamsConstructor, 0,
+    searchParamsProperties, searchParamsMethods,
+    nullptr, nullptr));
+  if (!searchParamsPrototype) {
+    return false;
+  }
+  JS::SetReservedSlot(searchParamsPrototype, SearchParamsPrototypeSlotIteratorPrototype, JS::ObjectValue(*searchParamsIteratorPrototype));
+
+  // `URLSearchParams.prototype[Symbol.iterator]` is the `entries` function itself
+  JS::RootedValue entries(cx);
+  JS::RootedId iteratorId(cx, JS::PropertyKey::Symbol(JS::GetWellKnownSymbol(cx, JS::SymbolCode::iterator)));
+  if (!JS_GetProperty(cx, searchParamsPrototype, "entries", &entries) ||
+      !JS_DefinePropertyById(cx, searchParamsPrototype, iteratorId, entries, 0)) {
+    return false;
+  }
+
+  JS::RootedObject urlPrototype(cx, JS_InitClass(cx, classes,
+    &urlPrototypeClass, objectPrototype,
+    "URL",
+    URLConstructor, 1,
+    urlProperties, urlMethods,
+    nullptr, urlStaticMethods));
+  if (!urlPrototype) {
+    return false;
+  }
+  JS::SetReservedSlot(urlPrototype, URLPrototypeSlotSearchParamsPrototype, JS::ObjectValue(*searchParamsPrototype));
+
+  args.rval().setObject(*classes);
+  return true;
+}
+
+JSFunctionSpec InternalBinding::url[] = {
+  JS_FN("createClasses", createClasses, 0, 0),
+  JS_FS_END
+};
@@ -7,6 +7,7 @@
  */
 
 #include "include/internalBinding.hh"
+#include "include/StructuredClone.hh"
 
 #include <jsapi.h>
 #include <js/Array.h>
@@ -15,8 +16,13 @@
 #include <js/Promise.h>
 #include <js/Proxy.h>
 #include <js/RegExp.h>
+#include <js/String.h>
+#include <js/Wrapper.h>
 #include <js/experimental/TypedData.h>
 
+#include <cstdint>
+#include <cstring>
+
 /**
  * See function declarations in python/pythonmonkey/builtin_modules/internal-binding.d.ts :
  *    `declare function internalBinding(namespace: "utils")`
@@ -105,6 +111,316 @@ static bool getProxyDetails(JSContext *cx, unsigned argc, JS::Value *vp) {
   return true;
 }
 
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const int8_t BASE64_INVALID = -1;
+static const int8_t BASE64_WHITESPACE = -2;
+
+/**
+ * @brief The lookup tables of the base64 codec: the two characters encoding each 12-bit group, so that 3 bytes are encoded
+ * with two lookups, and the 6-bit value of each character, or BASE64_INVALID, or BASE64_WHITESPACE for the ASCII whitespace skipped by atob
+ */
+struct Base64Tables {
+  char pairs[4096][2];
+  int8_t values[256];
+
+  Base64Tables() {
+    for (int group = 0; group < 4096; group++) {
+      pairs[group][0] = BASE64_ALPHABET[group >> 6];
+      pairs[group][1] = BASE64_ALPHABET[group & 0x3F];
+    }
+    memset(values, BASE64_INVALID, sizeof(values));
+    for (int value = 0; value < 64; value++) {
+      values[(unsigned char)BASE64_ALPHABET[value]] = value;
+    }
+    for (unsigned char whitespace : {'\t', '\n', '\f', '\r', ' '}) {
+      values[whitespace] = BASE64_WHITESPACE;
+    }
+  }
+};
+
+static const Base64Tables &base64Tables() {
+  static const Base64Tables tables;
+  return tables;
+}
+
+static inline size_t base64EncodedLength(size_t length) {
+  return (length + 2) / 3 * 4;
+}
+
+/**
+ * @brief Encode bytes, or the code units of a string that are all below 256
+ *
+ * @param out - base64EncodedLength(length) characters
+ */
+template <typename CharT>
+static void base64Encode(const CharT *in, size_t length, JS::Latin1Char *out) {
+  const Base64Tables &tables = base64Tables();
+  size_t index = 0;
+  for (; index + 3 <= length; index += 3) {
+    uint32_t group = ((uint32_t)(uint8_t)in[index] << 16) | ((uint32_t)(uint8_t)in[index + 1] << 8) | (uint8_t)in[index + 2];
+    memcpy(out, tables.pairs[group >> 12], 2);
+    memcpy(out + 2, tables.pairs[group & 0xFFF], 2);
+    out += 4;
+  }
+  if (index < length) {
+    uint32_t group = (uint32_t)(uint8_t)in[index] << 16;
+    if (index + 1 < length) {
+      group |= (uint32_t)(uint8_t)in[index + 1] << 8;
+    }
+    out[0] = BASE64_ALPHABET[group >> 18];
+    out[1] = BASE64_ALPHABET[(group >> 12) & 0x3F];
+    out[2] = index + 1 < length ? BASE64_ALPHABET[(group >> 6) & 0x3F] : '=';
+    out[3] = '=';
+  }
+}
+
+/**
+ * @brief Validate a base64 string like the forgiving-base64 decode of the HTML spec, see https://infra.spec.whatwg.org/#forgiving-base64-decode
+ *
+ * @param significant - set to the number of characters to decode, whitespace and padding excluded
+ * @return the length of the decoded bytes, or SIZE_MAX if the string is not valid base64
+ */
+template <typename CharT>
+static size_t base64DecodedLength(const CharT *in, size_t length, size_t *significant) {
+  const int8_t *values = base64Tables().values;
+  size_t count = 0, padding = 0;
+  for (size_t index = 0; index < length; index++) {
+    CharT c = in[index];
+    int8_t value = (size_t)c < 256 ? values[(size_t)c] : BASE64_INVALID;
+    if (value == BASE64_WHITESPACE) {
+      continue;
+    }
+    if (c == '=') {
+      padding++;
+      continue;
+    }
+    if (value == BASE64_INVALID || padding > 0) { // padding may only be followed by whitespace
+      return SIZE_MAX;
+    }
+    count++;
+  }
+  if (padding > 2 || (padding > 0 && (count + padding) % 4 != 0) || count % 4 == 1) {
+    return SIZE_MAX;
+  }
+  *significant = count;
+  return count / 4 * 3 + (count % 4 ? count % 4 - 1 : 0);
+}
+
+/**
+ * @brief Decode a validated base64 string, skipping the whitespace and stopping at the padding
+ */
+template <typename CharT>
+static void base64Decode(const CharT *in, size_t significant, uint8_t *out) {
+  const int8_t *values = base64Tables().values;
+  uint32_t bits = 0;
+  unsigned bitCount = 0;
+  for (size_t decoded = 0; decoded < significant; in++) {
+    int8_t value = values[(uint8_t)*in]; // validated, all below 256
+    if (value < 0) {
+      continue;
+    }
+    decoded++;
+    bits = (bits << 6) | value;
+    bitCount += 6;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      *out++ = (uint8_t)(bits >> bitCount);
+    }
+  }
+}
+
+/**
+ * @brief Create a string from base64 characters, filled in by `fill` without GC
+ */
+template <typename Fill>
+static JSString *newBase64String(JSContext *cx, size_t length, Fill fill) {
+  if (length == 0) {
+    return JS_GetEmptyString(cx);
+  }
+  JS::UniqueLatin1Chars chars(js_pod_malloc<JS::Latin1Char>(length));
+  if (!chars) {
+    JS_ReportOutOfMemory(cx);
+    return nullptr;
+  }
+  fill(chars.get());
+  return JS_NewLatin1String(cx, std::move(chars), length);
+}
+
+/**
+ * @brief `btoa` on the chars of a JS string, returns null if one of them is above U+00FF
+ */
+static bool base64EncodeString(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str) {
+    return false;
+  }
+  JS::Rooted<JSLinearString *> linear(cx, JS_EnsureLinearString(cx, str));
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(linear);
+
+  bool valid = true;
+  JSString *encoded = newBase64String(cx, base64EncodedLength(length), [&](JS::Latin1Char *out) {
+    JS::AutoCheckCannotGC nogc;
+    if (JS::LinearStringHasLatin1Chars(linear)) {
+      base64Encode(JS::GetLatin1LinearStringChars(nogc, linear), length, out);
+      return;
+    }
+    const char16_t *chars = JS::GetTwoByteLinearStringChars(nogc, linear);
+    for (size_t index = 0; index < length; index++) {
+      if (chars[index] > 0xFF) {
+        valid = false;
+        return;
+      }
+    }
+    base64Encode(chars, length, out);
+  });
+  if (!encoded) {
+    return false;
+  }
+  if (!valid) {
+    args.rval().setNull();
+  } else {
+    args.rval().setString(encoded);
+  }
+  return true;
+}
+
+/**
+ * @brief `atob`, returns the Latin-1 string of the decoded bytes, or null if the argument is not valid base64
+ */
+static bool base64DecodeString(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str) {
+    return false;
+  }
+  JS::Rooted<JSLinearString *> linear(cx, JS_EnsureLinearString(cx, str));
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(linear);
+
+  size_t significant = 0, decodedLength;
+  {
+    JS::AutoCheckCannotGC nogc;
+    decodedLength = JS::LinearStringHasLatin1Chars(linear)
+      ? base64DecodedLength(JS::GetLatin1LinearStringChars(nogc, linear), length, &significant)
+      : base64DecodedLength(JS::GetTwoByteLinearStringChars(nogc, linear), length, &significant);
+  }
+  if (decodedLength == SIZE_MAX) {
+    args.rval().setNull();
+    return true;
+  }
+
+  JSString *decoded = newBase64String(cx, decodedLength, [&](JS::Latin1Char *out) {
+    JS::AutoCheckCannotGC nogc;
+    if (JS::LinearStringHasLatin1Chars(linear)) {
+      base64Decode(JS::GetLatin1LinearStringChars(nogc, linear), significant, out);
+    } else {
+      base64Decode(JS::GetTwoByteLinearStringChars(nogc, linear), significant, out);
+    }
+  });
+  if (!decoded) {
+    return false;
+  }
+  args.rval().setString(decoded);
+  return true;
+}
+
+/**
+ * @brief Encode the bytes of an ArrayBuffer or ArrayBuffer view, returns undefined for other values
+ */
+static bool base64EncodeBytes(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  args.rval().setUndefined();
+  if (!args.get(0).isObject()) {
+    return true;
+  }
+  JS::RootedObject buffer(cx, js::CheckedUnwrapStatic(&args.get(0).toObject()));
+  if (!buffer || !(JS_IsArrayBufferViewObject(buffer) || JS::IsArrayBufferObjectMaybeShared(buffer))) {
+    return true;
+  }
+  bool isView = JS_IsArrayBufferViewObject(buffer);
+  size_t length;
+  if (isView) {
+    length = JS_GetArrayBufferViewByteLength(buffer);
+  } else {
+    bool isShared;
+    uint8_t *data;
+    JS::GetArrayBufferMaybeSharedLengthAndData(buffer, &length, &isShared, &data);
+  }
+
+  JSString *encoded = newBase64String(cx, base64EncodedLength(length), [&](JS::Latin1Char *out) {
+    JS::AutoCheckCannotGC nogc;
+    bool isShared;
+    const uint8_t *bytes = isView
+      ? (const uint8_t *)JS_GetArrayBufferViewData(buffer, &isShared, nogc)
+      : JS::GetArrayBufferMaybeSharedData(buffer, &isShared, nogc);
+    base64Encode(bytes, length, out);
+  });
+  if (!encoded) {
+    return false;
+  }
+  args.rval().setString(encoded);
+  return true;
+}
+
+/**
+ * @brief Decode a base64 string into a new Uint8Array, returns null if it is not valid base64
+ */
+static bool base64DecodeBytes(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedString str(cx, JS::ToString(cx, args.get(0)));
+  if (!str) {
+    return false;
+  }
+  JS::Rooted<JSLinearString *> linear(cx, JS_EnsureLinearString(cx, str));
+  if (!linear) {
+    return false;
+  }
+  size_t length = JS::GetLinearStringLength(linear);
+
+  size_t significant = 0, decodedLength;
+  {
+    JS::AutoCheckCannotGC nogc;
+    decodedLength = JS::LinearStringHasLatin1Chars(linear)
+      ? base64DecodedLength(JS::GetLatin1LinearStringChars(nogc, linear), length, &significant)
+      : base64DecodedLength(JS::GetTwoByteLinearStringChars(nogc, linear), length, &significant);
+  }
+  if (decodedLength == SIZE_MAX) {
+    args.rval().setNull();
+    return true;
+  }
+
+  JS::RootedObject bytes(cx, JS_NewUint8Array(cx, decodedLength)); // may GC, the chars are got again after it
+  if (!bytes) {
+    return false;
+  }
+  {
+    JS::AutoCheckCannotGC nogc;
+    bool isShared;
+    uint8_t *out = JS_GetUint8ArrayData(bytes, &isShared, nogc);
+    if (JS::LinearStringHasLatin1Chars(linear)) {
+      base64Decode(JS::GetLatin1LinearStringChars(nogc, linear), significant, out);
+    } else {
+      base64Decode(JS::GetTwoByteLinearStringChars(nogc, linear), significant, out);
+    }
+  }
+  args.rval().setObject(*bytes);
+  return true;
+}
+
+/**
+ * @brief `structuredClone(value, transfer)`, `transfer` being an array or undefined
+ */
+static bool structuredClone(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  return StructuredClone::clone(cx, args.get(0), args.get(1), args.rval());
+}
+
 JSFunctionSpec InternalBinding::utils[] = {
   JS_FN("defineGlobal", defineGlobal, /* nargs */ 2, 0),
   JS_FN("isAnyArrayBuffer", isAnyArrayBuffer, 1, 0),
@@ -113,5 +429,10 @@ JSFunctionSpec InternalBinding::utils[] = {
   JS_FN("isTypedArray", isTypedArray, 1, 0),
   JS_FN("getPromiseDetails", getPromiseDetails, 1, 0),
   JS_FN("getProxyDetails", getProxyDetails, 1, 0),
+  JS_FN("base64EncodeString", base64EncodeString, 1, 0),
+  JS_FN("base64DecodeString", base64DecodeString, 1, 0),
+  JS_FN("base64EncodeBytes", base64EncodeBytes, 1, 0),
+  JS_FN("base64DecodeBytes", base64DecodeBytes, 1, 0),
+  JS_FN("structuredClone", structuredClone, 2, 0),
   JS_FS_END
 };
@@ -15,14 +15,25 @@
 #include "include/JSMethodProxy.hh"
 #include "include/JSObjectProxy.hh"
 #include "include/JSArrayProxy.hh"
+#include "include/JSMapProxy.hh"
+#include "include/JSSetProxy.hh"
 #include "include/PyDictProxyHandler.hh"
 #include "include/JSStringProxy.hh"
 #include "include/PyListProxyHandler.hh"
 #include "include/PyObjectProxyHandler.hh"
 #include "include/PyIterableProxyHandler.hh"
+#include "include/PyBytesProxyHandler.hh"
+#include "include/PyMapProxyHandler.hh"
+#include "include/ProxyCache.hh"
+#include "include/ConsoleSink.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 #include "include/pyTypeFactory.hh"
 #include "include/IntType.hh"
 #include "include/PromiseType.hh"
+#include "include/Profiler.hh"
+#include "include/HotPathStats.hh"
 #include "include/DateType.hh"
 #include "include/ExceptionType.hh"
 #include "include/BufferType.hh"
@@ -33,12 +44,21 @@
 #include <js/Equality.h>
 #include <js/Proxy.h>
 #include <js/Array.h>
+#include <js/Utility.h>
 
 #include <Python.h>
 #include <datetime.h>
 #include "include/pyshim.hh"
 
+#include <algorithm>
 #include <unordered_map>
+#include <utility>
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
 
 #define HIGH_SURROGATE_START 0xD800
 #define LOW_SURROGATE_START 0xDC00
@@ -49,18 +69,43 @@ static PyDictProxyHandler pyDictProxyHandler;
 static PyObjectProxyHandler pyObjectProxyHandler;
 static PyListProxyHandler pyListProxyHandler;
 static PyIterableProxyHandler pyIterableProxyHandler;
+static PyMapProxyHandler pyMapProxyHandler;
+
+/**
+ * @brief Bookkeeping for a python string object whose char buffer is shared with one or more JSExternalStrings
+ */
+struct ExternalStringEntry {
+  PyObject *pyString; // the python string object that owns the char buffer
+  size_t refCount; // the number of JSExternalStrings that depend on it
+};
+
+// a map of char buffers to the python string objects that own them, used when finalizing JSExternalStrings
+// keyed by PyUnicode_DATA so that lookups from the JSExternalStringCallbacks are O(1)
+static std::unordered_map<const void *, ExternalStringEntry> externalStringCharsToEntryMap;
 
-std::unordered_map<PyObject *, size_t> externalStringObjToRefCountMap; // a map of python string objects to the number of JSExternalStrings that depend on it, used when finalizing JSExternalStrings
+/**
+ * @brief Register a new JSExternalString dependency on the char buffer of a python string object
+ *
+ * @param pyString - the python string object, a new reference is taken
+ */
+static inline void retainExternalString(PyObject *pyString) {
+  ExternalStringEntry &entry = externalStringCharsToEntryMap[PyUnicode_DATA(pyString)];
+  entry.pyString = pyString;
+  if (entry.refCount++ == 0) {
+    MemoryStats::externalStrings++;
+    MemoryStats::externalStringBytes += PyUnicode_GetLength(pyString) * PyUnicode_KIND(pyString);
+  }
+  Py_INCREF(pyString);
+}
 
 PyObject *PythonExternalString::getPyString(const char16_t *chars)
 {
-  for (auto it: externalStringObjToRefCountMap) {
-    if (PyUnicode_DATA(it.first) == (void *)chars) { // PyUnicode_<2/1>BYTE_DATA are just type casts of PyUnicode_DATA
-      return it.first;
-    }
+  // PyUnicode_<2/1>BYTE_DATA are just type casts of PyUnicode_DATA
+  auto it = externalStringCharsToEntryMap.find((const void *)chars);
+  if (it == externalStringCharsToEntryMap.end()) {
+    return NULL; // this shouldn't be reachable
   }
-
-  return NULL; // this shouldn't be reachable
+  return it->second.pyString;
 }
 
 PyObject *PythonExternalString::getPyString(const JS::Latin1Char *chars)
@@ -75,17 +120,18 @@ void PythonExternalString::finalize(char16_t *chars) const
   // to free the object since the entire process memory is being released.
   if (Py_IsFinalizing()) { return; }
 
-  for (auto it = externalStringObjToRefCountMap.cbegin(), next_it = it; it != externalStringObjToRefCountMap.cend(); it = next_it) {
-    next_it++;
-    if (PyUnicode_DATA(it->first) == (void *)chars) {
-      Py_DECREF(it->first);
-      externalStringObjToRefCountMap[it->first] = externalStringObjToRefCountMap[it->first] - 1;
+  auto it = externalStringCharsToEntryMap.find((const void *)chars);
+  if (it == externalStringCharsToEntryMap.end()) {
+    return; // this shouldn't be reachable
+  }
 
-      if (externalStringObjToRefCountMap[it->first] == 0) {
-        externalStringObjToRefCountMap.erase(it);
-      }
-    }
+  PyObject *pyString = it->second.pyString;
+  if (--it->second.refCount == 0) {
+    MemoryStats::externalStrings--;
+    MemoryStats::externalStringBytes -= PyUnicode_GetLength(pyString) * PyUnicode_KIND(pyString);
+    externalStringCharsToEntryMap.erase(it); // erase before decref'ing, the char buffer may be reused by a new string once it's freed
   }
+  Py_DECREF(pyString);
 }
 
 void PythonExternalString::finalize(JS::Latin1Char *chars) const
@@ -95,13 +141,11 @@ void PythonExternalString::finalize(JS::Latin1Char *chars) const
 
 size_t PythonExternalString::sizeOfBuffer(const char16_t *chars, mozilla::MallocSizeOf mallocSizeOf) const
 {
-  for (auto it: externalStringObjToRefCountMap) {
-    if (PyUnicode_DATA(it.first) == (void *)chars) {
-      return PyUnicode_GetLength(it.first);
-    }
+  PyObject *pyString = PythonExternalString::getPyString(chars);
+  if (!pyString) {
+    return 0; // this shouldn't be reachable
   }
-
-  return 0; // // this shouldn't be reachable
+  return PyUnicode_GetLength(pyString) * PyUnicode_KIND(pyString);
 }
 
 size_t PythonExternalString::sizeOfBuffer(const JS::Latin1Char *chars, mozilla::MallocSizeOf mallocSizeOf) const
@@ -111,40 +155,228 @@ size_t PythonExternalString::sizeOfBuffer(const JS::Latin1Char *chars, mozilla::
 
 PythonExternalString PythonExternalStringCallbacks = {};
 
-size_t UCS4ToUTF16(const uint32_t *chars, size_t length, uint16_t **outStr) {
-  uint16_t *utf16String = (uint16_t *)malloc(sizeof(uint16_t) * length*2);
-  size_t utf16Length = 0;
+PyFuncArgShape PyFuncArgShape::fromPyFunc(PyObject *pyFunc) {
+  PyFuncArgShape shape;
+
+  if (PyCFunction_Check(pyFunc)) {
+    const int funcFlags = ((PyCFunctionObject *)pyFunc)->m_ml->ml_flags;
+    if (funcFlags & METH_NOARGS) { // 0 arguments
+      shape.nNormalArgs = 0;
+    }
+    else if (funcFlags & METH_O) { // 1 argument
+      shape.nNormalArgs = 1;
+    }
+    else { // unknown number of arguments
+      shape.nNormalArgs = 0;
+      shape.unknownNargs = true;
+      shape.varargs = true;
+    }
+    return shape;
+  }
+
+  int32_t nNormalArgs = 1;
+  PyObject *f = pyFunc;
+  if (PyMethod_Check(pyFunc)) {
+    f = PyMethod_Function(pyFunc); // borrowed reference
+    nNormalArgs -= 1; // don't include the implicit `self` of the method as an argument
+  }
+  if (!PyFunction_Check(f)) { // e.g. a method wrapping a builtin, can't introspect it
+    shape.unknownNargs = true;
+    shape.varargs = true;
+    return shape;
+  }
+  PyCodeObject *bytecode = (PyCodeObject *)PyFunction_GetCode(f); // borrowed reference
+  PyObject *defaults = PyFunction_GetDefaults(f); // borrowed reference
+  shape.nDefaultArgs = defaults ? PyTuple_Size(defaults) : 0;
+  shape.nNormalArgs = nNormalArgs + bytecode->co_argcount - shape.nDefaultArgs - 1;
+  shape.varargs = bytecode->co_flags & CO_VARARGS;
+  return shape;
+}
+
+JS::Value PyFuncArgShape::toValue() const {
+  // pack everything into a single int32 so that it fits in one reserved slot
+  uint32_t packed = ((uint32_t)(uint16_t)nNormalArgs << 16) | ((uint32_t)(nDefaultArgs & 0x3FFF) << 2) | (varargs << 1) | unknownNargs;
+  return JS::Int32Value((int32_t)packed);
+}
+
+PyFuncArgShape PyFuncArgShape::fromValue(const JS::Value &value) {
+  PyFuncArgShape shape;
+  if (!value.isInt32()) { // not set, e.g. a wrapper created by something else than jsTypeFactory
+    shape.unknownNargs = true;
+    shape.varargs = true;
+    return shape;
+  }
+  uint32_t packed = (uint32_t)value.toInt32();
+  shape.nNormalArgs = (int16_t)(packed >> 16);
+  shape.nDefaultArgs = (packed >> 2) & 0x3FFF;
+  shape.varargs = (packed >> 1) & 1;
+  shape.unknownNargs = packed & 1;
+  return shape;
+}
+
+/**
+ * @brief Releases the python object held in the 0th reserved slot when the holder is finalized
+ */
+static void pyObjectHolderFinalize(JS::GCContext *gcx, JSObject *holder) {
+  // We cannot call Py_DECREF here when shutting down as the thread state is gone.
+  if (Py_IsFinalizing()) { return; }
+
+  PyObject *pyObject = JS::GetMaybePtrFromReservedSlot<PyObject>(holder, PyObjectHolderSlot);
+  Retention::unpinPython(pyObject, "PyObjectHolder");
+  Py_XDECREF(pyObject);
+}
+
+static const JSClassOps pyObjectHolderClassOps = {
+  .finalize = pyObjectHolderFinalize,
+};
+
+static const JSClass pyObjectHolderClass = {
+  "PyObjectHolder",
+  JSCLASS_HAS_RESERVED_SLOTS(PyObjectHolderSlotCount) | JSCLASS_FOREGROUND_FINALIZE,
+  &pyObjectHolderClassOps
+};
+
+PyObject *getHeldPyObject(JSObject *obj) {
+  if (JS::GetClass(obj) == &pyObjectHolderClass) {
+    return JS::GetMaybePtrFromReservedSlot<PyObject>(obj, PyObjectHolderSlot);
+  }
+  if (js::IsProxy(obj)) {
+    const void *family = js::GetProxyHandler(obj)->family();
+    if (family == &PyDictProxyHandler::family || family == &PyListProxyHandler::family || family == &PyObjectProxyHandler::family ||
+        family == &PyIterableProxyHandler::family || family == &PyBytesProxyHandler::family || family == &PyMapProxyHandler::family) {
+      return JS::GetMaybePtrFromReservedSlot<PyObject>(obj, PyObjectSlot);
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Tie the lifetime of a strong reference to `pyObject` to the JSFunction `jsFunc`, by storing a native finalizable holder object in its reserved slot.
+ * The holder is only reachable through the function, so it dies with it and its finalizer decrefs the python object, no FinalizationRegistry round-trip needed.
+ *
+ * @param cx - javascript context pointer
+ * @param jsFunc - the JSFunction (created with NewFunctionWithReserved)
+ * @param pyObject - the python object to keep alive, a new reference is taken
+ * @param argShape - the PyFuncArgShape of `pyObject` if it is called through `callPyFunc`
+ * @return true - call succeeded
+ * @return false - call failed and an exception has been set
+ */
+static bool holdPyObjectInFunction(JSContext *cx, JS::HandleObject jsFunc, PyObject *pyObject, const JS::Value &argShape = JS::UndefinedValue()) {
+  JS::RootedObject holder(cx, JS_NewObject(cx, &pyObjectHolderClass));
+  if (!holder) {
+    setSpiderMonkeyException(cx);
+    return false;
+  }
+  Py_INCREF(pyObject);
+  JS::SetReservedSlot(holder, PyObjectHolderSlot, JS::PrivateValue((void *)pyObject));
+  JS::SetReservedSlot(holder, PyObjectHolderArgShapeSlot, argShape);
+  js::SetFunctionNativeReserved(jsFunc, PyFuncHolderSlot, JS::ObjectValue(*holder));
+  Retention::pinPython(cx, pyObject, "PyObjectHolder");
+  return true;
+}
+
+/**
+ * @brief Native for the JSFunctions coerced from JSMethodProxy objects, forwards the call to the bound JS function in the 0th reserved slot
+ */
+static bool callBoundJSMethod(JSContext *cx, unsigned int argc, JS::Value *vp) {
+  JS::CallArgs callargs = JS::CallArgsFromVp(argc, vp);
+  JS::RootedValue boundFunction(cx, js::GetFunctionNativeReserved(&(callargs.callee()), PyFuncObjectSlot));
 
+  if (callargs.isConstructing()) {
+    JS::RootedObject newObject(cx);
+    if (!JS::Construct(cx, boundFunction, JS::HandleValueArray(callargs), &newObject)) {
+      return false;
+    }
+    callargs.rval().setObject(*newObject);
+    return true;
+  }
+  return JS::Call(cx, JS::UndefinedHandleValue, boundFunction, JS::HandleValueArray(callargs), callargs.rval());
+}
+
+/**
+ * @brief Write the UTF-16 encoding of a single code point to `outStr`
+ *
+ * @return size_t - the number of UTF-16 code units written (1 or 2)
+ */
+static inline size_t encodeUTF16(uint32_t codePoint, char16_t *outStr) {
+  if (codePoint < BMP_END) { // lone surrogates are kept as-is, as JS strings allow them
+    outStr[0] = char16_t(codePoint);
+    return 1;
+  }
+  /* *INDENT-OFF* */
+  outStr[0] = char16_t(((0b1111'1111'1100'0000'0000 & (codePoint - BMP_END)) >> 10) + HIGH_SURROGATE_START);
+  outStr[1] = char16_t(((0b0000'0000'0011'1111'1111 & (codePoint - BMP_END)) >> 00) +  LOW_SURROGATE_START);
+  /* *INDENT-ON* */
+  return 2;
+}
+
+size_t UCS4ToUTF16Length(const uint32_t *chars, size_t length) {
+  size_t astralCount = 0;
   for (size_t i = 0; i < length; i++) {
-    if (chars[i] < HIGH_SURROGATE_START || (chars[i] > LOW_SURROGATE_END && chars[i] < BMP_END)) {
-      utf16String[utf16Length] = uint16_t(chars[i]);
-      utf16Length += 1;
+    astralCount += chars[i] >= BMP_END; // branchless so that the compiler can vectorize the loop
+  }
+  return length + astralCount;
+}
+
+size_t UCS4ToUTF16(const uint32_t *chars, size_t length, char16_t *outStr) {
+  size_t i = 0;
+  size_t utf16Length = 0;
+
+#if defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+  // Narrow 8 code points at a time while they are all in the BMP, falling back to the scalar encoder for blocks that contain astral characters
+  for (; i + 8 <= length; i += 8) {
+  #if defined(__SSE2__)
+    __m128i lo = _mm_loadu_si128((const __m128i *)(chars + i));
+    __m128i hi = _mm_loadu_si128((const __m128i *)(chars + i + 4));
+    __m128i upperBits = _mm_srli_epi32(_mm_or_si128(lo, hi), 16);
+    bool allInBMP = _mm_movemask_epi8(_mm_cmpeq_epi32(upperBits, _mm_setzero_si128())) == 0xFFFF;
+    if (allInBMP) {
+      // SSE2 only has a signed saturating pack, so shift the values into the int16 range and back
+      const __m128i bias32 = _mm_set1_epi32(0x8000);
+      const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+      __m128i packed = _mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32));
+      _mm_storeu_si128((__m128i *)(outStr + utf16Length), _mm_add_epi16(packed, bias16));
+      utf16Length += 8;
+      continue;
     }
-    else {
-      /* *INDENT-OFF* */
-      utf16String[utf16Length]      = uint16_t(((0b1111'1111'1100'0000'0000 & (chars[i] - BMP_END)) >> 10) + HIGH_SURROGATE_START);
-      utf16String[utf16Length + 1]  = uint16_t(((0b0000'0000'0011'1111'1111 & (chars[i] - BMP_END)) >> 00) +  LOW_SURROGATE_START);
-      utf16Length += 2;
-      /* *INDENT-ON* */
+  #else
+    uint32x4_t lo = vld1q_u32(chars + i);
+    uint32x4_t hi = vld1q_u32(chars + i + 4);
+    if (vmaxvq_u32(vorrq_u32(lo, hi)) < BMP_END) {
+      vst1q_u16((uint16_t *)(outStr + utf16Length), vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+      utf16Length += 8;
+      continue;
     }
+  #endif
+    for (size_t k = i; k < i + 8; k++) {
+      utf16Length += encodeUTF16(chars[k], outStr + utf16Length);
+    }
+  }
+#endif
+
+  for (; i < length; i++) {
+    utf16Length += encodeUTF16(chars[i], outStr + utf16Length);
   }
-  *outStr = utf16String;
   return utf16Length;
 }
 
 JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
+  ProfilerLabel profilerLabel("jsTypeFactory");
   if (!PyDateTimeAPI) { PyDateTime_IMPORT; } // for PyDateTime_Check
 
   JS::RootedValue returnType(cx);
 
   if (PyBool_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, bool);
     returnType.setBoolean(PyLong_AsLong(object));
   }
   else if (PyLong_Check(object)) {
     if (PyObject_IsInstance(object, getPythonMonkeyBigInt())) { // pm.bigint is a subclass of the builtin int type
+      PYTHONMONKEY_HOT_PATH(toJS, bigint);
       JS::BigInt *bigint = IntType::toJsBigInt(cx, object);
       returnType.setBigInt(bigint);
     } else if (_PyLong_NumBits(object) <= 53) { // num <= JS Number.MAX_SAFE_INTEGER, the mantissa of a float64 is 53 bits (with 52 explicitly stored and the highest bit always being 1)
+      PYTHONMONKEY_HOT_PATH(toJS, int);
       int64_t num = PyLong_AsLongLong(object);
       returnType.setNumber(num);
     } else {
@@ -152,32 +384,45 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
     }
   }
   else if (PyFloat_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, float);
     returnType.setNumber(PyFloat_AsDouble(object));
   }
   else if (PyObject_TypeCheck(object, &JSStringProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSStringProxy);
     returnType.setString(((JSStringProxy *)object)->jsString->toString());
   }
   else if (PyUnicode_Check(object)) {
     switch (PyUnicode_KIND(object)) {
     case (PyUnicode_4BYTE_KIND): {
-        uint32_t *u32Chars = PyUnicode_4BYTE_DATA(object);
-        uint16_t *u16Chars;
-        size_t u16Length = UCS4ToUTF16(u32Chars, PyUnicode_GET_LENGTH(object), &u16Chars);
-        JSString *str = JS_NewUCStringCopyN(cx, (char16_t *)u16Chars, u16Length);
-        free(u16Chars);
+        PYTHONMONKEY_HOT_PATH(toJS, strUCS4);
+        const uint32_t *u32Chars = PyUnicode_4BYTE_DATA(object);
+        size_t u32Length = PyUnicode_GET_LENGTH(object);
+        size_t u16Length = UCS4ToUTF16Length(u32Chars, u32Length);
+        // transcode straight into a buffer owned by the JS engine, which the new JSString then adopts without copying
+        JS::UniqueTwoByteChars u16Chars(js_pod_arena_malloc<char16_t>(js::StringBufferArena, u16Length));
+        if (!u16Chars) {
+          PyErr_NoMemory();
+          break;
+        }
+        UCS4ToUTF16(u32Chars, u32Length, u16Chars.get());
+        JSString *str = JS_NewUCString(cx, std::move(u16Chars), u16Length);
+        if (!str) {
+          setSpiderMonkeyException(cx);
+          break;
+        }
         returnType.setString(str);
         break;
       }
     case (PyUnicode_2BYTE_KIND): {
-        externalStringObjToRefCountMap[object] = externalStringObjToRefCountMap[object] + 1;
-        Py_INCREF(object);
+        PYTHONMONKEY_HOT_PATH(toJS, strUCS2);
+        retainExternalString(object);
         JSString *str = JS_NewExternalUCString(cx, (char16_t *)PyUnicode_2BYTE_DATA(object), PyUnicode_GET_LENGTH(object), &PythonExternalStringCallbacks);
         returnType.setString(str);
         break;
       }
     case (PyUnicode_1BYTE_KIND): {
-        externalStringObjToRefCountMap[object] = externalStringObjToRefCountMap[object] + 1;
-        Py_INCREF(object);
+        PYTHONMONKEY_HOT_PATH(toJS, strLatin1);
+        retainExternalString(object);
         JSString *str = JS_NewExternalStringLatin1(cx, (JS::Latin1Char *)PyUnicode_1BYTE_DATA(object), PyUnicode_GET_LENGTH(object), &PythonExternalStringCallbacks);
         // JSExternalString can now be properly treated as either one-byte or two-byte strings when GCed
         // see https://hg.mozilla.org/releases/mozilla-esr128/file/tip/js/src/vm/StringType-inl.h#l785
@@ -187,6 +432,7 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
     }
   }
   else if (PyMethod_Check(object) || PyFunction_Check(object) || PyCFunction_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, function);
     // can't determine number of arguments for PyCFunctions, so just assume potentially unbounded
     uint16_t nargs = 0;
     if (PyFunction_Check(object)) {
@@ -195,24 +441,21 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
     }
 
     JSFunction *jsFunc = js::NewFunctionWithReserved(cx, callPyFunc, nargs, 0, NULL);
+    if (!jsFunc) {
+      setSpiderMonkeyException(cx);
+      return returnType;
+    }
     JS::RootedObject jsFuncObject(cx, JS_GetFunctionObject(jsFunc));
     // We put the address of the PyObject in the JSFunction's 0th private slot so we can access it later
-    js::SetFunctionNativeReserved(jsFuncObject, 0, JS::PrivateValue((void *)object));
-    returnType.setObject(*jsFuncObject);
-    Py_INCREF(object); // otherwise the python function object would be double-freed on GC in Python 3.11+
-
-    // add function to jsFunctionRegistry, to DECREF the PyObject when the JSFunction is finalized
-    JS::RootedValueArray<2> registerArgs(GLOBAL_CX);
-    registerArgs[0].setObject(*jsFuncObject);
-    registerArgs[1].setPrivate(object);
-    JS::RootedValue ignoredOutVal(GLOBAL_CX);
-    JS::RootedObject registry(GLOBAL_CX, jsFunctionRegistry);
-    if (!JS_CallFunctionName(GLOBAL_CX, registry, "register", registerArgs, &ignoredOutVal)) {
-      setSpiderMonkeyException(GLOBAL_CX);
+    js::SetFunctionNativeReserved(jsFuncObject, PyFuncObjectSlot, JS::PrivateValue((void *)object));
+    // the holder keeps the python function alive (otherwise it would be double-freed on GC in Python 3.11+), and DECREFs it when the JSFunction is finalized
+    if (!holdPyObjectInFunction(cx, jsFuncObject, object, PyFuncArgShape::fromPyFunc(object).toValue())) {
       return returnType;
     }
+    returnType.setObject(*jsFuncObject);
   }
   else if (PyExceptionInstance_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, exception);
     JSObject *error = ExceptionType::toJsError(cx, object, nullptr);
     if (error) {
       returnType.setObject(*error);
@@ -222,17 +465,21 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
     }
   }
   else if (PyDateTime_Check(object)) {
-    JSObject *dateObj = DateType::toJsDate(cx, object);
-    returnType.setObject(*dateObj);
+    PYTHONMONKEY_HOT_PATH(toJS, datetime);
+    JSObject *dateObj = DateType::toJsDate(cx, object); // may return null
+    returnType.setObjectOrNull(dateObj);
   }
-  else if (PyObject_CheckBuffer(object)) {
+  else if (PyObject_CheckBuffer(object) && !PyObject_TypeCheck(object, &JSObjectProxyType)) { // a JSWasmMemoryProxy is unwrapped below
+    PYTHONMONKEY_HOT_PATH(toJS, buffer);
     JSObject *typedArray = BufferType::toJsTypedArray(cx, object); // may return null
     returnType.setObjectOrNull(typedArray);
   }
   else if (PyObject_TypeCheck(object, &JSObjectProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSObjectProxy);
     returnType.setObject(**((JSObjectProxy *)object)->jsObject);
   }
   else if (PyObject_TypeCheck(object, &JSMethodProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSMethodProxy);
     JS::RootedObject func(cx, *((JSMethodProxy *)object)->jsFunc);
     PyObject *self = ((JSMethodProxy *)object)->self;
 
@@ -243,69 +490,136 @@ JS::Value jsTypeFactory(JSContext *cx, PyObject *object) {
       setSpiderMonkeyException(GLOBAL_CX);
       return returnType;
     }
-    returnType.set(boundFunction);
-    // add function to jsFunctionRegistry, to DECREF the PyObject when the JSFunction is finalized
-    JS::RootedValueArray<2> registerArgs(GLOBAL_CX);
-    registerArgs[0].set(boundFunction);
-    registerArgs[1].setPrivate(object);
-    JS::RootedValue ignoredOutVal(GLOBAL_CX);
-    JS::RootedObject registry(GLOBAL_CX, jsFunctionRegistry);
-    if (!JS_CallFunctionName(GLOBAL_CX, registry, "register", registerArgs, &ignoredOutVal)) {
-      setSpiderMonkeyException(GLOBAL_CX);
+
+    // Bound functions have no reserved slots, so wrap it in a forwarding function that can hold the JSMethodProxy
+    JSFunction *jsFunc = js::NewFunctionWithReserved(cx, callBoundJSMethod, 0, JSFUN_CONSTRUCTOR, NULL);
+    if (!jsFunc) {
+      setSpiderMonkeyException(cx);
       return returnType;
     }
-
-    Py_INCREF(object);
+    JS::RootedObject jsFuncObject(cx, JS_GetFunctionObject(jsFunc));
+    js::SetFunctionNativeReserved(jsFuncObject, PyFuncObjectSlot, boundFunction);
+    // DECREF the JSMethodProxy when the JSFunction is finalized
+    if (!holdPyObjectInFunction(cx, jsFuncObject, object)) {
+      return returnType;
+    }
+    returnType.setObject(*jsFuncObject);
   }
   else if (PyObject_TypeCheck(object, &JSFunctionProxyType)) {
-    returnType.setObject(**((JSFunctionProxy *)object)->jsFunc);
+    PYTHONMONKEY_HOT_PATH(toJS, JSFunctionProxy);
+    JSFunctionProxy *functionProxy = (JSFunctionProxy *)object;
+    if (functionProxy->jsBound) {
+      returnType.setObject(**functionProxy->jsBound);
+    }
+    else if (functionProxy->jsThis) { // the function was read from a JSObjectProxy, materialize the bound function now that it is passed to JS
+      JS::RootedObject func(cx, *functionProxy->jsFunc);
+      JS::Rooted<JS::ValueArray<1>> args(cx);
+      args[0].setObject(**functionProxy->jsThis);
+      JS::RootedValue boundFunction(cx);
+      if (!JS_CallFunctionName(cx, func, "bind", args, &boundFunction)) {
+        setSpiderMonkeyException(cx);
+        return returnType;
+      }
+      if (boundFunction.isObject()) { // the same bound function each time it is passed to JS
+        functionProxy->jsBound = RootPool::newRoot(cx, &boundFunction.toObject());
+      }
+      returnType.set(boundFunction);
+    }
+    else {
+      returnType.setObject(**functionProxy->jsFunc);
+    }
   }
   else if (PyObject_TypeCheck(object, &JSArrayProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSArrayProxy);
     returnType.setObject(**((JSArrayProxy *)object)->jsArray);
   }
+  else if (PyObject_TypeCheck(object, &JSMapProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSMapProxy);
+    returnType.setObject(**((JSMapProxy *)object)->jsMap);
+  }
+  else if (PyObject_TypeCheck(object, &JSSetProxyType)) {
+    PYTHONMONKEY_HOT_PATH(toJS, JSSetProxy);
+    returnType.setObject(**((JSSetProxy *)object)->jsSet);
+  }
+  else if (JSObject *cachedProxy = ProxyCache::getJSProxy(object)) { // the dict, list or object has already been proxied and the proxy is still alive
+    PYTHONMONKEY_HOT_PATH(toJS, cachedProxy);
+    returnType.setObject(*cachedProxy);
+  }
   else if (PyDict_Check(object) || PyList_Check(object)) {
     JS::RootedValue v(cx);
     JSObject *proxy;
     if (PyList_Check(object)) {
+      PYTHONMONKEY_HOT_PATH(toJS, list);
       JS::RootedObject arrayPrototype(cx);
       JS_GetClassPrototype(cx, JSProto_Array, &arrayPrototype); // so that instanceof will work, not that prototype methods will
       proxy = js::NewProxyObject(cx, &pyListProxyHandler, v, arrayPrototype.get());
+    } else if (PyMapProxyHandler::isMapLike(object)) { // no str keys, which would be stringified as property names
+      PYTHONMONKEY_HOT_PATH(toJS, map);
+      JS::RootedObject mapPrototype(cx);
+      JS_GetClassPrototype(cx, JSProto_Map, &mapPrototype); // so that instanceof will work, not that prototype methods will
+      proxy = js::NewProxyObject(cx, &pyMapProxyHandler, v, mapPrototype.get());
     } else {
+      PYTHONMONKEY_HOT_PATH(toJS, dict);
       JS::RootedObject objectPrototype(cx);
       JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype); // so that instanceof will work, not that prototype methods will
       proxy = js::NewProxyObject(cx, &pyDictProxyHandler, v, objectPrototype.get());
     }
     Py_INCREF(object);
     JS::SetReservedSlot(proxy, PyObjectSlot, JS::PrivateValue(object));
+    ProxyCache::putJSProxy(object, proxy);
+    MemoryStats::countPyProxy(js::GetProxyHandler(proxy)->family(), 1);
+    const char *holder = Retention::handlerName(js::GetProxyHandler(proxy)->family());
     returnType.setObject(*proxy);
+    Retention::pinPython(cx, object, holder);
   }
   else if (object == Py_None) {
+    PYTHONMONKEY_HOT_PATH(toJS, None);
     returnType.setUndefined();
   }
   else if (object == getPythonMonkeyNull()) {
+    PYTHONMONKEY_HOT_PATH(toJS, null);
     returnType.setNull();
   }
   else if (PythonAwaitable_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, awaitable);
     returnType.setObjectOrNull(PromiseType::toJsPromise(cx, object));
   }
   else if (PyIter_Check(object)) {
+    PYTHONMONKEY_HOT_PATH(toJS, iterator);
     JS::RootedValue v(cx);
     JS::RootedObject objectPrototype(cx);
     JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype); // so that instanceof will work, not that prototype methods will
     JSObject *proxy = js::NewProxyObject(cx, &pyIterableProxyHandler, v, objectPrototype.get());
-    PyObject *iterable = PyObject_GetIter(object);
-    Py_INCREF(iterable);
+    PyObject *iterable = PyObject_GetIter(object); // the new reference owned by the proxy
     JS::SetReservedSlot(proxy, PyObjectSlot, JS::PrivateValue(iterable));
+    MemoryStats::pyIterableProxies++;
     returnType.setObject(*proxy);
+    Retention::pinPython(cx, iterable, "PyIterableProxyHandler");
+  }
+  else if (Py_TYPE(object)->tp_as_async && (Py_TYPE(object)->tp_as_async->am_aiter || Py_TYPE(object)->tp_as_async->am_anext)) {
+    PYTHONMONKEY_HOT_PATH(toJS, asyncIterable);
+    JS::RootedValue v(cx);
+    JS::RootedObject objectPrototype(cx);
+    JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype); // so that instanceof will work, not that prototype methods will
+    JSObject *proxy = js::NewProxyObject(cx, &pyIterableProxyHandler, v, objectPrototype.get());
+    Py_INCREF(object);
+    JS::SetReservedSlot(proxy, PyObjectSlot, JS::PrivateValue(object));
+    MemoryStats::pyIterableProxies++;
+    returnType.setObject(*proxy);
+    Retention::pinPython(cx, object, "PyIterableProxyHandler");
   }
   else {
+    PYTHONMONKEY_HOT_PATH(toJS, object);
     JS::RootedValue v(cx);
     JS::RootedObject objectPrototype(cx);
     JS_GetClassPrototype(cx, JSProto_Object, &objectPrototype); // so that instanceof will work, not that prototype methods will
     JSObject *proxy = js::NewProxyObject(cx, &pyObjectProxyHandler, v, objectPrototype.get());
     Py_INCREF(object);
     JS::SetReservedSlot(proxy, PyObjectSlot, JS::PrivateValue(object));
+    ProxyCache::putJSProxy(object, proxy);
+    MemoryStats::pyObjectProxies++;
     returnType.setObject(*proxy);
+    Retention::pinPython(cx, object, "PyObjectProxyHandler");
   }
   return returnType;
 }
@@ -349,104 +663,137 @@ bool setPyException(JSContext *cx) {
   return true;
 }
 
+Py_ssize_t PyFuncArgShape::argCount(Py_ssize_t passed) const {
+  if ((nNormalArgs + nDefaultArgs) <= 0 && !varargs) { // no arguments are needed
+    return 0;
+  }
+  else if (unknownNargs) { // pass all passed arguments
+    return passed;
+  }
+  else if (varargs) { // if passed arguments is less than number of non-default positionals, rest will be set to `None`
+    return std::max(passed, (Py_ssize_t)nNormalArgs);
+  }
+  else if ((Py_ssize_t)nNormalArgs > passed) { // if passed arguments is less than number of non-default positionals, rest will be set to `None`
+    return nNormalArgs;
+  }
+  else { // passed arguments greater than non-default positionals, so we may be replacing default positional arguments
+    return std::min(passed, (Py_ssize_t)(nNormalArgs + nDefaultArgs));
+  }
+}
+
 bool callPyFunc(JSContext *cx, unsigned int argc, JS::Value *vp) {
+  ProfilerLabel profilerLabel("callPyFunc");
   JS::CallArgs callargs = JS::CallArgsFromVp(argc, vp);
 
-  // get the python function from the 0th reserved slot
-  PyObject *pyFunc = (PyObject *)js::GetFunctionNativeReserved(&(callargs.callee()), 0).toPrivate();
+  // get the python function from the 0th reserved slot, and the argument shape cached alongside it in the holder
+  PyObject *pyFunc = (PyObject *)js::GetFunctionNativeReserved(&(callargs.callee()), PyFuncObjectSlot).toPrivate();
+  JSObject *holder = &js::GetFunctionNativeReserved(&(callargs.callee()), PyFuncHolderSlot).toObject();
+  PyFuncArgShape shape = PyFuncArgShape::fromValue(JS::GetReservedSlot(holder, PyObjectHolderArgShapeSlot));
   Py_INCREF(pyFunc);
-  PyObject *pyRval = NULL;
-  PyObject *pyArgs = NULL;
-  Py_ssize_t nNormalArgs = 0;   // number of positional non-default arguments
-  Py_ssize_t nDefaultArgs = 0;  // number of positional default arguments
-  bool varargs = false;
-  bool unknownNargs = false;
 
-  if (PyCFunction_Check(pyFunc)) {
-    const int funcFlags = ((PyCFunctionObject *)pyFunc)->m_ml->ml_flags;
-    if (funcFlags & METH_NOARGS) { // 0 arguments
-      nNormalArgs = 0;
-    }
-    else if (funcFlags & METH_O) { // 1 argument
-      nNormalArgs = 1;
-    }
-    else { // unknown number of arguments
-      nNormalArgs = 0;
-      unknownNargs = true;
-      varargs = true;
+  // number of positional arguments to pass
+  Py_ssize_t nargs = shape.argCount(callargs.length());
+
+  // populate the python args array, with one extra leading slot so that PY_VECTORCALL_ARGUMENTS_OFFSET can be used
+  PyObject *smallArgs[PY_FUNC_SMALL_ARGS_COUNT + 1];
+  PyObject **args = smallArgs;
+  if (nargs > PY_FUNC_SMALL_ARGS_COUNT) {
+    args = PyMem_New(PyObject *, nargs + 1);
+    if (!args) {
+      Py_DECREF(pyFunc);
+      PyErr_NoMemory();
+      setPyException(cx);
+      return false;
     }
   }
-  else {
-    nNormalArgs = 1;
-    PyObject *f = pyFunc;
-    if (PyMethod_Check(pyFunc)) {
-      f = PyMethod_Function(pyFunc); // borrowed reference
-      nNormalArgs -= 1; // don't include the implicit `self` of the method as an argument
-    }
-    PyCodeObject *bytecode = (PyCodeObject *)PyFunction_GetCode(f); // borrowed reference
-    PyObject *defaults = PyFunction_GetDefaults(f); // borrowed reference
-    nDefaultArgs = defaults ? PyTuple_Size(defaults) : 0;
-    nNormalArgs += bytecode->co_argcount - nDefaultArgs - 1;
-    if (bytecode->co_flags & CO_VARARGS) {
-      varargs = true;
+
+  bool conversionFailed = false;
+  Py_ssize_t nConvertedArgs = std::min((Py_ssize_t)callargs.length(), nargs);
+  for (Py_ssize_t i = 0; i < nConvertedArgs; i++) {
+    JS::RootedValue jsArg(cx, callargs[i]);
+    PyObject *pyArgObj = pyTypeFactory(cx, jsArg);
+    if (!pyArgObj) { // error occurred
+      nConvertedArgs = i;
+      conversionFailed = true;
+      break;
     }
+    args[i + 1] = pyArgObj;
   }
 
-  // use faster calling if no arguments are needed
-  if (((nNormalArgs + nDefaultArgs) <= 0 && !varargs)) {
-    pyRval = PyObject_CallObject(pyFunc, NULL);
-    if (PyErr_Occurred() && setPyException(cx)) { // Check if an exception has already been set in Python error stack
-      goto failure;
+  PyObject *pyRval = NULL;
+  if (!conversionFailed) {
+    // set unspecified args to None, to match JS behaviour of setting unspecified args to undefined
+    for (Py_ssize_t i = nConvertedArgs; i < nargs; i++) {
+      args[i + 1] = Py_None;
     }
-    goto success;
+    ConsoleSink::flushPending(); // the Python function may print
+    pyRval = PyObject_Vectorcall(pyFunc, args + 1, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL);
   }
 
-  // populate python args tuple
-  Py_ssize_t argTupleLength;
-  if (unknownNargs) { // pass all passed arguments
-    argTupleLength = callargs.length();
-  }
-  else if (varargs) { // if passed arguments is less than number of non-default positionals, rest will be set to `None`
-    argTupleLength = std::max((Py_ssize_t)callargs.length(), nNormalArgs);
+  for (Py_ssize_t i = 0; i < nConvertedArgs; i++) {
+    Py_DECREF(args[i + 1]);
   }
-  else if (nNormalArgs > callargs.length()) { // if passed arguments is less than number of non-default positionals, rest will be set to `None`
-    argTupleLength = nNormalArgs;
-  }
-  else { // passed arguments greater than non-default positionals, so we may be replacing default positional arguments
-    argTupleLength = std::min((Py_ssize_t)callargs.length(), nNormalArgs+nDefaultArgs);
-  }
-  pyArgs = PyTuple_New(argTupleLength);
-
-  for (size_t i = 0; i < callargs.length() && i < argTupleLength; i++) {
-    JS::RootedValue jsArg(cx, callargs[i]);
-    PyObject *pyArgObj = pyTypeFactory(cx, jsArg);
-    if (!pyArgObj) return false; // error occurred
-    PyTuple_SetItem(pyArgs, i, pyArgObj);
+  if (args != smallArgs) {
+    PyMem_Free(args);
   }
+  Py_DECREF(pyFunc);
 
-  // set unspecified args to None, to match JS behaviour of setting unspecified args to undefined
-  for (Py_ssize_t i = callargs.length(); i < argTupleLength; i++) {
-    PyTuple_SetItem(pyArgs, i, Py_None);
+  if (conversionFailed) {
+    if (PyErr_Occurred()) {
+      setPyException(cx);
+    }
+    return false;
   }
 
-  pyRval = PyObject_Call(pyFunc, pyArgs, NULL);
-  if (PyErr_Occurred() && setPyException(cx)) {
-    goto failure;
+  if (PyErr_Occurred() && setPyException(cx)) { // Check if an exception has already been set in Python error stack
+    Py_XDECREF(pyRval);
+    return false;
   }
-  goto success;
 
-success:
   if (pyRval) { // can be NULL if SystemExit was raised
     callargs.rval().set(jsTypeFactory(cx, pyRval));
     Py_DECREF(pyRval);
   }
-  Py_DECREF(pyFunc);
-  Py_XDECREF(pyArgs);
   return true;
+}
+
+PyObject *getWrappedPyFunc(JSObject *function, PyFuncArgShape *shape) {
+  if (!JS_IsNativeFunction(function, callPyFunc)) {
+    return nullptr;
+  }
+  JSObject *holder = &js::GetFunctionNativeReserved(function, PyFuncHolderSlot).toObject();
+  *shape = PyFuncArgShape::fromValue(JS::GetReservedSlot(holder, PyObjectHolderArgShapeSlot));
+  return (PyObject *)js::GetFunctionNativeReserved(function, PyFuncObjectSlot).toPrivate();
+}
 
-failure:
-  Py_XDECREF(pyRval);
+bool callWrappedPyFunc(JSContext *cx, PyObject *pyFunc, const PyFuncArgShape &shape, PyObject *const *args, Py_ssize_t argc, PyObject **pyRval) {
+  Py_ssize_t nargs = shape.argCount(argc);
+  PyObject *smallArgs[PY_FUNC_SMALL_ARGS_COUNT + 1];
+  PyObject **callArgs = smallArgs;
+  if (nargs > PY_FUNC_SMALL_ARGS_COUNT) { // many positionals without a default value
+    callArgs = PyMem_New(PyObject *, nargs + 1);
+    if (!callArgs) {
+      PyErr_NoMemory();
+      setPyException(cx);
+      *pyRval = NULL;
+      return false;
+    }
+  }
+  for (Py_ssize_t i = 0; i < nargs; i++) {
+    callArgs[i + 1] = i < argc ? args[i] : Py_None;
+  }
+
+  Py_INCREF(pyFunc);
+  ConsoleSink::flushPending(); // the Python function may print
+  *pyRval = PyObject_Vectorcall(pyFunc, callArgs + 1, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, NULL);
   Py_DECREF(pyFunc);
-  Py_XDECREF(pyArgs);
-  return false;
-}
\ No newline at end of file
+  if (callArgs != smallArgs) {
+    PyMem_Free(callArgs);
+  }
+
+  if (PyErr_Occurred() && setPyException(cx)) {
+    Py_CLEAR(*pyRval);
+    return false;
+  }
+  return true;
+}
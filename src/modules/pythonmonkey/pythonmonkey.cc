@@ -20,9 +20,46 @@
 #include "include/JSObjectValuesProxy.hh"
 #include "include/JSObjectItemsProxy.hh"
 #include "include/JSObjectProxy.hh"
+#include "include/JSIteratorProxy.hh"
+#include "include/JSWasmMemoryProxy.hh"
+#include "include/JSMapProxy.hh"
+#include "include/JSSetProxy.hh"
 #include "include/JSStringProxy.hh"
+#include "include/JSWorker.hh"
+#include "include/JSScriptHandle.hh"
+#include "include/JSONStringify.hh"
+#include "include/StrType.hh"
+#include "include/FloatType.hh"
+#include "include/GILSwitch.hh"
+#include "include/ContextOwner.hh"
+#include "include/DateType.hh"
+#include "include/ExceptionType.hh"
+#include "include/BufferType.hh"
+#include "include/ProxyCache.hh"
+#include "include/CrossHeap.hh"
+#include "include/ConsoleSink.hh"
+#include "include/StencilCache.hh"
+#include "include/WasmModuleCache.hh"
+#include "include/ModuleLoader.hh"
+#include "include/RequireCache.hh"
+#include "include/Watchdog.hh"
+#include "include/HelperThreads.hh"
+#include "include/Prefork.hh"
+#include "include/EngineOptions.hh"
+#include "include/PromiseType.hh"
+#include "include/AtomCache.hh"
+#include "include/TypeLayoutCache.hh"
+#include "include/DeepCopy.hh"
+#include "include/StructuredClone.hh"
+#include "include/Metrics.hh"
+#include "include/Profiler.hh"
+#include "include/MemoryStats.hh"
+#include "include/Retention.hh"
+#include "include/RootPool.hh"
 #include "include/pyTypeFactory.hh"
+#include "include/jsTypeFactory.hh"
 #include "include/PyEventLoop.hh"
+#include "include/PyIterableProxyHandler.hh"
 #include "include/internalBinding.hh"
 
 #include <jsapi.h>
@@ -33,9 +70,13 @@
 #include <js/ContextOptions.h>
 #include <js/Class.h>
 #include <js/Date.h>
+#include <js/GCAPI.h>
 #include <js/Initialization.h>
+#include <js/JSON.h>
 #include <js/Object.h>
+#include <js/Promise.h>
 #include <js/Proxy.h>
+#include <js/SliceBudget.h>
 #include <js/SourceText.h>
 #include <js/Symbol.h>
 
@@ -43,16 +84,29 @@
 #include <datetime.h>
 #include "include/pyshim.hh"
 
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <cassert>
 
-JS::PersistentRootedObject jsFunctionRegistry;
-
 /**
- * @brief During a GC, string buffers may have moved, so we need to re-point our JSStringProxies
+ * @brief Re-point a JSStringProxy to the current location of its JSString's char buffer
  * The char buffer pointer obtained by previous `JS::Get{Latin1,TwoByte}LinearStringChars` calls remains valid only as long as no GC occurs.
  */
+static inline void updateCharBufferPointer(const JSStringProxy *jsStringProxy, const JS::AutoCheckCannotGC &nogc) {
+  JSLinearString *str = JS_ASSERT_STRING_IS_LINEAR(jsStringProxy->jsString->toString());
+  void *updatedCharBufPtr; // pointer to the moved char buffer after a GC
+  if (JS::LinearStringHasLatin1Chars(str)) {
+    updatedCharBufPtr = (void *)JS::GetLatin1LinearStringChars(nogc, str);
+  } else { // utf16 / ucs2 string
+    updatedCharBufPtr = (void *)JS::GetTwoByteLinearStringChars(nogc, str);
+  }
+  ((PyUnicodeObject *)(jsStringProxy))->data.any = updatedCharBufPtr;
+}
+
+/**
+ * @brief During a major GC, string buffers may have moved (compacting), so we need to re-point all our JSStringProxies
+ */
 void updateCharBufferPointers() {
   if (Py_IsFinalizing()) {
     return; // do not move char pointers around if python is finalizing
@@ -60,14 +114,27 @@ void updateCharBufferPointers() {
 
   JS::AutoCheckCannotGC nogc;
   for (const JSStringProxy *jsStringProxy: jsStringProxies) {
-    JSLinearString *str = JS_ASSERT_STRING_IS_LINEAR(jsStringProxy->jsString->toString());
-    void *updatedCharBufPtr; // pointer to the moved char buffer after a GC
-    if (JS::LinearStringHasLatin1Chars(str)) {
-      updatedCharBufPtr = (void *)JS::GetLatin1LinearStringChars(nogc, str);
-    } else { // utf16 / ucs2 string
-      updatedCharBufPtr = (void *)JS::GetTwoByteLinearStringChars(nogc, str);
+    updateCharBufferPointer(jsStringProxy, nogc);
+  }
+}
+
+/**
+ * @brief A minor GC only moves nursery-allocated strings, so only re-point the JSStringProxies that may have been moved.
+ * Strings that got tenured are dropped from the set, which keeps the minor GC pause independent of how many JS strings python holds.
+ */
+void updateNurseryCharBufferPointers() {
+  if (Py_IsFinalizing()) {
+    return; // do not move char pointers around if python is finalizing
+  }
+
+  JS::AutoCheckCannotGC nogc;
+  for (auto it = nurseryJSStringProxies.begin(); it != nurseryJSStringProxies.end();) {
+    updateCharBufferPointer(*it, nogc);
+    if (!JSStringProxyIsInNursery(*it)) {
+      it = nurseryJSStringProxies.erase(it);
+    } else {
+      it++;
     }
-    ((PyUnicodeObject *)(jsStringProxy))->data.any = updatedCharBufPtr;
   }
 }
 
@@ -81,16 +148,10 @@ void pythonmonkeyGCCallback(JSContext *cx, JSGCStatus status, JS::GCReason reaso
 
 void nurseryCollectionCallback(JSContext *cx, JS::GCNurseryProgress progress, JS::GCReason reason, void *data) {
   if (progress == JS::GCNurseryProgress::GC_NURSERY_COLLECTION_END) {
-    updateCharBufferPointers();
+    updateNurseryCharBufferPointers();
   }
 }
 
-bool functionRegistryCallback(JSContext *cx, unsigned int argc, JS::Value *vp) {
-  JS::CallArgs callargs = JS::CallArgsFromVp(argc, vp);
-  Py_DECREF((PyObject *)callargs[0].toPrivate());
-  return true;
-}
-
 static void cleanupFinalizationRegistry(JSFunction *callback, JSObject *global [[maybe_unused]], void *user_data [[maybe_unused]]) {
   JOB_QUEUE->queueFinalizationRegistryCallback(callback);
 }
@@ -155,10 +216,90 @@ PyTypeObject JSObjectProxyType = {
   .tp_base = &PyDict_Type
 };
 
+PyTypeObject JSIterableProxyType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSIterableProxy",
+  .tp_basicsize = sizeof(JSIteratorProxy),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSIteratorProxyMethodDefinitions::JSIteratorProxy_dealloc,
+  .tp_as_async = &JSIterableProxy_async_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DICT_SUBCLASS | Py_TPFLAGS_HAVE_GC,
+  .tp_doc = PyDoc_STR("Javascript iterable proxy dict"),
+  .tp_traverse = (traverseproc)JSObjectProxyMethodDefinitions::JSObjectProxy_traverse,
+  .tp_clear = (inquiry)JSObjectProxyMethodDefinitions::JSObjectProxy_clear,
+  .tp_iter = (getiterfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_iter,
+  .tp_iternext = _PyObject_NextNotImplemented, // not an iterator, so that PyIter_Check holds
+  .tp_base = &JSObjectProxyType
+};
+
+PyTypeObject JSIteratorProxyType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSIteratorProxy",
+  .tp_basicsize = sizeof(JSIteratorProxy),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSIteratorProxyMethodDefinitions::JSIteratorProxy_dealloc,
+  .tp_as_async = &JSIteratorProxy_async_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DICT_SUBCLASS | Py_TPFLAGS_HAVE_GC,
+  .tp_doc = PyDoc_STR("Javascript iterator proxy dict"),
+  .tp_traverse = (traverseproc)JSObjectProxyMethodDefinitions::JSObjectProxy_traverse,
+  .tp_clear = (inquiry)JSObjectProxyMethodDefinitions::JSObjectProxy_clear,
+  .tp_iter = (getiterfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_iter,
+  .tp_iternext = (iternextfunc)JSIteratorProxyMethodDefinitions::JSIteratorProxy_iternext,
+  .tp_base = &JSIterableProxyType
+};
+
+PyTypeObject JSWasmMemoryProxyType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSWasmMemoryProxy",
+  .tp_basicsize = sizeof(JSWasmMemoryProxy),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSWasmMemoryProxyMethodDefinitions::JSWasmMemoryProxy_dealloc,
+  .tp_as_buffer = &JSWasmMemoryProxy_buffer_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_DICT_SUBCLASS | Py_TPFLAGS_HAVE_GC,
+  .tp_doc = PyDoc_STR("Javascript WebAssembly.Memory proxy dict, exporting the memory of the Wasm instance as a buffer"),
+  .tp_traverse = (traverseproc)JSObjectProxyMethodDefinitions::JSObjectProxy_traverse,
+  .tp_clear = (inquiry)JSObjectProxyMethodDefinitions::JSObjectProxy_clear,
+  .tp_base = &JSObjectProxyType
+};
+
+PyTypeObject JSMapProxyType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSMapProxy",
+  .tp_basicsize = sizeof(JSMapProxy),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSMapProxyMethodDefinitions::JSMapProxy_dealloc,
+  .tp_repr = (reprfunc)JSMapProxyMethodDefinitions::JSMapProxy_repr,
+  .tp_as_sequence = &JSMapProxy_sequence_methods,
+  .tp_as_mapping = &JSMapProxy_mapping_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+  .tp_doc = PyDoc_STR("Javascript Map proxy mapping"),
+  .tp_traverse = (traverseproc)JSMapProxyMethodDefinitions::JSMapProxy_traverse,
+  .tp_clear = (inquiry)JSMapProxyMethodDefinitions::JSMapProxy_clear,
+  .tp_iter = (getiterfunc)JSMapProxyMethodDefinitions::JSMapProxy_iter,
+  .tp_methods = JSMapProxy_methods,
+};
+
+PyTypeObject JSSetProxyType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSSetProxy",
+  .tp_basicsize = sizeof(JSSetProxy),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSSetProxyMethodDefinitions::JSSetProxy_dealloc,
+  .tp_repr = (reprfunc)JSSetProxyMethodDefinitions::JSSetProxy_repr,
+  .tp_as_sequence = &JSSetProxy_sequence_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+  .tp_doc = PyDoc_STR("Javascript Set proxy collection"),
+  .tp_traverse = (traverseproc)JSSetProxyMethodDefinitions::JSSetProxy_traverse,
+  .tp_clear = (inquiry)JSSetProxyMethodDefinitions::JSSetProxy_clear,
+  .tp_iter = (getiterfunc)JSSetProxyMethodDefinitions::JSSetProxy_iter,
+  .tp_methods = JSSetProxy_methods,
+};
+
 PyTypeObject JSStringProxyType = {
   .tp_name = PyUnicode_Type.tp_name,
   .tp_basicsize = sizeof(JSStringProxy),
   .tp_dealloc = (destructor)JSStringProxyMethodDefinitions::JSStringProxy_dealloc,
+  .tp_str = (reprfunc)JSStringProxyMethodDefinitions::JSStringProxy_str,
   .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_UNICODE_SUBCLASS,
   .tp_doc = PyDoc_STR("Javascript String proxy"),
   .tp_methods = JSStringProxy_methods,
@@ -170,8 +311,9 @@ PyTypeObject JSFunctionProxyType = {
   .tp_name = "pythonmonkey.JSFunctionProxy",
   .tp_basicsize = sizeof(JSFunctionProxy),
   .tp_dealloc = (destructor)JSFunctionProxyMethodDefinitions::JSFunctionProxy_dealloc,
+  .tp_vectorcall_offset = offsetof(JSFunctionProxy, vectorcall),
   .tp_call = JSFunctionProxyMethodDefinitions::JSFunctionProxy_call,
-  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_VECTORCALL,
   .tp_doc = PyDoc_STR("Javascript Function proxy object"),
   .tp_new = JSFunctionProxyMethodDefinitions::JSFunctionProxy_new
 };
@@ -181,8 +323,9 @@ PyTypeObject JSMethodProxyType = {
   .tp_name = "pythonmonkey.JSMethodProxy",
   .tp_basicsize = sizeof(JSMethodProxy),
   .tp_dealloc = (destructor)JSMethodProxyMethodDefinitions::JSMethodProxy_dealloc,
+  .tp_vectorcall_offset = offsetof(JSMethodProxy, vectorcall),
   .tp_call = JSMethodProxyMethodDefinitions::JSMethodProxy_call,
-  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_VECTORCALL,
   .tp_doc = PyDoc_STR("Javascript Method proxy object"),
   .tp_new = JSMethodProxyMethodDefinitions::JSMethodProxy_new
 };
@@ -207,6 +350,40 @@ PyTypeObject JSArrayProxyType = {
   .tp_base = &PyList_Type
 };
 
+PyTypeObject JSBufferExporterType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSBufferExporter",
+  .tp_basicsize = sizeof(JSBufferExporter),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSBufferExporterMethodDefinitions::JSBufferExporter_dealloc,
+  .tp_as_buffer = &JSBufferExporter_buffer_methods,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = PyDoc_STR("Exporter of memoryviews over Javascript buffers, keeping them alive and attached"),
+};
+
+PyTypeObject JSWorkerType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.Worker",
+  .tp_basicsize = sizeof(JSWorker),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSWorkerMethodDefinitions::JSWorker_dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = PyDoc_STR("Javascript code running in its own JS runtime and thread, exchanging deep copies of values with Python"),
+  .tp_methods = JSWorker_methods,
+  .tp_new = JSWorkerMethodDefinitions::JSWorker_new,
+};
+
+PyTypeObject JSScriptHandleType = {
+  .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
+  .tp_name = "pythonmonkey.JSScript",
+  .tp_basicsize = sizeof(JSScriptHandle),
+  .tp_itemsize = 0,
+  .tp_dealloc = (destructor)JSScriptHandleMethodDefinitions::JSScriptHandle_dealloc,
+  .tp_flags = Py_TPFLAGS_DEFAULT,
+  .tp_doc = PyDoc_STR("Javascript script compiled by pythonmonkey.compile, to be run many times"),
+  .tp_methods = JSScriptHandle_methods,
+};
+
 PyTypeObject JSArrayIterProxyType = {
   .ob_base = PyVarObject_HEAD_INIT(NULL, 0)
   .tp_name = PyListIter_Type.tp_name,
@@ -308,6 +485,20 @@ static void cleanup() {
   Py_XDECREF(PythonMonkey_BigInt);
 
   // Clean up SpiderMonkey
+  Retention::finalize();
+  Profiler::finalize();
+  PromiseType::finalize();
+  ProxyCache::finalize();
+  CrossHeap::finalize();
+  ConsoleSink::finalize();
+  AtomCache::finalize();
+  TypeLayoutCache::finalize();
+  ModuleLoader::finalize();
+  StencilCache::finalize();
+  WasmModuleCache::finalize();
+  JSONStringify::finalize();
+  InternalBinding::finalizeUrl();
+  RootPool::finalize();
   delete autoRealm;
   delete global;
   if (GLOBAL_CX) {
@@ -321,11 +512,156 @@ static void cleanup(PyObject *) {
   cleanup();
 }
 
-static PyObject *collect(PyObject *self, PyObject *args) {
-  JS_GC(GLOBAL_CX);
+static PyObject *collect(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"shrinking", NULL};
+  int shrinking = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **)kwlist, &shrinking)) {
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  // a non-incremental GC also finishes the incremental GC driven by gcSlice, if one is in progress
+  JS::PrepareForFullGC(GLOBAL_CX);
+  JS::NonIncrementalGC(GLOBAL_CX, shrinking ? JS::GCOptions::Shrink : JS::GCOptions::Normal, JS::GCReason::API);
+  Py_RETURN_NONE;
+}
+
+static PyObject *gcSlice(PyObject *self, PyObject *args) {
+  double budgetMs;
+  if (!PyArg_ParseTuple(args, "d", &budgetMs)) {
+    return NULL;
+  }
+  if (budgetMs <= 0) {
+    PyErr_SetString(PyExc_ValueError, "pythonmonkey.gcSlice expects a budget > 0 milliseconds");
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+
+  js::SliceBudget budget(js::TimeBudget((int64_t)(budgetMs < 1 ? 1 : budgetMs)));
+  if (JS::IsIncrementalGCInProgress(GLOBAL_CX)) {
+    JS::PrepareForIncrementalGC(GLOBAL_CX);
+    JS::IncrementalGCSlice(GLOBAL_CX, JS::GCReason::API, budget);
+  } else {
+    JS::PrepareForFullGC(GLOBAL_CX);
+    JS::StartIncrementalGC(GLOBAL_CX, JS::GCOptions::Normal, JS::GCReason::API, budget);
+  }
+  return PyBool_FromLong(JS::IsIncrementalGCInProgress(GLOBAL_CX));
+}
+
+/**
+ * @brief The GC parameters exposed to Python by pythonmonkey.setGCParameter and pythonmonkey.getGCParameter
+ */
+struct GCParameter {
+  const char *name;
+  JSGCParamKey key;
+  bool writable;
+};
+
+static const GCParameter gcParameters[] = {
+  {"maxBytes", JSGC_MAX_BYTES, true},
+  {"minNurseryBytes", JSGC_MIN_NURSERY_BYTES, true},
+  {"maxNurseryBytes", JSGC_MAX_NURSERY_BYTES, true},
+  {"incrementalGCEnabled", JSGC_INCREMENTAL_GC_ENABLED, true},
+  {"perZoneGCEnabled", JSGC_PER_ZONE_GC_ENABLED, true},
+  {"compactingEnabled", JSGC_COMPACTING_ENABLED, true},
+  {"sliceTimeBudgetMs", JSGC_SLICE_TIME_BUDGET_MS, true},
+  {"highFrequencyTimeLimit", JSGC_HIGH_FREQUENCY_TIME_LIMIT, true},
+  {"smallHeapSizeMax", JSGC_SMALL_HEAP_SIZE_MAX, true},
+  {"largeHeapSizeMin", JSGC_LARGE_HEAP_SIZE_MIN, true},
+  {"highFrequencySmallHeapGrowth", JSGC_HIGH_FREQUENCY_SMALL_HEAP_GROWTH, true},
+  {"highFrequencyLargeHeapGrowth", JSGC_HIGH_FREQUENCY_LARGE_HEAP_GROWTH, true},
+  {"lowFrequencyHeapGrowth", JSGC_LOW_FREQUENCY_HEAP_GROWTH, true},
+  {"allocationThreshold", JSGC_ALLOCATION_THRESHOLD, true},
+  {"bytes", JSGC_BYTES, false},
+  {"number", JSGC_NUMBER, false},
+  {"totalChunks", JSGC_TOTAL_CHUNKS, false},
+  {"unusedChunks", JSGC_UNUSED_CHUNKS, false},
+};
+
+static const GCParameter *findGCParameter(const char *name) {
+  for (const GCParameter &parameter : gcParameters) {
+    if (strcmp(parameter.name, name) == 0) {
+      return &parameter;
+    }
+  }
+  PyErr_Format(PyExc_KeyError, "unknown GC parameter '%s'", name);
+  return nullptr;
+}
+
+static PyObject *setGCParameter(PyObject *self, PyObject *args) {
+  const char *name;
+  unsigned long long value;
+  if (!PyArg_ParseTuple(args, "sK", &name, &value)) {
+    return NULL;
+  }
+  const GCParameter *parameter = findGCParameter(name);
+  if (!parameter) {
+    return NULL;
+  }
+  if (!parameter->writable) {
+    PyErr_Format(PyExc_ValueError, "the GC parameter '%s' is read-only", name);
+    return NULL;
+  }
+  if (value > UINT32_MAX) {
+    PyErr_Format(PyExc_OverflowError, "the GC parameter '%s' must fit in 32 bits", name);
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  // JS_SetGCParameter ignores the values out of the range of a parameter, which then keeps its previous value
+  uint32_t previous = JS_GetGCParameter(GLOBAL_CX, parameter->key);
+  JS_SetGCParameter(GLOBAL_CX, parameter->key, (uint32_t)value);
+  if (JS_GetGCParameter(GLOBAL_CX, parameter->key) != (uint32_t)value) {
+    JS_SetGCParameter(GLOBAL_CX, parameter->key, previous);
+    PyErr_Format(PyExc_ValueError, "the GC parameter '%s' does not accept the value %llu", name, value);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *getGCParameter(PyObject *self, PyObject *args) {
+  const char *name;
+  if (!PyArg_ParseTuple(args, "s", &name)) {
+    return NULL;
+  }
+  const GCParameter *parameter = findGCParameter(name);
+  if (!parameter) {
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return PyLong_FromUnsignedLong(JS_GetGCParameter(GLOBAL_CX, parameter->key));
+}
+
+static PyObject *setEngineOptions(PyObject *self, PyObject *args, PyObject *kwargs) {
+  if (PyTuple_GET_SIZE(args) != 0) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.setEngineOptions only accepts keyword arguments");
+    return NULL;
+  }
+  if (!kwargs) {
+    Py_RETURN_NONE;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  if (!EngineOptions::set(GLOBAL_CX, kwargs)) {
+    return NULL;
+  }
   Py_RETURN_NONE;
 }
 
+static PyObject *getEngineOptions(PyObject *self, PyObject *Py_UNUSED(args)) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return EngineOptions::toPython(GLOBAL_CX);
+}
+
 static bool getEvalOption(PyObject *evalOptions, const char *optionName, const char **s_p) {
   PyObject *value;
   if (PyObject_TypeCheck(evalOptions, &JSObjectProxyType)) {
@@ -355,6 +691,19 @@ static bool getEvalOption(PyObject *evalOptions, const char *optionName, unsigne
   return value != NULL && value != Py_None;
 }
 
+static bool getEvalOption(PyObject *evalOptions, const char *optionName, double *d_p) {
+  PyObject *value;
+  if (PyObject_TypeCheck(evalOptions, &JSObjectProxyType)) {
+    value = PyMapping_GetItemString(evalOptions, optionName);
+  } else {
+    value = PyDict_GetItemString(evalOptions, optionName);
+  }
+  if (value && value != Py_None) {
+    *d_p = PyFloat_AsDouble(value);
+  }
+  return value != NULL && value != Py_None;
+}
+
 static bool getEvalOption(PyObject *evalOptions, const char *optionName, bool *b_p) {
   PyObject *value;
   if (PyObject_TypeCheck(evalOptions, &JSObjectProxyType)) {
@@ -368,6 +717,46 @@ static bool getEvalOption(PyObject *evalOptions, const char *optionName, bool *b
   return value != NULL && value != Py_None;
 }
 
+/**
+ * Apply the options of pythonmonkey.eval and pythonmonkey.compile, see `eval` below
+ */
+static void setEvalOptions(PyObject *evalOptions, JS::CompileOptions &options, bool *isModule) {
+  const char *s;
+  unsigned long l;
+  bool b;
+
+  if (getEvalOption(evalOptions, "filename", &s)) options.setFile(s);
+  if (getEvalOption(evalOptions, "lineno", &l)) options.setLine(l);
+  if (getEvalOption(evalOptions, "column", &l)) options.setColumn(JS::ColumnNumberOneOrigin(l));
+  if (getEvalOption(evalOptions, "mutedErrors", &b)) options.setMutedErrors(b);
+  if (getEvalOption(evalOptions, "noScriptRval", &b)) options.setNoScriptRval(b);
+  if (getEvalOption(evalOptions, "selfHosting", &b)) options.setSelfHostingMode(b);
+  if (getEvalOption(evalOptions, "strict", &b)) if (b) options.setForceStrictMode();
+  if (getEvalOption(evalOptions, "module", &b)) if (b) { options.setModule(); *isModule = true; }
+
+  if (getEvalOption(evalOptions, "fromPythonFrame", &b) && b) {
+#if PY_VERSION_HEX >= 0x03090000
+    PyFrameObject *frame = PyEval_GetFrame();
+    if (frame && !getEvalOption(evalOptions, "lineno", &l)) {
+      options.setLine(PyFrame_GetLineNumber(frame));
+    } /* lineno */
+#endif
+#if 0 && (PY_VERSION_HEX >= 0x030a0000) && (PY_VERSION_HEX < 0x030c0000)
+    PyObject *filename = PyDict_GetItemString(frame->f_builtins, "__file__");
+#elif (PY_VERSION_HEX >= 0x030c0000)
+    PyObject *filename = PyDict_GetItemString(PyFrame_GetGlobals(frame), "__file__");
+#else
+    PyObject *filename = NULL;
+#endif
+    if (!getEvalOption(evalOptions, "filename", &s)) {
+      if (filename && PyUnicode_Check(filename)) {
+        PyObject *filenameStr = PyUnicode_FromObject(filename); // needs a strict Python str object (not a subtype)
+        options.setFile(PyUnicode_AsUTF8(filenameStr));
+      }
+    } /* filename */
+  } /* fromPythonFrame */
+}
+
 /**
  * Implement the pythonmonkey.eval function. From Python-land, that function has the following API:
  * argument 0 - unicode string of JS code or open file containing JS code in UTF-8
@@ -377,6 +766,7 @@ static bool getEvalOption(PyObject *evalOptions, const char *optionName, bool *b
  *              and still get stack dumps which point to the source code.
  */
 static PyObject *eval(PyObject *self, PyObject *args) {
+  ProfilerLabel profilerLabel("pythonmonkey.eval");
   size_t argc = PyTuple_GET_SIZE(args);
   if (argc > 2 || argc == 0) {
     PyErr_SetString(PyExc_TypeError, "pythonmonkey.eval accepts one or two arguments");
@@ -422,55 +812,57 @@ static PyObject *eval(PyObject *self, PyObject *args) {
   .setNoScriptRval(false)
   .setIntroductionType("pythonmonkey eval");
 
+  bool isModule = false;
+  double timeoutMs = 0;
+  unsigned long maxHeapBytes = 0;
   if (evalOptions) {
-    const char *s;
-    unsigned long l;
-    bool b;
-
-    if (getEvalOption(evalOptions, "filename", &s)) options.setFile(s);
-    if (getEvalOption(evalOptions, "lineno", &l)) options.setLine(l);
-    if (getEvalOption(evalOptions, "column", &l)) options.setColumn(JS::ColumnNumberOneOrigin(l));
-    if (getEvalOption(evalOptions, "mutedErrors", &b)) options.setMutedErrors(b);
-    if (getEvalOption(evalOptions, "noScriptRval", &b)) options.setNoScriptRval(b);
-    if (getEvalOption(evalOptions, "selfHosting", &b)) options.setSelfHostingMode(b);
-    if (getEvalOption(evalOptions, "strict", &b)) if (b) options.setForceStrictMode();
-    if (getEvalOption(evalOptions, "module", &b)) if (b) options.setModule();
-
-    if (getEvalOption(evalOptions, "fromPythonFrame", &b) && b) {
-#if PY_VERSION_HEX >= 0x03090000
-      PyFrameObject *frame = PyEval_GetFrame();
-      if (frame && !getEvalOption(evalOptions, "lineno", &l)) {
-        options.setLine(PyFrame_GetLineNumber(frame));
-      } /* lineno */
-#endif
-#if 0 && (PY_VERSION_HEX >= 0x030a0000) && (PY_VERSION_HEX < 0x030c0000)
-      PyObject *filename = PyDict_GetItemString(frame->f_builtins, "__file__");
-#elif (PY_VERSION_HEX >= 0x030c0000)
-      PyObject *filename = PyDict_GetItemString(PyFrame_GetGlobals(frame), "__file__");
-#else
-      PyObject *filename = NULL;
-#endif
-      if (!getEvalOption(evalOptions, "filename", &s)) {
-        if (filename && PyUnicode_Check(filename)) {
-          PyObject *filenameStr = PyUnicode_FromObject(filename); // needs a strict Python str object (not a subtype)
-          options.setFile(PyUnicode_AsUTF8(filenameStr));
-        }
-      } /* filename */
-    } /* fromPythonFrame */
-  } /* eval options */
+    setEvalOptions(evalOptions, options, &isModule);
+    getEvalOption(evalOptions, "timeoutMs", &timeoutMs);
+    getEvalOption(evalOptions, "maxHeapBytes", &maxHeapBytes);
+    if (PyErr_Occurred()) {
+      if (file)
+        fclose(file);
+      return NULL;
+    }
+  }
 
   // compile the code to execute
   JS::RootedScript script(GLOBAL_CX);
   JS::Rooted<JS::Value> rval(GLOBAL_CX);
   if (code) {
-    JS::SourceText<mozilla::Utf8Unit> source;
     Py_ssize_t codeLength;
     const char *codeChars = PyUnicode_AsUTF8AndSize(code, &codeLength);
-    if (!source.init(GLOBAL_CX, codeChars, codeLength, JS::SourceOwnership::Borrowed)) {
-      setSpiderMonkeyException(GLOBAL_CX);
+    if (!codeChars) {
       return NULL;
     }
-    script = JS::Compile(GLOBAL_CX, options, source);
+    if (isModule) { // an ES module, evaluates to its namespace object
+      JS::RootedObject module(GLOBAL_CX, ModuleLoader::compileModule(GLOBAL_CX, options, codeChars, codeLength));
+      JS::RootedObject moduleNamespace(GLOBAL_CX);
+      if (!module) {
+        setSpiderMonkeyException(GLOBAL_CX);
+        return NULL;
+      }
+      {
+        Watchdog::AutoLimit limit(timeoutMs, maxHeapBytes);
+        if (limit.failed()) {
+          return NULL;
+        }
+        GILSwitch::AutoHandOver handOver;
+        if (!handOver.entered()) {
+          return NULL;
+        }
+        moduleNamespace = ModuleLoader::evaluateModule(GLOBAL_CX, module);
+        if (!moduleNamespace) {
+          if (!limit.exceeded()) {
+            setSpiderMonkeyException(GLOBAL_CX);
+          }
+          return NULL;
+        }
+      }
+      rval.setObject(*moduleNamespace);
+      return pyTypeFactory(GLOBAL_CX, rval);
+    }
+    script = StencilCache::compile(GLOBAL_CX, options, codeChars, codeLength);
   } else {
     assert(file);
     script = JS::CompileUtf8File(GLOBAL_CX, options, file);
@@ -483,9 +875,21 @@ static PyObject *eval(PyObject *self, PyObject *args) {
   }
 
   // execute the compiled code; last expr goes to rval
-  if (!JS_ExecuteScript(GLOBAL_CX, script, &rval)) {
-    setSpiderMonkeyException(GLOBAL_CX);
-    return NULL;
+  {
+    Watchdog::AutoLimit limit(timeoutMs, maxHeapBytes);
+    if (limit.failed()) {
+      return NULL;
+    }
+    GILSwitch::AutoHandOver handOver;
+    if (!handOver.entered()) {
+      return NULL;
+    }
+    if (!JS_ExecuteScript(GLOBAL_CX, script, &rval)) {
+      if (!limit.exceeded()) {
+        setSpiderMonkeyException(GLOBAL_CX);
+      }
+      return NULL;
+    }
   }
 
   // translate to the proper python type
@@ -502,6 +906,87 @@ static PyObject *eval(PyObject *self, PyObject *args) {
   }
 }
 
+/**
+ * Implement the pythonmonkey.compile function: argument 0 is a unicode string of JS code, argument 1 the same
+ * options as pythonmonkey.eval. The script is compiled once, not as run-once, and returned as a JSScript to be run many times.
+ */
+static PyObject *compile(PyObject *self, PyObject *args) {
+  PyObject *code;
+  PyObject *evalOptions = NULL;
+  if (!PyArg_ParseTuple(args, "U|O!", &code, &PyDict_Type, &evalOptions)) {
+    return NULL;
+  }
+
+  JS::CompileOptions options (GLOBAL_CX);
+  options.setFileAndLine("evaluate", 1)
+  .setNoScriptRval(false)
+  .setIntroductionType("pythonmonkey compile");
+
+  bool isModule = false;
+  if (evalOptions) {
+    setEvalOptions(evalOptions, options, &isModule);
+  }
+  if (isModule) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.compile does not support modules");
+    return NULL;
+  }
+  return JSScriptHandleMethodDefinitions::compile(GLOBAL_CX, code, options);
+}
+
+/**
+ * Implement the pythonmonkey.compileAsync function: same arguments as pythonmonkey.compile, the script is compiled by a
+ * thread of its own and the returned asyncio.Future resolves to the JSScript, so the event-loop keeps running meanwhile
+ */
+static PyObject *compileAsync(PyObject *self, PyObject *args) {
+  PyObject *code;
+  PyObject *evalOptions = NULL;
+  if (!PyArg_ParseTuple(args, "U|O!", &code, &PyDict_Type, &evalOptions)) {
+    return NULL;
+  }
+
+  JS::CompileOptions options (GLOBAL_CX);
+  options.setFileAndLine("evaluate", 1)
+  .setNoScriptRval(false)
+  .setIntroductionType("pythonmonkey compile");
+
+  bool isModule = false;
+  if (evalOptions) {
+    setEvalOptions(evalOptions, options, &isModule);
+  }
+  if (isModule) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.compileAsync does not support modules");
+    return NULL;
+  }
+  return JSScriptHandleMethodDefinitions::compileAsync(GLOBAL_CX, code, options);
+}
+
+/**
+ * Implement the pythonmonkey.importModule function: load, link and evaluate the ES module of a file and the modules
+ * it imports, and return its namespace object
+ */
+static PyObject *importModule(PyObject *self, PyObject *args) {
+  const char *filename;
+  if (!PyArg_ParseTuple(args, "s", &filename)) {
+    return NULL;
+  }
+
+  JS::RootedObject module(GLOBAL_CX, ModuleLoader::loadModule(GLOBAL_CX, filename));
+  JS::RootedObject moduleNamespace(GLOBAL_CX);
+  if (module) {
+    GILSwitch::AutoHandOver handOver;
+    if (!handOver.entered()) {
+      return NULL;
+    }
+    moduleNamespace = ModuleLoader::evaluateModule(GLOBAL_CX, module);
+  }
+  if (!moduleNamespace) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  JS::RootedValue moduleNamespaceValue(GLOBAL_CX, JS::ObjectValue(*moduleNamespace));
+  return pyTypeFactory(GLOBAL_CX, moduleNamespaceValue);
+}
+
 static PyObject *waitForEventLoop(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(_)) {
   PyObject *waiter = PyEventLoop::_locker->_queueIsEmpty; // instance of asyncio.Event
 
@@ -535,39 +1020,703 @@ static PyObject *isCompilableUnit(PyObject *self, PyObject *args) {
   }
 }
 
-PyMethodDef PythonMonkeyMethods[] = {
-  {"eval", eval, METH_VARARGS, "Javascript evaluator in Python"},
-  {"wait", waitForEventLoop, METH_NOARGS, "The event-loop shield. Blocks until all asynchronous jobs finish."},
-  {"stop", closeAllPending, METH_NOARGS, "Cancel all pending event-loop jobs."},
-  {"isCompilableUnit", isCompilableUnit, METH_VARARGS, "Hint if a string might be compilable Javascript"},
-  {"collect", collect, METH_VARARGS, "Calls the Spidermonkey garbage collector"},
-  {NULL, NULL, 0, NULL}
-};
-
-struct PyModuleDef pythonmonkey =
-{
-  PyModuleDef_HEAD_INIT,
-  "pythonmonkey",                                   /* name of module */
-  "A module for python to JS interoperability",   /* module documentation, may be NULL */
-  -1,                                           /* size of per-interpreter state of the module, or -1 if the module keeps state in global variables. */
-  PythonMonkeyMethods
-};
-
-PyObject *SpiderMonkeyError = NULL;
-
-PyMODINIT_FUNC PyInit_pythonmonkey(void)
-{
-  if (!PyDateTimeAPI) { PyDateTime_IMPORT; }
+static PyObject *setLazyStringNormalization(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  StrType::lazySurrogateNormalization = enabled;
+  Py_RETURN_NONE;
+}
 
-  SpiderMonkeyError = PyErr_NewException("pythonmonkey.SpiderMonkeyError", NULL, NULL);
-  if (!JS_Init()) {
-    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not be initialized.");
+static PyObject *setReleaseGIL(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  if (!GILSwitch::setEnabled(enabled)) {
     return NULL;
   }
+  Py_RETURN_NONE;
+}
 
-  GLOBAL_CX = JS_NewContext(JS::DefaultHeapMaxBytes);
-  if (!GLOBAL_CX) {
-    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create a JS context.");
+static PyObject *setCollectCrossHeapCycles(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  CrossHeap::enabled = enabled;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setStencilCache(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"size", "directory", NULL};
+  Py_ssize_t size = 256;
+  PyObject *directoryObject = NULL;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|nO", (char **)kwlist, &size, &directoryObject)) {
+    return NULL;
+  }
+  if (size < 0) {
+    PyErr_SetString(PyExc_ValueError, "pythonmonkey.setStencilCache expects a size >= 0");
+    return NULL;
+  }
+  std::string directory;
+  if (!directoryObject) { // the default, the PYTHONMONKEY_STENCIL_CACHE directory
+    directory = StencilCache::defaultDirectory();
+  } else if (directoryObject != Py_None) {
+    if (!PyUnicode_Check(directoryObject)) {
+      PyErr_SetString(PyExc_TypeError, "pythonmonkey.setStencilCache expects the directory to be a str or None");
+      return NULL;
+    }
+    const char *chars = PyUnicode_AsUTF8(directoryObject);
+    if (!chars) {
+      return NULL;
+    }
+    directory = chars;
+  }
+  if (!StencilCache::configure(size, directory)) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *setRequireCache(PyObject *self, PyObject *args) {
+  const char *path = NULL;
+  if (!PyArg_ParseTuple(args, "z", &path)) {
+    return NULL;
+  }
+  RequireCache::setFile(path ? path : "");
+  Py_RETURN_NONE;
+}
+
+static PyObject *setCopyStridedBuffers(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  BufferType::copyStridedBuffers = enabled;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setCopyImmutableBuffers(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  BufferType::copyImmutableBuffers = enabled;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setIteratorBatchSize(PyObject *self, PyObject *args) {
+  Py_ssize_t size;
+  if (!PyArg_ParseTuple(args, "n", &size)) {
+    return NULL;
+  }
+  if (size < 1) {
+    PyErr_SetString(PyExc_ValueError, "pythonmonkey.setIteratorBatchSize expects a size >= 1");
+    return NULL;
+  }
+  PyIterableProxyHandler::batchSize = size;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setNumbersAsInt(PyObject *self, PyObject *args) {
+  int int32AsInt;
+  int integralAsInt = false;
+  if (!PyArg_ParseTuple(args, "p|p", &int32AsInt, &integralAsInt)) {
+    return NULL;
+  }
+  FloatType::int32AsInt = int32AsInt;
+  FloatType::integralAsInt = integralAsInt;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setDatesAsTimestamps(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  DateType::datesAsTimestamps = enabled;
+  Py_RETURN_NONE;
+}
+
+static PyObject *setKeywordArgumentsAsOptions(PyObject *self, PyObject *args) {
+  int enabled;
+  if (!PyArg_ParseTuple(args, "p", &enabled)) {
+    return NULL;
+  }
+  JSFunctionProxyMethodDefinitions::keywordArgumentsAsOptions = enabled;
+  Py_RETURN_NONE;
+}
+
+static PyObject *toPython(PyObject *self, PyObject *value) {
+  JS::RootedValue jsValue(GLOBAL_CX, jsTypeFactory(GLOBAL_CX, value)); // unwraps the proxies of JS objects
+  if (PyErr_Occurred()) {
+    return NULL;
+  }
+  return DeepCopy::toPython(GLOBAL_CX, jsValue);
+}
+
+static PyObject *arrayFromBuffer(PyObject *self, PyObject *buffer) {
+  JS::RootedObject array(GLOBAL_CX, BufferType::toJsArray(GLOBAL_CX, buffer));
+  if (!array) {
+    return NULL;
+  }
+  JS::RootedValue arrayValue(GLOBAL_CX, JS::ObjectValue(*array));
+  return pyTypeFactory(GLOBAL_CX, arrayValue);
+}
+
+static PyObject *toJS(PyObject *self, PyObject *value) {
+  JS::RootedValue copy(GLOBAL_CX);
+  if (!DeepCopy::toJS(GLOBAL_CX, value, &copy)) {
+    return NULL;
+  }
+  return pyTypeFactory(GLOBAL_CX, copy);
+}
+
+static PyObject *serialize(PyObject *self, PyObject *value) {
+  JS::RootedValue copy(GLOBAL_CX);
+  if (!DeepCopy::toJS(GLOBAL_CX, value, &copy)) { // plain Python data is copied, the proxies of JS objects give their JS object
+    return NULL;
+  }
+  PyObject *bytes = StructuredClone::serialize(GLOBAL_CX, copy);
+  if (!bytes && !PyErr_Occurred()) {
+    setSpiderMonkeyException(GLOBAL_CX);
+  }
+  return bytes;
+}
+
+static PyObject *deserialize(PyObject *self, PyObject *data) {
+  Py_buffer view;
+  if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) {
+    return NULL;
+  }
+  JS::RootedValue rval(GLOBAL_CX);
+  bool ok = StructuredClone::deserialize(GLOBAL_CX, (const char *)view.buf, view.len, &rval);
+  PyBuffer_Release(&view);
+  if (!ok) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  return pyTypeFactory(GLOBAL_CX, rval);
+}
+
+/**
+ * @brief Settle a JS value produced by `runSync`: a Promise that is no longer pending gives its result, anything else is itself the result
+ *
+ * @param cx - javascript context pointer
+ * @param value - the value returned by the JS function
+ * @param pending - set to the Promise if it still waits on timers or I/O, left null otherwise
+ * @return PyObject* - a new reference to the result, or NULL with a Python exception set (or with `pending` set)
+ */
+static PyObject *settledResult(JSContext *cx, JS::HandleValue value, JS::MutableHandleObject pending) {
+  if (!value.isObject() || !JS::IsPromiseObject(&value.toObject())) {
+    return pyTypeFactory(cx, value);
+  }
+  JS::RootedObject promise(cx, &value.toObject());
+  JS::RootedValue result(cx, JS::GetPromiseResult(promise));
+  switch (JS::GetPromiseState(promise)) {
+  case JS::PromiseState::Fulfilled:
+    return pyTypeFactory(cx, result);
+  case JS::PromiseState::Rejected:
+    (void)JS::SetSettledPromiseIsHandled(cx, promise); // the rejection is raised here, it must not also be reported as unhandled
+    JS::SetPendingException(cx, result);
+    setSpiderMonkeyException(cx);
+    return NULL;
+  default:
+    pending.set(promise);
+    return NULL;
+  }
+}
+
+static PyObject *runSync(PyObject *self, PyObject *args) {
+  Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+  if (nargs < 1) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.runSync expects a JS function or promise as its first argument");
+    return NULL;
+  }
+
+  PyObject *asyncio = PyImport_ImportModule("asyncio");
+  if (!asyncio) {
+    return NULL;
+  }
+  PyObject *runningLoop = PyObject_CallMethod(asyncio, "_get_running_loop", NULL);
+  if (!runningLoop) {
+    Py_DECREF(asyncio);
+    return NULL;
+  }
+
+  // Without a running event-loop, a private one is installed while the JS code runs,
+  //    so that the timers and I/O it starts can still be waited on once the promise jobs are exhausted
+  PyObject *privateLoop = NULL;
+  if (runningLoop == Py_None) {
+    privateLoop = PyObject_CallMethod(asyncio, "new_event_loop", NULL);
+    PyObject *ret = privateLoop ? PyObject_CallMethod(asyncio, "_set_running_loop", "O", privateLoop) : NULL;
+    if (!ret) {
+      Py_XDECREF(privateLoop);
+      Py_DECREF(runningLoop);
+      Py_DECREF(asyncio);
+      return NULL;
+    }
+    Py_DECREF(ret);
+  }
+  Py_DECREF(runningLoop);
+
+  JSContext *cx = GLOBAL_CX;
+  PyObject *result = NULL;
+  JS::RootedObject pending(cx);
+  JS::RootedValue fn(cx, jsTypeFactory(cx, PyTuple_GET_ITEM(args, 0)));
+  if (!PyErr_Occurred()) {
+    if (fn.isObject() && JS::IsCallable(&fn.toObject())) {
+      JS::RootedValueVector jsArgs(cx);
+      if (!jsArgs.resize(nargs - 1)) {
+        PyErr_NoMemory();
+      }
+      for (Py_ssize_t index = 1; index < nargs && !PyErr_Occurred(); index++) {
+        jsArgs[index - 1].set(jsTypeFactory(cx, PyTuple_GET_ITEM(args, index)));
+      }
+      JS::RootedValue rval(cx);
+      if (!PyErr_Occurred() && JOB_QUEUE->callSync(cx, fn, jsArgs, &rval)) {
+        result = settledResult(cx, rval, &pending);
+      }
+    } else { // a promise, or a Python awaitable converted to one
+      result = settledResult(cx, fn, &pending);
+    }
+  }
+
+  if (pending && !privateLoop) {
+    PyErr_SetString(PyExc_RuntimeError, "pythonmonkey.runSync cannot block the running event-loop while the promise waits on timers or I/O, await it instead");
+  } else if (pending) {
+    // Fall back to the private event-loop, the promise jobs still run back-to-back in one callback of it
+    PyObject *future = PromiseType::getPyObject(cx, pending);
+    PyObject *ret = PyObject_CallMethod(asyncio, "_set_running_loop", "O", Py_None);
+    Py_XDECREF(ret);
+    if (future && ret) {
+      result = PyObject_CallMethod(privateLoop, "run_until_complete", "O", future);
+    }
+    Py_XDECREF(future);
+  }
+
+  if (privateLoop) {
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    PyObject *ret = PyObject_CallMethod(asyncio, "_set_running_loop", "O", Py_None);
+    Py_XDECREF(ret);
+    ret = PyObject_CallMethod(privateLoop, "close", NULL);
+    Py_XDECREF(ret);
+    Py_DECREF(privateLoop);
+    PyErr_Clear();
+    PyErr_Restore(type, value, traceback);
+  }
+  Py_DECREF(asyncio);
+
+  if (!result && !PyErr_Occurred()) {
+    Py_RETURN_NONE; // undefined
+  }
+  return result;
+}
+
+static PyObject *startProfiler(PyObject *self, PyObject *args) {
+  double interval = 0.001;
+  if (!PyArg_ParseTuple(args, "|d", &interval)) {
+    return NULL;
+  }
+  if (!ContextOwner::check() || !Profiler::start(GLOBAL_CX, interval)) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *stopProfiler(PyObject *self, PyObject *Py_UNUSED(args)) {
+  return Profiler::stop();
+}
+
+static PyObject *callMany(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"", "", "chunk", NULL};
+  PyObject *func;
+  PyObject *iterable;
+  Py_ssize_t chunk = 1024;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|$n:callMany", (char **)kwlist, &func, &iterable, &chunk)) {
+    return NULL;
+  }
+  if (chunk < 1) {
+    PyErr_SetString(PyExc_ValueError, "callMany() chunk must be at least 1");
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return JSFunctionProxyMethodDefinitions::callMany(GLOBAL_CX, func, iterable, chunk);
+}
+
+static PyObject *compileWasm(PyObject *self, PyObject *binary) {
+  Py_buffer view;
+  if (PyObject_GetBuffer(binary, &view, PyBUF_SIMPLE) < 0) {
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    PyBuffer_Release(&view);
+    return NULL;
+  }
+  JS::RootedObject module(GLOBAL_CX, WasmModuleCache::compile(GLOBAL_CX, (const uint8_t *)view.buf, view.len));
+  PyBuffer_Release(&view);
+  if (!module) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  JS::RootedValue moduleValue(GLOBAL_CX, JS::ObjectValue(*module));
+  return pyTypeFactory(GLOBAL_CX, moduleValue);
+}
+
+static PyObject *prefork(PyObject *self, PyObject *Py_UNUSED(args)) {
+  if (!Prefork::prepare(GLOBAL_CX, JOB_QUEUE)) {
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
+static PyObject *stats(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"reset", NULL};
+  int reset = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **)kwlist, &reset)) {
+    return NULL;
+  }
+  PyObject *result = Metrics::toPython();
+  if (reset) {
+    Metrics::reset();
+  }
+  return result;
+}
+
+static PyObject *memoryStats(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"detailed", NULL};
+  int detailed = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **)kwlist, &detailed)) {
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return MemoryStats::toPython(GLOBAL_CX, detailed);
+}
+
+static PyObject *trackRetention(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"enabled", "stackSampleRate", NULL};
+  int enabled = 1;
+  double stackSampleRate = 0.0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|pd", (char **)kwlist, &enabled, &stackSampleRate)) {
+    return NULL;
+  }
+  if (stackSampleRate < 0.0 || stackSampleRate > 1.0) {
+    PyErr_SetString(PyExc_ValueError, "stackSampleRate must be between 0 and 1");
+    return NULL;
+  }
+  Retention::setTracking(enabled, stackSampleRate);
+  Py_RETURN_NONE;
+}
+
+static PyObject *retention(PyObject *self, PyObject *args) {
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return Retention::toPython();
+}
+
+#define JSON_WRITE_CHUNK_SIZE 65536 // bytes buffered before they are passed to the write callable of jsonStringify
+
+/**
+ * @brief Receives the UTF-16 output of JS_Stringify and encodes it to UTF-8, optionally streaming it to a Python callable
+ */
+struct JSONBytesWriter {
+  std::string utf8;
+  char16_t leadSurrogate = 0; // a surrogate pair may be split across two chunks
+  PyObject *write = NULL;
+
+  void append(char32_t c) {
+    if (c < 0x80) {
+      utf8.push_back((char)c);
+    } else if (c < 0x800) {
+      utf8.push_back((char)(0xC0 | (c >> 6)));
+      utf8.push_back((char)(0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+      utf8.push_back((char)(0xE0 | (c >> 12)));
+      utf8.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+      utf8.push_back((char)(0x80 | (c & 0x3F)));
+    } else {
+      utf8.push_back((char)(0xF0 | (c >> 18)));
+      utf8.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+      utf8.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+      utf8.push_back((char)(0x80 | (c & 0x3F)));
+    }
+  }
+
+  /**
+   * @brief Pass the buffered bytes to `write`, a lead surrogate at the end of the output so far is kept for the next call of the callback
+   */
+  bool flush() {
+    if (!write || utf8.empty()) {
+      return true;
+    }
+    PyObject *chunk = PyBytes_FromStringAndSize(utf8.data(), utf8.size());
+    if (!chunk) {
+      return false;
+    }
+    utf8.clear();
+    PyObject *result = PyObject_CallOneArg(write, chunk);
+    Py_DECREF(chunk);
+    Py_XDECREF(result);
+    return result != NULL;
+  }
+
+  /**
+   * @brief Flush the end of the output, where a dangling lead surrogate is unpaired
+   */
+  bool finish() {
+    if (leadSurrogate) {
+      append(0xFFFD);
+      leadSurrogate = 0;
+    }
+    return flush();
+  }
+
+  static bool callback(const char16_t *chars, uint32_t length, void *data) {
+    JSONBytesWriter *writer = (JSONBytesWriter *)data;
+    for (uint32_t index = 0; index < length; index++) {
+      char32_t c = chars[index];
+      if (writer->leadSurrogate) {
+        if (c >= 0xDC00 && c <= 0xDFFF) {
+          c = 0x10000 + ((writer->leadSurrogate - 0xD800) << 10) + (c - 0xDC00);
+        } else {
+          writer->append(0xFFFD);
+        }
+        writer->leadSurrogate = 0;
+      }
+      if (c >= 0xD800 && c <= 0xDBFF) {
+        writer->leadSurrogate = c;
+        continue;
+      }
+      writer->append(c >= 0xDC00 && c <= 0xDFFF ? 0xFFFD : c);
+      // JS_Stringify passes the whole output at once, so it is sliced here
+      if (writer->write && writer->utf8.size() >= JSON_WRITE_CHUNK_SIZE && !writer->flush()) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+static PyObject *jsonStringify(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static const char *kwlist[] = {"value", "indent", "write", NULL};
+  PyObject *value;
+  PyObject *indent = NULL;
+  PyObject *write = NULL;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OO:jsonStringify", (char **)kwlist, &value, &indent, &write)) {
+    return NULL;
+  }
+  if (write == Py_None) {
+    write = NULL;
+  }
+  if (write && !PyCallable_Check(write)) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.jsonStringify expects write to be callable");
+    return NULL;
+  }
+
+  JS::RootedValue jsValue(GLOBAL_CX, jsTypeFactory(GLOBAL_CX, value));
+  JS::RootedValue space(GLOBAL_CX);
+  if (indent && indent != Py_None) {
+    space.set(jsTypeFactory(GLOBAL_CX, indent));
+  }
+  if (PyErr_Occurred()) {
+    return NULL;
+  }
+
+  JSONBytesWriter writer;
+  writer.write = write;
+  if (!JS_Stringify(GLOBAL_CX, &jsValue, nullptr, space, JSONBytesWriter::callback, &writer)) {
+    if (!PyErr_Occurred()) {
+      setSpiderMonkeyException(GLOBAL_CX);
+    }
+    return NULL;
+  }
+  if (!writer.finish()) {
+    return NULL;
+  }
+  if (write) {
+    Py_RETURN_NONE;
+  }
+  if (writer.utf8.empty()) { // JSON.stringify returned undefined, e.g. for functions
+    Py_RETURN_NONE;
+  }
+  return PyBytes_FromStringAndSize(writer.utf8.data(), writer.utf8.size());
+}
+
+static PyObject *utf8(PyObject *self, PyObject *string) {
+  if (!PyUnicode_Check(string)) {
+    PyErr_SetString(PyExc_TypeError, "pythonmonkey.utf8 expects a str");
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  return StrType::toUTF8(GLOBAL_CX, string);
+}
+
+static PyObject *writeUtf8(PyObject *self, PyObject *args) {
+  PyObject *string, *target;
+  if (!PyArg_ParseTuple(args, "UO:writeUtf8", &string, &target)) {
+    return NULL;
+  }
+  if (!ContextOwner::check()) {
+    return NULL;
+  }
+  Py_ssize_t written = StrType::writeUTF8(GLOBAL_CX, string, target);
+  return written < 0 ? NULL : PyLong_FromSsize_t(written);
+}
+
+static PyObject *jsonParse(PyObject *self, PyObject *data) {
+  Py_buffer view;
+  if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0) {
+    return NULL;
+  }
+  if (view.len > UINT32_MAX) {
+    PyBuffer_Release(&view);
+    PyErr_SetString(PyExc_ValueError, "pythonmonkey.jsonParse input is too large");
+    return NULL;
+  }
+
+  const JS::Latin1Char *chars = (const JS::Latin1Char *)view.buf;
+  bool isAscii = true;
+  for (Py_ssize_t index = 0; index < view.len && isAscii; index++) {
+    isAscii = chars[index] < 0x80;
+  }
+
+  JS::RootedValue rval(GLOBAL_CX);
+  bool ok;
+  if (isAscii) { // ASCII is Latin-1, so the buffer is parsed in place
+    ok = JS_ParseJSON(GLOBAL_CX, chars, (uint32_t)view.len, &rval);
+  } else {
+    JS::RootedString string(GLOBAL_CX, JS_NewStringCopyUTF8N(GLOBAL_CX, JS::UTF8Chars((const char *)view.buf, view.len)));
+    ok = string && JS_ParseJSON(GLOBAL_CX, string, &rval);
+  }
+  PyBuffer_Release(&view);
+  if (!ok) {
+    setSpiderMonkeyException(GLOBAL_CX);
+    return NULL;
+  }
+  return pyTypeFactory(GLOBAL_CX, rval);
+}
+
+PyMethodDef PythonMonkeyMethods[] = {
+  {"eval", eval, METH_VARARGS, "Javascript evaluator in Python"},
+  {"compile", compile, METH_VARARGS, "Compile Javascript code once into a JSScript that can be run many times"},
+  {"compileAsync", compileAsync, METH_VARARGS, "Compile Javascript code off the event-loop thread, returns an awaitable of the JSScript"},
+  {"compileWasm", compileWasm, METH_O, "Compile a WebAssembly binary into a WebAssembly.Module, reusing the code compiled recently from the same bytes"},
+  {"importModule", importModule, METH_VARARGS, "Load and evaluate the ES module of a file, and return its namespace"},
+  {"wait", waitForEventLoop, METH_NOARGS, "The event-loop shield. Blocks until all asynchronous jobs finish."},
+  {"stop", closeAllPending, METH_NOARGS, "Cancel all pending event-loop jobs."},
+  {"stats", (PyCFunction)stats, METH_VARARGS | METH_KEYWORDS, "Get the counters and latency histograms of the event-loop and job queue bridge"},
+  {"memoryStats", (PyCFunction)memoryStats, METH_VARARGS | METH_KEYWORDS, "Get the memory used by the JS heap and held across the Python <-> JS bridge"},
+  {"trackRetention", (PyCFunction)trackRetention, METH_VARARGS | METH_KEYWORDS, "Start or stop recording the references across the Python <-> JS bridge, with sampled allocation stacks"},
+  {"retention", retention, METH_NOARGS, "List the recorded references across the Python <-> JS bridge by holder and type, with their sizes"},
+  {"runSync", runSync, METH_VARARGS, "Call a JS async function and drain its promise jobs synchronously, without going through the event-loop unless timers or I/O are pending"},
+  {"callMany", (PyCFunction)callMany, METH_VARARGS | METH_KEYWORDS, "Call a JS function once per item of an iterable, converting the items and results in chunks, and return the list of the results"},
+  {"isCompilableUnit", isCompilableUnit, METH_VARARGS, "Hint if a string might be compilable Javascript"},
+  {"collect", (PyCFunction)collect, METH_VARARGS | METH_KEYWORDS, "Calls the Spidermonkey garbage collector"},
+  {"gcSlice", gcSlice, METH_VARARGS, "Run one slice of an incremental garbage collection, starting one if needed"},
+  {"setGCParameter", setGCParameter, METH_VARARGS, "Set a tuning parameter of the Spidermonkey garbage collector"},
+  {"getGCParameter", getGCParameter, METH_VARARGS, "Get a tuning parameter or statistic of the Spidermonkey garbage collector"},
+  {"setEngineOptions", (PyCFunction)setEngineOptions, METH_VARARGS | METH_KEYWORDS, "Set the JIT tiers and warm-up thresholds of Spidermonkey"},
+  {"getEngineOptions", getEngineOptions, METH_NOARGS, "Get the JIT tiers and warm-up thresholds of Spidermonkey"},
+  {"setLazyStringNormalization", setLazyStringNormalization, METH_VARARGS, "Defer the UCS4 conversion of JS strings containing surrogate pairs until str() is called"},
+  {"setReleaseGIL", setReleaseGIL, METH_VARARGS, "Let the other Python threads run at regular intervals while JS code runs"},
+  {"setCollectCrossHeapCycles", setCollectCrossHeapCycles, METH_VARARGS, "Scan the JS heap before each full Python collection, to collect the reference cycles spanning both heaps"},
+  {"setStencilCache", (PyCFunction)setStencilCache, METH_VARARGS | METH_KEYWORDS, "Configure the in-memory and on-disk caches of the scripts compiled by eval"},
+  {"setRequireCache", setRequireCache, METH_VARARGS, "Load the cache of the module lookups of require and import from a file, and save it there at exit"},
+  {"setCopyStridedBuffers", setCopyStridedBuffers, METH_VARARGS, "Copy Python buffers that are not C-contiguous into new TypedArrays instead of raising"},
+  {"setCopyImmutableBuffers", setCopyImmutableBuffers, METH_VARARGS, "Copy immutable Python buffers such as bytes into new TypedArrays instead of proxying them"},
+  {"setIteratorBatchSize", setIteratorBatchSize, METH_VARARGS, "Pull this many items of a Python iterator per native call when JS iterates it"},
+  {"setNumbersAsInt", setNumbersAsInt, METH_VARARGS, "Convert int32 (and optionally all safe integral) JS numbers to Python ints instead of floats"},
+  {"setDatesAsTimestamps", setDatesAsTimestamps, METH_VARARGS, "Convert JS Dates to float timestamps in seconds instead of datetimes"},
+  {"setKeywordArgumentsAsOptions", setKeywordArgumentsAsOptions, METH_VARARGS, "Pass the keyword arguments of calls to JS functions as a trailing options object"},
+  {"toPython", toPython, METH_O, "Deep-copy a JS value into plain Python dicts, lists and primitives"},
+  {"arrayFromBuffer", arrayFromBuffer, METH_O, "Unpack the numbers of a 1-dimensional buffer into a new JS Array"},
+  {"toJS", toJS, METH_O, "Deep-copy a Python value into plain JS objects, arrays and primitives"},
+  {"jsonStringify", (PyCFunction)jsonStringify, METH_VARARGS | METH_KEYWORDS, "JSON.stringify a value into UTF-8 bytes, without creating a JS or Python string"},
+  {"jsonParse", jsonParse, METH_O, "JSON.parse UTF-8 bytes, without creating a Python string"},
+  {"utf8", utf8, METH_O, "Encode a string to UTF-8 bytes, straight from the chars of a JS string"},
+  {"writeUtf8", writeUtf8, METH_VARARGS, "Encode a string to UTF-8 into a writable buffer or through a write method, returning the number of bytes"},
+  {"startProfiler", startProfiler, METH_VARARGS, "Start sampling the JS stacks at an interval in seconds, see pythonmonkey.profiler"},
+  {"stopProfiler", stopProfiler, METH_NOARGS, "Stop sampling the JS stacks and return the profile in the .cpuprofile JSON format"},
+  {"prefork", prefork, METH_NOARGS, "Get the runtime ready to fork worker processes sharing its warmed-up heaps"},
+  {"serialize", serialize, METH_O, "Serialize a value into bytes with the structured clone algorithm"},
+  {"deserialize", deserialize, METH_O, "Rebuild a value from the bytes made by serialize"},
+  {NULL, NULL, 0, NULL}
+};
+
+struct PyModuleDef pythonmonkey =
+{
+  PyModuleDef_HEAD_INIT,
+  "pythonmonkey",                                   /* name of module */
+  "A module for python to JS interoperability",   /* module documentation, may be NULL */
+  -1,                                           /* size of per-interpreter state of the module, or -1 if the module keeps state in global variables. */
+  PythonMonkeyMethods
+};
+
+PyObject *SpiderMonkeyError = NULL;
+
+static JSClass globalClass = {"global", JSCLASS_GLOBAL_FLAGS, &JS::DefaultGlobalClassOps};
+
+static JS::RealmOptions globalRealmOptions() {
+  JS::RealmCreationOptions creationOptions = JS::RealmCreationOptions();
+  creationOptions.setSharedMemoryAndAtomicsEnabled(true); // SharedArrayBuffer and Atomics, exposed to Python as memoryviews of the shared memory
+  JS::RealmBehaviors behaviours = JS::RealmBehaviors();
+  return JS::RealmOptions(creationOptions, behaviours);
+}
+
+/**
+ * @brief The getter of `globalThis.debuggerGlobal`: the global of the Debugger API (used by pmdb) is created on first use,
+ * then replaces the getter
+ */
+static bool getDebuggerGlobal(JSContext *cx, unsigned argc, JS::Value *vp) {
+  JS::CallArgs args = JS::CallArgsFromVp(argc, vp);
+  JS::RootedObject debuggerGlobal(cx, JS_NewGlobalObject(cx, &globalClass, nullptr, JS::FireOnNewGlobalHook, globalRealmOptions()));
+  if (!debuggerGlobal) {
+    return false;
+  }
+  {
+    JSAutoRealm r(cx, debuggerGlobal);
+    if (!JS_DefineDebuggerObject(cx, debuggerGlobal)) {
+      return false;
+    }
+  }
+  JS::RootedValue debuggerGlobalValue(cx, JS::ObjectValue(*debuggerGlobal));
+  if (!JS_WrapValue(cx, &debuggerGlobalValue) || !JS_DefineProperty(cx, *global, "debuggerGlobal", debuggerGlobalValue, 0)) {
+    return false;
+  }
+  args.rval().set(debuggerGlobalValue);
+  return true;
+}
+
+PyMODINIT_FUNC PyInit_pythonmonkey(void)
+{
+  if (!PyDateTimeAPI) { PyDateTime_IMPORT; }
+
+  SpiderMonkeyError = ExceptionType::newSpiderMonkeyErrorType();
+  if (!SpiderMonkeyError) {
+    return NULL;
+  }
+  EngineOptions::initProcess();
+  if (!JS_Init()) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not be initialized.");
+    return NULL;
+  }
+  if (!HelperThreads::init()) {
+    return NULL;
+  }
+
+  GLOBAL_CX = JS_NewContext(JS::DefaultHeapMaxBytes);
+  if (!GLOBAL_CX) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create a JS context.");
     return NULL;
   }
 
@@ -577,13 +1726,34 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
   .setAsyncStack(true)
   .setSourcePragmas(true);
 
+  if (!EngineOptions::init(GLOBAL_CX)) {
+    return NULL;
+  }
+
+  ContextOwner::init();
+
   JOB_QUEUE = new JobQueue(GLOBAL_CX);
   if (!JOB_QUEUE->init(GLOBAL_CX)) {
     PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create the event-loop.");
     return NULL;
   }
 
-  if (!JS::InitSelfHostedCode(GLOBAL_CX)) {
+  if (!GILSwitch::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not register the interrupt callback.");
+    return NULL;
+  }
+
+  if (!Watchdog::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not register the watchdog interrupt callback.");
+    return NULL;
+  }
+
+  if (!StencilCache::init()) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create the stencil cache.");
+    return NULL;
+  }
+
+  if (!StencilCache::initSelfHostedCode(GLOBAL_CX)) {
     PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not initialize self-hosted code.");
     return NULL;
   }
@@ -593,32 +1763,62 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
   JS_SetGCCallback(GLOBAL_CX, pythonmonkeyGCCallback, NULL);
   JS::AddGCNurseryCollectionCallback(GLOBAL_CX, nurseryCollectionCallback, NULL);
 
-  JS::RealmCreationOptions creationOptions = JS::RealmCreationOptions();
-  JS::RealmBehaviors behaviours = JS::RealmBehaviors();
-  JS::RealmOptions options = JS::RealmOptions(creationOptions, behaviours);
-  static JSClass globalClass = {"global", JSCLASS_GLOBAL_FLAGS, &JS::DefaultGlobalClassOps};
-  global = new JS::RootedObject(GLOBAL_CX, JS_NewGlobalObject(GLOBAL_CX, &globalClass, nullptr, JS::FireOnNewGlobalHook, options));
+  global = new JS::RootedObject(GLOBAL_CX, JS_NewGlobalObject(GLOBAL_CX, &globalClass, nullptr, JS::FireOnNewGlobalHook, globalRealmOptions()));
   if (!global) {
     PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create a global object.");
     return NULL;
   }
 
-  JS::RootedObject debuggerGlobal(GLOBAL_CX, JS_NewGlobalObject(GLOBAL_CX, &globalClass, nullptr, JS::FireOnNewGlobalHook, options));
-  {
-    JSAutoRealm r(GLOBAL_CX, debuggerGlobal);
-    JS_DefineDebuggerObject(GLOBAL_CX, debuggerGlobal);
-  }
   {
     JSAutoRealm r(GLOBAL_CX, *global);
-    JS::Rooted<JS::PropertyDescriptor> desc(GLOBAL_CX, JS::PropertyDescriptor::Data(
-      JS::ObjectValue(*debuggerGlobal)
-    ));
-    JS_WrapPropertyDescriptor(GLOBAL_CX, &desc);
-    JS_DefineUCProperty(GLOBAL_CX, *global, u"debuggerGlobal", 14, desc);
+    if (!JS_DefineProperty(GLOBAL_CX, *global, "debuggerGlobal", getDebuggerGlobal, nullptr, 0)) {
+      PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not define the debugger global.");
+      return NULL;
+    }
   }
 
   autoRealm = new JSAutoRealm(GLOBAL_CX, *global);
 
+  if (!ProxyCache::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create the proxy caches.");
+    return NULL;
+  }
+
+  if (!CrossHeap::init(GLOBAL_CX)) {
+    return NULL;
+  }
+
+  Retention::init();
+
+  if (!ConsoleSink::init()) {
+    return NULL;
+  }
+
+  if (!AtomCache::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create the property key cache.");
+    return NULL;
+  }
+
+  if (!PromiseType::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not create the table of pending promises.");
+    return NULL;
+  }
+
+  if (!ModuleLoader::init(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not install the module loader.");
+    return NULL;
+  }
+
+  if (!InternalBinding::initUrl(GLOBAL_CX)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not capture the String methods of the URL parser.");
+    return NULL;
+  }
+
+  if (!JSONStringify::init(GLOBAL_CX, *global)) {
+    PyErr_SetString(SpiderMonkeyError, "Spidermonkey could not install the JSON.stringify of the Python dicts and lists.");
+    return NULL;
+  }
+
   // XXX: SpiderMonkey bug???
   // In https://hg.mozilla.org/releases/mozilla-esr102/file/3b574e1/js/src/jit/CacheIR.cpp#l317, trying to use the callback returned by `js::GetDOMProxyShadowsCheck()` even it's unset (nullptr)
   // Temporarily solved by explicitly setting the `domProxyShadowsCheck` callback here
@@ -633,6 +1833,16 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   if (PyType_Ready(&JSObjectProxyType) < 0)
     return NULL;
+  if (PyType_Ready(&JSIterableProxyType) < 0)
+    return NULL;
+  if (PyType_Ready(&JSIteratorProxyType) < 0)
+    return NULL;
+  if (PyType_Ready(&JSWasmMemoryProxyType) < 0)
+    return NULL;
+  if (PyType_Ready(&JSMapProxyType) < 0)
+    return NULL;
+  if (PyType_Ready(&JSSetProxyType) < 0)
+    return NULL;
   if (PyType_Ready(&JSStringProxyType) < 0)
     return NULL;
   if (PyType_Ready(&JSFunctionProxyType) < 0)
@@ -643,6 +1853,8 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   if (PyType_Ready(&JSArrayIterProxyType) < 0)
     return NULL;
+  if (PyType_Ready(&JSBufferExporterType) < 0)
+    return NULL;
   if (PyType_Ready(&JSObjectIterProxyType) < 0)
     return NULL;
   if (PyType_Ready(&JSObjectKeysProxyType) < 0)
@@ -651,10 +1863,16 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   if (PyType_Ready(&JSObjectItemsProxyType) < 0)
     return NULL;
+  if (PyType_Ready(&JSWorkerType) < 0)
+    return NULL;
+  if (PyType_Ready(&JSScriptHandleType) < 0)
+    return NULL;
 
   PyObject *pyModule = PyModule_Create(&pythonmonkey);
   if (pyModule == NULL)
     return NULL;
+  // not declared Py_MOD_GIL_NOT_USED: the registries of proxies and strings have no locking of their own,
+  // so free-threaded builds enable the GIL again when the module is imported, and the ContextOwner then lets any thread use the JS context
 
   // Clean up SpiderMonkey when the PythonMonkey module gets destroyed (module.___cleanup is GCed)
   // The `cleanup` function will be called automatically when this PyCapsule gets GCed
@@ -722,6 +1940,41 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   }
 
+  Py_INCREF(&JSIterableProxyType);
+  if (PyModule_AddObject(pyModule, "JSIterableProxy", (PyObject *)&JSIterableProxyType) < 0) {
+    Py_DECREF(&JSIterableProxyType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
+  Py_INCREF(&JSIteratorProxyType);
+  if (PyModule_AddObject(pyModule, "JSIteratorProxy", (PyObject *)&JSIteratorProxyType) < 0) {
+    Py_DECREF(&JSIteratorProxyType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
+  Py_INCREF(&JSWasmMemoryProxyType);
+  if (PyModule_AddObject(pyModule, "JSWasmMemoryProxy", (PyObject *)&JSWasmMemoryProxyType) < 0) {
+    Py_DECREF(&JSWasmMemoryProxyType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
+  Py_INCREF(&JSMapProxyType);
+  if (PyModule_AddObject(pyModule, "JSMapProxy", (PyObject *)&JSMapProxyType) < 0) {
+    Py_DECREF(&JSMapProxyType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
+  Py_INCREF(&JSSetProxyType);
+  if (PyModule_AddObject(pyModule, "JSSetProxy", (PyObject *)&JSSetProxyType) < 0) {
+    Py_DECREF(&JSSetProxyType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
   Py_INCREF(&JSObjectIterProxyType);
   if (PyModule_AddObject(pyModule, "JSObjectIterProxy", (PyObject *)&JSObjectIterProxyType) < 0) {
     Py_DECREF(&JSObjectIterProxyType);
@@ -750,6 +2003,20 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   }
 
+  Py_INCREF(&JSWorkerType);
+  if (PyModule_AddObject(pyModule, "Worker", (PyObject *)&JSWorkerType) < 0) {
+    Py_DECREF(&JSWorkerType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
+  Py_INCREF(&JSScriptHandleType);
+  if (PyModule_AddObject(pyModule, "JSScript", (PyObject *)&JSScriptHandleType) < 0) {
+    Py_DECREF(&JSScriptHandleType);
+    Py_DECREF(pyModule);
+    return NULL;
+  }
+
   if (PyModule_AddObject(pyModule, "SpiderMonkeyError", SpiderMonkeyError) < 0) {
     Py_DECREF(pyModule);
     return NULL;
@@ -765,23 +2032,12 @@ PyMODINIT_FUNC PyInit_pythonmonkey(void)
     return NULL;
   }
 
-  // initialize FinalizationRegistry of JSFunctions to Python Functions
-  JS::RootedValue FinalizationRegistry(GLOBAL_CX);
-  JS::RootedObject registryObject(GLOBAL_CX);
+  JS::SetHostCleanupFinalizationRegistryCallback(GLOBAL_CX, cleanupFinalizationRegistry, NULL);
 
-  JS_GetProperty(GLOBAL_CX, *global, "FinalizationRegistry", &FinalizationRegistry);
-  JS::Rooted<JS::ValueArray<1>> args(GLOBAL_CX);
-  JSFunction *registryCallback = JS_NewFunction(GLOBAL_CX, functionRegistryCallback, 1, 0, NULL);
-  JS::RootedObject registryCallbackObject(GLOBAL_CX, JS_GetFunctionObject(registryCallback));
-  args[0].setObject(*registryCallbackObject);
-  if (!JS::Construct(GLOBAL_CX, FinalizationRegistry, args, &registryObject)) {
-    setSpiderMonkeyException(GLOBAL_CX);
+  if (!Prefork::init()) {
+    Py_DECREF(pyModule);
     return NULL;
   }
-  jsFunctionRegistry.init(GLOBAL_CX);
-  jsFunctionRegistry.set(registryObject);
-
-  JS::SetHostCleanupFinalizationRegistryCallback(GLOBAL_CX, cleanupFinalizationRegistry, NULL);
 
   return pyModule;
 }
\ No newline at end of file
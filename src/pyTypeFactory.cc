@@ -17,17 +17,24 @@
 #include "include/ExceptionType.hh"
 #include "include/FloatType.hh"
 #include "include/FuncType.hh"
+#include "include/HotPathStats.hh"
 #include "include/IntType.hh"
+#include "include/JSIteratorProxy.hh"
+#include "include/JSWasmMemoryProxy.hh"
+#include "include/JSMapProxy.hh"
+#include "include/JSSetProxy.hh"
 #include "include/jsTypeFactory.hh"
 #include "include/ListType.hh"
 #include "include/NoneType.hh"
 #include "include/NullType.hh"
 #include "include/PromiseType.hh"
+#include "include/Profiler.hh"
 #include "include/PyDictProxyHandler.hh"
 #include "include/PyListProxyHandler.hh"
 #include "include/PyObjectProxyHandler.hh"
 #include "include/PyIterableProxyHandler.hh"
 #include "include/PyBytesProxyHandler.hh"
+#include "include/PyMapProxyHandler.hh"
 #include "include/setSpiderMonkeyException.hh"
 #include "include/StrType.hh"
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
@@ -38,27 +45,35 @@
 #include <js/ValueArray.h>
 
 PyObject *pyTypeFactory(JSContext *cx, JS::HandleValue rval) {
+  ProfilerLabel profilerLabel("pyTypeFactory");
   std::string errorString;
 
   if (rval.isUndefined()) {
+    PYTHONMONKEY_HOT_PATH(toPython, undefined);
     return NoneType::getPyObject();
   }
   else if (rval.isNull()) {
+    PYTHONMONKEY_HOT_PATH(toPython, null);
     return NullType::getPyObject();
   }
   else if (rval.isBoolean()) {
+    PYTHONMONKEY_HOT_PATH(toPython, boolean);
     return BoolType::getPyObject(rval.toBoolean());
   }
   else if (rval.isNumber()) {
-    return FloatType::getPyObject(rval.toNumber());
+    PYTHONMONKEY_HOT_PATH(toPython, number);
+    return FloatType::getPyObject(rval.get());
   }
   else if (rval.isString()) {
+    PYTHONMONKEY_HOT_PATH(toPython, string);
     return StrType::getPyObject(cx, rval);
   }
   else if (rval.isSymbol()) {
+    PYTHONMONKEY_HOT_PATH(toPython, symbol);
     errorString = "symbol type is not handled by PythonMonkey yet.\n";
   }
   else if (rval.isBigInt()) {
+    PYTHONMONKEY_HOT_PATH(toPython, bigint);
     return IntType::getPyObject(cx, rval.toBigInt());
   }
   else if (rval.isObject()) {
@@ -69,9 +84,11 @@ PyObject *pyTypeFactory(JSContext *cx, JS::HandleValue rval) {
       if (js::GetProxyHandler(obj)->family() == &PyDictProxyHandler::family ||                // this is one of our proxies for python dicts
           js::GetProxyHandler(obj)->family() == &PyListProxyHandler::family ||                // this is one of our proxies for python lists
           js::GetProxyHandler(obj)->family() == &PyIterableProxyHandler::family ||            // this is one of our proxies for python iterables
+          js::GetProxyHandler(obj)->family() == &PyMapProxyHandler::family ||                 // this is one of our proxies for python dicts without str keys
           js::GetProxyHandler(obj)->family() == &PyObjectProxyHandler::family ||              // this is one of our proxies for python iterables
           js::GetProxyHandler(obj)->family() == &PyBytesProxyHandler::family) {               // this is one of our proxies for python bytes objects
 
+        PYTHONMONKEY_HOT_PATH(toPython, pythonProxy);
         PyObject *pyObject = JS::GetMaybePtrFromReservedSlot<PyObject>(obj, PyObjectSlot);
         Py_INCREF(pyObject);
         return pyObject;
@@ -90,34 +107,69 @@ PyObject *pyTypeFactory(JSContext *cx, JS::HandleValue rval) {
     case js::ESClass::Boolean:
     case js::ESClass::Number:
     case js::ESClass::BigInt:
-    case js::ESClass::String:
-      js::Unbox(cx, obj, &unboxed);
-      return pyTypeFactory(cx, unboxed);
-    case js::ESClass::Date:
-      return DateType::getPyObject(cx, obj);
-    case js::ESClass::Promise:
-      return PromiseType::getPyObject(cx, obj);
-    case js::ESClass::Error:
-      return ExceptionType::getPyObject(cx, obj);
+    case js::ESClass::String: {
+        PYTHONMONKEY_HOT_PATH(toPython, boxed);
+        js::Unbox(cx, obj, &unboxed);
+        return pyTypeFactory(cx, unboxed);
+      }
+    case js::ESClass::Date: {
+        PYTHONMONKEY_HOT_PATH(toPython, Date);
+        return DateType::getPyObject(cx, obj);
+      }
+    case js::ESClass::Promise: {
+        PYTHONMONKEY_HOT_PATH(toPython, Promise);
+        return PromiseType::getPyObject(cx, obj);
+      }
+    case js::ESClass::Error: {
+        PYTHONMONKEY_HOT_PATH(toPython, Error);
+        return ExceptionType::getPyObject(cx, obj);
+      }
     case js::ESClass::Function: {
         if (JS_IsNativeFunction(obj, callPyFunc)) { // It's a wrapped python function by us
+          PYTHONMONKEY_HOT_PATH(toPython, pythonFunction);
           // Get the underlying python function from the 0th reserved slot
           JS::Value pyFuncVal = js::GetFunctionNativeReserved(obj, 0);
           PyObject *pyFunc = (PyObject *)(pyFuncVal.toPrivate());
           Py_INCREF(pyFunc);
           return pyFunc;
         } else {
+          PYTHONMONKEY_HOT_PATH(toPython, function);
           return FuncType::getPyObject(cx, rval);
         }
       }
-    case js::ESClass::Array:
-      return ListType::getPyObject(cx, obj);
+    case js::ESClass::Array: {
+        PYTHONMONKEY_HOT_PATH(toPython, Array);
+        return ListType::getPyObject(cx, obj);
+      }
+    case js::ESClass::Map: {
+        PYTHONMONKEY_HOT_PATH(toPython, Map);
+        return JSMapProxyMethodDefinitions::getPyObject(cx, obj);
+      }
+    case js::ESClass::Set: {
+        PYTHONMONKEY_HOT_PATH(toPython, Set);
+        return JSSetProxyMethodDefinitions::getPyObject(cx, obj);
+      }
     default:
+      if (JSWasmMemoryProxyMethodDefinitions::isWasmMemory(obj)) {
+        PYTHONMONKEY_HOT_PATH(toPython, wasmMemory);
+        return JSWasmMemoryProxyMethodDefinitions::getPyObject(cx, obj);
+      }
       if (BufferType::isSupportedJsTypes(obj)) { // TypedArray or ArrayBuffer
         // TODO (Tom Tang): ArrayBuffers have cls == js::ESClass::ArrayBuffer
+        PYTHONMONKEY_HOT_PATH(toPython, buffer);
         return BufferType::getPyObject(cx, obj);
       }
+      bool iterable, async, iterator;
+      if (!JSIteratorProxyMethodDefinitions::isIterable(cx, obj, &iterable, &async, &iterator)) {
+        setSpiderMonkeyException(cx);
+        return NULL;
+      }
+      if (iterable) { // generators, builtin iterators and the objects with their own [Symbol.iterator]
+        PYTHONMONKEY_HOT_PATH(toPython, iterable);
+        return JSIteratorProxyMethodDefinitions::getPyObject(cx, obj, async, iterator);
+      }
     }
+    PYTHONMONKEY_HOT_PATH(toPython, object);
     return DictType::getPyObject(cx, rval);
   }
   else if (rval.isMagic()) {
@@ -10,8 +10,8 @@
 
 #include "include/modules/pythonmonkey/pythonmonkey.hh"
 #include "include/setSpiderMonkeyException.hh"
+#include "include/ExceptionType.hh"
 #include "include/StrType.hh"
-#include "include/DictType.hh"
 
 #include <jsapi.h>
 #include <Python.h>
@@ -38,7 +38,7 @@ PyObject *getExceptionString(JSContext *cx, const JS::ExceptionStack &exceptionS
   std::stringstream outStrStream;
 
   JSErrorReport *errorReport = reportBuilder.report();
-  if (errorReport && !!errorReport->filename) { // `errorReport->filename` (the source file name) can be null
+  if (errorReport && !!errorReport->filename && *errorReport->filename.c_str()) { // `errorReport->filename` (the source file name) can be null or empty
     std::string offsetSpaces(errorReport->tokenOffset(), ' '); // number of spaces equal to tokenOffset
     std::string linebuf; // the offending JS line of code (can be empty)
 
@@ -59,7 +59,18 @@ PyObject *getExceptionString(JSContext *cx, const JS::ExceptionStack &exceptionS
   }
 
   // print out the SpiderMonkey error message
-  outStrStream << reportBuilder.toStringResult().c_str() << "\n";
+  // the report of an Error converted from a Python exception has no message, as it is only formatted when the `message` property is read
+  JS::RootedValue exn(cx, exceptionStack.exception());
+  JS::RootedObject exnObj(cx, exn.isObject() ? &exn.toObject() : nullptr);
+  JS::UniqueChars lazyMessage;
+  if (exnObj && ExceptionType::hasLazyMessage(cx, exnObj)) {
+    JS::RootedString exnStr(cx, JS::ToString(cx, exn));
+    if (exnStr) {
+      lazyMessage = JS_EncodeStringToUTF8(cx, exnStr);
+    }
+    JS_ClearPendingException(cx);
+  }
+  outStrStream << (lazyMessage ? lazyMessage.get() : reportBuilder.toStringResult().c_str()) << "\n";
 
   if (printStack) {
     JS::RootedObject stackObj(cx, exceptionStack.stack());
@@ -88,32 +99,13 @@ void setSpiderMonkeyException(JSContext *cx) {
     return;
   }
 
-  // check if it is a Python Exception and already has a stack trace
-  bool printStack = true;
-
-  JS::RootedValue exn(cx);
-  if (JS_GetPendingException(cx, &exn)) {
-    if (exn.isObject()) {
-      JS::RootedObject exnObj(cx, &exn.toObject());
-      JS::RootedValue tmp(cx);
-      if (JS_GetProperty(cx, exnObj, "message", &tmp) && tmp.isString()) {
-        JS::RootedString rootedStr(cx, tmp.toString());
-        printStack = strstr(JS_EncodeStringToUTF8(cx, rootedStr).get(), "JS Stack Trace") == NULL;
-      }
-    }
-  }
-
   JS_ClearPendingException(cx);
 
-  // `PyErr_SetString` uses `PyErr_SetObject` with `PyUnicode_FromString` under the hood
-  //    see https://github.com/python/cpython/blob/3.9/Python/errors.c#L234-L236
-  PyObject *errStr = getExceptionString(cx, exceptionStack, printStack);
-  PyObject *errObj = PyObject_CallFunction(SpiderMonkeyError, "O", errStr); // errObj = SpiderMonkeyError(errStr)
-  Py_XDECREF(errStr);
-  // Preserve the original JS value as the `jsError` attribute for lossless back conversion
-  PyObject *originalJsErrCapsule = DictType::getPyObject(cx, exn);
-  PyObject_SetAttrString(errObj, "jsError", originalJsErrCapsule);
-  Py_XDECREF(originalJsErrCapsule);
+  // the message is only formatted, and the JS stack only checked for, when the Python exception is printed or converted to a string
+  PyObject *errObj = ExceptionType::newSpiderMonkeyError(cx, exceptionStack, true);
+  if (!errObj) {
+    return;
+  }
   // `PyErr_SetObject` can accept either an already created Exception instance or the containing exception value as the second argument
   //  see https://github.com/python/cpython/blob/v3.9.16/Python/errors.c#L134-L150
   PyErr_SetObject(SpiderMonkeyError, errObj);
@@ -0,0 +1,515 @@
+#! /usr/bin/env python3
+# @file         bench_conversions.py
+#               Micro-benchmarks of the hot paths of the bridge: the conversions of each type at several sizes in
+#               both directions, the call overhead from Python to JS and from JS to Python, the proxy getters and
+#               methods, the iteration of the proxies, and the throughput of the promise bridge, the jobs and the
+#               timers of the event loop. With pyperf installed, this is a pyperf script; without it, a simple
+#               timer runs each benchmark in this process. Run it once per build and compare the results, e.g.
+#                 python tests/bench/bench_conversions.py -o old.json            # then switch builds
+#                 python tests/bench/bench_conversions.py -o new.json
+#                 python tests/bench/bench_conversions.py --compare old.json new.json
+#                 python tests/bench/bench_conversions.py --filter 'call/*' --fast
+#               The files are in the pyperf format when pyperf is used, so `python -m pyperf compare_to old.json
+#               new.json` works as well, and `--python=other/venv/bin/python` benchmarks another installation.
+# @author       agent, agent@local
+# @date         October 2026
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import argparse
+import asyncio
+import fnmatch
+import json
+import os
+import statistics
+import sys
+import time
+
+try:
+  import pyperf
+except ImportError:
+  pyperf = None
+
+import pythonmonkey as pm
+
+SIZES = (1, 100, 10000)
+BENCHMARKS = {}
+
+
+def benchmark(name):
+  """Register a setup function, which prepares its values and returns the timed function: f(loops) -> seconds"""
+  def register(setup):
+    BENCHMARKS[name] = setup
+    return setup
+  return register
+
+
+def timed(fn):
+  """The timed function of a function called with no arguments"""
+  def run(loops):
+    start = time.perf_counter()
+    for _ in range(loops):
+      fn()
+    return time.perf_counter() - start
+  return run
+
+
+def timedInJS(jsLoop, *args):
+  """The timed function of a JS function (loops, ...args) that loops itself, so that the Python loop is not measured"""
+  def run(loops):
+    start = time.perf_counter()
+    jsLoop(loops, *args)
+    return time.perf_counter() - start
+  return run
+
+
+def timedAsync(makeCoroutine):
+  """The timed function of a coroutine function (loops), awaited in a new event loop; only the coroutine is measured"""
+  async def measure(loops):
+    start = time.perf_counter()
+    await makeCoroutine(loops)
+    return time.perf_counter() - start
+
+  def run(loops):
+    return asyncio.run(measure(loops))
+  return run
+
+
+#
+# Conversions: the Python values are passed to a JS function that ignores them (jsTypeFactory), the JS values are
+# returned by a JS closure that keeps them (pyTypeFactory)
+#
+def pythonValues(size):
+  return {
+    'int': size,
+    'bigint': 2 ** 64 + size,
+    'float': size + 0.5,
+    'bool': True,
+    'None': None,
+    'str-ascii': 'x' * size,
+    'str-latin1': 'é' * size,
+    'str-ucs2': '€' * size,
+    'bytes': b'x' * size,
+    'bytearray': bytearray(size),
+    'list': list(range(size)),
+    'dict': {str(i): i for i in range(size)},
+    'function': lambda: None,
+  }
+
+
+JS_VALUES = {
+  'number': 'n',
+  'bigint': '2n ** 64n + BigInt(n)',
+  'float': 'n + 0.5',
+  'bool': 'true',
+  'undefined': 'undefined',
+  'null': 'null',
+  'str-ascii': '"x".repeat(n)',
+  'str-latin1': '"é".repeat(n)',
+  'str-ucs2': '"€".repeat(n)',
+  'Uint8Array': 'new Uint8Array(n)',
+  'Float64Array': 'new Float64Array(n)',
+  'Array': 'Array.from({ length: n }, (_, i) => i)',
+  'Object': 'Object.fromEntries(Array.from({ length: n }, (_, i) => [String(i), i]))',
+  'Date': 'new Date(n)',
+  'function': '() => n',
+  'Error': 'new Error("x".repeat(n))',
+}
+
+SIZED = ('str-ascii', 'str-latin1', 'str-ucs2', 'bytes', 'bytearray', 'list', 'dict', 'Uint8Array', 'Float64Array',
+         'Array', 'Object', 'Error')
+
+
+def registerConversions():
+  ignore = pm.eval('(function ignore(value) {})')
+  for typeName in pythonValues(1):
+    for size in (SIZES if typeName in SIZED else SIZES[:1]):
+      name = f'py-to-js/{typeName}' + (f'/{size}' if typeName in SIZED else '')
+      benchmark(name)(lambda typeName=typeName, size=size:
+                      timed(lambda value=pythonValues(size)[typeName]: ignore(value)))
+
+  for typeName, source in JS_VALUES.items():
+    for size in (SIZES if typeName in SIZED else SIZES[:1]):
+      name = f'js-to-py/{typeName}' + (f'/{size}' if typeName in SIZED else '')
+      benchmark(name)(lambda source=source, size=size:
+                      timed(pm.eval(f'(n) => {{ const value = {source}; return () => value; }}')(size)))
+
+
+registerConversions()
+
+
+#
+# Calls between Python and JS
+#
+@benchmark('call/py-to-js/no-args')
+def _():
+  return timed(pm.eval('(function f() {})'))
+
+
+@benchmark('call/py-to-js/3-args')
+def _():
+  f = pm.eval('(function f(a, b, c) { return a; })')
+  return timed(lambda: f(1, 'b', 3.0))
+
+
+@benchmark('call/py-to-js/method')
+def _():
+  obj = pm.eval('({ count: 0, increment() { return ++this.count; } })')
+  return timed(lambda: obj.increment())
+
+
+@benchmark('call/js-to-py/no-args')
+def _():
+  return timedInJS(pm.eval('(n, f) => { for (let i = 0; i < n; i++) f(); }'), lambda: None)
+
+
+@benchmark('call/js-to-py/3-args')
+def _():
+  return timedInJS(pm.eval('(n, f) => { for (let i = 0; i < n; i++) f(i, "b", 3.0); }'), lambda a, b, c: a)
+
+
+@benchmark('call/js-to-py/builtin')
+def _():
+  return timedInJS(pm.eval('(n, f) => { for (let i = 0; i < n; i++) f(i); }'), abs)
+
+
+#
+# The getters of the proxies of the JS objects in Python, and the methods of the proxies of the Python objects in JS
+#
+@benchmark('proxy/JSObjectProxy/getattr')
+def _():
+  obj = pm.eval('({ a: 1, b: "x", c: [] })')
+  return timed(lambda: obj.b)
+
+
+@benchmark('proxy/JSObjectProxy/getitem')
+def _():
+  obj = pm.eval('({ a: 1, b: "x", c: [] })')
+  return timed(lambda: obj['c'])
+
+
+@benchmark('proxy/JSObjectProxy/get-missing')
+def _():
+  obj = pm.eval('({ a: 1, b: "x", c: [] })')
+  return timed(lambda: obj.get('z'))
+
+
+@benchmark('proxy/JSObjectProxy/setitem')
+def _():
+  obj = pm.eval('({ a: 1 })')
+
+  def setItem():
+    obj['a'] = 2
+  return timed(setItem)
+
+
+@benchmark('proxy/JSArrayProxy/getitem')
+def _():
+  array = pm.eval('Array.from({ length: 100 }, (_, i) => i)')
+  return timed(lambda: array[50])
+
+
+@benchmark('proxy/JSArrayProxy/len')
+def _():
+  array = pm.eval('Array.from({ length: 100 }, (_, i) => i)')
+  return timed(lambda: len(array))
+
+
+@benchmark('proxy/PyObjectProxy/get')
+def _():
+  class Point:
+    def __init__(self):
+      self.x = 1
+  return timedInJS(pm.eval('(n, p) => { let x; for (let i = 0; i < n; i++) x = p.x; }'), Point())
+
+
+@benchmark('proxy/PyDictProxy/get')
+def _():
+  return timedInJS(pm.eval('(n, d) => { let x; for (let i = 0; i < n; i++) x = d.b; }'), {'a': 1, 'b': 'x'})
+
+
+@benchmark('proxy/PyDictProxy/set')
+def _():
+  return timedInJS(pm.eval('(n, d) => { for (let i = 0; i < n; i++) d.a = i; }'), {'a': 1})
+
+
+@benchmark('proxy/PyListProxy/index')
+def _():
+  return timedInJS(pm.eval('(n, l) => { let x; for (let i = 0; i < n; i++) x = l[50]; }'), list(range(100)))
+
+
+@benchmark('proxy/PyListProxy/length')
+def _():
+  return timedInJS(pm.eval('(n, l) => { let x; for (let i = 0; i < n; i++) x = l.length; }'), list(range(100)))
+
+
+@benchmark('proxy/PyListProxy/push-pop')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) { l.push(i); l.pop(); } }'), [])
+
+
+@benchmark('proxy/PyListProxy/indexOf')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) l.indexOf(99); }'), list(range(100)))
+
+
+@benchmark('proxy/PyListProxy/slice')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) l.slice(10, 20); }'), list(range(100)))
+
+
+@benchmark('proxy/PyListProxy/join')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) l.join(","); }'), [str(i) for i in range(100)])
+
+
+@benchmark('proxy/PyListProxy/map')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) l.map((x) => x + 1); }'), list(range(100)))
+
+
+#
+# Iteration of the proxies, 1000 items
+#
+@benchmark('iterate/JSArrayProxy/for')
+def _():
+  array = pm.eval('Array.from({ length: 1000 }, (_, i) => i)')
+
+  def iterate():
+    for _ in array:
+      pass
+  return timed(iterate)
+
+
+@benchmark('iterate/JSArrayProxy/list')
+def _():
+  array = pm.eval('Array.from({ length: 1000 }, (_, i) => i)')
+  return timed(lambda: list(array))
+
+
+@benchmark('iterate/JSObjectProxy/keys')
+def _():
+  obj = pm.eval('Object.fromEntries(Array.from({ length: 1000 }, (_, i) => ["k" + i, i]))')
+
+  def iterate():
+    for _ in obj:
+      pass
+  return timed(iterate)
+
+
+@benchmark('iterate/JSObjectProxy/items')
+def _():
+  obj = pm.eval('Object.fromEntries(Array.from({ length: 1000 }, (_, i) => ["k" + i, i]))')
+
+  def iterate():
+    for _ in obj.items():
+      pass
+  return timed(iterate)
+
+
+@benchmark('iterate/PyListProxy/for-of')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) for (const x of l); }'), list(range(1000)))
+
+
+@benchmark('iterate/PyListProxy/index')
+def _():
+  return timedInJS(pm.eval('(n, l) => { for (let i = 0; i < n; i++) for (let j = 0; j < l.length; j++) l[j]; }'),
+                   list(range(1000)))
+
+
+@benchmark('iterate/PyDictProxy/keys')
+def _():
+  return timedInJS(pm.eval('(n, d) => { for (let i = 0; i < n; i++) Object.keys(d); }'),
+                   {f'k{i}': i for i in range(1000)})
+
+
+@benchmark('iterate/PyDictProxy/for-in')
+def _():
+  return timedInJS(pm.eval('(n, d) => { for (let i = 0; i < n; i++) for (const k in d); }'),
+                   {f'k{i}': i for i in range(1000)})
+
+
+#
+# The event loop: one iteration is one promise settled across the bridge, one job, or one timer
+#
+@benchmark('event-loop/await-js-promise')
+def _():
+  resolved = pm.eval('() => Promise.resolve(1)')
+
+  async def run(loops):
+    for _ in range(loops):
+      await resolved()
+  return timedAsync(run)
+
+
+@benchmark('event-loop/js-await-python-coroutine')
+def _():
+  awaitAll = pm.eval('async (n, f) => { for (let i = 0; i < n; i++) await f(); }')
+
+  async def coroutine():
+    return 1
+  return timedAsync(lambda loops: awaitAll(loops, coroutine))
+
+
+@benchmark('event-loop/jobs')
+def _():
+  chain = pm.eval('''(n) => new Promise((resolve) => {
+  let i = 0;
+  const step = () => (++i < n ? Promise.resolve().then(step) : resolve());
+  step();
+})''')
+  return timedAsync(chain)
+
+
+@benchmark('event-loop/setTimeout')
+def _():
+  chain = pm.eval('''(n) => new Promise((resolve) => {
+  let i = 0;
+  const step = () => (++i < n ? setTimeout(step, 0) : resolve());
+  step();
+})''')
+  return timedAsync(chain)
+
+
+@benchmark('event-loop/setTimeout-batch')
+def _():
+  batch = pm.eval('''(n) => new Promise((resolve) => {
+  let left = n;
+  for (let i = 0; i < n; i++) setTimeout(() => --left || resolve(), 0);
+})''')
+  return timedAsync(batch)
+
+
+def selected(patterns):
+  names = list(BENCHMARKS)
+  if patterns:
+    names = [name for name in names if any(fnmatch.fnmatchcase(name, pattern) for pattern in patterns)]
+  return names
+
+
+#
+# The simple timer, used without pyperf: the loops are calibrated so that a sample lasts at least --min-time, and
+# the results are the seconds per loop of each sample
+#
+def simpleSamples(run, runs, minTime):
+  loops = 1
+  while True:
+    elapsed = run(loops)
+    if elapsed >= minTime or loops >= 2 ** 30:
+      break
+    loops *= 2 if elapsed <= 0 else max(2, min(10, int(minTime / elapsed * 1.2)))
+  return [run(loops) / loops for _ in range(runs)]
+
+
+def formatTime(seconds):
+  for unit, scale in (('sec', 1), ('ms', 1e3), ('us', 1e6)):
+    if seconds >= 1 / scale:
+      return f'{seconds * scale:.2f} {unit}'
+  return f'{seconds * 1e9:.1f} ns'
+
+
+def loadResults(filename):
+  """The seconds per loop of each benchmark of a results file, in the format of pyperf or of the simple timer"""
+  with open(filename) as file:
+    data = json.load(file)
+  if 'benchmarks' not in data:
+    return data
+  results = {}
+  for bench in data['benchmarks']:
+    name = bench.get('metadata', {}).get('name') or data.get('metadata', {}).get('name')
+    values = [value for run in bench['runs'] for value in run.get('values', [])]
+    if name and values:
+      results[name] = values
+  return results
+
+
+def compare(oldFilename, newFilename):
+  old = loadResults(oldFilename)
+  new = loadResults(newFilename)
+  width = max((len(name) for name in old if name in new), default=0)
+  for name in old:
+    if name not in new or not statistics.mean(old[name]):
+      continue
+    oldMean = statistics.mean(old[name])
+    newMean = statistics.mean(new[name])
+    ratio = newMean / oldMean
+    change = f'{ratio:.2f}x slower' if ratio >= 1 else f'{1 / ratio:.2f}x faster'
+    print(f'{name:{width}}  {formatTime(oldMean):>10} -> {formatTime(newMean):>10}  {change}')
+  for name in sorted(set(old) ^ set(new)):
+    print(f'{name:{width}}  only in {oldFilename if name in old else newFilename}')
+
+
+def simpleMain():
+  parser = argparse.ArgumentParser(description='Micro-benchmarks of the conversions, calls, proxies and event loop of PythonMonkey')
+  parser.add_argument('--filter', action='append', default=[], help='run the benchmarks matching this glob, e.g. "call/*"')
+  parser.add_argument('--list', action='store_true', help='list the benchmarks')
+  parser.add_argument('--runs', type=int, default=10, help='number of samples per benchmark')
+  parser.add_argument('--min-time', type=float, default=0.1, help='minimum duration of a sample, in seconds')
+  parser.add_argument('--fast', action='store_true', help='take 3 samples of at least 20 ms')
+  parser.add_argument('-o', '--output', '--json', dest='output', help='write the seconds per loop of the samples to this file')
+  parser.add_argument('--compare', nargs=2, metavar=('OLD', 'NEW'), help='compare two results files and exit')
+  parser.add_argument('--simple', action='store_true', help='use the simple timer even if pyperf is installed')
+  args = parser.parse_args()
+
+  if args.compare:
+    compare(*args.compare)
+    return
+  names = selected(args.filter)
+  if args.list:
+    print('\n'.join(names))
+    return
+  if args.fast:
+    args.runs, args.min_time = 3, 0.02
+
+  results = {}
+  width = max((len(name) for name in names), default=0)
+  for name in names:
+    samples = simpleSamples(BENCHMARKS[name](), args.runs, args.min_time)
+    results[name] = samples
+    deviation = statistics.stdev(samples) if len(samples) > 1 else 0
+    print(f'{name:{width}}  mean {formatTime(statistics.mean(samples)):>10} +- {formatTime(deviation):>10}   '
+          f'min {formatTime(min(samples)):>10}')
+    sys.stdout.flush()
+
+  if args.output:
+    with open(args.output, 'w') as file:
+      json.dump(results, file, indent=2)
+
+
+def pyperfMain():
+  runner = pyperf.Runner()
+  runner.argparser.add_argument('--filter', action='append', default=[],
+                                help='run the benchmarks matching this glob, e.g. "call/*"')
+  runner.argparser.add_argument('--list', action='store_true', help='list the benchmarks')
+  args = runner.parse_args()
+  # the worker processes start with a clean environment: keep the module search path and the options of PythonMonkey
+  inherited = [name for name in os.environ if name == 'PYTHONPATH' or name.startswith('PYTHONMONKEY_')]
+  if inherited:
+    args.inherit_environ = (args.inherit_environ or []) + inherited
+
+  names = selected(args.filter)
+  if args.list:
+    if not args.worker:
+      print('\n'.join(names))
+    return
+  runner.metadata['pythonmonkey_version'] = pm.__version__
+  for name in names:
+    setup = BENCHMARKS[name]
+    prepared = []
+
+    def run(loops, setup=setup, prepared=prepared):
+      if not prepared: # in the worker that runs this benchmark only
+        prepared.append(setup())
+      return prepared[0](loops)
+    runner.bench_time_func(name, run)
+
+
+def main():
+  if '--compare' in sys.argv or '--simple' in sys.argv or pyperf is None:
+    simpleMain()
+  else:
+    pyperfMain()
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,59 @@
+#! /usr/bin/env python3
+# @file         bench_import.py
+#               Benchmark the cold-import time of PythonMonkey: each sample runs `import pythonmonkey`
+#               in a new Python process. Run with and without a stencil cache directory to measure
+#               the warm starts, e.g.
+#                 python tests/bench/bench_import.py
+#                 python tests/bench/bench_import.py --stencil-cache /tmp/pm-stencils
+# @author       agent, agent@local
+# @date         October 2026
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+SNIPPETS = {
+  'import': 'import pythonmonkey',
+  'import+console': 'import pythonmonkey as pm; pm.eval("console")',
+  'import+timers': 'import pythonmonkey as pm; pm.eval("setTimeout")',
+}
+
+
+def sample(snippet: str, env) -> float:
+  start = time.perf_counter()
+  subprocess.run([sys.executable, '-c', snippet], env=env, check=True)
+  return time.perf_counter() - start
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Benchmark the cold-import time of PythonMonkey')
+  parser.add_argument('--runs', type=int, default=10, help='number of processes started per snippet')
+  parser.add_argument('--stencil-cache', help='directory of the on-disk stencil cache (PYTHONMONKEY_STENCIL_CACHE)')
+  parser.add_argument('--json', help='write the samples, in seconds, to this file')
+  args = parser.parse_args()
+
+  env = dict(os.environ)
+  env.pop('PYTHONMONKEY_STENCIL_CACHE', None)
+  if args.stencil_cache:
+    env['PYTHONMONKEY_STENCIL_CACHE'] = args.stencil_cache
+    sample(SNIPPETS['import'], env)  # populate the cache
+
+  results = {}
+  for name, snippet in SNIPPETS.items():
+    samples = [sample(snippet, env) for _ in range(args.runs)]
+    results[name] = samples
+    print(f'{name:16} mean {statistics.mean(samples) * 1000:8.1f} ms   min {min(samples) * 1000:8.1f} ms   '
+          f'stdev {statistics.stdev(samples) * 1000 if len(samples) > 1 else 0:6.1f} ms')
+
+  if args.json:
+    with open(args.json, 'w') as file:
+      json.dump(results, file, indent=2)
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,82 @@
+#! /usr/bin/env python3
+# @file         bench_jit.py
+#               Benchmark the JIT engine options: each sample runs a workload in a new Python process with
+#               PYTHONMONKEY_ENGINE_OPTIONS set to one of the profiles, measuring a short task (a cold function
+#               called a few hundred times) and a long-running one (a hot loop), e.g.
+#                 python tests/bench/bench_jit.py
+#                 python tests/bench/bench_jit.py --profile eager=baselineWarmUpThreshold=0,ionWarmUpThreshold=100
+# @author       agent, agent@local
+# @date         October 2026
+# @copyright Copyright (c) 2026 Distributive Corp.
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+
+PROFILES = {
+  'default': '',
+  'interpreter': 'baselineInterpreter=false,baseline=false,ion=false',
+  'no-ion': 'ion=false',
+  'eager-baseline': 'baselineInterpreterWarmUpThreshold=0,baselineWarmUpThreshold=0',
+  'aggressive-ion': 'baselineWarmUpThreshold=10,ionWarmUpThreshold=100,offThreadCompilation=false',
+}
+
+WORKLOADS = {
+  'short': '''
+function checksum(s) { let h = 0; for (let i = 0; i < s.length; i++) h = (h * 31 + s.charCodeAt(i)) | 0; return h; }
+for (let i = 0; i < 300; i++) checksum("request-" + i);
+''',
+  'long': '''
+let total = 0;
+for (let i = 0; i < 30000000; i++) total = (total + (i % 7) * (i % 13)) | 0;
+''',
+}
+
+RUNNER = '''
+import sys, time, pythonmonkey as pm
+code = sys.stdin.read()
+start = time.perf_counter()
+pm.eval(code)
+print(time.perf_counter() - start)
+'''
+
+
+def sample(workload: str, env) -> float:
+  result = subprocess.run([sys.executable, '-c', RUNNER], input=workload, env=env, check=True,
+                          capture_output=True, text=True)
+  return float(result.stdout)
+
+
+def main():
+  parser = argparse.ArgumentParser(description='Benchmark the JIT engine options of PythonMonkey')
+  parser.add_argument('--runs', type=int, default=5, help='number of processes started per profile and workload')
+  parser.add_argument('--profile', action='append', default=[],
+                      help='an extra profile, NAME=PYTHONMONKEY_ENGINE_OPTIONS')
+  parser.add_argument('--json', help='write the samples, in seconds, to this file')
+  args = parser.parse_args()
+
+  profiles = dict(PROFILES)
+  for profile in args.profile:
+    name, _, options = profile.partition('=')
+    profiles[name] = options
+
+  results = {}
+  for profileName, options in profiles.items():
+    env = dict(os.environ)
+    env['PYTHONMONKEY_ENGINE_OPTIONS'] = options
+    for workloadName, workload in WORKLOADS.items():
+      samples = [sample(workload, env) for _ in range(args.runs)]
+      results[f'{profileName}/{workloadName}'] = samples
+      print(f'{profileName:16} {workloadName:6} mean {statistics.mean(samples) * 1000:9.2f} ms   '
+            f'min {min(samples) * 1000:9.2f} ms')
+
+  if args.json:
+    with open(args.json, 'w') as file:
+      json.dump(results, file, indent=2)
+
+
+if __name__ == '__main__':
+  main()
@@ -2650,3 +2650,42 @@ def test_iter_for_of():
   pm.eval("""(result, myit) => {let index = 0; for (const value of myit) {result[index++] = value}}""")(result, myit)
   assert result[0] == 1.0
   assert result[1] == 2.0
+
+
+def test_methods_are_cached():
+  items = [1, 2]
+  assert pm.eval("(a, b) => a.push === b.push && a[Symbol.iterator] === b[Symbol.iterator]")(items, [])
+  assert pm.eval("(a) => { for (let i = 0; i < 1000; i++) a.push(i); return a.length; }")(items) == 1002
+
+
+def test_sort_is_stable():
+  items = [[i % 3, i] for i in range(100)]
+  pm.eval("(arr) => arr.sort((a, b) => a[0] - b[0])")(items)
+  assert items == sorted([[i % 3, i] for i in range(100)], key=lambda x: x[0])
+
+
+def test_sort_large_sorted_input():
+  items = list(range(100000))
+  pm.eval("(arr) => arr.sort((a, b) => a - b)")(items)
+  assert items == list(range(100000))
+
+
+def test_sort_undefined_last():
+  items = [3, None, 1, None, 2]
+  pm.eval("(arr) => arr.sort((a, b) => a - b)")(items)
+  assert items == [1, 2, 3, None, None]
+
+
+def test_iteration_methods_pass_python_elements_to_python_callbacks():
+  records = [{'n': 1}, {'n': 2}, {'n': 3}]
+  seen = []
+  pm.eval("(arr, fn) => arr.forEach(fn)")(records, lambda record, index, arr: seen.append((record, index, arr)))
+  assert all(record is records[index] and arr is records for record, index, arr in seen)
+  assert pm.eval("(arr, fn) => arr.map(fn)")(records, lambda record: record['n'] * 2) == [2, 4, 6]
+  assert pm.eval("(arr, fn) => arr.filter(fn)")(records, lambda record: record['n'] % 2) == [{'n': 1}, {'n': 3}]
+  assert pm.eval("(arr, fn) => arr.filter(fn)")([0, 1, 2], lambda x: []) == [0, 1, 2]  # [] is truthy in JS
+  assert pm.eval("(arr, fn) => arr.reduce(fn, '')")(['a', 'b', 'c'], lambda acc, x: acc + x) == 'abc'
+  assert pm.eval("(arr, fn) => arr.reduceRight(fn)")(['a', 'b', 'c'], lambda acc, x: acc + x) == 'cba'
+  assert pm.eval("(arr, fn) => arr.find(fn)")(records, lambda record: record['n'] == 2) is records[1]
+  assert pm.eval("(arr, fn) => arr.findIndex(fn)")(records, lambda record: record['n'] == 3) == 2
+  assert pm.eval("(arr, fn) => [arr.some(fn), arr.every(fn)]")(records, lambda record: record['n'] > 1) == [True, False]
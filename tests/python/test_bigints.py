@@ -167,3 +167,14 @@ def test_eval_functions_bigint_crc32():
   assert crc_table_at(0) == 0
   assert crc_table_at(1) == 1996959894
   assert crc_table_at(255) == 755167117  # last item
+
+
+def test_bigint_64_bit_boundaries():
+  values = [0, 1, -1, 2**53 + 1, 2**63 - 1, -2**63, 2**63, 2**64 - 1, -2**64 + 1, 2**64, -2**64, 2**200 + 3, -2**200 - 3]
+  identity = pm.eval("(n) => n")
+  to_string = pm.eval("(n) => n.toString()")
+  for value in values:
+    assert identity(pm.bigint(value)) == value
+    assert type(identity(pm.bigint(value))) == pm.bigint
+    assert to_string(pm.bigint(value)) == str(value)
+    assert pm.eval(f"{value}n") == value
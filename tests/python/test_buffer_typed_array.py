@@ -12,7 +12,7 @@ def test_py_buffer_to_js_typed_array():
   # JS TypedArray/ArrayBuffer should coerce to Python memoryview type
   def assert_js_to_py_memoryview(buf: memoryview):
     assert type(buf) is memoryview
-    assert None is buf.obj  # https://docs.python.org/3.9/c-api/buffer.html#c.Py_buffer.obj
+    assert "pythonmonkey.JSBufferExporter" == type(buf.obj).__module__ + "." + type(buf.obj).__name__  # keeps the JS buffer alive
     assert 2 * 4 == buf.nbytes  # 2 elements * sizeof(int32_t)
     assert "02000000ffffffff" == buf.hex()  # native (little) endian
   buf1 = pm.eval("new Int32Array([2,-1])")
@@ -185,9 +185,6 @@ def test_py_buffer_to_js_typed_array():
   assert_empty_arraybuffer(pm.eval("(arr)=>arr.buffer")(numpy.array([], dtype=numpy.uint64)))
   assert_empty_arraybuffer(pm.eval("(arr)=>arr.buffer")(array.array("d", [])))
 
-  # TODO (Tom Tang): shared ArrayBuffer should be disallowed
-  # pm.eval("new WebAssembly.Memory({ initial: 1, maximum: 1, shared: true }).buffer")
-
   # TODO (Tom Tang): once a JS ArrayBuffer is transferred to a worker
   # thread, it should be invalidated in Python-land as well
 
@@ -199,10 +196,11 @@ def test_py_buffer_to_js_typed_array():
   with pytest.raises(ValueError, match="ndarray is not C-contiguous"):
     pm.eval("(typedArray) => {}")(fortran_order_arr)
 
-  # disallow multidimensional array
-  numpy_2d_array = numpy.array([[1, 2], [3, 4]], order="C")
-  with pytest.raises(BufferError, match="multidimensional arrays are not allowed"):
-    pm.eval("(typedArray) => {}")(numpy_2d_array)
+  # C-contiguous multidimensional arrays are flattened, keeping their shape
+  numpy_2d_array = numpy.array([[1, 2], [3, 4]], order="C", dtype=numpy.float32)
+  assert pm.eval("(typedArray) => [typedArray.length, typedArray.shape, typedArray.strides, typedArray[2]]")(numpy_2d_array) == [4.0, [2.0, 2.0], [8.0, 4.0], 3.0]
+  pm.eval("(typedArray) => { typedArray[3] = 5 }")(numpy_2d_array)
+  assert numpy_2d_array[1][1] == 5
 
 
 
@@ -394,4 +392,85 @@ def test_values_iterator():
     }
   """)(result, items)
   assert result == [97.0, 98.0, 99.0]
-  assert result is not items  
\ No newline at end of file
+  assert result is not items  
+
+def test_shared_array_buffer():
+  sab = pm.eval("globalThis.sharedInts = new Int32Array(new SharedArrayBuffer(16)); sharedInts.buffer")
+  assert sab.nbytes == 16
+  assert not sab.readonly
+  ints = pm.eval("sharedInts")
+  assert ints.format == "i"
+  ints[1] = 42
+  assert pm.eval("sharedInts[1]") == 42
+  pm.eval("Atomics.store(sharedInts, 2, 7)")
+  assert ints[2] == 7
+  assert sab.cast("i")[1] == 42
+
+
+def test_copy_strided_buffers():
+  arr = numpy.arange(12, dtype=numpy.int32).reshape(3, 4)[:, 1:3]
+  with pytest.raises(ValueError, match="ndarray is not C-contiguous"):
+    pm.eval("(typedArray) => {}")(arr)
+  pm.setCopyStridedBuffers(True)
+  try:
+    assert pm.eval("(typedArray) => [Array.from(typedArray), typedArray.shape]")(arr) == [[1.0, 2.0, 5.0, 6.0, 9.0, 10.0], [3.0, 2.0]]
+  finally:
+    pm.setCopyStridedBuffers(False)
+
+
+def test_copy_immutable_buffers():
+  pm.setCopyImmutableBuffers(True)
+  try:
+    b = b"hello"
+    assert pm.eval("(arr) => arr.constructor === Uint8Array && String.fromCharCode(...arr)")(b) == "hello"
+    assert pm.eval("(arr) => { arr[0] = 72; return arr[0]; }")(b) == 72
+    assert b == b"hello"
+  finally:
+    pm.setCopyImmutableBuffers(False)
+
+
+def test_memoryview_pins_js_buffer():
+  view = pm.eval("new Uint8Array([1, 2, 3])") # small enough to be stored inline
+  pm.collect()
+  assert view.tolist() == [1, 2, 3]
+  buf = pm.eval("globalThis.pinnedBuffer = new ArrayBuffer(8); pinnedBuffer")
+  if pm.eval("typeof ArrayBuffer.prototype.transfer === 'function'"):
+    assert pm.eval("(() => { try { pinnedBuffer.transfer(); return false; } catch (e) { return true; } })()")
+    del buf
+    pm.eval("pinnedBuffer.transfer()")  # detachable again once the memoryview is gone
+
+
+def test_js_buffer_stays_pinned_until_last_memoryview():
+  first = pm.eval("globalThis.sharedPin = new ArrayBuffer(16); sharedPin")
+  second = pm.eval("new Uint8Array(sharedPin, 4, 4)")
+  third = pm.eval("sharedPin")
+  if pm.eval("typeof ArrayBuffer.prototype.transfer === 'function'"):
+    transferFails = "(() => { try { sharedPin.transfer(); return false; } catch (e) { return true; } })()"
+    del first
+    assert pm.eval(transferFails)
+    del second
+    assert pm.eval(transferFails)
+    third[0] = 1
+    del third
+    pm.eval("sharedPin.transfer()")
+
+
+def test_wasm_memory_buffer_across_grow():
+  # (module (memory (export "mem") 1))
+  binary = bytes([0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+                  0x05, 0x03, 0x01, 0x00, 0x01,
+                  0x07, 0x07, 0x01, 0x03, 0x6d, 0x65, 0x6d, 0x02, 0x00])
+  module = pm.compileWasm(binary)
+  assert pm.eval("(m) => m instanceof WebAssembly.Module")(pm.compileWasm(binary))  # from the cache
+  memory = pm.eval("(m) => new WebAssembly.Instance(m).exports.mem")(module)
+  assert isinstance(memory, pm.JSWasmMemoryProxy)
+  with memoryview(memory) as view:
+    assert len(view) == 65536
+    view[0] = 42
+  assert pm.eval("(mem) => new Uint8Array(mem.buffer)[0]")(memory) == 42
+  memory.grow(1)
+  with memoryview(memory) as view:
+    assert len(view) == 2 * 65536
+    assert view[0] == 42
+  with pytest.raises(pm.SpiderMonkeyError):
+    pm.compileWasm(b"not wasm")
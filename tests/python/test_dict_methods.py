@@ -223,6 +223,16 @@ def test_keys_iter_reverse():
   assert result == ['b', 'a']
 
 
+def test_iter_large_object_length_hint():
+  obj = pm.eval("Object.fromEntries(Array.from({ length: 50000 }, (_, i) => ['k' + i, i]))")
+  it = iter(obj.items())
+  assert it.__length_hint__() == 50000
+  next(it)
+  assert it.__length_hint__() == 49999
+  assert sum(v for k, v in obj.items()) == sum(range(50000))
+  assert list(reversed(obj.keys()))[0] == 'k49999'
+
+
 def test_keys_list():
   obj = pm.eval("({ a: 123, b: 'test' })")
   assert list(obj.keys()) == ['a', 'b']
@@ -26,6 +26,20 @@ def test_eval_dicts_cycle():
   assert pm.eval("(dict) => { return dict.recursive; }")(d) is d["recursive"]
 
 
+def test_dict_to_js_preserves_identity():
+  d = {"a": 1}
+  assert pm.eval("(a, b) => a === b")(d, d)
+  l = [1, 2]
+  assert pm.eval("(a, b) => a === b")(l, l)
+
+
+def test_js_object_to_py_preserves_identity():
+  getObj = pm.eval("const obj = {a: 1}; () => obj")
+  assert getObj() is getObj()
+  getArr = pm.eval("const arr = [1, 2]; () => arr")
+  assert getArr() is getArr()
+
+
 def test_eval_objects():
   pyObj = pm.eval("Object({a:1.0})")
   assert pyObj == {'a': 1.0}
@@ -387,3 +401,202 @@ def test___class__attribute():
 def test___none__attribute():
   a = pm.eval("({'0': 1, '1': 2})")
   assert a[2] is None
+
+
+def test_js_reads_py_dict_keys():
+  d = {'foo': 1, 'bé': 2, '\U0001F600': 3}
+  assert pm.eval("(d) => d.foo + d['bé'] + d['\U0001F600']")(d) == 6
+  assert pm.eval("(d) => Object.keys(d)")(d) == ['foo', 'bé', '\U0001F600']
+
+
+def test_to_python_deep_copy():
+  obj = pm.eval("const o = {a: [1, 'x', {b: null}], c: new Uint8Array([1, 2])}; o.self = o; o")
+  copy = pm.toPython(obj)
+  assert type(copy) is dict
+  assert type(copy['a']) is list
+  assert type(copy['a'][1]) is str
+  assert copy['a'][2] == {'b': pm.null}
+  assert copy['self'] is copy
+  assert bytes(copy['c']) == b'\x01\x02'
+  pm.eval("(o) => { o.a.push(2); o.c[0] = 9; }")(obj)
+  assert len(copy['a']) == 3
+  assert bytes(copy['c']) == b'\x01\x02'
+
+
+def test_to_js_deep_copy():
+  d = {'a': [1, (2, 3)], 'b': {'c': 'd'}}
+  d['self'] = d
+  copy = pm.toJS(d)
+  assert pm.eval("(o) => Array.isArray(o.a) && Array.isArray(o.a[1]) && o.self === o && o.b.c === 'd'")(copy)
+  d['b']['c'] = 'e'
+  assert copy['b']['c'] == 'd'
+
+
+def test_json_stringify_bytes():
+  obj = pm.eval("({a: [1, 'é', '\\u{1F600}'], b: null})")
+  assert pm.jsonStringify(obj) == '{"a":[1,"é","\U0001F600"],"b":null}'.encode('utf-8')
+  assert pm.jsonStringify({'x': 1}, indent=1) == b'{\n "x": 1\n}'
+  assert pm.jsonStringify(pm.eval("(() => 1)")) is None
+  chunks = []
+  pm.jsonStringify(obj, write=chunks.append)
+  assert b''.join(chunks) == pm.jsonStringify(obj)
+  large = pm.eval("'x'.repeat(65535) + '\\u{1F600}'.repeat(40000)")
+  chunks = []
+  pm.jsonStringify(large, write=chunks.append)
+  assert len(chunks) > 1 and all(len(chunk) < 65536 + 4 for chunk in chunks)
+  assert b''.join(chunks).decode('utf-8') == '"' + large + '"'
+
+
+def test_json_parse_bytes():
+  assert pm.jsonParse(b'{"a": [1, 2]}') == {'a': [1.0, 2.0]}
+  assert pm.jsonParse('{"é": "\U0001F600"}'.encode('utf-8')) == {'é': '\U0001F600'}
+
+
+def test_js_enumerates_py_dict_keys():
+  d = {'a': 1, 2: 'b', -1: 'skipped', (1, 2): 'skipped'}
+  assert pm.eval("(d) => Object.keys(d)")(d) == ['a', '2']
+  assert pm.eval("(d) => { const keys = []; for (const k in d) keys.push(k); return keys.length; }")(d) == 2
+
+
+def test_js_iterables_are_iterated_lazily():
+  log = []
+  counter = pm.eval("(log) => (function* () { for (let i = 0; ; i++) { log.push(i); yield i; } })()")(log)
+  assert isinstance(counter, pm.JSIteratorProxy)
+  for value in counter:
+    if value == 2:
+      break
+  assert log == [0, 1, 2]
+
+  custom = pm.eval("({ label: 'three', [Symbol.iterator]: function* () { yield 1; yield 2; yield 3; } })")
+  assert isinstance(custom, pm.JSIterableProxy) and not isinstance(custom, pm.JSIteratorProxy)
+  assert list(custom) == [1.0, 2.0, 3.0]
+  assert list(custom) == [1.0, 2.0, 3.0]  # each iteration gets a new JS iterator
+  assert custom['label'] == 'three'
+  assert list(pm.eval("new Map([['a', 1]]).keys()")) == ['a']
+
+
+def test_js_iterable_detection_runs_no_js_code():
+  ran = pm.eval("""globalThis.iterableDetectionRan = []; [
+    { get [Symbol.iterator]() { iterableDetectionRan.push('getter'); return function* () {}; } },
+    new Proxy({}, { get(target, key) { iterableDetectionRan.push('trap'); return undefined; } }),
+  ]""")
+  getter, proxy = ran[0], ran[1]
+  assert type(getter) is pm.JSObjectProxy
+  assert type(proxy) is pm.JSObjectProxy
+  assert pm.eval("iterableDetectionRan.length") == 0
+
+  obj = pm.eval("({})")
+  obj2 = pm.eval("(obj) => { obj[Symbol.iterator] = function* () { yield 1; }; return obj; }")(obj)
+  assert obj2 is obj  # the proxy keeps its identity once the object becomes iterable
+
+
+def test_js_map_and_set_proxies():
+  m = pm.eval("new Map([[1, 'one'], ['1', 'string one']])")
+  assert isinstance(m, pm.JSMapProxy)
+  assert len(m) == 2
+  assert m[1] == 'one' and m['1'] == 'string one'
+  m[2] = 'two'
+  assert pm.eval("(m) => m.get(2)")(m) == 'two'
+  assert 2 in m and 3 not in m
+  assert m.get(3, 'missing') == 'missing'
+  assert m.pop(2) == 'two' and len(m) == 2
+  try:
+    m[3]
+    assert False
+  except KeyError:
+    pass
+  assert list(m) == [1.0, '1']
+  assert [(k, v) for k, v in m.items()] == [(1.0, 'one'), ('1', 'string one')]
+  assert pm.eval("(m) => m instanceof Map")(m)
+
+  s = pm.eval("new Set([1, 'a'])")
+  assert isinstance(s, pm.JSSetProxy)
+  assert 1 in s and 'a' in s and 2 not in s
+  s.add(2)
+  s.discard('a')
+  assert list(s) == [1.0, 2.0]
+  assert pm.eval("(s) => s.has(2) && !s.has('a')")(s)
+
+
+def test_py_dict_without_str_keys_is_map_like():
+  d = {1: 'one', (2, 3): 'tuple'}
+  assert pm.eval("(d) => d instanceof Map && d.size")(d) == 2
+  assert pm.eval("(d) => d.get(1)")(d) == 'one'
+  assert pm.eval("(d) => d.get([2, 3])")(d) == 'tuple'
+  assert pm.eval("(d) => d.has(4)")(d) is False
+  pm.eval("(d) => d.set(4, 'four').delete(1)")(d)
+  assert d == {(2, 3): 'tuple', 4: 'four'}
+  assert pm.eval("(d) => { const values = []; for (const [k, v] of d) values.push(v); return values; }")(d) == ['tuple', 'four']
+  assert pm.eval("(d) => Object.keys(d).length")(d) == 0
+  assert pm.eval("(d) => d[1]")({1: 'a', 'b': 2}) == 'a'  # dicts with str keys stay object-like, their int keys are found
+
+
+def test_bulk_property_access():
+  obj = pm.eval("({ a: 1, b: 'two', f() { return this.a; } })")
+  values = obj.get_many(['a', 'b', 'missing'])
+  assert values[:2] == [1.0, 'two'] and values[2] is None
+  assert obj.get_many(['f'])[0]() == 1.0  # functions are bound to the object, as obj['f'] is
+  obj.set_many({'c': 3, 'd': [4]})
+  obj.set_many([('e', 5)])
+  obj.update_fast({f'field{i}': i for i in range(50)})
+  assert pm.eval("(o) => [o.c, o.d[0], o.e, o.field49]")(obj) == [3.0, 4.0, 5.0, 49.0]
+  try:
+    obj.set_many({'g': 1, (1, 2): 'invalid'})
+    assert False
+  except AttributeError:
+    pass
+  assert 'g' not in obj  # the keys are resolved before any property is set
+  obj.update({'h': 1}, i=2)
+  assert obj['h'] == 1.0 and obj['i'] == 2.0
+
+
+def test_structural_equality():
+  obj = pm.eval("({ a: [1, { b: 'é😀' }], c: null, d: undefined, e: true })")
+  assert obj == {'a': [1, {'b': 'é😀'}], 'c': pm.null, 'd': None, 'e': 1}
+  assert obj != {'a': [1, {'b': 'é😀'}], 'c': pm.null, 'd': None}  # the lengths differ
+  assert obj != {'a': [1, {'b': 'é'}], 'c': pm.null, 'd': None, 'e': True}
+  assert obj == obj and obj == pm.eval("(o) => o")(obj)
+  other = pm.eval("({ a: [1, { b: 'é😀' }], c: null, d: undefined, e: true })")
+  assert obj == other and obj['a'] == other['a']
+  cyclic = pm.eval("(() => { const o = { n: 1 }; o.self = o; o.list = [o]; return o; })()")
+  pyCyclic = {'n': 1}
+  pyCyclic['self'] = pyCyclic
+  pyCyclic['list'] = [pyCyclic]
+  assert cyclic == pyCyclic
+  assert cyclic == pm.eval("(() => { const o = { n: 1 }; o.self = o; o.list = [o]; return o; })()")
+  pyCyclic['n'] = 2
+  assert cyclic != pyCyclic
+  assert pm.eval("[1, [2, 3]]") == [1, [2, 3]]
+  assert pm.eval("[1, [2, 3]]") < [1, [2, 4]]
+  assert pm.eval("[[1]]") != [(1,)]  # lists don't equal tuples
+
+
+def test_json_stringify_of_python_dicts_and_lists():
+  stringify = pm.eval("(value, space) => JSON.stringify(value, undefined, space)")
+  value = {'a': [1, 2.5, None, float('nan'), 'x"\n\ud800é😀'], 'b': None, 'c': {}, 'd': [], 'e': {'f': True, 'g': pm.null}}
+  expected = '{"a":[1,2.5,null,null,"x\\"\\n\\ud800é😀"],"c":{},"d":[],"e":{"f":true,"g":null}}'
+  assert stringify(value) == expected
+  assert stringify(value, 2) == pm.eval("(s) => JSON.stringify(JSON.parse(s), null, 2)")(expected)
+  assert stringify(value, '--') == pm.eval("(s) => JSON.stringify(JSON.parse(s), null, '--')")(expected)
+  assert pm.eval("(o) => JSON.stringify(o, ['a'])")({'a': 1, 'b': 2}) == '{"a":1}'  # the replacer is honoured
+  assert pm.eval("(o) => JSON.stringify({ o })")({'a': 1}) == '{"o":{"a":1}}'
+  assert stringify({'toJSON': lambda key: 'replaced'}) == '"replaced"'
+  cyclic = {}
+  cyclic['self'] = cyclic
+  try:
+    stringify(cyclic)
+    assert False
+  except pm.SpiderMonkeyError as e:
+    assert 'cyclic' in str(e)
+
+
+def test_js_iterables_compare_by_identity():
+  make = pm.eval("() => (function* () { yield 1; })()")
+  gen1, gen2 = make(), make()
+  assert gen1 == gen1 and gen1 == pm.eval("(g) => g")(gen1)
+  assert gen1 != gen2
+  iterable = pm.eval("({ a: 1, [Symbol.iterator]: function* () { yield 1; } })")
+  assert iterable != {'a': 1}
+  assert iterable != gen1
+  assert iterable != 1
+  assert pm.eval("({ list: [1] })") != pm.eval("({ list: (function* () {})() })")
@@ -432,3 +432,120 @@ def test_webassembly():
     # making sure the async_fn is run
     return True
   assert asyncio.run(async_fn())
+
+
+def test_promise_jobs_drained_in_order():
+  async def async_fn():
+    order = []
+    pm.eval("""(order) => {
+      Promise.resolve().then(() => { order.push(1); Promise.resolve().then(() => order.push(3)); });
+      Promise.resolve().then(() => order.push(2));
+    }""")(order)
+    asyncio.get_running_loop().call_soon(order.append, 4)  # scheduled after the single drain of the JS job queue
+    assert 100000 == await pm.eval("(async () => { let i = 0; while (i < 100000) { await null; i++; } return i; })()")
+    assert order == [1, 2, 3, 4]
+    return True
+  assert asyncio.run(async_fn())
+
+
+def test_timer_ids_reused_with_new_generation():
+  async def async_fn():
+    first = pm.eval("(setTimeout(() => {}, 0))")
+    first_id = pm.eval("(t) => Number(t)")(first)
+    await pm.wait()
+    assert pm.eval("(t) => t.hasRef()")(first) is False  # released once finished
+    second_id = pm.eval("Number(setTimeout(() => {}, 0))")
+    await pm.wait()
+    assert second_id != first_id
+    assert int(second_id) % 2 ** 32 == int(first_id) % 2 ** 32  # same slot, new generation
+    return True
+  assert asyncio.run(async_fn())
+
+
+def test_many_timers_share_the_timer_heap():
+  async def async_fn():
+    order = []
+    pm.eval("""(order) => {
+      const cleared = [];
+      for (let i = 0; i < 1000; i++)
+        cleared.push(setTimeout(() => order.push(-1), 10));
+      for (const t of cleared)
+        clearTimeout(t);
+      setTimeout(() => order.push(3), 30);
+      for (let i = 0; i < 3; i++)
+        setTimeout(() => order.push(i), 20);
+    }""")(order)
+    await pm.wait()
+    assert order == [0, 1, 2, 3]
+    return True
+  assert asyncio.run(async_fn())
+
+
+def test_same_future_settles_the_same_promise():
+  async def async_fn():
+    future = asyncio.get_running_loop().create_future()
+    same = pm.eval("(a, b) => a === b")(future, future)
+    assert same is True
+    settled = pm.eval("(p) => p.then((v) => v * 2)")(future)
+    future.set_result(21)
+    assert await settled == 42
+    return True
+  assert asyncio.run(async_fn())
+
+
+def test_run_sync_drains_promise_jobs_without_an_event_loop():
+  fn = pm.eval("""async (n) => {
+    let total = 0;
+    for (let i = 0; i < n; i++)
+      total += await Promise.resolve(i);
+    return total;
+  }""")
+  assert pm.runSync(fn, 100) == 4950
+  assert pm.runSync(pm.eval("(x) => x + 1"), 1) == 2  # not async
+  with pytest.raises(pm.SpiderMonkeyError, match="boom"):
+    pm.runSync(pm.eval("async () => { await null; throw new Error('boom') }"))
+  # timers are waited on a private event-loop
+  assert pm.runSync(pm.eval("() => new Promise((resolve) => setTimeout(() => resolve(7), 10))")) == 7
+
+
+def test_stats_count_jobs_and_timers():
+  pm.stats(reset=True)
+  pm.runSync(pm.eval("async () => { await null; await null; }"))
+  stats = pm.stats()
+  assert stats["jobs"]["run"] >= 2
+  assert stats["jobs"]["wait"]["count"] == stats["jobs"]["run"]
+  assert sum(stats["jobs"]["duration"]["buckets"]) == stats["jobs"]["run"]
+
+  async def async_fn():
+    pm.eval("setTimeout(() => {}, 0); clearTimeout(setTimeout(() => {}, 0))")
+    await pm.wait()
+  asyncio.run(async_fn())
+  js_stats = pm.eval("internalBinding => internalBinding('metrics').getStats(true)")(pm.internalBinding)
+  assert js_stats["timers"]["scheduled"] == 2
+  assert js_stats["timers"]["fired"] == 1
+  assert js_stats["timers"]["cancelled"] == 1
+  assert pm.stats()["timers"]["scheduled"] == 0  # reset
+
+
+def test_async_generator_is_js_async_iterable():
+  async def numbers():
+    for i in range(3):
+      await asyncio.sleep(0)
+      yield i
+
+  async def async_fn():
+    collect = pm.eval("""async (iterable) => {
+      const items = [];
+      for await (const item of iterable)
+        items.push(item);
+      return items;
+    }""")
+    return await collect(numbers())
+  assert asyncio.run(async_fn()) == [0.0, 1.0, 2.0]
+
+
+def test_js_async_generator_is_python_async_iterable():
+  async def async_fn():
+    numbers = pm.eval("(async function* () { for (let i = 0; i < 3; i++) { await null; yield i; } })()")
+    return [value async for value in numbers]
+  assert asyncio.run(async_fn()) == [0.0, 1.0, 2.0]
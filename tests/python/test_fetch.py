@@ -0,0 +1,95 @@
+from http.server import HTTPServer, BaseHTTPRequestHandler
+import pythonmonkey as pm
+import threading
+import asyncio
+import json
+
+
+def test_fetch():
+  class TestHTTPRequestHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'  # keep the connections alive
+
+    def log_request(self, *args) -> None:
+      return
+
+    def do_GET(self):
+      data = json.dumps({'path': self.path, 'port': self.client_address[1]}).encode('utf-8')
+      self.send_response(200)
+      self.send_header('Content-Type', 'application/json')
+      self.send_header('Content-Length', str(len(data)))
+      self.end_headers()
+      self.wfile.write(data)
+
+    def do_POST(self):
+      length = int(self.headers.get('Content-Length'))
+      data = self.rfile.read(length)
+      self.send_response(201)
+      self.send_header('Content-Type', self.headers.get('Content-Type'))
+      self.send_header('Content-Length', str(len(data)))
+      self.end_headers()
+      self.wfile.write(data)
+
+  httpd = HTTPServer(('localhost', 4003), TestHTTPRequestHandler)
+  thread = threading.Thread(target=httpd.serve_forever)
+  thread.daemon = True
+  thread.start()
+
+  pm.configure_fetch(keepalive_timeout=30, origins={'http://localhost:4003': {'limit_per_host': 1}})
+
+  async def async_fn():
+    first = await pm.eval("fetch('http://localhost:4003/a').then((response) => response.json())")
+    second = await pm.eval("fetch('http://localhost:4003/b').then((response) => response.json())")
+    assert first['path'] == '/a'
+    assert first['port'] == second['port']  # the connection was reused
+
+    echoed = await pm.eval("""
+      (async () => {
+        const response = await fetch('http://localhost:4003/echo', {
+          method: 'POST',
+          headers: { 'Content-Type': 'text/plain' },
+          body: 'snakes and monkeys',
+        });
+        return [response.status, response.headers.get('content-type'), await response.text()];
+      })()
+      """)
+    assert echoed[0] == 201
+    assert echoed[1] == 'text/plain'
+    assert echoed[2] == 'snakes and monkeys'
+    await pm.close_fetch_sessions()
+    httpd.shutdown()
+  asyncio.run(async_fn())
+
+
+def test_fetch_manual_redirect_and_pooled_session_shutdown():
+  class RedirectingHTTPRequestHandler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+
+    def log_request(self, *args) -> None:
+      return
+
+    def do_GET(self):
+      self.send_response(302)
+      self.send_header('Location', '/elsewhere')
+      self.send_header('Content-Length', '0')
+      self.end_headers()
+
+  httpd = HTTPServer(('localhost', 4004), RedirectingHTTPRequestHandler)
+  thread = threading.Thread(target=httpd.serve_forever)
+  thread.daemon = True
+  thread.start()
+
+  async def async_fn():
+    return await pm.eval("""
+      (async () => {
+        const response = await fetch('http://localhost:4004/moved', { redirect: 'manual' });
+        const original = new Request('http://localhost:4004/', { method: 'POST', body: 'once' });
+        const copy = new Request(original);
+        return [response.type, response.status, response.body, original.bodyUsed, await copy.text()];
+      })()
+      """)
+  try:
+    assert asyncio.run(async_fn()) == ['opaqueredirect', 0, None, True, 'once']
+    # the session of the event-loop was closed when asyncio.run() shut it down
+    assert all(not loop.is_closed() for loop, _ in pm.http_pool._sessions.values())
+  finally:
+    httpd.shutdown()
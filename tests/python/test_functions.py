@@ -119,3 +119,50 @@ def test_default_vararg_func_too_few_args():
   def f(a, b, c=42, d=43, *args):
     return [a, b, c, d, *args]
   assert [1, None, 42, 43] == pm.eval("(f) => f(1)")(f)
+
+
+def test_vararg_func_many_args():
+  def f(*args):
+    return list(args)
+  assert list(range(20)) == pm.eval("(f) => f(...Array.from({ length: 20 }, (_, i) => i))")(f)
+
+
+def test_method_default_args():
+  class C:
+    def m(self, a, b=42):
+      return [a, b]
+  assert [1, 42] == pm.eval("(f) => f(1)")(C().m)
+
+
+def test_js_function_many_args():
+  f = pm.eval("(...args) => args.length")
+  assert 20 == f(*range(20))
+
+
+def test_js_function_keyword_arguments_as_options():
+  f = pm.eval("(...args) => args")
+  assert [1] == f(1, b=2)
+  pm.setKeywordArgumentsAsOptions(True)
+  try:
+    assert [1, {'b': 2.0, 'c': 'three'}] == f(1, b=2, c='three')
+    assert [1] == f(1)
+  finally:
+    pm.setKeywordArgumentsAsOptions(False)
+
+
+def test_call_many_and_map():
+  double = pm.eval("(x) => x * 2")
+  assert pm.callMany(double, range(5), chunk=2) == [0.0, 2.0, 4.0, 6.0, 8.0]
+  assert pm.callMany(double, []) == []
+  assert list(pm.mapJS(double, iter(range(2500)), chunk=1000))[-1] == 4998.0
+  namespace = {}
+  exec('from pythonmonkey import *', namespace)
+  assert 'map' not in namespace  # the builtin map is not shadowed
+  obj = pm.eval("({ factor: 3, scale(x) { return x * this.factor; } })")
+  assert pm.callMany(obj.scale, [1, 2]) == [3.0, 6.0]
+  thrower = pm.eval("(x) => { if (x === 3) throw new Error('three'); return x; }")
+  try:
+    pm.callMany(thrower, range(10), chunk=4)
+    assert False
+  except pm.SpiderMonkeyError as e:
+    assert 'three' in str(e)
@@ -215,4 +215,20 @@ def test_method_no_self():
     pm.eval('x => x.some_method()')(obj)
     assert (False)
   except pm.SpiderMonkeyError as e:
-    assert 'takes 0 positional arguments but 1 was given' in str(e)
\ No newline at end of file
+    assert 'takes 0 positional arguments but 1 was given' in str(e)
+
+
+def test_js_object_method_this_without_bind():
+  obj = pm.eval("({ x: 42, getX() { return this.x; }, getThis() { return this; } })")
+  getX = obj.getX
+  assert getX() == 42
+  assert obj['getX']() == 42
+  assert obj.getThis() == obj
+  # the method stays bound to obj when it is passed back to JS
+  assert pm.eval("(f) => f()")(obj.getX) == 42
+  # and it is bound once, to the object it was last read from
+  getX = obj.getX
+  assert pm.eval("(f, g) => f === g")(getX, getX)
+  other = pm.eval("(o) => ({ x: 7, getX: o.getX })")(obj)
+  assert other.getX() == 7
+  assert pm.eval("(f) => f()")(other.getX) == 7
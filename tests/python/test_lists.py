@@ -1244,3 +1244,72 @@ def test_slice_assign_pm_array_step_2():
 def test___class__attribute():
   items = pm.eval("([1,2,3,4,5,6])")
   assert repr(items.__class__) == "<class 'list'>"
+
+# to_list
+
+
+def test_to_list():
+  items = pm.eval("([1, 'two', [3], undefined])")
+  result = items.to_list()
+  assert type(result) is list
+  assert result == [1.0, 'two', [3.0], None]
+
+
+def test_iter_large_array():
+  items = pm.eval("Array.from({length: 1000}, (_, i) => i)")
+  assert list(items) == list(range(1000))
+  assert 999 in items
+  assert items.count(500) == 1
+
+
+def test_to_buffer():
+  import array
+  items = pm.eval("Array.from({length: 100}, (_, i) => i / 2)")
+  doubles = items.to_buffer()
+  assert doubles.format == 'd'
+  assert doubles.tolist() == [i / 2 for i in range(100)]
+  ints = pm.eval("[1, -2, 3]").to_buffer('i')
+  assert array.array('i', ints) == array.array('i', [1, -2, 3])
+  try:
+    pm.eval("[1, 'x']").to_buffer()
+    assert (False)
+  except TypeError:
+    pass
+
+
+def test_array_from_buffer():
+  import array
+  items = pm.arrayFromBuffer(array.array('d', [0.5, 1, 2]))
+  assert items == [0.5, 1.0, 2.0]
+  assert pm.eval("(a) => Array.isArray(a) && a.every((x) => typeof x === 'number')")(items)
+  assert pm.arrayFromBuffer(array.array('i', [1, 2, 3])).to_buffer('i').tolist() == [1, 2, 3]
+
+
+def test_sort_with_key_calls_key_once_per_element_and_is_stable():
+  calls = []
+
+  def firstLetter(word):
+    calls.append(word)
+    return word[0]
+  a = pm.eval("(['bx', 'a1', 'by', 'a2', undefined, 'c', 'bz'])")
+  a.sort(key=firstLetter, reverse=True)
+  assert a == ['c', 'bx', 'by', 'bz', 'a1', 'a2', None]
+  assert len(calls) == 6
+  a.sort(key={'a1': 3, 'a2': 1, 'bx': 2, 'by': 2, 'bz': 2, 'c': 0}.get)
+  assert a == ['c', 'a2', 'bx', 'by', 'bz', 'a1', None]
+
+
+def test_sort_keeps_holes_and_the_length_left_by_the_key():
+  a = pm.eval("[3, , undefined, 1, , 2]")
+  a.sort()
+  assert pm.eval("(a) => [a.length, 0 in a, 3 in a, 4 in a, 5 in a, a[3]]")(a) == [6.0, True, True, False, False, None]
+  assert a[:3] == [1.0, 2.0, 3.0]
+
+  b = pm.eval("[4, 3, 2, 1]")
+
+  def shrinking(x):
+    if len(b) > 2:
+      b.pop()
+    return x
+  b.sort(key=shrinking)
+  assert len(b) == 2
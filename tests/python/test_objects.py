@@ -185,4 +185,61 @@ def test_toString_is_prototype_toLocaleString():
 
 def test_valueof_is_prototype_valueof():
   is_valueof_correct = pm.eval("x => x.valueOf === Object.prototype.valueOf")
-  assert is_valueof_correct({})
\ No newline at end of file
+  assert is_valueof_correct({})
+
+
+def test_cached_attribute_layout_follows_type_changes():
+  class Slotted:
+    __slots__ = ('x', 'unset')
+
+    def __init__(self):
+      self.x = 1
+
+  class Point:
+    scale = 2
+
+    def __init__(self):
+      self.x = 3
+
+    @property
+    def doubled(self):
+      return self.x * self.scale
+
+  readFields = pm.eval("(obj) => [obj.x, obj.doubled, obj.scale, 'unset' in obj, Object.keys(obj).join()]")
+  slotted = Slotted()
+  assert readFields(slotted) == [1.0, None, None, False, 'unset,x']
+  slotted.unset = 0
+  assert readFields(slotted)[3]
+  point = Point()
+  assert readFields(point) == [3.0, 6.0, 2.0, False, 'doubled,scale,x']
+  Point.scale = 10
+  point.extra = 0
+  assert readFields(point) == [3.0, 30.0, 10.0, False, 'doubled,extra,scale,x']
+  Point.doubled = 5
+  assert readFields(point)[1] == 5.0
+
+
+def test_iterator_batches_keep_order_and_defer_errors():
+  def numbers():
+    yield from range(5)
+    raise ValueError("after 5")
+
+  pm.setIteratorBatchSize(3)
+  try:
+    collect = pm.eval("""(it) => {
+      const items = [];
+      try {
+        for (const item of it)
+          items.push(item);
+      } catch (error) {
+        items.push(error.message.includes('after 5'));
+      }
+      return items;
+    }""")
+    assert collect(numbers()) == [0.0, 1.0, 2.0, 3.0, 4.0, True]
+    it = iter(range(4))
+    first = pm.eval("(it) => it.next().value")(it)
+    assert first == 0.0
+    assert next(it) == 3  # the rest of the batch is buffered on the proxy
+  finally:
+    pm.setIteratorBatchSize(1)
@@ -0,0 +1,78 @@
+import gc
+import os
+import stat
+import subprocess
+import sys
+import time
+
+import pytest
+import pythonmonkey as pm
+from pythonmonkey.cli import forkserver
+
+requiresFork = pytest.mark.skipif(not hasattr(os, 'fork'), reason="the platform can't fork")
+
+
+@requiresFork
+def test_fork_and_eval():
+  pm.eval("globalThis.warmedUp = [1, 2, 3].map((x) => x * 2)")
+  pm.prefork()
+  gc.unfreeze()
+  readFd, writeFd = os.pipe()
+  pid = os.fork()
+  if pid == 0:
+    try:
+      os.close(readFd)
+      result = pm.eval("warmedUp.reduce((a, b) => a + b)")
+      os.write(writeFd, b'%d' % result)
+    finally:
+      os._exit(0)
+  os.close(writeFd)
+  with os.fdopen(readFd, 'rb') as child:
+    answer = child.read()
+  _, status = os.waitpid(pid, 0)
+  assert os.waitstatus_to_exitcode(status) == 0
+  assert answer == b'12'
+  assert pm.eval("warmedUp.length") == 3  # the parent keeps running JS
+
+
+@requiresFork
+def test_fork_server_socket_is_private(tmp_path):
+  path = str(tmp_path / 'pmjs.sock')
+  listener = forkserver.listen(path)
+  try:
+    mode = os.stat(path).st_mode
+    assert stat.S_ISSOCK(mode)
+    assert stat.S_IMODE(mode) == 0o600
+  finally:
+    listener.close()
+  forkserver.listen(path).close()  # the socket left by a previous server is replaced
+
+  regular = tmp_path / 'not-a-socket'
+  regular.write_text('keep me')
+  with pytest.raises(FileExistsError):
+    forkserver.listen(str(regular))
+  assert regular.read_text() == 'keep me'
+
+
+@requiresFork
+def test_fork_server_runs_the_program(tmp_path):
+  path = str(tmp_path / 'pmjs.sock')
+  script = tmp_path / 'program.js'
+  script.write_text("python.exit(6 * Number(arguments[arguments.length - 1]));\n")
+  server = subprocess.Popen([sys.executable, '-m', 'pythonmonkey.cli.pmjs', '--fork-server=' + path, str(script)],
+                            stdin=subprocess.DEVNULL)
+  try:
+    deadline = time.monotonic() + 30
+    while True:
+      assert server.poll() is None, "the fork server exited"
+      assert time.monotonic() < deadline, "the fork server did not start"
+      try:
+        code = forkserver.connect(path, [str(script), '7'])
+        break
+      except (FileNotFoundError, ConnectionRefusedError):
+        time.sleep(0.05)
+    assert code == 42
+    assert forkserver.connect(path, [str(script), '2']) == 12
+  finally:
+    server.terminate()
+    server.wait(10)
@@ -4,8 +4,11 @@ import random
 from datetime import datetime, timedelta, timezone
 import math
 from io import StringIO
+import os
 import sys
 import asyncio
+import copy
+import pickle
 
 
 def test_passes():
@@ -450,4 +453,492 @@ def test_iterable_attribute_console_printing():
   assert hasattr(sys.stdin, '__iter__') == True
   obj['stdin'].isTTY = sys.stdin.isatty()
   pm.eval('''(function iife(obj){console.log(obj['stdin'].isTTY);})''')(obj)
-  assert temp_out.getvalue() == "\x1b[33mfalse\x1b[39m\n" 
\ No newline at end of file
+  assert temp_out.getvalue() == "\x1b[33mfalse\x1b[39m\n" 
+
+
+def test_numbers_as_int():
+  pm.setNumbersAsInt(True)
+  try:
+    assert type(pm.eval("1 + 1")) is int
+    first = pm.eval("[1, 2, 3]")[0]
+    assert first == 1 and type(first) is int
+    assert type(pm.eval("2 ** 40")) is float
+    assert type(pm.eval("0.5")) is float
+    pm.setNumbersAsInt(True, True)
+    assert pm.eval("2 ** 40") == 2 ** 40 and type(pm.eval("2 ** 40")) is int
+    assert type(pm.eval("2 ** 60")) is float
+    assert type(pm.eval("-0")) is float
+  finally:
+    pm.setNumbersAsInt(False)
+  assert type(pm.eval("1 + 1")) is float
+
+
+def test_dates_round_trip_before_epoch():
+  identity = pm.eval("(d) => d")
+  for py_date in [datetime(1, 1, 1, tzinfo=timezone.utc), datetime(1969, 12, 31, 23, 59, 59, 999000, tzinfo=timezone.utc),
+                  datetime(2000, 2, 29, 12, 30, tzinfo=timezone.utc), datetime(9999, 12, 31, 23, 59, 59, 999000, tzinfo=timezone.utc)]:
+    assert identity(py_date) == py_date
+    assert pm.eval("(d) => d.toISOString()")(py_date) == py_date.isoformat(timespec='milliseconds').replace('+00:00', 'Z').rjust(24, '0')
+
+
+def test_dates_as_timestamps():
+  pm.setDatesAsTimestamps(True)
+  try:
+    assert pm.eval("new Date(1500)") == 1.5
+    assert pm.eval("new Date(-1500)") == -1.5
+  finally:
+    pm.setDatesAsTimestamps(False)
+  assert pm.eval("new Date(0)") == datetime(1970, 1, 1, tzinfo=timezone.utc)
+
+
+def test_eval_exceptions_lazy_message():
+  try:
+    pm.eval("throw new RangeError('not formatted yet')")
+  except pm.SpiderMonkeyError as e:
+    assert "RangeError: not formatted yet" in e.args[0]
+    assert e.args == (str(e),)
+    assert "not formatted yet" in repr(e)
+    assert pm.eval("(e) => e instanceof RangeError")(e.jsError)
+
+  try:
+    pm.eval("throw 'a primitive'")
+  except pm.SpiderMonkeyError as e:
+    copied = pickle.loads(pickle.dumps(e))
+    assert type(copied) is pm.SpiderMonkeyError and copied.args == e.args and "a primitive" in str(copied)
+    assert copy.copy(e).args == e.args
+
+    def rethrow():
+      raise e
+    assert pm.eval("(f) => { try { f() } catch (e) { return String(e) } }")(rethrow) == 'a primitive'
+
+  def thrower():
+    raise ValueError("lazy")
+  err = pm.eval("(f) => { try { f() } catch (e) { return e } }")(thrower)
+  assert pm.eval("(e) => typeof e.stack")(err) == "string"
+  assert pm.eval("(e) => e.message.startsWith('Python ValueError: lazy\\nTraceback')")(err)
+  assert pm.eval("(e) => { e.message = 'replaced'; return e.message }")(err) == "replaced"
+
+
+def test_worker_runs_in_its_own_runtime():
+  worker = pm.Worker("""
+    const seen = typeof python;  // the worker has none of the main runtime's globals
+    onmessage = (event) => {
+      if (event.data === 'fail') throw new TypeError('bad message');
+      Promise.resolve(seen).then((s) => postMessage({ doubled: event.data.map((x) => x * 2), seen: s }));
+    };
+  """)
+  worker.postMessage([1, 2, 3])
+  assert worker.getMessage(timeout=10) == {'doubled': [2.0, 4.0, 6.0], 'seen': 'undefined'}
+  worker.postMessage('fail')
+  with pytest.raises(pm.SpiderMonkeyError, match="bad message"):
+    worker.getMessage(timeout=10)
+  with pytest.raises(TimeoutError):
+    worker.getMessage(timeout=0.01)
+  worker.terminate()
+  with pytest.raises(RuntimeError):
+    worker.postMessage(1)
+
+
+def test_worker_terminate_interrupts_running_code():
+  worker = pm.Worker("postMessage('started'); for (;;) {}")
+  assert worker.getMessage(timeout=10) == 'started'
+  worker.terminate()
+
+
+def test_release_gil_lets_python_threads_run():
+  import threading
+  ticks = []
+  done = threading.Event()
+
+  def tick():
+    while not done.is_set():
+      ticks.append(1)
+      done.wait(0.001)
+  pm.setReleaseGIL(True)
+  try:
+    thread = threading.Thread(target=tick)
+    thread.start()
+    pm.eval("const end = Date.now() + 200; while (Date.now() < end) {}")
+    ticks_during_js = len(ticks)
+    done.set()
+    thread.join()
+  finally:
+    pm.setReleaseGIL(False)
+  assert ticks_during_js > 10
+
+
+def test_release_gil_rejects_js_from_another_thread():
+  import threading
+  errors = []
+  started = threading.Event()
+
+  obj = pm.eval("({a: 1})")
+  array = pm.eval("[1, 2]")
+
+  def enter():
+    started.wait()
+    for use in (lambda: pm.eval("1"), lambda: obj['a'], lambda: len(array)):
+      try:
+        use()
+      except RuntimeError as error:
+        errors.append(str(error))
+      else:
+        errors.append(None)
+  pm.setReleaseGIL(True)
+  try:
+    thread = threading.Thread(target=enter)
+    thread.start()
+    pm.eval("(started, finished) => { started(); const end = Date.now() + 5000; while (!finished() && Date.now() < end) {} }")(
+      started.set, lambda: len(errors) == 3)
+    thread.join()
+  finally:
+    pm.setReleaseGIL(False)
+  assert errors == ["PythonMonkey is already running JS code on another thread"] * 3
+  assert obj['a'] == 1.0 and len(array) == 2
+  assert pm.eval("1 + 1") == 2  # usable again from the thread that owns it
+
+
+def test_stencil_cache_reuses_compiled_scripts(tmp_path):
+  code = "(function stencilCacheTest(x) { return x * 6; })(7)"
+  pm.stats(reset=True)
+  assert pm.eval(code) == 42.0
+  assert pm.eval(code) == 42.0
+  scripts = pm.stats()['scripts']
+  assert scripts['compiled'] == 1 and scripts['memoryHits'] == 1
+
+  pm.setStencilCache(0, str(tmp_path))  # on disk only
+  try:
+    code = "(function stencilDiskCacheTest(x) { return x * 7; })(6)"
+    assert pm.eval(code) == 42.0
+    assert pm.eval(code) == 42.0
+    scripts = pm.stats(reset=True)['scripts']
+    assert scripts['stored'] == 1 and scripts['diskHits'] == 1
+
+    pm.setStencilCache(0, None)  # no store at all
+    code = "(function stencilNoCacheTest(x) { return x * 2; })(21)"
+    assert pm.eval(code) == 42.0
+    assert pm.eval(code) == 42.0
+    scripts = pm.stats(reset=True)['scripts']
+    assert scripts['stored'] == 0 and scripts['diskHits'] == 0 and scripts['compiled'] == 2
+  finally:
+    pm.setStencilCache()
+
+
+def test_compiled_script_runs_with_fresh_bindings():
+  rule = pm.compile("const total = price * quantity; total > limit")
+  assert isinstance(rule, pm.JSScript)
+  assert rule.run({'price': 10, 'quantity': 3, 'limit': 20}) is True
+  assert rule.run({'price': 1, 'quantity': 3, 'limit': 20}) is False
+  counter = pm.compile("globalThis.compiledRuns = (globalThis.compiledRuns || 0) + 1")
+  counter.run()
+  assert counter.run() == 2.0
+
+
+def test_import_es_module_from_file(tmp_path):
+  (tmp_path / 'dependency.mjs').write_text("export const answer = 42;\n")
+  (tmp_path / 'main.mjs').write_text(
+    "import { answer } from './dependency.mjs';\n"
+    "export const doubled = answer * 2;\n"
+    "export const url = import.meta.url;\n")
+  namespace = pm.importModule(str(tmp_path / 'main.mjs'))
+  assert namespace['doubled'] == 84.0
+  assert namespace['url'].endswith('main.mjs')
+  assert pm.importModule(str(tmp_path / 'main.mjs'))['doubled'] == 84.0
+
+
+def test_eval_module_option_returns_namespace():
+  namespace = pm.eval("export default 'es module'; export function f() { return 1; }", {'module': True})
+  assert namespace['default'] == 'es module'
+  assert namespace['f']() == 1.0
+
+
+def test_lazy_globals_load_on_first_use():
+  assert pm.eval("typeof URLSearchParams") == 'function'
+  assert pm.eval("new URLSearchParams('a=1').get('a')") == '1'
+  assert pm.eval("typeof debuggerGlobal.Debugger") == 'function'
+  assert pm.eval("debuggerGlobal === debuggerGlobal")
+
+
+def test_gc_tuning_and_incremental_slices():
+  pm.setGCParameter('sliceTimeBudgetMs', 5)
+  assert pm.getGCParameter('sliceTimeBudgetMs') == 5
+  pm.eval("globalThis.garbage = Array.from({ length: 10000 }, (_, i) => ({ i })); delete globalThis.garbage")
+  number = pm.getGCParameter('number')
+  while pm.gcSlice(1):
+    pass
+  assert pm.getGCParameter('number') > number
+  pm.collect(shrinking=True)
+  with pytest.raises(ValueError):
+    pm.setGCParameter('bytes', 0)
+  growth = pm.getGCParameter('lowFrequencyHeapGrowth')
+  with pytest.raises(ValueError):
+    pm.setGCParameter('lowFrequencyHeapGrowth', 50)
+  assert pm.getGCParameter('lowFrequencyHeapGrowth') == growth
+  with pytest.raises(ValueError):
+    pm.setGCParameter('minNurseryBytes', 1)
+  with pytest.raises(KeyError):
+    pm.setGCParameter('notAParameter', 1)
+  with pytest.raises(KeyError):
+    pm.getGCParameter('notAParameter')
+
+
+def test_cross_heap_cycle_is_collected():
+  import gc
+  import weakref
+
+  class Holder:
+    pass
+  pm.setCollectCrossHeapCycles(True)
+  try:
+    holder = Holder()
+    holder.js = pm.eval("({})")
+    holder.js['callback'] = lambda: holder
+    holderRef = weakref.ref(holder)
+    del holder
+    gc.collect()
+    assert holderRef() is None
+  finally:
+    pm.setCollectCrossHeapCycles(False)
+
+
+def test_memory_stats_counts_bridge_memory():
+  before = pm.memoryStats()
+  keep = [pm.eval("(x) => x")({'a': 1}), pm.eval("[1, 2]")]
+  after = pm.memoryStats(detailed=True)
+  assert after['heap']['gcBytes'] > 0
+  assert after['proxiesOfJSValues']['array'] >= before['proxiesOfJSValues']['array'] + 1
+  assert after['persistentRoots'] >= before['persistentRoots'] + 1
+  assert after['runtime']['gcHeapChunkTotal'] > 0
+  del keep
+
+
+def test_recycled_proxies_keep_their_type_and_identity():
+  make = pm.eval("(i) => [{ i }, [i, i, i], () => i, { a: i, b: i }]")
+  baseline = pm.memoryStats()['proxiesOfJSValues']
+  for attempt in range(3):
+    kept = []
+    for i in range(600):  # more proxies than a free list keeps, of the types sharing the pools of roots
+      obj, arr, fn, pair = make(i)
+      assert type(obj) is pm.JSObjectProxy and len(obj) == 1 and obj['i'] == i
+      assert type(arr) is pm.JSArrayProxy and len(arr) == 3 and arr[2] == i
+      assert type(fn) is pm.JSFunctionProxy and fn() == i
+      assert type(pair) is pm.JSObjectProxy and len(pair) == 2 and list(pair.keys()) == ['a', 'b']
+      assert [key for key in obj] == ['i'] and list(arr) == [i, i, i]
+      if i % 100 == 0:
+        kept.append((i, obj, arr))
+      del obj, arr, fn, pair
+    for i, obj, arr in kept:
+      assert obj['i'] == i and arr[0] == i
+      assert pm.eval("(o, a) => o.i === a[0]")(obj, arr)
+
+    live = pm.eval("globalThis.recycled = { attempt: %d }; recycled" % attempt)
+    assert pm.eval("recycled") is live  # the cache hands out the live proxy, not a recycled one
+    stats = pm.memoryStats()['proxiesOfJSValues']
+    assert stats['object'] >= baseline['object'] + len(kept) + 1
+    assert stats['array'] >= baseline['array'] + len(kept)
+    del kept, live
+  pm.collect()
+  stats = pm.memoryStats()['proxiesOfJSValues']
+  assert stats['object'] <= baseline['object'] + 1
+  assert stats['array'] <= baseline['array']
+
+
+def test_eval_timeout_and_heap_limit():
+  with pytest.raises(TimeoutError):
+    pm.eval("try { for (;;) {} } catch (e) {}", {'timeoutMs': 50})
+  with pytest.raises(MemoryError):
+    pm.eval("{ const a = []; try { for (;;) a.push({}); } catch (e) {} }", {'maxHeapBytes': 64 * 1024 * 1024})
+  assert pm.eval("1 + 1", {'timeoutMs': 1000, 'maxHeapBytes': 1 << 30}) == 2
+
+
+def test_engine_options():
+  options = pm.getEngineOptions()
+  threshold = options['baselineWarmUpThreshold']
+  pm.setEngineOptions(baselineWarmUpThreshold=0)
+  try:
+    assert pm.getEngineOptions()['baselineWarmUpThreshold'] == 0
+    assert pm.eval("(function f(n) { return n < 2 ? n : f(n - 1) + f(n - 2); })(15)") == 610
+  finally:
+    pm.setEngineOptions(baselineWarmUpThreshold=threshold)
+  with pytest.raises(KeyError):
+    pm.setEngineOptions(warp=True)
+
+
+def test_compile_async():
+  async def compileAndRun():
+    script = await pm.compileAsync("var compiledOffThread = 6 * 7; compiledOffThread")
+    with pytest.raises(pm.SpiderMonkeyError):
+      await pm.compileAsync("let = = ;")
+    return script.run()
+  assert asyncio.run(compileAndRun()) == 42
+
+
+def test_console_output_is_batched_in_order():
+  temp_out = StringIO()
+  temp_err = StringIO()
+  sys.stdout = temp_out
+  sys.stderr = temp_err
+  try:
+    pm.eval("""
+      for (let i = 0; i < 3; i++)
+        console.log('line', i);
+      python.stdout.write('from python\\n');
+      console.error('oops');
+      console.log('%s', 'last');
+    """)
+    assert temp_out.getvalue() == "line 0\nline 1\nline 2\nfrom python\nlast\n"
+    assert temp_err.getvalue() == "oops\n"
+  finally:
+    sys.stdout = sys.__stdout__
+    sys.stderr = sys.__stderr__
+
+
+def test_structured_clone():
+  result = pm.eval("""
+    const buffer = new Uint8Array([1, 2, 3]).buffer;
+    const original = { map: new Map([[1, 'a']]), date: new Date(0), buffer };
+    original.self = original;
+    const copy = structuredClone(original, { transfer: [buffer] });
+    [copy !== original, copy.self === copy, copy.map.get(1), copy.date.getTime(), buffer.byteLength, new Uint8Array(copy.buffer)[2]]
+  """)
+  assert list(result) == [True, True, 'a', 0.0, 0.0, 3.0]
+  assert pm.eval("try { structuredClone(() => 1) } catch (error) { error.name }") == 'DataCloneError'
+
+
+def test_serialize_and_deserialize():
+  data = pm.serialize({'a': [1, 2], 'b': 'text'})
+  assert isinstance(data, bytes)
+  copy = pm.deserialize(data)
+  assert copy['a'][1] == 2.0 and copy['b'] == 'text'
+
+  cyclic = pm.eval("const cyclic = { n: 1, set: new Set([2]) }; cyclic.self = cyclic; cyclic")
+  copy = pm.deserialize(bytearray(pm.serialize(cyclic)))
+  assert copy['self']['n'] == 1.0
+  assert pm.eval("(copy) => copy.self === copy && copy.set.has(2)")(copy)
+
+  with pytest.raises(pm.SpiderMonkeyError):
+    pm.serialize(pm.eval("() => 1"))
+  with pytest.raises(pm.SpiderMonkeyError):
+    pm.deserialize(b'not serialized')
+
+
+def test_require_cache_is_persisted(tmp_path):
+  package = tmp_path / 'node_modules' / 'cached-package'
+  package.mkdir(parents=True)
+  (package / 'index.js').write_text("exports.answer = 42;\n")
+  cacheFile = tmp_path / 'require-cache'
+  fs = pm.internalBinding('fs')
+  pm.setRequireCache(str(cacheFile))
+  try:
+    assert fs.prewarm(str(tmp_path)) >= 2
+    assert fs.statSync(str(package / 'index.js'))
+    assert not fs.existsSync(str(package / 'missing.js'))
+    assert not fs.existsSync(str(tmp_path / 'node_modules' / 'missing-package' / 'index.js'))
+    require = pm.createRequire(str(tmp_path / 'main.js'))
+    assert require('cached-package')['answer'] == 42.0
+    fs.setResolution(str(tmp_path), 'cached-package', str(package / 'index.js'))
+    assert fs.getResolution(str(tmp_path), 'cached-package') == str(package / 'index.js')
+    assert fs.saveCache()
+    assert str(package) in cacheFile.read_text()
+
+    assert fs.getResolution(str(tmp_path), 'cached-package', '/other/search/path') is None  # keyed on the search paths
+
+    fs.clearStatCache()
+    pm.setRequireCache(str(cacheFile))  # loaded again, the directories did not change
+    assert fs.getResolution(str(tmp_path), 'cached-package') == str(package / 'index.js')
+
+    fs.clearStatCache()
+    (package / 'index.js').write_text("exports.answer = 43; // rewritten in place\n")
+    pm.setRequireCache(str(cacheFile))  # the file changed, its directory did not
+    assert fs.getResolution(str(tmp_path), 'cached-package') is None
+  finally:
+    pm.setRequireCache(None)
+    fs.clearStatCache()
+
+
+def test_prewarm_require_cache_needs_a_cache_file(tmp_path):
+  import subprocess
+  environment = {name: value for name, value in os.environ.items() if name != 'PYTHONMONKEY_REQUIRE_CACHE'}
+  result = subprocess.run([sys.executable, '-m', 'pythonmonkey.cli.pmjs', '--prewarm-require-cache'],
+                          cwd=tmp_path, env=environment, capture_output=True, text=True)
+  assert result.returncode == 2
+  assert '--require-cache' in result.stderr
+
+
+def test_fs_binding_reads_text_and_finds_packages_installed_later(tmp_path):
+  fs = pm.internalBinding('fs')
+  text = tmp_path / 'latin1.js'
+  text.write_bytes('caf\xe9\r\nfin\rend\n'.encode('latin-1'))
+  assert fs.readFileSync(str(text), 'latin-1') == 'caf\xe9\nfin\nend\n'
+  (tmp_path / 'crlf.js').write_bytes(b'a\r\nb\r\n')
+  assert fs.readFileSync(str(tmp_path / 'crlf.js'), 'utf8') == 'a\nb\n'
+
+  nodeModules = tmp_path / 'node_modules'
+  nodeModules.mkdir()
+  try:
+    assert not fs.existsSync(str(nodeModules / 'late-package' / 'index.js'))
+    (nodeModules / 'late-package').mkdir()
+    (nodeModules / 'late-package' / 'index.js').write_text("exports.late = true;\n")
+    assert fs.existsSync(str(nodeModules / 'late-package' / 'index.js'))
+  finally:
+    fs.clearStatCache()
+
+
+def test_profiler_samples_js_and_bridge_frames(tmp_path):
+  busy = pm.eval("""(function busy(pyFunc) {
+    const end = Date.now() + 200;
+    let n = 0;
+    while (Date.now() < end)
+      n += pyFunc(n) ? 1 : 0;
+    return n;
+  })""", {'filename': 'profiled.js'})
+  pm.profiler.start(0.0005)
+  with pytest.raises(RuntimeError):
+    pm.profiler.start()
+  busy(lambda n: n % 2)
+  profile = pm.profiler.stop(str(tmp_path / 'test.cpuprofile'))
+  with pytest.raises(RuntimeError):
+    pm.profiler.stop()
+
+  assert len(profile['samples']) == len(profile['timeDeltas']) > 0
+  names = {node['callFrame']['functionName'] for node in profile['nodes']}
+  assert '(root)' in names and 'busy' in names and 'callPyFunc' in names
+  busyNode = next(node for node in profile['nodes'] if node['callFrame']['functionName'] == 'busy')
+  assert busyNode['callFrame']['url'] == 'profiled.js' and busyNode['callFrame']['lineNumber'] == 0
+  assert (tmp_path / 'test.cpuprofile').read_text().startswith('{"nodes":[')
+
+
+def test_stats_count_hot_paths():
+  pm.stats(reset=True)
+  countKeys = pm.eval("(d, l) => { Object.keys(d); return l.length + 'x'; }")
+  d = {'a': 1}
+  countKeys(d, [1, 2])
+  hotPaths = pm.stats()['hotPaths']
+  assert hotPaths['PyDictProxyHandler']['ownPropertyKeys'] >= 1
+  assert hotPaths['PyListProxyHandler']['getOwnPropertyDescriptor'] >= 1
+  assert hotPaths['toJS']['dict'] == 1 and hotPaths['toJS']['list'] == 1
+  assert hotPaths['toPython']['string'] == 1
+  obj = pm.eval("({ a: 1 })")
+  assert obj.a == 1 and len(obj) == 1
+  hotPaths = pm.stats(reset=True)['hotPaths']
+  assert hotPaths['JSObjectProxy']['get'] == 1 and hotPaths['JSObjectProxy']['length'] == 1
+  assert pm.stats()['hotPaths']['JSObjectProxy']['get'] == 0
+
+
+def test_retention_groups_references_by_holder_and_type():
+  pm.trackRetention(stackSampleRate=1.0)
+  try:
+    held = {'payload': 'x' * 1000}
+    keep = pm.eval("(d) => { globalThis.retainedDict = d; return { kept: true }; }")(held)
+    report = pm.retention()
+    assert report['tracking'] and report['stackSampleRate'] == 1.0
+    dictGroup = next(group for group in report['pythonObjects'] if group['holder'] == 'PyDictProxyHandler' and group['type'] == 'dict')
+    assert dictGroup['count'] == 1 and dictGroup['bytes'] > 0
+    assert 'test_retention_groups_references_by_holder_and_type' in dictGroup['stacks'][0]['stack']
+    objectGroup = next(group for group in report['jsObjects'] if group['holder'] == 'JSObjectProxy')
+    assert objectGroup['class'] == 'Object' and objectGroup['count'] >= 1
+    assert keep.kept
+  finally:
+    pm.eval("delete globalThis.retainedDict")
+    pm.trackRetention(False)
+  assert pm.retention() == {'tracking': False, 'stackSampleRate': 0.0, 'pythonObjects': [], 'jsObjects': []}
@@ -2,6 +2,7 @@ import pythonmonkey as pm
 import gc
 import random
 import copy
+import io
 
 
 def test_identity():
@@ -46,6 +47,26 @@ def test_eval_ucs4_string_matches_evaluated_string():
   assert py_ucs4_string == js_ucs4_string
 
 
+def test_ucs4_string_to_js_length_and_round_trip():
+  # long enough to mix blocks of BMP-only code points with blocks containing astral characters
+  py_ucs4_string = ("abcdefgh" * 3) + "🀄" + ("ՄԸՋ" * 5) + "🜢🀛" + "xyz"
+  js_length = pm.eval("(s) => s.length")(py_ucs4_string)
+  assert js_length == len(py_ucs4_string) + 3  # each astral character is a surrogate pair in JS
+  assert pm.eval("(s) => s")(py_ucs4_string) == py_ucs4_string
+
+
+def test_lazy_string_normalization():
+  pm.setLazyStringNormalization(True)
+  try:
+    js_ucs4_string = pm.eval('"🀄🀛🜢"')
+    assert len(js_ucs4_string) == 6  # surrogate pairs are left in place
+    assert str(js_ucs4_string) == "🀄🀛🜢"
+    assert len(str(js_ucs4_string)) == 3
+  finally:
+    pm.setLazyStringNormalization(False)
+  assert pm.eval('"🀄🀛🜢"') == "🀄🀛🜢"
+
+
 def test_eval_latin1_string_fuzztest():
   n = 10
   for _ in range(n):
@@ -289,4 +310,24 @@ def test_string_proxy_deepcopy():
   hello_world = say(copy.deepcopy(who))
   assert hello_world == "Hello World"
   assert hello_world is not who
-  
\ No newline at end of file
+
+
+def test_utf8_of_js_strings():
+  ascii = pm.eval("'hello '.repeat(20000)")
+  assert pm.utf8(ascii) == b'hello ' * 20000
+  text = pm.eval("'é😀\\uD800'")
+  assert pm.utf8(text) == 'é😀�'.encode('utf-8')
+  assert pm.utf8('a python str') == b'a python str'
+  buffer = bytearray(16)
+  assert pm.writeUtf8(text, buffer) == 9
+  assert bytes(buffer[:9]) == pm.utf8(text)
+  assert pm.writeUtf8(text, memoryview(buffer)[4:]) == 9
+  try:
+    pm.writeUtf8(ascii, buffer)
+    assert False
+  except ValueError:
+    pass
+  out = io.BytesIO()
+  big = pm.eval("'é'.repeat(100000)")
+  assert pm.writeUtf8(big, out) == 200000
+  assert out.getvalue() == ('é' * 100000).encode('utf-8')
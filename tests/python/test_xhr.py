@@ -94,4 +94,69 @@ def test_xhr():
     assert result_json["fromPM"] == "snakesandmonkeys"
     assert result_json["User-Agent"].startswith("Python/")
     httpd.shutdown()
-  asyncio.run(async_fn())
\ No newline at end of file
+  asyncio.run(async_fn())
+
+def test_xhr_stream_and_arraybuffer():
+  body = bytes(range(256)) * 4096  # 1 MiB
+
+  class StreamingHandler(BaseHTTPRequestHandler):
+    def log_request(self, *args) -> None:
+      return
+
+    def do_GET(self):
+      self.send_response(200)
+      self.send_header('Content-Length', str(len(body)))
+      self.end_headers()
+      for offset in range(0, len(body), 65536):
+        self.wfile.write(body[offset:offset + 65536])
+
+  httpd = HTTPServer(('localhost', 4002), StreamingHandler)
+  thread = threading.Thread(target=httpd.serve_forever)
+  thread.daemon = True
+  thread.start()
+
+  async def async_fn():
+    streamed = await pm.eval("""
+      new Promise(function (resolve, reject) {
+        const xhr = new XMLHttpRequest();
+        xhr.open('GET', 'http://localhost:4002');
+        xhr.responseType = 'stream';
+        xhr.onerror = (ev) => reject(ev.error);
+        xhr.onreadystatechange = async function () {
+          if (xhr.readyState !== XMLHttpRequest.HEADERS_RECEIVED)
+            return;
+          let length = 0, sum1 = 0, sum2 = 0; // Fletcher-16, it tells a reordered or corrupted chunk
+          for await (const chunk of xhr.response)
+          {
+            length += chunk.length;
+            for (const byte of chunk)
+            {
+              sum1 = (sum1 + byte) % 255;
+              sum2 = (sum2 + sum1) % 255;
+            }
+          }
+          resolve([length, sum2 * 256 + sum1]);
+        };
+        xhr.send();
+      });
+      """)
+    assert int(streamed[0]) == len(body)
+    sum1 = sum2 = 0
+    for byte in body:
+      sum1 = (sum1 + byte) % 255
+      sum2 = (sum2 + sum1) % 255
+    assert int(streamed[1]) == sum2 * 256 + sum1
+
+    buffer = await pm.eval("""
+      new Promise(function (resolve, reject) {
+        const xhr = new XMLHttpRequest();
+        xhr.open('GET', 'http://localhost:4002');
+        xhr.responseType = 'arraybuffer';
+        xhr.onload = () => resolve(new Uint8Array(xhr.response));
+        xhr.onerror = (ev) => reject(ev.error);
+        xhr.send();
+      });
+      """)
+    assert bytes(buffer) == body
+    httpd.shutdown()
+  asyncio.run(async_fn())